@@ -23,125 +23,105 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 
 #include "BathymetrySaverTool.h"
 
+#include <string.h>
+#include <stdio.h>
+#include <zlib.h>
 #include <stdexcept>
 #include <iomanip>
-#include <Misc/PrintInteger.h>
+#include <Misc/SizedTypes.h>
+#include <Misc/Endianness.h>
 #include <Misc/ThrowStdErr.h>
 #include <Misc/MessageLogger.h>
 #include <Misc/StandardValueCoders.h>
 #include <Misc/ConfigurationFile.h>
-#include <IO/ValueSource.h>
+#include <IO/OpenFile.h>
 #include <IO/OStream.h>
-#include <Comm/TCPPipe.h>
+#include <Realtime/Time.h>
 #include <Math/Math.h>
-#include <Vrui/OpenFile.h>
 
+#include "HTTPUpdateClient.h"
+#include "TerrainMesh.h"
 #include "WaterTable2.h"
 #include "Sandbox.h"
 
+namespace {
+
+/**************
+Helper objects:
+**************/
+
+const double demGridCenter[2]={609959.0,4268028.0}; // Coordenadas UTM del centro de la cuadrícula exportada
+const char* saveFormatNames[6]={"DEM","Raw","NPY","GeoTIFF","STL","OBJ"}; // Nombres de los formatos de exportación en los archivos de configuración
+
+}
+
 /**********************************************************
 Methods of class BathymetrySaverToolFactory::Configuration:
 **********************************************************/
 
 BathymetrySaverToolFactory::Configuration::Configuration(void)
 	:saveFileName("BathymetrySaverTool.dem"),
+	 saveFormat(DEM_FORMAT),saveWaterDepth(false),compressGeoTIFF(false),
 	 postUpdate(false),postUpdatePort(80),postUpdatePage(""),
 	 postUpdateMessage("app.GenerateTileCache();"),
-	 gridScale(1.0)
+	 postUpdateConnectTimeout(2.0),postUpdateReadTimeout(5.0),
+	 postUpdateMaxRetries(3),postUpdateRetryDelay(0.5),
+	 meshMaxTriangles(100000),meshBaseThickness(2.0),meshNumThreads(2),
+	 gridScale(1.0),
+	 maxQueuedSaves(4)
 	{
 	}
 
 void BathymetrySaverToolFactory::Configuration::read(const Misc::ConfigurationFileSection& cfs)
 	{
 	saveFileName=cfs.retrieveString("./saveFileName",saveFileName);
+	std::string saveFormatName=cfs.retrieveString("./saveFormat",saveFormatNames[saveFormat]);
+	int formatIndex;
+	for(formatIndex=0;formatIndex<6&&strcasecmp(saveFormatName.c_str(),saveFormatNames[formatIndex])!=0;++formatIndex)
+		;
+	if(formatIndex==6)
+		Misc::throwStdErr("BathymetrySaverTool: Unknown save format %s",saveFormatName.c_str());
+	saveFormat=SaveFormat(formatIndex);
+	saveWaterDepth=cfs.retrieveValue<bool>("./saveWaterDepth",saveWaterDepth);
+	compressGeoTIFF=cfs.retrieveValue<bool>("./compressGeoTIFF",compressGeoTIFF);
 	postUpdate=cfs.retrieveValue<bool>("./postUpdate",postUpdate);
 	postUpdateHostName=cfs.retrieveString("./postUpdateHostName",postUpdateHostName);
 	postUpdatePort=cfs.retrieveValue<int>("./postUpdatePort",postUpdatePort);
 	postUpdatePage=cfs.retrieveString("./postUpdatePage",postUpdatePage);
 	postUpdateMessage=cfs.retrieveString("./postUpdateMessage",postUpdateMessage);
+	postUpdateConnectTimeout=cfs.retrieveValue<double>("./postUpdateConnectTimeout",postUpdateConnectTimeout);
+	postUpdateReadTimeout=cfs.retrieveValue<double>("./postUpdateReadTimeout",postUpdateReadTimeout);
+	postUpdateMaxRetries=cfs.retrieveValue<unsigned int>("./postUpdateMaxRetries",postUpdateMaxRetries);
+	postUpdateRetryDelay=cfs.retrieveValue<double>("./postUpdateRetryDelay",postUpdateRetryDelay);
+	meshMaxTriangles=cfs.retrieveValue<unsigned int>("./meshMaxTriangles",meshMaxTriangles);
+	meshBaseThickness=cfs.retrieveValue<double>("./meshBaseThickness",meshBaseThickness);
+	meshNumThreads=cfs.retrieveValue<unsigned int>("./meshNumThreads",meshNumThreads);
 	gridScale=cfs.retrieveValue<double>("./gridScale",gridScale);
+	maxQueuedSaves=cfs.retrieveValue<unsigned int>("./maxQueuedSaves",maxQueuedSaves);
 	}
 
 void BathymetrySaverToolFactory::Configuration::write(Misc::ConfigurationFileSection& cfs) const
 	{
 	cfs.storeString("./saveFileName",saveFileName);
+	cfs.storeString("./saveFormat",saveFormatNames[saveFormat]);
+	cfs.storeValue<bool>("./saveWaterDepth",saveWaterDepth);
+	cfs.storeValue<bool>("./compressGeoTIFF",compressGeoTIFF);
 	cfs.storeValue<bool>("./postUpdate",postUpdate);
 	cfs.storeString("./postUpdateHostName",postUpdateHostName);
 	cfs.storeValue<int>("./postUpdatePort",postUpdatePort);
 	cfs.storeString("./postUpdatePage",postUpdatePage);
 	cfs.storeString("./postUpdateMessage",postUpdateMessage);
+	cfs.storeValue<double>("./postUpdateConnectTimeout",postUpdateConnectTimeout);
+	cfs.storeValue<double>("./postUpdateReadTimeout",postUpdateReadTimeout);
+	cfs.storeValue<unsigned int>("./postUpdateMaxRetries",postUpdateMaxRetries);
+	cfs.storeValue<double>("./postUpdateRetryDelay",postUpdateRetryDelay);
+	cfs.storeValue<unsigned int>("./meshMaxTriangles",meshMaxTriangles);
+	cfs.storeValue<double>("./meshBaseThickness",meshBaseThickness);
+	cfs.storeValue<unsigned int>("./meshNumThreads",meshNumThreads);
 	cfs.storeValue<double>("./gridScale",gridScale);
+	cfs.storeValue<unsigned int>("./maxQueuedSaves",maxQueuedSaves);
 	}
 
-/*******************************************
-Methods of class BathymetrySaverToolFactory:
-*******************************************/
-
-BathymetrySaverToolFactory::BathymetrySaverToolFactory(WaterTable2* sWaterTable,Vrui::ToolManager& toolManager)
-	:ToolFactory("BathymetrySaverTool",toolManager),
-	 waterTable(sWaterTable)
-	{
-	/* Recuperar la cuadrícula de batimetría y tamaños de celda: */
-	for(int i=0;i<2;++i)
-		{
-		gridSize[i]=waterTable->getBathymetrySize(i);
-		cellSize[i]=waterTable->getCellSize()[i];
-		}
-	
-	/* Inicializar diseño de herramienta: */
-	layout.setNumButtons(1);
-	
-	#if 0
-	/* Insertar clase en la jerarquía de clases: */
-	ToolFactory* toolFactory=toolManager.loadClass("Tool");
-	toolFactory->addChildClass(this);
-	addParentClass(toolFactory);
-	#endif
-	
-	/* Cargar ajustes de clase: */
-	Misc::ConfigurationFileSection cfs=toolManager.getToolClassSection(getClassName());
-	configuration.read(cfs);
-	
-	/* Establecer el puntero de fábrica de la clase de herramienta: */
-	BathymetrySaverTool::factory=this;
-	}
-
-BathymetrySaverToolFactory::~BathymetrySaverToolFactory(void)
-	{
-	/* Restablecer el puntero de fábrica de la clase de herramienta: */
-	BathymetrySaverTool::factory=0;
-	}
-
-const char* BathymetrySaverToolFactory::getName(void) const
-	{
-	return "Save Bathymetry";
-	}
-
-const char* BathymetrySaverToolFactory::getButtonFunction(int) const
-	{
-	return "Save Bathymetry";
-	}
-
-Vrui::Tool* BathymetrySaverToolFactory::createTool(const Vrui::ToolInputAssignment& inputAssignment) const
-	{
-	return new BathymetrySaverTool(this,inputAssignment);
-	}
-
-void BathymetrySaverToolFactory::destroyTool(Vrui::Tool* tool) const
-	{
-	delete tool;
-	}
-
-/********************************************
-Static elements of class BathymetrySaverTool:
-********************************************/
-
-BathymetrySaverToolFactory* BathymetrySaverTool::factory=0;
-
-/************************************
-Methods of class BathymetrySaverTool:
-************************************/
-
 namespace {
 
 /****************
@@ -206,12 +186,25 @@ std::ostream& printFloat8(std::ostream& os,double value)
 	return os;
 	}
 
+void writeTiffEntry(IO::File& file,Misc::UInt16 tag,Misc::UInt16 type,Misc::UInt32 count,Misc::UInt32 value)
+	{
+	/* Escribe una entrada de directorio TIFF; los valores cortos en línea ocupan los bytes bajos en orden little-endian: */
+	file.write<Misc::UInt16>(tag);
+	file.write<Misc::UInt16>(type);
+	file.write<Misc::UInt32>(count);
+	file.write<Misc::UInt32>(value);
+	}
+
 }
 
-void BathymetrySaverTool::writeDEMFile(void) const
+/*******************************************
+Methods of class BathymetrySaverToolFactory:
+*******************************************/
+
+void BathymetrySaverToolFactory::writeDEMFile(const GLfloat* bathymetry,const BathymetrySaverToolFactory::Configuration& jobConfiguration) const
 	{
 	/* Abra el archivo de salida como un std::ostream: */
-	IO::OStream demFile(Vrui::openFile(configuration.saveFileName.c_str(),IO::File::WriteOnly));
+	IO::OStream demFile(IO::openFile(jobConfiguration.saveFileName.c_str(),IO::File::WriteOnly));
 	
 	/* Escribe el nombre de batimetría: */
 	static const char* fileHeader="Augmented Reality Sandbox bathymetry grid";
@@ -234,17 +227,16 @@ void BathymetrySaverTool::writeDEMFile(void) const
 	printInt2(demFile,2); // Unidad vertical en metros
 	
 	/* Recuperar el factor de escala de la cuadrícula: */
-	double gs=configuration.gridScale;
+	double gs=jobConfiguration.gridScale;
 	
 	/* Escriba el polígono de cobertura DEM: */
 	printInt2(demFile,4); // El polígono es cuadrángulo
 	
 	/* Huevo de Pascua: todos los DEM exportados se centran en Davis, CA: */
-	static const double gridCenter[2]={609959.0, 4268028.0};
-	double west=gridCenter[0]-double(factory->gridSize[0]-1)*double(factory->cellSize[0])*gs*0.5;
-	double east=gridCenter[0]+double(factory->gridSize[0]-1)*double(factory->cellSize[0])*gs*0.5;
-	double north=gridCenter[1]+double(factory->gridSize[1]-1)*double(factory->cellSize[1])*gs*0.5;
-	double south=gridCenter[1]-double(factory->gridSize[1]-1)*double(factory->cellSize[1])*gs*0.5;
+	double west=demGridCenter[0]-double(gridSize[0]-1)*double(cellSize[0])*gs*0.5;
+	double east=demGridCenter[0]+double(gridSize[0]-1)*double(cellSize[0])*gs*0.5;
+	double north=demGridCenter[1]+double(gridSize[1]-1)*double(cellSize[1])*gs*0.5;
+	double south=demGridCenter[1]-double(gridSize[1]-1)*double(cellSize[1])*gs*0.5;
 	
 	/* Recorra el polígono en el sentido de las agujas del reloj, comenzando en la esquina suroeste: */
 	printFloat8(demFile,west);
@@ -258,9 +250,9 @@ void BathymetrySaverTool::writeDEMFile(void) const
 	
 	/* Calcule y escriba el rango de elevación de la cuadrícula: */
 	GLfloat elevMin,elevMax;
-	elevMin=elevMax=bathymetryBuffer[0];
-	const GLfloat* bbPtr=bathymetryBuffer+1;
-	for(GLsizei count=factory->gridSize[1]*factory->gridSize[0]-1;count>0;--count,++bbPtr)
+	elevMin=elevMax=bathymetry[0];
+	const GLfloat* bbPtr=bathymetry+1;
+	for(GLsizei count=gridSize[1]*gridSize[0]-1;count>0;--count,++bbPtr)
 		{
 		if(elevMin>*bbPtr)
 			elevMin=*bbPtr;
@@ -268,9 +260,6 @@ void BathymetrySaverTool::writeDEMFile(void) const
 			elevMax=*bbPtr;
 		}
 	
-	// DEBUGGING
-	std::cout<<elevMin<<", "<<elevMax<<std::endl;
-	
 	elevMin*=gs;
 	elevMax*=gs;
 	printFloat8(demFile,elevMin);
@@ -297,19 +286,19 @@ void BathymetrySaverTool::writeDEMFile(void) const
 	printInt2(demFile,0); // Precisión desconocida
 	
 	/* Escriba las escalas de cuadrícula con total precisión. Por especificación, solo se admiten valores enteros: */
-	printFloat4(demFile,factory->cellSize[0]*gs);
-	printFloat4(demFile,factory->cellSize[1]*gs);
+	printFloat4(demFile,cellSize[0]*gs);
+	printFloat4(demFile,cellSize[1]*gs);
 	printFloat4(demFile,1.0/zScale);
 	
 	/* Escriba el número de filas y columnas en la cuadrícula: */
 	printInt2(demFile,1); // Número de filas especificadas en cada perfil de cuadrícula
-	printInt2(demFile,factory->gridSize[0]); // Número de columnas
+	printInt2(demFile,gridSize[0]); // Número de columnas
 	
 	/* Calcule el tamaño total del archivo escrito hasta el momento: */
 	size_t fileSize=864U;
 	
 	/* Escribe todas las columnas de la cuadrícula: */
-	for(GLsizei column=0;column<factory->gridSize[0];++column)
+	for(GLsizei column=0;column<gridSize[0];++column)
 		{
 		/* Rellene el tamaño del archivo actual a un múltiplo de 1024: */
 		size_t paddedSize=(fileSize+1023U)&~size_t(1023U);
@@ -319,18 +308,18 @@ void BathymetrySaverTool::writeDEMFile(void) const
 		/* Escribe el encabezado del perfil: */
 		printInt2(demFile,1); // Índice de fila inicial basado en 1 de este perfil
 		printInt2(demFile,column+1); // Índice de columna basado en 1 de este perfil
-		printInt2(demFile,factory->gridSize[1]); // Número de filas en el perfil
+		printInt2(demFile,gridSize[1]); // Número de filas en el perfil
 		printInt2(demFile,1); // Número de columnas en el perfil.
-		printFloat8(demFile,west+double(column)*double(factory->cellSize[0])*gs); // Este de la primera publicación de elevación en la columna
+		printFloat8(demFile,west+double(column)*double(cellSize[0])*gs); // Este de la primera publicación de elevación en la columna
 		printFloat8(demFile,south); // Norte de la primera elevación en la columna.
 		printFloat8(demFile,elevationBase); // Elevación local del dato
 		
 		/* Calcule y escriba el rango de elevación del perfil: */
-		const GLfloat* pPtr=bathymetryBuffer+column;
+		const GLfloat* pPtr=bathymetry+column;
 		GLfloat elevMin,elevMax;
 		elevMin=elevMax=*pPtr;
-		pPtr+=factory->gridSize[0];
-		for(GLsizei count=factory->gridSize[1]-1;count>0;--count,pPtr+=factory->gridSize[0])
+		pPtr+=gridSize[0];
+		for(GLsizei count=gridSize[1]-1;count>0;--count,pPtr+=gridSize[0])
 			{
 			if(elevMin>*pPtr)
 				elevMin=*pPtr;
@@ -344,8 +333,8 @@ void BathymetrySaverTool::writeDEMFile(void) const
 		fileSize+=6*4+24*5;
 		
 		/* Cuantizar y escribir las publicaciones de elevación del perfil: */
-		pPtr=bathymetryBuffer+column;
-		for(GLsizei count=factory->gridSize[1];count>0;--count,pPtr+=factory->gridSize[0])
+		pPtr=bathymetry+column;
+		for(GLsizei count=gridSize[1];count>0;--count,pPtr+=gridSize[0])
 			{
 			/* Compruebe si queda suficiente espacio en el registro actual de 1024 caracteres: */
 			size_t paddedSize=(fileSize+1023U)&~size_t(1023U);
@@ -379,207 +368,587 @@ void BathymetrySaverTool::writeDEMFile(void) const
 		demFile<<' ';
 	}
 
-void BathymetrySaverTool::postUpdate(void) const
-	{
-	/* Conéctese al servidor HTTP: */
-	Comm::NetPipePtr pipe=new Comm::TCPPipe(configuration.postUpdateHostName.c_str(),configuration.postUpdatePort);
-	
-	/* Ensamble la solicitud PUT: */
-	std::string request;
-	request.append("PUT");
-	request.push_back(' ');
-	request.push_back('/');
-	request.append(configuration.postUpdatePage.c_str());
-	request.push_back(' ');
-	request.append("HTTP/1.1\r\n");
-	
-	request.append("Host: ");
-	request.append(configuration.postUpdateHostName.c_str());
-	request.push_back(':');
-	char portString[6];
-	request.append(Misc::print(configuration.postUpdatePort,portString+5));
-	request.append("\r\n");
-	
-	request.append("Accept: */*\r\n");
-	
-	request.append("Content-Length: ");
-	char contentLengthString[6];
-	request.append(Misc::print(configuration.postUpdateMessage.size(),contentLengthString+5));
-	request.append("\r\n");
-	
-	request.append("Content-Type: application/x-www-form-urlencoded\r\n");
-	
-	/* Termina el encabezado de solicitud: */
-	request.append("\r\n");
-	
-	/* Ensamble el contenido de la solicitud PUT: */
-	request.append(configuration.postUpdateMessage);
-	
-	/* Envíe la solicitud PUT: */
-	pipe->writeRaw(request.data(),request.size());
-	pipe->flush();
-	
-	/* Analiza el encabezado de respuesta: */
-	bool replyChunked=false;
-	bool replySized=false;
-	size_t replySize=0;
-	{
-	/* Adjunte una fuente de valor al conducto para analizar la respuesta del servidor: */
-	IO::ValueSource reply(pipe);
-	reply.setPunctuation("()<>@,;:\\/[]?={}\r");
-	reply.setQuotes("\"");
-	reply.skipWs();
-	
-	/* Lea la línea de estado: */
-	if(!reply.isLiteral("HTTP")||!reply.isLiteral('/'))
-		Misc::throwStdErr("Not an HTTP reply!");
-	reply.skipString();
-	unsigned int statusCode=reply.readUnsignedInteger();
-	if(statusCode!=200)
-		Misc::throwStdErr("HTTP error %d: %s",statusCode,reply.readLine().c_str());
-	reply.readLine();
-	reply.skipWs();
-	
-	/* Analizar las opciones de respuesta hasta la primera línea vacía: */
-	while(!reply.eof()&&reply.peekc()!='\r')
+void BathymetrySaverToolFactory::postUpdate(const BathymetrySaverToolFactory::Configuration& jobConfiguration)
+	{
+	/* Entregue el mensaje al cliente de actualización, que lo envía en su propio hilo: */
+	HTTPUpdateClient::Request request;
+	request.hostName=jobConfiguration.postUpdateHostName;
+	request.port=jobConfiguration.postUpdatePort;
+	request.page=jobConfiguration.postUpdatePage;
+	request.message=jobConfiguration.postUpdateMessage;
+	request.connectTimeout=jobConfiguration.postUpdateConnectTimeout;
+	request.readTimeout=jobConfiguration.postUpdateReadTimeout;
+	request.maxRetries=jobConfiguration.postUpdateMaxRetries;
+	request.retryDelay=jobConfiguration.postUpdateRetryDelay;
+	updateClient->postUpdate(request);
+	}
+
+void BathymetrySaverToolFactory::calcWaterDepths(const BathymetrySaverToolFactory::SaveJob& job,std::vector<float>& depths) const
+	{
+	/* Calcule la profundidad mojada de cada celda de agua; la batimetría de una celda es el promedio de sus cuatro vértices de esquina, limitados al borde de la cuadrícula: */
+	GLsizei cellsX=gridSize[0]+1;
+	GLsizei cellsY=gridSize[1]+1;
+	std::vector<float> cellDepths(size_t(cellsY)*size_t(cellsX));
+	float* cdPtr=&cellDepths[0];
+	for(GLsizei cy=0;cy<cellsY;++cy)
 		{
-		/* Lea la etiqueta de opción: */
-		std::string option=reply.readString();
-		if(reply.isLiteral(':'))
+		const GLfloat* b0Ptr=job.bathymetry+size_t(cy>0?cy-1:0)*size_t(gridSize[0]);
+		const GLfloat* b1Ptr=job.bathymetry+size_t(cy<gridSize[1]?cy:gridSize[1]-1)*size_t(gridSize[0]);
+		const GLfloat* wPtr=job.waterLevel+size_t(cy)*size_t(cellsX);
+		for(GLsizei cx=0;cx<cellsX;++cx,++cdPtr)
 			{
-			/* Manejar el valor de la opción: */
-			if(option=="Transfer-Encoding")
-				{
-				/* Analice la lista de codificaciones de transferencia separadas por comas: */
-				while(true)
+			GLsizei x0=cx>0?cx-1:0;
+			GLsizei x1=cx<gridSize[0]?cx:gridSize[0]-1;
+			float bathymetry=(b0Ptr[x0]+b0Ptr[x1]+b1Ptr[x0]+b1Ptr[x1])*0.25f;
+			*cdPtr=wPtr[cx]>bathymetry?wPtr[cx]-bathymetry:0.0f;
+			}
+		}
+	
+	/* Promedie las profundidades mojadas de las cuatro celdas que comparten cada vértice de batimetría: */
+	depths.resize(size_t(gridSize[1])*size_t(gridSize[0]));
+	float* dPtr=&depths[0];
+	for(GLsizei y=0;y<gridSize[1];++y)
+		{
+		const float* cd0Ptr=&cellDepths[size_t(y)*size_t(cellsX)];
+		const float* cd1Ptr=cd0Ptr+cellsX;
+		for(GLsizei x=0;x<gridSize[0];++x,++dPtr)
+			*dPtr=(cd0Ptr[x]+cd0Ptr[x+1]+cd1Ptr[x]+cd1Ptr[x+1])*0.25f;
+		}
+	}
+
+void BathymetrySaverToolFactory::calcWaterSurface(const BathymetrySaverToolFactory::SaveJob& job,std::vector<float>& surface) const
+	{
+	/* Marque las celdas de agua mojadas, cuyo nivel supera el promedio de sus cuatro vértices de esquina como en calcWaterDepths: */
+	GLsizei cellsX=gridSize[0]+1;
+	GLsizei cellsY=gridSize[1]+1;
+	std::vector<bool> wetCells(size_t(cellsY)*size_t(cellsX));
+	for(GLsizei cy=0;cy<cellsY;++cy)
+		{
+		const GLfloat* b0Ptr=job.bathymetry+size_t(cy>0?cy-1:0)*size_t(gridSize[0]);
+		const GLfloat* b1Ptr=job.bathymetry+size_t(cy<gridSize[1]?cy:gridSize[1]-1)*size_t(gridSize[0]);
+		const GLfloat* wPtr=job.waterLevel+size_t(cy)*size_t(cellsX);
+		for(GLsizei cx=0;cx<cellsX;++cx)
+			{
+			GLsizei x0=cx>0?cx-1:0;
+			GLsizei x1=cx<gridSize[0]?cx:gridSize[0]-1;
+			wetCells[size_t(cy)*size_t(cellsX)+size_t(cx)]=wPtr[cx]>(b0Ptr[x0]+b0Ptr[x1]+b1Ptr[x0]+b1Ptr[x1])*0.25f;
+			}
+		}
+	
+	/* Promedie los niveles de agua de las celdas mojadas que comparten cada vértice y limite el resultado a la batimetría del vértice, para que el lago quede plano y las orillas no se hundan: */
+	surface.resize(size_t(gridSize[1])*size_t(gridSize[0]));
+	float* sPtr=&surface[0];
+	for(GLsizei y=0;y<gridSize[1];++y)
+		{
+		const GLfloat* bPtr=job.bathymetry+size_t(y)*size_t(gridSize[0]);
+		for(GLsizei x=0;x<gridSize[0];++x,++sPtr)
+			{
+			float levelSum=0.0f;
+			unsigned int numWet=0;
+			for(GLsizei cy=y;cy<=y+1;++cy)
+				for(GLsizei cx=x;cx<=x+1;++cx)
 					{
-					std::string coding=reply.readString();
-					if(coding=="chunked")
-						replyChunked=true;
-					else
+					size_t cellIndex=size_t(cy)*size_t(cellsX)+size_t(cx);
+					if(wetCells[cellIndex])
 						{
-						/* Saltar la extensión de transferencia: */
-						while(reply.isLiteral(';'))
-							{
-							reply.skipString();
-							if(!reply.isLiteral('='))
-								Misc::throwStdErr("Malformed HTTP reply header");
-							reply.skipString();
-							}
+						levelSum+=job.waterLevel[cellIndex];
+						++numWet;
 						}
-					if(reply.eof()||reply.peekc()!=',')
-						break;
-					while(!reply.eof()&&reply.peekc()==',')
-						reply.readChar();
 					}
-				}
-			else if(option=="Content-Length")
-				{
-				replySized=true;
-				replySize=reply.readUnsignedInteger();
-				}
+			float level=numWet>0?levelSum/float(numWet):bPtr[x];
+			*sPtr=level>bPtr[x]?level:bPtr[x];
 			}
-		
-		/* Salta el resto de la línea: */
-		reply.skipLine();
-		reply.skipWs();
 		}
-	
-	/* Lea el par CR / LF: */
-	if(reply.getChar()!='\r'||reply.getChar()!='\n')
-		Misc::throwStdErr("Malformed HTTP reply header");
 	}
+
+unsigned int BathymetrySaverToolFactory::makeSamples(const BathymetrySaverToolFactory::SaveJob& job,std::vector<float>& samples) const
+	{
+	unsigned int numBands=job.waterLevel!=0?2:1;
+	float gs=float(job.configuration.gridScale);
+	samples.resize(size_t(gridSize[1])*size_t(gridSize[0])*numBands);
+	
+	/* Calcule la profundidad del agua en los vértices de batimetría: */
+	std::vector<float> depths;
+	if(job.waterLevel!=0)
+		calcWaterDepths(job,depths);
 	
-	/* Imprima la entidad de respuesta: */
-	if(replyChunked)
+	/* Copie las filas de norte a sur, ya que la cuadrícula de batimetría empieza en el sur: */
+	float* sPtr=&samples[0];
+	for(GLsizei row=gridSize[1]-1;row>=0;--row)
 		{
-		// std::cout<<"Chunked reply body!"<<std::endl<<std::endl;
-		
-		/* Lea todos los fragmentos hasta el fragmento final: */
-		while(true)
+		const GLfloat* bPtr=job.bathymetry+size_t(row)*size_t(gridSize[0]);
+		if(job.waterLevel!=0)
 			{
-			/* Lea el siguiente tamaño de trozo: */
-			size_t chunkSize=0;
-			int digit;
-			while(true)
+			const float* dPtr=&depths[size_t(row)*size_t(gridSize[0])];
+			for(GLsizei x=0;x<gridSize[0];++x,sPtr+=2)
 				{
-				digit=pipe->getChar();
-				if(digit>='0'&&digit<='9')
-					chunkSize=(chunkSize<<4)+(digit-'0');
-				else if(digit>='a'&&digit<='f')
-					chunkSize=(chunkSize<<4)+(digit-'a'+10);
-				else if(digit>='A'&&digit<='F')
-					chunkSize=(chunkSize<<4)+(digit-'A'+10);
-				else
-					break;
+				sPtr[0]=bPtr[x]*gs;
+				sPtr[1]=dPtr[x]*gs;
 				}
-			while(digit!='\r')
-				digit=pipe->getChar();
-			if(pipe->getChar()!='\n')
-				Misc::throwStdErr("Malformed HTTP chunk header");
-			
-			if(chunkSize==0)
-				break;
-			
-			/* Lee el trozo: */
-			char buffer[256];
-			while(chunkSize>0)
-				{
-				size_t readSize=chunkSize;
-				if(readSize>sizeof(buffer))
-					readSize=sizeof(buffer);
-				pipe->read(buffer,readSize);
-				// buffer[readSize]='\0';
-				// std::cout<<buffer;
-				chunkSize-=readSize;
-				}
-			
-			/* Lea el pie de página del fragmento: */
-			if(pipe->getChar()!='\r'||pipe->getChar()!='\n')
-				Misc::throwStdErr("Malformed HTTP chunk footer");
 			}
-		
-		/* Saltar el remolque del cuerpo: */
-		while(pipe->getChar()!='\r')
+		else
 			{
-			/* Saltarse la línea: */
-			while(pipe->getChar()!='\r')
-				;
-			if(pipe->getChar()!='\n')
-				Misc::throwStdErr("Malformed HTTP body trailer");
+			for(GLsizei x=0;x<gridSize[0];++x,++sPtr)
+				*sPtr=bPtr[x]*gs;
 			}
-		if(pipe->getChar()!='\n')
-			Misc::throwStdErr("Malformed HTTP body trailer");
 		}
-	else if(replySized)
+	
+	return numBands;
+	}
+
+void BathymetrySaverToolFactory::writeRawFile(const BathymetrySaverToolFactory::SaveJob& job) const
+	{
+	std::vector<float> samples;
+	unsigned int numBands=makeSamples(job,samples);
+	
+	/* Abra el archivo de salida en orden little-endian: */
+	IO::FilePtr file=IO::openFile(job.configuration.saveFileName.c_str(),IO::File::WriteOnly);
+	file->setEndianness(Misc::LittleEndian);
+	
+	/* Calcule la georreferencia de la primera muestra con la misma ubicación que los archivos DEM: */
+	double gs=job.configuration.gridScale;
+	double west=demGridCenter[0]-double(gridSize[0]-1)*double(cellSize[0])*gs*0.5;
+	double north=demGridCenter[1]+double(gridSize[1]-1)*double(cellSize[1])*gs*0.5;
+	
+	/* Escribe el encabezado: identificador, versión, tamaño de la cuadrícula, número de bandas, tamaño de celda y esquina noroeste: */
+	file->write<char>("SARBATHY",8);
+	file->write<Misc::UInt32>(1);
+	file->write<Misc::UInt32>(gridSize[0]);
+	file->write<Misc::UInt32>(gridSize[1]);
+	file->write<Misc::UInt32>(numBands);
+	for(int i=0;i<2;++i)
+		file->write<Misc::Float64>(double(cellSize[i])*gs);
+	file->write<Misc::Float64>(west);
+	file->write<Misc::Float64>(north);
+	
+	/* Escribe las muestras intercaladas por píxel, con filas de norte a sur: */
+	file->write<Misc::Float32>(&samples[0],samples.size());
+	}
+
+void BathymetrySaverToolFactory::writeNpyFile(const BathymetrySaverToolFactory::SaveJob& job) const
+	{
+	std::vector<float> samples;
+	unsigned int numBands=makeSamples(job,samples);
+	
+	/* Ensamble el diccionario del encabezado de NumPy: */
+	char shape[64];
+	if(numBands>1)
+		snprintf(shape,sizeof(shape),"(%d, %d, %u)",int(gridSize[1]),int(gridSize[0]),numBands);
+	else
+		snprintf(shape,sizeof(shape),"(%d, %d)",int(gridSize[1]),int(gridSize[0]));
+	std::string header="{'descr': '<f4', 'fortran_order': False, 'shape': ";
+	header.append(shape);
+	header.append(", }");
+	
+	/* Rellene el encabezado con espacios para que los datos empiecen en un múltiplo de 64 bytes: */
+	size_t totalSize=10+header.size()+1;
+	header.append((64-totalSize%64)%64,' ');
+	header.push_back('\n');
+	
+	/* Escribe el archivo: */
+	IO::FilePtr file=IO::openFile(job.configuration.saveFileName.c_str(),IO::File::WriteOnly);
+	file->setEndianness(Misc::LittleEndian);
+	file->write<char>("\x93NUMPY\x01\x00",8);
+	file->write<Misc::UInt16>(Misc::UInt16(header.size()));
+	file->write<char>(header.data(),header.size());
+	file->write<Misc::Float32>(&samples[0],samples.size());
+	}
+
+void BathymetrySaverToolFactory::writeGeoTIFFFile(const BathymetrySaverToolFactory::SaveJob& job) const
+	{
+	std::vector<float> samples;
+	unsigned int numBands=makeSamples(job,samples);
+	double gs=job.configuration.gridScale;
+	
+	/* Divida la imagen en tiras y comprímalas si se solicita: */
+	Misc::UInt32 rowsPerStrip=job.configuration.compressGeoTIFF?32:Misc::UInt32(gridSize[1]);
+	Misc::UInt32 numStrips=(Misc::UInt32(gridSize[1])+rowsPerStrip-1)/rowsPerStrip;
+	size_t rowSize=size_t(gridSize[0])*numBands*sizeof(float);
+	std::vector<std::vector<Bytef> > strips;
+	std::vector<Misc::UInt32> stripByteCounts(numStrips);
+	if(job.configuration.compressGeoTIFF)
 		{
-		/* Lea el tamaño de respuesta fijo: */
-		char buffer[256];
-		while(replySize>0)
+		strips.resize(numStrips);
+		for(Misc::UInt32 strip=0;strip<numStrips;++strip)
 			{
-			size_t readSize=replySize;
-			if(readSize>sizeof(buffer))
-				readSize=sizeof(buffer);
-			pipe->read(buffer,readSize);
-			// buffer[readSize]='\0';
-			// std::cout<<buffer;
-			replySize-=readSize;
+			Misc::UInt32 numRows=strip<numStrips-1?rowsPerStrip:Misc::UInt32(gridSize[1])-strip*rowsPerStrip;
+			const Bytef* src=reinterpret_cast<const Bytef*>(&samples[0])+size_t(strip)*rowsPerStrip*rowSize;
+			uLongf compressedSize=compressBound(uLong(numRows*rowSize));
+			strips[strip].resize(compressedSize);
+			if(compress2(&strips[strip][0],&compressedSize,src,uLong(numRows*rowSize),6)!=Z_OK)
+				Misc::throwStdErr("BathymetrySaverTool: Unable to compress GeoTIFF strip");
+			strips[strip].resize(compressedSize);
+			stripByteCounts[strip]=Misc::UInt32(compressedSize);
 			}
 		}
 	else
+		stripByteCounts[0]=Misc::UInt32(samples.size()*sizeof(float));
+	
+	/* Calcule la georreferencia de la primera muestra con la misma ubicación que los archivos DEM: */
+	double west=demGridCenter[0]-double(gridSize[0]-1)*double(cellSize[0])*gs*0.5;
+	double north=demGridCenter[1]+double(gridSize[1]-1)*double(cellSize[1])*gs*0.5;
+	
+	/* Calcule la disposición del archivo: encabezado, directorio, datos fuera de línea y tiras: */
+	const Misc::UInt16 numEntries=numBands>1?15:14;
+	Misc::UInt32 offset=8+2+Misc::UInt32(numEntries)*12+4;
+	Misc::UInt32 stripOffsetsOffset=offset;
+	if(numStrips>1)
+		offset+=numStrips*4;
+	Misc::UInt32 stripByteCountsOffset=offset;
+	if(numStrips>1)
+		offset+=numStrips*4;
+	Misc::UInt32 pixelScaleOffset=offset;
+	offset+=3*8;
+	Misc::UInt32 tiepointOffset=offset;
+	offset+=6*8;
+	Misc::UInt32 geoKeysOffset=offset;
+	offset+=16*2;
+	std::vector<Misc::UInt32> stripOffsets(numStrips);
+	for(Misc::UInt32 strip=0;strip<numStrips;++strip)
+		{
+		stripOffsets[strip]=offset;
+		offset+=stripByteCounts[strip];
+		}
+	
+	/* Escribe el encabezado TIFF little-endian: */
+	IO::FilePtr file=IO::openFile(job.configuration.saveFileName.c_str(),IO::File::WriteOnly);
+	file->setEndianness(Misc::LittleEndian);
+	file->write<char>("II",2);
+	file->write<Misc::UInt16>(42);
+	file->write<Misc::UInt32>(8);
+	
+	/* Escribe el directorio de la imagen en orden ascendente de etiquetas: */
+	Misc::UInt32 perSample=numBands>1?0x00010001U:1U; // Dos valores cortos en línea, o uno
+	file->write<Misc::UInt16>(numEntries);
+	writeTiffEntry(*file,256,4,1,Misc::UInt32(gridSize[0])); // ImageWidth
+	writeTiffEntry(*file,257,4,1,Misc::UInt32(gridSize[1])); // ImageLength
+	writeTiffEntry(*file,258,3,numBands,perSample*32U); // BitsPerSample
+	writeTiffEntry(*file,259,3,1,job.configuration.compressGeoTIFF?8:1); // Compression: deflate o ninguna
+	writeTiffEntry(*file,262,3,1,1); // PhotometricInterpretation: negro es cero
+	writeTiffEntry(*file,273,4,numStrips,numStrips>1?stripOffsetsOffset:stripOffsets[0]); // StripOffsets
+	writeTiffEntry(*file,277,3,1,numBands); // SamplesPerPixel
+	writeTiffEntry(*file,278,4,1,rowsPerStrip); // RowsPerStrip
+	writeTiffEntry(*file,279,4,numStrips,numStrips>1?stripByteCountsOffset:stripByteCounts[0]); // StripByteCounts
+	writeTiffEntry(*file,284,3,1,1); // PlanarConfiguration: intercalada por píxel
+	if(numBands>1)
+		writeTiffEntry(*file,338,3,1,0); // ExtraSamples: banda de profundidad del agua sin especificar
+	writeTiffEntry(*file,339,3,numBands,perSample*3U); // SampleFormat: punto flotante IEEE
+	writeTiffEntry(*file,33550,12,3,pixelScaleOffset); // ModelPixelScaleTag
+	writeTiffEntry(*file,33922,12,6,tiepointOffset); // ModelTiepointTag
+	writeTiffEntry(*file,34735,3,16,geoKeysOffset); // GeoKeyDirectoryTag
+	file->write<Misc::UInt32>(0); // No hay más directorios
+	
+	/* Escribe los datos fuera de línea: */
+	if(numStrips>1)
+		{
+		file->write<Misc::UInt32>(&stripOffsets[0],numStrips);
+		file->write<Misc::UInt32>(&stripByteCounts[0],numStrips);
+		}
+	Misc::Float64 pixelScale[3]={double(cellSize[0])*gs,double(cellSize[1])*gs,0.0};
+	file->write<Misc::Float64>(pixelScale,3);
+	Misc::Float64 tiepoint[6]={0.0,0.0,0.0,west,north,0.0};
+	file->write<Misc::Float64>(tiepoint,6);
+	
+	/* Escribe las claves GeoTIFF: modelo proyectado, ráster de punto y WGS 84 / UTM zona 10N: */
+	Misc::UInt16 geoKeys[16]={1,1,0,3, 1024,0,1,1, 1025,0,1,2, 3072,0,1,32610};
+	file->write<Misc::UInt16>(geoKeys,16);
+	
+	/* Escribe las tiras: */
+	if(job.configuration.compressGeoTIFF)
+		{
+		for(Misc::UInt32 strip=0;strip<numStrips;++strip)
+			file->write<Bytef>(&strips[strip][0],strips[strip].size());
+		}
+	else
+		file->write<Misc::Float32>(&samples[0],samples.size());
+	}
+
+void BathymetrySaverToolFactory::writeMeshFile(const BathymetrySaverToolFactory::SaveJob& job) const
+	{
+	/* Ensamble la superficie superior con filas de sur a norte; donde hay agua, la superficie es el nivel del agua: */
+	std::vector<float> surface;
+	if(job.waterLevel!=0)
+		calcWaterSurface(job,surface);
+	else
+		surface.assign(job.bathymetry,job.bathymetry+size_t(gridSize[1])*size_t(gridSize[0]));
+	
+	/* Escale la superficie a las unidades de exportación: */
+	float gs=float(job.configuration.gridScale);
+	for(std::vector<float>::iterator sIt=surface.begin();sIt!=surface.end();++sIt)
+		*sIt*=gs;
+	
+	/* Diezme la superficie en una malla cerrada con base sólida y escríbala: */
+	unsigned int meshGridSize[2];
+	float meshCellSize[2];
+	for(int i=0;i<2;++i)
+		{
+		meshGridSize[i]=(unsigned int)(gridSize[i]);
+		meshCellSize[i]=cellSize[i]*gs;
+		}
+	TerrainMesh mesh(&surface[0],meshGridSize,meshCellSize,float(job.configuration.meshBaseThickness)*gs,job.configuration.meshMaxTriangles,job.configuration.meshNumThreads);
+	if(job.configuration.saveFormat==STL_FORMAT)
+		mesh.writeSTL(job.configuration.saveFileName.c_str());
+	else
+		mesh.writeOBJ(job.configuration.saveFileName.c_str());
+	}
+
+void* BathymetrySaverToolFactory::writerThreadMethod(void)
+	{
+	while(true)
+		{
+		/* Espere hasta que haya un trabajo pendiente o el programa se apague con la cola vacía: */
+		SaveJob job;
 		{
-		/* Lea hasta el final del archivo:: */
-		char buffer[256];
-		while(!pipe->eof())
+		Threads::MutexCond::Lock jobLock(jobCond);
+		while(runWriterThread&&jobs.empty())
+			jobCond.wait(jobLock);
+		if(jobs.empty())
+			break;
+		job=jobs.front();
+		jobs.pop_front();
+		jobActive=true;
+		}
+		
+		/* Exporte la cuadrícula de batimetría fuera del hilo principal y ponga en cola la actualización: */
+		SaveResult result;
+		result.saveFileName=job.configuration.saveFileName;
+		Realtime::TimePointMonotonic saveTimer;
+		try
+			{
+			switch(job.configuration.saveFormat)
+				{
+				case DEM_FORMAT:
+					writeDEMFile(job.bathymetry,job.configuration);
+					break;
+				
+				case RAW_FORMAT:
+					writeRawFile(job);
+					break;
+				
+				case NPY_FORMAT:
+					writeNpyFile(job);
+					break;
+				
+				case GEOTIFF_FORMAT:
+					writeGeoTIFFFile(job);
+					break;
+				
+				case STL_FORMAT:
+				case OBJ_FORMAT:
+					writeMeshFile(job);
+					break;
+				}
+			if(job.configuration.postUpdate)
+				postUpdate(job.configuration);
+			}
+		catch(const std::runtime_error& err)
 			{
-			pipe->readUpTo(buffer,sizeof(buffer));
-			// buffer[bufSize]='\0';
-			// std::cout<<buffer;
+			result.error=err.what();
 			}
+		result.time=double(saveTimer.setAndDiff());
+		
+		/* Devuelva el búfer y guarde el resultado para el hilo principal: */
+		{
+		Threads::MutexCond::Lock jobLock(jobCond);
+		freeBuffers.push_back(job.bathymetry);
+		if(job.waterLevel!=0)
+			freeWaterBuffers.push_back(job.waterLevel);
+		results.push_back(result);
+		jobActive=false;
+		}
+		}
+	
+	return 0;
+	}
+
+GLfloat* BathymetrySaverToolFactory::getBuffer(void)
+	{
+	{
+	Threads::MutexCond::Lock jobLock(jobCond);
+	
+	/* Reutilice un búfer devuelto por el hilo de E/S si hay uno: */
+	if(!freeBuffers.empty())
+		{
+		GLfloat* result=freeBuffers.back();
+		freeBuffers.pop_back();
+		return result;
 		}
-	// std::cout<<std::endl;
+	}
+	
+	return new GLfloat[gridSize[1]*gridSize[0]];
 	}
 
+GLfloat* BathymetrySaverToolFactory::getWaterBuffer(void)
+	{
+	{
+	Threads::MutexCond::Lock jobLock(jobCond);
+	
+	/* Reutilice un búfer devuelto por el hilo de E/S si hay uno: */
+	if(!freeWaterBuffers.empty())
+		{
+		GLfloat* result=freeWaterBuffers.back();
+		freeWaterBuffers.pop_back();
+		return result;
+		}
+	}
+	
+	/* La cuadrícula de nivel de agua está centrada en celdas y es una celda más grande que la cuadrícula de batimetría: */
+	return new GLfloat[(gridSize[1]+1)*(gridSize[0]+1)];
+	}
+
+bool BathymetrySaverToolFactory::canQueueJob(size_t& queueDepth)
+	{
+	Threads::MutexCond::Lock jobLock(jobCond);
+	queueDepth=jobs.size()+(jobActive?1:0);
+	return !isQueueFull();
+	}
+
+bool BathymetrySaverToolFactory::queueJob(GLfloat* bathymetry,GLfloat* waterLevel,const BathymetrySaverToolFactory::Configuration& jobConfiguration,size_t& queueDepth)
+	{
+	Threads::MutexCond::Lock jobLock(jobCond);
+	
+	/* Rechace el trabajo si la cola está llena, para no bloquear nunca el hilo principal: */
+	if(isQueueFull())
+		{
+		queueDepth=jobs.size()+(jobActive?1:0);
+		return false;
+		}
+	
+	/* Agregue el trabajo a la cola y despierte el hilo de E/S: */
+	SaveJob job;
+	job.bathymetry=bathymetry;
+	job.waterLevel=waterLevel;
+	job.configuration=jobConfiguration;
+	jobs.push_back(job);
+	queueDepth=jobs.size()+(jobActive?1:0);
+	jobCond.signal();
+	
+	return true;
+	}
+
+void BathymetrySaverToolFactory::reportResults(void)
+	{
+	/* Tome los resultados terminados bajo el bloqueo: */
+	std::vector<SaveResult> newResults;
+	size_t queueDepth;
+	{
+	Threads::MutexCond::Lock jobLock(jobCond);
+	newResults.swap(results);
+	queueDepth=jobs.size()+(jobActive?1:0);
+	}
+	
+	/* Informe cada resultado: */
+	for(std::vector<SaveResult>::iterator rIt=newResults.begin();rIt!=newResults.end();++rIt)
+		{
+		if(rIt->error.empty())
+			Misc::formattedUserNote("Save Bathymetry: Saved bathymetry to %s in %.0f ms (%u saves pending)",rIt->saveFileName.c_str(),rIt->time*1000.0,(unsigned int)queueDepth);
+		else
+			Misc::formattedUserError("Save Bathymetry: Unable to save bathymetry due to exception \"%s\"",rIt->error.c_str());
+		}
+	
+	/* Informe los mensajes de actualización terminados: */
+	std::vector<HTTPUpdateClient::Result> updateResults;
+	updateClient->getResults(updateResults);
+	for(std::vector<HTTPUpdateClient::Result>::iterator urIt=updateResults.begin();urIt!=updateResults.end();++urIt)
+		{
+		if(urIt->error.empty())
+			Misc::formattedUserNote("Save Bathymetry: Posted update to %s in %.0f ms (%u attempts, %u updates coalesced)",urIt->url.c_str(),urIt->time*1000.0,urIt->numAttempts,urIt->numCoalesced);
+		else
+			Misc::formattedUserError("Save Bathymetry: Unable to post update to %s after %u attempts due to exception \"%s\"",urIt->url.c_str(),urIt->numAttempts,urIt->error.c_str());
+		}
+	}
+
+
+BathymetrySaverToolFactory::BathymetrySaverToolFactory(WaterTable2* sWaterTable,Vrui::ToolManager& toolManager)
+	:ToolFactory("BathymetrySaverTool",toolManager),
+	 waterTable(sWaterTable),
+	 jobActive(false),
+	 runWriterThread(false),
+	 updateClient(0)
+	{
+	/* Recuperar la cuadrícula de batimetría y tamaños de celda: */
+	for(int i=0;i<2;++i)
+		{
+		gridSize[i]=waterTable->getBathymetrySize(i);
+		cellSize[i]=waterTable->getCellSize()[i];
+		}
+	
+	/* Inicializar diseño de herramienta: */
+	layout.setNumButtons(1);
+	
+	#if 0
+	/* Insertar clase en la jerarquía de clases: */
+	ToolFactory* toolFactory=toolManager.loadClass("Tool");
+	toolFactory->addChildClass(this);
+	addParentClass(toolFactory);
+	#endif
+	
+	/* Cargar ajustes de clase: */
+	Misc::ConfigurationFileSection cfs=toolManager.getToolClassSection(getClassName());
+	configuration.read(cfs);
+	
+	/* Inicie el cliente de actualización y el hilo de E/S, que le entrega los mensajes: */
+	updateClient=new HTTPUpdateClient;
+	runWriterThread=true;
+	writerThread.start(this,&BathymetrySaverToolFactory::writerThreadMethod);
+	
+	/* Establecer el puntero de fábrica de la clase de herramienta: */
+	BathymetrySaverTool::factory=this;
+	}
+
+BathymetrySaverToolFactory::~BathymetrySaverToolFactory(void)
+	{
+	/* Apague el hilo de E/S después de que termine las exportaciones en cola: */
+	{
+	Threads::MutexCond::Lock jobLock(jobCond);
+	runWriterThread=false;
+	jobCond.signal();
+	}
+	writerThread.join();
+	
+	/* Apague el cliente de actualización, descartando los mensajes que aún no se enviaron: */
+	delete updateClient;
+	
+	/* Libere todos los búferes de batimetría: */
+	for(std::vector<GLfloat*>::iterator fbIt=freeBuffers.begin();fbIt!=freeBuffers.end();++fbIt)
+		delete[] *fbIt;
+	for(std::vector<GLfloat*>::iterator fbIt=freeWaterBuffers.begin();fbIt!=freeWaterBuffers.end();++fbIt)
+		delete[] *fbIt;
+	
+	/* Restablecer el puntero de fábrica de la clase de herramienta: */
+	BathymetrySaverTool::factory=0;
+	}
+
+const char* BathymetrySaverToolFactory::getName(void) const
+	{
+	return "Save Bathymetry";
+	}
+
+const char* BathymetrySaverToolFactory::getButtonFunction(int) const
+	{
+	return "Save Bathymetry";
+	}
+
+Vrui::Tool* BathymetrySaverToolFactory::createTool(const Vrui::ToolInputAssignment& inputAssignment) const
+	{
+	return new BathymetrySaverTool(this,inputAssignment);
+	}
+
+void BathymetrySaverToolFactory::destroyTool(Vrui::Tool* tool) const
+	{
+	delete tool;
+	}
+
+/********************************************
+Static elements of class BathymetrySaverTool:
+********************************************/
+
+BathymetrySaverToolFactory* BathymetrySaverTool::factory=0;
+
+/************************************
+Methods of class BathymetrySaverTool:
+************************************/
+
 BathymetrySaverToolFactory* BathymetrySaverTool::initClass(WaterTable2* sWaterTable,Vrui::ToolManager& toolManager)
 	{
 	/* Crea la fábrica de herramientas: */
@@ -590,17 +959,34 @@ BathymetrySaverToolFactory* BathymetrySaverTool::initClass(WaterTable2* sWaterTa
 	return factory;
 	}
 
+void BathymetrySaverTool::releaseWaterTable(void)
+	{
+	if(factory!=0)
+		factory->waterTable=0;
+	}
+
 BathymetrySaverTool::BathymetrySaverTool(const Vrui::ToolFactory* factory,const Vrui::ToolInputAssignment& inputAssignment)
 	:Vrui::Tool(factory,inputAssignment),
 	 configuration(BathymetrySaverTool::factory->configuration),
-	 bathymetryBuffer(new GLfloat[BathymetrySaverTool::factory->gridSize[1]*BathymetrySaverTool::factory->gridSize[0]]),
-	 requestPending(false)
+	 bathymetryBuffer(BathymetrySaverTool::factory->getBuffer()),
+	 waterLevelBuffer(0),
+	 requestPending(false),waterLevelPending(false)
 	{
 	}
 
 BathymetrySaverTool::~BathymetrySaverTool(void)
 	{
+	/* Cancele las lecturas pendientes para que ningún contexto escriba en los búferes después de liberarlos: */
+	if(factory->waterTable!=0)
+		{
+		if(requestPending)
+			factory->waterTable->cancelBathymetryRequest(bathymetryBuffer);
+		if(waterLevelPending)
+			factory->waterTable->cancelWaterLevelRequest(waterLevelBuffer);
+		}
+	
 	delete[] bathymetryBuffer;
+	delete[] waterLevelBuffer;
 	}
 
 void BathymetrySaverTool::configure(const Misc::ConfigurationFileSection& configFileSection)
@@ -622,33 +1008,48 @@ const Vrui::ToolFactory* BathymetrySaverTool::getFactory(void) const
 
 void BathymetrySaverTool::buttonCallback(int buttonSlotIndex,Vrui::InputDevice::ButtonCallbackData* cbData)
 	{
-	if(cbData->newButtonState)
+	if(cbData->newButtonState&&!requestPending)
 		{
-		/* Solicite una rejilla de batimetría de la capa freática: */
-		requestPending=factory->waterTable->requestBathymetry(bathymetryBuffer);
+		/* Rechace la solicitud si la cola del hilo de E/S ya está llena: */
+		size_t queueDepth;
+		if(!factory->canQueueJob(queueDepth))
+			Misc::formattedUserWarning("Save Bathymetry: Ignoring request; %u saves are still pending",(unsigned int)queueDepth);
+		else
+			{
+			/* Solicite una rejilla de batimetría de la capa freática: */
+			requestPending=factory->waterTable->requestBathymetry(bathymetryBuffer);
+			
+			/* Solicite también la superficie del agua si el formato de exportación tiene una banda de profundidad del agua: */
+			if(requestPending&&configuration.saveWaterDepth&&configuration.saveFormat!=BathymetrySaverToolFactory::DEM_FORMAT)
+				{
+				if(waterLevelBuffer==0)
+					waterLevelBuffer=factory->getWaterBuffer();
+				waterLevelPending=factory->waterTable->requestWaterLevel(waterLevelBuffer);
+				}
+			}
 		}
 	}
 
 void BathymetrySaverTool::frame(void)
 	{
-	if(requestPending&&factory->waterTable->haveBathymetry())
+	if(requestPending&&factory->waterTable->haveBathymetry()&&(!waterLevelPending||factory->waterTable->haveWaterLevel()))
 		{
-		try
+		/* Entregue las cuadrículas al hilo de E/S y tome búferes nuevos para la siguiente solicitud: */
+		size_t queueDepth;
+		if(factory->queueJob(bathymetryBuffer,waterLevelPending?waterLevelBuffer:0,configuration,queueDepth))
 			{
-			/* Exportar la red de batimetría: */
-			writeDEMFile();
-			
-			if(configuration.postUpdate)
-				{
-				/* Envíe un mensaje de actualización al servidor web configurado: */
-				postUpdate();
-				}
-			}
-		catch(const std::runtime_error& err)
-			{
-			Misc::formattedUserError("Save Bathymetry: Unable to save bathymetry due to exception \"%s\"",err.what());
+			bathymetryBuffer=factory->getBuffer();
+			if(waterLevelPending)
+				waterLevelBuffer=factory->getWaterBuffer();
+			Misc::formattedUserNote("Save Bathymetry: Queued bathymetry for %s (%u saves pending)",configuration.saveFileName.c_str(),(unsigned int)queueDepth);
 			}
+		else
+			Misc::formattedUserWarning("Save Bathymetry: Dropping bathymetry for %s; %u saves are still pending",configuration.saveFileName.c_str(),(unsigned int)queueDepth);
 		
 		requestPending=false;
+		waterLevelPending=false;
 		}
+	
+	/* Informe las exportaciones terminadas por el hilo de E/S: */
+	factory->reportResults();
 	}
@@ -24,6 +24,10 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 #define BATHYMETRYSAVERTOOL_INCLUDED
 
 #include <string>
+#include <vector>
+#include <deque>
+#include <Threads/MutexCond.h>
+#include <Threads/Thread.h>
 #include <GL/gl.h>
 #include <Vrui/Tool.h>
 #include <Vrui/Application.h>
@@ -34,6 +38,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 class WaterTable2;
 class Sandbox;
 class BathymetrySaverTool;
+class HTTPUpdateClient;
 
 class BathymetrySaverToolFactory:public Vrui::ToolFactory
 	{
@@ -41,17 +46,38 @@ class BathymetrySaverToolFactory:public Vrui::ToolFactory
 	
 	/* Clases integradas: */
 	private:
+	enum SaveFormat // Enumerado de los formatos de exportación de la cuadrícula de batimetría
+		{
+		DEM_FORMAT, // USGS DEM de texto de ancho fijo
+		RAW_FORMAT, // Flotantes little-endian con un encabezado pequeño
+		NPY_FORMAT, // Matriz de NumPy
+		GEOTIFF_FORMAT, // GeoTIFF de punto flotante, sin comprimir o con deflate
+		STL_FORMAT, // Malla de triángulos cerrada en STL binario para la impresión 3D
+		OBJ_FORMAT // Malla de triángulos cerrada en OBJ de Wavefront
+		};
+	
 	struct Configuration // Estructura que contiene configuraciones de herramientas
 		{
 		/* Elementos: */
 		public:
 		std::string saveFileName; // Nombre del archivo en el que guardar la cuadrícula de batimetría
+		SaveFormat saveFormat; // Formato del archivo de exportación
+		bool saveWaterDepth; // Marque si los formatos binarios incluyen la profundidad del agua como segunda banda, o si las mallas incluyen la superficie del agua
+		bool compressGeoTIFF; // Marque si los archivos GeoTIFF se comprimen con deflate
 		bool postUpdate; // Marque si desea publicar un mensaje de actualización en un servidor web después de guardar la cuadrícula de batimetría
 		std::string postUpdateHostName; // Nombre del servidor web al que enviar mensajes de actualización
 		int postUpdatePort; // Número de puerto TCP del servidor web al que enviar mensajes de actualización
 		std::string postUpdatePage; // Nombre de la página en el servidor web en la que se publican los mensajes de actualización
 		std::string postUpdateMessage; // El mensaje a enviar al servidor web
+		double postUpdateConnectTimeout; // Tiempo máximo en segundos para conectarse al servidor web
+		double postUpdateReadTimeout; // Tiempo máximo en segundos de inactividad al enviar el mensaje o leer la respuesta
+		unsigned int postUpdateMaxRetries; // Número máximo de reintentos tras un error temporal del servidor web
+		double postUpdateRetryDelay; // Espera en segundos antes del primer reintento; se duplica en cada reintento
+		unsigned int meshMaxTriangles; // Número aproximado de triángulos de las mallas exportadas, incluidas las paredes y la base
+		double meshBaseThickness; // Grosor de la base sólida de las mallas debajo del punto más bajo de la superficie
+		unsigned int meshNumThreads; // Número de hilos usados para diezmar las mallas
 		double gridScale; // Factor de escala general para aplicar a las redes en la exportación
+		unsigned int maxQueuedSaves; // Número máximo de exportaciones pendientes en la cola del hilo de E/S
 		
 		/* Constructores y destructores: */
 		Configuration(void); // Crea la configuración predeterminada
@@ -60,6 +86,24 @@ class BathymetrySaverToolFactory:public Vrui::ToolFactory
 		void write(Misc::ConfigurationFileSection& cfs) const; // Escribe la configuración en la sección del archivo de configuración
 		};
 	
+	struct SaveJob // Estructura para una exportación pendiente en la cola del hilo de E/S
+		{
+		/* Elementos: */
+		public:
+		GLfloat* bathymetry; // Cuadrícula de batimetría a exportar; el trabajo es su propietario
+		GLfloat* waterLevel; // Cuadrícula de nivel de agua centrada en celdas a exportar, o NULL; el trabajo es su propietario
+		Configuration configuration; // Configuración de la herramienta que solicitó la exportación
+		};
+	
+	struct SaveResult // Estructura para el resultado de una exportación terminada
+		{
+		/* Elementos: */
+		public:
+		std::string saveFileName; // Nombre del archivo exportado
+		std::string error; // Mensaje de error, o vacío si la exportación tuvo éxito
+		double time; // Tiempo en segundos dedicado a escribir la exportación
+		};
+	
 	/* Elementos: */
 	private:
 	Configuration configuration; // Configuración predeterminada para todas las herramientas.
@@ -67,6 +111,38 @@ class BathymetrySaverToolFactory:public Vrui::ToolFactory
 	GLsizei gridSize[2]; // Ancho y alto de la rejilla de batimetría de la capa freática
 	GLfloat cellSize[2]; // Ancho y alto de cada celda de nivel freático
 	
+	/* Estado del hilo de E/S: */
+	Threads::MutexCond jobCond; // Variable de condición para señalar nuevos trabajos al hilo de E/S
+	std::deque<SaveJob> jobs; // Cola acotada de exportaciones pendientes
+	bool jobActive; // Marcar si el hilo de E/S está procesando una exportación
+	std::vector<GLfloat*> freeBuffers; // Búferes de batimetría devueltos por el hilo de E/S para reutilizarlos
+	std::vector<GLfloat*> freeWaterBuffers; // Búferes de nivel de agua devueltos por el hilo de E/S para reutilizarlos
+	std::vector<SaveResult> results; // Resultados de exportaciones terminadas aún no informados
+	volatile bool runWriterThread; // Marcar para mantener en ejecución el hilo de E/S
+	Threads::Thread writerThread; // El hilo de E/S que formatea y escribe las exportaciones
+	HTTPUpdateClient* updateClient; // Cliente que publica los mensajes de actualización sin bloquear el hilo de E/S
+	
+	/* Métodos privados: */
+	void writeDEMFile(const GLfloat* bathymetry,const Configuration& jobConfiguration) const; // Escribe la cuadrícula de batimetría dada en un archivo en formato USGS DEM
+	void calcWaterDepths(const SaveJob& job,std::vector<float>& depths) const; // Calcula la profundidad del agua en cada vértice de batimetría, con filas de sur a norte, como promedio de las profundidades mojadas de las cuatro celdas de agua adyacentes
+	void calcWaterSurface(const SaveJob& job,std::vector<float>& surface) const; // Calcula la superficie superior en cada vértice de batimetría, con filas de sur a norte, como el promedio de los niveles de agua de las celdas mojadas adyacentes, nunca por debajo de la batimetría
+	unsigned int makeSamples(const SaveJob& job,std::vector<float>& samples) const; // Convierte las cuadrículas de un trabajo en muestras escaladas intercaladas por píxel, con filas de norte a sur; devuelve el número de bandas
+	void writeRawFile(const SaveJob& job) const; // Escribe las cuadrículas de un trabajo como flotantes little-endian con un encabezado pequeño
+	void writeNpyFile(const SaveJob& job) const; // Escribe las cuadrículas de un trabajo como matriz de NumPy
+	void writeGeoTIFFFile(const SaveJob& job) const; // Escribe las cuadrículas de un trabajo como GeoTIFF de punto flotante
+	void writeMeshFile(const SaveJob& job) const; // Escribe las cuadrículas de un trabajo como malla de triángulos cerrada y diezmada en STL u OBJ
+	void postUpdate(const Configuration& jobConfiguration); // Pone en cola un mensaje de actualización para el servidor web
+	void* writerThreadMethod(void); // Método para el hilo de E/S
+	GLfloat* getBuffer(void); // Devuelve un búfer de batimetría libre, asignando uno nuevo si es necesario
+	GLfloat* getWaterBuffer(void); // Devuelve un búfer de nivel de agua libre, asignando uno nuevo si es necesario
+	bool isQueueFull(void) const // Devuelve verdadero si la cola del hilo de E/S no admite más trabajos; debe llamarse con el mutex de trabajos bloqueado
+		{
+		return jobs.size()>=configuration.maxQueuedSaves;
+		}
+	bool canQueueJob(size_t& queueDepth); // Devuelve verdadero si la cola del hilo de E/S admite otro trabajo y el número de exportaciones en cola o en proceso
+	bool queueJob(GLfloat* bathymetry,GLfloat* waterLevel,const Configuration& jobConfiguration,size_t& queueDepth); // Entrega los búferes de batimetría y nivel de agua al hilo de E/S; devuelve falso y conserva los búferes si la cola está llena
+	void reportResults(void); // Informa los resultados de las exportaciones terminadas desde el hilo principal
+	
 	/* Constructores y destructores: */
 	public:
 	BathymetrySaverToolFactory(WaterTable2* sWaterTable,Vrui::ToolManager& toolManager);
@@ -87,16 +163,15 @@ class BathymetrySaverTool:public Vrui::Tool,public Vrui::Application::Tool<Sandb
 	private:
 	static BathymetrySaverToolFactory* factory; // Puntero al objeto de fábrica para esta clase
 	BathymetrySaverToolFactory::Configuration configuration; // Configuracion de esta herramienta
-	GLfloat* bathymetryBuffer; // Búfer de batimetría
+	GLfloat* bathymetryBuffer; // Búfer de batimetría para la siguiente solicitud; se entrega al hilo de E/S al llegar la cuadrícula
+	GLfloat* waterLevelBuffer; // Búfer de nivel de agua para la siguiente solicitud, o NULL si no se exporta la profundidad del agua
 	bool requestPending; // Marque si esta herramienta tiene una solicitud pendiente para recuperar una cuadrícula de batimetría
-	
-	/* Métodos privados: */
-	void writeDEMFile(void) const; // Escribe la cuadrícula de batimetría en un archivo en formato USGS DEM
-	void postUpdate(void) const; // Envía un mensaje de actualización a un servidor web
+	bool waterLevelPending; // Marque si esta herramienta tiene una solicitud pendiente para recuperar una cuadrícula de nivel de agua
 	
 	/* Constructores y destructores: */
 	public:
 	static BathymetrySaverToolFactory* initClass(WaterTable2* sWaterTable,Vrui::ToolManager& toolManager);
+	static void releaseWaterTable(void); // Desconecta la clase de la mesa de agua antes de que se destruya; las lecturas pendientes ya no pueden completarse
 	BathymetrySaverTool(const Vrui::ToolFactory* factory,const Vrui::ToolInputAssignment& inputAssignment);
 	virtual ~BathymetrySaverTool(void);
 	
@@ -0,0 +1,243 @@
+/***********************************************************************
+ChunkedFile - Contenedor compartido de las grabaciones de lapso de tiempo
+y de marcos de profundidad: fragmentos con marca de tiempo, índice al
+final del archivo y recorrido de los fragmentos si falta el índice.
+Copyright (c) 2026 Sergio081096
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include "ChunkedFile.h"
+
+#include <endian.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <Misc/ThrowStdErr.h>
+#include <Misc/Endianness.h>
+#include <IO/OpenFile.h>
+
+namespace ChunkedFile {
+
+/*************************************
+Methods of class ChunkedFile::Writer:
+*************************************/
+
+Writer::Writer(const char* fileName,const char* sTrailerMagic)
+	:file(IO::openFile(fileName,IO::File::WriteOnly)),
+	 trailerMagic(sTrailerMagic),
+	 fileOffset(0)
+	{
+	file->setEndianness(Misc::LittleEndian);
+	}
+
+void Writer::startChunks(Misc::UInt64 dataOffset)
+	{
+	fileOffset=dataOffset;
+	}
+
+void Writer::writeChunk(Misc::UInt32 tag,Misc::UInt32 flags,double time,unsigned int numBlocks,const std::vector<unsigned char>* const blocks[])
+	{
+	/* Agregue el fragmento al índice: */
+	IndexEntry entry;
+	entry.offset=fileOffset;
+	entry.time=time;
+	entry.flags=flags;
+	index.push_back(entry);
+	
+	/* Escribe el encabezado del fragmento y sus bloques de datos: */
+	file->write<Misc::UInt32>(tag);
+	file->write<Misc::UInt32>(flags);
+	file->write<Misc::Float64>(time);
+	for(unsigned int i=0;i<numBlocks;++i)
+		file->write<Misc::UInt32>(Misc::UInt32(blocks[i]->size()));
+	fileOffset+=getChunkHeaderSize(numBlocks);
+	for(unsigned int i=0;i<numBlocks;++i)
+		if(!blocks[i]->empty())
+			{
+			file->write<unsigned char>(&(*blocks[i])[0],blocks[i]->size());
+			fileOffset+=blocks[i]->size();
+			}
+	}
+
+void Writer::close(void)
+	{
+	/* Escribe el fragmento de índice: */
+	Misc::UInt64 indexOffset=fileOffset;
+	file->write<Misc::UInt32>(indexChunkTag);
+	file->write<Misc::UInt32>(Misc::UInt32(index.size()));
+	for(std::vector<IndexEntry>::const_iterator iIt=index.begin();iIt!=index.end();++iIt)
+		{
+		file->write<Misc::UInt64>(iIt->offset);
+		file->write<Misc::Float64>(iIt->time);
+		file->write<Misc::UInt32>(iIt->flags);
+		}
+	
+	/* Escribe el final del archivo para que los lectores encuentren el índice: */
+	file->write<Misc::UInt64>(indexOffset);
+	file->write<char>(trailerMagic,8);
+	file->flush();
+	}
+
+/*************************************
+Methods of class ChunkedFile::Reader:
+*************************************/
+
+bool Reader::isChunkTag(Misc::UInt32 tag) const
+	{
+	for(std::vector<Misc::UInt32>::const_iterator ctIt=chunkTags.begin();ctIt!=chunkTags.end();++ctIt)
+		if(*ctIt==tag)
+			return true;
+	return false;
+	}
+
+bool Reader::readIndex(size_t dataOffset,const char* trailerMagic)
+	{
+	/* Verifique el final del archivo: */
+	if(mappingSize<dataOffset+trailerSize)
+		return false;
+	const unsigned char* trailer=mapping+(mappingSize-trailerSize);
+	if(memcmp(trailer+sizeof(Misc::UInt64),trailerMagic,8)!=0)
+		return false;
+	
+	/* Verifique el fragmento de índice: */
+	size_t indexOffset=size_t(getValue<Misc::UInt64>(trailer));
+	size_t indexEnd=mappingSize-trailerSize;
+	if(indexOffset<dataOffset||indexOffset+2*sizeof(Misc::UInt32)>indexEnd)
+		return false;
+	const unsigned char* iPtr=mapping+indexOffset;
+	size_t numEntries=getValue<Misc::UInt32>(iPtr+sizeof(Misc::UInt32));
+	if(getValue<Misc::UInt32>(iPtr)!=indexChunkTag||indexOffset+2*sizeof(Misc::UInt32)+numEntries*indexEntrySize!=indexEnd)
+		return false;
+	
+	/* Lea las entradas del índice: */
+	std::vector<IndexEntry> newIndex;
+	newIndex.reserve(numEntries);
+	iPtr+=2*sizeof(Misc::UInt32);
+	size_t chunkHeaderSize=getChunkHeaderSize(numBlocks);
+	for(size_t i=0;i<numEntries;++i,iPtr+=indexEntrySize)
+		{
+		IndexEntry entry;
+		entry.offset=getValue<Misc::UInt64>(iPtr);
+		entry.time=getValue<Misc::Float64>(iPtr+8);
+		entry.flags=getValue<Misc::UInt32>(iPtr+16);
+		if(entry.offset<dataOffset||entry.offset+chunkHeaderSize>indexOffset)
+			return false;
+		newIndex.push_back(entry);
+		}
+	index.swap(newIndex);
+	
+	return true;
+	}
+
+void Reader::scanChunks(size_t dataOffset)
+	{
+	/* Recorra los fragmentos hasta el final del archivo o hasta el primer fragmento incompleto: */
+	index.clear();
+	size_t chunkHeaderSize=getChunkHeaderSize(numBlocks);
+	size_t offset=dataOffset;
+	while(offset+chunkHeaderSize<=mappingSize)
+		{
+		const unsigned char* cPtr=mapping+offset;
+		if(!isChunkTag(getValue<Misc::UInt32>(cPtr)))
+			break;
+		size_t chunkSize=chunkHeaderSize;
+		for(unsigned int i=0;i<numBlocks;++i)
+			chunkSize+=getValue<Misc::UInt32>(cPtr+16+i*sizeof(Misc::UInt32));
+		if(offset+chunkSize>mappingSize)
+			break;
+		
+		IndexEntry entry;
+		entry.offset=offset;
+		entry.time=getValue<Misc::Float64>(cPtr+8);
+		entry.flags=getValue<Misc::UInt32>(cPtr+4);
+		index.push_back(entry);
+		offset+=chunkSize;
+		}
+	}
+
+Reader::Reader(const char* fileName)
+	:fd(-1),mapping(0),mappingSize(0),
+	 numBlocks(0)
+	{
+	#if __BYTE_ORDER!=__LITTLE_ENDIAN
+	Misc::throwStdErr("ChunkedFile::Reader: Recordings require a little-endian host");
+	#endif
+	
+	/* Abra el archivo y mapéelo en memoria: */
+	fd=open(fileName,O_RDONLY);
+	if(fd<0)
+		Misc::throwStdErr("ChunkedFile::Reader: Unable to open file %s due to error %d (%s)",fileName,errno,strerror(errno));
+	struct stat fileStats;
+	if(fstat(fd,&fileStats)<0||fileStats.st_size==0)
+		{
+		close(fd);
+		Misc::throwStdErr("ChunkedFile::Reader: File %s is empty",fileName);
+		}
+	mappingSize=size_t(fileStats.st_size);
+	void* map=mmap(0,mappingSize,PROT_READ,MAP_SHARED,fd,0);
+	if(map==MAP_FAILED)
+		{
+		int error=errno;
+		close(fd);
+		Misc::throwStdErr("ChunkedFile::Reader: Unable to map file %s due to error %d (%s)",fileName,error,strerror(error));
+		}
+	mapping=static_cast<const unsigned char*>(map);
+	}
+
+Reader::~Reader(void)
+	{
+	munmap(const_cast<unsigned char*>(mapping),mappingSize);
+	close(fd);
+	}
+
+bool Reader::loadIndex(size_t dataOffset,const char* trailerMagic,const Misc::UInt32* sChunkTags,unsigned int numChunkTags,unsigned int sNumBlocks)
+	{
+	chunkTags.assign(sChunkTags,sChunkTags+numChunkTags);
+	numBlocks=sNumBlocks;
+	
+	/* Lea el índice, o recórralo si el archivo no se cerró correctamente: */
+	if(readIndex(dataOffset,trailerMagic))
+		return true;
+	scanChunks(dataOffset);
+	return false;
+	}
+
+const unsigned char* Reader::getBlock(unsigned int chunkIndex,unsigned int blockIndex,size_t& blockSize) const
+	{
+	/* Verifique el encabezado del fragmento: */
+	size_t offset=size_t(index[chunkIndex].offset);
+	size_t chunkHeaderSize=getChunkHeaderSize(numBlocks);
+	if(offset+chunkHeaderSize>mappingSize||!isChunkTag(getValue<Misc::UInt32>(mapping+offset)))
+		Misc::throwStdErr("ChunkedFile::Reader: Chunk %u is corrupted",chunkIndex);
+	
+	/* Salte los bloques anteriores y verifique que el bloque cabe en el archivo: */
+	const unsigned char* sizePtr=mapping+offset+16;
+	size_t blockOffset=offset+chunkHeaderSize;
+	for(unsigned int i=0;i<blockIndex;++i)
+		blockOffset+=getValue<Misc::UInt32>(sizePtr+i*sizeof(Misc::UInt32));
+	blockSize=getValue<Misc::UInt32>(sizePtr+blockIndex*sizeof(Misc::UInt32));
+	if(blockOffset+blockSize>mappingSize)
+		Misc::throwStdErr("ChunkedFile::Reader: Chunk %u is truncated",chunkIndex);
+	
+	return mapping+blockOffset;
+	}
+
+}
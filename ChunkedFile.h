@@ -0,0 +1,144 @@
+/***********************************************************************
+ChunkedFile - Contenedor compartido de las grabaciones de lapso de tiempo
+y de marcos de profundidad: fragmentos con marca de tiempo, índice al
+final del archivo y recorrido de los fragmentos si falta el índice.
+Copyright (c) 2026 Sergio081096
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#ifndef CHUNKEDFILE_INCLUDED
+#define CHUNKEDFILE_INCLUDED
+
+#include <stddef.h>
+#include <string.h>
+#include <vector>
+#include <Misc/SizedTypes.h>
+#include <IO/File.h>
+
+/***********************************************************************
+Disposición del contenedor, en orden little-endian:
+- Un encabezado propio del formato, escrito por el llamador.
+- Un fragmento por cuadro o marco: etiqueta, marcas, marca de tiempo,
+  el tamaño de cada bloque de datos del fragmento, y los bloques. El
+  número de bloques por fragmento es fijo para cada formato.
+- Al cerrar: un fragmento de índice "INDX" con la posición, la marca de
+  tiempo y las marcas de cada fragmento, seguido de la posición del
+  índice y el identificador final del formato. Un archivo sin índice,
+  por ejemplo tras un fallo, se lee recorriendo los fragmentos completos.
+***********************************************************************/
+
+namespace ChunkedFile {
+
+static const size_t trailerSize=16; // Tamaño del final del archivo en bytes
+static const size_t indexEntrySize=20; // Tamaño de una entrada del fragmento de índice en bytes
+static const Misc::UInt32 indexChunkTag=0x58444e49U; // Etiqueta del fragmento de índice ("INDX")
+
+struct IndexEntry // Estructura para una entrada del índice del archivo
+	{
+	/* Elementos: */
+	public:
+	Misc::UInt64 offset; // Posición del fragmento en el archivo
+	double time; // Marca de tiempo del fragmento
+	Misc::UInt32 flags; // Marcas del fragmento
+	};
+
+inline size_t getChunkHeaderSize(unsigned int numBlocks) // Devuelve el tamaño del encabezado de un fragmento con el número de bloques dado
+	{
+	return 2*sizeof(Misc::UInt32)+sizeof(Misc::Float64)+size_t(numBlocks)*sizeof(Misc::UInt32);
+	}
+
+template <class ValueParam>
+inline ValueParam getValue(const unsigned char* ptr) // Lee un valor de una posición del mapeo sin requerir alineación
+	{
+	ValueParam result;
+	memcpy(&result,ptr,sizeof(ValueParam));
+	return result;
+	}
+
+class Writer // Clase para escribir fragmentos y cerrar el archivo con su índice
+	{
+	/* Elementos: */
+	private:
+	IO::FilePtr file; // El archivo
+	const char* trailerMagic; // Identificador del final del archivo del formato
+	Misc::UInt64 fileOffset; // Posición de escritura actual en el archivo
+	std::vector<IndexEntry> index; // Índice de todos los fragmentos escritos
+	
+	/* Constructores y destructores: */
+	public:
+	Writer(const char* fileName,const char* sTrailerMagic); // Crea el archivo dado en orden little-endian; el identificador final debe tener 8 caracteres y sobrevivir al escritor
+	
+	/* Métodos: */
+	IO::File& getFile(void) // Devuelve el archivo para escribir el encabezado del formato
+		{
+		return *file;
+		}
+	void startChunks(Misc::UInt64 dataOffset); // Marca el final del encabezado escrito por el llamador, que ocupa los bytes dados
+	size_t getNumChunks(void) const // Devuelve el número de fragmentos escritos
+		{
+		return index.size();
+		}
+	void writeChunk(Misc::UInt32 tag,Misc::UInt32 flags,double time,unsigned int numBlocks,const std::vector<unsigned char>* const blocks[]); // Escribe un fragmento con los bloques de datos dados y lo agrega al índice
+	void close(void); // Escribe el fragmento de índice y el final del archivo
+	};
+
+class Reader // Clase para mapear un archivo en memoria y leer su índice
+	{
+	/* Elementos: */
+	private:
+	int fd; // Descriptor del archivo
+	const unsigned char* mapping; // Mapeo de memoria de solo lectura de todo el archivo
+	size_t mappingSize; // Tamaño del mapeo de memoria en bytes
+	std::vector<Misc::UInt32> chunkTags; // Etiquetas de los fragmentos de datos del formato
+	unsigned int numBlocks; // Número de bloques de datos por fragmento
+	std::vector<IndexEntry> index; // Índice de todos los fragmentos del archivo
+	
+	/* Métodos privados: */
+	bool isChunkTag(Misc::UInt32 tag) const; // Devuelve verdadero si la etiqueta dada es la de un fragmento de datos
+	bool readIndex(size_t dataOffset,const char* trailerMagic); // Lee el índice desde el final del archivo; devuelve falso si el archivo no se cerró correctamente
+	void scanChunks(size_t dataOffset); // Reconstruye el índice recorriendo los fragmentos completos
+	
+	/* Constructores y destructores: */
+	public:
+	Reader(const char* fileName); // Mapea en memoria el archivo dado
+	private:
+	Reader(const Reader& source); // Prohibir copia constructor
+	Reader& operator=(const Reader& source); // Prohibir operador de asignación
+	public:
+	~Reader(void);
+	
+	/* Métodos: */
+	const unsigned char* getData(void) const // Devuelve el mapeo del archivo para leer el encabezado del formato
+		{
+		return mapping;
+		}
+	size_t getSize(void) const // Devuelve el tamaño del archivo en bytes
+		{
+		return mappingSize;
+		}
+	bool loadIndex(size_t dataOffset,const char* trailerMagic,const Misc::UInt32* sChunkTags,unsigned int numChunkTags,unsigned int sNumBlocks); // Lee el índice del final del archivo, o recorre los fragmentos con las etiquetas dadas a partir de la posición dada; devuelve falso si tuvo que recorrer los fragmentos
+	const std::vector<IndexEntry>& getIndex(void) const // Devuelve el índice del archivo
+		{
+		return index;
+		}
+	const unsigned char* getBlock(unsigned int chunkIndex,unsigned int blockIndex,size_t& blockSize) const; // Devuelve el bloque de datos dado del fragmento dado y su tamaño; lanza una excepción si el fragmento está dañado o truncado
+	};
+
+}
+
+#endif
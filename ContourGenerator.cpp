@@ -0,0 +1,656 @@
+/***********************************************************************
+ContourGenerator - Clase para extraer líneas de contorno topográficas
+vectoriales de la superficie de arena mediante marching squares en un
+hilo de fondo, con actualizaciones incrementales por mosaicos, para
+representarlas como geometría de líneas y exportarlas como GeoJSON o
+SVG.
+Copyright (c) 2014-2018 Oliver Kreylos
+Copyright (c) 2026 Sergio081096
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include "ContourGenerator.h"
+
+#include <map>
+#include <utility>
+#include <Math/Math.h>
+#include <IO/File.h>
+#include <IO/OpenFile.h>
+#include <IO/OStream.h>
+#include <GL/gl.h>
+#include <GL/GLVertexArrayParts.h>
+#include <GL/GLContextData.h>
+#include <GL/GLTransformationWrappers.h>
+#include <GL/Extensions/GLARBVertexBufferObject.h>
+
+namespace {
+
+/****************
+Helper functions:
+****************/
+
+const int cornerDx[4]={0,1,1,0}; // Desplazamientos en x de las esquinas de una celda en sentido antihorario
+const int cornerDy[4]={0,0,1,1}; // Desplazamientos en y de las esquinas de una celda en sentido antihorario
+const int edgeCorners[4][2]={{0,1},{1,2},{3,2},{0,3}}; // Esquinas de las aristas inferior, derecha, superior e izquierda en orden canónico de izquierda a derecha y de abajo arriba
+
+struct EdgeLink // Estructura para los segmentos que comparten un extremo en una arista de la cuadrícula
+	{
+	/* Elementos: */
+	public:
+	size_t segments[2]; // Índices de hasta dos segmentos que comparten el extremo
+	unsigned int numSegments; // Número de segmentos válidos
+	
+	/* Constructores y destructores: */
+	EdgeLink(void)
+		:numSegments(0)
+		{
+		}
+	};
+
+}
+
+/*******************************************
+Methods of class ContourGenerator::DataItem:
+*******************************************/
+
+ContourGenerator::DataItem::DataItem(void)
+	:vertexBuffer(0),
+	 numVertices(0),
+	 contoursVersion(0)
+	{
+	/* Verifique e inicialice todas las extensiones OpenGL requeridas: */
+	GLARBVertexBufferObject::initExtension();
+	
+	/* Crea el búfer de vértices: */
+	glGenBuffersARB(1,&vertexBuffer);
+	}
+
+ContourGenerator::DataItem::~DataItem(void)
+	{
+	/* Destruye el búfer de vértices: */
+	glDeleteBuffersARB(1,&vertexBuffer);
+	}
+
+/*********************************
+Methods of class ContourGenerator:
+*********************************/
+
+void ContourGenerator::processElevationTile(unsigned int tileIndex)
+	{
+	/* Calcule el rectángulo del mosaico: */
+	unsigned int x0=(tileIndex%numTiles[0])*tileSize;
+	unsigned int y0=(tileIndex/numTiles[0])*tileSize;
+	unsigned int x1=Math::min(x0+tileSize,size[0]);
+	unsigned int y1=Math::min(y0+tileSize,size[1]);
+	
+	/* Compare las nuevas elevaciones con las usadas para los segmentos actuales: */
+	bool dirty=!haveElevation;
+	for(unsigned int y=y0;y<y1&&!dirty;++y)
+		{
+		const float* fPtr=frameData+(y*size[0]+x0);
+		const float* ePtr=elevation+(y*size[0]+x0);
+		double dy=double(y)+0.5;
+		for(unsigned int x=x0;x<x1;++x,++fPtr,++ePtr)
+			{
+			/* Transforme el píxel del espacio de imagen de profundidad en elevación sobre el plano base: */
+			double dx=double(x)+0.5;
+			double z=double(*fPtr);
+			double e=(basePlaneDicEq[0]*dx+basePlaneDicEq[1]*dy+basePlaneDicEq[2]*z+basePlaneDicEq[3])/(weightDicEq[0]*dx+weightDicEq[1]*dy+weightDicEq[2]*z+weightDicEq[3]);
+			if(Math::abs(float(e)-*ePtr)>=changeThreshold)
+				{
+				dirty=true;
+				break;
+				}
+			}
+		}
+	
+	tileDirty[tileIndex]=dirty;
+	if(dirty)
+		{
+		/* Acepte las nuevas elevaciones y profundidades de todo el mosaico: */
+		for(unsigned int y=y0;y<y1;++y)
+			{
+			const float* fPtr=frameData+(y*size[0]+x0);
+			float* ePtr=elevation+(y*size[0]+x0);
+			float* dPtr=depth+(y*size[0]+x0);
+			double dy=double(y)+0.5;
+			for(unsigned int x=x0;x<x1;++x,++fPtr,++ePtr,++dPtr)
+				{
+				double dx=double(x)+0.5;
+				double z=double(*fPtr);
+				*ePtr=float((basePlaneDicEq[0]*dx+basePlaneDicEq[1]*dy+basePlaneDicEq[2]*z+basePlaneDicEq[3])/(weightDicEq[0]*dx+weightDicEq[1]*dy+weightDicEq[2]*z+weightDicEq[3]));
+				*dPtr=*fPtr;
+				}
+			}
+		}
+	}
+
+void ContourGenerator::processContourTile(unsigned int tileIndex)
+	{
+	/* Calcule el rectángulo de celdas del mosaico; cada celda usa las muestras de sus cuatro esquinas: */
+	unsigned int x0=(tileIndex%numTiles[0])*tileSize;
+	unsigned int y0=(tileIndex/numTiles[0])*tileSize;
+	unsigned int x1=Math::min(x0+tileSize,size[0]-1);
+	unsigned int y1=Math::min(y0+tileSize,size[1]-1);
+	
+	std::vector<Segment>& segments=tileSegments[tileIndex];
+	segments.clear();
+	float invSpacing=1.0f/spacing;
+	for(unsigned int y=y0;y<y1;++y)
+		for(unsigned int x=x0;x<x1;++x)
+			{
+			/* Recoja las elevaciones y profundidades de las esquinas de la celda en sentido antihorario: */
+			unsigned int corners[4];
+			corners[0]=y*size[0]+x;
+			corners[1]=corners[0]+1;
+			corners[3]=corners[0]+size[0];
+			corners[2]=corners[3]+1;
+			float e[4];
+			float eMin=elevation[corners[0]];
+			float eMax=eMin;
+			for(int i=0;i<4;++i)
+				{
+				e[i]=elevation[corners[i]];
+				eMin=Math::min(eMin,e[i]);
+				eMax=Math::max(eMax,e[i]);
+				}
+			
+			/* Identifique las aristas de la celda en la cuadrícula: */
+			unsigned int edges[4];
+			edges[0]=corners[0]*2U;
+			edges[1]=corners[1]*2U+1U;
+			edges[2]=corners[3]*2U;
+			edges[3]=corners[0]*2U+1U;
+			
+			/* Procese todos los niveles de contorno que cruzan la celda: */
+			int kMax=int(Math::floor(eMax*invSpacing));
+			for(int k=int(Math::floor(eMin*invSpacing))+1;k<=kMax;++k)
+				{
+				float level=float(k)*spacing;
+				
+				/* Busque las aristas cuyas esquinas quedan a distintos lados del nivel: */
+				int crossed[4];
+				int numCrossed=0;
+				for(int edge=0;edge<4;++edge)
+					if((e[edgeCorners[edge][0]]>=level)!=(e[edgeCorners[edge][1]]>=level))
+						crossed[numCrossed++]=edge;
+				if(numCrossed<2)
+					continue;
+				
+				/* Calcule los puntos de cruce en orden canónico, para que celdas vecinas produzcan puntos idénticos: */
+				Vertex vertices[4];
+				for(int i=0;i<numCrossed;++i)
+					{
+					int a=edgeCorners[crossed[i]][0];
+					int b=edgeCorners[crossed[i]][1];
+					float t=(level-e[a])/(e[b]-e[a]);
+					vertices[i].position[0]=GLfloat(x)+GLfloat(cornerDx[a])+t*GLfloat(cornerDx[b]-cornerDx[a])+0.5f;
+					vertices[i].position[1]=GLfloat(y)+GLfloat(cornerDy[a])+t*GLfloat(cornerDy[b]-cornerDy[a])+0.5f;
+					vertices[i].position[2]=depth[corners[a]]+t*(depth[corners[b]]-depth[corners[a]]);
+					}
+				
+				/* Empareje los puntos de cruce; las celdas de silla se resuelven con el valor del centro: */
+				int pairs[2][2]={{0,1},{2,3}};
+				int numPairs=1;
+				if(numCrossed==4)
+					{
+					numPairs=2;
+					bool centerAbove=(e[0]+e[1]+e[2]+e[3])*0.25f>=level;
+					if((e[0]>=level)!=centerAbove)
+						{
+						/* Separe las esquinas 0 y 2 con las aristas 3-0 y 1-2: */
+						pairs[0][1]=3;
+						pairs[1][0]=1;
+						pairs[1][1]=2;
+						}
+					}
+				for(int p=0;p<numPairs;++p)
+					{
+					Segment s;
+					s.level=k;
+					for(int i=0;i<2;++i)
+						{
+						s.edges[i]=edges[crossed[pairs[p][i]]];
+						s.vertices[i]=vertices[pairs[p][i]];
+						}
+					segments.push_back(s);
+					}
+				}
+			}
+	}
+
+void ContourGenerator::processTask(unsigned int task)
+	{
+	if(passType==ELEVATION)
+		processElevationTile(tasks[task]);
+	else
+		processContourTile(tasks[task]);
+	}
+
+void ContourGenerator::runPass(ContourGenerator::PassType newPassType)
+	{
+	/* Procese todas las tareas del paso con todos los hilos: */
+	passType=newPassType;
+	taskPool.run(*this,(unsigned int)(tasks.size()));
+	}
+
+void ContourGenerator::processFrame(bool fullUpdate)
+	{
+	/* Convierta el marco en elevaciones y detecte los mosaicos modificados: */
+	unsigned int totalTiles=numTiles[1]*numTiles[0];
+	tasks.clear();
+	for(unsigned int i=0;i<totalTiles;++i)
+		tasks.push_back(i);
+	runPass(ELEVATION);
+	fullUpdate=fullUpdate||!haveElevation;
+	haveElevation=true;
+	
+	/* Vuelva a extraer los mosaicos modificados y los mosaicos a su izquierda y debajo, cuyas celdas del borde dependen de ellos: */
+	tasks.clear();
+	for(unsigned int ty=0;ty<numTiles[1];++ty)
+		for(unsigned int tx=0;tx<numTiles[0];++tx)
+			{
+			bool affected=fullUpdate;
+			for(unsigned int y=ty;y<=ty+1&&y<numTiles[1]&&!affected;++y)
+				for(unsigned int x=tx;x<=tx+1&&x<numTiles[0];++x)
+					affected=affected||tileDirty[y*numTiles[0]+x]!=0;
+			if(affected)
+				tasks.push_back(ty*numTiles[0]+tx);
+			}
+	if(tasks.empty())
+		return;
+	runPass(CONTOURS);
+	
+	/* Publique el nuevo conjunto de líneas de contorno: */
+	Contours& newContours=contours.startNewValue();
+	newContours.segments.clear();
+	for(std::vector<std::vector<Segment> >::iterator tsIt=tileSegments.begin();tsIt!=tileSegments.end();++tsIt)
+		newContours.segments.insert(newContours.segments.end(),tsIt->begin(),tsIt->end());
+	newContours.contourLineSpacing=spacing;
+	contours.postNewValue();
+	}
+
+void* ContourGenerator::contourThreadMethod(void)
+	{
+	unsigned int lastInputFrameVersion=0;
+	while(true)
+		{
+		Kinect::FrameBuffer frame;
+		bool fullUpdate;
+		{
+		Threads::MutexCond::Lock inputLock(inputCond);
+		
+		/* Espere hasta que llegue un nuevo marco o el programa se apague: */
+		while(runContourThread&&lastInputFrameVersion==inputFrameVersion)
+			inputCond.wait(inputLock);
+		
+		/* Salte si el programa se está cerrando: */
+		if(!runContourThread)
+			break;
+		
+		/* Trabaja en el nuevo marco con el espaciado actual: */
+		frame=inputFrame;
+		lastInputFrameVersion=inputFrameVersion;
+		fullUpdate=spacingChanged;
+		spacingChanged=false;
+		spacing=contourLineSpacing;
+		}
+		
+		/* Actualice las líneas de contorno: */
+		frameData=frame.getData<float>();
+		processFrame(fullUpdate);
+		frameData=0;
+		}
+	
+	return 0;
+	}
+
+void ContourGenerator::buildPolylines(std::vector<std::vector<Point> >& polylines,std::vector<double>& elevations,const ContourGenerator::ONTransform& boxTransform,double unitScale) const
+	{
+	const Contours& c=contours.getLockedValue();
+	const std::vector<Segment>& segments=c.segments;
+	
+	/* Indexe los segmentos por los extremos que comparten en cada nivel: */
+	typedef std::map<std::pair<int,unsigned int>,EdgeLink> EdgeMap;
+	EdgeMap edgeMap;
+	for(size_t i=0;i<segments.size();++i)
+		for(int j=0;j<2;++j)
+			{
+			EdgeLink& link=edgeMap[std::make_pair(segments[i].level,segments[i].edges[j])];
+			if(link.numSegments<2)
+				link.segments[link.numSegments++]=i;
+			}
+	
+	/* Encadene los segmentos en polilíneas, en ambas direcciones desde cada segmento sin usar: */
+	std::vector<bool> used(segments.size(),false);
+	std::vector<Vertex> chain;
+	for(size_t start=0;start<segments.size();++start)
+		{
+		if(used[start])
+			continue;
+		used[start]=true;
+		int level=segments[start].level;
+		std::vector<Vertex> forward;
+		std::vector<Vertex> backward;
+		forward.push_back(segments[start].vertices[0]);
+		forward.push_back(segments[start].vertices[1]);
+		bool closed=false;
+		for(int direction=0;direction<2&&!closed;++direction)
+			{
+			/* La mitad hacia atrás no repite el vértice inicial, que ya es el primero de la mitad hacia adelante: */
+			std::vector<Vertex>& half=direction==0?forward:backward;
+			unsigned int edge=segments[start].edges[1-direction];
+			while(true)
+				{
+				/* Busque el segmento sin usar que continúa la cadena en la arista actual: */
+				const EdgeLink& link=edgeMap[std::make_pair(level,edge)];
+				size_t next=segments.size();
+				for(unsigned int i=0;i<link.numSegments;++i)
+					if(!used[link.segments[i]])
+						next=link.segments[i];
+				if(next==segments.size())
+					break;
+				used[next]=true;
+				int end=segments[next].edges[0]==edge?1:0;
+				half.push_back(segments[next].vertices[end]);
+				edge=segments[next].edges[end];
+				}
+			
+			/* Una cadena que vuelve a la arista inicial es un lazo cerrado; ciérrelo con exactamente el vértice inicial una sola vez: */
+			if(direction==0&&edge==segments[start].edges[0]&&forward.size()>2)
+				{
+				forward.back()=forward.front();
+				closed=true;
+				}
+			}
+		
+		/* Transforme la polilínea al espacio de la caja de arena en cm: */
+		chain.assign(backward.rbegin(),backward.rend());
+		chain.insert(chain.end(),forward.begin(),forward.end());
+		polylines.push_back(std::vector<Point>());
+		std::vector<Point>& polyline=polylines.back();
+		for(std::vector<Vertex>::iterator vIt=chain.begin();vIt!=chain.end();++vIt)
+			{
+			Point p=boxTransform.transform(depthProjection.transform(Point(vIt->position[0],vIt->position[1],vIt->position[2])));
+			polyline.push_back(Point(p[0]/unitScale,p[1]/unitScale,p[2]/unitScale));
+			}
+		elevations.push_back(double(level)*double(c.contourLineSpacing)/unitScale);
+		}
+	}
+
+ContourGenerator::ContourGenerator(const unsigned int sSize[2],const PTransform& sDepthProjection,const Plane& basePlane,unsigned int sNumThreads,unsigned int sTileSize)
+	:tileSize(sTileSize),
+	 depthProjection(sDepthProjection),
+	 changeThreshold(0.1f),
+	 lineWidth(1.0f),
+	 frameData(0),
+	 spacing(1.0f),
+	 elevation(0),depth(0),
+	 haveElevation(false),
+	 haveInputFrame(false),
+	 inputFrameVersion(0),
+	 contourLineSpacing(1.0f),
+	 spacingChanged(false),
+	 runContourThread(false),
+	 taskPool(sNumThreads),
+	 passType(ELEVATION),
+	 contoursVersion(0)
+	{
+	/* Dibuje las líneas de contorno en negro por defecto: */
+	for(int i=0;i<3;++i)
+		lineColor[i]=0.0f;
+	lineColor[3]=1.0f;
+	
+	/* Copie el tamaño de la cuadrícula y calcule la disposición de los mosaicos: */
+	for(int i=0;i<2;++i)
+		{
+		size[i]=sSize[i];
+		numTiles[i]=(size[i]+tileSize-1)/tileSize;
+		}
+	tileDirty.resize(numTiles[1]*numTiles[0],0);
+	tileSegments.resize(numTiles[1]*numTiles[0]);
+	
+	/* Transforme el plano base en el espacio de imagen de profundidad, como lo hace el renderizador de imágenes de profundidad: */
+	const PTransform::Matrix& dpm=depthProjection.getMatrix();
+	const Plane::Vector& bpn=basePlane.getNormal();
+	Scalar bpo=basePlane.getOffset();
+	for(int i=0;i<4;++i)
+		{
+		basePlaneDicEq[i]=dpm(0,i)*bpn[0]+dpm(1,i)*bpn[1]+dpm(2,i)*bpn[2]-dpm(3,i)*bpo;
+		weightDicEq[i]=dpm(3,i);
+		}
+	
+	/* Asigne las cuadrículas de cálculo: */
+	unsigned int numCells=size[1]*size[0];
+	elevation=new float[numCells];
+	depth=new float[numCells];
+	
+	/* Inicialice los buffers de salida: */
+	for(int i=0;i<3;++i)
+		contours.getBuffer(i).contourLineSpacing=contourLineSpacing;
+	
+	/* Inicie el hilo de cálculo: */
+	runContourThread=true;
+	contourThread.start(this,&ContourGenerator::contourThreadMethod);
+	}
+
+ContourGenerator::~ContourGenerator(void)
+	{
+	/* Apague el hilo de cálculo antes de que se destruya el conjunto de hilos de trabajo: */
+	{
+	Threads::MutexCond::Lock inputLock(inputCond);
+	runContourThread=false;
+	inputCond.signal();
+	}
+	contourThread.join();
+	
+	delete[] elevation;
+	delete[] depth;
+	}
+
+void ContourGenerator::initContext(GLContextData& contextData) const
+	{
+	/* Crea y registra un elemento de datos; el búfer de vértices se carga al dibujar: */
+	DataItem* dataItem=new DataItem;
+	contextData.addDataItem(this,dataItem);
+	}
+
+void ContourGenerator::setChangeThreshold(float newChangeThreshold)
+	{
+	changeThreshold=newChangeThreshold;
+	}
+
+void ContourGenerator::setContourLineSpacing(float newContourLineSpacing)
+	{
+	Threads::MutexCond::Lock inputLock(inputCond);
+	
+	/* Establezca el nuevo espaciado y vuelva a procesar el último marco recibido con él: */
+	if(contourLineSpacing!=newContourLineSpacing&&newContourLineSpacing>0.0f)
+		{
+		contourLineSpacing=newContourLineSpacing;
+		spacingChanged=true;
+		if(haveInputFrame)
+			{
+			++inputFrameVersion;
+			inputCond.signal();
+			}
+		}
+	}
+
+void ContourGenerator::setLineStyle(const GLfloat newLineColor[4],GLfloat newLineWidth)
+	{
+	for(int i=0;i<4;++i)
+		lineColor[i]=newLineColor[i];
+	lineWidth=newLineWidth;
+	}
+
+void ContourGenerator::receiveFilteredFrame(const Kinect::FrameBuffer& newFrame)
+	{
+	Threads::MutexCond::Lock inputLock(inputCond);
+	
+	/* Almacene el nuevo búfer en el búfer de entrada: */
+	inputFrame=newFrame;
+	haveInputFrame=true;
+	++inputFrameVersion;
+	
+	/* Señale el hilo de fondo: */
+	inputCond.signal();
+	}
+
+bool ContourGenerator::lockNewContours(void)
+	{
+	/* Bloquee las líneas de contorno más recientes e invalide los búferes de vértices si son nuevas: */
+	bool result=contours.lockNewValue();
+	if(result)
+		++contoursVersion;
+	return result;
+	}
+
+void ContourGenerator::glRenderAction(const PTransform& projectionModelview,GLContextData& contextData) const
+	{
+	/* Obtener el elemento de datos de contexto: */
+	DataItem* dataItem=contextData.retrieveDataItem<DataItem>(this);
+	
+	/* Vincula el búfer de vértices: */
+	glBindBufferARB(GL_ARRAY_BUFFER_ARB,dataItem->vertexBuffer);
+	
+	/* Compruebe si el búfer de vértices está desactualizado: */
+	if(dataItem->contoursVersion!=contoursVersion)
+		{
+		/* Cargue los extremos de todos los segmentos bloqueados: */
+		const std::vector<Segment>& segments=contours.getLockedValue().segments;
+		dataItem->numVertices=GLsizei(segments.size()*2);
+		glBufferDataARB(GL_ARRAY_BUFFER_ARB,dataItem->numVertices*sizeof(Vertex),0,GL_DYNAMIC_DRAW_ARB);
+		if(dataItem->numVertices>0)
+			{
+			Vertex* vPtr=static_cast<Vertex*>(glMapBufferARB(GL_ARRAY_BUFFER_ARB,GL_WRITE_ONLY_ARB));
+			for(std::vector<Segment>::const_iterator sIt=segments.begin();sIt!=segments.end();++sIt)
+				{
+				*(vPtr++)=sIt->vertices[0];
+				*(vPtr++)=sIt->vertices[1];
+				}
+			glUnmapBufferARB(GL_ARRAY_BUFFER_ARB);
+			}
+		dataItem->contoursVersion=contoursVersion;
+		}
+	
+	if(dataItem->numVertices>0)
+		{
+		/* Configure el estado de OpenGL; el rango de profundidad acortado evita que la superficie tape las líneas: */
+		glPushAttrib(GL_CURRENT_BIT|GL_DEPTH_BUFFER_BIT|GL_ENABLE_BIT|GL_LINE_BIT|GL_VIEWPORT_BIT);
+		glDisable(GL_LIGHTING);
+		glDisable(GL_TEXTURE_2D);
+		glDepthFunc(GL_LEQUAL);
+		glDepthRange(0.0,0.9995);
+		glLineWidth(lineWidth);
+		glColor4fv(lineColor);
+		
+		/* Dibuje los segmentos directamente desde el espacio de imagen de profundidad: */
+		PTransform projectionModelviewDepthProjection=projectionModelview;
+		projectionModelviewDepthProjection*=depthProjection;
+		glMatrixMode(GL_PROJECTION);
+		glPushMatrix();
+		glLoadMatrix(projectionModelviewDepthProjection);
+		glMatrixMode(GL_MODELVIEW);
+		glPushMatrix();
+		glLoadIdentity();
+		
+		GLVertexArrayParts::enable(Vertex::getPartsMask());
+		glVertexPointer(static_cast<const Vertex*>(0));
+		glDrawArrays(GL_LINES,0,dataItem->numVertices);
+		GLVertexArrayParts::disable(Vertex::getPartsMask());
+		
+		/* Restablecer el estado de OpenGL: */
+		glPopMatrix();
+		glMatrixMode(GL_PROJECTION);
+		glPopMatrix();
+		glMatrixMode(GL_MODELVIEW);
+		glPopAttrib();
+		}
+	
+	/* Desvincula el búfer de vértices: */
+	glBindBufferARB(GL_ARRAY_BUFFER_ARB,0);
+	}
+
+void ContourGenerator::exportGeoJSON(const char* fileName,const ContourGenerator::ONTransform& boxTransform,double unitScale) const
+	{
+	/* Encadene los segmentos bloqueados en polilíneas: */
+	std::vector<std::vector<Point> > polylines;
+	std::vector<double> elevations;
+	buildPolylines(polylines,elevations,boxTransform,unitScale);
+	
+	/* Escriba una colección de entidades con una LineString por polilínea: */
+	IO::OStream file(IO::openFile(fileName,IO::File::WriteOnly));
+	file.precision(6);
+	file<<"{\"type\":\"FeatureCollection\",\"features\":["<<std::endl;
+	for(size_t i=0;i<polylines.size();++i)
+		{
+		file<<"{\"type\":\"Feature\",\"properties\":{\"elevation\":"<<elevations[i]<<"},\"geometry\":{\"type\":\"LineString\",\"coordinates\":[";
+		for(size_t j=0;j<polylines[i].size();++j)
+			{
+			if(j>0)
+				file<<',';
+			file<<'['<<polylines[i][j][0]<<','<<polylines[i][j][1]<<']';
+			}
+		file<<"]}}"<<(i+1<polylines.size()?",":"")<<std::endl;
+		}
+	file<<"]}"<<std::endl;
+	}
+
+void ContourGenerator::exportSVG(const char* fileName,const ContourGenerator::ONTransform& boxTransform,double unitScale) const
+	{
+	/* Encadene los segmentos bloqueados en polilíneas: */
+	std::vector<std::vector<Point> > polylines;
+	std::vector<double> elevations;
+	buildPolylines(polylines,elevations,boxTransform,unitScale);
+	
+	/* Calcule la extensión de las polilíneas para escribir el dibujo a escala 1:1 en cm: */
+	double min[2]={0.0,0.0};
+	double max[2]={0.0,0.0};
+	bool first=true;
+	for(std::vector<std::vector<Point> >::iterator plIt=polylines.begin();plIt!=polylines.end();++plIt)
+		for(std::vector<Point>::iterator pIt=plIt->begin();pIt!=plIt->end();++pIt)
+			{
+			for(int i=0;i<2;++i)
+				{
+				if(first||min[i]>(*pIt)[i])
+					min[i]=(*pIt)[i];
+				if(first||max[i]<(*pIt)[i])
+					max[i]=(*pIt)[i];
+				}
+			first=false;
+			}
+	
+	/* Escriba una polilínea por línea de contorno, con el eje y hacia arriba como en el espacio de la caja de arena: */
+	IO::OStream file(IO::openFile(fileName,IO::File::WriteOnly));
+	file.precision(6);
+	double width=max[0]-min[0];
+	double height=max[1]-min[1];
+	file<<"<?xml version=\"1.0\" encoding=\"UTF-8\"?>"<<std::endl;
+	file<<"<svg xmlns=\"http://www.w3.org/2000/svg\" width=\""<<width<<"cm\" height=\""<<height<<"cm\" viewBox=\""<<min[0]<<' '<<-max[1]<<' '<<width<<' '<<height<<"\">"<<std::endl;
+	file<<"<g fill=\"none\" stroke=\"black\" stroke-width=\"0.05\">"<<std::endl;
+	for(size_t i=0;i<polylines.size();++i)
+		{
+		file<<"<polyline data-elevation=\""<<elevations[i]<<"\" points=\"";
+		for(size_t j=0;j<polylines[i].size();++j)
+			file<<(j>0?" ":"")<<polylines[i][j][0]<<','<<-polylines[i][j][1];
+		file<<"\"/>"<<std::endl;
+		}
+	file<<"</g>"<<std::endl;
+	file<<"</svg>"<<std::endl;
+	}
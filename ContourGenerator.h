@@ -0,0 +1,164 @@
+/***********************************************************************
+ContourGenerator - Clase para extraer líneas de contorno topográficas
+vectoriales de la superficie de arena mediante marching squares en un
+hilo de fondo, con actualizaciones incrementales por mosaicos, para
+representarlas como geometría de líneas y exportarlas como GeoJSON o
+SVG.
+Copyright (c) 2014-2018 Oliver Kreylos
+Copyright (c) 2026 Sergio081096
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#ifndef CONTOURGENERATOR_INCLUDED
+#define CONTOURGENERATOR_INCLUDED
+
+#include <stddef.h>
+#include <vector>
+#include <Threads/MutexCond.h>
+#include <Threads/Thread.h>
+#include <Threads/TripleBuffer.h>
+#include <Geometry/OrthonormalTransformation.h>
+#include <GL/gl.h>
+#include <GL/GLObject.h>
+#include <GL/GLGeometryVertex.h>
+#include <Kinect/FrameBuffer.h>
+
+#include "Types.h"
+#include "TaskPool.h"
+
+class ContourGenerator:public GLObject,private TaskPool::Tasks
+	{
+	/* Clases integradas: */
+	public:
+	typedef Geometry::OrthonormalTransformation<Scalar,3> ONTransform; // Tipo para transformaciones de cuerpo rígido
+	
+	private:
+	typedef GLGeometry::Vertex<void,0,void,0,void,GLfloat,3> Vertex; // Tipo para vértices de líneas de contorno en el espacio de imagen de profundidad
+	
+	struct Segment // Estructura para un segmento de línea de contorno dentro de una celda de la cuadrícula
+		{
+		/* Elementos: */
+		public:
+		int level; // Índice del nivel de contorno, múltiplo del espaciado entre líneas
+		unsigned int edges[2]; // Índices de las aristas de la cuadrícula que contienen los extremos del segmento
+		Vertex vertices[2]; // Extremos del segmento en el espacio de imagen de profundidad
+		};
+	
+	struct Contours // Estructura para un conjunto completo de líneas de contorno publicado por el hilo de fondo
+		{
+		/* Elementos: */
+		public:
+		std::vector<Segment> segments; // Lista de segmentos de todos los mosaicos
+		float contourLineSpacing; // Espaciado entre líneas de contorno con el que se extrajeron los segmentos
+		};
+	
+	struct DataItem:public GLObject::DataItem
+		{
+		/* Elementos: */
+		public:
+		GLuint vertexBuffer; // Objeto de búfer de vértices con los extremos de todos los segmentos
+		GLsizei numVertices; // Número de vértices en el búfer de vértices
+		unsigned int contoursVersion; // Número de versión de las líneas de contorno en el búfer de vértices
+		
+		/* Constructores y destructores: */
+		DataItem(void);
+		virtual ~DataItem(void);
+		};
+	
+	enum PassType // Enumerado para los pasos paralelos del cálculo
+		{
+		ELEVATION, // Convierte el marco de profundidad en elevaciones y detecta mosaicos modificados
+		CONTOURS // Vuelve a extraer los segmentos de contorno de los mosaicos afectados
+		};
+	
+	/* Elementos: */
+	unsigned int size[2]; // Ancho y alto de la cuadrícula de muestras, igual al tamaño de los marcos de profundidad
+	unsigned int tileSize; // Ancho y alto de los mosaicos en celdas
+	unsigned int numTiles[2]; // Número de mosaicos en x e y
+	PTransform depthProjection; // Matriz de proyección desde el espacio de imagen de profundidad al espacio de la cámara
+	double basePlaneDicEq[4]; // Ecuación del plano base en el espacio de imagen de profundidad
+	double weightDicEq[4]; // Ecuación para calcular el peso de un punto del espacio de imagen de profundidad en el espacio de la cámara
+	float changeThreshold; // Cambio mínimo de elevación para marcar un mosaico como modificado
+	GLfloat lineColor[4]; // Color para representar las líneas de contorno
+	GLfloat lineWidth; // Ancho de las líneas de contorno en píxeles
+	
+	/* Estado del cálculo, solo usado por los hilos de fondo: */
+	const float* frameData; // Marco de profundidad que se está procesando
+	float spacing; // Espaciado entre líneas de contorno del cálculo actual
+	float* elevation; // Cuadrícula de elevación usada para los segmentos actuales
+	float* depth; // Profundidades en el espacio de imagen de profundidad usadas para los segmentos actuales
+	std::vector<unsigned char> tileDirty; // Marcas de mosaicos modificados desde el último cálculo
+	std::vector<std::vector<Segment> > tileSegments; // Segmentos de contorno actuales de cada mosaico
+	std::vector<unsigned int> tasks; // Lista de índices de mosaicos a procesar en el paso paralelo actual
+	bool haveElevation; // Marcar si la cuadrícula de elevación ya fue inicializada
+	
+	/* Estado del hilo de cálculo: */
+	Threads::MutexCond inputCond; // Variable de condición para señalar la llegada de un nuevo marco de entrada
+	Kinect::FrameBuffer inputFrame; // El marco de entrada más reciente
+	bool haveInputFrame; // Marcar si ya se recibió algún marco de entrada
+	unsigned int inputFrameVersion; // Número de versión del marco de entrada
+	float contourLineSpacing; // Espaciado entre líneas de contorno solicitado
+	bool spacingChanged; // Marcar si el espaciado cambió desde el último cálculo
+	volatile bool runContourThread; // Marcar para mantener en ejecución el hilo de cálculo de fondo
+	Threads::Thread contourThread; // El hilo de cálculo de fondo
+	
+	/* Estado de los hilos de trabajo: */
+	TaskPool taskPool; // Conjunto de hilos que ejecuta los pasos paralelos
+	PassType passType; // Tipo del paso paralelo actual
+	
+	/* Estado de salida: */
+	Threads::TripleBuffer<Contours> contours; // Triple buffer de conjuntos de líneas de contorno
+	unsigned int contoursVersion; // Número de versión del conjunto de líneas de contorno bloqueado
+	
+	/* Métodos privados: */
+	void processElevationTile(unsigned int tileIndex); // Convierte el marco de profundidad en elevaciones para un mosaico y detecta si cambió
+	void processContourTile(unsigned int tileIndex); // Vuelve a extraer los segmentos de contorno de las celdas de un mosaico
+	virtual void processTask(unsigned int task); // Procesa un mosaico del paso paralelo actual
+	void runPass(PassType newPassType); // Ejecuta un paso paralelo sobre la lista de tareas actual con todos los hilos
+	void processFrame(bool fullUpdate); // Actualiza las líneas de contorno a partir del marco de entrada actual
+	void* contourThreadMethod(void); // Método para el hilo de cálculo de fondo
+	void buildPolylines(std::vector<std::vector<Point> >& polylines,std::vector<double>& elevations,const ONTransform& boxTransform,double unitScale) const; // Encadena los segmentos bloqueados en polilíneas en el espacio de la caja de arena en cm
+	
+	/* Constructores y destructores: */
+	public:
+	ContourGenerator(const unsigned int sSize[2],const PTransform& sDepthProjection,const Plane& basePlane,unsigned int sNumThreads=4,unsigned int sTileSize=32); // Crea un generador de contornos para marcos de profundidad filtrados del tamaño dado
+	private:
+	ContourGenerator(const ContourGenerator& source); // Prohibir copia constructor
+	ContourGenerator& operator=(const ContourGenerator& source); // Prohibir operador de asignación
+	public:
+	virtual ~ContourGenerator(void);
+	
+	/* Métodos de GLObject: */
+	virtual void initContext(GLContextData& contextData) const;
+	
+	/* Nuevos métodos: */
+	void setChangeThreshold(float newChangeThreshold); // Establece el cambio mínimo de elevación para marcar un mosaico como modificado
+	void setContourLineSpacing(float newContourLineSpacing); // Establece el espaciado entre líneas de contorno adyacentes; vuelve a extraer todas las líneas
+	void setLineStyle(const GLfloat newLineColor[4],GLfloat newLineWidth); // Establece el color y el ancho en píxeles de las líneas de contorno
+	void receiveFilteredFrame(const Kinect::FrameBuffer& newFrame); // Llamado para recibir un nuevo marco de profundidad filtrado
+	bool lockNewContours(void); // Bloquea las líneas de contorno más recientes; devuelve verdadero si son nuevas
+	size_t getNumSegments(void) const // Devuelve el número de segmentos de las líneas de contorno bloqueadas
+		{
+		return contours.getLockedValue().segments.size();
+		}
+	void glRenderAction(const PTransform& projectionModelview,GLContextData& contextData) const; // Dibuja las líneas de contorno bloqueadas con la matriz de proyección y vista de modelo dada
+	void exportGeoJSON(const char* fileName,const ONTransform& boxTransform,double unitScale) const; // Escribe las líneas de contorno bloqueadas como colección de LineStrings GeoJSON en cm del espacio de la caja de arena
+	void exportSVG(const char* fileName,const ONTransform& boxTransform,double unitScale) const; // Escribe las líneas de contorno bloqueadas como polilíneas SVG en cm del espacio de la caja de arena
+	};
+
+#endif
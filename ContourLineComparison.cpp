@@ -0,0 +1,281 @@
+/***********************************************************************
+ContourLineComparison - Utilidad que compara en la CPU las líneas de
+contorno del sombreador a partir de la textura de elevaciones de esquina
+de píxel con las líneas de contorno analíticas a partir de la derivada
+de la elevación. Los algoritmos son traducciones directas de
+SurfaceAddContourLines.fs y SurfaceAddAnalyticContourLines.fs.
+Copyright (c) 2026 Sergio081096
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include <stdlib.h>
+#include <strings.h>
+#include <math.h>
+#include <vector>
+#include <iostream>
+#include <iomanip>
+
+namespace {
+
+/**************
+Helper classes:
+**************/
+
+struct Terrain // Estructura para una superficie sintética con colinas, un valle y una meseta
+	{
+	/* Elementos: */
+	public:
+	double pixelSize; // Tamaño de un píxel de pantalla en cm
+	
+	/* Métodos: */
+	double elevation(double x,double y) const // Devuelve la elevación en cm en la posición de pantalla dada en píxeles
+		{
+		double px=x*pixelSize;
+		double py=y*pixelSize;
+		double result=0.02*px;
+		result+=12.0*exp(-((px-30.0)*(px-30.0)+(py-35.0)*(py-35.0))/(2.0*8.0*8.0));
+		result+=25.0*exp(-((px-70.0)*(px-70.0)+(py-45.0)*(py-45.0))/(2.0*4.0*4.0));
+		result-=6.0*exp(-((px-55.0)*(px-55.0)+(py-15.0)*(py-15.0))/(2.0*12.0*12.0));
+		double pr=sqrt((px-20.0)*(px-20.0)+(py-62.0)*(py-62.0));
+		if(pr<6.0)
+			result+=3.0;
+		else if(pr<8.0)
+			result+=3.0*(8.0-pr)*0.5;
+		return result;
+		}
+	};
+
+struct Metrics // Estructura para las medidas de calidad de un método en una clase de pendiente
+	{
+	/* Elementos: */
+	public:
+	double length; // Longitud total de las líneas de contorno verdaderas en píxeles
+	double ink; // Cobertura total de las líneas dibujadas en píxeles
+	unsigned int crossingPixels; // Número de píxeles cuyo área cruza una línea de contorno verdadera
+	unsigned int gapPixels; // Número de píxeles de cruce sin ningún píxel con cobertura de al menos 0.5 en su vecindario 3x3
+	double falseInk; // Cobertura total en píxeles a más de 1.5 píxeles de la línea de contorno verdadera más cercana
+	
+	/* Constructores y destructores: */
+	Metrics(void)
+		:length(0.0),ink(0.0),crossingPixels(0),gapPixels(0),falseInk(0.0)
+		{
+		}
+	};
+
+/****************
+Helper functions:
+****************/
+
+void pixelCornerContourLines(const std::vector<float>& corners,int width,int height,std::vector<float>& coverage)
+	{
+	/* Evalúe el algoritmo de adelgazamiento de SurfaceAddContourLines.fs para cada píxel: */
+	for(int y=0;y<height;++y)
+		for(int x=0;x<width;++x)
+			{
+			float corner0=floorf(corners[y*(width+1)+x]);
+			float corner1=floorf(corners[y*(width+1)+x+1]);
+			float corner2=floorf(corners[(y+1)*(width+1)+x]);
+			float corner3=floorf(corners[(y+1)*(width+1)+x+1]);
+			int edgeMask=0;
+			int numEdges=0;
+			if(corner0!=corner1)
+				{
+				edgeMask+=1;
+				++numEdges;
+				}
+			if(corner2!=corner3)
+				{
+				edgeMask+=2;
+				++numEdges;
+				}
+			if(corner0!=corner2)
+				{
+				edgeMask+=4;
+				++numEdges;
+				}
+			if(corner1!=corner3)
+				{
+				edgeMask+=8;
+				++numEdges;
+				}
+			bool line=numEdges>2||edgeMask==3||edgeMask==12||(numEdges==2&&(x+y)%2==0);
+			coverage[y*width+x]=line?1.0f:0.0f;
+			}
+	}
+
+void analyticContourLines(const std::vector<float>& centers,int width,int height,std::vector<float>& coverage)
+	{
+	/* Evalúe SurfaceAddAnalyticContourLines.fs con derivadas finas dentro de cada cuadrícula de 2x2 fragmentos: */
+	for(int y=0;y<height;++y)
+		for(int x=0;x<width;++x)
+			{
+			int qx=x&~1;
+			int qy=y&~1;
+			float contour=centers[y*width+x];
+			float dx=qx+1<width?centers[y*width+qx+1]-centers[y*width+qx]:0.0f;
+			float dy=qy+1<height?centers[(qy+1)*width+x]-centers[qy*width+x]:0.0f;
+			float dist=fabsf(contour+0.5f-floorf(contour+0.5f)-0.5f);
+			float pixelWidth=sqrtf(dx*dx+dy*dy);
+			if(pixelWidth<1.0e-6f)
+				pixelWidth=1.0e-6f;
+			float c=dist/pixelWidth;
+			c=c<0.0f?0.0f:(c>1.0f?1.0f:c);
+			coverage[y*width+x]=1.0f-c;
+			}
+	}
+
+void measure(const std::vector<float>& coverage,const std::vector<double>& gradient,const std::vector<double>& trueDistance,const std::vector<bool>& crossing,const std::vector<int>& slopeClass,int width,int height,Metrics metrics[3])
+	{
+	for(int y=1;y<height-1;++y)
+		for(int x=1;x<width-1;++x)
+			{
+			int i=y*width+x;
+			Metrics& m=metrics[slopeClass[i]];
+			m.length+=gradient[i];
+			m.ink+=coverage[i];
+			if(trueDistance[i]>1.5)
+				m.falseInk+=coverage[i];
+			if(crossing[i])
+				{
+				++m.crossingPixels;
+				bool covered=false;
+				for(int dy=-1;dy<=1&&!covered;++dy)
+					for(int dx=-1;dx<=1;++dx)
+						covered=covered||coverage[i+dy*width+dx]>=0.5f;
+				if(!covered)
+					++m.gapPixels;
+				}
+			}
+	}
+
+}
+
+int main(int argc,char* argv[])
+	{
+	/* Analice la línea de comandos: */
+	int width=1024;
+	int height=768;
+	double contourLineDistance=1.0;
+	for(int i=1;i<argc;++i)
+		{
+		if(argv[i][0]=='-')
+			{
+			if(strcasecmp(argv[i]+1,"size")==0&&i+2<argc)
+				{
+				width=atoi(argv[i+1]);
+				height=atoi(argv[i+2]);
+				i+=2;
+				}
+			else if(strcasecmp(argv[i]+1,"cld")==0&&i+1<argc)
+				{
+				++i;
+				contourLineDistance=atof(argv[i]);
+				}
+			else
+				std::cerr<<"Ignoring unrecognized option "<<argv[i]<<std::endl;
+			}
+		}
+	double contourLineFactor=1.0/contourLineDistance;
+	
+	/* Cree la superficie de prueba de 100cm de ancho: */
+	Terrain terrain;
+	terrain.pixelSize=100.0/double(width);
+	
+	/* Evalúe las elevaciones en las esquinas y en los centros de los píxeles, en unidades de la distancia entre líneas de contorno: */
+	std::vector<float> corners((width+1)*(height+1));
+	for(int y=0;y<=height;++y)
+		for(int x=0;x<=width;++x)
+			corners[y*(width+1)+x]=float(terrain.elevation(x,y)*contourLineFactor);
+	std::vector<float> centers(width*height);
+	for(int y=0;y<height;++y)
+		for(int x=0;x<width;++x)
+			centers[y*width+x]=float(terrain.elevation(x+0.5,y+0.5)*contourLineFactor);
+	
+	/* Calcule la referencia con 8x8 muestras por píxel: */
+	const int numSubs=8;
+	std::vector<double> gradient(width*height);
+	std::vector<double> trueDistance(width*height);
+	std::vector<bool> crossing(width*height);
+	std::vector<int> slopeClass(width*height);
+	for(int y=0;y<height;++y)
+		for(int x=0;x<width;++x)
+			{
+			int i=y*width+x;
+			double gSum=0.0;
+			double cMin=1.0e30,cMax=-1.0e30;
+			for(int sy=0;sy<numSubs;++sy)
+				for(int sx=0;sx<numSubs;++sx)
+					{
+					double px=x+(sx+0.5)/numSubs;
+					double py=y+(sy+0.5)/numSubs;
+					double c=terrain.elevation(px,py)*contourLineFactor;
+					if(cMin>c)
+						cMin=c;
+					if(cMax<c)
+						cMax=c;
+					double gx=(terrain.elevation(px+0.01,py)-terrain.elevation(px-0.01,py))*contourLineFactor/0.02;
+					double gy=(terrain.elevation(px,py+0.01)-terrain.elevation(px,py-0.01))*contourLineFactor/0.02;
+					gSum+=sqrt(gx*gx+gy*gy);
+					}
+			
+			/* La longitud de las líneas de contorno en el píxel es la integral del gradiente (fórmula de la coárea): */
+			gradient[i]=gSum/double(numSubs*numSubs);
+			crossing[i]=floor(cMin)!=floor(cMax);
+			
+			/* Calcule la distancia en píxeles del centro del píxel a la línea de contorno más cercana: */
+			double c=terrain.elevation(x+0.5,y+0.5)*contourLineFactor;
+			double d=fabs(c-floor(c+0.5));
+			double g=gradient[i]>1.0e-9?gradient[i]:1.0e-9;
+			trueDistance[i]=crossing[i]?0.0:d/g;
+			
+			/* Clasifique el píxel según la separación en píxeles entre líneas de contorno adyacentes: */
+			double spacing=1.0/g;
+			slopeClass[i]=spacing>8.0?0:(spacing>2.0?1:2);
+			}
+	
+	/* Evalúe ambos métodos: */
+	std::vector<float> coverage(width*height);
+	Metrics pcMetrics[3],anMetrics[3];
+	pixelCornerContourLines(corners,width,height,coverage);
+	measure(coverage,gradient,trueDistance,crossing,slopeClass,width,height,pcMetrics);
+	analyticContourLines(centers,width,height,coverage);
+	measure(coverage,gradient,trueDistance,crossing,slopeClass,width,height,anMetrics);
+	
+	/* Imprima los resultados: */
+	static const char* slopeNames[3]={"gentle (spacing > 8 px)","moderate (2-8 px)","steep (< 2 px)"};
+	std::cout<<"Screen "<<width<<'x'<<height<<", contour line distance "<<contourLineDistance<<" cm"<<std::endl;
+	std::cout<<std::fixed;
+	for(int sc=0;sc<3;++sc)
+		{
+		std::cout<<slopeNames[sc]<<": contour length "<<std::setprecision(0)<<pcMetrics[sc].length<<" px, "<<pcMetrics[sc].crossingPixels<<" crossing pixels"<<std::endl;
+		const Metrics* ms[2]={&pcMetrics[sc],&anMetrics[sc]};
+		static const char* methodNames[2]={"  pixel corner","  analytic    "};
+		for(int m=0;m<2;++m)
+			{
+			double length=ms[m]->length>0.0?ms[m]->length:1.0;
+			double crossings=ms[m]->crossingPixels>0?double(ms[m]->crossingPixels):1.0;
+			std::cout<<methodNames[m]<<": line width "<<std::setprecision(2)<<ms[m]->ink/length<<" px, gaps "<<std::setprecision(3)<<100.0*double(ms[m]->gapPixels)/crossings<<"%, ink farther than 1.5 px "<<std::setprecision(3)<<100.0*ms[m]->falseInk/(ms[m]->ink>0.0?ms[m]->ink:1.0)<<"%"<<std::endl;
+			}
+		}
+	
+	/* Imprima el coste de memoria del paso de elevaciones de esquina de píxel: */
+	double pcBytes=double(width+1)*double(height+1)*8.0;
+	std::cout<<"Pixel corner pass: one extra elevation pass per view and depth frame, "<<std::setprecision(1)<<pcBytes/(1024.0*1024.0)<<" MB of R32F texture and depth buffer per view"<<std::endl;
+	
+	return 0;
+	}
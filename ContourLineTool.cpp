@@ -1,6 +1,7 @@
 #include "ContourLineTool.h"
 #include "Sandbox.h"
 #include "SurfaceRenderer.h"
+#include "ContourGenerator.h"
 
 ContourLineToolFactory* ContourLineTool::factory=0;
 ContourLineToolFactory* ContourLineTool::initClass(Vrui::ToolManager& toolManager)
@@ -72,6 +73,10 @@ void ContourLineTool::adjustContourLines(int buttonSlotIndex)
         rsIt->surfaceRenderer->setContourLineDistance(rsIt->contourLineSpacing);
     }
     
+    // re-extract the vector contour lines with the first window's spacing
+    if(application->contourGenerator!=0)
+        application->contourGenerator->setContourLineSpacing(application->renderSettings.front().contourLineSpacing);
+    
 }
 
 
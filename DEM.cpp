@@ -22,6 +22,10 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 
 #include "DEM.h"
 
+#include <string>
+#include <iostream>
+#include <stdexcept>
+#include <Math/Math.h>
 #include <IO/File.h>
 #include <IO/OpenFile.h>
 #include <GL/gl.h>
@@ -30,14 +34,18 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 #include <GL/Extensions/GLARBTextureRectangle.h>
 #include <GL/Extensions/GLARBTextureRg.h>
 #include <GL/Extensions/GLARBShaderObjects.h>
+#include <Misc/ThrowStdErr.h>
 #include <Geometry/Matrix.h>
 
+#include "DEMPyramid.h"
+#include "DEMImporter.h"
+
 /******************************
 Methods of class DEM::DataItem:
 ******************************/
 
 DEM::DataItem::DataItem(void)
-	:textureObjectId(0)
+	:textureObjectId(0),demVersion(0)
 	{
 	/* Verifique e inicialice todas las extensiones OpenGL requeridas: */
 	GLARBTextureFloat::initExtension();
@@ -82,8 +90,116 @@ void DEM::calcMatrix(void)
 			*dtmPtr=GLfloat(dtm(i,j));
 	}
 
+void DEM::loadGrid(const char* demFileName)
+	{
+	/* Lea el archivo DEM: */
+	IO::FilePtr demFile=IO::openFile(demFileName);
+	demFile->setEndianness(Misc::LittleEndian);
+	demFile->read<int>(loadSize,2);
+	loadDem=new float[loadSize[1]*loadSize[0]];
+	for(int i=0;i<4;++i)
+		loadBox[i]=double(demFile->read<float>());
+	demFile->read<float>(loadDem,loadSize[1]*loadSize[0]);
+	}
+
+void DEM::loadPyramid(const char* pyramidFileName)
+	{
+	/* Mapee la pirámide en memoria solo durante el remuestreo: */
+	DEMPyramid pyramid(pyramidFileName);
+	const float* pyramidBox=pyramid.getDemBox();
+	for(int i=0;i<4;++i)
+		loadBox[i]=Scalar(pyramidBox[i]);
+	
+	/* Calcule el tamaño de la matriz DEM, reduciendo el DEM completo a la resolución máxima manteniendo la separación de las muestras: */
+	const unsigned int* fullSize=pyramid.getLevelSize(0);
+	unsigned int maxSize=fullSize[0]>fullSize[1]?fullSize[0]:fullSize[1];
+	unsigned int size[2];
+	for(int i=0;i<2;++i)
+		{
+		size[i]=fullSize[i];
+		if(maxSize>maxResolution)
+			size[i]=(unsigned int)(double(fullSize[i]-1)*double(maxResolution-1)/double(maxSize-1)+0.5)+1;
+		loadSize[i]=int(size[i]);
+		}
+	
+	/* Remuestree el nivel más grueso que tenga suficiente resolución; el mapeo se libera al salir: */
+	loadDem=new float[loadSize[1]*loadSize[0]];
+	pyramid.resample(pyramid.findLevel(size),size,loadDem,numThreads,&loadCancelled);
+	}
+
+void* DEM::loadThreadMethod(void)
+	{
+	try
+		{
+		/* Convierta los archivos GeoTIFF y de cuadrícula ASCII a través de la caché de DEM importados: */
+		std::string gridFileName=loadFileName;
+		if(DEMImporter::isImportable(loadFileName.c_str()))
+			gridFileName=DEMImporter::importDEM(loadFileName.c_str(),importCacheDirectory,numThreads);
+		const char* demFileName=gridFileName.c_str();
+		
+		/* Abandone una carga cancelada durante la importación; update() descarta el resultado: */
+		if(loadCancelled)
+			{
+			loadFinished=true;
+			return 0;
+			}
+		
+		if(DEMPyramid::isPyramidFile(demFileName))
+			loadPyramid(demFileName);
+		else
+			{
+			/* Lea el tamaño de la cuadrícula: */
+			int gridSize[2];
+			{
+			IO::FilePtr demFile=IO::openFile(demFileName);
+			demFile->setEndianness(Misc::LittleEndian);
+			demFile->read<int>(gridSize,2);
+			}
+			
+			bool havePyramid=false;
+			std::string pyramidFileName=demFileName;
+			pyramidFileName.append(".pyr");
+			if(gridSize[0]>int(maxResolution)||gridSize[1]>int(maxResolution))
+				{
+				/* Reutilice la pirámide junto a la cuadrícula, o créela si no existe o está desactualizada: */
+				havePyramid=DEMPyramid::isCurrent(pyramidFileName.c_str(),demFileName);
+				if(!havePyramid)
+					{
+					try
+						{
+						havePyramid=DEMPyramid::build(demFileName,pyramidFileName.c_str(),8,&loadCancelled);
+						}
+					catch(const std::runtime_error& err)
+						{
+						std::cerr<<"Loading full DEM grid "<<demFileName<<" due to exception "<<err.what()<<std::endl;
+						}
+					}
+				}
+			
+			if(havePyramid)
+				loadPyramid(pyramidFileName.c_str());
+			else if(!loadCancelled)
+				loadGrid(demFileName);
+			}
+		}
+	catch(const std::runtime_error& err)
+		{
+		/* Entregue el error al hilo principal: */
+		delete[] loadDem;
+		loadDem=0;
+		loadError=err.what();
+		}
+	
+	loadFinished=true;
+	
+	return 0;
+	}
+
 DEM::DEM(void)
-	:dem(0),
+	:dem(0),demVersion(0),
+	 maxResolution(2048),numThreads(4),
+	 loading(false),loadFinished(false),loadCancelled(false),
+	 havePendingLoad(false),loadDem(0),
 	 transform(OGTransform::identity),
 	 verticalScale(1),verticalScaleBase(0)
 	{
@@ -92,6 +208,13 @@ DEM::DEM(void)
 
 DEM::~DEM(void)
 	{
+	/* Cancele una carga pendiente y espere a que su hilo salga: */
+	if(loading)
+		{
+		loadCancelled=true;
+		loadThread.join();
+		}
+	delete[] loadDem;
 	delete[] dem;
 	}
 
@@ -101,29 +224,85 @@ void DEM::initContext(GLContextData& contextData) const
 	DataItem* dataItem=new DataItem;
 	contextData.addDataItem(this,dataItem);
 	
-	/* Cargue la matriz DEM en el objeto de textura: */
+	/* Configure el objeto de textura; la matriz DEM se carga la primera vez que se vincula: */
 	glBindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->textureObjectId);
 	glTexParameteri(GL_TEXTURE_RECTANGLE_ARB,GL_TEXTURE_MIN_FILTER,GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_RECTANGLE_ARB,GL_TEXTURE_MAG_FILTER,GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_RECTANGLE_ARB,GL_TEXTURE_WRAP_S,GL_CLAMP);
 	glTexParameteri(GL_TEXTURE_RECTANGLE_ARB,GL_TEXTURE_WRAP_T,GL_CLAMP);
-	glTexImage2D(GL_TEXTURE_RECTANGLE_ARB,0,GL_LUMINANCE32F_ARB,demSize[0],demSize[1],0,GL_LUMINANCE,GL_FLOAT,dem);
 	glBindTexture(GL_TEXTURE_RECTANGLE_ARB,0);
 	}
 
+void DEM::setResolution(unsigned int newMaxResolution,unsigned int newNumThreads)
+	{
+	maxResolution=newMaxResolution>2?newMaxResolution:2;
+	numThreads=newNumThreads>1?newNumThreads:1;
+	}
+
+void DEM::setImportCacheDirectory(const std::string& newImportCacheDirectory)
+	{
+	importCacheDirectory=newImportCacheDirectory;
+	}
+
+void DEM::startLoad(const std::string& demFileName)
+	{
+	/* Cargue el DEM en el hilo de carga; el DEM actual se sigue usando mientras tanto: */
+	loadFileName=demFileName;
+	loadError.clear();
+	loading=true;
+	loadFinished=false;
+	loadCancelled=false;
+	loadThread.start(this,&DEM::loadThreadMethod);
+	}
+
 void DEM::load(const char* demFileName)
 	{
-	/* Lea el archivo DEM: */
-	IO::FilePtr demFile=IO::openFile(demFileName);
-	demFile->setEndianness(Misc::LittleEndian);
-	demFile->read<int>(demSize,2);
-	dem=new float[demSize[1]*demSize[0]];
+	if(loading)
+		{
+		/* Pida a la carga anterior que se abandone y deje el nuevo archivo para update(), sin bloquear el hilo principal: */
+		loadCancelled=true;
+		havePendingLoad=true;
+		pendingLoadFileName=demFileName;
+		}
+	else
+		startLoad(demFileName);
+	}
+
+bool DEM::update(void)
+	{
+	/* Compruebe si el hilo de carga terminó: */
+	if(!loading||!loadFinished)
+		return false;
+	loadThread.join();
+	loading=false;
+	
+	/* Descarte el resultado de una carga cancelada y empiece la carga pedida mientras tanto: */
+	if(havePendingLoad)
+		{
+		delete[] loadDem;
+		loadDem=0;
+		havePendingLoad=false;
+		startLoad(pendingLoadFileName);
+		return false;
+		}
+	
+	if(!loadError.empty())
+		Misc::throwStdErr("DEM::update: Unable to load DEM file %s due to exception %s",loadFileName.c_str(),loadError.c_str());
+	
+	/* Intercambie el nuevo DEM: */
+	delete[] dem;
+	dem=loadDem;
+	loadDem=0;
+	for(int i=0;i<2;++i)
+		demSize[i]=loadSize[i];
 	for(int i=0;i<4;++i)
-		demBox[i]=double(demFile->read<float>());
-	demFile->read<float>(dem,demSize[1]*demSize[0]);
+		demBox[i]=loadBox[i];
+	++demVersion;
 	
 	/* Actualice la transformación DEM: */
 	calcMatrix();
+	
+	return true;
 	}
 
 float DEM::calcAverageElevation(void) const
@@ -148,6 +327,20 @@ void DEM::setTransform(const OGTransform& newTransform,Scalar newVerticalScale,S
 	calcMatrix();
 	}
 
+Scalar DEM::getPixelArea(void) const
+	{
+	/* Escale el área del píxel en el espacio DEM al espacio de la cámara: */
+	Scalar pixelWidth=(demBox[2]-demBox[0])/Scalar(demSize[0]-1);
+	Scalar pixelHeight=(demBox[3]-demBox[1])/Scalar(demSize[1]-1);
+	return pixelWidth*pixelHeight/Math::sqr(transform.getScaling());
+	}
+
+Scalar DEM::getDistanceScale(void) const
+	{
+	/* Deshaga la exageración vertical y escale la distancia en el espacio DEM al espacio de la cámara: */
+	return verticalScale/transform.getScaling();
+	}
+
 void DEM::bindTexture(GLContextData& contextData) const
 	{
 	/* Obtener el elemento de datos de contexto: */
@@ -155,6 +348,13 @@ void DEM::bindTexture(GLContextData& contextData) const
 	
 	/* Vincula la textura DEM: */
 	glBindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->textureObjectId);
+	
+	/* Cargue la matriz DEM en el objeto de textura si cambió: */
+	if(dataItem->demVersion!=demVersion)
+		{
+		glTexImage2D(GL_TEXTURE_RECTANGLE_ARB,0,GL_LUMINANCE32F_ARB,demSize[0],demSize[1],0,GL_LUMINANCE,GL_FLOAT,dem);
+		dataItem->demVersion=demVersion;
+		}
 	}
 
 void DEM::uploadDemTransform(GLint location) const
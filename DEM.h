@@ -23,6 +23,8 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 #ifndef DEM_INCLUDED
 #define DEM_INCLUDED
 
+#include <string>
+#include <Threads/Thread.h>
 #include <GL/gl.h>
 #include <GL/GLObject.h>
 
@@ -37,6 +39,7 @@ class DEM:public GLObject
 		/* Elementos: */
 		public:
 		GLuint textureObjectId; // ID del objeto de textura con modelo de elevación digital
+		unsigned int demVersion; // Versión de la matriz DEM cargada en el objeto de textura
 		
 		/* Constructores y destructores: */
 		DataItem(void);
@@ -48,6 +51,21 @@ class DEM:public GLObject
 	int demSize[2]; // Ancho y alto de la cuadrícula DEM
 	Scalar demBox[4]; // Coordenadas de la esquina inferior izquierda y superior derecha del DEM
 	float* dem; // Matriz de mediciones de elevación DEM
+	unsigned int demVersion; // Número de versión de la matriz DEM
+	unsigned int maxResolution; // Tamaño máximo de la matriz DEM en cualquier dirección al cargar desde una pirámide
+	unsigned int numThreads; // Número de hilos para remuestrear una pirámide o importar un archivo DEM
+	std::string importCacheDirectory; // Directorio para guardar los DEM importados de archivos GeoTIFF o de cuadrícula ASCII, o vacío para guardarlos junto al archivo
+	bool loading; // Marcar si el hilo de carga está en ejecución o aún no se ha unido
+	volatile bool loadFinished; // Marcar que el hilo de carga activa cuando termina
+	volatile bool loadCancelled; // Marcar que pide al hilo de carga que abandone su carga entre etapas, niveles y bandas
+	std::string loadFileName; // Nombre del archivo que carga el hilo de carga, antes de la importación
+	bool havePendingLoad; // Marcar si update() debe empezar a cargar un archivo pedido durante otra carga
+	std::string pendingLoadFileName; // Nombre del archivo pedido durante otra carga
+	int loadSize[2]; // Ancho y alto de la cuadrícula cargada por el hilo de carga
+	Scalar loadBox[4]; // Cuadro delimitador de la cuadrícula cargada por el hilo de carga
+	float* loadDem; // Matriz de elevación cargada por el hilo de carga, que se intercambia en el hilo principal
+	std::string loadError; // Mensaje de error del hilo de carga, o vacío
+	Threads::Thread loadThread; // Hilo que importa archivos, construye pirámides y carga el DEM sin bloquear el hilo principal
 	OGTransform transform; // Transformación del espacio de la cámara al espacio DEM (z arriba)
 	Scalar verticalScale; // Factor de escala vertical (exageración)
 	Scalar verticalScaleBase; // Elevación base alrededor de la cual se aplica la escala vertical
@@ -56,6 +74,10 @@ class DEM:public GLObject
 	
 	/* Métodos privados: */
 	void calcMatrix(void); // Calcula el espacio de la cámara a la transformación de espacio de píxeles DEM
+	void loadGrid(const char* demFileName); // Lee un archivo de cuadrícula DEM completo en la matriz del hilo de carga
+	void loadPyramid(const char* pyramidFileName); // Remuestrea el nivel adecuado de una pirámide DEM en la matriz del hilo de carga y libera el mapeo de la pirámide
+	void* loadThreadMethod(void); // Método para el hilo de carga
+	void startLoad(const std::string& demFileName); // Inicia el hilo de carga para el archivo dado
 	
 	/* Constructores y destructores: */
 	public:
@@ -66,11 +88,30 @@ class DEM:public GLObject
 	virtual void initContext(GLContextData& contextData) const;
 	
 	/* Nuevos métodos: */
-	void load(const char* demFileName); // Carga el DEM del archivo dado
+	void setResolution(unsigned int newMaxResolution,unsigned int newNumThreads); // Establece el tamaño máximo de la matriz DEM y el número de hilos para cargar desde pirámides e importar archivos
+	void setImportCacheDirectory(const std::string& newImportCacheDirectory); // Establece el directorio de la caché de DEM importados; una cadena vacía guarda las conversiones junto a los archivos de origen
+	void load(const char* demFileName); // Empieza a cargar en segundo plano el DEM del archivo dado, que puede ser una cuadrícula, una pirámide, o un GeoTIFF o una cuadrícula ASCII que se importan a través de la caché; las cuadrículas se convierten a una pirámide junto al archivo si es posible; el DEM actual se conserva hasta que update() intercambia el nuevo; durante otra carga, cancela esa carga sin esperarla y deja el archivo para que update() lo empiece
+	bool isLoading(void) const // Devuelve verdadero si hay una carga en segundo plano que update() aún no ha intercambiado
+		{
+		return loading;
+		}
+	bool update(void); // Intercambia el DEM cargado en segundo plano si está listo; devuelve verdadero si cambió el DEM; lanza una excepción si la carga falló
 	const Scalar* getDemBox(void) const // Devuelve el cuadro delimitador del DEM como x inferior izquierda, inferior izquierda y, superior derecha x, superior derecha y
 		{
 		return demBox;
 		}
+	const int* getDemSize(void) const // Devuelve el ancho y alto de la cuadrícula DEM
+		{
+		return demSize;
+		}
+	const float* getDemData(void) const // Devuelve la matriz de mediciones de elevación DEM, empezando por la fila inferior
+		{
+		return dem;
+		}
+	unsigned int getDemVersion(void) const // Devuelve el número de versión de la matriz DEM, que cambia con cada carga
+		{
+		return demVersion;
+		}
 	float calcAverageElevation(void) const; // Calcula la elevación promedio del DEM
 	void setTransform(const OGTransform& newTransform,Scalar newVerticalScale,Scalar newVerticalScaleBase); // Establece la transformación DEM
 	const PTransform& getDemTransform(void) const // Devuelve la transformación completa del espacio de la cámara al espacio de píxeles DEM escalado verticalmente
@@ -81,6 +122,8 @@ class DEM:public GLObject
 		{
 		return transform.getScaling()/verticalScale;
 		}
+	Scalar getPixelArea(void) const; // Devuelve el área horizontal de un píxel DEM en el espacio de la cámara
+	Scalar getDistanceScale(void) const; // Devuelve el factor de escala de las distancias verticales en el espacio de píxeles DEM escalado verticalmente al espacio de la cámara
 	void bindTexture(GLContextData& contextData) const; // Vincula el objeto de textura DEM a la unidad de textura actualmente activa
 	void uploadDemTransform(GLint location) const; // Carga la transformación DEM en la matriz GLSL 4x4 en la ubicación uniforme dada
 	};
@@ -0,0 +1,360 @@
+/***********************************************************************
+DEMDeviation - Clase para calcular en hilos de fondo estadísticas de la
+desviación entre la superficie de arena y el DEM activo: error medio
+cuadrático, volúmenes de corte y relleno, y puntuaciones por regiones.
+Copyright (c) 2012-2016 Oliver Kreylos
+Copyright (c) 2026 Sergio081096
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include "DEMDeviation.h"
+
+#include <Math/Math.h>
+#include <Realtime/Time.h>
+
+#include "DEM.h"
+
+/*****************************
+Methods of class DEMDeviation:
+*****************************/
+
+void DEMDeviation::processBand(unsigned int bandIndex)
+	{
+	/* Calcule el intervalo de filas de la banda: */
+	unsigned int yStart=bandIndex*bandSize*sampleStep;
+	unsigned int yEnd=Math::min(yStart+bandSize*sampleStep,size[1]);
+	
+	/* Copie el estado del cálculo a variables locales para que el compilador pueda mantenerlo en registros: */
+	double m[16];
+	for(int i=0;i<16;++i)
+		m[i]=dicToDem[i];
+	int dw=demSize[0];
+	const float* dem=&demGrid[0];
+	double xMax=double(demSize[0])-0.5;
+	double yMax=double(demSize[1])-0.5;
+	unsigned int nrx=numRegions[0];
+	unsigned int nry=numRegions[1];
+	double rsx=double(nrx)/double(demSize[0]-1);
+	double rsy=double(nry)/double(demSize[1]-1);
+	double ds=distScale;
+	double tol=tolerance;
+	
+	/* Reinicie las sumas parciales de la banda: */
+	Accumulator* acc=&accumulators[bandIndex*(1+nry*nrx)];
+	for(unsigned int i=0;i<=nry*nrx;++i)
+		acc[i].reset();
+	double numSamples=0.0,numWithin=0.0,sumError=0.0,sumSqError=0.0,cutVolume=0.0,fillVolume=0.0;
+	
+	for(unsigned int y=yStart;y<yEnd;y+=sampleStep)
+		{
+		/* Precalcule las partes de la transformación que son constantes a lo largo de la fila: */
+		const float* rowPtr=frameData+y*size[0];
+		double dy=double(y)+0.5;
+		double rowArea=double(Math::min(sampleStep,size[1]-y))*pixelArea;
+		double rowX=m[1]*dy+m[3];
+		double rowY=m[5]*dy+m[7];
+		double rowZ=m[9]*dy+m[11];
+		double rowW=m[13]*dy+m[15];
+		for(unsigned int x=0;x<size[0];x+=sampleStep)
+			{
+			/* Transforme la muestra al espacio de píxeles DEM: */
+			double dx=double(x)+0.5;
+			double d=double(rowPtr[x]);
+			double invW=1.0/(m[12]*dx+m[14]*d+rowW);
+			double demX=(m[0]*dx+m[2]*d+rowX)*invW;
+			double demY=(m[4]*dx+m[6]*d+rowY)*invW;
+			
+			/* Ignore las muestras fuera del DEM: */
+			if(demX<0.5||demX>xMax||demY<0.5||demY>yMax)
+				continue;
+			double demZ=(m[8]*dx+m[10]*d+rowZ)*invW;
+			
+			/* Interpole bilinealmente la elevación DEM, como el muestreador de texturas: */
+			double gx=demX-0.5;
+			double gy=demY-0.5;
+			int ix=Math::min(int(gx),dw-2);
+			int iy=Math::min(int(gy),demSize[1]-2);
+			double fx=gx-double(ix);
+			double fy=gy-double(iy);
+			const float* demPtr=dem+(iy*dw+ix);
+			double e0=double(demPtr[0])+(double(demPtr[1])-double(demPtr[0]))*fx;
+			double e1=double(demPtr[dw])+(double(demPtr[dw+1])-double(demPtr[dw]))*fx;
+			double dist=(demZ-(e0+(e1-e0)*fy))*ds;
+			
+			/* Calcule el área horizontal de la muestra a partir del jacobiano de la proyección: */
+			double dXdx=m[0]-demX*m[12];
+			double dXdy=m[1]-demX*m[13];
+			double dYdx=m[4]-demY*m[12];
+			double dYdy=m[5]-demY*m[13];
+			double area=Math::abs(dXdx*dYdy-dXdy*dYdx)*invW*invW*double(Math::min(sampleStep,size[0]-x))*rowArea;
+			
+			/* Acumule la desviación globalmente y en la región de la muestra: */
+			double sqDist=dist*dist;
+			double within=Math::abs(dist)<=tol?1.0:0.0;
+			numSamples+=1.0;
+			numWithin+=within;
+			sumError+=dist;
+			sumSqError+=sqDist;
+			if(dist>=0.0)
+				cutVolume+=dist*area;
+			else
+				fillVolume-=dist*area;
+			unsigned int rx=Math::min((unsigned int)(gx*rsx),nrx-1);
+			unsigned int ry=Math::min((unsigned int)(gy*rsy),nry-1);
+			Accumulator& racc=acc[1+ry*nrx+rx];
+			racc.numSamples+=1.0;
+			racc.numWithinTolerance+=within;
+			racc.sumSqError+=sqDist;
+			}
+		}
+	
+	/* Guarde las sumas globales de la banda: */
+	acc[0].numSamples=numSamples;
+	acc[0].numWithinTolerance=numWithin;
+	acc[0].sumError=sumError;
+	acc[0].sumSqError=sumSqError;
+	acc[0].cutVolume=cutVolume;
+	acc[0].fillVolume=fillVolume;
+	}
+
+void DEMDeviation::processTask(unsigned int task)
+	{
+	processBand(task);
+	}
+
+void DEMDeviation::processFrame(void)
+	{
+	Realtime::TimePointMonotonic timer;
+	
+	/* Prepare las sumas parciales para la disposición de regiones actual: */
+	unsigned int numAccumulators=1+numRegions[1]*numRegions[0];
+	accumulators.resize(numBands*numAccumulators);
+	
+	/* Procese todas las bandas con todos los hilos: */
+	taskPool.run(*this,numBands);
+	
+	/* Reduzca las sumas parciales de todas las bandas: */
+	std::vector<Accumulator> total(numAccumulators);
+	for(unsigned int i=0;i<numAccumulators;++i)
+		total[i].reset();
+	const Accumulator* accPtr=&accumulators[0];
+	for(unsigned int band=0;band<numBands;++band)
+		for(unsigned int i=0;i<numAccumulators;++i,++accPtr)
+			{
+			total[i].numSamples+=accPtr->numSamples;
+			total[i].numWithinTolerance+=accPtr->numWithinTolerance;
+			total[i].sumError+=accPtr->sumError;
+			total[i].sumSqError+=accPtr->sumSqError;
+			total[i].cutVolume+=accPtr->cutVolume;
+			total[i].fillVolume+=accPtr->fillVolume;
+			}
+	
+	/* Publique las nuevas estadísticas: */
+	Statistics& newStatistics=statistics.startNewValue();
+	const Accumulator& t=total[0];
+	newStatistics.numSamples=(unsigned int)(t.numSamples);
+	if(t.numSamples>0.0)
+		{
+		newStatistics.meanError=t.sumError/t.numSamples;
+		newStatistics.rmsError=Math::sqrt(t.sumSqError/t.numSamples);
+		newStatistics.score=t.numWithinTolerance*100.0/t.numSamples;
+		}
+	else
+		newStatistics.meanError=newStatistics.rmsError=newStatistics.score=0.0;
+	newStatistics.cutVolume=t.cutVolume;
+	newStatistics.fillVolume=t.fillVolume;
+	for(int i=0;i<2;++i)
+		newStatistics.numRegions[i]=numRegions[i];
+	newStatistics.regions.resize(numAccumulators-1);
+	for(unsigned int i=1;i<numAccumulators;++i)
+		{
+		RegionStatistics& rs=newStatistics.regions[i-1];
+		rs.numSamples=(unsigned int)(total[i].numSamples);
+		if(total[i].numSamples>0.0)
+			{
+			rs.rmsError=Math::sqrt(total[i].sumSqError/total[i].numSamples);
+			rs.score=total[i].numWithinTolerance*100.0/total[i].numSamples;
+			}
+		else
+			rs.rmsError=rs.score=0.0;
+		}
+	newStatistics.computeTime=double(timer.setAndDiff());
+	statistics.postNewValue();
+	}
+
+void* DEMDeviation::deviationThreadMethod(void)
+	{
+	unsigned int lastInputFrameVersion=0;
+	while(true)
+		{
+		Kinect::FrameBuffer frame;
+		{
+		Threads::MutexCond::Lock inputLock(inputCond);
+		
+		/* Espere hasta que llegue un nuevo marco con un DEM activo o el programa se apague: */
+		while(runDeviationThread&&(lastInputFrameVersion==inputFrameVersion||inputDem==0))
+			inputCond.wait(inputLock);
+		
+		/* Salte si el programa se está cerrando: */
+		if(!runDeviationThread)
+			break;
+		
+		/* Trabaja en el nuevo marco con el DEM y la configuración actuales: */
+		frame=inputFrame;
+		lastInputFrameVersion=inputFrameVersion;
+		if(demChanged)
+			{
+			demGrid.swap(inputDemGrid);
+			for(int i=0;i<2;++i)
+				demSize[i]=inputDemSize[i];
+			demChanged=false;
+			}
+		PTransform dicToDemTransform=inputDemTransform*depthProjection;
+		const PTransform::Matrix& dtm=dicToDemTransform.getMatrix();
+		for(int i=0;i<4;++i)
+			for(int j=0;j<4;++j)
+				dicToDem[i*4+j]=double(dtm(i,j));
+		distScale=inputDistScale;
+		pixelArea=inputPixelArea;
+		tolerance=inputTolerance;
+		for(int i=0;i<2;++i)
+			numRegions[i]=inputNumRegions[i];
+		}
+		
+		/* Calcule las estadísticas de desviación: */
+		frameData=frame.getData<float>();
+		processFrame();
+		frameData=0;
+		}
+	
+	return 0;
+	}
+
+DEMDeviation::DEMDeviation(const unsigned int sSize[2],const PTransform& sDepthProjection,unsigned int sNumThreads,unsigned int sSampleStep)
+	:depthProjection(sDepthProjection),
+	 sampleStep(sSampleStep>0?sSampleStep:1),
+	 frameData(0),
+	 distScale(1.0),pixelArea(1.0),tolerance(1.0),
+	 inputFrameVersion(0),
+	 inputDem(0),inputDemVersion(0),
+	 inputDistScale(1.0),inputPixelArea(1.0),
+	 demChanged(false),
+	 inputTolerance(1.0),
+	 runDeviationThread(false),
+	 taskPool(sNumThreads),
+	 statisticsVersion(0)
+	{
+	/* Copie el tamaño del marco y divida las filas de muestras en bandas para los hilos: */
+	for(int i=0;i<2;++i)
+		{
+		size[i]=sSize[i];
+		demSize[i]=inputDemSize[i]=0;
+		numRegions[i]=inputNumRegions[i]=1;
+		}
+	bandSize=16;
+	unsigned int numSampleRows=(size[1]+sampleStep-1)/sampleStep;
+	numBands=(numSampleRows+bandSize-1)/bandSize;
+	for(int i=0;i<16;++i)
+		dicToDem[i]=0.0;
+	
+	/* Inicie el hilo de cálculo: */
+	runDeviationThread=true;
+	deviationThread.start(this,&DEMDeviation::deviationThreadMethod);
+	}
+
+DEMDeviation::~DEMDeviation(void)
+	{
+	/* Apague el hilo de cálculo antes de que se destruya el conjunto de hilos de trabajo: */
+	{
+	Threads::MutexCond::Lock inputLock(inputCond);
+	runDeviationThread=false;
+	inputCond.signal();
+	}
+	deviationThread.join();
+	}
+
+void DEMDeviation::setTolerance(double newTolerance)
+	{
+	Threads::MutexCond::Lock inputLock(inputCond);
+	inputTolerance=newTolerance;
+	}
+
+void DEMDeviation::setNumRegions(const unsigned int newNumRegions[2])
+	{
+	Threads::MutexCond::Lock inputLock(inputCond);
+	for(int i=0;i<2;++i)
+		inputNumRegions[i]=newNumRegions[i]>0?newNumRegions[i]:1;
+	}
+
+void DEMDeviation::setDem(const DEM* newDem)
+	{
+	/* Copie la matriz DEM fuera del bloqueo si cambió desde la última llamada: */
+	std::vector<float> newDemGrid;
+	bool newGrid=false;
+	if(newDem!=0&&(newDem!=inputDem||newDem->getDemVersion()!=inputDemVersion))
+		{
+		const int* newDemSize=newDem->getDemSize();
+		const float* newDemData=newDem->getDemData();
+		newDemGrid.assign(newDemData,newDemData+newDemSize[1]*newDemSize[0]);
+		newGrid=true;
+		}
+	
+	Threads::MutexCond::Lock inputLock(inputCond);
+	
+	/* Almacene el DEM y su transformación actual: */
+	bool hadDem=inputDem!=0;
+	inputDem=newDem;
+	if(newDem==0)
+		return;
+	if(newGrid)
+		{
+		inputDemGrid.swap(newDemGrid);
+		for(int i=0;i<2;++i)
+			inputDemSize[i]=newDem->getDemSize()[i];
+		inputDemVersion=newDem->getDemVersion();
+		demChanged=true;
+		}
+	inputDemTransform=newDem->getDemTransform();
+	inputDistScale=double(newDem->getDistanceScale());
+	inputPixelArea=double(newDem->getPixelArea());
+	
+	/* Despierte el hilo de fondo si esperaba un DEM: */
+	if(!hadDem)
+		inputCond.signal();
+	}
+
+void DEMDeviation::receiveFilteredFrame(const Kinect::FrameBuffer& newFrame)
+	{
+	Threads::MutexCond::Lock inputLock(inputCond);
+	
+	/* Almacene el nuevo búfer en el búfer de entrada: */
+	inputFrame=newFrame;
+	++inputFrameVersion;
+	
+	/* Señale el hilo de fondo: */
+	inputCond.signal();
+	}
+
+bool DEMDeviation::lockNewStatistics(void)
+	{
+	/* Bloquee las estadísticas más recientes: */
+	bool result=statistics.lockNewValue();
+	if(result)
+		++statisticsVersion;
+	return result;
+	}
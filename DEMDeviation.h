@@ -0,0 +1,167 @@
+/***********************************************************************
+DEMDeviation - Clase para calcular en hilos de fondo estadísticas de la
+desviación entre la superficie de arena y el DEM activo: error medio
+cuadrático, volúmenes de corte y relleno, y puntuaciones por regiones.
+Copyright (c) 2012-2016 Oliver Kreylos
+Copyright (c) 2026 Sergio081096
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#ifndef DEMDEVIATION_INCLUDED
+#define DEMDEVIATION_INCLUDED
+
+#include <vector>
+#include <Threads/MutexCond.h>
+#include <Threads/Thread.h>
+#include <Threads/TripleBuffer.h>
+#include <Kinect/FrameBuffer.h>
+
+#include "Types.h"
+#include "TaskPool.h"
+
+/* Declaraciones de reenvío: */
+class DEM;
+
+class DEMDeviation:private TaskPool::Tasks
+	{
+	/* Clases integradas: */
+	public:
+	struct RegionStatistics // Estructura para las estadísticas de una región del DEM
+		{
+		/* Elementos: */
+		public:
+		unsigned int numSamples; // Número de muestras de la superficie sobre la región
+		double rmsError; // Error medio cuadrático en cm
+		double score; // Porcentaje de muestras dentro de la tolerancia
+		};
+	
+	struct Statistics // Estructura para las estadísticas de desviación de un marco
+		{
+		/* Elementos: */
+		public:
+		unsigned int numSamples; // Número de muestras de la superficie sobre el DEM
+		double meanError; // Desviación media con signo en cm; positiva si la arena está por encima del DEM
+		double rmsError; // Error medio cuadrático en cm
+		double cutVolume; // Volumen de arena por encima del DEM en cm^3
+		double fillVolume; // Volumen que falta por debajo del DEM en cm^3
+		double score; // Porcentaje de muestras dentro de la tolerancia
+		unsigned int numRegions[2]; // Número de regiones del DEM en x e y
+		std::vector<RegionStatistics> regions; // Estadísticas de cada región, desde la fila inferior
+		double computeTime; // Tiempo de cálculo del marco en segundos
+		
+		/* Constructores y destructores: */
+		Statistics(void)
+			:numSamples(0),meanError(0.0),rmsError(0.0),cutVolume(0.0),fillVolume(0.0),score(0.0),computeTime(0.0)
+			{
+			numRegions[0]=numRegions[1]=0;
+			}
+		};
+	
+	private:
+	struct Accumulator // Estructura para las sumas parciales de una banda de filas
+		{
+		/* Elementos: */
+		public:
+		double numSamples; // Número de muestras
+		double numWithinTolerance; // Número de muestras dentro de la tolerancia
+		double sumError; // Suma de las desviaciones
+		double sumSqError; // Suma de los cuadrados de las desviaciones
+		double cutVolume; // Volumen por encima del DEM
+		double fillVolume; // Volumen por debajo del DEM
+		
+		/* Métodos: */
+		void reset(void)
+			{
+			numSamples=numWithinTolerance=sumError=sumSqError=cutVolume=fillVolume=0.0;
+			}
+		};
+	
+	/* Elementos: */
+	unsigned int size[2]; // Ancho y alto de los marcos de profundidad
+	PTransform depthProjection; // Matriz de proyección desde el espacio de imagen de profundidad al espacio de la cámara
+	unsigned int sampleStep; // Distancia entre las muestras evaluadas en píxeles del marco
+	unsigned int bandSize; // Número de filas de muestras por tarea
+	unsigned int numBands; // Número de bandas de filas
+	
+	/* Estado del cálculo, solo usado por los hilos de fondo: */
+	const float* frameData; // Marco de profundidad que se está procesando
+	double dicToDem[16]; // Matriz de transformación del espacio de imagen de profundidad al espacio de píxeles DEM, por filas
+	std::vector<float> demGrid; // Copia de la matriz DEM
+	int demSize[2]; // Ancho y alto de la matriz DEM
+	double distScale; // Factor de escala de las distancias en el espacio de píxeles DEM a cm
+	double pixelArea; // Área de un píxel DEM en cm^2
+	double tolerance; // Desviación máxima en cm para que una muestra cuente como correcta
+	unsigned int numRegions[2]; // Número de regiones en x e y
+	std::vector<Accumulator> accumulators; // Sumas parciales de cada banda; la primera de cada banda es global, las demás por región
+	
+	/* Estado del hilo de cálculo: */
+	Threads::MutexCond inputCond; // Variable de condición para señalar la llegada de un nuevo marco de entrada o de un nuevo DEM
+	Kinect::FrameBuffer inputFrame; // El marco de entrada más reciente
+	unsigned int inputFrameVersion; // Número de versión del marco de entrada
+	const DEM* inputDem; // DEM cuya matriz se copió, o nulo si no hay DEM activo
+	unsigned int inputDemVersion; // Número de versión de la matriz del DEM copiada
+	std::vector<float> inputDemGrid; // Copia de la matriz DEM más reciente
+	int inputDemSize[2]; // Ancho y alto de la matriz DEM más reciente
+	PTransform inputDemTransform; // Transformación del espacio de la cámara al espacio de píxeles DEM más reciente
+	double inputDistScale; // Factor de escala de las distancias más reciente
+	double inputPixelArea; // Área de un píxel DEM más reciente
+	bool demChanged; // Marcar si la matriz DEM cambió desde el último cálculo
+	double inputTolerance; // Tolerancia solicitada en cm
+	unsigned int inputNumRegions[2]; // Número de regiones solicitado
+	volatile bool runDeviationThread; // Marcar para mantener en ejecución el hilo de cálculo de fondo
+	Threads::Thread deviationThread; // El hilo de cálculo de fondo
+	
+	/* Estado de los hilos de trabajo: */
+	TaskPool taskPool; // Conjunto de hilos que procesa las bandas de cada marco
+	
+	/* Estado de salida: */
+	Threads::TripleBuffer<Statistics> statistics; // Triple buffer de estadísticas de desviación
+	unsigned int statisticsVersion; // Número de versión de las estadísticas bloqueadas
+	
+	/* Métodos privados: */
+	void processBand(unsigned int bandIndex); // Acumula las desviaciones de una banda de filas
+	virtual void processTask(unsigned int task); // Procesa una banda del paso paralelo actual
+	void processFrame(void); // Calcula y publica las estadísticas del marco de entrada actual
+	void* deviationThreadMethod(void); // Método para el hilo de cálculo de fondo
+	
+	/* Constructores y destructores: */
+	public:
+	DEMDeviation(const unsigned int sSize[2],const PTransform& sDepthProjection,unsigned int sNumThreads=2,unsigned int sSampleStep=3); // Crea un calculador de desviaciones para marcos de profundidad filtrados del tamaño dado
+	private:
+	DEMDeviation(const DEMDeviation& source); // Prohibir copia constructor
+	DEMDeviation& operator=(const DEMDeviation& source); // Prohibir operador de asignación
+	public:
+	~DEMDeviation(void);
+	
+	/* Métodos: */
+	void setTolerance(double newTolerance); // Establece la desviación máxima en cm para que una muestra cuente como correcta
+	void setNumRegions(const unsigned int newNumRegions[2]); // Establece el número de regiones del DEM en x e y
+	void setDem(const DEM* newDem); // Establece el DEM con el que se compara la superficie; copia la matriz DEM si cambió
+	void receiveFilteredFrame(const Kinect::FrameBuffer& newFrame); // Llamado para recibir un nuevo marco de profundidad filtrado
+	bool lockNewStatistics(void); // Bloquea las estadísticas más recientes; devuelve verdadero si son nuevas
+	unsigned int getStatisticsVersion(void) const // Devuelve el número de versión de las estadísticas bloqueadas
+		{
+		return statisticsVersion;
+		}
+	const Statistics& getStatistics(void) const // Devuelve las estadísticas bloqueadas
+		{
+		return statistics.getLockedValue();
+		}
+	};
+
+#endif
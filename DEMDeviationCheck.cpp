@@ -0,0 +1,123 @@
+/***********************************************************************
+DEMDeviationCheck - Utilidad que comprueba el calculador de desviaciones
+respecto al DEM con un DEM sintético inclinado y una superficie de arena
+desplazada una distancia conocida, bajo una transformación DEM escalada y
+una exageración vertical.
+Copyright (c) 2026 Sergio081096
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <math.h>
+#include <vector>
+#include <iostream>
+#include <stdexcept>
+#include <IO/File.h>
+#include <IO/OpenFile.h>
+#include <Kinect/FrameBuffer.h>
+
+#include "Types.h"
+#include "DEM.h"
+#include "DEMDeviation.h"
+
+namespace {
+
+/****************
+Helper functions:
+****************/
+
+bool check(const char* name,double value,double expected,double tolerance)
+	{
+	bool ok=fabs(value-expected)<=tolerance;
+	std::cout<<name<<' '<<value<<" (expected "<<expected<<") "<<(ok?"ok":"FAILED")<<std::endl;
+	return ok;
+	}
+
+}
+
+int main(int argc,char* argv[])
+	{
+	/* Parámetros del escenario: un marco de 64x48 píxeles de 1cm, un DEM 2.5 veces más grande con exageración vertical 3 y arena 1.5cm por encima: */
+	const unsigned int frameSize[2]={64,48};
+	const int demSize[2]={33,25};
+	Scalar scale=2.5;
+	Scalar verticalScale=3.0;
+	Scalar baseElevation=10.0;
+	Scalar slope=0.2;
+	double offset=1.5;
+	
+	try
+		{
+		/* Escriba un DEM sintético que cubre exactamente el marco y sube linealmente hacia el este: */
+		const char* demFileName="DEMDeviationCheck.grid";
+		{
+		IO::FilePtr demFile=IO::openFile(demFileName,IO::File::WriteOnly);
+		demFile->setEndianness(Misc::LittleEndian);
+		demFile->write<int>(demSize,2);
+		float demBox[4]={0.0f,0.0f,float(scale*frameSize[0]),float(scale*frameSize[1])};
+		demFile->write<float>(demBox,4);
+		for(int y=0;y<demSize[1];++y)
+			for(int x=0;x<demSize[0];++x)
+				demFile->write<float>(float(baseElevation+slope*double(x)*double(demBox[2])/double(demSize[0]-1)));
+		}
+		
+		/* Cargue el DEM y espere a que el hilo de carga termine: */
+		DEM dem;
+		dem.load(demFileName);
+		while(!dem.update())
+			usleep(1000);
+		unlink(demFileName);
+		dem.setTransform(OGTransform::scale(scale),verticalScale,baseElevation);
+		
+		/* Cree un marco cuya proyección de profundidad es la identidad, con la arena desplazada sobre el DEM exagerado: */
+		DEMDeviation deviation(frameSize,PTransform::identity,2,1);
+		deviation.setTolerance(2.0);
+		deviation.setDem(&dem);
+		Kinect::FrameBuffer frame(frameSize[0],frameSize[1],frameSize[1]*frameSize[0]*sizeof(float));
+		float* fPtr=frame.getData<float>();
+		for(unsigned int y=0;y<frameSize[1];++y)
+			for(unsigned int x=0;x<frameSize[0];++x,++fPtr)
+				{
+				double demElevation=baseElevation+slope*(double(x)+0.5)*scale;
+				double displayElevation=baseElevation+verticalScale*(demElevation-baseElevation);
+				*fPtr=float(displayElevation/scale+offset);
+				}
+		deviation.receiveFilteredFrame(frame);
+		while(!deviation.lockNewStatistics())
+			usleep(1000);
+		
+		/* Compare las estadísticas con el desplazamiento conocido: */
+		const DEMDeviation::Statistics& stats=deviation.getStatistics();
+		double area=double(frameSize[0])*double(frameSize[1]);
+		bool ok=true;
+		ok=check("Samples",stats.numSamples,area,0.0)&&ok;
+		ok=check("Mean error (cm)",stats.meanError,offset,1.0e-4)&&ok;
+		ok=check("RMS error (cm)",stats.rmsError,offset,1.0e-4)&&ok;
+		ok=check("Cut volume (cm^3)",stats.cutVolume,offset*area,1.0e-2)&&ok;
+		ok=check("Fill volume (cm^3)",stats.fillVolume,0.0,1.0e-2)&&ok;
+		ok=check("Score (%)",stats.score,100.0,0.0)&&ok;
+		
+		return ok?0:1;
+		}
+	catch(const std::runtime_error& err)
+		{
+		std::cerr<<"Caught exception "<<err.what()<<std::endl;
+		return 1;
+		}
+	}
@@ -0,0 +1,979 @@
+/***********************************************************************
+DEMImporter - Funciones para importar modelos de elevación digital desde
+archivos GeoTIFF y de cuadrícula ASCII de ESRI, decodificándolos con
+varios hilos y guardando el resultado como archivo de cuadrícula DEM en
+una caché indexada por el hash del archivo de origen.
+Copyright (c) 2026 Sergio081096
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include "DEMImporter.h"
+
+#include <endian.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <utility>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <zlib.h>
+#include <Misc/SizedTypes.h>
+#include <Misc/ThrowStdErr.h>
+#include <IO/File.h>
+#include <IO/OpenFile.h>
+
+#include "TaskPool.h"
+
+namespace {
+
+/**************
+Helper classes:
+**************/
+
+class MappedFile // Clase para un archivo de origen mapeado en memoria de solo lectura
+	{
+	/* Elementos: */
+	public:
+	const unsigned char* data; // Contenido del archivo
+	size_t size; // Tamaño del archivo en bytes
+	
+	/* Constructores y destructores: */
+	MappedFile(const char* fileName)
+		:data(0),size(0)
+		{
+		int fd=open(fileName,O_RDONLY);
+		if(fd<0)
+			Misc::throwStdErr("DEMImporter: Unable to open file %s due to error %d (%s)",fileName,errno,strerror(errno));
+		struct stat fileStats;
+		if(fstat(fd,&fileStats)<0||fileStats.st_size==0)
+			{
+			close(fd);
+			Misc::throwStdErr("DEMImporter: File %s is empty",fileName);
+			}
+		size=size_t(fileStats.st_size);
+		void* map=mmap(0,size,PROT_READ,MAP_SHARED,fd,0);
+		int error=errno;
+		close(fd);
+		if(map==MAP_FAILED)
+			Misc::throwStdErr("DEMImporter: Unable to map file %s due to error %d (%s)",fileName,error,strerror(error));
+		data=static_cast<const unsigned char*>(map);
+		}
+	private:
+	MappedFile(const MappedFile& source); // Prohibir copia constructor
+	MappedFile& operator=(const MappedFile& source); // Prohibir operador de asignación
+	public:
+	~MappedFile(void)
+		{
+		munmap(const_cast<unsigned char*>(data),size);
+		}
+	};
+
+struct Grid // Estructura para una cuadrícula DEM importada
+	{
+	/* Elementos: */
+	public:
+	unsigned int size[2]; // Ancho y alto de la cuadrícula
+	double box[4]; // Coordenadas de las muestras de las esquinas inferior izquierda y superior derecha
+	std::vector<float> samples; // Muestras de elevación, de la fila inferior a la superior
+	bool haveNoData; // Marcar si el archivo de origen define un valor para muestras sin datos
+	double noData; // Valor de las muestras sin datos
+	
+	/* Constructores y destructores: */
+	Grid(void)
+		:haveNoData(false),noData(0.0)
+		{
+		size[0]=size[1]=0;
+		}
+	};
+
+/****************
+Helper functions:
+****************/
+
+const Misc::UInt64 importerVersion=1; // Versión del importador, incluida en las claves de la caché para invalidar conversiones anteriores
+const size_t hashChunkSize=size_t(1)<<20; // Tamaño de los bloques del archivo de origen cuyo hash se calcula en paralelo
+
+inline Misc::UInt64 hashBytes(Misc::UInt64 hash,const void* data,size_t size) // Acumula los bytes dados en un hash FNV-1a de 64 bits
+	{
+	const unsigned char* dPtr=static_cast<const unsigned char*>(data);
+	for(size_t i=0;i<size;++i,++dPtr)
+		{
+		hash^=Misc::UInt64(*dPtr);
+		hash*=0x100000001b3ULL;
+		}
+	return hash;
+	}
+
+class HashTasks:public TaskPool::Tasks // Clase para calcular en paralelo los hashes de los bloques de un archivo
+	{
+	/* Elementos: */
+	private:
+	const MappedFile& file; // El archivo de origen
+	public:
+	std::vector<Misc::UInt64> hashes; // Hash de cada bloque
+	
+	/* Métodos protegidos: */
+	protected:
+	virtual void processTask(unsigned int task)
+		{
+		size_t begin=size_t(task)*hashChunkSize;
+		size_t end=begin+hashChunkSize<file.size?begin+hashChunkSize:file.size;
+		hashes[task]=hashBytes(0xcbf29ce484222325ULL,file.data+begin,end-begin);
+		}
+	
+	/* Constructores y destructores: */
+	public:
+	HashTasks(const MappedFile& sFile)
+		:file(sFile),
+		 hashes((file.size+hashChunkSize-1)/hashChunkSize)
+		{
+		}
+	};
+
+Misc::UInt64 hashFile(const MappedFile& file,TaskPool& taskPool) // Devuelve un hash del contenido del archivo dado
+	{
+	/* Calcule el hash de cada bloque y combine los hashes de los bloques: */
+	HashTasks hashTasks(file);
+	taskPool.run(hashTasks,(unsigned int)(hashTasks.hashes.size()));
+	Misc::UInt64 hash=hashBytes(0xcbf29ce484222325ULL,&importerVersion,sizeof(Misc::UInt64));
+	Misc::UInt64 fileSize=Misc::UInt64(file.size);
+	hash=hashBytes(hash,&fileSize,sizeof(Misc::UInt64));
+	return hashBytes(hash,&hashTasks.hashes[0],hashTasks.hashes.size()*sizeof(Misc::UInt64));
+	}
+
+std::string getTempFileName(const std::string& fileName) // Devuelve un nombre de archivo temporal junto al archivo dado, único entre procesos e hilos
+	{
+	static unsigned int tempFileCounter=0;
+	char suffix[40];
+	snprintf(suffix,sizeof(suffix),".%d.%u.tmp",int(getpid()),__atomic_fetch_add(&tempFileCounter,1U,__ATOMIC_RELAXED));
+	return fileName+suffix;
+	}
+
+bool createDirectories(const std::string& path) // Crea el directorio dado y todos sus directorios padre que falten
+	{
+	for(std::string::size_type slash=path.find('/',1);;slash=path.find('/',slash+1))
+		{
+		std::string prefix=path.substr(0,slash);
+		if(mkdir(prefix.c_str(),0755)!=0&&errno!=EEXIST)
+			return false;
+		if(slash==std::string::npos)
+			break;
+		}
+	return true;
+	}
+
+bool hasExtension(const char* fileName,const char* extension) // Devuelve verdadero si el nombre de archivo dado termina con la extensión dada, sin distinguir mayúsculas
+	{
+	size_t fileNameLen=strlen(fileName);
+	size_t extensionLen=strlen(extension);
+	return fileNameLen>extensionLen&&strcasecmp(fileName+fileNameLen-extensionLen,extension)==0;
+	}
+
+/***********************************************************************
+Decodificación de archivos GeoTIFF clásicos (no BigTIFF) con una banda
+de muestras enteras o de punto flotante, en tiras o en mosaicos, sin
+comprimir o comprimidos con deflate, con o sin predictor horizontal o de
+punto flotante. Cada tira o mosaico se decodifica en una tarea paralela.
+***********************************************************************/
+
+struct TiffEntry // Estructura para una entrada de un directorio de archivo de imagen TIFF
+	{
+	/* Elementos: */
+	public:
+	unsigned int type; // Tipo de los valores
+	size_t count; // Número de valores
+	size_t offset; // Posición de los valores en el archivo
+	};
+
+class TiffFile // Clase para leer valores de un archivo TIFF mapeado en memoria
+	{
+	/* Elementos: */
+	private:
+	const MappedFile& file; // El archivo
+	bool swap; // Marcar si el orden de bytes del archivo difiere del orden del anfitrión
+	std::vector<std::pair<unsigned int,TiffEntry> > entries; // Entradas del primer directorio de imagen
+	
+	/* Métodos privados: */
+	static size_t getTypeSize(unsigned int type) // Devuelve el tamaño de un valor del tipo dado en bytes
+		{
+		switch(type)
+			{
+			case 1: case 2: case 6: case 7:
+				return 1;
+			
+			case 3: case 8:
+				return 2;
+			
+			case 4: case 9: case 11:
+				return 4;
+			
+			case 5: case 10: case 12: case 16: case 17:
+				return 8;
+			
+			default:
+				return 0;
+			}
+		}
+	void check(size_t offset,size_t size) const // Lanza una excepción si el rango dado no está dentro del archivo
+		{
+		if(offset>file.size||size>file.size-offset)
+			Misc::throwStdErr("DEMImporter: TIFF file is truncated");
+		}
+	
+	/* Constructores y destructores: */
+	public:
+	TiffFile(const MappedFile& sFile)
+		:file(sFile),swap(false)
+		{
+		/* Lea el encabezado del archivo: */
+		check(0,8);
+		bool fileLittleEndian;
+		if(file.data[0]=='I'&&file.data[1]=='I')
+			fileLittleEndian=true;
+		else if(file.data[0]=='M'&&file.data[1]=='M')
+			fileLittleEndian=false;
+		else
+			Misc::throwStdErr("DEMImporter: File is not a TIFF file");
+		#if __BYTE_ORDER==__LITTLE_ENDIAN
+		swap=!fileLittleEndian;
+		#else
+		swap=fileLittleEndian;
+		#endif
+		unsigned int magic=get16(2);
+		if(magic==43)
+			Misc::throwStdErr("DEMImporter: BigTIFF files are not supported");
+		if(magic!=42)
+			Misc::throwStdErr("DEMImporter: File is not a TIFF file");
+		
+		/* Lea las entradas del primer directorio de imagen: */
+		size_t ifdOffset=get32(4);
+		check(ifdOffset,2);
+		unsigned int numEntries=get16(ifdOffset);
+		check(ifdOffset+2,size_t(numEntries)*12);
+		for(unsigned int i=0;i<numEntries;++i)
+			{
+			size_t entryOffset=ifdOffset+2+size_t(i)*12;
+			TiffEntry entry;
+			entry.type=get16(entryOffset+2);
+			entry.count=get32(entryOffset+4);
+			size_t typeSize=getTypeSize(entry.type);
+			if(typeSize==0)
+				continue;
+			if(entry.count*typeSize<=4)
+				entry.offset=entryOffset+8;
+			else
+				entry.offset=get32(entryOffset+8);
+			check(entry.offset,entry.count*typeSize);
+			entries.push_back(std::make_pair(get16(entryOffset),entry));
+			}
+		}
+	
+	/* Métodos: */
+	bool getSwap(void) const // Devuelve verdadero si el orden de bytes del archivo difiere del orden del anfitrión
+		{
+		return swap;
+		}
+	void swapBytes(unsigned char* data,size_t size) const // Invierte el orden de los bytes dados
+		{
+		for(size_t i=0;i<size/2;++i)
+			std::swap(data[i],data[size-1-i]);
+		}
+	template <class ValueParam>
+	ValueParam get(size_t offset) const // Lee un valor del tipo dado en la posición dada
+		{
+		unsigned char buffer[sizeof(ValueParam)];
+		memcpy(buffer,file.data+offset,sizeof(ValueParam));
+		if(swap)
+			swapBytes(buffer,sizeof(ValueParam));
+		ValueParam result;
+		memcpy(&result,buffer,sizeof(ValueParam));
+		return result;
+		}
+	unsigned int get16(size_t offset) const
+		{
+		return get<Misc::UInt16>(offset);
+		}
+	size_t get32(size_t offset) const
+		{
+		return get<Misc::UInt32>(offset);
+		}
+	const TiffEntry* find(unsigned int tag) const // Devuelve la entrada con la etiqueta dada, o nulo
+		{
+		for(std::vector<std::pair<unsigned int,TiffEntry> >::const_iterator eIt=entries.begin();eIt!=entries.end();++eIt)
+			if(eIt->first==tag)
+				return &eIt->second;
+		return 0;
+		}
+	bool getValues(unsigned int tag,std::vector<double>& values) const // Lee los valores numéricos de la entrada con la etiqueta dada; devuelve falso si no existe
+		{
+		const TiffEntry* entry=find(tag);
+		if(entry==0)
+			return false;
+		values.resize(entry->count);
+		size_t typeSize=getTypeSize(entry->type);
+		for(size_t i=0;i<entry->count;++i)
+			{
+			size_t offset=entry->offset+i*typeSize;
+			switch(entry->type)
+				{
+				case 1: case 7:
+					values[i]=double(file.data[offset]);
+					break;
+				
+				case 6:
+					values[i]=double(Misc::SInt8(file.data[offset]));
+					break;
+				
+				case 3:
+					values[i]=double(get<Misc::UInt16>(offset));
+					break;
+				
+				case 8:
+					values[i]=double(get<Misc::SInt16>(offset));
+					break;
+				
+				case 4:
+					values[i]=double(get<Misc::UInt32>(offset));
+					break;
+				
+				case 9:
+					values[i]=double(get<Misc::SInt32>(offset));
+					break;
+				
+				case 5:
+					values[i]=double(get<Misc::UInt32>(offset))/double(get<Misc::UInt32>(offset+4));
+					break;
+				
+				case 10:
+					values[i]=double(get<Misc::SInt32>(offset))/double(get<Misc::SInt32>(offset+4));
+					break;
+				
+				case 11:
+					values[i]=double(get<Misc::Float32>(offset));
+					break;
+				
+				case 12:
+					values[i]=get<Misc::Float64>(offset);
+					break;
+				
+				case 16:
+					values[i]=double(get<Misc::UInt64>(offset));
+					break;
+				
+				case 17:
+					values[i]=double(get<Misc::SInt64>(offset));
+					break;
+				
+				default:
+					values[i]=0.0;
+				}
+			}
+		return true;
+		}
+	double getValue(unsigned int tag,double defaultValue) const // Devuelve el primer valor de la entrada con la etiqueta dada, o el valor predeterminado
+		{
+		std::vector<double> values;
+		return getValues(tag,values)&&!values.empty()?values[0]:defaultValue;
+		}
+	bool getString(unsigned int tag,std::string& string) const // Lee la cadena de la entrada con la etiqueta dada; devuelve falso si no existe
+		{
+		const TiffEntry* entry=find(tag);
+		if(entry==0||entry->type!=2)
+			return false;
+		const char* sPtr=reinterpret_cast<const char*>(file.data+entry->offset);
+		string.assign(sPtr,strnlen(sPtr,entry->count));
+		return true;
+		}
+	};
+
+class TiffChunkTasks:public TaskPool::Tasks // Clase para decodificar en paralelo las tiras o mosaicos de un archivo TIFF
+	{
+	/* Elementos: */
+	public:
+	const MappedFile& file; // El archivo TIFF
+	const TiffFile& tiff; // El lector de valores del archivo TIFF
+	Grid& grid; // La cuadrícula de destino
+	unsigned int compression; // Esquema de compresión; 1 sin comprimir, 8 o 32946 deflate
+	unsigned int predictor; // Predictor; 1 ninguno, 2 horizontal, 3 de punto flotante
+	unsigned int sampleFormat; // Formato de las muestras; 1 entero sin signo, 2 entero con signo, 3 punto flotante
+	unsigned int bytesPerSample; // Tamaño de una muestra en bytes
+	unsigned int samplesPerPixel; // Número de muestras intercaladas por píxel
+	unsigned int chunkSize[2]; // Ancho y alto de una tira o mosaico
+	bool tiled; // Marcar si la imagen está dividida en mosaicos en lugar de tiras
+	unsigned int chunksAcross; // Número de tiras o mosaicos por fila de la imagen
+	std::vector<double> chunkOffsets; // Posiciones de las tiras o mosaicos en el archivo
+	std::vector<double> chunkByteCounts; // Tamaños de las tiras o mosaicos en el archivo
+	
+	/* Métodos privados: */
+	private:
+	float getSample(const unsigned char* sPtr) const // Convierte una muestra en orden de bytes del anfitrión a flotante
+		{
+		union
+			{
+			Misc::UInt8 u8;
+			Misc::SInt8 s8;
+			Misc::UInt16 u16;
+			Misc::SInt16 s16;
+			Misc::UInt32 u32;
+			Misc::SInt32 s32;
+			Misc::Float32 f32;
+			Misc::Float64 f64;
+			} value;
+		memcpy(&value,sPtr,bytesPerSample);
+		switch(sampleFormat*16+bytesPerSample)
+			{
+			case 0x11:
+				return float(value.u8);
+			
+			case 0x12:
+				return float(value.u16);
+			
+			case 0x14:
+				return float(value.u32);
+			
+			case 0x21:
+				return float(value.s8);
+			
+			case 0x22:
+				return float(value.s16);
+			
+			case 0x24:
+				return float(value.s32);
+			
+			case 0x34:
+				return value.f32;
+			
+			case 0x38:
+				return float(value.f64);
+			
+			default:
+				return 0.0f;
+			}
+		}
+	template <class IntParam>
+	static void accumulateRow(unsigned char* row,unsigned int numValues,unsigned int stride) // Deshace el predictor horizontal en una fila de enteros
+		{
+		IntParam* rPtr=reinterpret_cast<IntParam*>(row);
+		for(unsigned int i=stride;i<numValues;++i)
+			rPtr[i]=IntParam(rPtr[i]+rPtr[i-stride]);
+		}
+	
+	/* Métodos protegidos: */
+	protected:
+	virtual void processTask(unsigned int task)
+		{
+		/* Calcule la posición y el tamaño de la tira o mosaico: */
+		unsigned int x0=(task%chunksAcross)*chunkSize[0];
+		unsigned int y0=(task/chunksAcross)*chunkSize[1];
+		unsigned int numRows=chunkSize[1];
+		if(!tiled&&y0+numRows>grid.size[1])
+			numRows=grid.size[1]-y0;
+		size_t rowSize=size_t(chunkSize[0])*size_t(samplesPerPixel)*size_t(bytesPerSample);
+		size_t chunkDataSize=rowSize*size_t(numRows);
+		
+		/* Lea o descomprima los datos de la tira o mosaico: */
+		size_t offset=size_t(chunkOffsets[task]);
+		size_t byteCount=size_t(chunkByteCounts[task]);
+		if(offset>file.size||byteCount>file.size-offset)
+			Misc::throwStdErr("DEMImporter: TIFF file is truncated");
+		std::vector<unsigned char> chunk(chunkDataSize);
+		if(compression==1)
+			{
+			if(byteCount<chunkDataSize)
+				Misc::throwStdErr("DEMImporter: TIFF strip or tile %u is truncated",task);
+			memcpy(&chunk[0],file.data+offset,chunkDataSize);
+			}
+		else
+			{
+			uLongf uncompressedSize=uLongf(chunkDataSize);
+			if(uncompress(&chunk[0],&uncompressedSize,file.data+offset,uLong(byteCount))!=Z_OK||uncompressedSize!=uLongf(chunkDataSize))
+				Misc::throwStdErr("DEMImporter: Unable to decompress TIFF strip or tile %u",task);
+			}
+		
+		/* Convierta las muestras al orden de bytes del anfitrión y deshaga el predictor: */
+		unsigned int rowValues=chunkSize[0]*samplesPerPixel;
+		if(predictor==3)
+			{
+			/* Sume las diferencias de bytes y reordene los planos de bytes, del más significativo al menos significativo, en muestras: */
+			std::vector<unsigned char> rowBuffer(rowSize);
+			for(unsigned int row=0;row<numRows;++row)
+				{
+				unsigned char* rPtr=&chunk[row*rowSize];
+				for(size_t i=samplesPerPixel;i<rowSize;++i)
+					rPtr[i]=(unsigned char)(rPtr[i]+rPtr[i-samplesPerPixel]);
+				for(unsigned int i=0;i<rowValues;++i)
+					for(unsigned int b=0;b<bytesPerSample;++b)
+						{
+						#if __BYTE_ORDER==__LITTLE_ENDIAN
+						rowBuffer[i*bytesPerSample+b]=rPtr[(bytesPerSample-1-b)*rowValues+i];
+						#else
+						rowBuffer[i*bytesPerSample+b]=rPtr[b*rowValues+i];
+						#endif
+						}
+				memcpy(rPtr,&rowBuffer[0],rowSize);
+				}
+			}
+		else
+			{
+			if(tiff.getSwap()&&bytesPerSample>1)
+				for(size_t i=0;i<chunkDataSize;i+=bytesPerSample)
+					tiff.swapBytes(&chunk[i],bytesPerSample);
+			if(predictor==2)
+				for(unsigned int row=0;row<numRows;++row)
+					{
+					unsigned char* rPtr=&chunk[row*rowSize];
+					switch(bytesPerSample)
+						{
+						case 1:
+							accumulateRow<Misc::UInt8>(rPtr,rowValues,samplesPerPixel);
+							break;
+						
+						case 2:
+							accumulateRow<Misc::UInt16>(rPtr,rowValues,samplesPerPixel);
+							break;
+						
+						case 4:
+							accumulateRow<Misc::UInt32>(rPtr,rowValues,samplesPerPixel);
+							break;
+						
+						case 8:
+							accumulateRow<Misc::UInt64>(rPtr,rowValues,samplesPerPixel);
+							break;
+						}
+					}
+			}
+		
+		/* Copie la primera banda a la cuadrícula, volteando las filas para que la fila inferior sea la primera: */
+		for(unsigned int row=0;row<numRows&&y0+row<grid.size[1];++row)
+			{
+			const unsigned char* sPtr=&chunk[row*rowSize];
+			float* gridRow=&grid.samples[size_t(grid.size[1]-1-(y0+row))*size_t(grid.size[0])];
+			for(unsigned int x=0;x<chunkSize[0]&&x0+x<grid.size[0];++x,sPtr+=samplesPerPixel*bytesPerSample)
+				gridRow[x0+x]=getSample(sPtr);
+			}
+		}
+	
+	/* Constructores y destructores: */
+	public:
+	TiffChunkTasks(const MappedFile& sFile,const TiffFile& sTiff,Grid& sGrid)
+		:file(sFile),tiff(sTiff),grid(sGrid),
+		 tiled(false)
+		{
+		}
+	};
+
+void decodeGeoTIFF(const MappedFile& file,Grid& grid,TaskPool& taskPool) // Decodifica un archivo GeoTIFF en la cuadrícula dada
+	{
+	TiffFile tiff(file);
+	TiffChunkTasks tasks(file,tiff,grid);
+	
+	/* Lea el formato de la imagen: */
+	grid.size[0]=(unsigned int)(tiff.getValue(256,0.0));
+	grid.size[1]=(unsigned int)(tiff.getValue(257,0.0));
+	if(grid.size[0]==0||grid.size[1]==0)
+		Misc::throwStdErr("DEMImporter: TIFF file has no image size");
+	unsigned int bitsPerSample=(unsigned int)(tiff.getValue(258,1.0));
+	tasks.bytesPerSample=bitsPerSample/8;
+	tasks.sampleFormat=(unsigned int)(tiff.getValue(339,1.0));
+	tasks.samplesPerPixel=(unsigned int)(tiff.getValue(277,1.0));
+	tasks.compression=(unsigned int)(tiff.getValue(259,1.0));
+	tasks.predictor=(unsigned int)(tiff.getValue(317,1.0));
+	unsigned int planarConfig=(unsigned int)(tiff.getValue(284,1.0));
+	if(bitsPerSample%8!=0||tasks.samplesPerPixel<1||(tasks.sampleFormat!=1&&tasks.sampleFormat!=2&&tasks.sampleFormat!=3)
+	   ||(tasks.sampleFormat==3&&bitsPerSample!=32&&bitsPerSample!=64)||(tasks.sampleFormat!=3&&bitsPerSample!=8&&bitsPerSample!=16&&bitsPerSample!=32))
+		Misc::throwStdErr("DEMImporter: TIFF file has unsupported sample format %u with %u bits",tasks.sampleFormat,bitsPerSample);
+	if(tasks.compression!=1&&tasks.compression!=8&&tasks.compression!=32946)
+		Misc::throwStdErr("DEMImporter: TIFF file has unsupported compression %u",tasks.compression);
+	if(tasks.predictor<1||tasks.predictor>3||(tasks.predictor==3&&tasks.sampleFormat!=3))
+		Misc::throwStdErr("DEMImporter: TIFF file has unsupported predictor %u",tasks.predictor);
+	
+	/* Lea la disposición de las tiras o mosaicos: */
+	unsigned int numChunks;
+	tasks.tiled=tiff.find(322)!=0;
+	if(tasks.tiled)
+		{
+		tasks.chunkSize[0]=(unsigned int)(tiff.getValue(322,0.0));
+		tasks.chunkSize[1]=(unsigned int)(tiff.getValue(323,0.0));
+		if(tasks.chunkSize[0]==0||tasks.chunkSize[1]==0)
+			Misc::throwStdErr("DEMImporter: TIFF file has invalid tile size");
+		tasks.chunksAcross=(grid.size[0]+tasks.chunkSize[0]-1)/tasks.chunkSize[0];
+		numChunks=tasks.chunksAcross*((grid.size[1]+tasks.chunkSize[1]-1)/tasks.chunkSize[1]);
+		tiff.getValues(324,tasks.chunkOffsets);
+		tiff.getValues(325,tasks.chunkByteCounts);
+		}
+	else
+		{
+		tasks.chunkSize[0]=grid.size[0];
+		tasks.chunkSize[1]=(unsigned int)(tiff.getValue(278,double(grid.size[1])));
+		if(tasks.chunkSize[1]==0||tasks.chunkSize[1]>grid.size[1])
+			tasks.chunkSize[1]=grid.size[1];
+		tasks.chunksAcross=1;
+		numChunks=(grid.size[1]+tasks.chunkSize[1]-1)/tasks.chunkSize[1];
+		tiff.getValues(273,tasks.chunkOffsets);
+		tiff.getValues(279,tasks.chunkByteCounts);
+		}
+	
+	/* Con bandas separadas, las primeras tiras o mosaicos contienen la primera banda: */
+	if(planarConfig==2)
+		tasks.samplesPerPixel=1;
+	if(tasks.chunkOffsets.size()<numChunks||tasks.chunkByteCounts.size()<numChunks)
+		Misc::throwStdErr("DEMImporter: TIFF file is missing strip or tile offsets");
+	
+	/* Lea el valor sin datos de GDAL: */
+	std::string noData;
+	if(tiff.getString(42113,noData))
+		{
+		char* end;
+		grid.noData=strtod(noData.c_str(),&end);
+		grid.haveNoData=end!=noData.c_str();
+		}
+	
+	/* Lea la georreferenciación; las muestras representan áreas salvo que las claves GeoTIFF indiquen puntos: */
+	std::vector<double> pixelScale,tiepoint,geoKeys;
+	bool pixelIsPoint=false;
+	if(tiff.getValues(34735,geoKeys))
+		for(size_t i=4;i+3<geoKeys.size();i+=4)
+			if(geoKeys[i]==1025.0&&geoKeys[i+1]==0.0)
+				pixelIsPoint=geoKeys[i+3]==2.0;
+	double scale[2]={1.0,1.0};
+	double origin[2]={0.0,double(grid.size[1]-1)};
+	if(tiff.getValues(33550,pixelScale)&&pixelScale.size()>=2&&tiff.getValues(33922,tiepoint)&&tiepoint.size()>=6)
+		{
+		scale[0]=pixelScale[0];
+		scale[1]=pixelScale[1];
+		double offset=pixelIsPoint?0.0:0.5;
+		origin[0]=tiepoint[3]+(offset-tiepoint[0])*scale[0];
+		origin[1]=tiepoint[4]-(offset-tiepoint[1])*scale[1];
+		}
+	grid.box[0]=origin[0];
+	grid.box[1]=origin[1]-double(grid.size[1]-1)*scale[1];
+	grid.box[2]=origin[0]+double(grid.size[0]-1)*scale[0];
+	grid.box[3]=origin[1];
+	
+	/* Decodifique las tiras o mosaicos en paralelo: */
+	grid.samples.resize(size_t(grid.size[1])*size_t(grid.size[0]));
+	taskPool.run(tasks,numChunks);
+	}
+
+/***********************************************************************
+Decodificación de cuadrículas ASCII de ESRI. El cuerpo del archivo se
+divide en bloques en los límites de los números; un primer paso paralelo
+cuenta los números de cada bloque y un segundo paso los convierte
+directamente a su posición en la cuadrícula.
+***********************************************************************/
+
+inline bool isSpace(char c)
+	{
+	return c==' '||c=='\t'||c=='\n'||c=='\r'||c==','||c=='\f'||c=='\v';
+	}
+
+const char* skipSpace(const char* cPtr,const char* end)
+	{
+	while(cPtr!=end&&isSpace(*cPtr))
+		++cPtr;
+	return cPtr;
+	}
+
+const char* skipToken(const char* cPtr,const char* end)
+	{
+	while(cPtr!=end&&!isSpace(*cPtr))
+		++cPtr;
+	return cPtr;
+	}
+
+bool parseNumber(const char* begin,const char* end,double& value) // Convierte el token dado en un número; devuelve falso si no es un número
+	{
+	const char* cPtr=begin;
+	bool negative=false;
+	if(cPtr!=end&&(*cPtr=='-'||*cPtr=='+'))
+		{
+		negative=*cPtr=='-';
+		++cPtr;
+		}
+	double mantissa=0.0;
+	int exponent=0;
+	int numDigits=0;
+	for(;cPtr!=end&&*cPtr>='0'&&*cPtr<='9';++cPtr,++numDigits)
+		mantissa=mantissa*10.0+double(*cPtr-'0');
+	if(cPtr!=end&&*cPtr=='.')
+		for(++cPtr;cPtr!=end&&*cPtr>='0'&&*cPtr<='9';++cPtr,++numDigits,--exponent)
+			mantissa=mantissa*10.0+double(*cPtr-'0');
+	if(numDigits==0)
+		return false;
+	if(cPtr!=end&&(*cPtr=='e'||*cPtr=='E'))
+		{
+		++cPtr;
+		bool negativeExponent=false;
+		if(cPtr!=end&&(*cPtr=='-'||*cPtr=='+'))
+			{
+			negativeExponent=*cPtr=='-';
+			++cPtr;
+			}
+		int e=0;
+		if(cPtr==end||*cPtr<'0'||*cPtr>'9')
+			return false;
+		for(;cPtr!=end&&*cPtr>='0'&&*cPtr<='9';++cPtr)
+			e=e*10+(*cPtr-'0');
+		exponent+=negativeExponent?-e:e;
+		}
+	if(cPtr!=end)
+		return false;
+	value=exponent!=0?mantissa*pow(10.0,double(exponent)):mantissa;
+	if(negative)
+		value=-value;
+	return true;
+	}
+
+class AsciiGridTasks:public TaskPool::Tasks // Clase para convertir en paralelo los bloques del cuerpo de una cuadrícula ASCII
+	{
+	/* Elementos: */
+	public:
+	Grid& grid; // La cuadrícula de destino
+	std::vector<const char*> blocks; // Límites de los bloques del cuerpo del archivo
+	std::vector<size_t> blockStarts; // Número de valores antes de cada bloque, o número de valores de cada bloque en el primer paso
+	bool parse; // Marcar si el paso actual convierte los valores en lugar de contarlos
+	
+	/* Métodos protegidos: */
+	protected:
+	virtual void processTask(unsigned int task)
+		{
+		const char* end=blocks[task+1];
+		const char* cPtr=skipSpace(blocks[task],end);
+		if(!parse)
+			{
+			/* Cuente los números del bloque: */
+			size_t numValues=0;
+			while(cPtr!=end)
+				{
+				cPtr=skipSpace(skipToken(cPtr,end),end);
+				++numValues;
+				}
+			blockStarts[task]=numValues;
+			}
+		else
+			{
+			/* Convierta los números del bloque en su posición de la cuadrícula, con la fila superior primero en el archivo: */
+			size_t numValues=size_t(grid.size[1])*size_t(grid.size[0]);
+			for(size_t index=blockStarts[task];cPtr!=end&&index<numValues;++index)
+				{
+				const char* tokenEnd=skipToken(cPtr,end);
+				double value;
+				if(!parseNumber(cPtr,tokenEnd,value))
+					Misc::throwStdErr("DEMImporter: Invalid value \"%s\" in ASCII grid",std::string(cPtr,tokenEnd).c_str());
+				size_t row=index/grid.size[0];
+				size_t col=index-row*grid.size[0];
+				grid.samples[(size_t(grid.size[1])-1-row)*size_t(grid.size[0])+col]=float(value);
+				cPtr=skipSpace(tokenEnd,end);
+				}
+			}
+		}
+	
+	/* Constructores y destructores: */
+	public:
+	AsciiGridTasks(Grid& sGrid)
+		:grid(sGrid),parse(false)
+		{
+		}
+	};
+
+void decodeAsciiGrid(const MappedFile& file,Grid& grid,TaskPool& taskPool) // Decodifica una cuadrícula ASCII de ESRI en la cuadrícula dada
+	{
+	/* Lea los pares de clave y valor del encabezado hasta el primer número del cuerpo: */
+	const char* end=reinterpret_cast<const char*>(file.data+file.size);
+	const char* cPtr=skipSpace(reinterpret_cast<const char*>(file.data),end);
+	double ncols=-1.0,nrows=-1.0,cellSize[2]={-1.0,-1.0};
+	double ll[2]={0.0,0.0};
+	bool llIsCenter[2]={false,false};
+	while(cPtr!=end&&isalpha(*cPtr))
+		{
+		const char* keyEnd=skipToken(cPtr,end);
+		std::string key(cPtr,keyEnd);
+		const char* valueBegin=skipSpace(keyEnd,end);
+		const char* valueEnd=skipToken(valueBegin,end);
+		double value;
+		if(!parseNumber(valueBegin,valueEnd,value))
+			Misc::throwStdErr("DEMImporter: Invalid value for %s in ASCII grid header",key.c_str());
+		if(strcasecmp(key.c_str(),"ncols")==0)
+			ncols=value;
+		else if(strcasecmp(key.c_str(),"nrows")==0)
+			nrows=value;
+		else if(strcasecmp(key.c_str(),"xllcorner")==0||strcasecmp(key.c_str(),"xllcenter")==0)
+			{
+			ll[0]=value;
+			llIsCenter[0]=strcasecmp(key.c_str(),"xllcenter")==0;
+			}
+		else if(strcasecmp(key.c_str(),"yllcorner")==0||strcasecmp(key.c_str(),"yllcenter")==0)
+			{
+			ll[1]=value;
+			llIsCenter[1]=strcasecmp(key.c_str(),"yllcenter")==0;
+			}
+		else if(strcasecmp(key.c_str(),"cellsize")==0)
+			cellSize[0]=cellSize[1]=value;
+		else if(strcasecmp(key.c_str(),"dx")==0)
+			cellSize[0]=value;
+		else if(strcasecmp(key.c_str(),"dy")==0)
+			cellSize[1]=value;
+		else if(strcasecmp(key.c_str(),"nodata_value")==0)
+			{
+			grid.haveNoData=true;
+			grid.noData=value;
+			}
+		cPtr=skipSpace(valueEnd,end);
+		}
+	if(ncols<1.0||nrows<1.0||cellSize[0]<=0.0||cellSize[1]<=0.0)
+		Misc::throwStdErr("DEMImporter: File is not an ESRI ASCII grid");
+	grid.size[0]=(unsigned int)(ncols);
+	grid.size[1]=(unsigned int)(nrows);
+	for(int i=0;i<2;++i)
+		{
+		double first=llIsCenter[i]?ll[i]:ll[i]+cellSize[i]*0.5;
+		grid.box[i]=first;
+		grid.box[2+i]=first+double(grid.size[i]-1)*cellSize[i];
+		}
+	
+	/* Divida el cuerpo en bloques que terminan en el límite de un número: */
+	AsciiGridTasks tasks(grid);
+	unsigned int numThreads=taskPool.getNumThreads();
+	unsigned int numBlocks=numThreads>1?numThreads*4:1;
+	size_t blockSize=size_t(end-cPtr)/numBlocks+1;
+	tasks.blocks.push_back(cPtr);
+	for(unsigned int i=1;i<numBlocks;++i)
+		{
+		const char* blockEnd=tasks.blocks.back()+blockSize<end?tasks.blocks.back()+blockSize:end;
+		tasks.blocks.push_back(skipToken(blockEnd,end));
+		}
+	tasks.blocks.push_back(end);
+	
+	/* Cuente los números de cada bloque y calcule la posición del primer número de cada bloque: */
+	tasks.blockStarts.resize(numBlocks);
+	taskPool.run(tasks,numBlocks);
+	size_t numValues=0;
+	for(unsigned int i=0;i<numBlocks;++i)
+		{
+		size_t blockValues=tasks.blockStarts[i];
+		tasks.blockStarts[i]=numValues;
+		numValues+=blockValues;
+		}
+	if(numValues<size_t(grid.size[1])*size_t(grid.size[0]))
+		Misc::throwStdErr("DEMImporter: ASCII grid is truncated");
+	
+	/* Convierta los números en paralelo: */
+	grid.samples.resize(size_t(grid.size[1])*size_t(grid.size[0]));
+	tasks.parse=true;
+	taskPool.run(tasks,numBlocks);
+	}
+
+void fillNoData(Grid& grid) // Reemplaza las muestras sin datos por la elevación válida mínima
+	{
+	float minElevation=0.0f;
+	bool haveValid=false;
+	for(std::vector<float>::iterator sIt=grid.samples.begin();sIt!=grid.samples.end();++sIt)
+		if(!isnan(*sIt)&&!(grid.haveNoData&&*sIt==float(grid.noData))&&(!haveValid||minElevation>*sIt))
+			{
+			minElevation=*sIt;
+			haveValid=true;
+			}
+	for(std::vector<float>::iterator sIt=grid.samples.begin();sIt!=grid.samples.end();++sIt)
+		if(isnan(*sIt)||(grid.haveNoData&&*sIt==float(grid.noData)))
+			*sIt=minElevation;
+	}
+
+void writeGrid(const Grid& grid,const std::string& gridFileName) // Escribe la cuadrícula dada como archivo de cuadrícula DEM
+	{
+	/* Escriba a un archivo temporal propio y reemplace atómicamente el archivo de destino: */
+	std::string tempFileName=getTempFileName(gridFileName);
+	{
+	IO::FilePtr file=IO::openFile(tempFileName.c_str(),IO::File::WriteOnly);
+	file->setEndianness(Misc::LittleEndian);
+	int size[2];
+	for(int i=0;i<2;++i)
+		size[i]=int(grid.size[i]);
+	file->write<int>(size,2);
+	for(int i=0;i<4;++i)
+		file->write<float>(float(grid.box[i]));
+	file->write<float>(&grid.samples[0],grid.samples.size());
+	}
+	if(rename(tempFileName.c_str(),gridFileName.c_str())!=0)
+		{
+		int error=errno;
+		unlink(tempFileName.c_str());
+		Misc::throwStdErr("DEMImporter: Unable to write file %s due to error %d (%s)",gridFileName.c_str(),error,strerror(error));
+		}
+	}
+
+}
+
+namespace DEMImporter {
+
+bool isImportable(const char* fileName)
+	{
+	return hasExtension(fileName,".tif")||hasExtension(fileName,".tiff")||hasExtension(fileName,".asc");
+	}
+
+std::string importDEM(const char* sourceFileName,const std::string& cacheDirectory,unsigned int numThreads)
+	{
+	/* Mapee el archivo de origen en memoria y calcule la clave de la caché a partir de su contenido: */
+	MappedFile source(sourceFileName);
+	TaskPool taskPool(numThreads);
+	char key[17];
+	snprintf(key,sizeof(key),"%016llx",(unsigned long long)(hashFile(source,taskPool)));
+	
+	/* Construya el nombre del archivo de cuadrícula en la caché: */
+	std::string gridFileName;
+	if(cacheDirectory.empty())
+		{
+		gridFileName=sourceFileName;
+		gridFileName.push_back('-');
+		}
+	else
+		{
+		if(!createDirectories(cacheDirectory))
+			Misc::throwStdErr("DEMImporter: Unable to create DEM cache directory %s",cacheDirectory.c_str());
+		gridFileName=cacheDirectory;
+		gridFileName.push_back('/');
+		}
+	gridFileName.append(key);
+	gridFileName.append(".grid");
+	
+	/* Reutilice una conversión anterior del mismo contenido: */
+	if(access(gridFileName.c_str(),R_OK)==0)
+		return gridFileName;
+	
+	/* Decodifique el archivo de origen según su extensión: */
+	Grid grid;
+	if(hasExtension(sourceFileName,".asc"))
+		decodeAsciiGrid(source,grid,taskPool);
+	else
+		decodeGeoTIFF(source,grid,taskPool);
+	fillNoData(grid);
+	
+	/* Guarde la cuadrícula en la caché: */
+	writeGrid(grid,gridFileName);
+	
+	return gridFileName;
+	}
+
+}
@@ -0,0 +1,37 @@
+/***********************************************************************
+DEMImporter - Funciones para importar modelos de elevación digital desde
+archivos GeoTIFF y de cuadrícula ASCII de ESRI, decodificándolos con
+varios hilos y guardando el resultado como archivo de cuadrícula DEM en
+una caché indexada por el hash del archivo de origen.
+Copyright (c) 2026 Sergio081096
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#ifndef DEMIMPORTER_INCLUDED
+#define DEMIMPORTER_INCLUDED
+
+#include <string>
+
+namespace DEMImporter {
+
+bool isImportable(const char* fileName); // Devuelve verdadero si el archivo dado es un GeoTIFF o una cuadrícula ASCII de ESRI según su extensión
+std::string importDEM(const char* sourceFileName,const std::string& cacheDirectory,unsigned int numThreads); // Convierte el archivo dado a un archivo de cuadrícula DEM en el directorio de caché dado, o junto al archivo si está vacío, y devuelve su nombre; reutiliza una conversión anterior del mismo contenido
+
+}
+
+#endif
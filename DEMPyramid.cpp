@@ -0,0 +1,453 @@
+/***********************************************************************
+DEMPyramid - Clase para un contenedor de modelos de elevación digital en
+mosaicos con una pirámide de resoluciones, mapeado en memoria para
+cargar y remuestrear rápidamente terrenos de origen muy grandes.
+Copyright (c) 2026 Sergio081096
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include "DEMPyramid.h"
+
+#include <endian.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <string>
+#include <Misc/ThrowStdErr.h>
+
+#include "TaskPool.h"
+
+/***********************************************************************
+Disposición del archivo, en el orden de bytes del anfitrión (little-endian,
+igual que los archivos de cuadrícula DEM):
+- Encabezado de una página: identificador "SARDEMPY", versión, logaritmo
+  del lado de los mosaicos, número de niveles, cuadro delimitador del DEM,
+  tamaño y fecha de modificación del archivo de cuadrícula de origen, y
+  el tamaño y la posición de cada nivel.
+- Los datos de cada nivel, alineados a páginas, como mosaicos cuadrados
+  ordenados por filas, con las muestras fuera del nivel replicadas desde
+  el borde. Cada nivel tiene la mitad de resolución que el anterior; el
+  último nivel cabe en un solo mosaico.
+***********************************************************************/
+
+namespace {
+
+/**************
+Helper objects:
+**************/
+
+const char pyramidMagic[8]={'S','A','R','D','E','M','P','Y'};
+const Misc::UInt32 pyramidVersion=1;
+const size_t pageSize=4096;
+const size_t gridHeaderSize=24; // Tamaño del encabezado de un archivo de cuadrícula DEM
+
+struct FileHeader // Estructura del encabezado del archivo de pirámide
+	{
+	/* Elementos: */
+	public:
+	char magic[8]; // Identificador del archivo
+	Misc::UInt32 version; // Versión del formato de archivo
+	Misc::UInt32 tileSizeLog; // Logaritmo en base dos del lado de los mosaicos
+	Misc::UInt32 numLevels; // Número de niveles de la pirámide
+	Misc::Float32 demBox[4]; // Cuadro delimitador del DEM
+	Misc::UInt32 reserved; // Relleno para alinear los siguientes elementos
+	Misc::UInt64 sourceSize; // Tamaño del archivo de cuadrícula de origen en bytes
+	Misc::SInt64 sourceMTime; // Fecha de modificación del archivo de cuadrícula de origen
+	};
+
+struct LevelHeader // Estructura de la entrada de un nivel en el encabezado
+	{
+	/* Elementos: */
+	public:
+	Misc::UInt32 size[2]; // Ancho y alto del nivel en muestras
+	Misc::UInt64 offset; // Posición de los datos del nivel en el archivo
+	};
+
+const unsigned int maxNumLevels=(unsigned int)((pageSize-sizeof(FileHeader))/sizeof(LevelHeader));
+
+bool readHeader(const char* fileName,FileHeader& header)
+	{
+	/* Lea el encabezado del archivo dado, si existe: */
+	int fd=open(fileName,O_RDONLY);
+	if(fd<0)
+		return false;
+	bool result=read(fd,&header,sizeof(FileHeader))==ssize_t(sizeof(FileHeader))&&memcmp(header.magic,pyramidMagic,8)==0;
+	close(fd);
+	return result;
+	}
+
+void initLevel(DEMPyramid::Level& level,unsigned int width,unsigned int height,unsigned int tileSizeLog,size_t offset)
+	{
+	level.size[0]=width;
+	level.size[1]=height;
+	for(int i=0;i<2;++i)
+		level.numTiles[i]=(level.size[i]+(1U<<tileSizeLog)-1U)>>tileSizeLog;
+	level.offset=offset;
+	}
+
+size_t getLevelDataSize(const DEMPyramid::Level& level,unsigned int tileSizeLog)
+	{
+	return ((size_t(level.numTiles[1])*size_t(level.numTiles[0]))<<(2*tileSizeLog))*sizeof(float);
+	}
+
+int createTempFile(const std::string& fileName,std::string& tempFileName) // Crea un archivo temporal exclusivo junto al archivo dado y devuelve su descriptor
+	{
+	static unsigned int tempFileCounter=0;
+	int fd=-1;
+	for(int attempt=0;fd<0&&attempt<16;++attempt)
+		{
+		/* Forme un nombre único entre procesos e hilos y créelo sólo si aún no existe: */
+		char suffix[40];
+		snprintf(suffix,sizeof(suffix),".%d.%u.tmp",int(getpid()),__atomic_fetch_add(&tempFileCounter,1U,__ATOMIC_RELAXED));
+		tempFileName=fileName+suffix;
+		fd=open(tempFileName.c_str(),O_RDWR|O_CREAT|O_EXCL,0644);
+		if(fd<0&&errno!=EEXIST)
+			break;
+		}
+	return fd;
+	}
+
+class Resampler:public TaskPool::Tasks // Clase para remuestrear un nivel de pirámide por bandas de filas con varios hilos
+	{
+	/* Elementos: */
+	private:
+	const DEMPyramid& pyramid; // La pirámide de origen
+	unsigned int level; // El nivel de origen
+	const unsigned int* levelSize; // Tamaño del nivel de origen
+	const unsigned int* destSize; // Tamaño de la cuadrícula de destino
+	float* dest; // La cuadrícula de destino
+	double scale[2]; // Factores de escala de los índices de destino a los índices de origen
+	double offset; // Desplazamiento de los índices de origen por el centrado de las muestras promediadas
+	unsigned int rowBandSize; // Número de filas de destino asignadas a la vez a un hilo
+	
+	/* Constructores y destructores: */
+	public:
+	Resampler(const DEMPyramid& sPyramid,unsigned int sLevel,const unsigned int sDestSize[2],float* sDest)
+		:pyramid(sPyramid),level(sLevel),levelSize(pyramid.getLevelSize(level)),
+		 destSize(sDestSize),dest(sDest),
+		 rowBandSize(16)
+		{
+		/* Alinee las esquinas de la cuadrícula de destino con las esquinas del nivel más fino; cada muestra del nivel dado está centrada en su bloque de muestras del nivel más fino: */
+		const unsigned int* fullSize=pyramid.getLevelSize(0);
+		double levelScale=double(1U<<level);
+		for(int i=0;i<2;++i)
+			scale[i]=destSize[i]>1?double(fullSize[i]-1)/(double(destSize[i]-1)*levelScale):0.0;
+		offset=0.5/levelScale-0.5;
+		}
+	
+	/* Métodos de TaskPool::Tasks: */
+	virtual void processTask(unsigned int task)
+		{
+		/* Calcule el intervalo de filas de la banda: */
+		unsigned int rowBegin=task*rowBandSize;
+		unsigned int rowEnd=rowBegin+rowBandSize;
+		if(rowEnd>destSize[1])
+			rowEnd=destSize[1];
+		
+		/* Interpole bilinealmente las filas de la banda: */
+		for(unsigned int y=rowBegin;y<rowEnd;++y)
+			{
+			double sy=double(y)*scale[1]+offset;
+			if(sy<0.0)
+				sy=0.0;
+			else if(sy>double(levelSize[1]-1))
+				sy=double(levelSize[1]-1);
+			unsigned int y0=(unsigned int)sy;
+			if(y0>levelSize[1]-2U)
+				y0=levelSize[1]>1?levelSize[1]-2U:0U;
+			unsigned int y1=levelSize[1]>1?y0+1:y0;
+			float wy=float(sy-double(y0));
+			float* destPtr=dest+size_t(y)*size_t(destSize[0]);
+			for(unsigned int x=0;x<destSize[0];++x,++destPtr)
+				{
+				double sx=double(x)*scale[0]+offset;
+				if(sx<0.0)
+					sx=0.0;
+				else if(sx>double(levelSize[0]-1))
+					sx=double(levelSize[0]-1);
+				unsigned int x0=(unsigned int)sx;
+				if(x0>levelSize[0]-2U)
+					x0=levelSize[0]>1?levelSize[0]-2U:0U;
+				unsigned int x1=levelSize[0]>1?x0+1:x0;
+				float wx=float(sx-double(x0));
+				float s0=pyramid.getSample(level,x0,y0)*(1.0f-wx)+pyramid.getSample(level,x1,y0)*wx;
+				float s1=pyramid.getSample(level,x0,y1)*(1.0f-wx)+pyramid.getSample(level,x1,y1)*wx;
+				*destPtr=s0*(1.0f-wy)+s1*wy;
+				}
+			}
+		}
+	
+	/* Nuevos métodos: */
+	unsigned int getNumBands(void) const // Devuelve el número de bandas de filas de la cuadrícula de destino
+		{
+		return (destSize[1]+rowBandSize-1)/rowBandSize;
+		}
+	};
+
+}
+
+/***************************
+Methods of class DEMPyramid:
+***************************/
+
+DEMPyramid::DEMPyramid(const char* pyramidFileName)
+	:fd(-1),mapping(0),mappingSize(0),
+	 tileSizeLog(0)
+	{
+	/* Abra el archivo de pirámide y mapéelo en memoria: */
+	fd=open(pyramidFileName,O_RDONLY);
+	if(fd<0)
+		Misc::throwStdErr("DEMPyramid: Unable to open file %s due to error %d (%s)",pyramidFileName,errno,strerror(errno));
+	struct stat fileStats;
+	if(fstat(fd,&fileStats)<0||size_t(fileStats.st_size)<pageSize)
+		{
+		close(fd);
+		Misc::throwStdErr("DEMPyramid: File %s is not a DEM pyramid",pyramidFileName);
+		}
+	mappingSize=size_t(fileStats.st_size);
+	void* map=mmap(0,mappingSize,PROT_READ,MAP_SHARED,fd,0);
+	if(map==MAP_FAILED)
+		{
+		int error=errno;
+		close(fd);
+		Misc::throwStdErr("DEMPyramid: Unable to map file %s due to error %d (%s)",pyramidFileName,error,strerror(error));
+		}
+	mapping=static_cast<const unsigned char*>(map);
+	
+	/* Verifique el encabezado: */
+	const FileHeader* header=reinterpret_cast<const FileHeader*>(mapping);
+	std::string error;
+	if(memcmp(header->magic,pyramidMagic,8)!=0)
+		error="is not a DEM pyramid";
+	else if(header->version!=pyramidVersion)
+		error="has an unsupported version";
+	else if(header->tileSizeLog<1||header->tileSizeLog>12||header->numLevels<1||header->numLevels>maxNumLevels)
+		error="has a corrupted header";
+	if(error.empty())
+		{
+		/* Lea los niveles y verifique que estén dentro del archivo: */
+		tileSizeLog=header->tileSizeLog;
+		for(int i=0;i<4;++i)
+			demBox[i]=header->demBox[i];
+		const LevelHeader* levelHeaders=reinterpret_cast<const LevelHeader*>(mapping+sizeof(FileHeader));
+		levels.resize(header->numLevels);
+		for(unsigned int l=0;l<header->numLevels&&error.empty();++l)
+			{
+			initLevel(levels[l],levelHeaders[l].size[0],levelHeaders[l].size[1],tileSizeLog,size_t(levelHeaders[l].offset));
+			if(levels[l].size[0]==0||levels[l].size[1]==0||levels[l].offset%pageSize!=0||levels[l].offset+getLevelDataSize(levels[l],tileSizeLog)>mappingSize)
+				error="is truncated";
+			}
+		}
+	if(!error.empty())
+		{
+		munmap(const_cast<unsigned char*>(mapping),mappingSize);
+		close(fd);
+		Misc::throwStdErr("DEMPyramid: File %s %s",pyramidFileName,error.c_str());
+		}
+	}
+
+DEMPyramid::~DEMPyramid(void)
+	{
+	munmap(const_cast<unsigned char*>(mapping),mappingSize);
+	close(fd);
+	}
+
+bool DEMPyramid::isPyramidFile(const char* fileName)
+	{
+	FileHeader header;
+	return readHeader(fileName,header);
+	}
+
+bool DEMPyramid::isCurrent(const char* pyramidFileName,const char* gridFileName)
+	{
+	/* Compare el origen registrado en la pirámide con el archivo de cuadrícula actual: */
+	FileHeader header;
+	struct stat gridStats;
+	if(!readHeader(pyramidFileName,header)||header.version!=pyramidVersion||stat(gridFileName,&gridStats)<0)
+		return false;
+	return header.sourceSize==Misc::UInt64(gridStats.st_size)&&header.sourceMTime==Misc::SInt64(gridStats.st_mtime);
+	}
+
+bool DEMPyramid::build(const char* gridFileName,const char* pyramidFileName,unsigned int tileSizeLog,const volatile bool* cancel)
+	{
+	#if __BYTE_ORDER!=__LITTLE_ENDIAN
+	Misc::throwStdErr("DEMPyramid::build: DEM pyramids require a little-endian host");
+	#endif
+	
+	/* Mapee en memoria el archivo de cuadrícula de origen: */
+	int gridFd=open(gridFileName,O_RDONLY);
+	if(gridFd<0)
+		Misc::throwStdErr("DEMPyramid::build: Unable to open file %s due to error %d (%s)",gridFileName,errno,strerror(errno));
+	struct stat gridStats;
+	if(fstat(gridFd,&gridStats)<0||size_t(gridStats.st_size)<gridHeaderSize)
+		{
+		close(gridFd);
+		Misc::throwStdErr("DEMPyramid::build: File %s is not a DEM grid",gridFileName);
+		}
+	size_t gridMappingSize=size_t(gridStats.st_size);
+	void* gridMap=mmap(0,gridMappingSize,PROT_READ,MAP_SHARED,gridFd,0);
+	close(gridFd);
+	if(gridMap==MAP_FAILED)
+		Misc::throwStdErr("DEMPyramid::build: Unable to map file %s due to error %d (%s)",gridFileName,errno,strerror(errno));
+	const unsigned char* gridMapping=static_cast<const unsigned char*>(gridMap);
+	
+	/* Lea el encabezado de la cuadrícula: */
+	Misc::SInt32 gridSize[2];
+	memcpy(gridSize,gridMapping,sizeof(gridSize));
+	Misc::Float32 gridBox[4];
+	memcpy(gridBox,gridMapping+sizeof(gridSize),sizeof(gridBox));
+	if(gridSize[0]<1||gridSize[1]<1||gridHeaderSize+size_t(gridSize[1])*size_t(gridSize[0])*sizeof(float)>gridMappingSize)
+		{
+		munmap(gridMap,gridMappingSize);
+		Misc::throwStdErr("DEMPyramid::build: File %s is truncated",gridFileName);
+		}
+	const float* grid=reinterpret_cast<const float*>(gridMapping+gridHeaderSize);
+	
+	/* Calcule la disposición de los niveles: */
+	std::vector<Level> levels;
+	Level level;
+	size_t fileSize=pageSize;
+	initLevel(level,(unsigned int)gridSize[0],(unsigned int)gridSize[1],tileSizeLog,fileSize);
+	while(true)
+		{
+		levels.push_back(level);
+		fileSize+=(getLevelDataSize(level,tileSizeLog)+pageSize-1)&~(pageSize-1);
+		if((level.size[0]<=(1U<<tileSizeLog)&&level.size[1]<=(1U<<tileSizeLog))||levels.size()==maxNumLevels)
+			break;
+		initLevel(level,(level.size[0]+1)/2,(level.size[1]+1)/2,tileSizeLog,fileSize);
+		}
+	
+	/* Cree un archivo temporal propio de este proceso y mapéelo en memoria para escritura: */
+	std::string tempFileName;
+	int fd=createTempFile(pyramidFileName,tempFileName);
+	if(fd<0)
+		{
+		int error=errno;
+		munmap(gridMap,gridMappingSize);
+		Misc::throwStdErr("DEMPyramid::build: Unable to create file %s due to error %d (%s)",tempFileName.c_str(),error,strerror(error));
+		}
+	void* map=MAP_FAILED;
+	if(ftruncate(fd,off_t(fileSize))==0)
+		map=mmap(0,fileSize,PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+	if(map==MAP_FAILED)
+		{
+		int error=errno;
+		close(fd);
+		unlink(tempFileName.c_str());
+		munmap(gridMap,gridMappingSize);
+		Misc::throwStdErr("DEMPyramid::build: Unable to map file %s due to error %d (%s)",tempFileName.c_str(),error,strerror(error));
+		}
+	unsigned char* mapping=static_cast<unsigned char*>(map);
+	
+	/* Escriba el encabezado: */
+	FileHeader* header=reinterpret_cast<FileHeader*>(mapping);
+	memcpy(header->magic,pyramidMagic,8);
+	header->version=pyramidVersion;
+	header->tileSizeLog=tileSizeLog;
+	header->numLevels=Misc::UInt32(levels.size());
+	for(int i=0;i<4;++i)
+		header->demBox[i]=gridBox[i];
+	header->reserved=0;
+	header->sourceSize=Misc::UInt64(gridStats.st_size);
+	header->sourceMTime=Misc::SInt64(gridStats.st_mtime);
+	LevelHeader* levelHeaders=reinterpret_cast<LevelHeader*>(mapping+sizeof(FileHeader));
+	for(size_t l=0;l<levels.size();++l)
+		{
+		for(int i=0;i<2;++i)
+			levelHeaders[l].size[i]=levels[l].size[i];
+		levelHeaders[l].offset=Misc::UInt64(levels[l].offset);
+		}
+	
+	/* Copie la cuadrícula de origen en los mosaicos del nivel más fino, replicando las muestras del borde: */
+	unsigned int tileSize=1U<<tileSizeLog;
+	float* levelData=reinterpret_cast<float*>(mapping+levels[0].offset);
+	for(unsigned int y=0;y<levels[0].numTiles[1]*tileSize;++y)
+		{
+		const float* gridRow=grid+size_t(y<levels[0].size[1]?y:levels[0].size[1]-1)*size_t(levels[0].size[0]);
+		for(unsigned int x=0;x<levels[0].numTiles[0]*tileSize;++x)
+			levelData[getSampleIndex(levels[0],tileSizeLog,x,y)]=gridRow[x<levels[0].size[0]?x:levels[0].size[0]-1];
+		}
+	munmap(gridMap,gridMappingSize);
+	
+	/* Calcule cada nivel como el promedio de bloques de 2x2 muestras del nivel anterior: */
+	for(size_t l=1;l<levels.size();++l)
+		{
+		/* Abandone la construcción entre niveles si se canceló: */
+		if(cancel!=0&&*cancel)
+			{
+			munmap(mapping,fileSize);
+			close(fd);
+			unlink(tempFileName.c_str());
+			return false;
+			}
+		
+		const Level& src=levels[l-1];
+		const float* srcData=reinterpret_cast<const float*>(mapping+src.offset);
+		const Level& dst=levels[l];
+		float* dstData=reinterpret_cast<float*>(mapping+dst.offset);
+		for(unsigned int y=0;y<dst.numTiles[1]*tileSize;++y)
+			{
+			unsigned int sy0=y<dst.size[1]?2*y:2*(dst.size[1]-1);
+			unsigned int sy1=sy0+1<src.size[1]?sy0+1:sy0;
+			for(unsigned int x=0;x<dst.numTiles[0]*tileSize;++x)
+				{
+				unsigned int sx0=x<dst.size[0]?2*x:2*(dst.size[0]-1);
+				unsigned int sx1=sx0+1<src.size[0]?sx0+1:sx0;
+				float sum=srcData[getSampleIndex(src,tileSizeLog,sx0,sy0)]+srcData[getSampleIndex(src,tileSizeLog,sx1,sy0)];
+				sum+=srcData[getSampleIndex(src,tileSizeLog,sx0,sy1)]+srcData[getSampleIndex(src,tileSizeLog,sx1,sy1)];
+				dstData[getSampleIndex(dst,tileSizeLog,x,y)]=sum*0.25f;
+				}
+			}
+		}
+	
+	/* Escriba el archivo y reemplace atómicamente cualquier pirámide anterior: */
+	bool ok=msync(mapping,fileSize,MS_SYNC)==0;
+	munmap(mapping,fileSize);
+	ok=close(fd)==0&&ok;
+	if(!ok||rename(tempFileName.c_str(),pyramidFileName)!=0)
+		{
+		int error=errno;
+		unlink(tempFileName.c_str());
+		Misc::throwStdErr("DEMPyramid::build: Unable to write file %s due to error %d (%s)",pyramidFileName,error,strerror(error));
+		}
+	
+	return true;
+	}
+
+unsigned int DEMPyramid::findLevel(const unsigned int minSize[2]) const
+	{
+	/* Busque desde el nivel más grueso el primer nivel suficientemente grande: */
+	for(unsigned int l=(unsigned int)(levels.size());l>0;--l)
+		if(levels[l-1].size[0]>=minSize[0]&&levels[l-1].size[1]>=minSize[1])
+			return l-1;
+	
+	return 0;
+	}
+
+bool DEMPyramid::resample(unsigned int level,const unsigned int destSize[2],float* dest,unsigned int numThreads,const volatile bool* cancel) const
+	{
+	/* Remuestree las bandas de filas con todos los hilos; la bandera de cancelación se consulta antes de cada banda: */
+	Resampler resampler(*this,level,destSize,dest);
+	TaskPool taskPool(numThreads);
+	return taskPool.run(resampler,resampler.getNumBands(),cancel);
+	}
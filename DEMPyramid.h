@@ -0,0 +1,95 @@
+/***********************************************************************
+DEMPyramid - Clase para un contenedor de modelos de elevación digital en
+mosaicos con una pirámide de resoluciones, mapeado en memoria para
+cargar y remuestrear rápidamente terrenos de origen muy grandes.
+Copyright (c) 2026 Sergio081096
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#ifndef DEMPYRAMID_INCLUDED
+#define DEMPYRAMID_INCLUDED
+
+#include <stddef.h>
+#include <vector>
+#include <Misc/SizedTypes.h>
+
+class DEMPyramid
+	{
+	/* Clases integradas: */
+	public:
+	struct Level // Estructura que describe un nivel de la pirámide
+		{
+		/* Elementos: */
+		public:
+		unsigned int size[2]; // Ancho y alto del nivel en muestras
+		unsigned int numTiles[2]; // Número de mosaicos del nivel en cada dirección
+		size_t offset; // Posición de los datos del nivel en el archivo
+		};
+	
+	/* Elementos: */
+	private:
+	int fd; // Descriptor del archivo de la pirámide
+	const unsigned char* mapping; // Mapeo de memoria de solo lectura de todo el archivo
+	size_t mappingSize; // Tamaño del mapeo de memoria en bytes
+	unsigned int tileSizeLog; // Logaritmo en base dos del lado de los mosaicos en muestras
+	float demBox[4]; // Coordenadas de la esquina inferior izquierda y superior derecha del DEM
+	std::vector<Level> levels; // Niveles de la pirámide, del más fino al más grueso
+	
+	/* Métodos privados: */
+	static size_t getSampleIndex(const Level& level,unsigned int tileSizeLog,unsigned int x,unsigned int y) // Devuelve el índice de una muestra dentro de los datos de un nivel
+		{
+		unsigned int tileMask=(1U<<tileSizeLog)-1U;
+		size_t tileIndex=size_t(y>>tileSizeLog)*size_t(level.numTiles[0])+size_t(x>>tileSizeLog);
+		return (tileIndex<<(2*tileSizeLog))+(size_t(y&tileMask)<<tileSizeLog)+size_t(x&tileMask);
+		}
+	
+	/* Constructores y destructores: */
+	public:
+	DEMPyramid(const char* pyramidFileName); // Mapea en memoria el archivo de pirámide dado
+	private:
+	DEMPyramid(const DEMPyramid& source); // Prohibir copia constructor
+	DEMPyramid& operator=(const DEMPyramid& source); // Prohibir operador de asignación
+	public:
+	~DEMPyramid(void);
+	
+	/* Métodos: */
+	static bool isPyramidFile(const char* fileName); // Devuelve verdadero si el archivo dado es una pirámide DEM
+	static bool isCurrent(const char* pyramidFileName,const char* gridFileName); // Devuelve verdadero si la pirámide dada existe y se construyó a partir de la versión actual del archivo de cuadrícula dado
+	static bool build(const char* gridFileName,const char* pyramidFileName,unsigned int tileSizeLog=8,const volatile bool* cancel=0); // Construye una pirámide a partir de un archivo de cuadrícula DEM sin cargarlo en la memoria; devuelve falso y no deja ningún archivo si la bandera de cancelación dada se activa entre niveles
+	const float* getDemBox(void) const // Devuelve el cuadro delimitador del DEM
+		{
+		return demBox;
+		}
+	unsigned int getNumLevels(void) const // Devuelve el número de niveles de la pirámide
+		{
+		return (unsigned int)(levels.size());
+		}
+	const unsigned int* getLevelSize(unsigned int level) const // Devuelve el tamaño del nivel dado en muestras
+		{
+		return levels[level].size;
+		}
+	float getSample(unsigned int level,unsigned int x,unsigned int y) const // Devuelve la muestra dada del nivel dado
+		{
+		const Level& l=levels[level];
+		return reinterpret_cast<const float*>(mapping+l.offset)[getSampleIndex(l,tileSizeLog,x,y)];
+		}
+	unsigned int findLevel(const unsigned int minSize[2]) const; // Devuelve el nivel más grueso que tiene al menos el tamaño dado, o el nivel más fino
+	bool resample(unsigned int level,const unsigned int destSize[2],float* dest,unsigned int numThreads,const volatile bool* cancel=0) const; // Remuestrea el nivel dado en paralelo a una cuadrícula del tamaño dado, alineando las esquinas; devuelve falso si la bandera de cancelación dada se activó entre bandas de filas
+	};
+
+#endif
@@ -23,6 +23,8 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 
 #include "DEMTool.h"
 
+#include <stdexcept>
+#include <Misc/MessageLogger.h>
 #include <Misc/StandardValueCoders.h>
 #include <Misc/ConfigurationFile.h>
 #include <Geometry/GeometryValueCoders.h>
@@ -34,9 +36,10 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 Methods of class DEMToolFactory:
 *******************************/
 
-DEMToolFactory::DEMToolFactory(Vrui::ToolManager& toolManager)
+DEMToolFactory::DEMToolFactory(Vrui::ToolManager& toolManager,const std::string& sDemCacheDirectory)
 	:ToolFactory("DEMTool",toolManager),
-	 demSelectionHelper(Vrui::getWidgetManager(),"",".grid",Vrui::openDirectory("."))
+	 demSelectionHelper(Vrui::getWidgetManager(),"",".grid;.pyr;.tif;.tiff;.asc",Vrui::openDirectory(".")),
+	 demCacheDirectory(sDemCacheDirectory)
 	{
 	/* Inicializar diseño de herramienta: */
 	layout.setNumButtons(1);
@@ -90,9 +93,12 @@ Methods of class DEMTool:
 
 void DEMTool::loadDEMFile(const char* demFileName)
 	{
-	/*   */
+	/* Empiece a cargar el DEM; el hilo de carga convierte los archivos GeoTIFF y de cuadrícula ASCII a través de la caché de DEM importados: */
 	load(demFileName);
-	
+	}
+
+void DEMTool::setDemTransform(void)
+	{
 	OGTransform demT;
 	if(haveDemTransform)
 		demT=demTransform;
@@ -140,10 +146,10 @@ void DEMTool::loadDEMFileCallback(GLMotif::FileSelectionDialog::OKCallbackData*
 	loadDEMFile(cbData->selectedDirectory->getPath(cbData->selectedFileName).c_str());
 	}
 
-DEMToolFactory* DEMTool::initClass(Vrui::ToolManager& toolManager)
+DEMToolFactory* DEMTool::initClass(Vrui::ToolManager& toolManager,const std::string& demCacheDirectory)
 	{
 	/* Crea la fábrica de herramientas: */
-	factory=new DEMToolFactory(toolManager);
+	factory=new DEMToolFactory(toolManager,demCacheDirectory);
 	
 	/* Register and return the class: */
 	toolManager.addClass(factory,Vrui::ToolManager::defaultToolFactoryDestructor);
@@ -153,8 +159,12 @@ DEMToolFactory* DEMTool::initClass(Vrui::ToolManager& toolManager)
 DEMTool::DEMTool(const Vrui::ToolFactory* factory,const Vrui::ToolInputAssignment& inputAssignment)
 	:Vrui::Tool(factory,inputAssignment),
 	 haveDemTransform(false),demTransform(OGTransform::identity),
-	 demVerticalShift(0),demVerticalScale(1)
+	 demVerticalShift(0),demVerticalScale(1),
+	 demNumThreads(4),
+	 demCacheDirectory(DEMTool::factory->demCacheDirectory)
 	{
+	/* Ajuste por defecto la resolución del DEM al doble de la resolución de la cámara: */
+	demMaxResolution=2*Math::max(application->frameSize[0],application->frameSize[1]);
 	}
 
 DEMTool::~DEMTool(void)
@@ -175,10 +185,18 @@ void DEMTool::configure(const Misc::ConfigurationFileSection& configFileSection)
 	
 	demVerticalShift=configFileSection.retrieveValue<Scalar>("./demVerticalShift",demVerticalShift);
 	demVerticalScale=configFileSection.retrieveValue<Scalar>("./demVerticalScale",demVerticalScale);
+	
+	/* Lea los parámetros para cargar pirámides DEM e importar archivos DEM: */
+	demMaxResolution=configFileSection.retrieveValue<unsigned int>("./demMaxResolution",demMaxResolution);
+	demNumThreads=configFileSection.retrieveValue<unsigned int>("./demNumThreads",demNumThreads);
+	demCacheDirectory=configFileSection.retrieveString("./demCacheDirectory",demCacheDirectory);
 	}
 
 void DEMTool::initialize(void)
 	{
+	setResolution(demMaxResolution,demNumThreads);
+	setImportCacheDirectory(demCacheDirectory);
+	
 	/* Muestra un cuadro de diálogo de selección de archivos si no hay un archivo DEM preconfigurado: */
 	if(demFileName.empty())
 		{
@@ -201,7 +219,27 @@ void DEMTool::buttonCallback(int buttonSlotIndex,Vrui::InputDevice::ButtonCallba
 	{
 	if(cbData->newButtonState)
 		{
-		/* Alternar esta herramienta DEM como la activa: */
-		application->toggleDEM(this);
+		/* No active un DEM que aún no se ha cargado: */
+		if(getDemVersion()==0)
+			Misc::formattedUserWarning("Show DEM: Ignoring request; the DEM is not loaded yet");
+		else
+			{
+			/* Alternar esta herramienta DEM como la activa: */
+			application->toggleDEM(this);
+			}
+		}
+	}
+
+void DEMTool::frame(void)
+	{
+	/* Intercambie el DEM cargado en segundo plano cuando esté listo: */
+	try
+		{
+		if(update())
+			setDemTransform();
+		}
+	catch(const std::runtime_error& err)
+		{
+		Misc::formattedUserError("Show DEM: %s",err.what());
 		}
 	}
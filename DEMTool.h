@@ -45,10 +45,11 @@ class DEMToolFactory:public Vrui::ToolFactory
 	/* Elementos: */
 	private:
 	GLMotif::FileSelectionHelper demSelectionHelper; // Objeto auxiliar para cargar DEM desde archivos
+	std::string demCacheDirectory; // Directorio predeterminado para guardar los DEM importados de archivos GeoTIFF o de cuadrícula ASCII
 	
 	/* Constructores y destructores: */
 	public:
-	DEMToolFactory(Vrui::ToolManager& toolManager);
+	DEMToolFactory(Vrui::ToolManager& toolManager,const std::string& sDemCacheDirectory);
 	virtual ~DEMToolFactory(void);
 	
 	/* Métodos de Vrui::ToolFactory: */
@@ -70,14 +71,18 @@ class DEMTool:public DEM,public Vrui::Tool,public Vrui::Application::Tool<Sandbo
 	OGTransform demTransform; // La transformación para aplicar a la DEM
 	Scalar demVerticalShift; // Desplazamiento vertical adicional para aplicar a DEM en unidades de coordenadas de sandbox
 	Scalar demVerticalScale; // La exageración vertical para aplicar al DEM
+	unsigned int demMaxResolution; // Tamaño máximo de la matriz DEM al cargar desde una pirámide
+	unsigned int demNumThreads; // Número de hilos para remuestrear una pirámide DEM o importar un archivo DEM
+	std::string demCacheDirectory; // Directorio para guardar los DEM importados de archivos GeoTIFF o de cuadrícula ASCII
 	
 	/* Métodos privados: */
-	void loadDEMFile(const char* demFileName); // Carga un DEM desde un archivo
+	void loadDEMFile(const char* demFileName); // Empieza a cargar en segundo plano un DEM desde un archivo, importándolo si es necesario
+	void setDemTransform(void); // Ajusta la transformación del DEM recién cargado al recinto de la caja de arena
 	void loadDEMFileCallback(GLMotif::FileSelectionDialog::OKCallbackData* cbData); // Se llama cuando el usuario selecciona un archivo DEM para cargar
 	
 	/* Constructores y destructores: */
 	public:
-	static DEMToolFactory* initClass(Vrui::ToolManager& toolManager);
+	static DEMToolFactory* initClass(Vrui::ToolManager& toolManager,const std::string& demCacheDirectory); // Crea la fábrica con el directorio predeterminado de la caché de DEM importados
 	DEMTool(const Vrui::ToolFactory* factory,const Vrui::ToolInputAssignment& inputAssignment);
 	virtual ~DEMTool(void);
 	
@@ -86,6 +91,7 @@ class DEMTool:public DEM,public Vrui::Tool,public Vrui::Application::Tool<Sandbo
 	virtual void initialize(void);
 	virtual const Vrui::ToolFactory* getFactory(void) const;
 	virtual void buttonCallback(int buttonSlotIndex,Vrui::InputDevice::ButtonCallbackData* cbData);
+	virtual void frame(void);
 	};
 
 #endif
@@ -0,0 +1,381 @@
+/***********************************************************************
+DepressionFiller - Clase para calcular la superficie de agua en
+equilibrio de una cuadrícula de elevación mediante el relleno de
+depresiones por inundación prioritaria, con actualizaciones
+incrementales por mosaicos.
+Copyright (c) 2026 Sergio081096
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include "DepressionFiller.h"
+
+#include <float.h>
+#include <utility>
+#include <algorithm>
+#include <queue>
+#include <Math/Math.h>
+
+namespace {
+
+/****************
+Helper functions:
+****************/
+
+const unsigned int unlabeled=~0U; // Etiqueta de celdas aún no alcanzadas por la inundación
+
+typedef std::pair<float,unsigned int> QueueEntry; // Entrada de cola de prioridad: elevación y índice de celda o cuenca
+typedef std::priority_queue<QueueEntry,std::vector<QueueEntry>,std::greater<QueueEntry> > MinQueue; // Cola de prioridad que devuelve primero la elevación más baja
+
+struct SpillEdgeOrder // Orden de las conexiones de desbordamiento por par de cuencas y elevación
+	{
+	/* Métodos: */
+	template <class SpillEdgeParam>
+	bool operator()(const SpillEdgeParam& e0,const SpillEdgeParam& e1) const
+		{
+		if(e0.label0!=e1.label0)
+			return e0.label0<e1.label0;
+		if(e0.label1!=e1.label1)
+			return e0.label1<e1.label1;
+		return e0.elevation<e1.elevation;
+		}
+	};
+
+template <class SpillEdgeParam>
+void compactEdges(std::vector<SpillEdgeParam>& edges)
+	{
+	/* Ordene las conexiones y conserve solo la más baja de cada par de cuencas: */
+	std::sort(edges.begin(),edges.end(),SpillEdgeOrder());
+	typename std::vector<SpillEdgeParam>::iterator outIt=edges.begin();
+	for(typename std::vector<SpillEdgeParam>::iterator eIt=edges.begin();eIt!=edges.end();++eIt)
+		if(outIt==edges.begin()||(outIt-1)->label0!=eIt->label0||(outIt-1)->label1!=eIt->label1)
+			*(outIt++)=*eIt;
+	edges.erase(outIt,edges.end());
+	}
+
+}
+
+/*********************************
+Methods of class DepressionFiller:
+*********************************/
+
+void DepressionFiller::fillTile(DepressionFiller::Tile& tile)
+	{
+	unsigned int x0=tile.origin[0];
+	unsigned int y0=tile.origin[1];
+	unsigned int x1=x0+tile.size[0];
+	unsigned int y1=y0+tile.size[1];
+	
+	/* Restablezca las celdas del mosaico; las celdas del borde del dominio drenan fuera de la mesa y pertenecen a la cuenca 0: */
+	MinQueue open;
+	for(unsigned int y=y0;y<y1;++y)
+		for(unsigned int x=x0;x<x1;++x)
+			{
+			unsigned int index=y*size[0]+x;
+			localFilled[index]=elevation[index];
+			labels[index]=unlabeled;
+			if(x==x0||x==x1-1||y==y0||y==y1-1)
+				{
+				if(x==0||x==size[0]-1||y==0||y==size[1]-1)
+					labels[index]=0;
+				open.push(QueueEntry(elevation[index],index));
+				}
+			}
+	tile.numLabels=1;
+	tile.edges.clear();
+	
+	/* Inunde el mosaico desde su perímetro; las celdas en fosas se procesan con una cola simple en lugar de la cola de prioridad: */
+	std::vector<unsigned int> pit;
+	size_t pitHead=0;
+	while(!open.empty()||pitHead<pit.size())
+		{
+		unsigned int c;
+		if(pitHead<pit.size())
+			c=pit[pitHead++];
+		else
+			{
+			c=open.top().second;
+			open.pop();
+			}
+		if(pitHead==pit.size())
+			{
+			pit.clear();
+			pitHead=0;
+			}
+		
+		/* Asigne una nueva cuenca local a las semillas del perímetro aún no alcanzadas: */
+		if(labels[c]==unlabeled)
+			labels[c]=tile.numLabels++;
+		float level=localFilled[c];
+		
+		/* Procese los cuatro vecinos de la celda dentro del mosaico; el agua solo fluye a través de las caras de las celdas: */
+		unsigned int cx=c%size[0];
+		unsigned int cy=c/size[0];
+		unsigned int neighbors[4];
+		int numNeighbors=0;
+		if(cx>x0)
+			neighbors[numNeighbors++]=c-1;
+		if(cx<x1-1)
+			neighbors[numNeighbors++]=c+1;
+		if(cy>y0)
+			neighbors[numNeighbors++]=c-size[0];
+		if(cy<y1-1)
+			neighbors[numNeighbors++]=c+size[0];
+		for(int i=0;i<numNeighbors;++i)
+			{
+			unsigned int n=neighbors[i];
+			if(labels[n]!=unlabeled)
+				{
+				/* Registre una conexión de desbordamiento si el vecino pertenece a otra cuenca: */
+				if(labels[n]!=labels[c])
+					{
+					unsigned int l0=Math::min(labels[c],labels[n]);
+					unsigned int l1=Math::max(labels[c],labels[n]);
+					tile.edges.push_back(SpillEdge(l0,l1,Math::max(level,localFilled[n])));
+					}
+				continue;
+				}
+			
+			/* Inunde el vecino: */
+			labels[n]=labels[c];
+			if(localFilled[n]<=level)
+				{
+				localFilled[n]=level;
+				pit.push_back(n);
+				}
+			else
+				open.push(QueueEntry(localFilled[n],n));
+			}
+		}
+	
+	compactEdges(tile.edges);
+	tile.dirty=false;
+	}
+
+void DepressionFiller::solveSpillGraph(void)
+	{
+	/* Asigne índices globales a todas las cuencas locales; la cuenca 0 de todos los mosaicos es el borde del dominio: */
+	unsigned int numLabels=1;
+	for(std::vector<Tile>::iterator tIt=tiles.begin();tIt!=tiles.end();++tIt)
+		{
+		tIt->labelBase=numLabels;
+		numLabels+=tIt->numLabels-1;
+		}
+	
+	/* Reúna todas las conexiones de desbordamiento dentro de los mosaicos y a través de sus bordes: */
+	std::vector<SpillEdge> edges;
+	for(unsigned int ty=0;ty<numTiles[1];++ty)
+		for(unsigned int tx=0;tx<numTiles[0];++tx)
+			{
+			const Tile& tile=tiles[ty*numTiles[0]+tx];
+			for(std::vector<SpillEdge>::const_iterator eIt=tile.edges.begin();eIt!=tile.edges.end();++eIt)
+				{
+				unsigned int l0=eIt->label0==0?0:tile.labelBase+eIt->label0-1;
+				unsigned int l1=eIt->label1==0?0:tile.labelBase+eIt->label1-1;
+				edges.push_back(SpillEdge(l0,l1,eIt->elevation));
+				}
+			
+			/* Conecte las celdas del borde derecho con el mosaico vecino de la derecha: */
+			if(tx<numTiles[0]-1)
+				{
+				const Tile& right=tiles[ty*numTiles[0]+tx+1];
+				unsigned int x=tile.origin[0]+tile.size[0]-1;
+				for(unsigned int y=tile.origin[1];y<tile.origin[1]+tile.size[1];++y)
+					{
+					unsigned int a=y*size[0]+x;
+					unsigned int b=a+1;
+					unsigned int la=labels[a]==0?0:tile.labelBase+labels[a]-1;
+					unsigned int lb=labels[b]==0?0:right.labelBase+labels[b]-1;
+					edges.push_back(SpillEdge(Math::min(la,lb),Math::max(la,lb),Math::max(localFilled[a],localFilled[b])));
+					}
+				}
+			
+			/* Conecte las celdas del borde superior con el mosaico vecino de arriba: */
+			if(ty<numTiles[1]-1)
+				{
+				const Tile& above=tiles[(ty+1)*numTiles[0]+tx];
+				unsigned int y=tile.origin[1]+tile.size[1]-1;
+				for(unsigned int x=tile.origin[0];x<tile.origin[0]+tile.size[0];++x)
+					{
+					unsigned int a=y*size[0]+x;
+					unsigned int b=a+size[0];
+					unsigned int la=labels[a]==0?0:tile.labelBase+labels[a]-1;
+					unsigned int lb=labels[b]==0?0:above.labelBase+labels[b]-1;
+					edges.push_back(SpillEdge(Math::min(la,lb),Math::max(la,lb),Math::max(localFilled[a],localFilled[b])));
+					}
+				}
+			}
+	compactEdges(edges);
+	
+	/* Construya la lista de adyacencia del grafo de cuencas: */
+	std::vector<unsigned int> firstEdge(numLabels+1,0);
+	for(std::vector<SpillEdge>::iterator eIt=edges.begin();eIt!=edges.end();++eIt)
+		if(eIt->label0!=eIt->label1)
+			{
+			++firstEdge[eIt->label0+1];
+			++firstEdge[eIt->label1+1];
+			}
+	for(unsigned int l=0;l<numLabels;++l)
+		firstEdge[l+1]+=firstEdge[l];
+	std::vector<std::pair<unsigned int,float> > adjacency(firstEdge[numLabels]);
+	std::vector<unsigned int> fillPtr(firstEdge.begin(),firstEdge.end()-1);
+	for(std::vector<SpillEdge>::iterator eIt=edges.begin();eIt!=edges.end();++eIt)
+		if(eIt->label0!=eIt->label1)
+			{
+			adjacency[fillPtr[eIt->label0]++]=std::make_pair(eIt->label1,eIt->elevation);
+			adjacency[fillPtr[eIt->label1]++]=std::make_pair(eIt->label0,eIt->elevation);
+			}
+	
+	/* Inunde el grafo de cuencas desde el borde del dominio para calcular el nivel de desbordamiento de cada cuenca: */
+	std::vector<float> spillLevels(numLabels,FLT_MAX);
+	spillLevels[0]=-FLT_MAX;
+	MinQueue queue;
+	queue.push(QueueEntry(spillLevels[0],0));
+	while(!queue.empty())
+		{
+		QueueEntry e=queue.top();
+		queue.pop();
+		if(e.first>spillLevels[e.second])
+			continue;
+		for(unsigned int i=firstEdge[e.second];i<firstEdge[e.second+1];++i)
+			{
+			float level=Math::max(e.first,adjacency[i].second);
+			if(spillLevels[adjacency[i].first]>level)
+				{
+				spillLevels[adjacency[i].first]=level;
+				queue.push(QueueEntry(level,adjacency[i].first));
+				}
+			}
+		}
+	
+	/* Eleve cada celda al nivel de desbordamiento de su cuenca: */
+	for(std::vector<Tile>::iterator tIt=tiles.begin();tIt!=tiles.end();++tIt)
+		for(unsigned int y=tIt->origin[1];y<tIt->origin[1]+tIt->size[1];++y)
+			for(unsigned int x=tIt->origin[0];x<tIt->origin[0]+tIt->size[0];++x)
+				{
+				unsigned int index=y*size[0]+x;
+				float spillLevel=labels[index]==0?-FLT_MAX:spillLevels[tIt->labelBase+labels[index]-1];
+				filled[index]=Math::max(localFilled[index],spillLevel);
+				}
+	}
+
+DepressionFiller::DepressionFiller(unsigned int width,unsigned int height,unsigned int sTileSize)
+	:tileSize(sTileSize),
+	 elevation(0),localFilled(0),labels(0),filled(0),
+	 changeThreshold(0.0f)
+	{
+	/* Inicialice el tamaño de la cuadrícula: */
+	size[0]=width;
+	size[1]=height;
+	
+	/* Asigne las cuadrículas de celdas: */
+	elevation=new float[size[1]*size[0]];
+	localFilled=new float[size[1]*size[0]];
+	labels=new unsigned int[size[1]*size[0]];
+	filled=new float[size[1]*size[0]];
+	for(unsigned int i=0;i<size[1]*size[0];++i)
+		elevation[i]=localFilled[i]=filled[i]=0.0f;
+	
+	/* Divida la cuadrícula en mosaicos; todos necesitan un relleno inicial: */
+	for(int i=0;i<2;++i)
+		numTiles[i]=(size[i]+tileSize-1)/tileSize;
+	tiles.resize(numTiles[1]*numTiles[0]);
+	for(unsigned int ty=0;ty<numTiles[1];++ty)
+		for(unsigned int tx=0;tx<numTiles[0];++tx)
+			{
+			Tile& tile=tiles[ty*numTiles[0]+tx];
+			tile.origin[0]=tx*tileSize;
+			tile.origin[1]=ty*tileSize;
+			tile.size[0]=Math::min(tileSize,size[0]-tile.origin[0]);
+			tile.size[1]=Math::min(tileSize,size[1]-tile.origin[1]);
+			tile.dirty=true;
+			tile.numLabels=1;
+			tile.labelBase=0;
+			}
+	}
+
+DepressionFiller::~DepressionFiller(void)
+	{
+	delete[] elevation;
+	delete[] localFilled;
+	delete[] labels;
+	delete[] filled;
+	}
+
+void DepressionFiller::setChangeThreshold(float newChangeThreshold)
+	{
+	changeThreshold=newChangeThreshold;
+	}
+
+void DepressionFiller::setElevation(const float* newElevation)
+	{
+	/* Compare cada mosaico con la elevación actual y copie solo los mosaicos modificados: */
+	for(std::vector<Tile>::iterator tIt=tiles.begin();tIt!=tiles.end();++tIt)
+		{
+		bool changed=tIt->dirty;
+		for(unsigned int y=tIt->origin[1];y<tIt->origin[1]+tIt->size[1]&&!changed;++y)
+			for(unsigned int x=tIt->origin[0];x<tIt->origin[0]+tIt->size[0]&&!changed;++x)
+				changed=Math::abs(newElevation[y*size[0]+x]-elevation[y*size[0]+x])>changeThreshold;
+		
+		if(changed)
+			{
+			for(unsigned int y=tIt->origin[1];y<tIt->origin[1]+tIt->size[1];++y)
+				for(unsigned int x=tIt->origin[0];x<tIt->origin[0]+tIt->size[0];++x)
+					elevation[y*size[0]+x]=newElevation[y*size[0]+x];
+			tIt->dirty=true;
+			}
+		}
+	}
+
+void DepressionFiller::setBathymetry(const float* bathymetryGrid)
+	{
+	/* Calcule la elevación centrada en las celdas igual que los sombreadores de WaterTable2, promediando los cuatro vértices de cada celda: */
+	unsigned int bw=size[0]-1;
+	unsigned int bh=size[1]-1;
+	std::vector<float> cellElevation(size[1]*size[0]);
+	std::vector<float>::iterator ceIt=cellElevation.begin();
+	for(unsigned int y=0;y<size[1];++y)
+		{
+		const float* row0=bathymetryGrid+(y>0?Math::min(y-1,bh-1):0)*bw;
+		const float* row1=bathymetryGrid+Math::min(y,bh-1)*bw;
+		for(unsigned int x=0;x<size[0];++x,++ceIt)
+			{
+			unsigned int xa=x>0?Math::min(x-1,bw-1):0;
+			unsigned int xb=Math::min(x,bw-1);
+			*ceIt=(row0[xa]+row0[xb]+row1[xa]+row1[xb])*0.25f;
+			}
+		}
+	
+	setElevation(&cellElevation[0]);
+	}
+
+unsigned int DepressionFiller::fill(void)
+	{
+	/* Vuelva a rellenar los mosaicos modificados: */
+	unsigned int numFilledTiles=0;
+	for(std::vector<Tile>::iterator tIt=tiles.begin();tIt!=tiles.end();++tIt)
+		if(tIt->dirty)
+			{
+			fillTile(*tIt);
+			++numFilledTiles;
+			}
+	
+	/* Combine los resultados locales a través del grafo de desbordamiento: */
+	solveSpillGraph();
+	
+	return numFilledTiles;
+	}
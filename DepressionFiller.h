@@ -0,0 +1,99 @@
+/***********************************************************************
+DepressionFiller - Clase para calcular la superficie de agua en
+equilibrio de una cuadrícula de elevación mediante el relleno de
+depresiones por inundación prioritaria, con actualizaciones
+incrementales por mosaicos.
+Copyright (c) 2026 Sergio081096
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#ifndef DEPRESSIONFILLER_INCLUDED
+#define DEPRESSIONFILLER_INCLUDED
+
+#include <vector>
+
+class DepressionFiller
+	{
+	/* Clases integradas: */
+	private:
+	struct SpillEdge // Estructura para una conexión de desbordamiento entre dos cuencas
+		{
+		/* Elementos: */
+		public:
+		unsigned int label0,label1; // Etiquetas de las dos cuencas conectadas
+		float elevation; // Elevación mínima a la que el agua pasa de una cuenca a la otra
+		
+		/* Constructores y destructores: */
+		SpillEdge(unsigned int sLabel0,unsigned int sLabel1,float sElevation)
+			:label0(sLabel0),label1(sLabel1),elevation(sElevation)
+			{
+			}
+		};
+	
+	struct Tile // Estructura para el resultado del relleno local de un mosaico
+		{
+		/* Elementos: */
+		public:
+		unsigned int origin[2]; // Índice de la primera celda del mosaico
+		unsigned int size[2]; // Tamaño del mosaico en celdas
+		bool dirty; // Marcar si la elevación del mosaico cambió desde el último relleno local
+		unsigned int numLabels; // Número de cuencas locales, incluyendo la cuenca del borde del dominio con etiqueta 0
+		unsigned int labelBase; // Índice global de la cuenca local 1 durante la resolución global
+		std::vector<SpillEdge> edges; // Conexiones de desbordamiento entre cuencas locales del mosaico
+		};
+	
+	/* Elementos: */
+	unsigned int size[2]; // Ancho y alto de la cuadrícula de celdas
+	unsigned int tileSize; // Ancho y alto de los mosaicos en celdas
+	unsigned int numTiles[2]; // Número de mosaicos en x e y
+	float* elevation; // Cuadrícula de elevación centrada en las celdas
+	float* localFilled; // Elevación rellenada dentro de cada mosaico, sin tener en cuenta los mosaicos vecinos
+	unsigned int* labels; // Etiqueta de cuenca local de cada celda
+	float* filled; // Superficie de agua en equilibrio de cada celda
+	std::vector<Tile> tiles; // Lista de mosaicos
+	float changeThreshold; // Cambio mínimo de elevación para marcar un mosaico como modificado
+	
+	/* Métodos privados: */
+	void fillTile(Tile& tile); // Rellena las depresiones de un mosaico por inundación prioritaria desde su perímetro
+	void solveSpillGraph(void); // Calcula la elevación de desbordamiento de todas las cuencas y la superficie rellenada final
+	
+	/* Constructores y destructores: */
+	public:
+	DepressionFiller(unsigned int width,unsigned int height,unsigned int sTileSize=64); // Crea un objeto de relleno para una cuadrícula de celdas del tamaño dado
+	private:
+	DepressionFiller(const DepressionFiller& source); // Prohibir copia constructor
+	DepressionFiller& operator=(const DepressionFiller& source); // Prohibir operador de asignación
+	public:
+	~DepressionFiller(void);
+	
+	/* Métodos: */
+	const unsigned int* getSize(void) const // Devuelve el tamaño de la cuadrícula de celdas
+		{
+		return size;
+		}
+	void setChangeThreshold(float newChangeThreshold); // Establece el cambio mínimo de elevación para marcar un mosaico como modificado
+	void setElevation(const float* newElevation); // Establece una nueva cuadrícula de elevación centrada en las celdas; marca los mosaicos modificados
+	void setBathymetry(const float* bathymetryGrid); // Establece la elevación desde una cuadrícula de batimetría centrada en vértices de tamaño de cuadrícula menos 1, como la de WaterTable2
+	unsigned int fill(void); // Actualiza la superficie de agua en equilibrio; vuelve a rellenar solo los mosaicos modificados y devuelve su número
+	const float* getFilled(void) const // Devuelve la superficie de agua en equilibrio más reciente
+		{
+		return filled;
+		}
+	};
+
+#endif
@@ -24,11 +24,13 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 
 #include "DepthImageRenderer.h"
 
+#include <string.h>
 #include <GL/gl.h>
 #include <GL/GLVertexArrayParts.h>
 #include <GL/GLContextData.h>
 #include <GL/Extensions/GLARBFragmentShader.h>
 #include <GL/Extensions/GLARBMultitexture.h>
+#include <GL/Extensions/GLARBPixelBufferObject.h>
 #include <GL/Extensions/GLARBShaderObjects.h>
 #include <GL/Extensions/GLARBTextureFloat.h>
 #include <GL/Extensions/GLARBTextureRectangle.h>
@@ -38,6 +40,8 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 #include <GL/GLTransformationWrappers.h>
 
 #include "ShaderHelper.h"
+#include "ElevationPyramid.h"
+#include "SurfaceMeshDecimator.h"
 
 // DEBUGGING
 #include <iostream>
@@ -49,11 +53,14 @@ Methods of class DepthImageRenderer::DataItem:
 DepthImageRenderer::DataItem::DataItem(void)
 	:vertexBuffer(0),indexBuffer(0),
 	 depthTexture(0),depthTextureVersion(0),
+	 nextDepthPixelBuffer(0),pendingDepthPixelBuffer(-1),pendingDepthImageVersion(0),pendingFrameNumber(0),
+	 lodMeshVersion(0),
 	 depthShader(0),elevationShader(0)
 	{
 	/* Inicialice todas las extensiones requeridas: */
 	GLARBFragmentShader::initExtension();
 	GLARBMultitexture::initExtension();
+	GLARBPixelBufferObject::initExtension();
 	GLARBShaderObjects::initExtension();
 	GLARBTextureFloat::initExtension();
 	GLARBTextureRectangle::initExtension();
@@ -64,7 +71,11 @@ DepthImageRenderer::DataItem::DataItem(void)
 	/* Asignar los buffers y texturas: */
 	glGenBuffersARB(1,&vertexBuffer);
 	glGenBuffersARB(1,&indexBuffer);
+	glGenBuffersARB(2,lodIndexBuffers);
+	for(int i=0;i<2;++i)
+		lodNumIndices[i]=0;
 	glGenTextures(1,&depthTexture);
+	glGenBuffersARB(numDepthPixelBuffers,depthPixelBuffers);
 	}
 
 DepthImageRenderer::DataItem::~DataItem(void)
@@ -72,7 +83,9 @@ DepthImageRenderer::DataItem::~DataItem(void)
 	/* Libere todos los búferes, texturas y sombreadores asignados: */
 	glDeleteBuffersARB(1,&vertexBuffer);
 	glDeleteBuffersARB(1,&indexBuffer);
+	glDeleteBuffersARB(2,lodIndexBuffers);
 	glDeleteTextures(1,&depthTexture);
+	glDeleteBuffersARB(numDepthPixelBuffers,depthPixelBuffers);
 	glDeleteObjectARB(depthShader);
 	glDeleteObjectARB(elevationShader);
 	}
@@ -81,8 +94,161 @@ DepthImageRenderer::DataItem::~DataItem(void)
 Methods of class DepthImageRenderer:
 ***********************************/
 
+void DepthImageRenderer::drawMesh(DepthImageRenderer::MeshLevel level,DepthImageRenderer::DataItem* dataItem) const
+	{
+	GLVertexArrayParts::enable(Vertex::getPartsMask());
+	glVertexPointer(static_cast<const Vertex*>(0));
+	
+	if(level!=FULL_MESH&&meshDecimator!=0)
+		{
+		/* Compruebe si los búferes de índice diezmados están desactualizados: */
+		if(dataItem->lodMeshVersion!=meshVersion)
+			{
+			/* Sube las nuevas mallas diezmadas: */
+			for(int i=0;i<2;++i)
+				{
+				const std::vector<GLuint>& indices=meshDecimator->getIndices(i);
+				glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB,dataItem->lodIndexBuffers[i]);
+				glBufferDataARB(GL_ELEMENT_ARRAY_BUFFER_ARB,indices.size()*sizeof(GLuint),indices.empty()?0:&indices[0],GL_DYNAMIC_DRAW_ARB);
+				dataItem->lodNumIndices[i]=GLsizei(indices.size());
+				}
+			dataItem->lodMeshVersion=meshVersion;
+			}
+		
+		/* Dibuje la malla diezmada si ya existe: */
+		int lodIndex=level==COARSE_MESH?1:0;
+		if(dataItem->lodNumIndices[lodIndex]>0)
+			{
+			glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB,dataItem->lodIndexBuffers[lodIndex]);
+			glDrawElements(GL_TRIANGLES,dataItem->lodNumIndices[lodIndex],GL_UNSIGNED_INT,static_cast<const GLuint*>(0));
+			glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB,dataItem->indexBuffer);
+			GLVertexArrayParts::disable(Vertex::getPartsMask());
+			return;
+			}
+		glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB,dataItem->indexBuffer);
+		}
+	
+	/* Dibuje la malla de tiras cuádruples de resolución completa: */
+	GLuint* indexPtr=0;
+	for(unsigned int y=1;y<depthImageSize[1];++y,indexPtr+=depthImageSize[0]*2)
+		glDrawElements(GL_QUAD_STRIP,depthImageSize[0]*2,GL_UNSIGNED_INT,indexPtr);
+	GLVertexArrayParts::disable(Vertex::getPartsMask());
+	}
+
+void DepthImageRenderer::uploadPendingDepthImage(DepthImageRenderer::DataItem* dataItem) const
+	{
+	/* Sube los subrectángulos modificados desde el búfer de píxeles pendiente; la copia se realiza en la GPU sin bloquear la CPU: */
+	glBindBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB,dataItem->depthPixelBuffers[dataItem->pendingDepthPixelBuffer]);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH,depthImageSize[0]);
+	for(std::vector<Rect>::const_iterator rIt=dataItem->pendingRects.begin();rIt!=dataItem->pendingRects.end();++rIt)
+		{
+		const GLfloat* offset=static_cast<const GLfloat*>(0)+(size_t(rIt->origin[1])*size_t(depthImageSize[0])+size_t(rIt->origin[0]));
+		glTexSubImage2D(GL_TEXTURE_RECTANGLE_ARB,0,rIt->origin[0],rIt->origin[1],rIt->size[0],rIt->size[1],GL_LUMINANCE,GL_FLOAT,offset);
+		}
+	glPixelStorei(GL_UNPACK_ROW_LENGTH,0);
+	glBindBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB,0);
+	
+	/* Marque la textura de profundidad como actual para la versión subida: */
+	dataItem->depthTextureVersion=dataItem->pendingDepthImageVersion;
+	dataItem->pendingDepthPixelBuffer=-1;
+	dataItem->pendingRects.clear();
+	}
+
+void DepthImageRenderer::stageDepthImage(DepthImageRenderer::DataItem* dataItem) const
+	{
+	/* Reúna los mosaicos modificados desde la versión de la textura en rectángulos, uno por racha de mosaicos de cada fila: */
+	std::vector<Rect>& rects=dataItem->pendingRects;
+	rects.clear();
+	size_t numDirtyTiles=0;
+	const unsigned int* tvPtr=&tileVersions[0];
+	for(unsigned int ty=0;ty<numTiles[1];++ty,tvPtr+=numTiles[0])
+		{
+		unsigned int tx=0;
+		while(tx<numTiles[0])
+			{
+			/* Busque el inicio de la siguiente racha de mosaicos modificados: */
+			for(;tx<numTiles[0]&&tvPtr[tx]<=dataItem->depthTextureVersion;++tx)
+				;
+			if(tx==numTiles[0])
+				break;
+			unsigned int tx0=tx;
+			for(;tx<numTiles[0]&&tvPtr[tx]>dataItem->depthTextureVersion;++tx)
+				;
+			numDirtyTiles+=tx-tx0;
+			
+			/* Cree el rectángulo de la racha, recortado a la imagen de profundidad: */
+			Rect r;
+			r.origin[0]=tx0*tileSize;
+			r.origin[1]=ty*tileSize;
+			r.size[0]=tx*tileSize<depthImageSize[0]?tx*tileSize-r.origin[0]:depthImageSize[0]-r.origin[0];
+			r.size[1]=(ty+1)*tileSize<depthImageSize[1]?tileSize:depthImageSize[1]-r.origin[1];
+			rects.push_back(r);
+			}
+		}
+	
+	/* Suba la imagen completa como un solo rectángulo si la mayoría de los mosaicos cambiaron: */
+	if(numDirtyTiles*2>size_t(numTiles[0])*size_t(numTiles[1]))
+		{
+		rects.clear();
+		Rect r;
+		for(int i=0;i<2;++i)
+			{
+			r.origin[i]=0;
+			r.size[i]=depthImageSize[i];
+			}
+		rects.push_back(r);
+		}
+	
+	if(!rects.empty())
+		{
+		/* Desecha el almacenamiento anterior del siguiente búfer de píxeles para no esperar a una subida en curso, y mapéelo: */
+		int bufferIndex=dataItem->nextDepthPixelBuffer;
+		glBindBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB,dataItem->depthPixelBuffers[bufferIndex]);
+		glBufferDataARB(GL_PIXEL_UNPACK_BUFFER_ARB,size_t(depthImageSize[1])*size_t(depthImageSize[0])*sizeof(GLfloat),0,GL_STREAM_DRAW_ARB);
+		GLfloat* bufferPtr=static_cast<GLfloat*>(glMapBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB,GL_WRITE_ONLY_ARB));
+		if(bufferPtr!=0)
+			{
+			/* Copie las filas de los rectángulos modificados en sus posiciones de imagen dentro del búfer: */
+			const GLfloat* imagePtr=depthImage.getData<GLfloat>();
+			for(std::vector<Rect>::const_iterator rIt=rects.begin();rIt!=rects.end();++rIt)
+				for(unsigned int y=rIt->origin[1];y<rIt->origin[1]+rIt->size[1];++y)
+					{
+					size_t offset=size_t(y)*size_t(depthImageSize[0])+size_t(rIt->origin[0]);
+					memcpy(bufferPtr+offset,imagePtr+offset,rIt->size[0]*sizeof(GLfloat));
+					}
+			glUnmapBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB);
+			
+			/* Marque el búfer como pendiente; se subirá a la textura en el siguiente cuadro: */
+			dataItem->pendingDepthPixelBuffer=bufferIndex;
+			dataItem->nextDepthPixelBuffer=(bufferIndex+1)%numDepthPixelBuffers;
+			}
+		glBindBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB,0);
+		
+		if(bufferPtr==0)
+			{
+			/* Vuelva a una subida directa si no se pudo mapear el búfer: */
+			glTexSubImage2D(GL_TEXTURE_RECTANGLE_ARB,0,0,0,depthImageSize[0],depthImageSize[1],GL_LUMINANCE,GL_FLOAT,depthImage.getData<GLfloat>());
+			rects.clear();
+			dataItem->depthTextureVersion=depthImageVersion;
+			return;
+			}
+		}
+	
+	/* Recuerde la versión y el cuadro del búfer pendiente: */
+	dataItem->pendingDepthImageVersion=depthImageVersion;
+	dataItem->pendingFrameNumber=frameNumber;
+	if(rects.empty())
+		{
+		/* Ningún píxel cambió; la textura ya está actualizada: */
+		dataItem->depthTextureVersion=depthImageVersion;
+		}
+	}
+
 DepthImageRenderer::DepthImageRenderer(const unsigned int sDepthImageSize[2])
-	:depthImageVersion(0)
+	:depthImageVersion(0),
+	 frameNumber(0),
+	 elevationPyramid(0),
+	 meshDecimator(0),meshVersion(0)
 	{
 	std::cout<<"12: DepthImageRenderer "<< std::endl;
 	/* Copia el tamaño de la imagen de profundidad: */
@@ -98,6 +264,20 @@ DepthImageRenderer::DepthImageRenderer(const unsigned int sDepthImageSize[2])
 		for(unsigned int x=0;x<depthImageSize[0];++x,++diPtr)
 			*diPtr=0.0f;
 	++depthImageVersion;
+	
+	/* Inicialice los mosaicos de cambio como modificados en la primera versión: */
+	for(int i=0;i<2;++i)
+		numTiles[i]=(depthImageSize[i]+tileSize-1)/tileSize;
+	tileVersions.resize(size_t(numTiles[0])*size_t(numTiles[1]),depthImageVersion);
+	
+	/* Cree la pirámide de elevación para intersecar líneas: */
+	elevationPyramid=new ElevationPyramid(depthImageSize);
+	}
+
+DepthImageRenderer::~DepthImageRenderer(void)
+	{
+	delete elevationPyramid;
+	delete meshDecimator;
 	}
 
 void DepthImageRenderer::initContext(GLContextData& contextData) const
@@ -230,39 +410,87 @@ void DepthImageRenderer::setBasePlane(const Plane& newBasePlane)
 		basePlaneDicEq[i]=GLfloat(dpm(0,i)*bpn[0]+dpm(1,i)*bpn[1]+dpm(2,i)*bpn[2]-dpm(3,i)*bpo);
 		//std::cout<<"basePlaneDicEq "<< basePlaneDicEq[i] << std::endl;
 	}
+	
+	/* Actualice la transformación de la pirámide de elevación: */
+	elevationPyramid->setTransform(depthProjection,basePlane);
 	}
 
-void DepthImageRenderer::setDepthImage(const Kinect::FrameBuffer& newDepthImage)
+void DepthImageRenderer::setMeshDecimation(float fineError,float coarseError)
 	{
-	/* Actualizar la imagen de profundidad: */
-	depthImage=newDepthImage;
-	++depthImageVersion;
+	/* Destruya el diezmador actual: */
+	delete meshDecimator;
+	meshDecimator=0;
+	
+	/* Cree un nuevo diezmador para la proyección de profundidad y el plano base actuales: */
+	if(fineError>0.0f)
+		{
+		meshDecimator=new SurfaceMeshDecimator(depthImageSize,depthProjection,basePlane,fineError,coarseError);
+		meshDecimator->receiveDepthImage(depthImage);
+		}
+	
+	/* Invalide las mallas diezmadas en todos los contextos: */
+	++meshVersion;
 	}
 
-Scalar DepthImageRenderer::intersectLine(const Point& p0,const Point& p1,Scalar elevationMin,Scalar elevationMax) const
+void DepthImageRenderer::setDepthImage(const Kinect::FrameBuffer& newDepthImage)
 	{
-	/* Inicializar el segmento de línea: */
-	Scalar lambda0=Scalar(0);
-	Scalar lambda1=Scalar(1);
-	
-	/* Intersecta el segmento de línea con el plano de elevación superior: */
-	Scalar d0=basePlane.calcDistance(p0);
-	Scalar d1=basePlane.calcDistance(p1);
-	if(d0*d1<Scalar(0))
+	/* Compare la nueva imagen con la anterior para marcar los mosaicos modificados: */
+	++depthImageVersion;
+	const float* oldPtr=depthImage.getData<float>();
+	const float* newPtr=newDepthImage.getData<float>();
+	if(newPtr!=oldPtr)
 		{
-		/* Calcula el parámetro de intersección: */
-		
-		// IMPLEMENT ME!
-		
-		return Scalar(2);
+		for(unsigned int ty=0;ty<numTiles[1];++ty)
+			{
+			unsigned int y0=ty*tileSize;
+			unsigned int y1=y0+tileSize<depthImageSize[1]?y0+tileSize:depthImageSize[1];
+			for(unsigned int tx=0;tx<numTiles[0];++tx)
+				{
+				unsigned int x0=tx*tileSize;
+				unsigned int x1=x0+tileSize<depthImageSize[0]?x0+tileSize:depthImageSize[0];
+				
+				/* Compare las filas del mosaico hasta encontrar un cambio: */
+				bool changed=false;
+				for(unsigned int y=y0;y<y1&&!changed;++y)
+					{
+					size_t offset=size_t(y)*size_t(depthImageSize[0])+size_t(x0);
+					changed=memcmp(oldPtr+offset,newPtr+offset,(x1-x0)*sizeof(float))!=0;
+					}
+				if(changed)
+					tileVersions[size_t(ty)*size_t(numTiles[0])+size_t(tx)]=depthImageVersion;
+				}
+			}
 		}
-	else if(d1>Scalar(0))
+	
+	/* Actualizar la imagen de profundidad: */
+	depthImage=newDepthImage;
+	
+	if(meshDecimator!=0)
 		{
-		/* Rechazo trivial con máxima intercepción: */
-		return Scalar(2);
+		/* Envíe la nueva imagen al diezmador y bloquee la malla diezmada más reciente: */
+		meshDecimator->receiveDepthImage(depthImage);
+		if(meshDecimator->lockNewMesh())
+			++meshVersion;
 		}
+	}
+
+Scalar DepthImageRenderer::intersectLine(const Point& p0,const Point& p1,Scalar elevationMin,Scalar elevationMax) const
+	{
+	/* Actualice la pirámide de elevación si la imagen de profundidad cambió: */
+	elevationPyramid->update(depthImage,depthImageVersion);
 	
-	return Scalar(2);
+	/* Interseca el segmento de línea con la pirámide: */
+	return elevationPyramid->intersectLine(p0,p1,elevationMin,elevationMax);
+	}
+
+void DepthImageRenderer::intersectLines(size_t numLines,const Point* p0s,const Point* p1s,Scalar elevationMin,Scalar elevationMax,Scalar* lambdas) const
+	{
+	/* Actualice la pirámide de elevación una sola vez para todo el lote: */
+	elevationPyramid->update(depthImage,depthImageVersion);
+	
+	/* Interseca todos los segmentos de línea con la pirámide: */
+	for(size_t i=0;i<numLines;++i)
+		lambdas[i]=elevationPyramid->intersectLine(p0s[i],p1s[i],elevationMin,elevationMax);
 	}
 
 void DepthImageRenderer::uploadDepthProjection(GLint location) const
@@ -271,6 +499,14 @@ void DepthImageRenderer::uploadDepthProjection(GLint location) const
 	glUniformMatrix4fvARB(location,1,GL_FALSE,depthProjectionMatrix);
 	}
 
+unsigned int DepthImageRenderer::getDepthTextureVersion(GLContextData& contextData) const
+	{
+	/* Obtener el elemento de datos: */
+	DataItem* dataItem=contextData.retrieveDataItem<DataItem>(this);
+	
+	return dataItem->depthTextureVersion;
+	}
+
 void DepthImageRenderer::bindDepthTexture(GLContextData& contextData) const
 	{
 	/* Obtener el elemento de datos: */
@@ -279,18 +515,23 @@ void DepthImageRenderer::bindDepthTexture(GLContextData& contextData) const
 	/* Enlazar la textura de la imagen de profundidad: */
 	glBindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->depthTexture);
 	
-	/* Compruebe si la textura está desactualizada: */
-	if(dataItem->depthTextureVersion!=depthImageVersion)
+	/* Suba el búfer de píxeles pendiente si se llenó en un cuadro anterior: */
+	if(dataItem->pendingDepthPixelBuffer>=0&&dataItem->pendingFrameNumber!=frameNumber)
+		uploadPendingDepthImage(dataItem);
+	
+	/* Compruebe si hay una imagen de profundidad más nueva que la textura y el búfer pendiente: */
+	if(dataItem->depthTextureVersion!=depthImageVersion&&(dataItem->pendingDepthPixelBuffer<0||dataItem->pendingDepthImageVersion!=depthImageVersion))
 		{
-		/* Sube la nueva textura de profundidad: */
-		glTexSubImage2D(GL_TEXTURE_RECTANGLE_ARB,0,0,0,depthImageSize[0],depthImageSize[1],GL_LUMINANCE,GL_FLOAT,depthImage.getData<GLfloat>());
+		/* Suba primero un búfer pendiente más antiguo, ya que los mosaicos modificados se cuentan desde la versión de la textura: */
+		if(dataItem->pendingDepthPixelBuffer>=0)
+			uploadPendingDepthImage(dataItem);
 		
-		/* Marque la textura de profundidad como actual: */
-		dataItem->depthTextureVersion=depthImageVersion;
+		/* Copie los subrectángulos modificados al siguiente búfer de píxeles del anillo: */
+		stageDepthImage(dataItem);
 		}
 	}
 
-void DepthImageRenderer::renderSurfaceTemplate(GLContextData& contextData) const
+void DepthImageRenderer::renderSurfaceTemplate(GLContextData& contextData,DepthImageRenderer::MeshLevel level) const
 	{
 	/* Obtener el elemento de datos: */
 	DataItem* dataItem=contextData.retrieveDataItem<DataItem>(this);
@@ -300,19 +541,14 @@ void DepthImageRenderer::renderSurfaceTemplate(GLContextData& contextData) const
 	glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB,dataItem->indexBuffer);
 	
 	/* Dibuje la plantilla de superficie: */
-	GLVertexArrayParts::enable(Vertex::getPartsMask());
-	glVertexPointer(static_cast<const Vertex*>(0));
-	GLuint* indexPtr=0;
-	for(unsigned int y=1;y<depthImageSize[1];++y,indexPtr+=depthImageSize[0]*2)
-		glDrawElements(GL_QUAD_STRIP,depthImageSize[0]*2,GL_UNSIGNED_INT,indexPtr);
-	GLVertexArrayParts::disable(Vertex::getPartsMask());
+	drawMesh(level,dataItem);
 	
 	/* Desenlazar los buffers de vértice e índice: */
 	glBindBufferARB(GL_ARRAY_BUFFER_ARB,0);
 	glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB,0);
 	}
 
-void DepthImageRenderer::renderDepth(const PTransform& projectionModelview,GLContextData& contextData) const
+void DepthImageRenderer::renderDepth(const PTransform& projectionModelview,GLContextData& contextData,DepthImageRenderer::MeshLevel level) const
 	{
 	/* Get the data item: */
 	DataItem* dataItem=contextData.retrieveDataItem<DataItem>(this);
@@ -345,12 +581,7 @@ void DepthImageRenderer::renderDepth(const PTransform& projectionModelview,GLCon
 	glUniformARB(dataItem->depthShaderUniforms[1],pmvdp);
 	
 	/* Dibuja la superficie: */
-	GLVertexArrayParts::enable(Vertex::getPartsMask());
-	glVertexPointer(static_cast<const Vertex*>(0));
-	GLuint* indexPtr=0;
-	for(unsigned int y=1;y<depthImageSize[1];++y,indexPtr+=depthImageSize[0]*2)
-		glDrawElements(GL_QUAD_STRIP,depthImageSize[0]*2,GL_UNSIGNED_INT,indexPtr);
-	GLVertexArrayParts::disable(Vertex::getPartsMask());
+	drawMesh(level,dataItem);
 	
 	/* Desenlazar todas las texturas y buffers: */
 	glBindTexture(GL_TEXTURE_RECTANGLE_ARB,0);
@@ -361,7 +592,7 @@ void DepthImageRenderer::renderDepth(const PTransform& projectionModelview,GLCon
 	glUseProgramObjectARB(0);
 	}
 
-void DepthImageRenderer::renderElevation(const PTransform& projectionModelview,GLContextData& contextData) const
+void DepthImageRenderer::renderElevation(const PTransform& projectionModelview,GLContextData& contextData,DepthImageRenderer::MeshLevel level) const
 	{
 	/* Obtener el elemento de datos: */
 	DataItem* dataItem=contextData.retrieveDataItem<DataItem>(this);
@@ -400,12 +631,7 @@ void DepthImageRenderer::renderElevation(const PTransform& projectionModelview,G
 	glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB,dataItem->indexBuffer);
 	
 	/* Dibuja la superficie: */
-	GLVertexArrayParts::enable(Vertex::getPartsMask());
-	glVertexPointer(static_cast<const Vertex*>(0));
-	GLuint* indexPtr=0;
-	for(unsigned int y=1;y<depthImageSize[1];++y,indexPtr+=depthImageSize[0]*2)
-		glDrawElements(GL_QUAD_STRIP,depthImageSize[0]*2,GL_UNSIGNED_INT,indexPtr);
-	GLVertexArrayParts::disable(Vertex::getPartsMask());
+	drawMesh(level,dataItem);
 	
 	/* Desenlazar todas las texturas y buffers: */
 	glBindBufferARB(GL_ARRAY_BUFFER_ARB,0);
@@ -25,6 +25,8 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 #ifndef DEPTHIMAGERENDERER_INCLUDED
 #define DEPTHIMAGERENDERER_INCLUDED
 
+#include <stddef.h>
+#include <vector>
 #include <GL/gl.h>
 #include <GL/Extensions/GLARBShaderObjects.h>
 #include <GL/GLObject.h>
@@ -34,12 +36,35 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 
 #include "Types.h"
 
+/* Declaraciones avanzadas: */
+class SurfaceMeshDecimator;
+class ElevationPyramid;
+
 class DepthImageRenderer:public GLObject
 	{
 	/* Clases integradas: */
+	public:
+	enum MeshLevel // Enumerado para los niveles de detalle de la malla de superficie
+		{
+		FULL_MESH, // Malla de tiras cuádruples de resolución completa
+		FINE_MESH, // Malla diezmada fina, o de resolución completa si el diezmado está desactivado
+		COARSE_MESH // Malla diezmada gruesa para pases de sombra y contorno, o de resolución completa si el diezmado está desactivado
+		};
+	
 	private:
 	typedef GLGeometry::Vertex<void,0,void,0,void,GLfloat,2> Vertex; // Escriba para vértices de plantilla
 	
+	struct Rect // Estructura para un subrectángulo de la imagen de profundidad
+		{
+		/* Elementos: */
+		public:
+		unsigned int origin[2]; // Píxel inferior izquierdo del rectángulo
+		unsigned int size[2]; // Ancho y alto del rectángulo en píxeles
+		};
+	
+	static const unsigned int tileSize=32; // Lado en píxeles de los mosaicos con los que se rastrean los cambios de la imagen de profundidad
+	static const int numDepthPixelBuffers=2; // Número de búferes de píxeles en el anillo de subida de la textura de profundidad
+	
 	struct DataItem:public GLObject::DataItem // Estructura que almacena el estado OpenGL por contexto
 		{
 		/* Elementos: */
@@ -50,6 +75,15 @@ class DepthImageRenderer:public GLObject
 		GLuint indexBuffer; // ID del objeto buffer de índice que contiene triángulos de superficie
 		GLuint depthTexture; // ID del objeto de textura que sostiene las elevaciones de vértices de la superficie en el espacio de imagen de profundidad
 		unsigned int depthTextureVersion; // Número de versión de la textura de la imagen de profundidad.
+		GLuint depthPixelBuffers[numDepthPixelBuffers]; // Anillo de búferes de píxeles para subir la imagen de profundidad a la textura
+		int nextDepthPixelBuffer; // Índice del siguiente búfer de píxeles del anillo a llenar
+		int pendingDepthPixelBuffer; // Índice del búfer de píxeles lleno que aún no se subió a la textura, o -1
+		unsigned int pendingDepthImageVersion; // Número de versión de la imagen de profundidad en el búfer de píxeles pendiente
+		unsigned int pendingFrameNumber; // Número de cuadro en el que se llenó el búfer de píxeles pendiente
+		std::vector<Rect> pendingRects; // Subrectángulos modificados en el búfer de píxeles pendiente
+		GLuint lodIndexBuffers[2]; // IDs de los objetos de búfer de índice que contienen las mallas diezmadas fina y gruesa
+		GLsizei lodNumIndices[2]; // Número de índices en los búferes de índice diezmados
+		unsigned int lodMeshVersion; // Número de versión de las mallas diezmadas en los búferes de índice
 		
 		/* Gestión de sombreadores GLSL: */
 		GLhandleARB depthShader; // Programa de sombreado para representar solo la profundidad de la superficie
@@ -74,10 +108,26 @@ class DepthImageRenderer:public GLObject
 	/* Estado transitorio: */
 	Kinect::FrameBuffer depthImage; // La imagen de profundidad de píxel flotante más reciente
 	unsigned int depthImageVersion; // Número de versión de la imagen de profundidad.
+	unsigned int numTiles[2]; // Número de mosaicos de cambio en cada dirección
+	std::vector<unsigned int> tileVersions; // Número de versión de la imagen de profundidad en la que cambió cada mosaico por última vez
+	unsigned int frameNumber; // Número del cuadro de aplicación actual, para retrasar las subidas de textura un cuadro
+	ElevationPyramid* elevationPyramid; // Pirámide de elevaciones mínimas y máximas para intersecar líneas con la superficie, actualizada bajo demanda
+	SurfaceMeshDecimator* meshDecimator; // Diezmador de fondo de la malla de superficie, o nulo si el diezmado está desactivado
+	unsigned int meshVersion; // Número de versión de las mallas diezmadas bloqueadas
+	
+	/* Métodos privados: */
+	void drawMesh(MeshLevel level,DataItem* dataItem) const; // Dibuja la malla de superficie del nivel dado con los búferes de vértice e índice ya enlazados
+	void uploadPendingDepthImage(DataItem* dataItem) const; // Sube el búfer de píxeles pendiente a la textura de profundidad enlazada
+	void stageDepthImage(DataItem* dataItem) const; // Copia los subrectángulos modificados desde la versión de la textura al siguiente búfer de píxeles del anillo
 	
 	/* Constructores y destructores: */
 	public:
 	DepthImageRenderer(const unsigned int sDepthImageSize[2]); // Crea un renderizador de elevación para el tamaño de imagen de profundidad dado
+	private:
+	DepthImageRenderer(const DepthImageRenderer& source); // Prohibir copia constructor
+	DepthImageRenderer& operator=(const DepthImageRenderer& source); // Prohibir operador de asignación
+	public:
+	virtual ~DepthImageRenderer(void);
 	
 	/* Métodos de GLObject: */
 	virtual void initContext(GLContextData& contextData) const;
@@ -102,17 +152,24 @@ class DepthImageRenderer:public GLObject
 	void setDepthProjection(const PTransform& newDepthProjection); // Establece una nueva matriz de proyección de profundidad
 	void setIntrinsics(const Kinect::FrameSource::IntrinsicParameters& ips); // Establece una nueva matriz de proyección de profundidad y, si está presente, parámetros de distorsión de lente 2D
 	void setBasePlane(const Plane& newBasePlane); // Establece un nuevo plano base para la representación de elevación
+	void setMeshDecimation(float fineError,float coarseError); // Activa las mallas de superficie diezmadas con los errores máximos de elevación dados en unidades del espacio de la cámara; un error fino de cero las desactiva
 	void setDepthImage(const Kinect::FrameBuffer& newDepthImage); // Establece una nueva imagen de profundidad para la posterior representación de la superficie.
-	Scalar intersectLine(const Point& p0,const Point& p1,Scalar elevationMin,Scalar elevationMax) const; // Interseca un segmento de línea con la imagen de profundidad actual en el espacio de la cámara; devuelve el parámetro del punto de intersección a lo largo de la línea
+	void frame(void) // Llamado una vez por cuadro de aplicación para avanzar las subidas de textura pendientes
+		{
+		++frameNumber;
+		}
+	Scalar intersectLine(const Point& p0,const Point& p1,Scalar elevationMin,Scalar elevationMax) const; // Interseca un segmento de línea con la imagen de profundidad actual en el espacio de la cámara; devuelve el parámetro del punto de intersección a lo largo de la línea, o 2 si no hay intersección
+	void intersectLines(size_t numLines,const Point* p0s,const Point* p1s,Scalar elevationMin,Scalar elevationMax,Scalar* lambdas) const; // Interseca un lote de segmentos de línea con la imagen de profundidad actual; escribe los parámetros de intersección en la matriz dada
 	unsigned int getDepthImageVersion(void) const // Devuelve el número de versión de la imagen de profundidad actual
 		{
 		return depthImageVersion;
 		}
 	void uploadDepthProjection(GLint location) const; // Carga la matriz de proyección de profundidad en la matriz GLSL 4x4 en la ubicación uniforme dada
+	unsigned int getDepthTextureVersion(GLContextData& contextData) const; // Devuelve el número de versión de la imagen de profundidad que contiene la textura del contexto dado; puede ir un cuadro detrás de la versión actual
 	void bindDepthTexture(GLContextData& contextData) const; // Vincula la imagen de textura de profundidad actualizada a la unidad de textura activa actualmente
-	void renderSurfaceTemplate(GLContextData& contextData) const; // Representa la malla de la tira cuádruple de la plantilla utilizando la configuración actual de OpenGL
-	void renderDepth(const PTransform& projectionModelview,GLContextData& contextData) const; // Representa la superficie en un búfer de profundidad pura, para el sacrificio inicial de z o pases de sombra, etc.
-	void renderElevation(const PTransform& projectionModelview,GLContextData& contextData) const; // Representa la elevación de la superficie en relación con el plano base en el búfer de marco con valor de coma flotante de un componente actual
+	void renderSurfaceTemplate(GLContextData& contextData,MeshLevel level=FINE_MESH) const; // Representa la malla de la plantilla del nivel dado utilizando la configuración actual de OpenGL
+	void renderDepth(const PTransform& projectionModelview,GLContextData& contextData,MeshLevel level=COARSE_MESH) const; // Representa la superficie en un búfer de profundidad pura, para el sacrificio inicial de z o pases de sombra, etc.
+	void renderElevation(const PTransform& projectionModelview,GLContextData& contextData,MeshLevel level=FINE_MESH) const; // Representa la elevación de la superficie en relación con el plano base en el búfer de marco con valor de coma flotante de un componente actual
 	};
 
 #endif
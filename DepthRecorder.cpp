@@ -0,0 +1,231 @@
+/***********************************************************************
+DepthRecorder - Clase para grabar los marcos de profundidad sin procesar
+de una cámara 3D, y opcionalmente sus marcos de color, en un archivo de
+grabación compacto desde un hilo de fondo.
+Copyright (c) 2026 Sergio081096
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include "DepthRecorder.h"
+
+#include <stdexcept>
+
+#include "DepthRecordingFile.h"
+
+/******************************
+Methods of class DepthRecorder:
+******************************/
+
+void DepthRecorder::writeFrame(const DepthRecorder::Frame& frame)
+	{
+	/* Codifique un cuadro clave en intervalos regulares de cada flujo, o diferencias con el marco anterior del mismo flujo: */
+	Misc::UInt32 flags=0U;
+	if(frame.color)
+		{
+		bool keyframe=numColorFrames%keyframeInterval==0;
+		size_t frameBytes=size_t(colorSize[1])*size_t(colorSize[0])*DepthRecordingFile::colorPixelSize;
+		DepthRecordingFile::encodeColorFrame(frame.buffer.getData<unsigned char>(),keyframe?0:previousColorFrame.getData<unsigned char>(),frameBytes,planeBuffer,frameData);
+		previousColorFrame=frame.buffer;
+		++numColorFrames;
+		flags=DepthRecordingFile::COLOR;
+		if(keyframe)
+			flags|=DepthRecordingFile::KEYFRAME;
+		}
+	else
+		{
+		bool keyframe=numDepthFrames%keyframeInterval==0;
+		DepthRecordingFile::encodeDepthFrame(frame.buffer.getData<Misc::UInt16>(),keyframe?0:previousDepthFrame.getData<Misc::UInt16>(),depthSize,planeBuffer,frameData);
+		previousDepthFrame=frame.buffer;
+		++numDepthFrames;
+		if(keyframe)
+			flags|=DepthRecordingFile::KEYFRAME;
+		}
+	
+	/* Escribe el fragmento del marco y agréguelo al índice: */
+	const std::vector<unsigned char>* blocks[DepthRecordingFile::numChunkBlocks]={&frameData};
+	file.writeChunk(frame.color?DepthRecordingFile::colorChunkTag:DepthRecordingFile::depthChunkTag,flags,frame.buffer.timeStamp,DepthRecordingFile::numChunkBlocks,blocks);
+	}
+
+void* DepthRecorder::writerThreadMethod(void)
+	{
+	bool ok=true;
+	while(true)
+		{
+		/* Espere hasta que haya un marco en espera o el programa se apague con las colas vacías: */
+		Frame frame;
+		{
+		Threads::MutexCond::Lock frameLock(frameCond);
+		while(runWriterThread&&depthFrames.empty()&&colorFrames.empty())
+			frameCond.wait(frameLock);
+		if(depthFrames.empty()&&colorFrames.empty())
+			break;
+		
+		/* Tome el marco más antiguo de ambas colas para que el archivo quede en orden cronológico: */
+		std::deque<Frame>& queue=colorFrames.empty()||(!depthFrames.empty()&&depthFrames.front().buffer.timeStamp<=colorFrames.front().buffer.timeStamp)?depthFrames:colorFrames;
+		frame=queue.front();
+		queue.pop_front();
+		}
+		
+		/* Escribe el marco a menos que una escritura anterior haya fallado: */
+		if(ok)
+			{
+			try
+				{
+				writeFrame(frame);
+				}
+			catch(const std::runtime_error& err)
+				{
+				/* Deje de escribir y guarde el error para el hilo principal: */
+				Threads::MutexCond::Lock frameLock(frameCond);
+				error=err.what();
+				ok=false;
+				}
+			}
+		}
+	
+	if(ok)
+		{
+		try
+			{
+			/* Cierre el archivo con su índice: */
+			file.close();
+			}
+		catch(const std::runtime_error& err)
+			{
+			Threads::MutexCond::Lock frameLock(frameCond);
+			error=err.what();
+			}
+		}
+	
+	return 0;
+	}
+
+void DepthRecorder::addFrame(const Kinect::FrameBuffer& buffer,bool color)
+	{
+	/* Descarte el marco si la cola de su flujo está llena para no bloquear nunca el hilo de transmisión de la cámara; cada flujo tiene su propia cola para que los marcos de color nunca desplacen a los de profundidad: */
+	Threads::MutexCond::Lock frameLock(frameCond);
+	std::deque<Frame>& queue=color?colorFrames:depthFrames;
+	if(queue.size()>=maxQueuedFrames)
+		{
+		if(color)
+			++numDroppedColorFrames;
+		else
+			++numDroppedDepthFrames;
+		return;
+		}
+	
+	/* Agregue el marco a la cola sin copiarlo y despierte el hilo de escritura: */
+	Frame frame;
+	frame.color=color;
+	frame.buffer=buffer;
+	queue.push_back(frame);
+	frameCond.signal();
+	}
+
+DepthRecorder::DepthRecorder(const char* fileName,Kinect::FrameSource& camera,const DepthRecorder::PixelCorrection* pixelCorrection,bool recordColor,unsigned int sKeyframeInterval)
+	:keyframeInterval(sKeyframeInterval>0?sKeyframeInterval:1),
+	 maxQueuedFrames(8),
+	 file(fileName,DepthRecordingFile::trailerMagic),
+	 numDepthFrames(0),numColorFrames(0),
+	 numDroppedDepthFrames(0),numDroppedColorFrames(0),
+	 runWriterThread(false)
+	{
+	/* Copie los tamaños de los marcos: */
+	for(int i=0;i<2;++i)
+		{
+		depthSize[i]=camera.getActualFrameSize(Kinect::FrameSource::DEPTH)[i];
+		colorSize[i]=recordColor?camera.getActualFrameSize(Kinect::FrameSource::COLOR)[i]:0U;
+		}
+	
+	/* Escribe el encabezado del archivo: */
+	Kinect::FrameSource::IntrinsicParameters ips=camera.getIntrinsicParameters();
+	Kinect::FrameSource::ExtrinsicParameters eps=camera.getExtrinsicParameters();
+	Kinect::FrameSource::DepthRange depthRange=camera.getDepthRange();
+	Misc::UInt32 typeSizes[3]={sizeof(ips),sizeof(eps),sizeof(depthRange)};
+	size_t numPixels=size_t(depthSize[1])*size_t(depthSize[0]);
+	Misc::UInt64 dataOffset=DepthRecordingFile::headerSize+typeSizes[0]+typeSizes[1]+typeSizes[2];
+	if(pixelCorrection!=0)
+		dataOffset+=numPixels*2*sizeof(Misc::Float32);
+	IO::File& header=file.getFile();
+	header.write<char>(DepthRecordingFile::fileMagic,8);
+	header.write<Misc::UInt32>(DepthRecordingFile::fileVersion);
+	header.write<Misc::UInt32>(depthSize,2);
+	header.write<Misc::UInt32>(colorSize,2);
+	header.write<Misc::UInt32>(keyframeInterval);
+	header.write<Misc::UInt32>(typeSizes,3);
+	header.write<Misc::UInt32>(pixelCorrection!=0?1U:0U);
+	header.write<Misc::UInt64>(dataOffset);
+	Misc::UInt32 reserved[2]={0U,0U};
+	header.write<Misc::UInt32>(reserved,2);
+	
+	/* Escribe los parámetros de la cámara y la corrección de profundidad por píxel: */
+	header.write<char>(reinterpret_cast<const char*>(&ips),sizeof(ips));
+	header.write<char>(reinterpret_cast<const char*>(&eps),sizeof(eps));
+	header.write<char>(reinterpret_cast<const char*>(&depthRange),sizeof(depthRange));
+	if(pixelCorrection!=0)
+		for(size_t i=0;i<numPixels;++i)
+			{
+			header.write<Misc::Float32>(pixelCorrection[i].scale);
+			header.write<Misc::Float32>(pixelCorrection[i].offset);
+			}
+	file.startChunks(dataOffset);
+	
+	/* Inicie el hilo de escritura: */
+	runWriterThread=true;
+	writerThread.start(this,&DepthRecorder::writerThreadMethod);
+	}
+
+DepthRecorder::~DepthRecorder(void)
+	{
+	/* Apague el hilo de escritura después de que escriba los marcos en espera y el índice: */
+	{
+	Threads::MutexCond::Lock frameLock(frameCond);
+	runWriterThread=false;
+	frameCond.signal();
+	}
+	writerThread.join();
+	}
+
+void DepthRecorder::addDepthFrame(const Kinect::FrameBuffer& buffer)
+	{
+	addFrame(buffer,false);
+	}
+
+void DepthRecorder::addColorFrame(const Kinect::FrameBuffer& buffer)
+	{
+	if(hasColor())
+		addFrame(buffer,true);
+	}
+
+size_t DepthRecorder::getNumDroppedDepthFrames(void)
+	{
+	Threads::MutexCond::Lock frameLock(frameCond);
+	return numDroppedDepthFrames;
+	}
+
+size_t DepthRecorder::getNumDroppedColorFrames(void)
+	{
+	Threads::MutexCond::Lock frameLock(frameCond);
+	return numDroppedColorFrames;
+	}
+
+std::string DepthRecorder::getError(void)
+	{
+	Threads::MutexCond::Lock frameLock(frameCond);
+	return error;
+	}
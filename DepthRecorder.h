@@ -0,0 +1,104 @@
+/***********************************************************************
+DepthRecorder - Clase para grabar los marcos de profundidad sin procesar
+de una cámara 3D, y opcionalmente sus marcos de color, en un archivo de
+grabación compacto desde un hilo de fondo.
+Copyright (c) 2026 Sergio081096
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#ifndef DEPTHRECORDER_INCLUDED
+#define DEPTHRECORDER_INCLUDED
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <Misc/SizedTypes.h>
+#include <Threads/MutexCond.h>
+#include <Threads/Thread.h>
+#include <Kinect/FrameBuffer.h>
+#include <Kinect/FrameSource.h>
+
+#include "ChunkedFile.h"
+
+class DepthRecorder
+	{
+	/* Clases integradas: */
+	public:
+	typedef Kinect::FrameSource::DepthCorrection::PixelCorrection PixelCorrection; // Tipo para factores de corrección de profundidad por píxel
+	
+	private:
+	struct Frame // Estructura para un marco en espera de ser escrito
+		{
+		/* Elementos: */
+		public:
+		bool color; // Marcar si el marco es un marco de color
+		Kinect::FrameBuffer buffer; // El marco; los búferes de marco son de solo lectura y se comparten sin copiarlos
+		};
+	
+	/* Elementos: */
+	unsigned int depthSize[2]; // Ancho y alto de los marcos de profundidad
+	unsigned int colorSize[2]; // Ancho y alto de los marcos de color; cero si no se graba el color
+	unsigned int keyframeInterval; // Número de marcos de cada flujo entre cuadros clave
+	size_t maxQueuedFrames; // Número máximo de marcos en espera de cada flujo antes de descartar marcos nuevos de ese flujo
+	
+	/* Estado del hilo de escritura: */
+	ChunkedFile::Writer file; // El archivo de grabación con el índice de todos los marcos escritos
+	unsigned int numDepthFrames; // Número de marcos de profundidad escritos
+	unsigned int numColorFrames; // Número de marcos de color escritos
+	Kinect::FrameBuffer previousDepthFrame; // Marco de profundidad escrito anterior
+	Kinect::FrameBuffer previousColorFrame; // Marco de color escrito anterior
+	std::vector<unsigned char> planeBuffer; // Búfer para los residuos de un marco
+	std::vector<unsigned char> frameData; // Datos comprimidos de un marco
+	
+	/* Estado compartido entre los hilos: */
+	Threads::MutexCond frameCond; // Variable de condición para señalar la llegada de un nuevo marco
+	std::deque<Frame> depthFrames; // Cola de marcos de profundidad en espera de ser escritos
+	std::deque<Frame> colorFrames; // Cola de marcos de color en espera de ser escritos
+	size_t numDroppedDepthFrames; // Número de marcos de profundidad descartados porque su cola estaba llena
+	size_t numDroppedColorFrames; // Número de marcos de color descartados porque su cola estaba llena
+	std::string error; // Mensaje de error si la escritura falló
+	volatile bool runWriterThread; // Marcar para mantener en ejecución el hilo de escritura
+	Threads::Thread writerThread; // El hilo de escritura
+	
+	/* Métodos privados: */
+	void writeFrame(const Frame& frame); // Codifica y escribe un marco en el archivo
+	void* writerThreadMethod(void); // Método para el hilo de escritura
+	void addFrame(const Kinect::FrameBuffer& buffer,bool color); // Agrega un marco a la cola de escritura de su flujo, o lo descarta si esa cola está llena
+	
+	/* Constructores y destructores: */
+	public:
+	DepthRecorder(const char* fileName,Kinect::FrameSource& camera,const PixelCorrection* pixelCorrection,bool recordColor,unsigned int sKeyframeInterval); // Crea un archivo de grabación con los parámetros de la cámara dada y su corrección de profundidad por píxel, que puede ser NULL
+	private:
+	DepthRecorder(const DepthRecorder& source); // Prohibir copia constructor
+	DepthRecorder& operator=(const DepthRecorder& source); // Prohibir operador de asignación
+	public:
+	~DepthRecorder(void); // Escribe los marcos en espera y el índice, y cierra el archivo
+	
+	/* Métodos: */
+	bool hasColor(void) const // Devuelve verdadero si se graban los marcos de color
+		{
+		return colorSize[0]!=0&&colorSize[1]!=0;
+		}
+	void addDepthFrame(const Kinect::FrameBuffer& buffer); // Agrega un marco de profundidad a la grabación; se puede llamar desde el hilo de transmisión de la cámara
+	void addColorFrame(const Kinect::FrameBuffer& buffer); // Agrega un marco de color a la grabación; se puede llamar desde el hilo de transmisión de la cámara
+	size_t getNumDroppedDepthFrames(void); // Devuelve el número de marcos de profundidad descartados hasta ahora
+	size_t getNumDroppedColorFrames(void); // Devuelve el número de marcos de color descartados hasta ahora
+	std::string getError(void); // Devuelve el mensaje de error si la escritura falló, o una cadena vacía
+	};
+
+#endif
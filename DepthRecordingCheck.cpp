@@ -0,0 +1,322 @@
+/***********************************************************************
+DepthRecordingCheck - Utilidad que comprueba el grabador y la fuente de
+reproducción de marcos de profundidad y de color: graba marcos
+sintéticos, los reproduce desde el inicio y desde un tiempo intermedio,
+y vuelve a reproducirlos tras cortar el índice y el último marco.
+Copyright (c) 2026 Sergio081096
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <vector>
+#include <iostream>
+#include <stdexcept>
+#include <Misc/SizedTypes.h>
+#include <Misc/FunctionCalls.h>
+#include <Threads/MutexCond.h>
+#include <Kinect/FrameBuffer.h>
+#include <Kinect/FrameSource.h>
+
+#include "ChunkedFile.h"
+#include "DepthRecorder.h"
+#include "DepthRecordingFrameSource.h"
+
+namespace {
+
+/**************
+Helper classes:
+**************/
+
+class SyntheticCamera:public Kinect::FrameSource // Cámara que solo informa del tamaño de sus marcos y de sus parámetros
+	{
+	/* Elementos: */
+	private:
+	unsigned int depthSize[2]; // Ancho y alto de los marcos de profundidad
+	unsigned int colorSize[2]; // Ancho y alto de los marcos de color
+	
+	/* Constructores y destructores: */
+	public:
+	SyntheticCamera(const unsigned int sDepthSize[2],const unsigned int sColorSize[2])
+		{
+		for(int i=0;i<2;++i)
+			{
+			depthSize[i]=sDepthSize[i];
+			colorSize[i]=sColorSize[i];
+			}
+		}
+	
+	/* Métodos de la clase Kinect::FrameSource: */
+	virtual DepthCorrection* getDepthCorrectionParameters(void)
+		{
+		return 0;
+		}
+	virtual IntrinsicParameters getIntrinsicParameters(void)
+		{
+		return IntrinsicParameters();
+		}
+	virtual ExtrinsicParameters getExtrinsicParameters(void)
+		{
+		return ExtrinsicParameters();
+		}
+	virtual const unsigned int* getActualFrameSize(int sensor) const
+		{
+		return sensor==COLOR?colorSize:depthSize;
+		}
+	virtual DepthRange getDepthRange(void) const
+		{
+		return DepthRange();
+		}
+	virtual void startStreaming(StreamingCallback* newColorStreamingCallback,StreamingCallback* newDepthStreamingCallback)
+		{
+		delete newColorStreamingCallback;
+		delete newDepthStreamingCallback;
+		}
+	virtual void stopStreaming(void)
+		{
+		}
+	};
+
+class FrameSink // Clase que compara los marcos reproducidos con los marcos grabados
+	{
+	/* Elementos: */
+	private:
+	const std::vector<Kinect::FrameBuffer>& depthFrames; // Marcos de profundidad grabados
+	const std::vector<Kinect::FrameBuffer>& colorFrames; // Marcos de color grabados
+	size_t depthFrameSize; // Tamaño de un marco de profundidad en bytes
+	size_t colorFrameSize; // Tamaño de un marco de color en bytes
+	Threads::MutexCond frameCond; // Protege los contadores contra el hilo de reproducción
+	unsigned int numDepthFrames; // Número de marcos de profundidad recibidos
+	unsigned int numColorFrames; // Número de marcos de color recibidos
+	unsigned int numBadFrames; // Número de marcos recibidos distintos del marco grabado con la misma marca de tiempo
+	
+	/* Métodos privados: */
+	static bool matches(const Kinect::FrameBuffer& frame,const std::vector<Kinect::FrameBuffer>& frames,size_t frameSize) // Devuelve verdadero si algún marco grabado tiene la marca de tiempo y el contenido del marco dado
+		{
+		for(std::vector<Kinect::FrameBuffer>::const_iterator fIt=frames.begin();fIt!=frames.end();++fIt)
+			if(fIt->timeStamp==frame.timeStamp)
+				return memcmp(fIt->getData<unsigned char>(),frame.getData<unsigned char>(),frameSize)==0;
+		return false;
+		}
+	
+	/* Constructores y destructores: */
+	public:
+	FrameSink(const std::vector<Kinect::FrameBuffer>& sDepthFrames,const std::vector<Kinect::FrameBuffer>& sColorFrames,size_t sDepthFrameSize,size_t sColorFrameSize)
+		:depthFrames(sDepthFrames),colorFrames(sColorFrames),
+		 depthFrameSize(sDepthFrameSize),colorFrameSize(sColorFrameSize),
+		 numDepthFrames(0),numColorFrames(0),numBadFrames(0)
+		{
+		}
+	
+	/* Métodos: */
+	void depthFrameCallback(const Kinect::FrameBuffer& frame)
+		{
+		bool ok=matches(frame,depthFrames,depthFrameSize);
+		Threads::MutexCond::Lock frameLock(frameCond);
+		++numDepthFrames;
+		if(!ok)
+			++numBadFrames;
+		}
+	void colorFrameCallback(const Kinect::FrameBuffer& frame)
+		{
+		bool ok=matches(frame,colorFrames,colorFrameSize);
+		Threads::MutexCond::Lock frameLock(frameCond);
+		++numColorFrames;
+		if(!ok)
+			++numBadFrames;
+		}
+	bool waitForFrames(unsigned int expectedNumFrames) // Espera hasta diez segundos a recibir el número total de marcos dado
+		{
+		for(int i=0;i<10000;++i)
+			{
+			{
+			Threads::MutexCond::Lock frameLock(frameCond);
+			if(numDepthFrames+numColorFrames>=expectedNumFrames)
+				return true;
+			}
+			usleep(1000);
+			}
+		return false;
+		}
+	unsigned int getNumDepthFrames(void)
+		{
+		Threads::MutexCond::Lock frameLock(frameCond);
+		return numDepthFrames;
+		}
+	unsigned int getNumColorFrames(void)
+		{
+		Threads::MutexCond::Lock frameLock(frameCond);
+		return numColorFrames;
+		}
+	unsigned int getNumBadFrames(void)
+		{
+		Threads::MutexCond::Lock frameLock(frameCond);
+		return numBadFrames;
+		}
+	};
+
+/****************
+Helper functions:
+****************/
+
+bool check(const char* name,double value,double expected,double tolerance)
+	{
+	bool ok=fabs(value-expected)<=tolerance;
+	std::cout<<name<<' '<<value<<" (expected "<<expected<<") "<<(ok?"ok":"FAILED")<<std::endl;
+	return ok;
+	}
+
+bool checkReplay(const char* name,const char* fileName,double startTime,const std::vector<Kinect::FrameBuffer>& depthFrames,const std::vector<Kinect::FrameBuffer>& colorFrames,size_t depthFrameSize,size_t colorFrameSize,unsigned int expectedNumDepthFrames,unsigned int expectedNumColorFrames) // Reproduce el archivo lo más rápido posible desde el tiempo dado y compara los marcos recibidos
+	{
+	std::cout<<name<<':'<<std::endl;
+	DepthRecordingFrameSource source(fileName);
+	source.setSpeed(0.0);
+	source.setStartTime(startTime);
+	FrameSink sink(depthFrames,colorFrames,depthFrameSize,colorFrameSize);
+	source.startStreaming(Misc::createFunctionCall(&sink,&FrameSink::colorFrameCallback),Misc::createFunctionCall(&sink,&FrameSink::depthFrameCallback));
+	sink.waitForFrames(expectedNumDepthFrames+expectedNumColorFrames);
+	source.stopStreaming();
+	
+	bool ok=true;
+	ok=check("Depth frames",sink.getNumDepthFrames(),expectedNumDepthFrames,0.0)&&ok;
+	ok=check("Color frames",sink.getNumColorFrames(),expectedNumColorFrames,0.0)&&ok;
+	ok=check("Bad frames",sink.getNumBadFrames(),0.0,0.0)&&ok;
+	return ok;
+	}
+
+}
+
+int main(int argc,char* argv[])
+	{
+	/* Parámetros del escenario: 60 marcos de profundidad de 160x120 a 30Hz y 30 marcos de color de 32x24 a 15Hz, con un cuadro clave cada 10 marcos: */
+	const unsigned int depthSize[2]={160,120};
+	const unsigned int colorSize[2]={32,24};
+	const unsigned int numDepthFrames=60;
+	const unsigned int keyframeInterval=10;
+	const char* fileName="DepthRecordingCheck.sdr";
+	size_t numDepthPixels=size_t(depthSize[1])*size_t(depthSize[0]);
+	size_t colorFrameSize=size_t(colorSize[1])*size_t(colorSize[0])*3;
+	
+	try
+		{
+		bool ok=true;
+		
+		/* Cree marcos de profundidad ondulados con ruido y marcos de color con ruido: */
+		std::vector<Kinect::FrameBuffer> depthFrames,colorFrames;
+		unsigned int noise=1U;
+		for(unsigned int n=0;n<numDepthFrames;++n)
+			{
+			Kinect::FrameBuffer depthFrame(depthSize[0],depthSize[1],numDepthPixels*sizeof(Misc::UInt16));
+			Misc::UInt16* dPtr=depthFrame.getData<Misc::UInt16>();
+			for(unsigned int y=0;y<depthSize[1];++y)
+				for(unsigned int x=0;x<depthSize[0];++x,++dPtr)
+					{
+					noise=noise*1103515245U+12345U;
+					*dPtr=Misc::UInt16(800.0+100.0*sin(double(x)*0.08+double(n)*0.1)+30.0*cos(double(y)*0.12)+double((noise>>16)%7U));
+					}
+			depthFrame.timeStamp=double(n)/30.0;
+			depthFrames.push_back(depthFrame);
+			if(n%2==0)
+				{
+				Kinect::FrameBuffer colorFrame(colorSize[0],colorSize[1],colorFrameSize);
+				unsigned char* cPtr=colorFrame.getData<unsigned char>();
+				for(size_t i=0;i<colorFrameSize;++i,++cPtr)
+					{
+					noise=noise*1103515245U+12345U;
+					*cPtr=(unsigned char)((i*n+(noise>>16)%3U)&0xffU);
+					}
+				colorFrame.timeStamp=double(n/2)/15.0;
+				colorFrames.push_back(colorFrame);
+				}
+			}
+		unsigned int numColorFrames=(unsigned int)(colorFrames.size());
+		
+		/* Cree factores de corrección por píxel distintos para cada píxel: */
+		std::vector<DepthRecorder::PixelCorrection> pixelCorrection(numDepthPixels);
+		for(size_t i=0;i<numDepthPixels;++i)
+			{
+			pixelCorrection[i].scale=1.0f+float(i)*1.0e-6f;
+			pixelCorrection[i].offset=float(i)*0.5f;
+			}
+		
+		/* Grabe los marcos sin llenar las colas de escritura: */
+		{
+		SyntheticCamera camera(depthSize,colorSize);
+		DepthRecorder recorder(fileName,camera,&pixelCorrection[0],true,keyframeInterval);
+		for(unsigned int n=0;n<numDepthFrames;++n)
+			{
+			recorder.addDepthFrame(depthFrames[n]);
+			if(n%2==0)
+				recorder.addColorFrame(colorFrames[n/2]);
+			usleep(5000);
+			}
+		ok=check("Dropped frames",double(recorder.getNumDroppedDepthFrames()+recorder.getNumDroppedColorFrames()),0.0,0.0)&&ok;
+		std::string error=recorder.getError();
+		if(!error.empty())
+			{
+			std::cout<<"Recorder error "<<error<<" FAILED"<<std::endl;
+			ok=false;
+			}
+		}
+		
+		/* Compruebe el contenido del archivo cerrado correctamente: */
+		{
+		DepthRecordingFrameSource source(fileName);
+		ok=check("Frames",source.getNumFrames(),numDepthFrames+numColorFrames,0.0)&&ok;
+		ok=check("Duration (s)",source.getDuration(),double(numDepthFrames-1)/30.0,1.0e-9)&&ok;
+		bool sizesOk=source.hasColor();
+		for(int i=0;i<2;++i)
+			sizesOk=sizesOk&&source.getActualFrameSize(Kinect::FrameSource::DEPTH)[i]==depthSize[i]&&source.getActualFrameSize(Kinect::FrameSource::COLOR)[i]==colorSize[i];
+		std::cout<<"Frame sizes "<<(sizesOk?"ok":"FAILED")<<std::endl;
+		ok=sizesOk&&ok;
+		DepthRecordingFrameSource::PixelCorrection* readCorrection=source.getPixelDepthCorrection();
+		bool correctionOk=true;
+		for(size_t i=0;i<numDepthPixels;++i)
+			correctionOk=correctionOk&&readCorrection[i].scale==pixelCorrection[i].scale&&readCorrection[i].offset==pixelCorrection[i].offset;
+		delete[] readCorrection;
+		std::cout<<"Pixel correction "<<(correctionOk?"ok":"FAILED")<<std::endl;
+		ok=correctionOk&&ok;
+		}
+		
+		/* Reproduzca desde el inicio y desde un tiempo entre dos cuadros clave: */
+		size_t depthFrameSize=numDepthPixels*sizeof(Misc::UInt16);
+		ok=checkReplay("Replay from start",fileName,0.0,depthFrames,colorFrames,depthFrameSize,colorFrameSize,numDepthFrames,numColorFrames)&&ok;
+		ok=checkReplay("Replay from 1.12s",fileName,1.12,depthFrames,colorFrames,depthFrameSize,colorFrameSize,numDepthFrames-34,numColorFrames-17)&&ok;
+		
+		/* Corte el índice y el último byte del último marco, como tras un fallo durante la grabación: */
+		struct stat fileStats;
+		if(stat(fileName,&fileStats)<0)
+			throw std::runtime_error("Unable to query size of depth recording file");
+		off_t indexSize=2*sizeof(Misc::UInt32)+(numDepthFrames+numColorFrames)*ChunkedFile::indexEntrySize;
+		if(truncate(fileName,fileStats.st_size-ChunkedFile::trailerSize-indexSize-1)<0)
+			throw std::runtime_error("Unable to truncate depth recording file");
+		ok=checkReplay("Replay of truncated file",fileName,0.0,depthFrames,colorFrames,depthFrameSize,colorFrameSize,numDepthFrames-1,numColorFrames)&&ok;
+		
+		unlink(fileName);
+		return ok?0:1;
+		}
+	catch(const std::runtime_error& err)
+		{
+		unlink(fileName);
+		std::cerr<<"Caught exception "<<err.what()<<std::endl;
+		return 1;
+		}
+	}
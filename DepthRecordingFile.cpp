@@ -0,0 +1,207 @@
+/***********************************************************************
+DepthRecordingFile - Definiciones compartidas del formato de archivo de
+las grabaciones compactas de marcos de profundidad sin procesar, y
+funciones para codificar y decodificar los marcos.
+Copyright (c) 2026 Sergio081096
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include "DepthRecordingFile.h"
+
+#include <string.h>
+#include <zlib.h>
+#include <Misc/ThrowStdErr.h>
+
+namespace DepthRecordingFile {
+
+const char fileMagic[8]={'S','A','R','D','E','P','T','H'};
+const char trailerMagic[8]={'S','A','R','D','P','E','N','D'};
+
+namespace {
+
+/****************
+Helper functions:
+****************/
+
+inline Misc::UInt16 foldResidual(Misc::UInt16 residual) // Pliega un residuo con signo de 16 bits a un entero sin signo pequeño
+	{
+	return Misc::UInt16((residual<<1)^((residual&0x8000U)!=0U?0xffffU:0x0000U));
+	}
+
+inline Misc::UInt16 unfoldResidual(Misc::UInt16 folded) // Invierte el plegado de un residuo
+	{
+	return Misc::UInt16((folded>>1)^((folded&0x1U)!=0U?0xffffU:0x0000U));
+	}
+
+inline Misc::UInt16 predict(Misc::UInt16 left,Misc::UInt16 up,Misc::UInt16 upLeft) // Predice un píxel a partir de sus vecinos con el detector de bordes de la mediana
+	{
+	Misc::UInt16 lo=left<up?left:up;
+	Misc::UInt16 hi=left<up?up:left;
+	if(upLeft>=hi)
+		return lo;
+	else if(upLeft<=lo)
+		return hi;
+	else
+		return Misc::UInt16(left+up-upLeft);
+	}
+
+void compressPlanes(std::vector<unsigned char>& planeBuffer,std::vector<unsigned char>& result) // Comprime los planos de residuos con deflate limitado a series, lo más rápido y compacto para residuos pequeños
+	{
+	z_stream stream;
+	memset(&stream,0,sizeof(z_stream));
+	if(deflateInit2(&stream,Z_BEST_SPEED,Z_DEFLATED,15,8,Z_RLE)!=Z_OK)
+		Misc::throwStdErr("DepthRecordingFile: Unable to initialize frame compressor");
+	result.resize(deflateBound(&stream,uLong(planeBuffer.size())));
+	stream.next_in=&planeBuffer[0];
+	stream.avail_in=uInt(planeBuffer.size());
+	stream.next_out=&result[0];
+	stream.avail_out=uInt(result.size());
+	int status=deflate(&stream,Z_FINISH);
+	result.resize(stream.total_out);
+	deflateEnd(&stream);
+	if(status!=Z_STREAM_END)
+		Misc::throwStdErr("DepthRecordingFile: Unable to compress frame");
+	}
+
+void uncompressPlanes(const unsigned char* data,size_t dataSize,size_t planeSize,std::vector<unsigned char>& planeBuffer) // Descomprime los planos de residuos
+	{
+	planeBuffer.resize(planeSize);
+	uLongf uncompressedSize=uLongf(planeSize);
+	if(uncompress(&planeBuffer[0],&uncompressedSize,data,uLong(dataSize))!=Z_OK||uncompressedSize!=uLongf(planeSize))
+		Misc::throwStdErr("DepthRecordingFile: Corrupted frame data");
+	}
+
+}
+
+void encodeDepthFrame(const Misc::UInt16* frame,const Misc::UInt16* previousFrame,const unsigned int frameSize[2],std::vector<unsigned char>& planeBuffer,std::vector<unsigned char>& result)
+	{
+	/* Separe los residuos plegados en un plano de bytes bajos y otro de bytes altos: */
+	size_t numPixels=size_t(frameSize[1])*size_t(frameSize[0]);
+	planeBuffer.resize(numPixels*2);
+	unsigned char* loPtr=&planeBuffer[0];
+	unsigned char* hiPtr=loPtr+numPixels;
+	if(previousFrame!=0)
+		{
+		/* Calcule los residuos respecto del marco anterior: */
+		for(size_t i=0;i<numPixels;++i)
+			{
+			Misc::UInt16 folded=foldResidual(Misc::UInt16(frame[i]-previousFrame[i]));
+			loPtr[i]=(unsigned char)(folded&0xffU);
+			hiPtr[i]=(unsigned char)(folded>>8);
+			}
+		}
+	else
+		{
+		/* Calcule los residuos respecto de la predicción de los vecinos ya codificados: */
+		const Misc::UInt16* fPtr=frame;
+		for(unsigned int y=0;y<frameSize[1];++y,fPtr+=frameSize[0],loPtr+=frameSize[0],hiPtr+=frameSize[0])
+			{
+			const Misc::UInt16* upPtr=y>0?fPtr-frameSize[0]:0; // La primera fila no tiene fila superior; no forme un puntero antes del inicio del marco
+			for(unsigned int x=0;x<frameSize[0];++x)
+				{
+				Misc::UInt16 prediction;
+				if(y==0)
+					prediction=x>0?fPtr[x-1]:0U;
+				else if(x==0)
+					prediction=upPtr[x];
+				else
+					prediction=predict(fPtr[x-1],upPtr[x],upPtr[x-1]);
+				Misc::UInt16 folded=foldResidual(Misc::UInt16(fPtr[x]-prediction));
+				loPtr[x]=(unsigned char)(folded&0xffU);
+				hiPtr[x]=(unsigned char)(folded>>8);
+				}
+			}
+		}
+	
+	/* Comprima los planos: */
+	compressPlanes(planeBuffer,result);
+	}
+
+void decodeDepthFrame(const unsigned char* data,size_t dataSize,const unsigned int frameSize[2],bool keyframe,std::vector<unsigned char>& planeBuffer,Misc::UInt16* frame)
+	{
+	/* Descomprima los planos de residuos: */
+	size_t numPixels=size_t(frameSize[1])*size_t(frameSize[0]);
+	uncompressPlanes(data,dataSize,numPixels*2,planeBuffer);
+	const unsigned char* loPtr=&planeBuffer[0];
+	const unsigned char* hiPtr=loPtr+numPixels;
+	if(!keyframe)
+		{
+		/* Sume los residuos al marco anterior: */
+		for(size_t i=0;i<numPixels;++i)
+			frame[i]=Misc::UInt16(frame[i]+unfoldResidual(Misc::UInt16(loPtr[i])|(Misc::UInt16(hiPtr[i])<<8)));
+		}
+	else
+		{
+		/* Reconstruya los píxeles en el orden de codificación: */
+		Misc::UInt16* fPtr=frame;
+		for(unsigned int y=0;y<frameSize[1];++y,fPtr+=frameSize[0],loPtr+=frameSize[0],hiPtr+=frameSize[0])
+			{
+			const Misc::UInt16* upPtr=y>0?fPtr-frameSize[0]:0; // La primera fila no tiene fila superior; no forme un puntero antes del inicio del marco
+			for(unsigned int x=0;x<frameSize[0];++x)
+				{
+				Misc::UInt16 prediction;
+				if(y==0)
+					prediction=x>0?fPtr[x-1]:0U;
+				else if(x==0)
+					prediction=upPtr[x];
+				else
+					prediction=predict(fPtr[x-1],upPtr[x],upPtr[x-1]);
+				fPtr[x]=Misc::UInt16(prediction+unfoldResidual(Misc::UInt16(loPtr[x])|(Misc::UInt16(hiPtr[x])<<8)));
+				}
+			}
+		}
+	}
+
+void encodeColorFrame(const unsigned char* frame,const unsigned char* previousFrame,size_t frameBytes,std::vector<unsigned char>& planeBuffer,std::vector<unsigned char>& result)
+	{
+	/* Calcule los residuos respecto del marco anterior, o del mismo canal del píxel izquierdo en un cuadro clave: */
+	planeBuffer.resize(frameBytes);
+	unsigned char* rPtr=&planeBuffer[0];
+	if(previousFrame!=0)
+		{
+		for(size_t i=0;i<frameBytes;++i)
+			rPtr[i]=(unsigned char)(frame[i]-previousFrame[i]);
+		}
+	else
+		{
+		for(size_t i=0;i<frameBytes;++i)
+			rPtr[i]=(unsigned char)(frame[i]-(i>=colorPixelSize?frame[i-colorPixelSize]:0U));
+		}
+	
+	/* Comprima los residuos: */
+	compressPlanes(planeBuffer,result);
+	}
+
+void decodeColorFrame(const unsigned char* data,size_t dataSize,size_t frameBytes,bool keyframe,std::vector<unsigned char>& planeBuffer,unsigned char* frame)
+	{
+	/* Descomprima los residuos y súmelos a sus predicciones: */
+	uncompressPlanes(data,dataSize,frameBytes,planeBuffer);
+	const unsigned char* rPtr=&planeBuffer[0];
+	if(!keyframe)
+		{
+		for(size_t i=0;i<frameBytes;++i)
+			frame[i]=(unsigned char)(frame[i]+rPtr[i]);
+		}
+	else
+		{
+		for(size_t i=0;i<frameBytes;++i)
+			frame[i]=(unsigned char)(rPtr[i]+(i>=colorPixelSize?frame[i-colorPixelSize]:0U));
+		}
+	}
+
+}
@@ -0,0 +1,78 @@
+/***********************************************************************
+DepthRecordingFile - Definiciones compartidas del formato de archivo de
+las grabaciones compactas de marcos de profundidad sin procesar, y
+funciones para codificar y decodificar los marcos.
+Copyright (c) 2026 Sergio081096
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#ifndef DEPTHRECORDINGFILE_INCLUDED
+#define DEPTHRECORDINGFILE_INCLUDED
+
+#include <stddef.h>
+#include <vector>
+#include <Misc/SizedTypes.h>
+
+/***********************************************************************
+Disposición del archivo, en el contenedor de ChunkedFile.h y en orden
+little-endian:
+- Encabezado: identificador "SARDEPTH", versión, ancho y alto de los
+  marcos de profundidad y de color (cero si no se graba el color),
+  intervalo de cuadros clave, tamaños de los parámetros de la cámara, una
+  marca de corrección de profundidad por píxel y la posición del primer
+  fragmento.
+- Parámetros intrínsecos y extrínsecos y rango de profundidad de la
+  cámara, copiados como objetos en el orden de bytes del anfitrión, y los
+  factores de corrección de profundidad por píxel si la marca lo indica.
+- Un fragmento por marco de profundidad o de color, en orden de marca de
+  tiempo, con un único bloque de datos comprimidos.
+- El índice del contenedor, con el identificador final "SARDPEND".
+Un marco de profundidad se codifica como el residuo de cada píxel
+respecto del mismo píxel del marco anterior, o en los cuadros clave
+respecto de la predicción de sus vecinos izquierdo, superior y superior
+izquierdo. Los residuos se pliegan a enteros sin signo, se separan en un
+plano de bytes bajos y otro de bytes altos, y se comprimen con deflate.
+Los marcos de color se codifican igual, byte a byte, con el píxel
+izquierdo como predicción en los cuadros clave.
+***********************************************************************/
+
+namespace DepthRecordingFile {
+
+extern const char fileMagic[8]; // Identificador al inicio del archivo
+extern const char trailerMagic[8]; // Identificador al final de un archivo cerrado correctamente
+static const Misc::UInt32 fileVersion=1; // Versión del formato de archivo
+static const size_t headerSize=64; // Tamaño de la parte fija del encabezado del archivo en bytes
+static const unsigned int numChunkBlocks=1; // Número de bloques de datos de un fragmento de marco
+static const size_t colorPixelSize=3; // Bytes por píxel de color (RGB de 8 bits)
+static const Misc::UInt32 depthChunkTag=0x48545044U; // Etiqueta de un fragmento de marco de profundidad ("DPTH")
+static const Misc::UInt32 colorChunkTag=0x524c4f43U; // Etiqueta de un fragmento de marco de color ("COLR")
+
+enum FrameFlags // Enumerado de marcas de un marco
+	{
+	KEYFRAME=0x1, // El marco se codificó sin referencia al marco anterior
+	COLOR=0x2 // El marco es un marco de color
+	};
+
+void encodeDepthFrame(const Misc::UInt16* frame,const Misc::UInt16* previousFrame,const unsigned int frameSize[2],std::vector<unsigned char>& planeBuffer,std::vector<unsigned char>& result); // Codifica un marco de profundidad como diferencia con el marco anterior dado, o como cuadro clave si es nulo
+void decodeDepthFrame(const unsigned char* data,size_t dataSize,const unsigned int frameSize[2],bool keyframe,std::vector<unsigned char>& planeBuffer,Misc::UInt16* frame); // Decodifica un marco de profundidad en el búfer dado, que contiene el marco anterior si el marco no es clave
+void encodeColorFrame(const unsigned char* frame,const unsigned char* previousFrame,size_t frameBytes,std::vector<unsigned char>& planeBuffer,std::vector<unsigned char>& result); // Codifica un marco de color como diferencia con el marco anterior dado, o como cuadro clave si es nulo
+void decodeColorFrame(const unsigned char* data,size_t dataSize,size_t frameBytes,bool keyframe,std::vector<unsigned char>& planeBuffer,unsigned char* frame); // Decodifica un marco de color en el búfer dado, que contiene el marco anterior si el marco no es clave
+
+}
+
+#endif
@@ -0,0 +1,338 @@
+/***********************************************************************
+DepthRecordingFrameSource - Clase para una fuente de marcos que reproduce
+un archivo de grabación compacto mapeado en memoria, en tiempo real, a
+una velocidad múltiple o tan rápido como sea posible.
+Copyright (c) 2026 Sergio081096
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include "DepthRecordingFrameSource.h"
+
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <string>
+#include <iostream>
+#include <stdexcept>
+#include <Misc/ThrowStdErr.h>
+#include <Misc/FunctionCalls.h>
+
+#include "DepthRecordingFile.h"
+
+namespace {
+
+/****************
+Helper functions:
+****************/
+
+double getTime(void)
+	{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC,&now);
+	return double(now.tv_sec)+double(now.tv_nsec)/1.0e9;
+	}
+
+void sleepFor(double seconds)
+	{
+	usleep(useconds_t(seconds*1.0e6));
+	}
+
+}
+
+/******************************************
+Methods of class DepthRecordingFrameSource:
+******************************************/
+
+unsigned int DepthRecordingFrameSource::findKeyframe(double time,Misc::UInt32 streamFlags) const
+	{
+	const std::vector<ChunkedFile::IndexEntry>& index=file.getIndex();
+	unsigned int result=(unsigned int)(index.size());
+	for(unsigned int i=0;i<index.size();++i)
+		{
+		/* Ignore los marcos del otro flujo: */
+		if((index[i].flags&DepthRecordingFile::COLOR)!=streamFlags)
+			continue;
+		
+		/* Detenga la búsqueda en el primer marco posterior al tiempo dado si ya se encontró un marco inicial: */
+		if(index[i].time>time&&result<index.size())
+			break;
+		if(result==index.size()||(index[i].flags&DepthRecordingFile::KEYFRAME)!=0U)
+			result=i;
+		}
+	
+	return result;
+	}
+
+Kinect::FrameBuffer DepthRecordingFrameSource::decodeFrame(unsigned int entryIndex,const Kinect::FrameBuffer& previousFrame,std::vector<unsigned char>& planeBuffer) const
+	{
+	/* Localice los datos comprimidos del marco en el mapeo: */
+	const ChunkedFile::IndexEntry& entry=file.getIndex()[entryIndex];
+	size_t dataSize;
+	const unsigned char* data=file.getBlock(entryIndex,0,dataSize);
+	bool keyframe=(entry.flags&DepthRecordingFile::KEYFRAME)!=0U;
+	if(!keyframe&&previousFrame.getData<unsigned char>()==0)
+		Misc::throwStdErr("DepthRecordingFrameSource: Frame %u has no preceding keyframe",entryIndex);
+	
+	/* Decodifique el marco en un nuevo búfer, empezando con una copia del marco anterior si no es clave: */
+	Kinect::FrameBuffer result;
+	if((entry.flags&DepthRecordingFile::COLOR)!=0U)
+		{
+		size_t frameBytes=size_t(colorSize[1])*size_t(colorSize[0])*DepthRecordingFile::colorPixelSize;
+		result=Kinect::FrameBuffer(colorSize[0],colorSize[1],frameBytes);
+		if(!keyframe)
+			memcpy(result.getData<unsigned char>(),previousFrame.getData<unsigned char>(),frameBytes);
+		DepthRecordingFile::decodeColorFrame(data,dataSize,frameBytes,keyframe,planeBuffer,result.getData<unsigned char>());
+		}
+	else
+		{
+		size_t frameBytes=size_t(depthSize[1])*size_t(depthSize[0])*sizeof(DepthPixel);
+		result=Kinect::FrameBuffer(depthSize[0],depthSize[1],frameBytes);
+		if(!keyframe)
+			memcpy(result.getData<unsigned char>(),previousFrame.getData<unsigned char>(),frameBytes);
+		DepthRecordingFile::decodeDepthFrame(data,dataSize,depthSize,keyframe,planeBuffer,result.getData<Misc::UInt16>());
+		}
+	result.timeStamp=entry.time;
+	
+	return result;
+	}
+
+void* DepthRecordingFrameSource::replayThreadMethod(void)
+	{
+	const std::vector<ChunkedFile::IndexEntry>& index=file.getIndex();
+	std::vector<unsigned char> planeBuffer;
+	bool replayColor=colorStreamingCallback!=0&&hasColor();
+	try
+		{
+		do
+			{
+			/* Empiece en el último cuadro clave de cada flujo no posterior al tiempo inicial: */
+			double replayStart=index.front().time+startTime;
+			unsigned int depthStart=findKeyframe(replayStart,0U);
+			unsigned int colorStart=replayColor?findKeyframe(replayStart,DepthRecordingFile::COLOR):(unsigned int)(index.size());
+			Kinect::FrameBuffer previousDepthFrame,previousColorFrame;
+			double wallStart=getTime();
+			for(unsigned int i=depthStart<colorStart?depthStart:colorStart;runReplayThread&&i<index.size();++i)
+				{
+				/* Omita los marcos que no se reproducen: */
+				const ChunkedFile::IndexEntry& entry=index[i];
+				bool color=(entry.flags&DepthRecordingFile::COLOR)!=0U;
+				if(color?!replayColor||i<colorStart:i<depthStart)
+					continue;
+				
+				/* Decodifique el marco; los marcos anteriores al tiempo inicial solo ponen al día su flujo: */
+				Kinect::FrameBuffer frame=decodeFrame(i,color?previousColorFrame:previousDepthFrame,planeBuffer);
+				if(color)
+					previousColorFrame=frame;
+				else
+					previousDepthFrame=frame;
+				if(entry.time<replayStart)
+					continue;
+				
+				if(speed>0.0)
+					{
+					/* Espere hasta el momento de entrega del marco en pasos cortos para reaccionar a stopStreaming: */
+					double dueTime=wallStart+(entry.time-replayStart)/speed;
+					double now;
+					while(runReplayThread&&(now=getTime())<dueTime)
+						sleepFor(dueTime-now<0.1?dueTime-now:0.1);
+					if(!runReplayThread)
+						break;
+					}
+				
+				/* Entregue el marco: */
+				if(color)
+					(*colorStreamingCallback)(frame);
+				else
+					(*depthStreamingCallback)(frame);
+				}
+			}
+		while(runReplayThread&&loop);
+		}
+	catch(const std::runtime_error& err)
+		{
+		std::cerr<<"DepthRecordingFrameSource: Stopping replay due to exception "<<err.what()<<std::endl;
+		}
+	
+	return 0;
+	}
+
+DepthRecordingFrameSource::DepthRecordingFrameSource(const char* fileName)
+	:file(fileName),
+	 pixelCorrection(0),
+	 speed(1.0),startTime(0.0),loop(false),
+	 colorStreamingCallback(0),depthStreamingCallback(0),
+	 runReplayThread(false)
+	{
+	/* Verifique el encabezado: */
+	if(file.getSize()<DepthRecordingFile::headerSize)
+		Misc::throwStdErr("DepthRecordingFrameSource: File %s is not a depth recording",fileName);
+	const unsigned char* mapping=file.getData();
+	std::string error;
+	Misc::UInt32 typeSizes[3];
+	for(int i=0;i<3;++i)
+		typeSizes[i]=ChunkedFile::getValue<Misc::UInt32>(mapping+32+i*sizeof(Misc::UInt32));
+	for(int i=0;i<2;++i)
+		{
+		depthSize[i]=ChunkedFile::getValue<Misc::UInt32>(mapping+12+i*sizeof(Misc::UInt32));
+		colorSize[i]=ChunkedFile::getValue<Misc::UInt32>(mapping+20+i*sizeof(Misc::UInt32));
+		}
+	bool hasPixelCorrection=ChunkedFile::getValue<Misc::UInt32>(mapping+44)!=0U;
+	size_t dataOffset=size_t(ChunkedFile::getValue<Misc::UInt64>(mapping+48));
+	size_t numPixels=size_t(depthSize[1])*size_t(depthSize[0]);
+	if(memcmp(mapping,DepthRecordingFile::fileMagic,8)!=0)
+		error="is not a depth recording";
+	else if(ChunkedFile::getValue<Misc::UInt32>(mapping+8)!=DepthRecordingFile::fileVersion)
+		error="has an unsupported version";
+	else if(typeSizes[0]!=sizeof(IntrinsicParameters)||typeSizes[1]!=sizeof(ExtrinsicParameters)||typeSizes[2]!=sizeof(DepthRange))
+		error="was recorded with incompatible camera parameters";
+	else if(numPixels==0||dataOffset!=DepthRecordingFile::headerSize+typeSizes[0]+typeSizes[1]+typeSizes[2]+(hasPixelCorrection?numPixels*2*sizeof(Misc::Float32):0)||dataOffset>file.getSize())
+		error="has a corrupted header";
+	if(error.empty())
+		{
+		/* Lea los parámetros de la cámara y la corrección de profundidad por píxel: */
+		const unsigned char* pPtr=mapping+DepthRecordingFile::headerSize;
+		memcpy(&ips,pPtr,sizeof(IntrinsicParameters));
+		pPtr+=sizeof(IntrinsicParameters);
+		memcpy(&eps,pPtr,sizeof(ExtrinsicParameters));
+		pPtr+=sizeof(ExtrinsicParameters);
+		memcpy(&depthRange,pPtr,sizeof(DepthRange));
+		pPtr+=sizeof(DepthRange);
+		if(hasPixelCorrection)
+			{
+			pixelCorrection=new PixelCorrection[numPixels];
+			for(size_t i=0;i<numPixels;++i,pPtr+=2*sizeof(Misc::Float32))
+				{
+				pixelCorrection[i].scale=ChunkedFile::getValue<Misc::Float32>(pPtr);
+				pixelCorrection[i].offset=ChunkedFile::getValue<Misc::Float32>(pPtr+sizeof(Misc::Float32));
+				}
+			}
+		
+		/* Lea el índice, o reconstrúyalo si el archivo no se cerró correctamente: */
+		static const Misc::UInt32 chunkTags[2]={DepthRecordingFile::depthChunkTag,DepthRecordingFile::colorChunkTag};
+		if(!file.loadIndex(dataOffset,DepthRecordingFile::trailerMagic,chunkTags,2,DepthRecordingFile::numChunkBlocks))
+			std::cerr<<"DepthRecordingFrameSource: File "<<fileName<<" has no valid index; scanning frames"<<std::endl;
+		const std::vector<ChunkedFile::IndexEntry>& index=file.getIndex();
+		if(findKeyframe(index.empty()?0.0:index.front().time,0U)==index.size())
+			error="contains no depth frames";
+		}
+	if(!error.empty())
+		{
+		delete[] pixelCorrection;
+		Misc::throwStdErr("DepthRecordingFrameSource: File %s %s",fileName,error.c_str());
+		}
+	}
+
+DepthRecordingFrameSource::~DepthRecordingFrameSource(void)
+	{
+	stopStreaming();
+	delete[] pixelCorrection;
+	}
+
+Kinect::FrameSource::DepthCorrection* DepthRecordingFrameSource::getDepthCorrectionParameters(void)
+	{
+	/* La grabación contiene la corrección ya evaluada por píxel; ver getPixelDepthCorrection: */
+	return 0;
+	}
+
+Kinect::FrameSource::IntrinsicParameters DepthRecordingFrameSource::getIntrinsicParameters(void)
+	{
+	return ips;
+	}
+
+Kinect::FrameSource::ExtrinsicParameters DepthRecordingFrameSource::getExtrinsicParameters(void)
+	{
+	return eps;
+	}
+
+const unsigned int* DepthRecordingFrameSource::getActualFrameSize(int sensor) const
+	{
+	return sensor==COLOR&&hasColor()?colorSize:depthSize;
+	}
+
+Kinect::FrameSource::DepthRange DepthRecordingFrameSource::getDepthRange(void) const
+	{
+	return depthRange;
+	}
+
+void DepthRecordingFrameSource::startStreaming(Kinect::FrameSource::StreamingCallback* newColorStreamingCallback,Kinect::FrameSource::StreamingCallback* newDepthStreamingCallback)
+	{
+	/* Detener la transmisión anterior: */
+	stopStreaming();
+	
+	/* Iniciar el hilo de reproducción: */
+	colorStreamingCallback=newColorStreamingCallback;
+	depthStreamingCallback=newDepthStreamingCallback;
+	if(depthStreamingCallback!=0)
+		{
+		runReplayThread=true;
+		replayThread.start(this,&DepthRecordingFrameSource::replayThreadMethod);
+		}
+	}
+
+void DepthRecordingFrameSource::stopStreaming(void)
+	{
+	if(runReplayThread)
+		{
+		/* Detener el hilo de reproducción: */
+		runReplayThread=false;
+		replayThread.join();
+		}
+	
+	delete colorStreamingCallback;
+	colorStreamingCallback=0;
+	delete depthStreamingCallback;
+	depthStreamingCallback=0;
+	}
+
+void DepthRecordingFrameSource::setSpeed(double newSpeed)
+	{
+	speed=newSpeed;
+	}
+
+void DepthRecordingFrameSource::setStartTime(double newStartTime)
+	{
+	/* Limite el tiempo inicial a la duración de la grabación: */
+	startTime=newStartTime;
+	if(startTime<0.0)
+		startTime=0.0;
+	if(startTime>getDuration())
+		startTime=getDuration();
+	}
+
+void DepthRecordingFrameSource::setLoop(bool newLoop)
+	{
+	loop=newLoop;
+	}
+
+DepthRecordingFrameSource::PixelCorrection* DepthRecordingFrameSource::getPixelDepthCorrection(void) const
+	{
+	size_t numPixels=size_t(depthSize[1])*size_t(depthSize[0]);
+	PixelCorrection* result=new PixelCorrection[numPixels];
+	if(pixelCorrection!=0)
+		memcpy(result,pixelCorrection,numPixels*sizeof(PixelCorrection));
+	else
+		{
+		/* Cree factores de corrección neutros si la grabación no contiene ninguno: */
+		for(size_t i=0;i<numPixels;++i)
+			{
+			result[i].scale=1.0f;
+			result[i].offset=0.0f;
+			}
+		}
+	return result;
+	}
@@ -0,0 +1,101 @@
+/***********************************************************************
+DepthRecordingFrameSource - Clase para una fuente de marcos que reproduce
+un archivo de grabación compacto mapeado en memoria, en tiempo real, a
+una velocidad múltiple o tan rápido como sea posible.
+Copyright (c) 2026 Sergio081096
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#ifndef DEPTHRECORDINGFRAMESOURCE_INCLUDED
+#define DEPTHRECORDINGFRAMESOURCE_INCLUDED
+
+#include <stddef.h>
+#include <vector>
+#include <Misc/SizedTypes.h>
+#include <Threads/Thread.h>
+#include <Kinect/FrameBuffer.h>
+#include <Kinect/FrameSource.h>
+
+#include "ChunkedFile.h"
+
+class DepthRecordingFrameSource:public Kinect::FrameSource
+	{
+	/* Clases integradas: */
+	public:
+	typedef DepthCorrection::PixelCorrection PixelCorrection; // Tipo para factores de corrección de profundidad por píxel
+	
+	/* Elementos: */
+	private:
+	ChunkedFile::Reader file; // Mapeo de memoria del archivo de grabación con el índice de todos los marcos
+	unsigned int depthSize[2]; // Ancho y alto de los marcos de profundidad
+	unsigned int colorSize[2]; // Ancho y alto de los marcos de color; cero si no se grabó el color
+	IntrinsicParameters ips; // Parámetros intrínsecos de la cámara grabada
+	ExtrinsicParameters eps; // Parámetros extrínsecos de la cámara grabada
+	DepthRange depthRange; // Rango de valores de profundidad válidos de la cámara grabada
+	PixelCorrection* pixelCorrection; // Factores de corrección de profundidad por píxel grabados, o NULL
+	double speed; // Factor de velocidad de la reproducción; cero o negativo reproduce tan rápido como sea posible
+	double startTime; // Tiempo en segundos desde el inicio de la grabación en el que empieza la reproducción
+	bool loop; // Marcar para repetir la reproducción al llegar al final
+	StreamingCallback* colorStreamingCallback; // Función llamada con cada nuevo marco de color
+	StreamingCallback* depthStreamingCallback; // Función llamada con cada nuevo marco de profundidad
+	volatile bool runReplayThread; // Marcar para mantener en ejecución el hilo de reproducción
+	Threads::Thread replayThread; // Hilo que decodifica y entrega los marcos
+	
+	/* Métodos privados: */
+	unsigned int findKeyframe(double time,Misc::UInt32 streamFlags) const; // Devuelve el índice del último cuadro clave del flujo dado no posterior al tiempo absoluto dado, o del primer marco del flujo
+	Kinect::FrameBuffer decodeFrame(unsigned int entryIndex,const Kinect::FrameBuffer& previousFrame,std::vector<unsigned char>& planeBuffer) const; // Decodifica el marco dado en un nuevo búfer de marco a partir del marco anterior de su mismo flujo
+	void* replayThreadMethod(void); // Método para el hilo de reproducción
+	
+	/* Constructores y destructores: */
+	public:
+	DepthRecordingFrameSource(const char* fileName); // Mapea en memoria el archivo de grabación dado
+	private:
+	DepthRecordingFrameSource(const DepthRecordingFrameSource& source); // Prohibir copia constructor
+	DepthRecordingFrameSource& operator=(const DepthRecordingFrameSource& source); // Prohibir operador de asignación
+	public:
+	virtual ~DepthRecordingFrameSource(void);
+	
+	/* Métodos de la clase Kinect::FrameSource: */
+	virtual DepthCorrection* getDepthCorrectionParameters(void);
+	virtual IntrinsicParameters getIntrinsicParameters(void);
+	virtual ExtrinsicParameters getExtrinsicParameters(void);
+	virtual const unsigned int* getActualFrameSize(int sensor) const;
+	virtual DepthRange getDepthRange(void) const;
+	virtual void startStreaming(StreamingCallback* newColorStreamingCallback,StreamingCallback* newDepthStreamingCallback);
+	virtual void stopStreaming(void);
+	
+	/* Nuevos métodos: */
+	bool hasColor(void) const // Devuelve verdadero si la grabación contiene marcos de color
+		{
+		return colorSize[0]!=0&&colorSize[1]!=0;
+		}
+	unsigned int getNumFrames(void) const // Devuelve el número de marcos de la grabación
+		{
+		return (unsigned int)(file.getIndex().size());
+		}
+	double getDuration(void) const // Devuelve la duración de la grabación en segundos
+		{
+		return file.getIndex().back().time-file.getIndex().front().time;
+		}
+	void setSpeed(double newSpeed); // Establece el factor de velocidad de la reproducción; cero o negativo reproduce tan rápido como sea posible; se aplica al iniciar la transmisión
+	void setStartTime(double newStartTime); // Establece el tiempo desde el inicio de la grabación en el que empieza la reproducción; se aplica al iniciar la transmisión
+	void setLoop(bool newLoop); // Establece si la reproducción se repite al llegar al final; se aplica al iniciar la transmisión
+	PixelCorrection* getPixelDepthCorrection(void) const; // Devuelve una copia nueva de los factores de corrección de profundidad por píxel grabados, o factores neutros si no se grabaron
+	};
+
+#endif
@@ -0,0 +1,338 @@
+/***********************************************************************
+ElevationPyramid - Clase para mantener en la CPU una pirámide jerárquica
+de elevaciones mínimas y máximas sobre la imagen de profundidad actual,
+para intersecar rápidamente segmentos de línea con la superficie de
+arena.
+Copyright (c) 2014-2018 Oliver Kreylos
+Copyright (c) 2026 Sergio081096
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include "ElevationPyramid.h"
+
+#include <algorithm>
+#include <Math/Math.h>
+
+/*********************************
+Methods of class ElevationPyramid:
+*********************************/
+
+bool ElevationPyramid::clipRay(const ElevationPyramid::Ray& ray,unsigned int level,unsigned int nodeX,unsigned int nodeY,double& mu0,double& mu1) const
+	{
+	unsigned int node[2]={nodeX,nodeY};
+	for(int i=0;i<2;++i)
+		{
+		/* Calcule el rango de píxeles del nodo; las celdas van de centro a centro de píxel: */
+		double b0=double(node[i]<<level)+0.5;
+		double b1=double(Math::min((node[i]+1U)<<level,levelSizes[i]))+0.5;
+		
+		if(ray.dq[i]!=0.0)
+			{
+			/* Recorte el intervalo de parámetros a la franja del nodo: */
+			double m0=(b0-ray.q0[i])/ray.dq[i];
+			double m1=(b1-ray.q0[i])/ray.dq[i];
+			if(m0>m1)
+				std::swap(m0,m1);
+			if(mu0<m0)
+				mu0=m0;
+			if(mu1>m1)
+				mu1=m1;
+			}
+		else if(ray.q0[i]<b0||ray.q0[i]>b1)
+			return false;
+		}
+	
+	return mu0<=mu1;
+	}
+
+double ElevationPyramid::intersectCell(const ElevationPyramid::Ray& ray,unsigned int cellX,unsigned int cellY,double mu0,double mu1) const
+	{
+	/* Evalúe la distancia vertical entre el segmento y la superficie bilineal de la celda en la entrada y la salida: */
+	const float* e0=elevation+(cellY*size[0]+cellX);
+	const float* e1=e0+size[0];
+	double mus[2]={mu0,mu1};
+	double f[2];
+	for(int i=0;i<2;++i)
+		{
+		double x=Math::clamp(ray.q0[0]+ray.dq[0]*mus[i]-(double(cellX)+0.5),0.0,1.0);
+		double y=Math::clamp(ray.q0[1]+ray.dq[1]*mus[i]-(double(cellY)+0.5),0.0,1.0);
+		double surface=(double(e0[0])*(1.0-x)+double(e0[1])*x)*(1.0-y)+(double(e1[0])*(1.0-x)+double(e1[1])*x)*y;
+		f[i]=ray.calcElevation(mus[i])-surface;
+		}
+	
+	/* Devuelva el primer parámetro en el que el segmento está sobre o bajo la superficie: */
+	if(f[0]<=0.0)
+		return mu0;
+	if(f[1]<=0.0)
+		return mu0+(mu1-mu0)*f[0]/(f[0]-f[1]);
+	return 2.0;
+	}
+
+double ElevationPyramid::intersectNode(const ElevationPyramid::Ray& ray,unsigned int level,unsigned int nodeX,unsigned int nodeY,double mu0,double mu1) const
+	{
+	/* Rechace el nodo si el segmento pasa completamente por encima de su elevación máxima; la elevación del segmento es monótona: */
+	const float* node=&levels[level][(nodeY*levelSizes[level*2]+nodeX)*2];
+	if(Math::min(ray.calcElevation(mu0),ray.calcElevation(mu1))>double(node[1]))
+		return 2.0;
+	
+	if(level==0)
+		return intersectCell(ray,nodeX,nodeY,mu0,mu1);
+	
+	/* Recorte el segmento a los nodos hijos y ordénelos por su parámetro de entrada: */
+	unsigned int childLevel=level-1;
+	unsigned int childX0=nodeX*2;
+	unsigned int childX1=Math::min(childX0+2,levelSizes[childLevel*2+0]);
+	unsigned int childY0=nodeY*2;
+	unsigned int childY1=Math::min(childY0+2,levelSizes[childLevel*2+1]);
+	unsigned int children[4][2];
+	double childMus[4][2];
+	int numChildren=0;
+	for(unsigned int cy=childY0;cy<childY1;++cy)
+		for(unsigned int cx=childX0;cx<childX1;++cx)
+			{
+			double cMu0=mu0;
+			double cMu1=mu1;
+			if(clipRay(ray,childLevel,cx,cy,cMu0,cMu1))
+				{
+				int i;
+				for(i=numChildren;i>0&&childMus[i-1][0]>cMu0;--i)
+					{
+					children[i][0]=children[i-1][0];
+					children[i][1]=children[i-1][1];
+					childMus[i][0]=childMus[i-1][0];
+					childMus[i][1]=childMus[i-1][1];
+					}
+				children[i][0]=cx;
+				children[i][1]=cy;
+				childMus[i][0]=cMu0;
+				childMus[i][1]=cMu1;
+				++numChildren;
+				}
+			}
+	
+	/* Recorra los hijos de delante hacia atrás y devuelva la primera intersección: */
+	for(int i=0;i<numChildren;++i)
+		{
+		double mu=intersectNode(ray,childLevel,children[i][0],children[i][1],childMus[i][0],childMus[i][1]);
+		if(mu<=1.0)
+			return mu;
+		}
+	
+	return 2.0;
+	}
+
+ElevationPyramid::ElevationPyramid(const unsigned int sSize[2])
+	:elevation(0),
+	 numLevels(0),
+	 haveElevation(false),
+	 depthImageVersion(0)
+	{
+	/* Copie el tamaño de la imagen de profundidad: */
+	for(int i=0;i<2;++i)
+		size[i]=sSize[i];
+	
+	/* Inicialice la transformación a la identidad: */
+	for(int i=0;i<4;++i)
+		basePlaneDicEq[i]=weightDicEq[i]=i==3?1.0:0.0;
+	
+	/* Calcule los tamaños de los niveles; el nivel superior tiene un solo nodo: */
+	unsigned int w=size[0]-1;
+	unsigned int h=size[1]-1;
+	while(true)
+		{
+		levelSizes.push_back(w);
+		levelSizes.push_back(h);
+		levels.push_back(std::vector<float>(w*h*2,0.0f));
+		levelChanged.push_back(std::vector<unsigned char>(w*h,0));
+		++numLevels;
+		if(w<=1&&h<=1)
+			break;
+		w=(w+1)/2;
+		h=(h+1)/2;
+		}
+	
+	/* Asigne la cuadrícula de elevación: */
+	elevation=new float[size[1]*size[0]];
+	}
+
+ElevationPyramid::~ElevationPyramid(void)
+	{
+	delete[] elevation;
+	}
+
+void ElevationPyramid::setTransform(const PTransform& newDepthProjection,const Plane& newBasePlane)
+	{
+	/* Almacene la transformación: */
+	depthProjection=newDepthProjection;
+	invDepthProjection=Geometry::invert(depthProjection);
+	basePlane=newBasePlane;
+	
+	/* Transforme el plano base en el espacio de imagen de profundidad: */
+	const PTransform::Matrix& dpm=depthProjection.getMatrix();
+	const Plane::Vector& bpn=basePlane.getNormal();
+	Scalar bpo=basePlane.getOffset();
+	for(int i=0;i<4;++i)
+		{
+		basePlaneDicEq[i]=dpm(0,i)*bpn[0]+dpm(1,i)*bpn[1]+dpm(2,i)*bpn[2]-dpm(3,i)*bpo;
+		weightDicEq[i]=dpm(3,i);
+		}
+	
+	/* Invalide la pirámide: */
+	haveElevation=false;
+	}
+
+void ElevationPyramid::update(const Kinect::FrameBuffer& depthImage,unsigned int newDepthImageVersion)
+	{
+	/* No haga nada si la pirámide está al día: */
+	if(haveElevation&&depthImageVersion==newDepthImageVersion)
+		return;
+	
+	/* Calcule la elevación de cada píxel de la imagen de profundidad: */
+	const float* diPtr=depthImage.getData<float>();
+	float* ePtr=elevation;
+	for(unsigned int y=0;y<size[1];++y)
+		{
+		double dy=double(y)+0.5;
+		for(unsigned int x=0;x<size[0];++x,++diPtr,++ePtr)
+			{
+			double dx=double(x)+0.5;
+			double z=double(*diPtr);
+			*ePtr=float((basePlaneDicEq[0]*dx+basePlaneDicEq[1]*dy+basePlaneDicEq[2]*z+basePlaneDicEq[3])/(weightDicEq[0]*dx+weightDicEq[1]*dy+weightDicEq[2]*z+weightDicEq[3]));
+			}
+		}
+	
+	/* Actualice los rangos de elevación de las celdas del nivel cero y marque las que cambiaron: */
+	unsigned int w=levelSizes[0];
+	unsigned int h=levelSizes[1];
+	float* nPtr=&levels[0][0];
+	unsigned char* cPtr=&levelChanged[0][0];
+	for(unsigned int y=0;y<h;++y)
+		{
+		const float* row0=elevation+y*size[0];
+		const float* row1=row0+size[0];
+		for(unsigned int x=0;x<w;++x,nPtr+=2,++cPtr)
+			{
+			float min=Math::min(Math::min(row0[x],row0[x+1]),Math::min(row1[x],row1[x+1]));
+			float max=Math::max(Math::max(row0[x],row0[x+1]),Math::max(row1[x],row1[x+1]));
+			*cPtr=!haveElevation||nPtr[0]!=min||nPtr[1]!=max;
+			nPtr[0]=min;
+			nPtr[1]=max;
+			}
+		}
+	
+	/* Propague los cambios hacia arriba, recalculando solo los nodos con hijos modificados: */
+	for(unsigned int level=1;level<numLevels;++level)
+		{
+		unsigned int cw=levelSizes[(level-1)*2+0];
+		unsigned int ch=levelSizes[(level-1)*2+1];
+		const float* children=&levels[level-1][0];
+		const unsigned char* childrenChanged=&levelChanged[level-1][0];
+		w=levelSizes[level*2+0];
+		h=levelSizes[level*2+1];
+		nPtr=&levels[level][0];
+		cPtr=&levelChanged[level][0];
+		for(unsigned int y=0;y<h;++y)
+			for(unsigned int x=0;x<w;++x,nPtr+=2,++cPtr)
+				{
+				unsigned int cx1=Math::min(x*2+2,cw);
+				unsigned int cy1=Math::min(y*2+2,ch);
+				bool changed=false;
+				for(unsigned int cy=y*2;cy<cy1;++cy)
+					for(unsigned int cx=x*2;cx<cx1;++cx)
+						changed=changed||childrenChanged[cy*cw+cx]!=0;
+				*cPtr=0;
+				if(changed)
+					{
+					/* Recalcule el rango de elevación del nodo: */
+					const float* cnPtr=children+((y*2)*cw+x*2)*2;
+					float min=cnPtr[0];
+					float max=cnPtr[1];
+					for(unsigned int cy=y*2;cy<cy1;++cy)
+						for(unsigned int cx=x*2;cx<cx1;++cx)
+							{
+							const float* c=children+(cy*cw+cx)*2;
+							min=Math::min(min,c[0]);
+							max=Math::max(max,c[1]);
+							}
+					*cPtr=nPtr[0]!=min||nPtr[1]!=max;
+					nPtr[0]=min;
+					nPtr[1]=max;
+					}
+				}
+		}
+	
+	haveElevation=true;
+	depthImageVersion=newDepthImageVersion;
+	}
+
+Scalar ElevationPyramid::intersectLine(const Point& p0,const Point& p1,Scalar elevationMin,Scalar elevationMax) const
+	{
+	if(!haveElevation)
+		return Scalar(2);
+	
+	/* Recorte el segmento de línea al rango de elevación dado: */
+	Scalar lambda0=Scalar(0);
+	Scalar lambda1=Scalar(1);
+	Scalar d0=basePlane.calcDistance(p0);
+	Scalar d1=basePlane.calcDistance(p1);
+	if(d0!=d1)
+		{
+		Scalar lMin=(elevationMin-d0)/(d1-d0);
+		Scalar lMax=(elevationMax-d0)/(d1-d0);
+		if(lMin>lMax)
+			std::swap(lMin,lMax);
+		lambda0=Math::max(lambda0,lMin);
+		lambda1=Math::min(lambda1,lMax);
+		}
+	else if(d0<elevationMin||d0>elevationMax)
+		return Scalar(2);
+	if(lambda0>lambda1)
+		return Scalar(2);
+	
+	/* Transforme el segmento recortado al espacio de imagen de profundidad: */
+	Point q0=invDepthProjection.transform(Geometry::affineCombination(p0,p1,lambda0));
+	Point q1=invDepthProjection.transform(Geometry::affineCombination(p0,p1,lambda1));
+	Ray ray;
+	for(int i=0;i<2;++i)
+		{
+		ray.q0[i]=q0[i];
+		ray.dq[i]=q1[i]-q0[i];
+		}
+	ray.elevationNum[0]=basePlaneDicEq[0]*q0[0]+basePlaneDicEq[1]*q0[1]+basePlaneDicEq[2]*q0[2]+basePlaneDicEq[3];
+	ray.elevationNum[1]=basePlaneDicEq[0]*(q1[0]-q0[0])+basePlaneDicEq[1]*(q1[1]-q0[1])+basePlaneDicEq[2]*(q1[2]-q0[2]);
+	ray.elevationDenom[0]=weightDicEq[0]*q0[0]+weightDicEq[1]*q0[1]+weightDicEq[2]*q0[2]+weightDicEq[3];
+	ray.elevationDenom[1]=weightDicEq[0]*(q1[0]-q0[0])+weightDicEq[1]*(q1[1]-q0[1])+weightDicEq[2]*(q1[2]-q0[2]);
+	
+	/* Interseque el segmento con la pirámide desde su nodo raíz: */
+	double mu0=0.0;
+	double mu1=1.0;
+	if(!clipRay(ray,numLevels-1,0,0,mu0,mu1))
+		return Scalar(2);
+	double mu=intersectNode(ray,numLevels-1,0,0,mu0,mu1);
+	if(mu>1.0)
+		return Scalar(2);
+	
+	/* Convierta el punto de intersección de vuelta en un parámetro del segmento original: */
+	Point hit=depthProjection.transform(Point(q0[0]+(q1[0]-q0[0])*mu,q0[1]+(q1[1]-q0[1])*mu,q0[2]+(q1[2]-q0[2])*mu));
+	Vector d=p1-p0;
+	Scalar d2=Geometry::sqr(d);
+	if(d2==Scalar(0))
+		return lambda0;
+	Scalar lambda=((hit-p0)*d)/d2;
+	return Math::clamp(lambda,lambda0,lambda1);
+	}
@@ -0,0 +1,89 @@
+/***********************************************************************
+ElevationPyramid - Clase para mantener en la CPU una pirámide jerárquica
+de elevaciones mínimas y máximas sobre la imagen de profundidad actual,
+para intersecar rápidamente segmentos de línea con la superficie de
+arena.
+Copyright (c) 2014-2018 Oliver Kreylos
+Copyright (c) 2026 Sergio081096
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#ifndef ELEVATIONPYRAMID_INCLUDED
+#define ELEVATIONPYRAMID_INCLUDED
+
+#include <vector>
+#include <Kinect/FrameBuffer.h>
+
+#include "Types.h"
+
+class ElevationPyramid
+	{
+	/* Clases integradas: */
+	private:
+	struct Ray // Estructura para un segmento de línea en el espacio de imagen de profundidad
+		{
+		/* Elementos: */
+		public:
+		double q0[2]; // Posición de píxel del punto inicial
+		double dq[2]; // Dirección de píxel del segmento
+		double elevationNum[2]; // Numerador de la elevación del segmento como función racional lineal del parámetro
+		double elevationDenom[2]; // Denominador de la elevación del segmento como función racional lineal del parámetro
+		
+		/* Métodos: */
+		double calcElevation(double mu) const // Devuelve la elevación del segmento en el parámetro dado
+			{
+			return (elevationNum[0]+elevationNum[1]*mu)/(elevationDenom[0]+elevationDenom[1]*mu);
+			}
+		};
+	
+	/* Elementos: */
+	unsigned int size[2]; // Ancho y alto de la imagen de profundidad en píxeles
+	PTransform depthProjection; // Matriz de proyección desde el espacio de imagen de profundidad al espacio de la cámara
+	PTransform invDepthProjection; // Matriz de proyección desde el espacio de la cámara al espacio de imagen de profundidad
+	Plane basePlane; // Plano base para calcular la elevación de la superficie
+	double basePlaneDicEq[4]; // Ecuación del plano base en el espacio de imagen de profundidad
+	double weightDicEq[4]; // Ecuación para calcular el peso de un punto del espacio de imagen de profundidad en el espacio de la cámara
+	float* elevation; // Elevación de cada píxel de la imagen de profundidad sobre el plano base
+	unsigned int numLevels; // Número de niveles de la pirámide; el nivel cero contiene las celdas entre centros de píxeles
+	std::vector<unsigned int> levelSizes; // Ancho y alto de cada nivel de la pirámide en nodos
+	std::vector<std::vector<float> > levels; // Pares de elevaciones mínima y máxima de todos los nodos de cada nivel
+	std::vector<std::vector<unsigned char> > levelChanged; // Marcas de nodos modificados en la última actualización, por nivel
+	bool haveElevation; // Marcar si la pirámide ya fue construida con la transformación actual
+	unsigned int depthImageVersion; // Número de versión de la imagen de profundidad con la que se construyó la pirámide
+	
+	/* Métodos privados: */
+	bool clipRay(const Ray& ray,unsigned int level,unsigned int nodeX,unsigned int nodeY,double& mu0,double& mu1) const; // Recorta el intervalo de parámetros dado al rectángulo de píxeles de un nodo; devuelve falso si queda vacío
+	double intersectCell(const Ray& ray,unsigned int cellX,unsigned int cellY,double mu0,double mu1) const; // Interseca el segmento con la superficie bilineal de una celda; devuelve 2 si no hay intersección
+	double intersectNode(const Ray& ray,unsigned int level,unsigned int nodeX,unsigned int nodeY,double mu0,double mu1) const; // Interseca recursivamente el segmento con la superficie dentro de un nodo; devuelve 2 si no hay intersección
+	
+	/* Constructores y destructores: */
+	public:
+	ElevationPyramid(const unsigned int sSize[2]); // Crea una pirámide vacía para imágenes de profundidad del tamaño dado
+	private:
+	ElevationPyramid(const ElevationPyramid& source); // Prohibir copia constructor
+	ElevationPyramid& operator=(const ElevationPyramid& source); // Prohibir operador de asignación
+	public:
+	~ElevationPyramid(void);
+	
+	/* Métodos: */
+	void setTransform(const PTransform& newDepthProjection,const Plane& newBasePlane); // Establece una nueva proyección de profundidad y plano base; reconstruye toda la pirámide en la siguiente actualización
+	void update(const Kinect::FrameBuffer& depthImage,unsigned int newDepthImageVersion); // Actualiza la pirámide con la imagen de profundidad dada si su número de versión cambió
+	Scalar intersectLine(const Point& p0,const Point& p1,Scalar elevationMin,Scalar elevationMax) const; // Interseca un segmento de línea en el espacio de la cámara con la superficie dentro del rango de elevación dado; devuelve el parámetro de la primera intersección, o 2 si no hay
+	};
+
+#endif
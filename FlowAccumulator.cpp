@@ -0,0 +1,545 @@
+/***********************************************************************
+FlowAccumulator - Clase para calcular direcciones de flujo D8 y la
+acumulación de flujo sobre la superficie de arena en un hilo de fondo,
+con actualizaciones incrementales por mosaicos, y para representar la
+red de ríos resultante como textura.
+Copyright (c) 2026 Sergio081096
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include "FlowAccumulator.h"
+
+#include <string.h>
+#include <Math/Math.h>
+#include <GL/gl.h>
+#include <GL/GLContextData.h>
+#include <GL/Extensions/GLARBTextureRectangle.h>
+#include <GL/Extensions/GLARBTextureRg.h>
+
+namespace {
+
+/****************
+Helper functions:
+****************/
+
+const int dirDx[8]={ 1, 1, 0,-1,-1,-1, 0, 1}; // Pasos en x de las ocho direcciones D8
+const int dirDy[8]={ 0, 1, 1, 1, 0,-1,-1,-1}; // Pasos en y de las ocho direcciones D8
+const unsigned char sink=8; // Dirección de las celdas sin vecino más bajo
+
+}
+
+/******************************************
+Methods of class FlowAccumulator::DataItem:
+******************************************/
+
+FlowAccumulator::DataItem::DataItem(void)
+	:riverMaskTextureObject(0),
+	 riverMaskVersion(0)
+	{
+	/* Verifique e inicialice todas las extensiones OpenGL requeridas: */
+	GLARBTextureRectangle::initExtension();
+	GLARBTextureRg::initExtension();
+	
+	/* Crea el objeto de textura: */
+	glGenTextures(1,&riverMaskTextureObject);
+	}
+
+FlowAccumulator::DataItem::~DataItem(void)
+	{
+	/* Destruye el objeto de textura: */
+	glDeleteTextures(1,&riverMaskTextureObject);
+	}
+
+/********************************
+Methods of class FlowAccumulator:
+********************************/
+
+void FlowAccumulator::processElevationTile(unsigned int tileIndex)
+	{
+	/* Calcule el rectángulo del mosaico: */
+	unsigned int x0=(tileIndex%numTiles[0])*tileSize;
+	unsigned int y0=(tileIndex/numTiles[0])*tileSize;
+	unsigned int x1=Math::min(x0+tileSize,size[0]);
+	unsigned int y1=Math::min(y0+tileSize,size[1]);
+	
+	/* Compare las nuevas elevaciones con las usadas para las direcciones de flujo actuales: */
+	bool dirty=!haveElevation;
+	for(unsigned int y=y0;y<y1&&!dirty;++y)
+		{
+		const float* fPtr=frameData+(y*size[0]+x0);
+		const float* ePtr=elevation+(y*size[0]+x0);
+		double dy=double(y)+0.5;
+		for(unsigned int x=x0;x<x1;++x,++fPtr,++ePtr)
+			{
+			/* Transforme el píxel del espacio de imagen de profundidad en elevación sobre el plano base: */
+			double dx=double(x)+0.5;
+			double z=double(*fPtr);
+			double e=(basePlaneDicEq[0]*dx+basePlaneDicEq[1]*dy+basePlaneDicEq[2]*z+basePlaneDicEq[3])/(weightDicEq[0]*dx+weightDicEq[1]*dy+weightDicEq[2]*z+weightDicEq[3]);
+			if(Math::abs(float(e)-*ePtr)>=changeThreshold)
+				{
+				dirty=true;
+				break;
+				}
+			}
+		}
+	
+	tileDirty[tileIndex]=dirty;
+	if(dirty)
+		{
+		/* Acepte las nuevas elevaciones de todo el mosaico: */
+		for(unsigned int y=y0;y<y1;++y)
+			{
+			const float* fPtr=frameData+(y*size[0]+x0);
+			float* ePtr=elevation+(y*size[0]+x0);
+			double dy=double(y)+0.5;
+			for(unsigned int x=x0;x<x1;++x,++fPtr,++ePtr)
+				{
+				double dx=double(x)+0.5;
+				double z=double(*fPtr);
+				*ePtr=float((basePlaneDicEq[0]*dx+basePlaneDicEq[1]*dy+basePlaneDicEq[2]*z+basePlaneDicEq[3])/(weightDicEq[0]*dx+weightDicEq[1]*dy+weightDicEq[2]*z+weightDicEq[3]));
+				}
+			}
+		}
+	}
+
+void FlowAccumulator::processDirectionsTile(unsigned int tileIndex,std::vector<unsigned int>& changed)
+	{
+	/* Calcule el rectángulo del mosaico: */
+	unsigned int x0=(tileIndex%numTiles[0])*tileSize;
+	unsigned int y0=(tileIndex/numTiles[0])*tileSize;
+	unsigned int x1=Math::min(x0+tileSize,size[0]);
+	unsigned int y1=Math::min(y0+tileSize,size[1]);
+	
+	changed.clear();
+	for(unsigned int y=y0;y<y1;++y)
+		for(unsigned int x=x0;x<x1;++x)
+			{
+			/* Busque el vecino con la mayor pendiente descendente: */
+			unsigned int cell=y*size[0]+x;
+			float e=elevation[cell];
+			unsigned char bestDir=sink;
+			float bestSlope=0.0f;
+			for(int d=0;d<8;++d)
+				{
+				int nx=int(x)+dirDx[d];
+				int ny=int(y)+dirDy[d];
+				if(nx>=0&&nx<int(size[0])&&ny>=0&&ny<int(size[1]))
+					{
+					float slope=(e-elevation[cell+offsets[d]])*invDists[d];
+					if(bestSlope<slope)
+						{
+						bestDir=(unsigned char)(d);
+						bestSlope=slope;
+						}
+					}
+				}
+			
+			/* Recuerde la celda si su dirección cambió: */
+			newDirections[cell]=bestDir;
+			if(bestDir!=directions[cell])
+				changed.push_back(cell);
+			}
+	}
+
+void FlowAccumulator::processTask(unsigned int task)
+	{
+	unsigned int tileIndex=tasks[task];
+	if(passType==ELEVATION)
+		processElevationTile(tileIndex);
+	else
+		processDirectionsTile(tileIndex,tileChangedCells[tileIndex]);
+	}
+
+void FlowAccumulator::runPass(FlowAccumulator::PassType newPassType)
+	{
+	/* Procese todas las tareas del paso con todos los hilos: */
+	passType=newPassType;
+	taskPool.run(*this,(unsigned int)(tasks.size()));
+	}
+
+void FlowAccumulator::updateMask(unsigned int cell)
+	{
+	/* Asigne una intensidad logarítmica a las celdas con acumulación suficiente: */
+	unsigned int acc=accumulation[cell];
+	if(acc<minAccumulation)
+		riverMask[cell]=0;
+	else if(acc>=maxAccumulation)
+		riverMask[cell]=255;
+	else
+		riverMask[cell]=GLubyte(Math::log(float(acc)/float(minAccumulation))*255.0f/Math::log(float(maxAccumulation)/float(minAccumulation))+0.5f);
+	}
+
+void FlowAccumulator::accumulateAll(void)
+	{
+	unsigned int numCells=size[1]*size[0];
+	
+	/* Cuente las celdas que drenan en cada celda: */
+	memset(inDegrees,0,numCells);
+	for(unsigned int cell=0;cell<numCells;++cell)
+		{
+		accumulation[cell]=1;
+		if(directions[cell]!=sink)
+			++inDegrees[cell+offsets[directions[cell]]];
+		}
+	
+	/* Propague la acumulación río abajo en orden topológico: */
+	queue.clear();
+	for(unsigned int cell=0;cell<numCells;++cell)
+		if(inDegrees[cell]==0)
+			queue.push_back(cell);
+	while(!queue.empty())
+		{
+		unsigned int cell=queue.back();
+		queue.pop_back();
+		updateMask(cell);
+		if(directions[cell]!=sink)
+			{
+			unsigned int down=cell+offsets[directions[cell]];
+			accumulation[down]+=accumulation[cell];
+			if(--inDegrees[down]==0)
+				queue.push_back(down);
+			}
+		}
+	}
+
+bool FlowAccumulator::accumulateAffected(void)
+	{
+	unsigned int numCells=size[1]*size[0];
+	size_t maxAffected=numCells/4;
+	affectedCells.clear();
+	
+	/* Marque las celdas río abajo de las celdas modificadas a lo largo de las direcciones antiguas: */
+	for(std::vector<unsigned int>::iterator cIt=changedCells.begin();cIt!=changedCells.end();++cIt)
+		for(unsigned int cell=*cIt;directions[cell]!=sink;)
+			{
+			cell+=offsets[directions[cell]];
+			if(marks[cell]&0x1U)
+				break;
+			if(marks[cell]==0)
+				affectedCells.push_back(cell);
+			marks[cell]|=0x1U;
+			}
+	
+	/* Acepte las nuevas direcciones de flujo: */
+	for(std::vector<unsigned int>::iterator cIt=changedCells.begin();cIt!=changedCells.end();++cIt)
+		directions[*cIt]=newDirections[*cIt];
+	
+	/* Marque las celdas río abajo de las celdas modificadas a lo largo de las direcciones nuevas: */
+	for(std::vector<unsigned int>::iterator cIt=changedCells.begin();cIt!=changedCells.end()&&affectedCells.size()<=maxAffected;++cIt)
+		for(unsigned int cell=*cIt;directions[cell]!=sink;)
+			{
+			cell+=offsets[directions[cell]];
+			if(marks[cell]&0x2U)
+				break;
+			if(marks[cell]==0)
+				affectedCells.push_back(cell);
+			marks[cell]|=0x2U;
+			}
+	
+	if(affectedCells.size()>maxAffected)
+		{
+		/* Borre las marcas; es más barato recalcular toda la cuadrícula: */
+		for(std::vector<unsigned int>::iterator aIt=affectedCells.begin();aIt!=affectedCells.end();++aIt)
+			marks[*aIt]=0;
+		return false;
+		}
+	
+	/* Inicialice la acumulación de las celdas afectadas con las contribuciones de sus vecinos no afectados: */
+	queue.clear();
+	for(std::vector<unsigned int>::iterator aIt=affectedCells.begin();aIt!=affectedCells.end();++aIt)
+		{
+		unsigned int cell=*aIt;
+		int x=int(cell%size[0]);
+		int y=int(cell/size[0]);
+		accumulation[cell]=1;
+		inDegrees[cell]=0;
+		for(int d=0;d<8;++d)
+			{
+			int nx=x+dirDx[d];
+			int ny=y+dirDy[d];
+			if(nx>=0&&nx<int(size[0])&&ny>=0&&ny<int(size[1]))
+				{
+				/* Compruebe si el vecino drena en esta celda: */
+				unsigned int neighbor=cell+offsets[d];
+				if(directions[neighbor]==(d+4)%8)
+					{
+					if(marks[neighbor]!=0)
+						++inDegrees[cell];
+					else
+						accumulation[cell]+=accumulation[neighbor];
+					}
+				}
+			}
+		if(inDegrees[cell]==0)
+			queue.push_back(cell);
+		}
+	
+	/* Propague la acumulación por la región afectada en orden topológico: */
+	while(!queue.empty())
+		{
+		unsigned int cell=queue.back();
+		queue.pop_back();
+		marks[cell]=0;
+		updateMask(cell);
+		if(directions[cell]!=sink)
+			{
+			unsigned int down=cell+offsets[directions[cell]];
+			if(marks[down]!=0)
+				{
+				accumulation[down]+=accumulation[cell];
+				if(--inDegrees[down]==0)
+					queue.push_back(down);
+				}
+			}
+		}
+	
+	return true;
+	}
+
+void FlowAccumulator::processFrame(void)
+	{
+	/* Convierta el marco en elevaciones y detecte los mosaicos modificados: */
+	unsigned int totalTiles=numTiles[1]*numTiles[0];
+	tasks.clear();
+	for(unsigned int i=0;i<totalTiles;++i)
+		tasks.push_back(i);
+	runPass(ELEVATION);
+	bool fullUpdate=!haveElevation;
+	haveElevation=true;
+	
+	/* Vuelva a calcular las direcciones de los mosaicos modificados y de sus vecinos, cuyas celdas del borde dependen de ellos: */
+	tasks.clear();
+	for(unsigned int ty=0;ty<numTiles[1];++ty)
+		for(unsigned int tx=0;tx<numTiles[0];++tx)
+			{
+			bool affected=false;
+			for(unsigned int y=ty>0?ty-1:0;y<=ty+1&&y<numTiles[1]&&!affected;++y)
+				for(unsigned int x=tx>0?tx-1:0;x<=tx+1&&x<numTiles[0];++x)
+					affected=affected||tileDirty[y*numTiles[0]+x]!=0;
+			if(affected)
+				tasks.push_back(ty*numTiles[0]+tx);
+			}
+	if(tasks.empty())
+		return;
+	runPass(DIRECTIONS);
+	
+	/* Reúna las celdas modificadas de todos los mosaicos procesados: */
+	changedCells.clear();
+	for(std::vector<unsigned int>::iterator tIt=tasks.begin();tIt!=tasks.end();++tIt)
+		changedCells.insert(changedCells.end(),tileChangedCells[*tIt].begin(),tileChangedCells[*tIt].end());
+	if(changedCells.empty()&&!fullUpdate)
+		return;
+	
+	/* Actualice la acumulación de flujo de forma incremental si es posible: */
+	if(fullUpdate||changedCells.size()>size_t(size[1]*size[0]/16)||!accumulateAffected())
+		{
+		for(std::vector<unsigned int>::iterator cIt=changedCells.begin();cIt!=changedCells.end();++cIt)
+			directions[*cIt]=newDirections[*cIt];
+		accumulateAll();
+		}
+	
+	/* Publique la nueva máscara de ríos: */
+	Kinect::FrameBuffer& newMask=riverMasks.startNewValue();
+	memcpy(newMask.getData<GLubyte>(),riverMask,size[1]*size[0]*sizeof(GLubyte));
+	riverMasks.postNewValue();
+	}
+
+void* FlowAccumulator::accumulatorThreadMethod(void)
+	{
+	unsigned int lastInputFrameVersion=0;
+	while(true)
+		{
+		Kinect::FrameBuffer frame;
+		{
+		Threads::MutexCond::Lock inputLock(inputCond);
+		
+		/* Espere hasta que llegue un nuevo marco o el programa se apague: */
+		while(runAccumulatorThread&&lastInputFrameVersion==inputFrameVersion)
+			inputCond.wait(inputLock);
+		
+		/* Salte si el programa se está cerrando: */
+		if(!runAccumulatorThread)
+			break;
+		
+		/* Trabaja en el nuevo marco: */
+		frame=inputFrame;
+		lastInputFrameVersion=inputFrameVersion;
+		}
+		
+		/* Actualice la red de ríos: */
+		frameData=frame.getData<float>();
+		processFrame();
+		frameData=0;
+		}
+	
+	return 0;
+	}
+
+FlowAccumulator::FlowAccumulator(const unsigned int sSize[2],const PTransform& depthProjection,const Plane& basePlane,unsigned int sNumThreads,unsigned int sTileSize)
+	:tileSize(sTileSize),
+	 changeThreshold(0.1f),
+	 minAccumulation(200),
+	 maxAccumulation(20000),
+	 frameData(0),
+	 elevation(0),directions(0),newDirections(0),accumulation(0),marks(0),inDegrees(0),riverMask(0),
+	 haveElevation(false),
+	 inputFrameVersion(0),
+	 runAccumulatorThread(false),
+	 taskPool(sNumThreads),
+	 passType(ELEVATION),
+	 riverMaskVersion(0)
+	{
+	/* Copie el tamaño de la cuadrícula y calcule la disposición de los mosaicos: */
+	for(int i=0;i<2;++i)
+		{
+		size[i]=sSize[i];
+		numTiles[i]=(size[i]+tileSize-1)/tileSize;
+		}
+	tileDirty.resize(numTiles[1]*numTiles[0],0);
+	tileChangedCells.resize(numTiles[1]*numTiles[0]);
+	
+	/* Calcule los desplazamientos y distancias de las direcciones D8: */
+	for(int d=0;d<8;++d)
+		{
+		offsets[d]=ptrdiff_t(dirDy[d])*ptrdiff_t(size[0])+ptrdiff_t(dirDx[d]);
+		invDists[d]=dirDx[d]!=0&&dirDy[d]!=0?float(Math::sqrt(0.5)):1.0f;
+		}
+	
+	/* Transforme el plano base en el espacio de imagen de profundidad, como lo hace el renderizador de imágenes de profundidad: */
+	const PTransform::Matrix& dpm=depthProjection.getMatrix();
+	const Plane::Vector& bpn=basePlane.getNormal();
+	Scalar bpo=basePlane.getOffset();
+	for(int i=0;i<4;++i)
+		{
+		basePlaneDicEq[i]=dpm(0,i)*bpn[0]+dpm(1,i)*bpn[1]+dpm(2,i)*bpn[2]-dpm(3,i)*bpo;
+		weightDicEq[i]=dpm(3,i);
+		}
+	
+	/* Asigne las cuadrículas de cálculo: */
+	unsigned int numCells=size[1]*size[0];
+	elevation=new float[numCells];
+	directions=new unsigned char[numCells];
+	memset(directions,sink,numCells);
+	newDirections=new unsigned char[numCells];
+	accumulation=new unsigned int[numCells];
+	for(unsigned int i=0;i<numCells;++i)
+		accumulation[i]=1;
+	marks=new unsigned char[numCells];
+	memset(marks,0,numCells);
+	inDegrees=new unsigned char[numCells];
+	riverMask=new GLubyte[numCells];
+	memset(riverMask,0,numCells*sizeof(GLubyte));
+	
+	/* Asigne los buffers de salida: */
+	for(int i=0;i<3;++i)
+		{
+		riverMasks.getBuffer(i)=Kinect::FrameBuffer(size[0],size[1],numCells*sizeof(GLubyte));
+		memset(riverMasks.getBuffer(i).getData<GLubyte>(),0,numCells*sizeof(GLubyte));
+		}
+	
+	/* Inicie el hilo de cálculo: */
+	runAccumulatorThread=true;
+	accumulatorThread.start(this,&FlowAccumulator::accumulatorThreadMethod);
+	}
+
+FlowAccumulator::~FlowAccumulator(void)
+	{
+	/* Apague el hilo de cálculo antes de que se destruya el conjunto de hilos de trabajo: */
+	{
+	Threads::MutexCond::Lock inputLock(inputCond);
+	runAccumulatorThread=false;
+	inputCond.signal();
+	}
+	accumulatorThread.join();
+	
+	delete[] elevation;
+	delete[] directions;
+	delete[] newDirections;
+	delete[] accumulation;
+	delete[] marks;
+	delete[] inDegrees;
+	delete[] riverMask;
+	}
+
+void FlowAccumulator::initContext(GLContextData& contextData) const
+	{
+	/* Crea y registra un elemento de datos: */
+	DataItem* dataItem=new DataItem;
+	contextData.addDataItem(this,dataItem);
+	
+	/* Cree la textura de la máscara de ríos: */
+	glBindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->riverMaskTextureObject);
+	glTexParameteri(GL_TEXTURE_RECTANGLE_ARB,GL_TEXTURE_MIN_FILTER,GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_RECTANGLE_ARB,GL_TEXTURE_MAG_FILTER,GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_RECTANGLE_ARB,GL_TEXTURE_WRAP_S,GL_CLAMP);
+	glTexParameteri(GL_TEXTURE_RECTANGLE_ARB,GL_TEXTURE_WRAP_T,GL_CLAMP);
+	glPixelStorei(GL_UNPACK_ALIGNMENT,1);
+	glTexImage2D(GL_TEXTURE_RECTANGLE_ARB,0,GL_R8,size[0],size[1],0,GL_RED,GL_UNSIGNED_BYTE,riverMasks.getLockedValue().getData<GLubyte>());
+	glBindTexture(GL_TEXTURE_RECTANGLE_ARB,0);
+	dataItem->riverMaskVersion=riverMaskVersion;
+	}
+
+void FlowAccumulator::setChangeThreshold(float newChangeThreshold)
+	{
+	changeThreshold=newChangeThreshold;
+	}
+
+void FlowAccumulator::setAccumulationRange(unsigned int newMinAccumulation,unsigned int newMaxAccumulation)
+	{
+	minAccumulation=Math::max(newMinAccumulation,1U);
+	maxAccumulation=Math::max(newMaxAccumulation,minAccumulation+1U);
+	}
+
+void FlowAccumulator::receiveFilteredFrame(const Kinect::FrameBuffer& newFrame)
+	{
+	Threads::MutexCond::Lock inputLock(inputCond);
+	
+	/* Almacene el nuevo búfer en el búfer de entrada: */
+	inputFrame=newFrame;
+	++inputFrameVersion;
+	
+	/* Señale el hilo de fondo: */
+	inputCond.signal();
+	}
+
+bool FlowAccumulator::lockNewRiverMask(void)
+	{
+	/* Bloquee la máscara más reciente e invalide las texturas si es nueva: */
+	bool result=riverMasks.lockNewValue();
+	if(result)
+		++riverMaskVersion;
+	return result;
+	}
+
+void FlowAccumulator::bindRiverMaskTexture(GLContextData& contextData) const
+	{
+	/* Obtener el elemento de datos de contexto: */
+	DataItem* dataItem=contextData.retrieveDataItem<DataItem>(this);
+	
+	/* Vincula la textura de la máscara de ríos: */
+	glBindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->riverMaskTextureObject);
+	
+	/* Compruebe si la textura está desactualizada: */
+	if(dataItem->riverMaskVersion!=riverMaskVersion)
+		{
+		/* Cargue la nueva máscara de ríos: */
+		glPixelStorei(GL_UNPACK_ALIGNMENT,1);
+		glTexSubImage2D(GL_TEXTURE_RECTANGLE_ARB,0,0,0,size[0],size[1],GL_RED,GL_UNSIGNED_BYTE,riverMasks.getLockedValue().getData<GLubyte>());
+		dataItem->riverMaskVersion=riverMaskVersion;
+		}
+	}
@@ -0,0 +1,137 @@
+/***********************************************************************
+FlowAccumulator - Clase para calcular direcciones de flujo D8 y la
+acumulación de flujo sobre la superficie de arena en un hilo de fondo,
+con actualizaciones incrementales por mosaicos, y para representar la
+red de ríos resultante como textura.
+Copyright (c) 2026 Sergio081096
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#ifndef FLOWACCUMULATOR_INCLUDED
+#define FLOWACCUMULATOR_INCLUDED
+
+#include <stddef.h>
+#include <vector>
+#include <Threads/MutexCond.h>
+#include <Threads/Thread.h>
+#include <Threads/TripleBuffer.h>
+#include <GL/gl.h>
+#include <GL/GLObject.h>
+#include <Kinect/FrameBuffer.h>
+
+#include "Types.h"
+#include "TaskPool.h"
+
+class FlowAccumulator:public GLObject,private TaskPool::Tasks
+	{
+	/* Clases integradas: */
+	private:
+	struct DataItem:public GLObject::DataItem
+		{
+		/* Elementos: */
+		public:
+		GLuint riverMaskTextureObject; // Objeto de textura con la máscara de la red de ríos
+		unsigned int riverMaskVersion; // Número de versión de la máscara de ríos en el objeto de textura
+		
+		/* Constructores y destructores: */
+		DataItem(void);
+		virtual ~DataItem(void);
+		};
+	
+	enum PassType // Enumerado para los pasos paralelos del cálculo
+		{
+		ELEVATION, // Convierte el marco de profundidad en elevaciones y detecta mosaicos modificados
+		DIRECTIONS // Vuelve a calcular las direcciones de flujo de los mosaicos afectados
+		};
+	
+	/* Elementos: */
+	unsigned int size[2]; // Ancho y alto de la cuadrícula de celdas, igual al tamaño de los marcos de profundidad
+	unsigned int tileSize; // Ancho y alto de los mosaicos en celdas
+	unsigned int numTiles[2]; // Número de mosaicos en x e y
+	double basePlaneDicEq[4]; // Ecuación del plano base en el espacio de imagen de profundidad
+	double weightDicEq[4]; // Ecuación para calcular el peso de un punto del espacio de imagen de profundidad en el espacio de la cámara
+	ptrdiff_t offsets[8]; // Desplazamientos de índice de celda para las ocho direcciones D8
+	float invDists[8]; // Distancias inversas a las celdas vecinas en las ocho direcciones D8
+	float changeThreshold; // Cambio mínimo de elevación para marcar un mosaico como modificado
+	unsigned int minAccumulation; // Acumulación mínima en celdas para que una celda pertenezca a la red de ríos
+	unsigned int maxAccumulation; // Acumulación en celdas a la que la máscara de ríos se satura
+	
+	/* Estado del cálculo, solo usado por los hilos de fondo: */
+	const float* frameData; // Marco de profundidad que se está procesando
+	float* elevation; // Cuadrícula de elevación usada para las direcciones de flujo actuales
+	unsigned char* directions; // Dirección D8 de cada celda; 8 para sumideros
+	unsigned char* newDirections; // Direcciones D8 recalculadas en el paso actual
+	unsigned int* accumulation; // Número de celdas que drenan a través de cada celda, incluyéndose a sí misma
+	unsigned char* marks; // Marcas de celdas afectadas por el cambio de direcciones
+	unsigned char* inDegrees; // Número de celdas afectadas aún no procesadas que drenan en cada celda
+	GLubyte* riverMask; // Máscara de la red de ríos
+	std::vector<unsigned char> tileDirty; // Marcas de mosaicos modificados desde el último cálculo
+	std::vector<unsigned int> tasks; // Lista de índices de mosaicos a procesar en el paso paralelo actual
+	std::vector<std::vector<unsigned int> > tileChangedCells; // Listas de celdas cuya dirección de flujo cambió en cada mosaico en el paso actual
+	std::vector<unsigned int> changedCells; // Lista de celdas cuya dirección de flujo cambió en el paso actual
+	std::vector<unsigned int> affectedCells; // Lista de celdas cuya acumulación debe recalcularse
+	std::vector<unsigned int> queue; // Cola de celdas listas durante la ordenación topológica
+	bool haveElevation; // Marcar si la cuadrícula de elevación ya fue inicializada
+	
+	/* Estado del hilo de cálculo: */
+	Threads::MutexCond inputCond; // Variable de condición para señalar la llegada de un nuevo marco de entrada
+	Kinect::FrameBuffer inputFrame; // El marco de entrada más reciente
+	unsigned int inputFrameVersion; // Número de versión del marco de entrada
+	volatile bool runAccumulatorThread; // Marcar para mantener en ejecución el hilo de cálculo de fondo
+	Threads::Thread accumulatorThread; // El hilo de cálculo de fondo
+	
+	/* Estado de los hilos de trabajo: */
+	TaskPool taskPool; // Conjunto de hilos que ejecuta los pasos paralelos
+	PassType passType; // Tipo del paso paralelo actual
+	
+	/* Estado de salida: */
+	Threads::TripleBuffer<Kinect::FrameBuffer> riverMasks; // Triple buffer de máscaras de ríos
+	unsigned int riverMaskVersion; // Número de versión de la máscara de ríos bloqueada
+	
+	/* Métodos privados: */
+	void processElevationTile(unsigned int tileIndex); // Convierte el marco de profundidad en elevaciones para un mosaico y detecta si cambió
+	void processDirectionsTile(unsigned int tileIndex,std::vector<unsigned int>& changed); // Vuelve a calcular las direcciones de flujo de un mosaico y reemplaza la lista dada por sus celdas modificadas
+	virtual void processTask(unsigned int task); // Procesa un mosaico del paso paralelo actual
+	void runPass(PassType newPassType); // Ejecuta un paso paralelo sobre la lista de tareas actual con todos los hilos
+	void updateMask(unsigned int cell); // Actualiza la máscara de ríos de una celda a partir de su acumulación
+	void accumulateAll(void); // Vuelve a calcular la acumulación de flujo de todas las celdas
+	bool accumulateAffected(void); // Vuelve a calcular la acumulación de las celdas río abajo de las celdas modificadas; devuelve falso si la región afectada es demasiado grande
+	void processFrame(void); // Actualiza la red de ríos a partir del marco de entrada actual
+	void* accumulatorThreadMethod(void); // Método para el hilo de cálculo de fondo
+	
+	/* Constructores y destructores: */
+	public:
+	FlowAccumulator(const unsigned int sSize[2],const PTransform& depthProjection,const Plane& basePlane,unsigned int sNumThreads=4,unsigned int sTileSize=32); // Crea un acumulador de flujo para marcos de profundidad filtrados del tamaño dado
+	private:
+	FlowAccumulator(const FlowAccumulator& source); // Prohibir copia constructor
+	FlowAccumulator& operator=(const FlowAccumulator& source); // Prohibir operador de asignación
+	public:
+	virtual ~FlowAccumulator(void);
+	
+	/* Métodos de GLObject: */
+	virtual void initContext(GLContextData& contextData) const;
+	
+	/* Nuevos métodos: */
+	void setChangeThreshold(float newChangeThreshold); // Establece el cambio mínimo de elevación para marcar un mosaico como modificado
+	void setAccumulationRange(unsigned int newMinAccumulation,unsigned int newMaxAccumulation); // Establece el rango de acumulación en celdas que se representa en la máscara de ríos
+	void receiveFilteredFrame(const Kinect::FrameBuffer& newFrame); // Llamado para recibir un nuevo marco de profundidad filtrado
+	bool lockNewRiverMask(void); // Bloquea la máscara de ríos más reciente; devuelve verdadero si es nueva
+	void bindRiverMaskTexture(GLContextData& contextData) const; // Vincula la textura de la máscara de ríos bloqueada a la unidad de textura activa actualmente
+	};
+
+#endif
@@ -0,0 +1,539 @@
+/***********************************************************************
+HTTPUpdateClient - Clase para enviar mensajes de actualización a un
+servidor web desde un hilo de fondo, con tiempos de espera de conexión y
+lectura, reintentos con espera exponencial, reutilización de la conexión
+y combinación de actualizaciones idénticas en cola.
+Copyright (c) 2026 Sergio081096
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include "HTTPUpdateClient.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdexcept>
+#include <Misc/PrintInteger.h>
+#include <Misc/ThrowStdErr.h>
+#include <Math/Math.h>
+
+namespace {
+
+/**************
+Helper objects:
+**************/
+
+const double maxRetryDelay=30.0; // Espera máxima en segundos entre dos reintentos
+const size_t maxLineLength=8192; // Longitud máxima de una línea del encabezado de respuesta
+
+/****************
+Helper functions:
+****************/
+
+int toMilliseconds(double seconds)
+	{
+	return seconds>0.0?int(seconds*1000.0+0.5):0;
+	}
+
+std::string trim(const std::string& string)
+	{
+	std::string::size_type begin=string.find_first_not_of(" \t");
+	if(begin==std::string::npos)
+		return std::string();
+	std::string::size_type end=string.find_last_not_of(" \t");
+	return string.substr(begin,end+1-begin);
+	}
+
+bool containsToken(const std::string& value,const char* token)
+	{
+	/* Busque el símbolo dado en la lista separada por comas sin distinguir mayúsculas: */
+	std::string::size_type start=0;
+	while(start<=value.size())
+		{
+		std::string::size_type end=value.find(',',start);
+		if(end==std::string::npos)
+			end=value.size();
+		if(strcasecmp(trim(value.substr(start,end-start)).c_str(),token)==0)
+			return true;
+		start=end+1;
+		}
+	return false;
+	}
+
+}
+
+/*********************************
+Methods of class HTTPUpdateClient:
+*********************************/
+
+void HTTPUpdateClient::waitForSocket(short events,double timeout)
+	{
+	/* Espere en el socket y en la tubería de activación a la vez: */
+	struct pollfd fds[2];
+	fds[0].fd=socketFd;
+	fds[0].events=events;
+	fds[0].revents=0;
+	fds[1].fd=wakePipe[0];
+	fds[1].events=POLLIN;
+	fds[1].revents=0;
+	int result;
+	do
+		{
+		result=poll(fds,2,toMilliseconds(timeout));
+		}
+	while(result<0&&errno==EINTR);
+	
+	if(result<0)
+		Misc::throwStdErr("HTTPUpdateClient: Error while waiting for server: %s",strerror(errno));
+	if(fds[1].revents!=0)
+		Misc::throwStdErr("HTTPUpdateClient: Client is shutting down");
+	if(result==0)
+		Misc::throwStdErr("HTTPUpdateClient: Server did not respond within %.1f s",timeout);
+	}
+
+void HTTPUpdateClient::closeConnection(void)
+	{
+	if(socketFd>=0)
+		{
+		close(socketFd);
+		socketFd=-1;
+		}
+	bufferPos=bufferEnd=0;
+	}
+
+void HTTPUpdateClient::openConnection(const HTTPUpdateClient::Request& request)
+	{
+	/* Resuelva el nombre del servidor: */
+	char portString[6];
+	const char* port=Misc::print(request.port,portString+5);
+	struct addrinfo hints;
+	memset(&hints,0,sizeof(hints));
+	hints.ai_family=AF_UNSPEC;
+	hints.ai_socktype=SOCK_STREAM;
+	struct addrinfo* addresses=0;
+	int aiResult=getaddrinfo(request.hostName.c_str(),port,&hints,&addresses);
+	if(aiResult!=0)
+		Misc::throwStdErr("HTTPUpdateClient: Unable to resolve host name %s due to %s",request.hostName.c_str(),gai_strerror(aiResult));
+	
+	/* Pruebe cada dirección con una conexión no bloqueante hasta que una tenga éxito: */
+	std::string lastError="no address";
+	for(struct addrinfo* aiPtr=addresses;aiPtr!=0&&socketFd<0;aiPtr=aiPtr->ai_next)
+		{
+		int fd=socket(aiPtr->ai_family,aiPtr->ai_socktype,aiPtr->ai_protocol);
+		if(fd<0)
+			{
+			lastError=strerror(errno);
+			continue;
+			}
+		fcntl(fd,F_SETFL,fcntl(fd,F_GETFL)|O_NONBLOCK);
+		if(connect(fd,aiPtr->ai_addr,aiPtr->ai_addrlen)<0&&errno!=EINPROGRESS)
+			{
+			lastError=strerror(errno);
+			close(fd);
+			continue;
+			}
+		
+		/* Espere hasta que la conexión se establezca o falle: */
+		socketFd=fd;
+		try
+			{
+			waitForSocket(POLLOUT,request.connectTimeout);
+			int error=0;
+			socklen_t errorLen=sizeof(error);
+			if(getsockopt(fd,SOL_SOCKET,SO_ERROR,&error,&errorLen)<0)
+				error=errno;
+			if(error!=0)
+				{
+				lastError=strerror(error);
+				closeConnection();
+				}
+			}
+		catch(const std::runtime_error& err)
+			{
+			lastError=err.what();
+			closeConnection();
+			}
+		}
+	freeaddrinfo(addresses);
+	if(socketFd<0)
+		Misc::throwStdErr("HTTPUpdateClient: Unable to connect to %s:%d due to %s",request.hostName.c_str(),request.port,lastError.c_str());
+	
+	/* Envíe las solicitudes cortas de inmediato: */
+	int flag=1;
+	setsockopt(socketFd,IPPROTO_TCP,TCP_NODELAY,&flag,sizeof(flag));
+	connectedHostName=request.hostName;
+	connectedPort=request.port;
+	bufferPos=bufferEnd=0;
+	}
+
+void HTTPUpdateClient::sendAll(const std::string& data,double timeout)
+	{
+	const char* dataPtr=data.data();
+	size_t dataSize=data.size();
+	while(dataSize>0)
+		{
+		ssize_t numWritten=send(socketFd,dataPtr,dataSize,MSG_NOSIGNAL);
+		if(numWritten>0)
+			{
+			dataPtr+=numWritten;
+			dataSize-=size_t(numWritten);
+			}
+		else if(errno==EAGAIN||errno==EWOULDBLOCK)
+			waitForSocket(POLLOUT,timeout);
+		else if(errno!=EINTR)
+			Misc::throwStdErr("HTTPUpdateClient: Unable to send request due to %s",strerror(errno));
+		}
+	}
+
+bool HTTPUpdateClient::fillBuffer(double timeout)
+	{
+	while(true)
+		{
+		ssize_t numRead=recv(socketFd,buffer,sizeof(buffer),0);
+		if(numRead>0)
+			{
+			bufferPos=0;
+			bufferEnd=size_t(numRead);
+			return true;
+			}
+		else if(numRead==0)
+			return false;
+		else if(errno==EAGAIN||errno==EWOULDBLOCK)
+			waitForSocket(POLLIN,timeout);
+		else if(errno!=EINTR)
+			Misc::throwStdErr("HTTPUpdateClient: Unable to read reply due to %s",strerror(errno));
+		}
+	}
+
+int HTTPUpdateClient::getChar(double timeout)
+	{
+	if(bufferPos==bufferEnd&&!fillBuffer(timeout))
+		Misc::throwStdErr("HTTPUpdateClient: Server closed the connection");
+	return (unsigned char)(buffer[bufferPos++]);
+	}
+
+std::string HTTPUpdateClient::readLine(double timeout)
+	{
+	std::string result;
+	int c;
+	while((c=getChar(timeout))!='\n')
+		{
+		if(result.size()>=maxLineLength)
+			Misc::throwStdErr("HTTPUpdateClient: Malformed HTTP reply header");
+		result.push_back(char(c));
+		}
+	if(!result.empty()&&result[result.size()-1]=='\r')
+		result.erase(result.size()-1);
+	return result;
+	}
+
+void HTTPUpdateClient::skipBytes(size_t numBytes,double timeout)
+	{
+	while(numBytes>0)
+		{
+		if(bufferPos==bufferEnd&&!fillBuffer(timeout))
+			Misc::throwStdErr("HTTPUpdateClient: Server closed the connection");
+		size_t skip=Math::min(numBytes,bufferEnd-bufferPos);
+		bufferPos+=skip;
+		numBytes-=skip;
+		}
+	}
+
+void HTTPUpdateClient::sendRequest(const HTTPUpdateClient::Request& request,bool& retryable)
+	{
+	/* Los errores de red y del servidor son temporales mientras no se demuestre lo contrario: */
+	retryable=true;
+	double timeout=request.readTimeout;
+	
+	/* Ensamble la solicitud PUT: */
+	std::string httpRequest;
+	httpRequest.append("PUT /");
+	httpRequest.append(request.page);
+	httpRequest.append(" HTTP/1.1\r\n");
+	
+	httpRequest.append("Host: ");
+	httpRequest.append(request.hostName);
+	httpRequest.push_back(':');
+	char portString[6];
+	httpRequest.append(Misc::print(request.port,portString+5));
+	httpRequest.append("\r\n");
+	
+	httpRequest.append("Accept: */*\r\n");
+	
+	httpRequest.append("Content-Length: ");
+	char contentLengthString[21];
+	httpRequest.append(Misc::print(request.message.size(),contentLengthString+20));
+	httpRequest.append("\r\n");
+	
+	httpRequest.append("Content-Type: application/x-www-form-urlencoded\r\n");
+	
+	/* Termina el encabezado de solicitud y añada el contenido: */
+	httpRequest.append("\r\n");
+	httpRequest.append(request.message);
+	
+	/* Reutilice la conexión abierta si va al mismo servidor y éste no la cerró mientras estaba inactiva: */
+	if(socketFd>=0)
+		{
+		char peek;
+		ssize_t numPeeked=recv(socketFd,&peek,1,MSG_PEEK|MSG_DONTWAIT);
+		bool idle=numPeeked<0&&(errno==EAGAIN||errno==EWOULDBLOCK);
+		if(!idle||connectedHostName!=request.hostName||connectedPort!=request.port)
+			closeConnection();
+		}
+	if(socketFd<0)
+		openConnection(request);
+	
+	/* Envíe la solicitud y lea la línea de estado: */
+	sendAll(httpRequest,timeout);
+	std::string statusLine=readLine(timeout);
+	
+	/* Analice la línea de estado: */
+	if(statusLine.compare(0,5,"HTTP/")!=0)
+		Misc::throwStdErr("HTTPUpdateClient: Not an HTTP reply");
+	bool keepAlive=statusLine.compare(0,8,"HTTP/1.0")!=0;
+	std::string::size_type codeStart=statusLine.find(' ');
+	if(codeStart==std::string::npos)
+		Misc::throwStdErr("HTTPUpdateClient: Malformed HTTP status line");
+	unsigned int statusCode=(unsigned int)(atoi(statusLine.c_str()+codeStart+1));
+	std::string::size_type reasonStart=statusLine.find(' ',codeStart+1);
+	std::string reason=reasonStart!=std::string::npos?statusLine.substr(reasonStart+1):std::string();
+	
+	/* Analizar las opciones de respuesta hasta la primera línea vacía: */
+	bool replyChunked=false;
+	bool replySized=false;
+	size_t replySize=0;
+	while(true)
+		{
+		std::string line=readLine(timeout);
+		if(line.empty())
+			break;
+		std::string::size_type colon=line.find(':');
+		if(colon==std::string::npos)
+			Misc::throwStdErr("HTTPUpdateClient: Malformed HTTP reply header");
+		std::string option=trim(line.substr(0,colon));
+		std::string value=trim(line.substr(colon+1));
+		if(strcasecmp(option.c_str(),"Transfer-Encoding")==0)
+			replyChunked=containsToken(value,"chunked");
+		else if(strcasecmp(option.c_str(),"Content-Length")==0)
+			{
+			replySized=true;
+			replySize=size_t(strtoull(value.c_str(),0,10));
+			}
+		else if(strcasecmp(option.c_str(),"Connection")==0)
+			{
+			if(containsToken(value,"close"))
+				keepAlive=false;
+			else if(containsToken(value,"keep-alive"))
+				keepAlive=true;
+			}
+		}
+	
+	/* Salte la entidad de respuesta para dejar la conexión lista para la siguiente solicitud: */
+	if(statusCode==204||statusCode==304||(statusCode>=100&&statusCode<200))
+		{
+		/* Estas respuestas no tienen entidad: */
+		}
+	else if(replyChunked)
+		{
+		/* Lea todos los fragmentos hasta el fragmento final: */
+		while(true)
+			{
+			std::string chunkHeader=readLine(timeout);
+			char* end;
+			size_t chunkSize=size_t(strtoull(chunkHeader.c_str(),&end,16));
+			if(end==chunkHeader.c_str())
+				Misc::throwStdErr("HTTPUpdateClient: Malformed HTTP chunk header");
+			if(chunkSize==0)
+				break;
+			skipBytes(chunkSize,timeout);
+			if(!readLine(timeout).empty())
+				Misc::throwStdErr("HTTPUpdateClient: Malformed HTTP chunk footer");
+			}
+		
+		/* Saltar el remolque del cuerpo: */
+		while(!readLine(timeout).empty())
+			;
+		}
+	else if(replySized)
+		skipBytes(replySize,timeout);
+	else
+		{
+		/* Lea hasta que el servidor cierre la conexión: */
+		while(fillBuffer(timeout))
+			bufferPos=bufferEnd;
+		keepAlive=false;
+		}
+	if(!keepAlive)
+		closeConnection();
+	
+	/* Compruebe si el servidor aceptó el mensaje; los errores del cliente no mejoran al reintentar: */
+	if(statusCode<200||statusCode>=300)
+		{
+		retryable=statusCode>=500||statusCode==408||statusCode==429;
+		Misc::throwStdErr("HTTPUpdateClient: HTTP error %u: %s",statusCode,reason.c_str());
+		}
+	}
+
+bool HTTPUpdateClient::waitForRetry(double delay)
+	{
+	/* Espere en la tubería de activación para que el apagado interrumpa la espera: */
+	struct pollfd fd;
+	fd.fd=wakePipe[0];
+	fd.events=POLLIN;
+	fd.revents=0;
+	int result;
+	do
+		{
+		result=poll(&fd,1,toMilliseconds(delay));
+		}
+	while(result<0&&errno==EINTR);
+	
+	return result==0&&runClientThread;
+	}
+
+void* HTTPUpdateClient::clientThreadMethod(void)
+	{
+	while(true)
+		{
+		/* Espere hasta que haya un mensaje pendiente o el programa se apague: */
+		QueuedRequest qr;
+		{
+		Threads::MutexCond::Lock queueLock(queueCond);
+		while(runClientThread&&queue.empty())
+			queueCond.wait(queueLock);
+		if(!runClientThread)
+			break;
+		qr=queue.front();
+		queue.pop_front();
+		}
+		
+		/* Envíe el mensaje, reintentando los errores temporales con esperas crecientes: */
+		Result result;
+		result.url=qr.request.hostName;
+		result.url.push_back(':');
+		char portString[6];
+		result.url.append(Misc::print(qr.request.port,portString+5));
+		result.url.push_back('/');
+		result.url.append(qr.request.page);
+		result.numAttempts=0;
+		result.numCoalesced=qr.numCoalesced;
+		double delay=qr.request.retryDelay;
+		while(true)
+			{
+			++result.numAttempts;
+			bool retryable=true;
+			try
+				{
+				sendRequest(qr.request,retryable);
+				result.error.clear();
+				break;
+				}
+			catch(const std::runtime_error& err)
+				{
+				/* El estado de la conexión es desconocido después de un error: */
+				closeConnection();
+				result.error=err.what();
+				}
+			
+			if(!retryable||result.numAttempts>qr.request.maxRetries||!waitForRetry(delay))
+				break;
+			delay=Math::min(delay*2.0,maxRetryDelay);
+			}
+		result.time=double(qr.queueTime.setAndDiff());
+		
+		/* Guarde el resultado para el hilo principal: */
+		{
+		Threads::MutexCond::Lock queueLock(queueCond);
+		results.push_back(result);
+		}
+		}
+	
+	closeConnection();
+	
+	return 0;
+	}
+
+HTTPUpdateClient::HTTPUpdateClient(void)
+	:runClientThread(false),
+	 socketFd(-1),connectedPort(0),
+	 bufferPos(0),bufferEnd(0)
+	{
+	/* Cree la tubería que interrumpe las esperas del hilo del cliente: */
+	if(pipe(wakePipe)<0)
+		Misc::throwStdErr("HTTPUpdateClient: Unable to create wake-up pipe due to %s",strerror(errno));
+	
+	/* Inicie el hilo del cliente: */
+	runClientThread=true;
+	clientThread.start(this,&HTTPUpdateClient::clientThreadMethod);
+	}
+
+HTTPUpdateClient::~HTTPUpdateClient(void)
+	{
+	/* Apague el hilo del cliente e interrumpa su espera o conexión en curso: */
+	{
+	Threads::MutexCond::Lock queueLock(queueCond);
+	runClientThread=false;
+	queueCond.signal();
+	}
+	char wake=0;
+	if(write(wakePipe[1],&wake,1)<0)
+		{
+		/* La espera del hilo termina igualmente al vencer su tiempo: */
+		}
+	clientThread.join();
+	
+	close(wakePipe[0]);
+	close(wakePipe[1]);
+	}
+
+bool HTTPUpdateClient::postUpdate(const HTTPUpdateClient::Request& request)
+	{
+	Threads::MutexCond::Lock queueLock(queueCond);
+	
+	/* Combine el mensaje con uno idéntico que aún espera en la cola: */
+	for(std::deque<QueuedRequest>::iterator qIt=queue.begin();qIt!=queue.end();++qIt)
+		if(qIt->request.isSameUpdate(request))
+			{
+			++qIt->numCoalesced;
+			return false;
+			}
+	
+	/* Agregue el mensaje a la cola y despierte el hilo del cliente: */
+	QueuedRequest qr;
+	qr.request=request;
+	qr.numCoalesced=0;
+	queue.push_back(qr);
+	queueCond.signal();
+	
+	return true;
+	}
+
+void HTTPUpdateClient::getResults(std::vector<HTTPUpdateClient::Result>& newResults)
+	{
+	Threads::MutexCond::Lock queueLock(queueCond);
+	newResults.insert(newResults.end(),results.begin(),results.end());
+	results.clear();
+	}
@@ -0,0 +1,130 @@
+/***********************************************************************
+HTTPUpdateClient - Clase para enviar mensajes de actualización a un
+servidor web desde un hilo de fondo, con tiempos de espera de conexión y
+lectura, reintentos con espera exponencial, reutilización de la conexión
+y combinación de actualizaciones idénticas en cola.
+Copyright (c) 2026 Sergio081096
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#ifndef HTTPUPDATECLIENT_INCLUDED
+#define HTTPUPDATECLIENT_INCLUDED
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <Threads/MutexCond.h>
+#include <Threads/Thread.h>
+#include <Realtime/Time.h>
+
+class HTTPUpdateClient
+	{
+	/* Clases integradas: */
+	public:
+	struct Request // Estructura para un mensaje de actualización
+		{
+		/* Elementos: */
+		public:
+		std::string hostName; // Nombre del servidor web
+		int port; // Número de puerto TCP del servidor web
+		std::string page; // Nombre de la página en el servidor web en la que se publica el mensaje
+		std::string message; // El mensaje a enviar
+		double connectTimeout; // Tiempo máximo en segundos para establecer una conexión
+		double readTimeout; // Tiempo máximo en segundos de inactividad al enviar la solicitud o leer la respuesta
+		unsigned int maxRetries; // Número máximo de reintentos tras un error temporal
+		double retryDelay; // Espera en segundos antes del primer reintento; se duplica en cada reintento
+		
+		/* Constructores y destructores: */
+		Request(void)
+			:port(80),connectTimeout(2.0),readTimeout(5.0),maxRetries(3),retryDelay(0.5)
+			{
+			}
+		
+		/* Métodos: */
+		bool isSameUpdate(const Request& other) const // Devuelve verdadero si ambas solicitudes publican el mismo mensaje en la misma página
+			{
+			return hostName==other.hostName&&port==other.port&&page==other.page&&message==other.message;
+			}
+		};
+	
+	struct Result // Estructura para el resultado de un mensaje de actualización terminado
+		{
+		/* Elementos: */
+		public:
+		std::string url; // Servidor, puerto y página a los que se envió el mensaje
+		std::string error; // Mensaje de error, o vacío si el servidor aceptó el mensaje
+		unsigned int numAttempts; // Número de intentos de envío
+		unsigned int numCoalesced; // Número de actualizaciones idénticas combinadas en esta
+		double time; // Tiempo en segundos desde la puesta en cola hasta el resultado
+		};
+	
+	private:
+	struct QueuedRequest // Estructura para un mensaje de actualización en cola
+		{
+		/* Elementos: */
+		public:
+		Request request; // El mensaje de actualización
+		unsigned int numCoalesced; // Número de actualizaciones idénticas combinadas en esta
+		Realtime::TimePointMonotonic queueTime; // Momento de la puesta en cola
+		};
+	
+	/* Elementos: */
+	
+	/* Estado compartido entre los hilos: */
+	Threads::MutexCond queueCond; // Variable de condición para señalar nuevos mensajes al hilo del cliente
+	std::deque<QueuedRequest> queue; // Cola de mensajes pendientes que aún no se están enviando
+	std::vector<Result> results; // Resultados de mensajes terminados aún no recogidos
+	int wakePipe[2]; // Tubería para interrumpir las esperas del hilo del cliente al apagarse
+	volatile bool runClientThread; // Marcar para mantener en ejecución el hilo del cliente
+	Threads::Thread clientThread; // El hilo del cliente
+	
+	/* Estado de la conexión, solo usado por el hilo del cliente: */
+	int socketFd; // Descriptor de socket de la conexión abierta, o -1
+	std::string connectedHostName; // Nombre del servidor de la conexión abierta
+	int connectedPort; // Puerto de la conexión abierta
+	char buffer[4096]; // Búfer de lectura de la respuesta
+	size_t bufferPos,bufferEnd; // Intervalo de datos no leídos en el búfer de lectura
+	
+	/* Métodos privados: */
+	void waitForSocket(short events,double timeout); // Espera hasta que el socket esté listo para los eventos dados; lanza una excepción al vencer el tiempo o al apagarse
+	void closeConnection(void); // Cierra la conexión abierta
+	void openConnection(const Request& request); // Abre una conexión al servidor de la solicitud dada
+	void sendAll(const std::string& data,double timeout); // Escribe los datos dados en la conexión
+	bool fillBuffer(double timeout); // Lee más datos de la conexión; devuelve falso al final del flujo
+	int getChar(double timeout); // Devuelve el siguiente carácter de la respuesta; lanza una excepción al final del flujo
+	std::string readLine(double timeout); // Lee una línea de la respuesta sin el par CR/LF
+	void skipBytes(size_t numBytes,double timeout); // Salta el número dado de bytes de la respuesta
+	void sendRequest(const Request& request,bool& retryable); // Envía una solicitud por la conexión abierta o una nueva y lee la respuesta; lanza una excepción si falla e indica si merece un reintento
+	bool waitForRetry(double delay); // Espera el tiempo dado antes de un reintento; devuelve falso si el cliente se está apagando
+	void* clientThreadMethod(void); // Método para el hilo del cliente
+	
+	/* Constructores y destructores: */
+	public:
+	HTTPUpdateClient(void); // Crea un cliente e inicia su hilo
+	private:
+	HTTPUpdateClient(const HTTPUpdateClient& source); // Prohibir copia constructor
+	HTTPUpdateClient& operator=(const HTTPUpdateClient& source); // Prohibir operador de asignación
+	public:
+	~HTTPUpdateClient(void); // Interrumpe el mensaje en curso, descarta los pendientes y cierra la conexión
+	
+	/* Métodos: */
+	bool postUpdate(const Request& request); // Pone en cola un mensaje de actualización sin bloquear; devuelve falso si se combinó con un mensaje idéntico ya en cola
+	void getResults(std::vector<Result>& newResults); // Añade los resultados de los mensajes terminados al vector dado y los olvida
+	};
+
+#endif
@@ -0,0 +1,405 @@
+/***********************************************************************
+HTTPUpdateClientCheck - Utilidad que comprueba el cliente de mensajes de
+actualización contra un servidor web sustituto local que simula
+conexiones persistentes, respuestas fragmentadas, errores temporales y
+permanentes, respuestas delimitadas por el cierre de la conexión y un
+servidor que nunca responde.
+Copyright (c) 2026 Sergio081096
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <stdexcept>
+#include <Misc/ThrowStdErr.h>
+#include <Threads/Mutex.h>
+#include <Threads/Thread.h>
+#include <Realtime/Time.h>
+
+#include "HTTPUpdateClient.h"
+
+namespace {
+
+/**************
+Helper classes:
+**************/
+
+class StandInServer // Clase para un servidor web local de un solo hilo que responde según la página solicitada
+	{
+	/* Elementos: */
+	private:
+	int listenFd; // Socket de escucha en la interfaz local
+	int port; // Puerto asignado al socket de escucha
+	int stopPipe[2]; // Tubería para interrumpir las esperas del hilo del servidor
+	Threads::Mutex statsMutex; // Mutex que protege los contadores
+	unsigned int numConnections; // Número de conexiones aceptadas
+	unsigned int numRequests; // Número de solicitudes recibidas
+	unsigned int numFlakyRequests; // Número de solicitudes recibidas por la página con errores temporales
+	std::vector<int> hungFds; // Conexiones que nunca reciben una respuesta
+	int connFd; // Conexión atendida, o -1
+	char buffer[4096]; // Búfer de lectura de la solicitud
+	size_t bufferPos,bufferEnd; // Intervalo de datos no leídos en el búfer de lectura
+	Threads::Thread serverThread; // El hilo del servidor
+	
+	/* Métodos privados: */
+	bool waitForInput(int fd) // Espera hasta que haya datos en el descriptor dado; devuelve falso al apagarse
+		{
+		struct pollfd fds[2];
+		fds[0].fd=fd;
+		fds[0].events=POLLIN;
+		fds[0].revents=0;
+		fds[1].fd=stopPipe[0];
+		fds[1].events=POLLIN;
+		fds[1].revents=0;
+		while(poll(fds,2,-1)<0&&errno==EINTR)
+			;
+		return fds[1].revents==0;
+		}
+	int getChar(void) // Devuelve el siguiente carácter de la solicitud, o -1 al final del flujo o al apagarse
+		{
+		if(bufferPos==bufferEnd)
+			{
+			if(!waitForInput(connFd))
+				return -1;
+			ssize_t numRead=recv(connFd,buffer,sizeof(buffer),0);
+			if(numRead<=0)
+				return -1;
+			bufferPos=0;
+			bufferEnd=size_t(numRead);
+			}
+		return (unsigned char)(buffer[bufferPos++]);
+		}
+	bool readLine(std::string& line) // Lee una línea de la solicitud sin el par CR/LF; devuelve falso al final del flujo
+		{
+		line.clear();
+		int c;
+		while((c=getChar())!='\n')
+			{
+			if(c<0)
+				return false;
+			line.push_back(char(c));
+			}
+		if(!line.empty()&&line[line.size()-1]=='\r')
+			line.erase(line.size()-1);
+		return true;
+		}
+	void reply(const char* text) // Envía la respuesta dada completa
+		{
+		if(send(connFd,text,strlen(text),MSG_NOSIGNAL)<0)
+			{
+			/* El cliente verá la conexión cerrada: */
+			}
+		}
+	bool serveRequest(void) // Lee y responde a una solicitud; devuelve falso si el servidor deja de atender la conexión
+		{
+		/* Lea la línea de solicitud y el encabezado: */
+		std::string requestLine;
+		if(!readLine(requestLine))
+			return false;
+		size_t contentLength=0;
+		std::string line;
+		while(true)
+			{
+			if(!readLine(line))
+				return false;
+			if(line.empty())
+				break;
+			if(strncasecmp(line.c_str(),"Content-Length:",15)==0)
+				contentLength=size_t(strtoul(line.c_str()+15,0,10));
+			}
+		for(size_t i=0;i<contentLength;++i)
+			if(getChar()<0)
+				return false;
+		
+		/* Extraiga la página de la línea de solicitud: */
+		std::string::size_type pageStart=requestLine.find(" /");
+		std::string::size_type pageEnd=pageStart!=std::string::npos?requestLine.find(' ',pageStart+2):std::string::npos;
+		if(pageEnd==std::string::npos)
+			{
+			reply("HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\n\r\n");
+			return true;
+			}
+		std::string page=requestLine.substr(pageStart+2,pageEnd-(pageStart+2));
+		bool flaky=page=="flaky";
+		{
+		Threads::Mutex::Lock statsLock(statsMutex);
+		++numRequests;
+		if(flaky)
+			++numFlakyRequests;
+		}
+		
+		/* Responda según la página: */
+		if(page=="ok")
+			reply("HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nok");
+		else if(page=="chunked")
+			reply("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n3\r\nabc\r\n5\r\ndefgh\r\n0\r\nX-Trailer: 1\r\n\r\n");
+		else if(flaky)
+			{
+			/* Falle temporalmente en las dos primeras solicitudes: */
+			Threads::Mutex::Lock statsLock(statsMutex);
+			if(numFlakyRequests<=2)
+				reply("HTTP/1.1 503 Service Unavailable\r\nContent-Length: 4\r\n\r\nbusy");
+			else
+				reply("HTTP/1.1 204 No Content\r\n\r\n");
+			}
+		else if(page=="missing")
+			reply("HTTP/1.1 404 Not Found\r\nContent-Length: 9\r\n\r\nnot found");
+		else if(page=="close")
+			{
+			/* Envíe una respuesta HTTP/1.0 cuyo cuerpo termina al cerrar la conexión: */
+			reply("HTTP/1.0 200 OK\r\n\r\nbody until close");
+			return false;
+			}
+		else if(page=="hang")
+			{
+			/* Deje la conexión abierta sin responder nunca: */
+			hungFds.push_back(connFd);
+			connFd=-1;
+			return false;
+			}
+		else
+			reply("HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n");
+		
+		return true;
+		}
+	void* serverThreadMethod(void) // Método para el hilo del servidor
+		{
+		/* Atienda una conexión a la vez; el cliente cierra la anterior antes de abrir una nueva: */
+		while(waitForInput(listenFd))
+			{
+			connFd=accept(listenFd,0,0);
+			if(connFd<0)
+				continue;
+			{
+			Threads::Mutex::Lock statsLock(statsMutex);
+			++numConnections;
+			}
+			bufferPos=bufferEnd=0;
+			while(serveRequest())
+				;
+			if(connFd>=0)
+				{
+				close(connFd);
+				connFd=-1;
+				}
+			}
+		
+		return 0;
+		}
+	
+	/* Constructores y destructores: */
+	public:
+	StandInServer(void)
+		:listenFd(-1),port(0),
+		 numConnections(0),numRequests(0),numFlakyRequests(0),
+		 connFd(-1),bufferPos(0),bufferEnd(0)
+		{
+		/* Abra un socket de escucha en un puerto libre de la interfaz local: */
+		if(pipe(stopPipe)<0)
+			Misc::throwStdErr("StandInServer: Unable to create stop pipe due to %s",strerror(errno));
+		listenFd=socket(AF_INET,SOCK_STREAM,0);
+		struct sockaddr_in address;
+		memset(&address,0,sizeof(address));
+		address.sin_family=AF_INET;
+		address.sin_addr.s_addr=htonl(INADDR_LOOPBACK);
+		address.sin_port=0;
+		socklen_t addressLen=sizeof(address);
+		if(listenFd<0||bind(listenFd,reinterpret_cast<struct sockaddr*>(&address),sizeof(address))<0||listen(listenFd,4)<0||getsockname(listenFd,reinterpret_cast<struct sockaddr*>(&address),&addressLen)<0)
+			Misc::throwStdErr("StandInServer: Unable to open listening socket due to %s",strerror(errno));
+		port=ntohs(address.sin_port);
+		
+		/* Inicie el hilo del servidor: */
+		serverThread.start(this,&StandInServer::serverThreadMethod);
+		}
+	~StandInServer(void)
+		{
+		/* Apague el hilo del servidor y cierre todas las conexiones: */
+		char stop=0;
+		if(write(stopPipe[1],&stop,1)<0)
+			{
+			/* No hay otra forma de detener el hilo: */
+			}
+		serverThread.join();
+		for(std::vector<int>::iterator hIt=hungFds.begin();hIt!=hungFds.end();++hIt)
+			close(*hIt);
+		close(listenFd);
+		close(stopPipe[0]);
+		close(stopPipe[1]);
+		}
+	
+	/* Métodos: */
+	int getPort(void) const
+		{
+		return port;
+		}
+	unsigned int getNumConnections(void)
+		{
+		Threads::Mutex::Lock statsLock(statsMutex);
+		return numConnections;
+		}
+	unsigned int getNumRequests(void)
+		{
+		Threads::Mutex::Lock statsLock(statsMutex);
+		return numRequests;
+		}
+	};
+
+/****************
+Helper functions:
+****************/
+
+bool check(const char* name,bool ok)
+	{
+	std::cout<<name<<' '<<(ok?"ok":"FAILED")<<std::endl;
+	return ok;
+	}
+
+bool checkValue(const char* name,double value,double expected)
+	{
+	bool ok=value==expected;
+	std::cout<<name<<' '<<value<<" (expected "<<expected<<") "<<(ok?"ok":"FAILED")<<std::endl;
+	return ok;
+	}
+
+bool waitForResults(HTTPUpdateClient& client,std::vector<HTTPUpdateClient::Result>& results,size_t numResults,double timeout)
+	{
+	/* Sondee los resultados del cliente hasta que lleguen todos o venza el tiempo: */
+	Realtime::TimePointMonotonic lastTime;
+	double waitTime=0.0;
+	client.getResults(results);
+	while(results.size()<numResults)
+		{
+		waitTime+=double(lastTime.setAndDiff());
+		if(waitTime>timeout)
+			return false;
+		usleep(10000);
+		client.getResults(results);
+		}
+	return true;
+	}
+
+bool postAndCheck(HTTPUpdateClient& client,HTTPUpdateClient::Request request,const char* page,bool expectSuccess,unsigned int expectedAttempts)
+	{
+	/* Envíe el mensaje y espere su resultado: */
+	request.page=page;
+	client.postUpdate(request);
+	std::vector<HTTPUpdateClient::Result> results;
+	if(!waitForResults(client,results,1,10.0))
+		return check(page,false);
+	const HTTPUpdateClient::Result& result=results.front();
+	
+	std::cout<<result.url<<": "<<result.numAttempts<<" attempt(s), "<<(result.error.empty()?"accepted":result.error)<<std::endl;
+	bool ok=check(expectSuccess?"  accepted":"  rejected",result.error.empty()==expectSuccess);
+	ok=checkValue("  attempts",result.numAttempts,expectedAttempts)&&ok;
+	return ok;
+	}
+
+}
+
+int main(int argc,char* argv[])
+	{
+	try
+		{
+		StandInServer server;
+		bool ok=true;
+		Realtime::TimePointMonotonic shutdownStart;
+		
+		/* Cree la plantilla de solicitud con tiempos de espera cortos: */
+		HTTPUpdateClient::Request request;
+		request.hostName="127.0.0.1";
+		request.port=server.getPort();
+		request.message="update=1";
+		request.connectTimeout=1.0;
+		request.readTimeout=0.5;
+		request.maxRetries=3;
+		request.retryDelay=0.05;
+		
+		{
+		HTTPUpdateClient client;
+		
+		/* Las respuestas de tamaño conocido y fragmentadas mantienen la conexión abierta: */
+		ok=postAndCheck(client,request,"ok",true,1)&&ok;
+		ok=postAndCheck(client,request,"ok",true,1)&&ok;
+		ok=postAndCheck(client,request,"chunked",true,1)&&ok;
+		ok=checkValue("Connections after keep-alive replies",server.getNumConnections(),1)&&ok;
+		
+		/* Los errores temporales se reintentan en conexiones nuevas hasta que el servidor acepta: */
+		ok=postAndCheck(client,request,"flaky",true,3)&&ok;
+		
+		/* Los errores del cliente no se reintentan: */
+		ok=postAndCheck(client,request,"missing",false,1)&&ok;
+		
+		/* Una respuesta HTTP/1.0 sin tamaño termina al cerrar la conexión: */
+		ok=postAndCheck(client,request,"close",true,1)&&ok;
+		ok=postAndCheck(client,request,"ok",true,1)&&ok;
+		
+		/* Un servidor que nunca responde vence el tiempo de lectura en cada intento: */
+		HTTPUpdateClient::Request hangRequest=request;
+		hangRequest.maxRetries=1;
+		Realtime::TimePointMonotonic hangStart;
+		ok=postAndCheck(client,hangRequest,"hang",false,2)&&ok;
+		double hangTime=double(hangStart.setAndDiff());
+		std::cout<<"Unresponsive server took "<<hangTime<<" s"<<std::endl;
+		ok=check("Unresponsive server bounded by read timeouts",hangTime>=2.0*hangRequest.readTimeout&&hangTime<2.0*hangRequest.readTimeout+1.0)&&ok;
+		
+		/* Las actualizaciones idénticas que esperan detrás de un envío en curso se combinan: */
+		hangRequest.page="hang";
+		hangRequest.maxRetries=0;
+		client.postUpdate(hangRequest);
+		usleep(100000);
+		request.page="ok";
+		request.message="burst";
+		bool queued[3];
+		for(int i=0;i<3;++i)
+			queued[i]=client.postUpdate(request);
+		ok=check("Identical updates coalesced",queued[0]&&!queued[1]&&!queued[2])&&ok;
+		std::vector<HTTPUpdateClient::Result> results;
+		bool gotBurst=waitForResults(client,results,2,10.0);
+		ok=check("Coalesced update sent",gotBurst&&results[1].error.empty())&&ok;
+		ok=checkValue("  coalesced updates",gotBurst?results[1].numCoalesced:0,2)&&ok;
+		
+		/* El apagado interrumpe un envío en curso sin esperar su tiempo de lectura: */
+		hangRequest.readTimeout=30.0;
+		client.postUpdate(hangRequest);
+		usleep(200000);
+		shutdownStart.setAndDiff();
+		}
+		double shutdownTime=double(shutdownStart.setAndDiff());
+		std::cout<<"Shutdown took "<<shutdownTime<<" s"<<std::endl;
+		ok=check("Shutdown interrupts pending send",shutdownTime<1.0)&&ok;
+		
+		ok=checkValue("Requests received",server.getNumRequests(),14)&&ok;
+		
+		return ok?0:1;
+		}
+	catch(const std::runtime_error& err)
+		{
+		std::cerr<<"Caught exception "<<err.what()<<std::endl;
+		return 1;
+		}
+	}
@@ -0,0 +1,199 @@
+/***********************************************************************
+SARndboxCapture - Demonio de captura que transmite los marcos de
+profundidad sin procesar de una cámara 3D local a un anillo de memoria
+compartida, del que leen cualquier número de procesos SARndbox locales.
+Copyright (c) 2012-2018 Oliver Kreylos
+Copyright (c) 2026 Sergio081096
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include <signal.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string>
+#include <iostream>
+#include <stdexcept>
+#include <Misc/FunctionCalls.h>
+#include <Misc/ConfigurationFile.h>
+#include <Misc/StandardValueCoders.h>
+#include <Kinect/FrameBuffer.h>
+#include <Kinect/DirectFrameSource.h>
+#include <Kinect/OpenDirectFrameSource.h>
+
+#include "SharedFrameRing.h"
+
+#include "Config.h"
+
+namespace {
+
+/**************
+Helper objects:
+**************/
+
+volatile sig_atomic_t runDaemon=1; // Marcar para mantener en ejecución el demonio hasta recibir una señal
+
+/****************
+Helper functions:
+****************/
+
+void signalHandler(int signum)
+	{
+	runDaemon=0;
+	}
+
+void printUsage(void)
+	{
+	std::cout<<"Usage: SARndboxCapture [option 1] ... [option n]"<<std::endl;
+	std::cout<<"  Options:"<<std::endl;
+	std::cout<<"  -h"<<std::endl;
+	std::cout<<"     Prints this help message"<<std::endl;
+	std::cout<<"  -c <camera index>"<<std::endl;
+	std::cout<<"     Selects the local 3D camera of the given index (0: first camera"<<std::endl;
+	std::cout<<"     on USB bus)"<<std::endl;
+	std::cout<<"     Default: 0"<<std::endl;
+	std::cout<<"  -shm <shared memory segment name>"<<std::endl;
+	std::cout<<"     Writes depth frames to the shared memory segment of the given name"<<std::endl;
+	std::cout<<"     Default: SARndbox"<<std::endl;
+	std::cout<<"  -slots <number of frame slots>"<<std::endl;
+	std::cout<<"     Sets the number of depth frames kept in the shared memory segment"<<std::endl;
+	std::cout<<"     Default: 4"<<std::endl;
+	}
+
+/**************
+Helper classes:
+**************/
+
+class FrameForwarder // Clase para copiar los marcos de la cámara en el anillo de memoria compartida
+	{
+	/* Elementos: */
+	private:
+	SharedFrameRing& ring; // El anillo de memoria compartida
+	Misc::UInt64 numFrames; // Número de marcos publicados
+	
+	/* Constructores y destructores: */
+	public:
+	FrameForwarder(SharedFrameRing& sRing)
+		:ring(sRing),numFrames(0)
+		{
+		}
+	
+	/* Métodos: */
+	void depthStreamingCallback(const Kinect::FrameBuffer& frame) // Publica un nuevo marco de profundidad; llamado desde el hilo de transmisión de la cámara
+		{
+		ring.publishFrame(frame.getData<SharedFrameRing::DepthPixel>(),frame.timeStamp);
+		++numFrames;
+		}
+	Misc::UInt64 getNumFrames(void) const // Devuelve el número de marcos publicados
+		{
+		return numFrames;
+		}
+	};
+
+}
+
+int main(int argc,char* argv[])
+	{
+	try
+		{
+		/* Lea los parámetros de configuración predeterminados del sandbox: */
+		std::string sandboxConfigFileName=CONFIG_CONFIGDIR;
+		sandboxConfigFileName.push_back('/');
+		sandboxConfigFileName.append(CONFIG_DEFAULTCONFIGFILENAME);
+		Misc::ConfigurationFile sandboxConfigFile(sandboxConfigFileName.c_str());
+		Misc::ConfigurationFileSection cfg=sandboxConfigFile.getSection("/SARndbox");
+		unsigned int cameraIndex=cfg.retrieveValue<int>("./cameraIndex",0);
+		std::string cameraConfiguration=cfg.retrieveString("./cameraConfiguration","Camera");
+		std::string ringName=cfg.retrieveString("./sharedFrameRingName","SARndbox");
+		unsigned int numSlots=cfg.retrieveValue<unsigned int>("./sharedFrameRingNumSlots",4);
+		
+		/* Procesar los parámetros de la línea de comando: */
+		for(int i=1;i<argc;++i)
+			{
+			if(argv[i][0]=='-')
+				{
+				if(strcasecmp(argv[i]+1,"h")==0)
+					{
+					printUsage();
+					return 0;
+					}
+				else if(strcasecmp(argv[i]+1,"c")==0&&i+1<argc)
+					{
+					++i;
+					cameraIndex=atoi(argv[i]);
+					}
+				else if(strcasecmp(argv[i]+1,"shm")==0&&i+1<argc)
+					{
+					++i;
+					ringName=argv[i];
+					}
+				else if(strcasecmp(argv[i]+1,"slots")==0&&i+1<argc)
+					{
+					++i;
+					numSlots=atoi(argv[i]);
+					}
+				else
+					std::cerr<<"SARndboxCapture: Ignoring unrecognized command line option "<<argv[i]<<std::endl;
+				}
+			}
+		
+		/* Abra el dispositivo de cámara 3D del índice seleccionado: */
+		Kinect::DirectFrameSource* camera=Kinect::openDirectFrameSource(cameraIndex);
+		Misc::ConfigurationFileSection cameraConfigurationSection=cfg.getSection(cameraConfiguration.c_str());
+		camera->configure(cameraConfigurationSection);
+		unsigned int frameSize[2];
+		for(int i=0;i<2;++i)
+			frameSize[i]=camera->getActualFrameSize(Kinect::FrameSource::DEPTH)[i];
+		
+		/* Abra el anillo de memoria compartida, reutilizando el de un demonio anterior si es posible: */
+		SharedFrameRing ring(ringName.c_str(),frameSize,numSlots);
+		
+		/* Publique los parámetros de la cámara, con la corrección de profundidad evaluada en la cuadrícula de píxeles: */
+		SharedFrameRing::PixelCorrection* pixelCorrection=0;
+		Kinect::FrameSource::DepthCorrection* depthCorrection=camera->getDepthCorrectionParameters();
+		if(depthCorrection!=0)
+			{
+			pixelCorrection=depthCorrection->getPixelCorrection(frameSize);
+			delete depthCorrection;
+			}
+		ring.publishParameters(camera->getIntrinsicParameters(),camera->getExtrinsicParameters(),camera->getDepthRange(),pixelCorrection);
+		delete[] pixelCorrection;
+		
+		/* Transmita marcos de profundidad hasta recibir una señal de terminación: */
+		struct sigaction sigAction;
+		memset(&sigAction,0,sizeof(sigAction));
+		sigAction.sa_handler=signalHandler;
+		sigaction(SIGINT,&sigAction,0);
+		sigaction(SIGTERM,&sigAction,0);
+		FrameForwarder forwarder(ring);
+		camera->startStreaming(0,Misc::createFunctionCall(&forwarder,&FrameForwarder::depthStreamingCallback));
+		std::cout<<"SARndboxCapture: Streaming "<<frameSize[0]<<'x'<<frameSize[1]<<" depth frames to shared memory segment "<<ring.getName()<<std::endl;
+		while(runDaemon)
+			sleep(1);
+		camera->stopStreaming();
+		delete camera;
+		std::cout<<"SARndboxCapture: Published "<<forwarder.getNumFrames()<<" depth frames"<<std::endl;
+		}
+	catch(const std::runtime_error& err)
+		{
+		std::cerr<<"SARndboxCapture: Terminating due to exception "<<err.what()<<std::endl;
+		return 1;
+		}
+	
+	return 0;
+	}
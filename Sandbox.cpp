@@ -23,6 +23,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 
 #include <ctype.h>
 #include <string.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -39,8 +40,10 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 #include <Misc/FileNameExtensions.h>
 #include <Misc/StandardValueCoders.h>
 #include <Misc/ArrayValueCoders.h>
+#include <Misc/CompoundValueCoders.h>
 #include <Misc/ConfigurationFile.h>
 #include <IO/File.h>
+#include <IO/OStream.h>
 #include <IO/ValueSource.h>
 #include <Cluster/OpenPipe.h>
 #include <Math/Math.h>
@@ -98,14 +101,24 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 #include <Images/WriteImageFile.h>
 #endif
 
+#include "SharedMemoryFrameSource.h"
+#include "DepthRecordingFrameSource.h"
+#include "DepthRecorder.h"
 #include "FrameFilter.h"
 #include "DepthImageRenderer.h"
 #include "ElevationColorMap.h"
 #include "DEM.h"
 #include "SurfaceRenderer.h"
 #include "WaterTable2.h"
+#include "DepressionFiller.h"
 #include "HandExtractor.h"
+#include "FlowAccumulator.h"
+#include "ContourGenerator.h"
+#include "DEMDeviation.h"
+#include "TimeLapseRecorder.h"
+#include "TimeLapseReader.h"
 #include "WaterRenderer.h"
+#include "ShaderHelper.h"
 #include "GlobalWaterTool.h"
 #include "LocalWaterTool.h"
 #include "DEMTool.h"
@@ -123,7 +136,10 @@ Methods of class Sandbox::DataItem:
 
 Sandbox::DataItem::DataItem(void)
 	:waterTableTime(0.0),
-	 shadowFramebufferObject(0),shadowDepthTextureObject(0)
+	 equilibriumWaterLevelVersion(0),
+	 shadowFramebufferObject(0),shadowDepthTextureObject(0),
+	 shadowMapValid(false),shadowDepthImageVersion(0),
+	 timeLapseWaterLevelVersion(0)
 	{
 	/* Compruebe si todas las extensiones requeridas son compatibles: */
 	//std::cout<<"DataItem"<<std::endl;	
@@ -149,6 +165,10 @@ Sandbox::DataItem::DataItem(void)
 	GLARBVertexShader::initExtension();
 	GLARBFragmentShader::initExtension();
 	GLARBMultitexture::initExtension();
+	
+	/* Inicialice la posición de la fuente de luz del mapa de sombras: */
+	for(int i=0;i<4;++i)
+		shadowLightPosition[i]=0.0f;
 	}
 
 Sandbox::DataItem::~DataItem(void)
@@ -200,7 +220,7 @@ Sandbox::RenderSettings::RenderSettings(const Sandbox::RenderSettings& source) /
 	 surfaceRenderer(0),
 	 waterRenderer(0)
 	{
-
+		
 		//std::cout<<"3: Cargando Render del Apuntador"<<std::endl;	
 	}//*/
 
@@ -273,7 +293,9 @@ void Sandbox::rawDepthFrameDispatcher(const Kinect::FrameBuffer& frameBuffer)
 	{
 	/* Pase el cuadro recibido al filtro de cuadro y al extractor manual: */
 	//std::cout<<"123: rawDepthFrameDispatcher" <<std::endl;
-	if(frameFilter!=0 && !pauseUpdates)
+	if(depthRecorder!=0)
+		depthRecorder->addDepthFrame(frameBuffer);
+	if(frameFilter!=0 && !pauseUpdates && timeLapseReader==0)
 		frameFilter->receiveRawFrame(frameBuffer);
 	if(handExtractor!=0)
 		handExtractor->receiveRawFrame(frameBuffer);
@@ -285,6 +307,19 @@ void Sandbox::receiveFilteredFrame(const Kinect::FrameBuffer& frameBuffer)
 	//std::cout<<"receiveFilteredFrame"<<std::endl;
 	filteredFrames.postNewValue(frameBuffer);
 	
+	/* Pase el marco al acumulador de flujo si la red de ríos está habilitada; el hilo principal lo crea mientras este hilo recibe marcos: */
+	FlowAccumulator* fa=__atomic_load_n(&flowAccumulator,__ATOMIC_ACQUIRE);
+	if(fa!=0&&drawRiverNetwork)
+		fa->receiveFilteredFrame(frameBuffer);
+	
+	/* Pase el marco al generador de contornos si las líneas de contorno vectoriales están habilitadas: */
+	if(contourGenerator!=0&&useVectorContourLines)
+		contourGenerator->receiveFilteredFrame(frameBuffer);
+	
+	/* Pase el marco al calculador de desviaciones, que lo ignora mientras no haya un DEM activo: */
+	if(demDeviation!=0)
+		demDeviation->receiveFilteredFrame(frameBuffer);
+	
 	/* Despierta el hilo de primer plano: */
 	Vrui::requestUpdate();
 	}
@@ -311,6 +346,202 @@ void Sandbox::toggleDEM(DEM* dem)
 			rsIt->surfaceRenderer->setDem(activeDem);
 	}
 
+void Sandbox::setDrawRiverNetwork(bool newDrawRiverNetwork)
+	{
+	/* Cree el acumulador de flujo la primera vez que se habilita la red de ríos, para no reservar sus búferes ni sus hilos si nunca se usa: */
+	if(newDrawRiverNetwork&&flowAccumulator==0)
+		{
+		FlowAccumulator* newFlowAccumulator=new FlowAccumulator(frameSize,cameraIps.depthProjection,depthImageRenderer->getBasePlane(),riverNumThreads);
+		newFlowAccumulator->setChangeThreshold(float(0.1*unitScale));
+		newFlowAccumulator->setAccumulationRange(riverMinAccumulation,riverMaxAccumulation);
+		
+		/* Publique el acumulador completo para el hilo del filtro de marcos: */
+		__atomic_store_n(&flowAccumulator,newFlowAccumulator,__ATOMIC_RELEASE);
+		}
+	drawRiverNetwork=newDrawRiverNetwork;
+	
+	/* Habilite o deshabilite la red de ríos en todos los renderizadores de superficie ya creados: */
+	for(std::vector<RenderSettings>::iterator rsIt=renderSettings.begin();rsIt!=renderSettings.end();++rsIt)
+		if(rsIt->surfaceRenderer!=0)
+			rsIt->surfaceRenderer->setFlowAccumulator(drawRiverNetwork?flowAccumulator:0);
+	}
+
+void Sandbox::printWaterStatistics(std::ostream& os) const
+	{
+	/* Convierta la muestra más reciente de unidades de coordenadas mundiales a unidades de la caja de arena: */
+	const WaterTable2::Statistics& stats=waterTable->getStatistics();
+	double litresPerUnit=1.0/(unitScale*unitScale*unitScale*1000.0);
+	os<<"Water volume "<<stats.volume*litresPerUnit<<" l";
+	os<<", wet area "<<stats.wetArea/(unitScale*unitScale)<<" cm^2";
+	os<<", max depth "<<stats.maxDepth/unitScale<<" cm";
+	os<<", sources "<<stats.sourceVolume*litresPerUnit<<" l";
+	os<<", drift "<<stats.drift*litresPerUnit<<" l";
+	os<<" after "<<stats.numSteps<<" steps ("<<stats.simulationTime<<" s)"<<std::endl;
+	}
+
+void Sandbox::printDemStatistics(std::ostream& os) const
+	{
+	/* Escriba las estadísticas globales; la caja de arena ya mide en cm: */
+	const DEMDeviation::Statistics& stats=demDeviation->getStatistics();
+	os<<"DEM RMS error "<<stats.rmsError<<" cm";
+	os<<", mean error "<<stats.meanError<<" cm";
+	os<<", cut "<<stats.cutVolume/1000.0<<" l";
+	os<<", fill "<<stats.fillVolume/1000.0<<" l";
+	os<<", score "<<stats.score<<"%";
+	os<<" from "<<stats.numSamples<<" samples ("<<stats.computeTime*1000.0<<" ms)"<<std::endl;
+	
+	/* Escriba las puntuaciones por región empezando por la fila superior, como se ven desde arriba: */
+	os<<"DEM region scores:"<<std::endl;
+	for(unsigned int y=stats.numRegions[1];y>0;--y)
+		{
+		for(unsigned int x=0;x<stats.numRegions[0];++x)
+			{
+			const DEMDeviation::RegionStatistics& rs=stats.regions[(y-1)*stats.numRegions[0]+x];
+			if(x>0)
+				os<<' ';
+			if(rs.numSamples>0)
+				os<<rs.score<<'%';
+			else
+				os<<'-';
+			}
+		os<<std::endl;
+		}
+	}
+
+bool Sandbox::setWaterAppearance(const char* appearanceName)
+	{
+	/* Busque la apariencia en todos los renderizadores de superficie antes de cambiar alguno: */
+	for(std::vector<RenderSettings>::iterator rsIt=renderSettings.begin();rsIt!=renderSettings.end();++rsIt)
+		if(rsIt->surfaceRenderer->findWaterAppearance(appearanceName)<0)
+			return false;
+	
+	/* Cambie a la apariencia; sus sombreadores se precompilan repartidos entre los cuadros, por lo que el cambio suele ser inmediato: */
+	for(std::vector<RenderSettings>::iterator rsIt=renderSettings.begin();rsIt!=renderSettings.end();++rsIt)
+		rsIt->surfaceRenderer->setWaterAppearance(rsIt->surfaceRenderer->findWaterAppearance(appearanceName));
+	
+	return true;
+	}
+
+void Sandbox::advanceWeather(void)
+	{
+	if(weatherCycle.empty())
+		return;
+	
+	/* Pase al siguiente estado del ciclo: */
+	weatherState=(weatherState+1)%weatherCycle.size();
+	if(setWaterAppearance(weatherCycle[weatherState].c_str()))
+		std::cout<<"Changed weather to "<<weatherCycle[weatherState]<<std::endl;
+	else
+		std::cerr<<"Unknown water appearance "<<weatherCycle[weatherState]<<" in weather cycle"<<std::endl;
+	}
+
+void Sandbox::startTimeLapse(const char* fileName)
+	{
+	/* Termine la grabación anterior: */
+	stopTimeLapse();
+	
+	/* Grabe la cuadrícula de agua si la simulación está habilitada: */
+	unsigned int waterSize[2]={0,0};
+	if(timeLapseWater&&waterTable!=0)
+		for(int i=0;i<2;++i)
+			waterSize[i]=(unsigned int)(waterTable->getSize()[i]);
+	if(waterSize[0]!=0&&timeLapseWaterLevel==0)
+		timeLapseWaterLevel=new GLfloat[waterSize[1]*waterSize[0]];
+	
+	/* Cree el grabador y grabe el primer cuadro de inmediato: */
+	timeLapseRecorder=new TimeLapseRecorder(fileName,frameSize,waterSize,timeLapseKeyframeInterval);
+	nextTimeLapseTime=Vrui::getApplicationTime();
+	}
+
+void Sandbox::stopTimeLapse(void)
+	{
+	/* Destruir el grabador escribe los cuadros en espera y el índice; una lectura de agua pendiente aún llega al búfer: */
+	delete timeLapseRecorder;
+	timeLapseRecorder=0;
+	timeLapseWaterPending=false;
+	}
+
+void Sandbox::updateTimeLapse(void)
+	{
+	double now=Vrui::getApplicationTime();
+	
+	if(timeLapseReader!=0)
+		{
+		/* Busque el cuadro grabado del tiempo de reproducción actual: */
+		unsigned int frameIndex=timeLapseReader->findFrame(now-timeLapseReplayStart);
+		if(frameIndex!=timeLapseReplayFrame)
+			{
+			try
+				{
+				/* Entregue la elevación grabada como un marco filtrado, en un búfer nuevo porque los consumidores lo retienen: */
+				timeLapseReader->readFrame(frameIndex);
+				size_t frameBytes=size_t(frameSize[1])*size_t(frameSize[0])*sizeof(float);
+				Kinect::FrameBuffer frame(frameSize[0],frameSize[1],frameBytes);
+				memcpy(frame.getData<float>(),timeLapseReader->getElevation(),frameBytes);
+				receiveFilteredFrame(frame);
+				
+				/* Cargue la cuadrícula de agua grabada si coincide con la capa freática: */
+				const unsigned int* ws=timeLapseReader->getWaterSize();
+				if(waterTable!=0&&timeLapseReader->getWaterLevel()!=0&&GLsizei(ws[0])==waterTable->getSize()[0]&&GLsizei(ws[1])==waterTable->getSize()[1])
+					++timeLapseWaterLevelVersion;
+				
+				timeLapseReplayFrame=frameIndex;
+				}
+			catch(const std::runtime_error& err)
+				{
+				std::cerr<<"Stopping time-lapse replay due to exception "<<err.what()<<std::endl;
+				delete timeLapseReader;
+				timeLapseReader=0;
+				}
+			}
+		
+		/* Despierte a tiempo para el siguiente cuadro grabado: */
+		if(timeLapseReader!=0&&timeLapseReplayFrame+1<timeLapseReader->getNumFrames())
+			Vrui::scheduleUpdate(timeLapseReplayStart+timeLapseReader->getFrameTime(timeLapseReplayFrame+1));
+		}
+	
+	if(timeLapseRecorder!=0)
+		{
+		/* Detenga la grabación si el hilo de escritura falló: */
+		std::string error=timeLapseRecorder->getError();
+		if(!error.empty())
+			{
+			std::cerr<<"Stopping time-lapse recording due to exception "<<error<<std::endl;
+			stopTimeLapse();
+			return;
+			}
+		
+		const Kinect::FrameBuffer& frame=filteredFrames.getLockedValue();
+		bool recordFrame=false;
+		if(!timeLapseWaterPending&&now>=nextTimeLapseTime&&frame.getData<float>()!=0)
+			{
+			/* Solicite la cuadrícula de agua; otro lector puede estar usando la lectura, en cuyo caso se reintenta en el siguiente cuadro: */
+			if(timeLapseRecorder->hasWater())
+				timeLapseWaterPending=waterTable->requestWaterLevel(timeLapseWaterLevel);
+			else
+				recordFrame=true;
+			}
+		if(timeLapseWaterPending&&waterTable->haveWaterLevel())
+			{
+			recordFrame=true;
+			timeLapseWaterPending=false;
+			}
+		
+		if(recordFrame)
+			{
+			/* Entregue el cuadro al hilo de escritura, que copia las cuadrículas: */
+			if(!timeLapseRecorder->addFrame(now,frame.getData<float>(),timeLapseRecorder->hasWater()?timeLapseWaterLevel:0))
+				std::cerr<<"Dropping time-lapse frame; "<<timeLapseRecorder->getNumDroppedFrames()<<" frames dropped so far"<<std::endl;
+			
+			/* Mantenga la cadencia de grabación sin acumular cuadros atrasados: */
+			nextTimeLapseTime+=timeLapseInterval;
+			if(nextTimeLapseTime<=now)
+				nextTimeLapseTime=now+timeLapseInterval;
+			}
+		Vrui::scheduleUpdate(nextTimeLapseTime);
+		}
+	}
+
 void Sandbox::addWater(GLContextData& contextData) //const
 	{
 	/* Compruebe si la lista de objetos de lluvia más reciente no está vacía: */
@@ -320,7 +551,7 @@ void Sandbox::addWater(GLContextData& contextData) //const
 		/* Renderiza todos los objetos de lluvia al nivel de la mesa: */
 		glPushAttrib(GL_ENABLE_BIT);
 		glDisable(GL_CULL_FACE);
-
+		
 		for(std::vector<RenderSettings>::iterator rsIt=renderSettings.begin();rsIt!=renderSettings.end();++rsIt)
 			rsIt->surfaceRenderer->setLava(false);
 		/* Cree un marco de coordenadas locales para renderizar discos de lluvia: */
@@ -384,6 +615,17 @@ void Sandbox::showWaterControlDialogCallback(Misc::CallbackData* cbData)
 		Vrui::popupPrimaryWidget(waterControlDialog);
 	}
 
+void Sandbox::showDemMatchingDialogCallback(Misc::CallbackData* cbData)
+	{
+	Vrui::popupPrimaryWidget(demMatchingDialog);
+	}
+
+void Sandbox::fillToEquilibriumCallback(Misc::CallbackData* cbData)
+	{
+	/* Solicite un relleno de equilibrio en el próximo fotograma: */
+	equilibriumFillRequested=true;
+	}
+
 void Sandbox::waterSpeedSliderCallback(GLMotif::TextFieldSlider::ValueChangedCallbackData* cbData)
 	{
 		waterSpeed = cbData->value;
@@ -414,13 +656,13 @@ GLMotif::PopupMenu* Sandbox::createMainMenu(void)
 	pauseUpdatesLine=new GLMotif::ToggleButton("PauseUpdatesLine",mainMenu,"Pause Curves");
 	pauseUpdatesLine->setToggle(false);
 	pauseUpdatesLine->getValueChangedCallbacks().add(this,&Sandbox::pauseLineCallback);
-
+	
 	pauseUpdatesToggle=new GLMotif::ToggleButton("PauseUpdatesToggle",mainMenu,"Pause Topography");	
 	pauseUpdatesToggle->setToggle(false);
 	pauseUpdatesToggle->getValueChangedCallbacks().add(this,&Sandbox::pauseUpdatesCallback);
-
 	
-
+	
+	
 	//pauseUpdatesToggle->getValueChangedCallbacks().add(this,&Sandbox::pauseUpdatesCallback);
 	
 	if(waterTable!=0)
@@ -428,8 +670,16 @@ GLMotif::PopupMenu* Sandbox::createMainMenu(void)
 		/* Crea un botón para mostrar el diálogo de control de agua: */
 		GLMotif::Button* showWaterControlDialogButton=new GLMotif::Button("ShowWaterControlDialogButton",mainMenu,"Show Water Simulation Control");
 		showWaterControlDialogButton->getSelectCallbacks().add(this,&Sandbox::showWaterControlDialogCallback);
+		
+		/* Crea un botón para llenar todas las depresiones con agua en equilibrio: */
+		GLMotif::Button* fillToEquilibriumButton=new GLMotif::Button("FillToEquilibriumButton",mainMenu,"Fill to Equilibrium");
+		fillToEquilibriumButton->getSelectCallbacks().add(this,&Sandbox::fillToEquilibriumCallback);
 		}
 	
+	/* Crea un botón para mostrar el diálogo de coincidencia de DEM: */
+	GLMotif::Button* showDemMatchingDialogButton=new GLMotif::Button("ShowDemMatchingDialogButton",mainMenu,"Show DEM Matching");
+	showDemMatchingDialogButton->getSelectCallbacks().add(this,&Sandbox::showDemMatchingDialogCallback);
+	
 	/* Finish building the main menu: */
 	mainMenu->manageChild();
 	
@@ -489,6 +739,19 @@ GLMotif::PopupWindow* Sandbox::createWaterControlDialog(void)
 	
 	frameRateMargin->manageChild();
 	
+	new GLMotif::Label("WaterVolumeLabel",waterControlDialog,"Water Volume (l)");
+	
+	GLMotif::Margin* waterVolumeMargin=new GLMotif::Margin("WaterVolumeMargin",waterControlDialog,false);
+	waterVolumeMargin->setAlignment(GLMotif::Alignment::LEFT);
+	
+	waterVolumeTextField=new GLMotif::TextField("WaterVolumeTextField",waterVolumeMargin,8);
+	waterVolumeTextField->setFieldWidth(7);
+	waterVolumeTextField->setPrecision(3);
+	waterVolumeTextField->setFloatFormat(GLMotif::TextField::FIXED);
+	waterVolumeTextField->setValue(0.0);
+	
+	waterVolumeMargin->manageChild();
+	
 	new GLMotif::Label("WaterAttenuationLabel",waterControlDialog,"Attenuation");
 	
 	waterAttenuationSlider=new GLMotif::TextFieldSlider("WaterAttenuationSlider",waterControlDialog,8,ss.fontHeight*10.0f);
@@ -506,6 +769,67 @@ GLMotif::PopupWindow* Sandbox::createWaterControlDialog(void)
 	return waterControlDialogPopup;
 	}
 
+GLMotif::PopupWindow* Sandbox::createDemMatchingDialog(const unsigned int numRegions[2])
+	{
+	/* Create a popup window shell: */
+	GLMotif::PopupWindow* demMatchingDialogPopup=new GLMotif::PopupWindow("DemMatchingDialogPopup",Vrui::getWidgetManager(),"DEM Matching");
+	demMatchingDialogPopup->setCloseButton(true);
+	demMatchingDialogPopup->setResizableFlags(true,false);
+	demMatchingDialogPopup->popDownOnClose();
+	
+	GLMotif::RowColumn* demMatchingDialog=new GLMotif::RowColumn("DemMatchingDialog",demMatchingDialogPopup,false);
+	demMatchingDialog->setOrientation(GLMotif::RowColumn::VERTICAL);
+	demMatchingDialog->setPacking(GLMotif::RowColumn::PACK_TIGHT);
+	demMatchingDialog->setNumMinorWidgets(2);
+	
+	/* Cree un campo de texto de solo lectura para cada estadística global: */
+	const char* labels[4]={"RMS Error (cm)","Cut Volume (l)","Fill Volume (l)","Score (%)"};
+	const char* names[4]={"DemRmsError","DemCutVolume","DemFillVolume","DemScore"};
+	GLMotif::TextField** textFields[4]={&demRmsErrorTextField,&demCutVolumeTextField,&demFillVolumeTextField,&demScoreTextField};
+	for(int i=0;i<4;++i)
+		{
+		std::string name=names[i];
+		new GLMotif::Label((name+"Label").c_str(),demMatchingDialog,labels[i]);
+		
+		GLMotif::Margin* margin=new GLMotif::Margin((name+"Margin").c_str(),demMatchingDialog,false);
+		margin->setAlignment(GLMotif::Alignment::LEFT);
+		
+		GLMotif::TextField* textField=new GLMotif::TextField((name+"TextField").c_str(),margin,8);
+		textField->setFieldWidth(7);
+		textField->setPrecision(i==3?1:2);
+		textField->setFloatFormat(GLMotif::TextField::FIXED);
+		textField->setValue(0.0);
+		*textFields[i]=textField;
+		
+		margin->manageChild();
+		}
+	
+	/* Cree una cuadrícula de campos de texto con las puntuaciones por región, con la fila superior primero: */
+	new GLMotif::Label("DemRegionScoresLabel",demMatchingDialog,"Region Scores (%)");
+	
+	GLMotif::RowColumn* regionScores=new GLMotif::RowColumn("DemRegionScores",demMatchingDialog,false);
+	regionScores->setOrientation(GLMotif::RowColumn::HORIZONTAL);
+	regionScores->setPacking(GLMotif::RowColumn::PACK_GRID);
+	regionScores->setNumMinorWidgets(numRegions[0]);
+	demRegionScoreTextFields.clear();
+	for(unsigned int i=0;i<numRegions[1]*numRegions[0];++i)
+		{
+		char name[40];
+		snprintf(name,sizeof(name),"DemRegionScore%u",i);
+		GLMotif::TextField* textField=new GLMotif::TextField(name,regionScores,5);
+		textField->setFieldWidth(5);
+		textField->setPrecision(0);
+		textField->setFloatFormat(GLMotif::TextField::FIXED);
+		textField->setString("-");
+		demRegionScoreTextFields.push_back(textField);
+		}
+	regionScores->manageChild();
+	
+	demMatchingDialog->manageChild();
+	
+	return demMatchingDialogPopup;
+	}
+
 namespace {
 
 /****************
@@ -525,6 +849,26 @@ void printUsage(void)
 	std::cout<<"  -f <frame file name prefix>"<<std::endl;
 	std::cout<<"     Reads a pre-recorded 3D video stream from a pair of color/depth"<<std::endl;
 	std::cout<<"     files of the given file name prefix"<<std::endl;
+	std::cout<<"  -shm <shared memory segment name>"<<std::endl;
+	std::cout<<"     Reads depth frames from the shared memory segment written by a"<<std::endl;
+	std::cout<<"     local SARndboxCapture daemon instead of opening the camera"<<std::endl;
+	std::cout<<"  -dr <depth recording file name>"<<std::endl;
+	std::cout<<"     Records the raw depth frames of the camera into a compact depth"<<std::endl;
+	std::cout<<"     recording file of the given name"<<std::endl;
+	std::cout<<"  -drc"<<std::endl;
+	std::cout<<"     Also records the color frames of the camera into the depth recording"<<std::endl;
+	std::cout<<"  -drp <depth recording file name>"<<std::endl;
+	std::cout<<"     Replays the compact depth recording file of the given name instead"<<std::endl;
+	std::cout<<"     of opening the camera"<<std::endl;
+	std::cout<<"  -drs <replay speed>"<<std::endl;
+	std::cout<<"     Sets the depth recording replay speed as a multiple of real time;"<<std::endl;
+	std::cout<<"     0 replays as fast as possible"<<std::endl;
+	std::cout<<"     Default: 1.0"<<std::endl;
+	std::cout<<"  -drt <start time>"<<std::endl;
+	std::cout<<"     Starts the depth recording replay at the given time in seconds"<<std::endl;
+	std::cout<<"     Default: 0.0"<<std::endl;
+	std::cout<<"  -drl"<<std::endl;
+	std::cout<<"     Loops the depth recording replay"<<std::endl;
 	std::cout<<"  -s <scale factor>"<<std::endl;
 	std::cout<<"     Scale factor from real sandbox to simulated terrain"<<std::endl;
 	std::cout<<"     Default: 100.0 (1:100 scale, 1cm in sandbox is 1m in terrain"<<std::endl;
@@ -568,6 +912,51 @@ void printUsage(void)
 	std::cout<<"  -dds <DEM distance scale>"<<std::endl;
 	std::cout<<"     DEM matching distance scale factor in cm"<<std::endl;
 	std::cout<<"     Default: 1.0"<<std::endl;
+	std::cout<<"  -rn [river minimum accumulation]"<<std::endl;
+	std::cout<<"     Draws the river network computed from D8 flow accumulation over"<<std::endl;
+	std::cout<<"     the sand surface, starting at the given number of upstream cells"<<std::endl;
+	std::cout<<"     Default: 200"<<std::endl;
+	std::cout<<"  -vcl"<<std::endl;
+	std::cout<<"     Extracts topographic contour lines as vector polylines on the CPU"<<std::endl;
+	std::cout<<"     and draws them as line geometry instead of in the surface shader"<<std::endl;
+	std::cout<<"  -acl"<<std::endl;
+	std::cout<<"     Computes anti-aliased contour lines from elevation derivatives in the"<<std::endl;
+	std::cout<<"     surface shader, without the extra pixel-corner elevation pass"<<std::endl;
+	std::cout<<"  -rsc"<<std::endl;
+	std::cout<<"     Reports the compile time of every surface shader variant"<<std::endl;
+	std::cout<<"  -lod [surface LOD error]"<<std::endl;
+	std::cout<<"     Draws the sand surface as a decimated mesh whose elevation stays"<<std::endl;
+	std::cout<<"     within the given error in cm of the full-resolution surface"<<std::endl;
+	std::cout<<"     Default: 0.05"<<std::endl;
+	std::cout<<"  -wsi <water statistics interval>"<<std::endl;
+	std::cout<<"     Sets the number of water simulation steps between global water"<<std::endl;
+	std::cout<<"     volume and mass balance measurements; 0 disables them"<<std::endl;
+	std::cout<<"     Default: 30"<<std::endl;
+	std::cout<<"  -wsl <water statistics log file name>"<<std::endl;
+	std::cout<<"     Appends every water volume and mass balance measurement to the"<<std::endl;
+	std::cout<<"     file of the given name"<<std::endl;
+	std::cout<<"  -tl <time-lapse file name>"<<std::endl;
+	std::cout<<"     Records the filtered elevation grid and the water grid to the"<<std::endl;
+	std::cout<<"     time-lapse file of the given name"<<std::endl;
+	std::cout<<"  -tli <time-lapse interval>"<<std::endl;
+	std::cout<<"     Sets the time between recorded time-lapse frames in seconds"<<std::endl;
+	std::cout<<"     Default: 1.0"<<std::endl;
+	std::cout<<"  -tlp <time-lapse file name>"<<std::endl;
+	std::cout<<"     Replays the elevation grid recorded in the time-lapse file of the"<<std::endl;
+	std::cout<<"     given name instead of the live camera"<<std::endl;
+	std::cout<<"  -wsm <water solver mode>"<<std::endl;
+	std::cout<<"     Selects the water flow integration scheme: RungeKutta for the"<<std::endl;
+	std::cout<<"     explicit second-order scheme, or SemiImplicit for the large"<<std::endl;
+	std::cout<<"     time step scheme with implicit free surface and friction"<<std::endl;
+	std::cout<<"     Default: RungeKutta"<<std::endl;
+	std::cout<<"  -wa <water appearance>"<<std::endl;
+	std::cout<<"     Selects the initial water appearance by the name of its"<<std::endl;
+	std::cout<<"     SurfaceAddWaterColor-<name>.fs shader"<<std::endl;
+	std::cout<<"     Default: Default (SurfaceAddWaterColor.fs)"<<std::endl;
+	std::cout<<"  -wp <weather period>"<<std::endl;
+	std::cout<<"     Advances the weather cycle of water appearances automatically"<<std::endl;
+	std::cout<<"     every given number of seconds; 0 advances only on command"<<std::endl;
+	std::cout<<"     Default: 0.0"<<std::endl;
 	std::cout<<"  -wi <window index>"<<std::endl;
 	std::cout<<"     Sets the zero-based index of the display window to which the"<<std::endl;
 	std::cout<<"     following rendering settings are applied"<<std::endl;
@@ -613,16 +1002,49 @@ void printUsage(void)
 Sandbox::Sandbox(int& argc,char**& argv):Vrui::Application(argc,argv),
 	 camera(0),
 	 pixelDepthCorrection(0),
+	 depthRecorder(0),
 	 frameFilter(0),
 	 pauseUpdates(false),
 	 pauseLine(true),
 	 depthImageRenderer(0),
 	 waterTable(0),
+	 depressionFiller(0),
+	 equilibriumBathymetry(0),
+	 equilibriumFillRequested(false),
+	 equilibriumBathymetryPending(false),
+	 equilibriumWaterLevelVersion(0),
 	 handExtractor(0),
+	 flowAccumulator(0),
+	 drawRiverNetwork(false),
+	 riverMinAccumulation(200U),riverMaxAccumulation(20000U),
+	 riverNumThreads(4U),
+	 contourGenerator(0),
+	 useVectorContourLines(false),
+	 useAnalyticContourLines(false),
+	 reportShaderCompiles(false),
+	 unitScale(1.0),
+	 waterStatisticsVersion(0),
+	 waterStatisticsLog(0),
+	 timeLapseRecorder(0),
+	 timeLapseInterval(1.0),
+	 timeLapseKeyframeInterval(60),
+	 timeLapseWater(true),
+	 nextTimeLapseTime(0.0),
+	 timeLapseWaterLevel(0),
+	 timeLapseWaterPending(false),
+	 timeLapseReader(0),
+	 timeLapseReplayStart(0.0),
+	 timeLapseReplayFrame(~0U),
+	 timeLapseWaterLevelVersion(0),
+	 weatherState(0),
+	 weatherPeriod(0.0),
+	 nextWeatherTime(0.0),
 	 addWaterFunction(0),
 	 addWaterFunctionRegistered(false),
 	 sun(0),
 	 activeDem(0),
+	 demDeviation(0),
+	 demStatisticsVersion(0),
 	 mainMenu(0),
 	 pauseUpdatesToggle(0),
 	 pauseUpdatesLine(0),
@@ -630,7 +1052,13 @@ Sandbox::Sandbox(int& argc,char**& argv):Vrui::Application(argc,argv),
 	 waterSpeedSlider(0),
 	 waterMaxStepsSlider(0),
 	 frameRateTextField(0),
+	 waterVolumeTextField(0),
 	 waterAttenuationSlider(0),
+	 demMatchingDialog(0),
+	 demRmsErrorTextField(0),
+	 demCutVolumeTextField(0),
+	 demFillVolumeTextField(0),
+	 demScoreTextField(0),
 	 controlPipeFd(-1)
 	{
 	/* Lea los parámetros de configuración predeterminados del sandbox: */
@@ -671,12 +1099,71 @@ Sandbox::Sandbox(int& argc,char**& argv):Vrui::Application(argc,argv),
 	rainStrength=cfg.retrieveValue<GLfloat>("./rainStrength",0.25f);
 	double evaporationRate=cfg.retrieveValue<double>("./evaporationRate",0.0);
 	float demDistScale=cfg.retrieveValue<float>("./demDistScale",1.0f);
+	unsigned int demDeviationNumThreads=cfg.retrieveValue<unsigned int>("./demDeviationNumThreads",2U);
+	unsigned int demDeviationSampleStep=cfg.retrieveValue<unsigned int>("./demDeviationSampleStep",3U);
+	double demScoreTolerance=cfg.retrieveValue<double>("./demScoreTolerance",1.0);
+	Misc::FixedArray<unsigned int,2> demScoreRegions;
+	demScoreRegions[0]=3;
+	demScoreRegions[1]=2;
+	demScoreRegions=cfg.retrieveValue<Misc::FixedArray<unsigned int,2> >("./demScoreRegions",demScoreRegions);
+	for(int i=0;i<2;++i)
+		if(demScoreRegions[i]==0)
+			demScoreRegions[i]=1;
+	drawRiverNetwork=cfg.retrieveValue<bool>("./riverNetwork",false);
+	riverMinAccumulation=cfg.retrieveValue<unsigned int>("./riverMinAccumulation",riverMinAccumulation);
+	riverMaxAccumulation=cfg.retrieveValue<unsigned int>("./riverMaxAccumulation",riverMaxAccumulation);
+	riverNumThreads=cfg.retrieveValue<unsigned int>("./riverNumThreads",riverNumThreads);
+	useVectorContourLines=cfg.retrieveValue<bool>("./vectorContourLines",false);
+	useAnalyticContourLines=cfg.retrieveValue<bool>("./analyticContourLines",false);
+	reportShaderCompiles=cfg.retrieveValue<bool>("./reportShaderCompiles",false);
+	unsigned int contourNumThreads=cfg.retrieveValue<unsigned int>("./contourNumThreads",4U);
+	bool useSurfaceLod=cfg.retrieveValue<bool>("./surfaceLod",false);
+	float surfaceLodError=cfg.retrieveValue<float>("./surfaceLodError",0.05f);
+	float surfaceLodCoarseError=cfg.retrieveValue<float>("./surfaceLodCoarseError",0.2f);
+	unsigned int waterStatisticsInterval=cfg.retrieveValue<unsigned int>("./waterStatisticsInterval",30U);
+	std::string waterStatisticsLogName=cfg.retrieveString("./waterStatisticsLog","");
+	std::string timeLapseFileName=cfg.retrieveString("./timeLapseFile","");
+	timeLapseInterval=cfg.retrieveValue<double>("./timeLapseInterval",timeLapseInterval);
+	timeLapseKeyframeInterval=cfg.retrieveValue<unsigned int>("./timeLapseKeyframeInterval",timeLapseKeyframeInterval);
+	timeLapseWater=cfg.retrieveValue<bool>("./timeLapseWater",timeLapseWater);
+	std::string timeLapseReplayFileName=cfg.retrieveString("./timeLapseReplayFile","");
+	std::string waterSolverName=cfg.retrieveString("./waterSolver","RungeKutta");
+	unsigned int waterSemiImplicitIterations=cfg.retrieveValue<unsigned int>("./waterSemiImplicitIterations",16U);
+	GLfloat waterSemiImplicitStepFactor=cfg.retrieveValue<GLfloat>("./waterSemiImplicitStepFactor",4.0f);
+	GLfloat waterFriction=cfg.retrieveValue<GLfloat>("./waterFriction",0.001f);
+	std::string waterAppearanceName=cfg.retrieveString("./waterAppearance","Default");
+	std::vector<std::string> defaultWeatherCycle;
+	defaultWeatherCycle.push_back("Water");
+	defaultWeatherCycle.push_back("Lava");
+	defaultWeatherCycle.push_back("Waste");
+	defaultWeatherCycle.push_back("Snow");
+	weatherCycle=cfg.retrieveValue<std::vector<std::string> >("./weatherCycle",defaultWeatherCycle);
+	weatherPeriod=cfg.retrieveValue<double>("./weatherPeriod",0.0);
 	std::string controlPipeName=cfg.retrieveString("./controlPipeName","");
+	std::string shaderCacheDirectory;
+	std::string demCacheDirectory;
+	const char* homeDirectory=getenv("HOME");
+	if(homeDirectory!=0)
+		{
+		shaderCacheDirectory=homeDirectory;
+		shaderCacheDirectory.append("/.SARndbox-2.6.1/ShaderCache");
+		demCacheDirectory=homeDirectory;
+		demCacheDirectory.append("/.SARndbox-2.6.1/DEMCache");
+		}
+	shaderCacheDirectory=cfg.retrieveString("./shaderCacheDirectory",shaderCacheDirectory);
+	demCacheDirectory=cfg.retrieveString("./demCacheDirectory",demCacheDirectory);
 	
 	/* Procesar los parámetros de la línea de comando: */
 	bool printHelp=false;
 	const char* frameFilePrefix=0;
 	const char* kinectServerName=0;
+	const char* sharedFrameRingName=0;
+	const char* depthRecordingFileName=0;
+	bool depthRecordingColor=false;
+	const char* depthReplayFileName=0;
+	double depthReplaySpeed=1.0;
+	double depthReplayStartTime=0.0;
+	bool depthReplayLoop=false;
 	int windowIndex=0;
 	renderSettings.push_back(RenderSettings());
 	for(int i=1;i<argc;++i)
@@ -700,6 +1187,35 @@ Sandbox::Sandbox(int& argc,char**& argv):Vrui::Application(argc,argv),
 				++i;
 				kinectServerName=argv[i];
 				}
+			else if(strcasecmp(argv[i]+1,"shm")==0)
+				{
+				++i;
+				sharedFrameRingName=argv[i];
+				}
+			else if(strcasecmp(argv[i]+1,"dr")==0)
+				{
+				++i;
+				depthRecordingFileName=argv[i];
+				}
+			else if(strcasecmp(argv[i]+1,"drc")==0)
+				depthRecordingColor=true;
+			else if(strcasecmp(argv[i]+1,"drp")==0)
+				{
+				++i;
+				depthReplayFileName=argv[i];
+				}
+			else if(strcasecmp(argv[i]+1,"drs")==0)
+				{
+				++i;
+				depthReplaySpeed=atof(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"drt")==0)
+				{
+				++i;
+				depthReplayStartTime=atof(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"drl")==0)
+				depthReplayLoop=true;
 			else if(strcasecmp(argv[i]+1,"s")==0)
 				{
 				++i;
@@ -786,6 +1302,72 @@ Sandbox::Sandbox(int& argc,char**& argv):Vrui::Application(argc,argv),
 				++i;
 				demDistScale=float(atof(argv[i]));
 				}
+			else if(strcasecmp(argv[i]+1,"rn")==0)
+				{
+				drawRiverNetwork=true;
+				if(i+1<argc&&argv[i+1][0]!='-')
+					{
+					/* Lea la acumulación mínima de la red de ríos: */
+					++i;
+					riverMinAccumulation=(unsigned int)(atoi(argv[i]));
+					}
+				}
+			else if(strcasecmp(argv[i]+1,"vcl")==0)
+				useVectorContourLines=true;
+			else if(strcasecmp(argv[i]+1,"acl")==0)
+				useAnalyticContourLines=true;
+			else if(strcasecmp(argv[i]+1,"rsc")==0)
+				reportShaderCompiles=true;
+			else if(strcasecmp(argv[i]+1,"lod")==0)
+				{
+				useSurfaceLod=true;
+				if(i+1<argc&&argv[i+1][0]!='-')
+					{
+					/* Lea el error máximo de la malla diezmada fina: */
+					++i;
+					surfaceLodError=float(atof(argv[i]));
+					}
+				}
+			else if(strcasecmp(argv[i]+1,"wsi")==0)
+				{
+				++i;
+				waterStatisticsInterval=(unsigned int)(atoi(argv[i]));
+				}
+			else if(strcasecmp(argv[i]+1,"wsl")==0)
+				{
+				++i;
+				waterStatisticsLogName=argv[i];
+				}
+			else if(strcasecmp(argv[i]+1,"tl")==0)
+				{
+				++i;
+				timeLapseFileName=argv[i];
+				}
+			else if(strcasecmp(argv[i]+1,"tli")==0)
+				{
+				++i;
+				timeLapseInterval=atof(argv[i]);
+				}
+			else if(strcasecmp(argv[i]+1,"tlp")==0)
+				{
+				++i;
+				timeLapseReplayFileName=argv[i];
+				}
+			else if(strcasecmp(argv[i]+1,"wsm")==0)
+				{
+				++i;
+				waterSolverName=argv[i];
+				}
+			else if(strcasecmp(argv[i]+1,"wa")==0)
+				{
+				++i;
+				waterAppearanceName=argv[i];
+				}
+			else if(strcasecmp(argv[i]+1,"wp")==0)
+				{
+				++i;
+				weatherPeriod=atof(argv[i]);
+				}
 			else if(strcasecmp(argv[i]+1,"wi")==0)
 				{
 				++i;
@@ -872,8 +1454,20 @@ Sandbox::Sandbox(int& argc,char**& argv):Vrui::Application(argc,argv),
 	/* Print usage help if requested: */
 	if(printHelp)
 		printUsage();
-
+	
+	/* Habilite la caché en disco de binarios de programas de sombreado antes de crear cualquier sombreador: */
+	try
+		{
+		setShaderCacheDirectory(shaderCacheDirectory);
+		}
+	catch(const std::runtime_error& err)
+		{
+		std::cerr<<"Disabling shader cache due to exception "<<err.what()<<std::endl;
+		}
+	
 	std::cout<<"7: Inicio " << std::endl;	
+	SharedMemoryFrameSource* sharedCamera=0;
+	DepthRecordingFrameSource* recordedCamera=0;
 	if(frameFilePrefix!=0)
 	{
 		/* Abra los archivos de video 3D pregrabados seleccionados: */
@@ -911,6 +1505,21 @@ Sandbox::Sandbox(int& argc,char**& argv):Vrui::Application(argc,argv),
 		/* Utilice la primera secuencia de componentes del servidor como dispositivo de cámara: */
 		camera=source->getStream(0);
 	}
+	else if(sharedFrameRingName!=0)
+	{
+		/* Abra el anillo de memoria compartida escrito por un demonio de captura local: */
+		sharedCamera=new SharedMemoryFrameSource(sharedFrameRingName,5.0);
+		camera=sharedCamera;
+	}
+	else if(depthReplayFileName!=0)
+	{
+		/* Mapee en memoria la grabación de profundidad compacta seleccionada: */
+		recordedCamera=new DepthRecordingFrameSource(depthReplayFileName);
+		recordedCamera->setSpeed(depthReplaySpeed);
+		recordedCamera->setStartTime(depthReplayStartTime);
+		recordedCamera->setLoop(depthReplayLoop);
+		camera=recordedCamera;
+	}
 	else///Continua
 	{		
 		/* Abra el dispositivo de cámara 3D del índice seleccionado: */
@@ -932,6 +1541,16 @@ Sandbox::Sandbox(int& argc,char**& argv):Vrui::Application(argc,argv),
 		pixelDepthCorrection=depthCorrection->getPixelCorrection(frameSize);// 0x1235390
 		delete depthCorrection;
 		}
+	else if(sharedCamera!=0)
+		{
+		/* Utilice la corrección de profundidad por píxel ya evaluada por el demonio de captura: */
+		pixelDepthCorrection=sharedCamera->getPixelDepthCorrection();
+		}
+	else if(recordedCamera!=0)
+		{
+		/* Utilice la corrección de profundidad por píxel guardada en la grabación: */
+		pixelDepthCorrection=recordedCamera->getPixelDepthCorrection();
+		}
 	else
 		{
 		/* Crear parámetros de corrección de profundidad por píxel ficticios: */
@@ -982,6 +1601,7 @@ Sandbox::Sandbox(int& argc,char**& argv):Vrui::Application(argc,argv),
 	
 	/* Escala todos los tamaños por el factor de escala dado: */
 	double sf=scale/100.0; // Factor de escala desde cm hasta unidades finales.
+	unitScale=sf;
 	for(int i=0;i<3;++i)
 		for(int j=0;j<4;++j)
 			cameraIps.depthProjection.getMatrix()(i,j) *= sf;
@@ -1000,7 +1620,7 @@ Sandbox::Sandbox(int& argc,char**& argv):Vrui::Application(argc,argv),
 	{
 		elevationRange*=sf;// 1
 	}
-
+	
 	if(rainElevationRange!=Math::Interval<double>::full)
 	{
 		rainElevationRange*=sf;// 1
@@ -1033,13 +1653,38 @@ Sandbox::Sandbox(int& argc,char**& argv):Vrui::Application(argc,argv),
 		handExtractor = new HandExtractor(frameSize, pixelDepthCorrection, cameraIps.depthProjection);//640x480
 	}
 	
+	/* Crear el generador de líneas de contorno vectoriales con el espaciado de la primera ventana: */
+	contourGenerator=new ContourGenerator(frameSize,cameraIps.depthProjection,basePlane,contourNumThreads);
+	contourGenerator->setChangeThreshold(float(0.05*sf));
+	contourGenerator->setContourLineSpacing(renderSettings.front().contourLineSpacing);
+	
+	/* Crear el calculador de desviaciones respecto al DEM activo: */
+	demDeviation=new DEMDeviation(frameSize,cameraIps.depthProjection,demDeviationNumThreads,demDeviationSampleStep);
+	demDeviation->setTolerance(demScoreTolerance);
+	demDeviation->setNumRegions(demScoreRegions.getElements());
+	
+	/* Cree el grabador de marcos de profundidad sin procesar si se solicitó: */
+	Kinect::FrameSource::StreamingCallback* colorStreamingCallback=0;
+	if(depthRecordingFileName!=0)
+		{
+		depthRecorder=new DepthRecorder(depthRecordingFileName,*camera,pixelDepthCorrection,depthRecordingColor,30);
+		if(depthRecorder->hasColor())
+			colorStreamingCallback=Misc::createFunctionCall(depthRecorder,&DepthRecorder::addColorFrame);
+		}
+	
 	/* Iniciar la transmisión de cuadros de profundidad: */
-	camera->startStreaming(0,Misc::createFunctionCall(this,&Sandbox::rawDepthFrameDispatcher));/// Inicializar pero no lanzar
+	camera->startStreaming(colorStreamingCallback,Misc::createFunctionCall(this,&Sandbox::rawDepthFrameDispatcher));/// Inicializar pero no lanzar
 	
 	/* Crea el renderizador de imágenes en profundidad: */
 	depthImageRenderer=new DepthImageRenderer(frameSize);
 	depthImageRenderer->setIntrinsics(cameraIps);
 	depthImageRenderer->setBasePlane(basePlane);
+	if(useSurfaceLod)
+		depthImageRenderer->setMeshDecimation(float(surfaceLodError*sf),float(surfaceLodCoarseError*sf));
+	
+	/* Crear el acumulador de flujo solo si la red de ríos está habilitada desde el inicio: */
+	if(drawRiverNetwork)
+		setDrawRiverNetwork(true);
 	
 	{
 	/* Calcule la transformación del espacio de la cámara al espacio de la caja de arena: */
@@ -1070,6 +1715,26 @@ Sandbox::Sandbox(int& argc,char**& argv):Vrui::Application(argc,argv),
 		waterTable = new WaterTable2(wtSize[0],wtSize[1],depthImageRenderer,basePlaneCorners);
 		waterTable->setElevationRange(elevationRange.getMin(),rainElevationRange.getMax());
 		waterTable->setWaterDeposit(evaporationRate);
+		waterTable->setStatisticsInterval(waterStatisticsInterval);
+		
+		/* Seleccione el esquema de integración de la simulación de flujo de agua: */
+		if(strcasecmp(waterSolverName.c_str(),"SemiImplicit")==0)
+			waterTable->setSolverMode(WaterTable2::SEMI_IMPLICIT);
+		else if(strcasecmp(waterSolverName.c_str(),"RungeKutta")!=0)
+			Misc::throwStdErr("Sandbox: Unknown water solver mode %s",waterSolverName.c_str());
+		waterTable->setSemiImplicitParameters(waterSemiImplicitIterations,waterSemiImplicitStepFactor,waterFriction);
+		
+		if(!waterStatisticsLogName.empty())
+			{
+			/* Abra el registro de estadísticas del agua y escriba su encabezado: */
+			waterStatisticsLog=new IO::OStream(Vrui::openFile(waterStatisticsLogName.c_str(),IO::File::WriteOnly));
+			*waterStatisticsLog<<"# Simulation time (s), steps, volume (l), wet area (cm^2), max depth (cm), sources (l), drift (l)"<<std::endl;
+			}
+		
+		/* Crear el objeto de relleno de depresiones para la cuadrícula de la capa freática: */
+		depressionFiller=new DepressionFiller(wtSize[0],wtSize[1]);
+		depressionFiller->setChangeThreshold(GLfloat(0.01*sf));
+		equilibriumBathymetry=new GLfloat[waterTable->getBathymetrySize(1)*waterTable->getBathymetrySize(0)];
 		
 		/* Registrar una función de render con la tabla de agua: */
 		addWaterFunction = Misc::createFunctionCall(this,&Sandbox::addWater);
@@ -1108,7 +1773,12 @@ Sandbox::Sandbox(int& argc,char**& argv):Vrui::Application(argc,argv),
 		rsIt->surfaceRenderer->setContourLineDistance(rsIt->contourLineSpacing);
 		rsIt->surfaceRenderer->setElevationColorMap(rsIt->elevationColorMap);
 		rsIt->surfaceRenderer->setIlluminate(rsIt->hillshade);
+		rsIt->surfaceRenderer->setUseShadows(rsIt->useShadows);
 		rsIt->surfaceRenderer->setLava(rsIt->useLava);
+		rsIt->surfaceRenderer->setFlowAccumulator(drawRiverNetwork?flowAccumulator:0);
+		rsIt->surfaceRenderer->setContourGenerator(useVectorContourLines?contourGenerator:0);
+		rsIt->surfaceRenderer->setAnalyticContourLines(useAnalyticContourLines);
+		rsIt->surfaceRenderer->setReportShaderCompiles(reportShaderCompiles);
 		if(waterTable!=0)
 			{
 			if(rsIt->renderWaterSurface)
@@ -1128,6 +1798,28 @@ Sandbox::Sandbox(int& argc,char**& argv):Vrui::Application(argc,argv),
 		rsIt->surfaceRenderer->setDemDistScale(demDistScale);
 		}
 	
+	if(!timeLapseReplayFileName.empty())
+		{
+		/* Abra el lapso de tiempo que reemplaza a la cámara: */
+		timeLapseReader=new TimeLapseReader(timeLapseReplayFileName.c_str());
+		if(timeLapseReader->getElevationSize()[0]!=frameSize[0]||timeLapseReader->getElevationSize()[1]!=frameSize[1])
+			Misc::throwStdErr("Sandbox: Time-lapse file %s does not match the camera's frame size",timeLapseReplayFileName.c_str());
+		timeLapseReplayStart=Vrui::getApplicationTime();
+		std::cout<<"Replaying "<<timeLapseReader->getNumFrames()<<" time-lapse frames over "<<timeLapseReader->getFrameTime(timeLapseReader->getNumFrames()-1)<<" s from "<<timeLapseReplayFileName<<std::endl;
+		}
+	
+	/* Empiece a grabar el lapso de tiempo si se solicitó: */
+	if(!timeLapseFileName.empty())
+		startTimeLapse(timeLapseFileName.c_str());
+	
+	/* Seleccione la apariencia inicial del agua y el estado correspondiente del ciclo meteorológico: */
+	if(!setWaterAppearance(waterAppearanceName.c_str()))
+		std::cerr<<"Unknown water appearance "<<waterAppearanceName<<"; using default appearance"<<std::endl;
+	for(unsigned int i=0;i<weatherCycle.size();++i)
+		if(strcasecmp(weatherCycle[i].c_str(),waterAppearanceName.c_str())==0)
+			weatherState=i;
+	nextWeatherTime=Vrui::getApplicationTime()+weatherPeriod;
+	
 	#if 0
 	/* Create a fixed-position light source: */
 	sun=Vrui::getLightsourceManager()->createLightsource(true);
@@ -1142,11 +1834,12 @@ Sandbox::Sandbox(int& argc,char**& argv):Vrui::Application(argc,argv),
 	Vrui::setMainMenu(mainMenu);
 	if(waterTable!=0)
 		waterControlDialog=createWaterControlDialog();
+	demMatchingDialog=createDemMatchingDialog(demScoreRegions.getElements());
 	
 	/* Inicialice las clases de herramientas personalizadas: */
 	GlobalWaterTool::initClass(*Vrui::getToolManager());
 	LocalWaterTool::initClass(*Vrui::getToolManager());
-	DEMTool::initClass(*Vrui::getToolManager());
+	DEMTool::initClass(*Vrui::getToolManager(),demCacheDirectory);
 	HeightColorMapTool::initClass(*Vrui::getToolManager());
 	ContourLineTool::initClass(*Vrui::getToolManager());
 	WaterLevelTool::initClass(*Vrui::getToolManager());
@@ -1179,15 +1872,41 @@ Sandbox::~Sandbox(void)
 	delete camera;
 	delete frameFilter;
 	
+	/* Termine la grabación de los marcos de profundidad: */
+	if(depthRecorder!=0)
+		{
+		size_t numDroppedDepthFrames=depthRecorder->getNumDroppedDepthFrames();
+		size_t numDroppedColorFrames=depthRecorder->getNumDroppedColorFrames();
+		std::string error=depthRecorder->getError();
+		delete depthRecorder;
+		if(!error.empty())
+			std::cerr<<"Depth recording failed due to exception "<<error<<std::endl;
+		else if(numDroppedDepthFrames>0||numDroppedColorFrames>0)
+			std::cout<<"Depth recording dropped "<<numDroppedDepthFrames<<" depth frames and "<<numDroppedColorFrames<<" color frames"<<std::endl;
+		}
+	
+	/* Termine la grabación del lapso de tiempo: */
+	stopTimeLapse();
+	delete[] timeLapseWaterLevel;
+	delete timeLapseReader;
+	
 	/* Eliminar objetos de ayuda: */
+	BathymetrySaverTool::releaseWaterTable();
 	delete waterTable;
+	delete depressionFiller;
+	delete[] equilibriumBathymetry;
 	delete depthImageRenderer;
 	delete handExtractor;
+	delete flowAccumulator;
+	delete contourGenerator;
+	delete demDeviation;
+	delete waterStatisticsLog;
 	delete addWaterFunction;
 	delete[] pixelDepthCorrection;
 	
 	delete mainMenu;
 	delete waterControlDialog;
+	delete demMatchingDialog;
 	
 	close(controlPipeFd);
 	}
@@ -1255,6 +1974,9 @@ bool isToken(const std::string& token,const char* pattern)
 
 void Sandbox::frame(void)
 	{
+	/* Avance las subidas pendientes de la textura de profundidad al nuevo cuadro: */
+	depthImageRenderer->frame();
+	
 	/* Compruebe si el marco filtrado se ha actualizado: */
 	if(filteredFrames.lockNewValue())
 		{
@@ -1262,6 +1984,29 @@ void Sandbox::frame(void)
 		depthImageRenderer->setDepthImage(filteredFrames.getLockedValue());
 		}
 	
+	/* Grabe o reproduzca el lapso de tiempo: */
+	if(timeLapseRecorder!=0||timeLapseReader!=0)
+		updateTimeLapse();
+	
+	if(flowAccumulator!=0)
+		{
+		/* Bloquea la máscara de ríos más reciente: */
+		flowAccumulator->lockNewRiverMask();
+		}
+	
+	if(contourGenerator!=0)
+		{
+		/* Bloquea las líneas de contorno vectoriales más recientes: */
+		contourGenerator->lockNewContours();
+		}
+	
+	if(demDeviation!=0)
+		{
+		/* Pase el DEM activo al calculador de desviaciones y bloquee las estadísticas más recientes: */
+		demDeviation->setDem(activeDem);
+		demDeviation->lockNewStatistics();
+		}
+	
 	if(handExtractor!=0)
 	{
 		/* Bloquea la lista de manos extraída más reciente: */
@@ -1284,6 +2029,25 @@ void Sandbox::frame(void)
 	}
 	//std::cout<<"Algoaqyu"<<std::endl;
 	
+	if(depressionFiller!=0)
+		{
+		/* Solicite la batimetría actual si hay un relleno de equilibrio pendiente; otro lector puede estar usando la lectura: */
+		if(equilibriumFillRequested&&!equilibriumBathymetryPending)
+			{
+			equilibriumBathymetryPending=waterTable->requestBathymetry(equilibriumBathymetry);
+			equilibriumFillRequested=!equilibriumBathymetryPending;
+			}
+		
+		/* Calcule la superficie de agua en equilibrio cuando llega la batimetría: */
+		if(equilibriumBathymetryPending&&waterTable->haveBathymetry())
+			{
+			depressionFiller->setBathymetry(equilibriumBathymetry);
+			depressionFiller->fill();
+			++equilibriumWaterLevelVersion;
+			equilibriumBathymetryPending=false;
+			}
+		}
+	
 	/* Actualizar todos los renderizadores de superficie: */
 	for(std::vector<RenderSettings>::iterator rsIt=renderSettings.begin();rsIt!=renderSettings.end();++rsIt)
 		rsIt->surfaceRenderer->setAnimationTime(Vrui::getApplicationTime());
@@ -1474,6 +2238,7 @@ void Sandbox::frame(void)
 				      		/* Override the contour line spacing of all surface renderers: */
 				      		for(std::vector<RenderSettings>::iterator rsIt=renderSettings.begin();rsIt!=renderSettings.end();++rsIt)
 				        		rsIt->surfaceRenderer->setContourLineDistance(contourLineSpacing);
+				      		contourGenerator->setContourLineSpacing(contourLineSpacing);
 				      	}
 				    	else
 				      		std::cerr<<"Invalid parameter "<<contourLineSpacing<<" for contourLineSpacing control pipe command"<<std::endl;
@@ -1481,6 +2246,215 @@ void Sandbox::frame(void)
 			  		else
 			    		std::cerr<<"Wrong number of arguments for contourLineSpacing control pipe command"<<std::endl;
 			  	}	
+				else if(isToken(tokens[0],"riverNetwork"))
+					{
+					if(tokens.size()==2)
+						{
+						/* Analiza el parámetro del comando: */
+						bool newDrawRiverNetwork=isToken(tokens[1],"on");
+						if(newDrawRiverNetwork||isToken(tokens[1],"off"))
+							{
+							/* Habilite o deshabilite la red de ríos en todos los renderizadores de superficie: */
+							setDrawRiverNetwork(newDrawRiverNetwork);
+							}
+						else
+							std::cerr<<"Invalid parameter "<<tokens[1]<<" for riverNetwork control pipe command"<<std::endl;
+						}
+					else
+						std::cerr<<"Wrong number of arguments for riverNetwork control pipe command"<<std::endl;
+					}
+				else if(isToken(tokens[0],"vectorContourLines"))
+					{
+					if(tokens.size()==2)
+						{
+						/* Analiza el parámetro del comando: */
+						bool newUseVectorContourLines=isToken(tokens[1],"on");
+						if(newUseVectorContourLines||isToken(tokens[1],"off"))
+							{
+							/* Cambie entre líneas de contorno vectoriales y del sombreador en todos los renderizadores de superficie: */
+							useVectorContourLines=newUseVectorContourLines;
+							for(std::vector<RenderSettings>::iterator rsIt=renderSettings.begin();rsIt!=renderSettings.end();++rsIt)
+								rsIt->surfaceRenderer->setContourGenerator(useVectorContourLines?contourGenerator:0);
+							}
+						else
+							std::cerr<<"Invalid parameter "<<tokens[1]<<" for vectorContourLines control pipe command"<<std::endl;
+						}
+					else
+						std::cerr<<"Wrong number of arguments for vectorContourLines control pipe command"<<std::endl;
+					}
+				else if(isToken(tokens[0],"analyticContourLines"))
+					{
+					if(tokens.size()==2)
+						{
+						/* Analiza el parámetro del comando: */
+						bool newUseAnalyticContourLines=isToken(tokens[1],"on");
+						if(newUseAnalyticContourLines||isToken(tokens[1],"off"))
+							{
+							/* Cambie entre líneas de contorno analíticas y de elevaciones de esquina de píxel en todos los renderizadores de superficie: */
+							useAnalyticContourLines=newUseAnalyticContourLines;
+							for(std::vector<RenderSettings>::iterator rsIt=renderSettings.begin();rsIt!=renderSettings.end();++rsIt)
+								rsIt->surfaceRenderer->setAnalyticContourLines(useAnalyticContourLines);
+							}
+						else
+							std::cerr<<"Invalid parameter "<<tokens[1]<<" for analyticContourLines control pipe command"<<std::endl;
+						}
+					else
+						std::cerr<<"Wrong number of arguments for analyticContourLines control pipe command"<<std::endl;
+					}
+				else if(isToken(tokens[0],"exportContours"))
+					{
+					if(tokens.size()==2)
+						{
+						if(useVectorContourLines)
+							{
+							try
+								{
+								/* Seleccione el formato de exportación por la extensión del nombre del archivo: */
+								const std::string& fileName=tokens[1];
+								if(fileName.size()>=4&&strcasecmp(fileName.c_str()+fileName.size()-4,".svg")==0)
+									contourGenerator->exportSVG(fileName.c_str(),boxTransform,unitScale);
+								else
+									contourGenerator->exportGeoJSON(fileName.c_str(),boxTransform,unitScale);
+								std::cout<<"Exported "<<contourGenerator->getNumSegments()<<" contour line segments to "<<fileName<<std::endl;
+								}
+							catch(const std::runtime_error& err)
+								{
+								std::cerr<<"Unable to export contour lines to "<<tokens[1]<<" due to exception "<<err.what()<<std::endl;
+								}
+							}
+						else
+							std::cerr<<"Vector contour lines are disabled; ignoring exportContours control pipe command"<<std::endl;
+						}
+					else
+						std::cerr<<"Wrong number of arguments for exportContours control pipe command"<<std::endl;
+					}
+				else if(isToken(tokens[0],"waterStatistics"))
+					{
+					if(tokens.size()==1)
+						{
+						if(waterTable!=0&&waterTable->getStatisticsVersion()!=0)
+							printWaterStatistics(std::cout);
+						else
+							std::cerr<<"No water statistics available; ignoring waterStatistics control pipe command"<<std::endl;
+						}
+					else
+						std::cerr<<"Wrong number of arguments for waterStatistics control pipe command"<<std::endl;
+					}
+				else if(isToken(tokens[0],"demStatistics"))
+					{
+					if(tokens.size()==1)
+						{
+						if(activeDem!=0&&demDeviation->getStatisticsVersion()!=0)
+							printDemStatistics(std::cout);
+						else
+							std::cerr<<"No DEM statistics available; ignoring demStatistics control pipe command"<<std::endl;
+						}
+					else
+						std::cerr<<"Wrong number of arguments for demStatistics control pipe command"<<std::endl;
+					}
+				else if(isToken(tokens[0],"demScoreTolerance"))
+					{
+					if(tokens.size()==2)
+						demDeviation->setTolerance(atof(tokens[1].c_str()));
+					else
+						std::cerr<<"Wrong number of arguments for demScoreTolerance control pipe command"<<std::endl;
+					}
+				else if(isToken(tokens[0],"waterStatisticsInterval"))
+					{
+					if(tokens.size()==2)
+						{
+						if(waterTable!=0)
+							waterTable->setStatisticsInterval((unsigned int)(atoi(tokens[1].c_str())));
+						}
+					else
+						std::cerr<<"Wrong number of arguments for waterStatisticsInterval control pipe command"<<std::endl;
+					}
+				else if(isToken(tokens[0],"waterAppearance"))
+					{
+					if(tokens.size()==1)
+						{
+						/* Enumere las apariencias del agua disponibles: */
+						const SurfaceRenderer* sr=renderSettings.front().surfaceRenderer;
+						std::cout<<"Water appearances:";
+						for(unsigned int i=0;i<sr->getNumWaterAppearances();++i)
+							std::cout<<' '<<sr->getWaterAppearanceName(i);
+						std::cout<<std::endl;
+						}
+					else if(tokens.size()==2)
+						{
+						if(!setWaterAppearance(tokens[1].c_str()))
+							std::cerr<<"Invalid parameter "<<tokens[1]<<" for waterAppearance control pipe command"<<std::endl;
+						}
+					else
+						std::cerr<<"Wrong number of arguments for waterAppearance control pipe command"<<std::endl;
+					}
+				else if(isToken(tokens[0],"weather"))
+					{
+					if(tokens.size()==1)
+						advanceWeather();
+					else if(tokens.size()==2)
+						{
+						/* Salte al estado del ciclo con el nombre dado, o use la apariencia fuera del ciclo: */
+						if(setWaterAppearance(tokens[1].c_str()))
+							{
+							for(unsigned int i=0;i<weatherCycle.size();++i)
+								if(strcasecmp(weatherCycle[i].c_str(),tokens[1].c_str())==0)
+									weatherState=i;
+							}
+						else
+							std::cerr<<"Invalid parameter "<<tokens[1]<<" for weather control pipe command"<<std::endl;
+						}
+					else
+						std::cerr<<"Wrong number of arguments for weather control pipe command"<<std::endl;
+					
+					/* Reinicie el temporizador del ciclo automático: */
+					nextWeatherTime=Vrui::getApplicationTime()+weatherPeriod;
+					}
+				else if(isToken(tokens[0],"weatherPeriod"))
+					{
+					if(tokens.size()==2)
+						{
+						weatherPeriod=atof(tokens[1].c_str());
+						nextWeatherTime=Vrui::getApplicationTime()+weatherPeriod;
+						}
+					else
+						std::cerr<<"Wrong number of arguments for weatherPeriod control pipe command"<<std::endl;
+					}
+				else if(isToken(tokens[0],"fillToEquilibrium"))
+					{
+					if(tokens.size()==1)
+						{
+						if(depressionFiller!=0)
+							equilibriumFillRequested=true;
+						else
+							std::cerr<<"Water simulation is disabled; ignoring fillToEquilibrium control pipe command"<<std::endl;
+						}
+					else
+						std::cerr<<"Wrong number of arguments for fillToEquilibrium control pipe command"<<std::endl;
+					}
+				else if(isToken(tokens[0],"timeLapse"))
+					{
+					if(tokens.size()==2)
+						{
+						if(isToken(tokens[1],"off"))
+							stopTimeLapse();
+						else
+							{
+							try
+								{
+								/* Empiece a grabar un nuevo lapso de tiempo: */
+								startTimeLapse(tokens[1].c_str());
+								std::cout<<"Recording time-lapse to "<<tokens[1]<<std::endl;
+								}
+							catch(const std::runtime_error& err)
+								{
+								std::cerr<<"Unable to record time-lapse to "<<tokens[1]<<" due to exception "<<err.what()<<std::endl;
+								}
+							}
+						}
+					else
+						std::cerr<<"Wrong number of arguments for timeLapse control pipe command"<<std::endl;
+					}
 				else
 					std::cerr<<"Unrecognized control pipe command "<<tokens[0]<<std::endl;
 				}
@@ -1493,10 +2467,188 @@ void Sandbox::frame(void)
 		frameRateTextField->setValue(1.0/Vrui::getCurrentFrameTime());
 		}
 	
+	if(waterTable!=0&&waterStatisticsVersion!=waterTable->getStatisticsVersion())
+		{
+		/* Procese la nueva muestra de estadísticas del agua: */
+		const WaterTable2::Statistics& stats=waterTable->getStatistics();
+		if(waterVolumeTextField!=0&&Vrui::getWidgetManager()->isVisible(waterControlDialog))
+			waterVolumeTextField->setValue(stats.volume/(unitScale*unitScale*unitScale*1000.0));
+		if(waterStatisticsLog!=0)
+			{
+			double litresPerUnit=1.0/(unitScale*unitScale*unitScale*1000.0);
+			*waterStatisticsLog<<stats.simulationTime<<' '<<stats.numSteps<<' '<<stats.volume*litresPerUnit<<' '<<stats.wetArea/(unitScale*unitScale)<<' '<<stats.maxDepth/unitScale<<' '<<stats.sourceVolume*litresPerUnit<<' '<<stats.drift*litresPerUnit<<std::endl;
+			}
+		waterStatisticsVersion=waterTable->getStatisticsVersion();
+		}
+	
+	if(demDeviation!=0&&demStatisticsVersion!=demDeviation->getStatisticsVersion())
+		{
+		/* Actualice el diálogo de coincidencia de DEM con las nuevas estadísticas: */
+		if(Vrui::getWidgetManager()->isVisible(demMatchingDialog))
+			{
+			const DEMDeviation::Statistics& stats=demDeviation->getStatistics();
+			demRmsErrorTextField->setValue(stats.rmsError);
+			demCutVolumeTextField->setValue(stats.cutVolume/1000.0);
+			demFillVolumeTextField->setValue(stats.fillVolume/1000.0);
+			demScoreTextField->setValue(stats.score);
+			for(unsigned int y=0;y<stats.numRegions[1];++y)
+				for(unsigned int x=0;x<stats.numRegions[0];++x)
+					{
+					const DEMDeviation::RegionStatistics& rs=stats.regions[(stats.numRegions[1]-1-y)*stats.numRegions[0]+x];
+					GLMotif::TextField* textField=demRegionScoreTextFields[y*stats.numRegions[0]+x];
+					if(rs.numSamples>0)
+						textField->setValue(rs.score);
+					else
+						textField->setString("-");
+					}
+			}
+		demStatisticsVersion=demDeviation->getStatisticsVersion();
+		}
+	
+	if(weatherPeriod>0.0&&Vrui::getApplicationTime()>=nextWeatherTime)
+		{
+		/* Avance el ciclo meteorológico automático: */
+		advanceWeather();
+		nextWeatherTime=Vrui::getApplicationTime()+weatherPeriod;
+		}
+	
 	if(pauseUpdates)
 		Vrui::scheduleUpdate(Vrui::getApplicationTime()+1.0/30.0);
 	}
 
+void Sandbox::updateShadowMap(Sandbox::DataItem* dataItem,const Vrui::DisplayState& ds,GLContextData& contextData) const
+	{
+	/* Busque la primera fuente de luz habilitada: */
+	const GLLightTracker& lt=*contextData.getLightTracker();
+	int lightSourceIndex;
+	for(lightSourceIndex=0;lightSourceIndex<lt.getMaxNumLights()&&!lt.getLightState(lightSourceIndex).isEnabled();++lightSourceIndex)
+		;
+	bool haveLight=lightSourceIndex<lt.getMaxNumLights();
+	
+	/* Transforma la posición de la fuente de luz al espacio de la cámara: */
+	Vrui::ONTransform::HVector lightPosCc(0,0,0,0);
+	if(haveLight)
+		{
+		Geometry::HVector<float,3> lightPosEc;
+		glGetLightfv(GL_LIGHT0+lightSourceIndex,GL_POSITION,lightPosEc.getComponents());
+		lightPosCc=ds.modelviewNavigational.inverseTransform(Vrui::ONTransform::HVector(lightPosEc));
+		}
+	
+	/* Compruebe si el mapa de sombras sigue siendo válido para la imagen de profundidad y la fuente de luz actuales: */
+	bool lightChanged=false;
+	for(int i=0;i<4;++i)
+		lightChanged=lightChanged||dataItem->shadowLightPosition[i]!=GLfloat(lightPosCc[i]);
+	if(dataItem->shadowMapValid&&!lightChanged&&dataItem->shadowDepthImageVersion==depthImageRenderer->getDepthTextureVersion(contextData))
+		return;
+	
+	/* Calcula la matriz de proyección de la sombra: */
+	PTransform shadowProjection(1.0);
+	if(haveLight)
+		{
+		/* Calcule el vector de dirección desde el centro del cuadro delimitador hasta la fuente de luz: */
+		Point bboxCenter=Geometry::mid(bbox.min,bbox.max);
+		Vrui::Vector lightDirCc=Vrui::Vector(lightPosCc.getComponents())-Vrui::Vector(bboxCenter.getComponents())*lightPosCc[3];
+		
+		/* Cree una transformación que alinee la dirección de la luz con el eje z positivo: */
+		Vrui::ONTransform shadowModelview=Vrui::ONTransform::rotate(Vrui::Rotation::rotateFromTo(lightDirCc,Vrui::Vector(0,0,1)));
+		shadowModelview*=Vrui::ONTransform::translateToOriginFrom(bboxCenter);
+		
+		/* Cree una matriz de proyección, basada en si la luz es posicional o direccional: */
+		shadowProjection=PTransform(0.0);
+		if(lightPosCc[3]!=0.0)
+			{
+			/* Modifique la transformación de la vista del modelo de modo que la fuente de luz esté en el origen: */
+			shadowModelview.leftMultiply(Vrui::ONTransform::translate(Vrui::Vector(0,0,-lightDirCc.mag())));
+			
+			/* Calcule el cuadro delimitador de perspectiva del cuadro delimitador de superficie en el espacio ocular: */
+			Box pBox=Box::empty;
+			for(int i=0;i<8;++i)
+				{
+				Point bc=shadowModelview.transform(bbox.getVertex(i));
+				pBox.addPoint(Point(-bc[0]/bc[2],-bc[1]/bc[2],-bc[2]));
+				}
+			
+			/* Cree la matriz del tronco: */
+			double l=pBox.min[0]*pBox.min[2];
+			double r=pBox.max[0]*pBox.min[2];
+			double b=pBox.min[1]*pBox.min[2];
+			double t=pBox.max[1]*pBox.min[2];
+			double n=pBox.min[2];
+			double f=pBox.max[2];
+			shadowProjection.getMatrix()(0,0)=2.0*n/(r-l);
+			shadowProjection.getMatrix()(0,2)=(r+l)/(r-l);
+			shadowProjection.getMatrix()(1,1)=2.0*n/(t-b);
+			shadowProjection.getMatrix()(1,2)=(t+b)/(t-b);
+			shadowProjection.getMatrix()(2,2)=-(f+n)/(f-n);
+			shadowProjection.getMatrix()(2,3)=-2.0*f*n/(f-n);
+			shadowProjection.getMatrix()(3,2)=-1.0;
+			}
+		else
+			{
+			/* Transforma el cuadro delimitador con la transformación modelview: */
+			Box bboxEc=bbox;
+			bboxEc.transform(shadowModelview);
+			
+			/* Cree la matriz orto: */
+			double l=bboxEc.min[0];
+			double r=bboxEc.max[0];
+			double b=bboxEc.min[1];
+			double t=bboxEc.max[1];
+			double n=-bboxEc.max[2];
+			double f=-bboxEc.min[2];
+			shadowProjection.getMatrix()(0,0)=2.0/(r-l);
+			shadowProjection.getMatrix()(0,3)=-(r+l)/(r-l);
+			shadowProjection.getMatrix()(1,1)=2.0/(t-b);
+			shadowProjection.getMatrix()(1,3)=-(t+b)/(t-b);
+			shadowProjection.getMatrix()(2,2)=-2.0/(f-n);
+			shadowProjection.getMatrix()(2,3)=-(f+n)/(f-n);
+			shadowProjection.getMatrix()(3,3)=1.0;
+			}
+		
+		/* Multiplique la matriz de la vista de modelo de sombra en la matriz de proyección de sombra: */
+		shadowProjection*=shadowModelview;
+		}
+	
+	/* Configure el estado de OpenGL para renderizar en el mapa de sombras: */
+	GLint currentFrameBuffer;
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING_EXT,&currentFrameBuffer);
+	glPushAttrib(GL_DEPTH_BUFFER_BIT|GL_ENABLE_BIT|GL_POLYGON_BIT|GL_VIEWPORT_BIT);
+	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,dataItem->shadowFramebufferObject);
+	glViewport(0,0,dataItem->shadowBufferSize[0],dataItem->shadowBufferSize[1]);
+	glEnable(GL_DEPTH_TEST);
+	glDepthMask(GL_TRUE);
+	glClear(GL_DEPTH_BUFFER_BIT);
+	
+	/* Dibuja la superficie en el buffer de sombra; sin fuente de luz, el mapa vacío deja toda la superficie iluminada: */
+	if(haveLight)
+		{
+		glDisable(GL_CULL_FACE);
+		glEnable(GL_POLYGON_OFFSET_FILL);
+		glPolygonOffset(2.0f,4.0f);
+		depthImageRenderer->renderDepth(shadowProjection,contextData);
+		}
+	
+	/* Restablecer el estado de OpenGL: */
+	glPopAttrib();
+	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,currentFrameBuffer);
+	
+	/* Calcule la transformación del espacio de la cámara al espacio de textura del mapa de sombras: */
+	PTransform bias(1.0);
+	for(int i=0;i<3;++i)
+		{
+		bias.getMatrix()(i,i)=0.5;
+		bias.getMatrix()(i,3)=0.5;
+		}
+	dataItem->shadowTextureTransform=bias;
+	dataItem->shadowTextureTransform*=shadowProjection;
+	
+	/* Marque el mapa de sombras como actual: */
+	dataItem->shadowMapValid=true;
+	dataItem->shadowDepthImageVersion=depthImageRenderer->getDepthTextureVersion(contextData);
+	for(int i=0;i<4;++i)
+		dataItem->shadowLightPosition[i]=GLfloat(lightPosCc[i]);
+	}
+
 void Sandbox::display(GLContextData& contextData) const
 	{	
 	//std::cout << "Inicio de algo" << std::endl;
@@ -1516,6 +2668,20 @@ void Sandbox::display(GLContextData& contextData) const
 		{
 		/* Avtualizar agua table's bathymetry grid: */
 		waterTable->updateBathymetry(contextData);
+		
+		/* Cargue el nivel de agua en equilibrio más reciente si este contexto aún no lo tiene: */
+		if(dataItem->equilibriumWaterLevelVersion!=equilibriumWaterLevelVersion)
+			{
+			waterTable->setWaterLevel(depressionFiller->getFilled(),contextData);
+			dataItem->equilibriumWaterLevelVersion=equilibriumWaterLevelVersion;
+			}
+		
+		/* Cargue la cuadrícula de agua reproducida más reciente si este contexto aún no la tiene: */
+		if(timeLapseReader!=0&&dataItem->timeLapseWaterLevelVersion!=timeLapseWaterLevelVersion)
+			{
+			waterTable->setWaterLevel(timeLapseReader->getWaterLevel(),contextData);
+			dataItem->timeLapseWaterLevelVersion=timeLapseWaterLevelVersion;
+			}
 		/* Ejecutar el paso principal de simulaciones de flujo de agua: */
 		GLfloat totalTimeStep = GLfloat(Vrui::getFrameTime()*waterSpeed);
 		unsigned int numSteps=0;
@@ -1564,177 +2730,16 @@ void Sandbox::display(GLContextData& contextData) const
 		glMaterial(GLMaterialEnums::FRONT,rs.surfaceMaterial);
 		}
 	
-	#if 0
 	if(rs.hillshade&&rs.useShadows)
 		{
-		/* Configurar el estado de OpenGL: */
-		glPushAttrib(GL_COLOR_BUFFER_BIT|GL_DEPTH_BUFFER_BIT|GL_ENABLE_BIT|GL_POLYGON_BIT);
-		
-		GLLightTracker& lt=*contextData.getLightTracker();
-		
-		/* Guarde el buffer de marco y la ventana gráfica actualmente enlazados: */
-		GLint currentFrameBuffer;
-		glGetIntegerv(GL_FRAMEBUFFER_BINDING_EXT,&currentFrameBuffer);
-		GLint currentViewport[4];
-		glGetIntegerv(GL_VIEWPORT,currentViewport);
-		
-		/*******************************************************************
-		First rendering pass: Global ambient illumination only
-		*******************************************************************/
-		
-		/* Dibuja la malla de la superficie: */
-		surfaceRenderer->glRenderGlobalAmbientHeightMap(dataItem->heightColorMapObject,contextData);
-		
-		/*******************************************************************
-		Second rendering pass: Add local illumination for every light source
-		*******************************************************************/
-		
-		/* Habilitar la representación aditiva: */
-		glEnable(GL_BLEND);
-		glBlendFunc(GL_ONE,GL_ONE);
-		glDepthFunc(GL_LEQUAL);
-		glDepthMask(GL_FALSE);
-		
-		for(int lightSourceIndex=0;lightSourceIndex<lt.getMaxNumLights();++lightSourceIndex)
-			if(lt.getLightState(lightSourceIndex).isEnabled())
-				{
-				/***************************************************************
-				First step: Render to the light source's shadow map
-				***************************************************************/
-				
-				/* Configure el estado de OpenGL para renderizar en el mapa de sombras: */
-				glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,dataItem->shadowFramebufferObject);
-				glViewport(0,0,dataItem->shadowBufferSize[0],dataItem->shadowBufferSize[1]);
-				glDepthMask(GL_TRUE);
-				glClear(GL_DEPTH_BUFFER_BIT);
-				glCullFace(GL_FRONT);
-				
-				/*************************************************************
-				Calculate the shadow projection matrix:
-				*************************************************************/
-				
-				/* Obtener la posición de la fuente de luz en el espacio ocular: */
-				Geometry::HVector<float,3> lightPosEc;
-				glGetLightfv(GL_LIGHT0+lightSourceIndex,GL_POSITION,lightPosEc.getComponents());
-				
-				/* Transforma la posición de la fuente de luz al espacio de la cámara: */
-				Vrui::ONTransform::HVector lightPosCc=Vrui::getDisplayState(contextData).modelviewNavigational.inverseTransform(Vrui::ONTransform::HVector(lightPosEc));
-				
-				/* Calcule el vector de dirección desde el centro del cuadro delimitador hasta la fuente de luz: */
-				Point bboxCenter=Geometry::mid(bbox.min,bbox.max);
-				Vrui::Vector lightDirCc=Vrui::Vector(lightPosCc.getComponents())-Vrui::Vector(bboxCenter.getComponents())*lightPosCc[3];
-				
-				/* Cree una transformación que alinee la dirección de la luz con el eje z positivo: */
-				Vrui::ONTransform shadowModelview=Vrui::ONTransform::rotate(Vrui::Rotation::rotateFromTo(lightDirCc,Vrui::Vector(0,0,1)));
-				shadowModelview*=Vrui::ONTransform::translateToOriginFrom(bboxCenter);
-				
-				/* Cree una matriz de proyección, basada en si la luz es posicional o direccional: */
-				PTransform shadowProjection(0.0);
-				if(lightPosEc[3]!=0.0f)
-					{
-					/* Modifique la transformación de la vista del modelo de modo que la fuente de luz esté en el origen: */
-					shadowModelview.leftMultiply(Vrui::ONTransform::translate(Vrui::Vector(0,0,-lightDirCc.mag())));
-					
-					/***********************************************************
-					Create a perspective projection:
-					***********************************************************/
-					
-					/* Calcule el cuadro delimitador de perspectiva del cuadro delimitador de superficie en el espacio ocular: */
-					Box pBox=Box::empty;
-					for(int i=0;i<8;++i)
-						{
-						Point bc=shadowModelview.transform(bbox.getVertex(i));
-						pBox.addPoint(Point(-bc[0]/bc[2],-bc[1]/bc[2],-bc[2]));
-						}
-					
-					/* Sube la matriz del tronco: */
-					double l=pBox.min[0]*pBox.min[2];
-					double r=pBox.max[0]*pBox.min[2];
-					double b=pBox.min[1]*pBox.min[2];
-					double t=pBox.max[1]*pBox.min[2];
-					double n=pBox.min[2];
-					double f=pBox.max[2];
-					shadowProjection.getMatrix()(0,0)=2.0*n/(r-l);
-					shadowProjection.getMatrix()(0,2)=(r+l)/(r-l);
-					shadowProjection.getMatrix()(1,1)=2.0*n/(t-b);
-					shadowProjection.getMatrix()(1,2)=(t+b)/(t-b);
-					shadowProjection.getMatrix()(2,2)=-(f+n)/(f-n);
-					shadowProjection.getMatrix()(2,3)=-2.0*f*n/(f-n);
-					shadowProjection.getMatrix()(3,2)=-1.0;
-					}
-				else
-					{
-					/***********************************************************
-					Create a perspective projection:
-					***********************************************************/
-					
-					/* Transforma el cuadro delimitador con la transformación modelview: */
-					Box bboxEc=bbox;
-					bboxEc.transform(shadowModelview);
-					
-					/* Subir la matriz orto: */
-					double l=bboxEc.min[0];
-					double r=bboxEc.max[0];
-					double b=bboxEc.min[1];
-					double t=bboxEc.max[1];
-					double n=-bboxEc.max[2];
-					double f=-bboxEc.min[2];
-					shadowProjection.getMatrix()(0,0)=2.0/(r-l);
-					shadowProjection.getMatrix()(0,3)=-(r+l)/(r-l);
-					shadowProjection.getMatrix()(1,1)=2.0/(t-b);
-					shadowProjection.getMatrix()(1,3)=-(t+b)/(t-b);
-					shadowProjection.getMatrix()(2,2)=-2.0/(f-n);
-					shadowProjection.getMatrix()(2,3)=-(f+n)/(f-n);
-					shadowProjection.getMatrix()(3,3)=1.0;
-					}
-				
-				/* Multiplique la matriz de la vista de modelo de sombra en la matriz de proyección de sombra: */
-				shadowProjection*=shadowModelview;
-				
-				/* Dibuja la superficie en el buffer de sombra: */
-				surfaceRenderer->glRenderDepthOnly(shadowProjection,contextData);
-				
-				/* Restablecer el estado de OpenGL: */
-				glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,currentFrameBuffer);
-				glViewport(currentViewport[0],currentViewport[1],currentViewport[2],currentViewport[3]);
-				glCullFace(GL_BACK);
-				glDepthMask(GL_FALSE);
-				
-				#if SAVEDEPTH
-				/* Guardar la imagen de profundidad: */
-				{
-				glBindTexture(GL_TEXTURE_2D,dataItem->shadowDepthTextureObject);
-				GLfloat* depthTextureImage=new GLfloat[dataItem->shadowBufferSize[1]*dataItem->shadowBufferSize[0]];
-				glGetTexImage(GL_TEXTURE_2D,0,GL_DEPTH_COMPONENT,GL_FLOAT,depthTextureImage);
-				glBindTexture(GL_TEXTURE_2D,0);
-				Images::RGBImage dti(dataItem->shadowBufferSize[0],dataItem->shadowBufferSize[1]);
-				GLfloat* dtiPtr=depthTextureImage;
-				Images::RGBImage::Color* ciPtr=dti.modifyPixels();
-				for(int y=0;y<dataItem->shadowBufferSize[1];++y)
-					for(int x=0;x<dataItem->shadowBufferSize[0];++x,++dtiPtr,++ciPtr)
-						{
-						GLColor<GLfloat,3> tc(*dtiPtr,*dtiPtr,*dtiPtr);
-						*ciPtr=tc;
-						}
-				delete[] depthTextureImage;
-				Images::writeImageFile(dti,"DepthImage.png");
-				}
-				#endif
-				
-				/* Dibuja la superficie usando la textura de la sombra: */
-				rs.surfaceRenderer->glRenderShadowedIlluminatedHeightMap(dataItem->heightColorMapObject,dataItem->shadowDepthTextureObject,shadowProjection,contextData);
-				}
-		
-		/* Restablecer el estado de OpenGL: */
-		glPopAttrib();
-		}
-	else
-	#endif
-		{
-		/* Render la superficie en una sola pasada: */
-		rs.surfaceRenderer->renderSinglePass(ds.viewport,projection,ds.modelviewNavigational,contextData);
+		/* Actualice el mapa de sombras del contexto solo si el terreno o la luz cambiaron, y páselo al renderizador de superficie: */
+		updateShadowMap(dataItem,ds,contextData);
+		rs.surfaceRenderer->setShadowMap(dataItem->shadowDepthTextureObject,dataItem->shadowTextureTransform,contextData);
 		}
 	
+	/* Render la superficie en una sola pasada: */
+	rs.surfaceRenderer->renderSinglePass(ds.viewport,projection,ds.modelviewNavigational,contextData);
+	
 	if(rs.waterRenderer!=0)
 		{
 		/* Dibuje la superficie del agua: */
@@ -22,6 +22,9 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 #ifndef SANDBOX_INCLUDED
 #define SANDBOX_INCLUDED
 
+#include <iosfwd>
+#include <string>
+#include <vector>
 #include <Threads/TripleBuffer.h>
 #include <Geometry/Box.h>
 #include <Geometry/Rotation.h>
@@ -49,6 +52,9 @@ template <class ParameterParam>
 class FunctionCall;
 }
 class GLContextData;
+namespace IO {
+class OStream;
+}
 namespace GLMotif {
 class PopupMenu;
 class PopupWindow;
@@ -56,17 +62,25 @@ class TextField;
 }
 namespace Vrui {
 class Lightsource;
+class DisplayState;
 }
 namespace Kinect {
 class Camera;
 }
+class DepthRecorder;
 class FrameFilter;
 class DepthImageRenderer;
 class ElevationColorMap;
 class DEM;
 class SurfaceRenderer;
 class WaterTable2;
+class DepressionFiller;
 class HandExtractor;
+class FlowAccumulator;
+class ContourGenerator;
+class DEMDeviation;
+class TimeLapseRecorder;
+class TimeLapseReader;
 typedef Misc::FunctionCall<GLContextData&> AddWaterFunction;
 class WaterRenderer;
 class HeightColorMapTool;
@@ -87,9 +101,15 @@ class Sandbox:public Vrui::Application,public GLObject
 		/* Elementos: */
 		public:
 		double waterTableTime; // Marca de tiempo de simulación de la capa freática en este contexto OpenGL
+		unsigned int equilibriumWaterLevelVersion; // Número de versión del nivel de agua en equilibrio cargado en la capa freática de este contexto OpenGL
 		GLsizei shadowBufferSize[2]; // Tamaño del búfer del marco de representación de sombras
 		GLuint shadowFramebufferObject; // Objeto de búfer de marco para representar mapas de sombra
 		GLuint shadowDepthTextureObject; // Textura de profundidad para el búfer del marco de renderizado de sombras
+		bool shadowMapValid; // Marcar si el mapa de sombras ya fue renderizado
+		unsigned int shadowDepthImageVersion; // Número de versión de la imagen de profundidad con la que se renderizó el mapa de sombras
+		GLfloat shadowLightPosition[4]; // Posición homogénea de la fuente de luz en el espacio de la cámara con la que se renderizó el mapa de sombras
+		PTransform shadowTextureTransform; // Transformación del espacio de la cámara al espacio de textura del mapa de sombras
+		unsigned int timeLapseWaterLevelVersion; // Número de versión de la cuadrícula de agua reproducida cargada en la capa freática de este contexto OpenGL
 		
 		/* Constructores y destructores: */
 		DataItem(void);
@@ -138,6 +158,7 @@ class Sandbox:public Vrui::Application,public GLObject
 	Kinect::FrameSource* camera; // El dispositivo de cámara Kinect
 	unsigned int frameSize[2]; // Ancho y alto de los marcos de profundidad de la cámara.
 	PixelDepthCorrection* pixelDepthCorrection; // Buffer de coeficientes de corrección de profundidad por píxel
+	DepthRecorder* depthRecorder; // Grabador opcional de los marcos de profundidad sin procesar de la cámara
 	Kinect::FrameSource::IntrinsicParameters cameraIps; // Parámetros intrínsecos de la cámara Kinect.
 	FrameFilter* frameFilter; // Procesamiento de objetos para filtrar fotogramas de profundidad sin procesar de la cámara Kinect
 	bool pauseUpdates; // Pausa las actualizaciones de la topografía.
@@ -153,12 +174,45 @@ class Sandbox:public Vrui::Application,public GLObject
 	double lavaSpeed; // Velocidad relativa de la simulación del flujo de lava.
 	unsigned int waterMaxSteps; // Número máximo de pasos de simulación de agua por cuadro
 	GLfloat rainStrength; // Cantidad de agua depositada por herramientas y objetos de lluvia en cada paso de simulación de agua
+	DepressionFiller* depressionFiller; // Objeto para calcular la superficie de agua en equilibrio de la batimetría actual
+	GLfloat* equilibriumBathymetry; // Buffer para la cuadrícula de batimetría leída para el relleno de equilibrio
+	bool equilibriumFillRequested; // Marcar si se solicitó un relleno de equilibrio que aún no tiene lectura de batimetría
+	bool equilibriumBathymetryPending; // Marcar si hay una lectura de batimetría pendiente para el relleno de equilibrio
+	unsigned int equilibriumWaterLevelVersion; // Número de versión del nivel de agua en equilibrio más reciente
 	HandExtractor* handExtractor; // Objeto para detectar manos extendidas sobre la superficie de arena para hacer que llueva
+	FlowAccumulator* flowAccumulator; // Objeto para calcular la red de ríos de la superficie de arena; se crea la primera vez que se habilita la red de ríos
+	bool drawRiverNetwork; // Marcar si la red de ríos se calcula y se dibuja sobre la superficie
+	unsigned int riverMinAccumulation,riverMaxAccumulation; // Rango de acumulación de flujo con el que se dibujan los ríos
+	unsigned int riverNumThreads; // Número de hilos de trabajo del acumulador de flujo
+	ContourGenerator* contourGenerator; // Objeto para extraer líneas de contorno vectoriales de la superficie de arena
+	bool useVectorContourLines; // Marcar si las líneas de contorno se extraen en la CPU y se dibujan como geometría en lugar de en el sombreador de superficie
+	bool useAnalyticContourLines; // Marcar si las líneas de contorno del sombreador se calculan a partir de las derivadas de la elevación en una sola pasada
+	bool reportShaderCompiles; // Marcar para informar del tiempo de compilación de cada variante del sombreador de superficie
+	double unitScale; // Factor de escala desde cm en la caja de arena hasta unidades de coordenadas mundiales
+	unsigned int waterStatisticsVersion; // Número de versión de la muestra de estadísticas del agua procesada más recientemente
+	IO::OStream* waterStatisticsLog; // Archivo opcional en el que registrar cada muestra de estadísticas del agua
+	TimeLapseRecorder* timeLapseRecorder; // Grabador opcional de lapso de tiempo de las cuadrículas de elevación y de agua
+	double timeLapseInterval; // Intervalo en segundos entre cuadros del lapso de tiempo
+	unsigned int timeLapseKeyframeInterval; // Número de cuadros del lapso de tiempo entre cuadros clave
+	bool timeLapseWater; // Marcar si el lapso de tiempo graba también la cuadrícula de agua
+	double nextTimeLapseTime; // Tiempo de aplicación del siguiente cuadro del lapso de tiempo
+	GLfloat* timeLapseWaterLevel; // Búfer para la lectura de la cuadrícula de agua del lapso de tiempo
+	bool timeLapseWaterPending; // Marcar si hay una lectura de la cuadrícula de agua pendiente para el lapso de tiempo
+	TimeLapseReader* timeLapseReader; // Lector opcional de un lapso de tiempo que reemplaza a la cámara
+	double timeLapseReplayStart; // Tiempo de aplicación del inicio de la reproducción del lapso de tiempo
+	unsigned int timeLapseReplayFrame; // Índice del cuadro del lapso de tiempo reproducido actualmente
+	unsigned int timeLapseWaterLevelVersion; // Número de versión de la cuadrícula de agua reproducida más reciente
+	std::vector<std::string> weatherCycle; // Secuencia de nombres de apariencias del agua que recorre el ciclo meteorológico
+	unsigned int weatherState; // Índice del estado actual del ciclo meteorológico
+	double weatherPeriod; // Duración en segundos de cada estado del ciclo meteorológico; 0 si el ciclo solo avanza por comandos
+	double nextWeatherTime; // Tiempo de aplicación del siguiente avance automático del ciclo meteorológico
 	const AddWaterFunction* addWaterFunction; // Función de procesamiento registrada con la capa freática
 	bool addWaterFunctionRegistered; // Marcar si la función de adición de agua está registrada actualmente en la capa freática
 	std::vector<RenderSettings> renderSettings; // Lista de configuraciones de representación por ventana
 	Vrui::Lightsource* sun; // Una fuente de luz fija externa
 	DEM* activeDem; // El DEM actualmente activo
+	DEMDeviation* demDeviation; // Objeto para calcular las estadísticas de desviación entre la superficie de arena y el DEM activo
+	unsigned int demStatisticsVersion; // Número de versión de las estadísticas de desviación mostradas más recientemente
 	GLMotif::PopupMenu* mainMenu;
 	GLMotif::ToggleButton* pauseUpdatesToggle;
 	GLMotif::ToggleButton* pauseUpdatesLine;
@@ -166,25 +220,44 @@ class Sandbox:public Vrui::Application,public GLObject
 	GLMotif::TextFieldSlider* waterSpeedSlider;
 	GLMotif::TextFieldSlider* waterMaxStepsSlider;
 	GLMotif::TextField* frameRateTextField;
+	GLMotif::TextField* waterVolumeTextField;
 	GLMotif::TextFieldSlider* waterAttenuationSlider;
+	GLMotif::PopupWindow* demMatchingDialog;
+	GLMotif::TextField* demRmsErrorTextField;
+	GLMotif::TextField* demCutVolumeTextField;
+	GLMotif::TextField* demFillVolumeTextField;
+	GLMotif::TextField* demScoreTextField;
+	std::vector<GLMotif::TextField*> demRegionScoreTextFields; // Campos de texto de las puntuaciones por región, empezando por la fila superior
 	int controlPipeFd; // Descriptor de archivo de una tubería con nombre opcional para enviar comandos de control a un AR Sandbox en ejecución
 	
 	/* Métodos privados:s */
 	void rawDepthFrameDispatcher(const Kinect::FrameBuffer& frameBuffer); // Devolución de llamada que recibe fotogramas de profundidad sin procesar de la cámara Kinect; los reenvía al filtro de marco y a los objetos de lluvia
 	void receiveFilteredFrame(const Kinect::FrameBuffer& frameBuffer); // Devolución de llamada que recibe marcos de profundidad filtrados del objeto de filtro
 	void toggleDEM(DEM* dem); // Establece o alterna el DEM actualmente activo
+	void setDrawRiverNetwork(bool newDrawRiverNetwork); // Habilita o deshabilita la red de ríos en todos los renderizadores de superficie, creando el acumulador de flujo la primera vez
+	void printWaterStatistics(std::ostream& os) const; // Escribe la muestra de estadísticas del agua más reciente en unidades de la caja de arena
+	void printDemStatistics(std::ostream& os) const; // Escribe las estadísticas de desviación respecto al DEM activo más recientes
+	bool setWaterAppearance(const char* appearanceName); // Cambia la apariencia del agua en todas las ventanas; devuelve falso si la apariencia no existe
+	void advanceWeather(void); // Avanza el ciclo meteorológico a su siguiente estado
+	void startTimeLapse(const char* fileName); // Empieza a grabar un lapso de tiempo en el archivo dado, reemplazando una grabación en curso
+	void stopTimeLapse(void); // Termina la grabación del lapso de tiempo en curso
+	void updateTimeLapse(void); // Graba o reproduce el siguiente cuadro del lapso de tiempo cuando corresponde
+	void updateShadowMap(DataItem* dataItem,const Vrui::DisplayState& ds,GLContextData& contextData) const; // Vuelve a renderizar el mapa de sombras del contexto si la imagen de profundidad o la fuente de luz cambiaron
 	void addWater(GLContextData& contextData); //const; // Función para renderizar geometría que agrega agua a la capa freática
 	void pauseUpdatesCallback(GLMotif::ToggleButton::ValueChangedCallbackData* cbData);
 	void pauseLineCallback(GLMotif::ToggleButton::ValueChangedCallbackData* cbData);
 	void lavaCallback(bool sLava);
 	void waterCallback(bool sWater);
 	void showWaterControlDialogCallback(Misc::CallbackData* cbData);
+	void showDemMatchingDialogCallback(Misc::CallbackData* cbData);
+	void fillToEquilibriumCallback(Misc::CallbackData* cbData);
 	void waterSpeedSliderCallback(GLMotif::TextFieldSlider::ValueChangedCallbackData* cbData);
 	void waterMaxStepsSliderCallback(GLMotif::TextFieldSlider::ValueChangedCallbackData* cbData);
 	void waterAttenuationSliderCallback(GLMotif::TextFieldSlider::ValueChangedCallbackData* cbData);
 	GLMotif::PopupMenu* createMainMenu(void);
 	GLMotif::PopupWindow* createWaterControlDialog(void);
-
+	GLMotif::PopupWindow* createDemMatchingDialog(const unsigned int numRegions[2]);
+	
 	void glutPostRedisplay(void);
 	
 	/* Constructores y destructores: */
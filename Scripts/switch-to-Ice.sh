@@ -3,7 +3,7 @@
 #   Script:  Switch-to-Ice.sh
 #   Script to switch from snow or lava to Ice
 #
-cd ~/src/SARndbox-2.3/share/SARndbox-2.3/Shaders
-echo 'Switching to Toxic Waste'
-cp SurfaceAddWaterColor-Ice.fs SurfaceAddWaterColor.fs
-cd ~/src/SARndbox-2.3
+# Switches the running AR Sandbox through its control pipe
+CONTROLPIPE=${SARNDBOX_CONTROLPIPE:-~/src/SARndbox-2.6.1/ControlPipe}
+echo 'Switching to Ice'
+echo "waterAppearance Ice" > $CONTROLPIPE
@@ -3,7 +3,7 @@
 #   Script:  Switch-to-PollutedWater.sh
 #   Script to switch from snow or lava to Polluted Water
 #
-cd ~/src/SARndbox-2.6.1/share/SARndbox-2.6.1/Shaders
+# Switches the running AR Sandbox through its control pipe
+CONTROLPIPE=${SARNDBOX_CONTROLPIPE:-~/src/SARndbox-2.6.1/ControlPipe}
 echo 'Switching to Polluted Water'
-cp SurfaceAddWaterColor-PollutedWater.fs SurfaceAddWaterColor.fs
-cd ~/src/SARndbox-2.3
+echo "waterAppearance PollutedWater" > $CONTROLPIPE
@@ -3,7 +3,7 @@
 #   Script:  Switch-to-SparklyIce.sh
 #   Script to switch from snow or lava to Sparkly Ice
 #
-cd ~/src/SARndbox-2.6.1/share/SARndbox-2.6.1/Shaders
+# Switches the running AR Sandbox through its control pipe
+CONTROLPIPE=${SARNDBOX_CONTROLPIPE:-~/src/SARndbox-2.6.1/ControlPipe}
 echo 'Switching to Sparkly Ice'
-cp SurfaceAddWaterColor-SparklyIce.fs SurfaceAddWaterColor.fs
-cd ~/src/SARndbox-2.6.1
+echo "waterAppearance SparklyIce" > $CONTROLPIPE
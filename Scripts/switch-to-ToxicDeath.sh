@@ -3,7 +3,7 @@
 #   Script:  Switch-to-waste.sh
 #   Script to switch from snow or lava to toxic waste
 #
-cd ~/src/SARndbox-2.6.1/share/SARndbox-2.6.1/Shaders
+# Switches the running AR Sandbox through its control pipe
+CONTROLPIPE=${SARNDBOX_CONTROLPIPE:-~/src/SARndbox-2.6.1/ControlPipe}
 echo 'Switching to Toxic Death'
-cp SurfaceAddWaterColor-ToxicDeath.fs SurfaceAddWaterColor.fs
-cd ~/src/SARndbox-2.6.1
+echo "waterAppearance ToxicDeath" > $CONTROLPIPE
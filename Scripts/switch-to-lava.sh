@@ -3,7 +3,7 @@
 #   Script:  Switch-to-lava.sh
 #   Script to switch from water or snow to lava
 #
-cd ~/src/SARndbox-2.6.1/share/SARndbox-2.6.1/Shaders
+# Switches the running AR Sandbox through its control pipe
+CONTROLPIPE=${SARNDBOX_CONTROLPIPE:-~/src/SARndbox-2.6.1/ControlPipe}
 echo 'Switching to Lava'
-cp SurfaceAddWaterColor-Lava.fs SurfaceAddWaterColor.fs
-cd ~/src/SARndbox-2.6.1
+echo "waterAppearance Lava" > $CONTROLPIPE
@@ -3,7 +3,7 @@
 #   Script:  Switch-to-snow.sh
 #   Script to switch from water or lava to snow
 #
-cd ~/src/SARndbox-2.6.1/share/SARndbox-2.6.1/Shaders
+# Switches the running AR Sandbox through its control pipe
+CONTROLPIPE=${SARNDBOX_CONTROLPIPE:-~/src/SARndbox-2.6.1/ControlPipe}
 echo 'Switching to Snow'
-cp SurfaceAddWaterColor-Snow.fs SurfaceAddWaterColor.fs
-cd ~/src/SARndbox-2.6.1
+echo "waterAppearance Snow" > $CONTROLPIPE
@@ -3,7 +3,7 @@
 #   Script:  Switch-to-water.sh
 #   Script to switch from snow or lava to water
 #
-cd ~/src/SARndbox-2.6.1/share/SARndbox-2.6.1/Shaders
+# Switches the running AR Sandbox through its control pipe
+CONTROLPIPE=${SARNDBOX_CONTROLPIPE:-~/src/SARndbox-2.6.1/ControlPipe}
 echo 'Switching to Water'
-cp SurfaceAddWaterColor-Water.fs SurfaceAddWaterColor.fs
-cd ~/src/SARndbox-2.6.1
+echo "waterAppearance Water" > $CONTROLPIPE
@@ -1,6 +1,6 @@
 /***********************************************************************
 ShaderHelper: Funciones de ayuda para crear sombreadores GLSL a partir 
-de archivos de texto.
+de archivos de texto, con una caché en disco de binarios de programas.
 Copyright (c) 2014 Oliver Kreylos
 
 This file is part of the Augmented Reality Sandbox (SARndbox).
@@ -22,50 +22,418 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 
 #include "ShaderHelper.h"
 
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <unistd.h>
 #include <string>
+#include <vector>
+#include <algorithm>
+#include <Misc/SizedTypes.h>
+#include <Misc/ThrowStdErr.h>
+#include <Threads/Mutex.h>
 #include <GL/gl.h>
+#include <GL/GLExtensionManager.h>
 #include <GL/Extensions/GLARBFragmentShader.h>
 #include <GL/Extensions/GLARBShaderObjects.h>
 #include <GL/Extensions/GLARBVertexShader.h>
 
 #include "Config.h"
 
-GLhandleARB compileVertexShader(const char* vertexShaderFileName)
+/* Constantes de GL_ARB_get_program_binary que pueden faltar en encabezados de OpenGL antiguos: */
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+namespace {
+
+/**************
+Helper classes:
+**************/
+
+struct ProgramBinaryHeader // Encabezado de un archivo de la caché de binarios de programas
+	{
+	/* Elementos: */
+	public:
+	char magic[16]; // Cadena de identificación del formato de archivo
+	Misc::UInt64 key; // Clave del programa, para detectar colisiones de nombres de archivo
+	Misc::UInt32 binaryFormat; // Formato del binario del programa devuelto por el controlador
+	Misc::UInt32 binaryLength; // Longitud del binario del programa en bytes
+	};
+
+/****************
+Helper functions:
+****************/
+
+static const char programBinaryMagic[16]="SARndboxProgBin"; // Cadena de identificación de los archivos de la caché
+Threads::Mutex shaderCacheMutex; // Mutex que protege el directorio y los archivos de la caché de binarios de programas
+std::string shaderCacheDirectory; // Directorio de la caché de binarios de programas; vacío si la caché está deshabilitada
+
+std::string getShaderFileName(const char* shaderFileName,const char* extension)
 	{
 	/* Construya el nombre completo del archivo de origen del sombreador: */
 	std::string fullShaderFileName=CONFIG_SHADERDIR;
 	fullShaderFileName.push_back('/');
-	fullShaderFileName.append(vertexShaderFileName);
-	fullShaderFileName.append(".vs");
+	fullShaderFileName.append(shaderFileName);
+	fullShaderFileName.append(extension);
+	return fullShaderFileName;
+	}
+
+std::string readShaderSource(const char* shaderFileName,const char* extension)
+	{
+	/* Abra el archivo de origen del sombreador: */
+	std::string fullShaderFileName=getShaderFileName(shaderFileName,extension);
+	FILE* file=fopen(fullShaderFileName.c_str(),"rb");
+	if(file==0)
+		Misc::throwStdErr("readShaderSource: Unable to open shader source file %s",fullShaderFileName.c_str());
+	
+	/* Lea el archivo completo: */
+	std::string result;
+	char buffer[4096];
+	size_t readSize;
+	while((readSize=fread(buffer,1,sizeof(buffer),file))!=0)
+		result.append(buffer,readSize);
+	fclose(file);
+	
+	return result;
+	}
+
+inline Misc::UInt64 hashBytes(Misc::UInt64 hash,const void* data,size_t size) // Acumula los bytes dados en un hash FNV-1a de 64 bits
+	{
+	const unsigned char* dPtr=static_cast<const unsigned char*>(data);
+	for(size_t i=0;i<size;++i,++dPtr)
+		{
+		hash^=Misc::UInt64(*dPtr);
+		hash*=0x100000001b3ULL;
+		}
+	return hash;
+	}
+
+std::string getTempFileName(const std::string& fileName) // Devuelve un nombre de archivo temporal junto al archivo dado, único entre procesos e hilos
+	{
+	static unsigned int tempFileCounter=0;
+	char suffix[40];
+	snprintf(suffix,sizeof(suffix),".%d.%u.tmp",int(getpid()),__atomic_fetch_add(&tempFileCounter,1U,__ATOMIC_RELAXED));
+	return fileName+suffix;
+	}
+
+bool createDirectories(const std::string& path) // Crea el directorio dado y todos sus directorios padre que falten
+	{
+	for(std::string::size_type slash=path.find('/',1);;slash=path.find('/',slash+1))
+		{
+		std::string prefix=path.substr(0,slash);
+		if(mkdir(prefix.c_str(),0755)!=0&&errno!=EEXIST)
+			return false;
+		if(slash==std::string::npos)
+			break;
+		}
+	return true;
+	}
+
+}
+
+/*********************************
+Methods of class ShaderSourceList:
+*********************************/
+
+GLhandleARB ShaderSourceList::compileAndLink(bool retrievable) const
+	{
+	/* Compila todos los sombreadores: */
+	std::vector<GLhandleARB> shaders;
+	try
+		{
+		for(std::vector<Source>::const_iterator sIt=sources.begin();sIt!=sources.end();++sIt)
+			{
+			if(sIt->shaderType==GL_VERTEX_SHADER_ARB)
+				shaders.push_back(glCompileVertexShaderFromString(sIt->source.c_str()));
+			else
+				shaders.push_back(glCompileFragmentShaderFromString(sIt->source.c_str()));
+			}
+		}
+	catch(...)
+		{
+		/* Libere los sombreadores ya compilados y vuelva a lanzar la excepción: */
+		for(std::vector<GLhandleARB>::iterator shIt=shaders.begin();shIt!=shaders.end();++shIt)
+			glDeleteObjectARB(*shIt);
+		throw;
+		}
+	
+	/* Cree el programa de sombreado y adjunte todos los sombreadores: */
+	GLhandleARB result=glCreateProgramObjectARB();
+	for(std::vector<GLhandleARB>::iterator shIt=shaders.begin();shIt!=shaders.end();++shIt)
+		glAttachObjectARB(result,*shIt);
+	
+	if(retrievable)
+		{
+		/* Pida al controlador que conserve el binario del programa para la caché: */
+		PFNGLPROGRAMPARAMETERIPROC glProgramParameteriProc=GLExtensionManager::getFunction<PFNGLPROGRAMPARAMETERIPROC>("glProgramParameteri");
+		if(glProgramParameteriProc!=0)
+			glProgramParameteriProc(result,GL_PROGRAM_BINARY_RETRIEVABLE_HINT,GL_TRUE);
+		}
+	
+	/* Enlace el programa de sombreado: */
+	glLinkProgramARB(result);
+	
+	/* Libere los sombreadores compilados (no se eliminarán hasta que se elimine el programa de sombreado): */
+	for(std::vector<GLhandleARB>::iterator shIt=shaders.begin();shIt!=shaders.end();++shIt)
+		glDeleteObjectARB(*shIt);
+	
+	/* Compruebe si el programa se enlazó correctamente: */
+	GLint linkStatus;
+	glGetObjectParameterivARB(result,GL_OBJECT_LINK_STATUS_ARB,&linkStatus);
+	if(!linkStatus)
+		{
+		/* Obtenga el registro de enlace y lance una excepción: */
+		GLcharARB linkLogBuffer[2048];
+		glGetInfoLogARB(result,sizeof(linkLogBuffer),0,linkLogBuffer);
+		glDeleteObjectARB(result);
+		Misc::throwStdErr("ShaderSourceList::link: Error \"%s\" while linking shader program",linkLogBuffer);
+		}
 	
+	return result;
+	}
+
+void ShaderSourceList::addVertexShader(const std::string& source)
+	{
+	sources.push_back(Source(GL_VERTEX_SHADER_ARB,source));
+	}
+
+void ShaderSourceList::addVertexShaderFile(const char* vertexShaderFileName)
+	{
+	sources.push_back(Source(GL_VERTEX_SHADER_ARB,readShaderSource(vertexShaderFileName,".vs")));
+	}
+
+void ShaderSourceList::addFragmentShader(const std::string& source)
+	{
+	sources.push_back(Source(GL_FRAGMENT_SHADER_ARB,source));
+	}
+
+void ShaderSourceList::addFragmentShaderFile(const char* fragmentShaderFileName)
+	{
+	sources.push_back(Source(GL_FRAGMENT_SHADER_ARB,readShaderSource(fragmentShaderFileName,".fs")));
+	}
+
+GLhandleARB ShaderSourceList::link(void) const
+	{
+	/* Compruebe si la caché de binarios de programas está habilitada: */
+	std::string cacheDirectory;
+	{
+	Threads::Mutex::Lock shaderCacheLock(shaderCacheMutex);
+	cacheDirectory=shaderCacheDirectory;
+	}
+	if(cacheDirectory.empty()||!GLExtensionManager::isExtensionSupported("GL_ARB_get_program_binary"))
+		return compileAndLink(false);
+	
+	/* Obtenga las funciones de binarios de programas y compruebe si el controlador admite algún formato binario: */
+	PFNGLGETPROGRAMIVPROC glGetProgramivProc=GLExtensionManager::getFunction<PFNGLGETPROGRAMIVPROC>("glGetProgramiv");
+	PFNGLGETPROGRAMBINARYPROC glGetProgramBinaryProc=GLExtensionManager::getFunction<PFNGLGETPROGRAMBINARYPROC>("glGetProgramBinary");
+	PFNGLPROGRAMBINARYPROC glProgramBinaryProc=GLExtensionManager::getFunction<PFNGLPROGRAMBINARYPROC>("glProgramBinary");
+	GLint numBinaryFormats=0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS,&numBinaryFormats);
+	if(glGetProgramivProc==0||glGetProgramBinaryProc==0||glProgramBinaryProc==0||numBinaryFormats<=0)
+		return compileAndLink(false);
+	
+	/* Calcule la clave del programa a partir del controlador y de los códigos fuente, incluidas las definiciones generadas: */
+	Misc::UInt64 key=0xcbf29ce484222325ULL;
+	static const GLenum driverStrings[4]={GL_VENDOR,GL_RENDERER,GL_VERSION,GL_SHADING_LANGUAGE_VERSION};
+	for(int i=0;i<4;++i)
+		{
+		const char* driverString=reinterpret_cast<const char*>(glGetString(driverStrings[i]));
+		if(driverString!=0)
+			key=hashBytes(key,driverString,strlen(driverString)+1);
+		}
+	for(std::vector<Source>::const_iterator sIt=sources.begin();sIt!=sources.end();++sIt)
+		{
+		Misc::UInt32 sourceHeader[2];
+		sourceHeader[0]=Misc::UInt32(sIt->shaderType);
+		sourceHeader[1]=Misc::UInt32(sIt->source.size());
+		key=hashBytes(key,sourceHeader,sizeof(sourceHeader));
+		key=hashBytes(key,sIt->source.data(),sIt->source.size());
+		}
+	char keyString[17];
+	snprintf(keyString,sizeof(keyString),"%016llx",(unsigned long long)key);
+	std::string cacheFileName=cacheDirectory;
+	cacheFileName.push_back('/');
+	cacheFileName.append(keyString);
+	cacheFileName.append(".bin");
+	
+	/* Intente cargar el binario del programa de la caché: */
+	ProgramBinaryHeader header;
+	std::vector<char> binary;
+	{
+	Threads::Mutex::Lock shaderCacheLock(shaderCacheMutex);
+	FILE* file=fopen(cacheFileName.c_str(),"rb");
+	if(file!=0)
+		{
+		/* Acepte solo entradas cuyo tamaño de archivo coincida con la longitud del binario, para que una entrada dañada o truncada sea un fallo de la caché: */
+		struct stat fileStat;
+		if(fread(&header,sizeof(ProgramBinaryHeader),1,file)==1&&memcmp(header.magic,programBinaryMagic,sizeof(programBinaryMagic))==0&&header.key==key&&header.binaryLength>0&&
+		   fstat(fileno(file),&fileStat)==0&&Misc::UInt64(fileStat.st_size)==Misc::UInt64(sizeof(ProgramBinaryHeader))+Misc::UInt64(header.binaryLength))
+			{
+			binary.resize(header.binaryLength);
+			if(fread(&binary[0],1,binary.size(),file)!=binary.size())
+				binary.clear();
+			}
+		fclose(file);
+		}
+	}
+	if(!binary.empty())
+		{
+		/* Cree el programa de sombreado a partir del binario: */
+		GLhandleARB result=glCreateProgramObjectARB();
+		glProgramBinaryProc(result,GLenum(header.binaryFormat),&binary[0],GLsizei(binary.size()));
+		GLint linkStatus=0;
+		glGetObjectParameterivARB(result,GL_OBJECT_LINK_STATUS_ARB,&linkStatus);
+		if(linkStatus)
+			return result;
+		
+		/* El controlador rechazó el binario; descártelo y vuelva a compilar: */
+		glDeleteObjectARB(result);
+		Threads::Mutex::Lock shaderCacheLock(shaderCacheMutex);
+		unlink(cacheFileName.c_str());
+		}
+	
+	/* Compile y enlace el programa a partir de los códigos fuente: */
+	GLhandleARB result=compileAndLink(true);
+	
+	/* Obtenga el binario del programa enlazado: */
+	GLint binaryLength=0;
+	glGetProgramivProc(result,GL_PROGRAM_BINARY_LENGTH,&binaryLength);
+	if(binaryLength>0)
+		{
+		binary.resize(binaryLength);
+		GLenum binaryFormat=0;
+		glGetProgramBinaryProc(result,binaryLength,&binaryLength,&binaryFormat,&binary[0]);
+		
+		/* Escriba el binario en un archivo temporal propio y muévalo a su lugar para que otros procesos nunca lean ni trunquen archivos incompletos: */
+		memcpy(header.magic,programBinaryMagic,sizeof(programBinaryMagic));
+		header.key=key;
+		header.binaryFormat=Misc::UInt32(binaryFormat);
+		header.binaryLength=Misc::UInt32(binaryLength);
+		std::string tempFileName=getTempFileName(cacheFileName);
+		Threads::Mutex::Lock shaderCacheLock(shaderCacheMutex);
+		FILE* file=fopen(tempFileName.c_str(),"wb");
+		if(file!=0)
+			{
+			bool ok=fwrite(&header,sizeof(ProgramBinaryHeader),1,file)==1&&fwrite(&binary[0],1,size_t(binaryLength),file)==size_t(binaryLength);
+			ok=fclose(file)==0&&ok;
+			if(!ok||rename(tempFileName.c_str(),cacheFileName.c_str())!=0)
+				unlink(tempFileName.c_str());
+			}
+		}
+	
+	return result;
+	}
+
+std::string readFragmentShaderSource(const char* fragmentShaderFileName)
+	{
+	return readShaderSource(fragmentShaderFileName,".fs");
+	}
+
+void findFragmentShaders(const char* prefix,std::vector<std::string>& suffixes)
+	{
+	/* Abra el directorio de sombreadores: */
+	DIR* directory=opendir(CONFIG_SHADERDIR);
+	if(directory==0)
+		Misc::throwStdErr("findFragmentShaders: Unable to open shader directory %s",CONFIG_SHADERDIR);
+	
+	/* Busque todos los archivos de sombreadores de fragmentos que comienzan con el prefijo: */
+	std::vector<std::string> newSuffixes;
+	size_t prefixLength=strlen(prefix);
+	struct dirent* entry;
+	while((entry=readdir(directory))!=0)
+		{
+		size_t nameLength=strlen(entry->d_name);
+		if(nameLength>prefixLength+3&&strncmp(entry->d_name,prefix,prefixLength)==0&&strcmp(entry->d_name+nameLength-3,".fs")==0)
+			newSuffixes.push_back(std::string(entry->d_name+prefixLength,entry->d_name+nameLength-3));
+		}
+	closedir(directory);
+	
+	/* Agregue los sufijos en orden alfabético: */
+	std::sort(newSuffixes.begin(),newSuffixes.end());
+	suffixes.insert(suffixes.end(),newSuffixes.begin(),newSuffixes.end());
+	}
+
+void setShaderCacheDirectory(const std::string& newShaderCacheDirectory)
+	{
+	Threads::Mutex::Lock shaderCacheLock(shaderCacheMutex);
+	
+	/* Cree el directorio de la caché si aún no existe; deshabilite la caché si no es posible: */
+	shaderCacheDirectory.clear();
+	if(!newShaderCacheDirectory.empty())
+		{
+		if(createDirectories(newShaderCacheDirectory))
+			shaderCacheDirectory=newShaderCacheDirectory;
+		else
+			Misc::throwStdErr("setShaderCacheDirectory: Unable to create shader cache directory %s",newShaderCacheDirectory.c_str());
+		}
+	}
+
+void invalidateShaderCache(void)
+	{
+	Threads::Mutex::Lock shaderCacheLock(shaderCacheMutex);
+	if(shaderCacheDirectory.empty())
+		return;
+	
+	/* Elimine todos los archivos de binarios de programas del directorio de la caché: */
+	DIR* directory=opendir(shaderCacheDirectory.c_str());
+	if(directory==0)
+		return;
+	struct dirent* entry;
+	while((entry=readdir(directory))!=0)
+		{
+		size_t nameLength=strlen(entry->d_name);
+		if(nameLength>4&&strcmp(entry->d_name+nameLength-4,".bin")==0)
+			{
+			std::string fileName=shaderCacheDirectory;
+			fileName.push_back('/');
+			fileName.append(entry->d_name);
+			unlink(fileName.c_str());
+			}
+		}
+	closedir(directory);
+	}
+
+GLhandleARB compileVertexShader(const char* vertexShaderFileName)
+	{
 	/* Compila y devuelve el sombreador de vértices: */
-	return glCompileVertexShaderFromFile(fullShaderFileName.c_str());
+	return glCompileVertexShaderFromFile(getShaderFileName(vertexShaderFileName,".vs").c_str());
 	}
 
 GLhandleARB compileFragmentShader(const char* fragmentShaderFileName)
 	{
-	/* Construya el nombre completo del archivo de origen del sombreador: */
-	std::string fullShaderFileName=CONFIG_SHADERDIR;
-	fullShaderFileName.push_back('/');
-	fullShaderFileName.append(fragmentShaderFileName);
-	fullShaderFileName.append(".fs");
-	
 	/* Compila y devuelve el fragmento shader: */
-	return glCompileFragmentShaderFromFile(fullShaderFileName.c_str());
+	return glCompileFragmentShaderFromFile(getShaderFileName(fragmentShaderFileName,".fs").c_str());
 	}
 
 GLhandleARB linkVertexAndFragmentShader(const char* shaderFileName)
 	{
-	/* Compila los sombreadores de vértices y fragmentos: */
-	GLhandleARB vertexShader=compileVertexShader(shaderFileName);
-	GLhandleARB fragmentShader=compileFragmentShader(shaderFileName);
+	/* Reúna los códigos fuente de los sombreadores de vértices y fragmentos: */
+	ShaderSourceList sources;
+	sources.addVertexShaderFile(shaderFileName);
+	sources.addFragmentShaderFile(shaderFileName);
 	
-	/* Enlace el programa de sombreado: */
-	GLhandleARB shaderProgram=glLinkShader(vertexShader,fragmentShader);
-	
-	/* Libere los sombreadores compilados (no se eliminarán hasta que se lance el programa de sombreado): */
-	glDeleteObjectARB(vertexShader);
-	glDeleteObjectARB(fragmentShader);
+	/* Cargue o enlace el programa de sombreado: */
+	return sources.link();
+	}
+
+GLhandleARB linkVertexSourceAndFragmentShader(const char* vertexShaderSource,const char* fragmentShaderFileName)
+	{
+	/* Reúna los códigos fuente de los sombreadores de vértices y fragmentos: */
+	ShaderSourceList sources;
+	sources.addVertexShader(vertexShaderSource);
+	sources.addFragmentShaderFile(fragmentShaderFileName);
 	
-	return shaderProgram;
+	/* Cargue o enlace el programa de sombreado: */
+	return sources.link();
 	}
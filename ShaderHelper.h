@@ -1,6 +1,6 @@
 /***********************************************************************
 ShaderHelper: Funciones de ayuda para crear sombreadores GLSL a partir 
-de archivos de texto.
+de archivos de texto, con una caché en disco de binarios de programas.
 Copyright (c) 2014 Oliver Kreylos
 
 This file is part of the Augmented Reality Sandbox (SARndbox).
@@ -23,11 +23,51 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 #ifndef SHADERHELPER_INCLUDED
 #define SHADERHELPER_INCLUDED
 
+#include <string>
+#include <vector>
 #include <GL/gl.h>
 #include <GL/Extensions/GLARBShaderObjects.h>
 
+class ShaderSourceList // Clase para reunir los códigos fuente de todos los sombreadores de un programa antes de compilarlos, de modo que el programa pueda cargarse de la caché de binarios de programas
+	{
+	/* Clases integradas: */
+	private:
+	struct Source // Estructura para el código fuente de un sombreador
+		{
+		/* Elementos: */
+		public:
+		GLenum shaderType; // Tipo de sombreador, GL_VERTEX_SHADER_ARB o GL_FRAGMENT_SHADER_ARB
+		std::string source; // Código fuente completo del sombreador
+		
+		/* Constructores y destructores: */
+		Source(GLenum sShaderType,const std::string& sSource)
+			:shaderType(sShaderType),source(sSource)
+			{
+			}
+		};
+	
+	/* Elementos: */
+	std::vector<Source> sources; // Lista de los códigos fuente de los sombreadores en orden de compilación
+	
+	/* Métodos privados: */
+	GLhandleARB compileAndLink(bool retrievable) const; // Compila y enlaza todos los sombreadores; marca el programa como recuperable para la caché si se solicita
+	
+	/* Métodos: */
+	public:
+	void addVertexShader(const std::string& source); // Agrega un sombreador de vértices a partir de su código fuente
+	void addVertexShaderFile(const char* vertexShaderFileName); // Agrega un sombreador de vértices a partir del archivo fuente dado en el directorio de sombreadores de SARndbox
+	void addFragmentShader(const std::string& source); // Agrega un sombreador de fragmentos a partir de su código fuente
+	void addFragmentShaderFile(const char* fragmentShaderFileName); // Agrega un sombreador de fragmentos a partir del archivo fuente dado en el directorio de sombreadores de SARndbox
+	GLhandleARB link(void) const; // Devuelve un identificador a un programa de sombreador cargado de la caché de binarios de programas o, si no está allí, compilado y enlazado a partir de los códigos fuente
+	};
+
+std::string readFragmentShaderSource(const char* fragmentShaderFileName); // Devuelve el código fuente del archivo de sombreador de fragmentos dado en el directorio de sombreadores de SARndbox
+void findFragmentShaders(const char* prefix,std::vector<std::string>& suffixes); // Agrega a la lista, en orden alfabético, los sufijos de los nombres de todos los archivos de sombreadores de fragmentos del directorio de sombreadores de SARndbox que comienzan con el prefijo dado
+void setShaderCacheDirectory(const std::string& newShaderCacheDirectory); // Establece el directorio de la caché de binarios de programas en disco; una cadena vacía deshabilita la caché
+void invalidateShaderCache(void); // Elimina todos los binarios de programas de la caché en disco
 GLhandleARB compileVertexShader(const char* vertexShaderFileName); // Devuelve un identificador a un sombreador de vértices compilado a partir del archivo fuente dado en el directorio de sombreadores de SARndbox
 GLhandleARB compileFragmentShader(const char* fragmentShaderFileName); // Devuelve un identificador a un sombreador de fragmentos compilado del archivo fuente dado en el directorio de sombreadores de SARndbox
 GLhandleARB linkVertexAndFragmentShader(const char* shaderFileName); // Devuelve un identificador a un programa de sombreador vinculado desde un sombreador de vértices y un sombreador de fragmentos compilado a partir de los archivos fuente dados en el directorio de sombreadores de SARndbox
+GLhandleARB linkVertexSourceAndFragmentShader(const char* vertexShaderSource,const char* fragmentShaderFileName); // Devuelve un identificador a un programa de sombreador vinculado desde un sombreador de vértices con el código fuente dado y un sombreador de fragmentos compilado a partir del archivo fuente dado en el directorio de sombreadores de SARndbox
 
 #endif
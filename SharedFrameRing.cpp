@@ -0,0 +1,516 @@
+/***********************************************************************
+SharedFrameRing - Clase para un anillo de marcos de profundidad sin
+procesar en memoria compartida POSIX, escrito sin bloqueos por un único
+demonio de captura y leído por cualquier número de procesos locales.
+Copyright (c) 2026 Sergio081096
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include "SharedFrameRing.h"
+
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/file.h>
+#ifdef __linux__
+#include <limits.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
+#include <new>
+#include <Misc/ThrowStdErr.h>
+
+/***********************************************************************
+Disposición del segmento de memoria compartida, en el orden de bytes del
+anfitrión:
+- Encabezado: identificador, versión, tamaño de los marcos, número de
+  ranuras, tamaños de los tipos de parámetros de la cámara, posición de
+  cada área, y los contadores compartidos: generación, contador de marcos
+  y número de secuencia del marco publicado más reciente.
+- Parámetros intrínsecos y extrínsecos y rango de profundidad de la
+  cámara, copiados como objetos; el demonio y los lectores se compilan
+  contra el mismo paquete Kinect, y los tamaños del encabezado lo
+  comprueban.
+- Factores de corrección de profundidad por píxel, evaluados por el
+  demonio en la cuadrícula de píxeles del marco.
+- Las ranuras de marco, cada una con un número de secuencia, una marca
+  de tiempo y los píxeles de profundidad sin procesar.
+La generación es un bloqueo de secuencia para los parámetros: es impar
+mientras un demonio se inicializa, y cambia cada vez que uno se reinicia.
+Cada ranura es un bloqueo de secuencia para su marco: el escritor borra
+su número de secuencia, copia el marco, y escribe el nuevo número; un
+lector copia el marco y lo descarta si el número cambió mientras tanto.
+Los lectores solo mapean el segmento para leer, por lo que no afectan al
+escritor ni entre sí.
+***********************************************************************/
+
+namespace {
+
+/**************
+Helper objects:
+**************/
+
+const Misc::UInt32 ringMagic=0x53524E47U; // Identificador de un segmento inicializado
+const Misc::UInt32 ringVersion=1;
+const size_t alignment=64; // Alineación de las áreas del segmento a líneas de caché
+
+/****************
+Helper functions:
+****************/
+
+size_t align(size_t offset)
+	{
+	return (offset+alignment-1)&~(alignment-1);
+	}
+
+double getTime(void)
+	{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC,&now);
+	return double(now.tv_sec)+double(now.tv_nsec)/1.0e9;
+	}
+
+void sleepFor(double seconds)
+	{
+	usleep(useconds_t(seconds*1.0e6));
+	}
+
+void waitOnCounter(const Misc::UInt32* counter,Misc::UInt32 value,double timeout)
+	{
+	#ifdef __linux__
+	/* Espera en el futex compartido del contador hasta que el escritor lo incremente: */
+	struct timespec ts;
+	ts.tv_sec=time_t(timeout);
+	ts.tv_nsec=long((timeout-double(ts.tv_sec))*1.0e9);
+	syscall(SYS_futex,const_cast<Misc::UInt32*>(counter),FUTEX_WAIT,value,&ts,0,0);
+	#else
+	/* Sondear el contador a intervalos cortos: */
+	if(__atomic_load_n(counter,__ATOMIC_ACQUIRE)==value)
+		sleepFor(timeout<0.001?timeout:0.001);
+	#endif
+	}
+
+void wakeCounter(Misc::UInt32* counter)
+	{
+	#ifdef __linux__
+	syscall(SYS_futex,counter,FUTEX_WAKE,INT_MAX,0,0,0);
+	#endif
+	}
+
+/**************
+Helper classes:
+**************/
+
+struct RingLayout // Estructura con la posición y el tamaño de las áreas del segmento
+	{
+	/* Elementos: */
+	public:
+	size_t parameterOffsets[3]; // Posiciones de los parámetros intrínsecos, extrínsecos y del rango de profundidad
+	size_t pixelCorrectionOffset; // Posición de los factores de corrección de profundidad por píxel
+	size_t slotsOffset; // Posición de la primera ranura de marco
+	size_t slotStride; // Distancia entre ranuras de marco consecutivas
+	size_t segmentSize; // Tamaño total del segmento
+	
+	/* Constructores y destructores: */
+	RingLayout(size_t headerSize,size_t slotHeaderSize,const unsigned int frameSize[2],unsigned int numSlots)
+		{
+		size_t numPixels=size_t(frameSize[1])*size_t(frameSize[0]);
+		parameterOffsets[0]=align(headerSize);
+		parameterOffsets[1]=align(parameterOffsets[0]+sizeof(SharedFrameRing::IntrinsicParameters));
+		parameterOffsets[2]=align(parameterOffsets[1]+sizeof(SharedFrameRing::ExtrinsicParameters));
+		pixelCorrectionOffset=align(parameterOffsets[2]+sizeof(SharedFrameRing::DepthRange));
+		slotsOffset=align(pixelCorrectionOffset+numPixels*sizeof(SharedFrameRing::PixelCorrection));
+		slotStride=align(slotHeaderSize+numPixels*sizeof(SharedFrameRing::DepthPixel));
+		segmentSize=slotsOffset+size_t(numSlots)*slotStride;
+		}
+	};
+
+}
+
+/*********************************************
+Declaration of struct SharedFrameRing::Header:
+*********************************************/
+
+struct SharedFrameRing::Header
+	{
+	/* Elementos: */
+	public:
+	Misc::UInt32 magic; // Identificador; se escribe al final de la inicialización del segmento
+	Misc::UInt32 version; // Versión de la disposición del segmento
+	Misc::UInt32 frameSize[2]; // Ancho y alto de los marcos de profundidad
+	Misc::UInt32 numSlots; // Número de ranuras de marco
+	Misc::UInt32 typeSizes[4]; // Tamaños de los tipos de parámetros y de corrección por píxel con los que se compiló el demonio
+	Misc::UInt32 hasPixelCorrection; // Indicador de si la cámara proporciona corrección de profundidad por píxel
+	Misc::UInt64 segmentSize; // Tamaño total del segmento
+	char padding[16]; // Relleno para separar los contadores compartidos en su propia línea de caché
+	Misc::UInt32 generation; // Bloqueo de secuencia de los parámetros; impar mientras un demonio se inicializa
+	Misc::UInt32 frameCounter; // Contador de marcos publicados, en el que esperan los lectores
+	Misc::UInt64 publishedSequence; // Número de secuencia del marco publicado más reciente, o 0
+	};
+
+/*************************************************
+Declaration of struct SharedFrameRing::SlotHeader:
+*************************************************/
+
+struct SharedFrameRing::SlotHeader
+	{
+	/* Elementos: */
+	public:
+	Misc::UInt64 sequence; // Número de secuencia del marco en la ranura, o 0 mientras se escribe
+	double timeStamp; // Marca de tiempo del marco
+	};
+
+/********************************
+Methods of class SharedFrameRing:
+********************************/
+
+SharedFrameRing::SlotHeader* SharedFrameRing::getSlot(Misc::UInt64 sequence) const
+	{
+	RingLayout layout(sizeof(Header),sizeof(SlotHeader),frameSize,numSlots);
+	return reinterpret_cast<SlotHeader*>(segment+layout.slotsOffset+size_t(sequence%numSlots)*layout.slotStride);
+	}
+
+void SharedFrameRing::lockWriter(void)
+	{
+	/* Tomar un bloqueo exclusivo sobre el segmento, que se libera al cerrar el descriptor: */
+	if(flock(fd,LOCK_EX|LOCK_NB)!=0)
+		{
+		int error=errno;
+		close(fd);
+		fd=-1;
+		if(error==EWOULDBLOCK)
+			Misc::throwStdErr("SharedFrameRing: Shared memory segment %s is already in use by another capture daemon",name.c_str());
+		else
+			Misc::throwStdErr("SharedFrameRing: Unable to lock shared memory segment %s due to error %d (%s)",name.c_str(),error,strerror(error));
+		}
+	}
+
+void SharedFrameRing::unmap(void)
+	{
+	if(segment!=0)
+		munmap(segment,segmentSize);
+	segment=0;
+	header=0;
+	if(fd>=0)
+		close(fd);
+	fd=-1;
+	}
+
+SharedFrameRing::SharedFrameRing(const char* sName,const unsigned int sFrameSize[2],unsigned int sNumSlots)
+	:name(sName[0]=='/'?"":"/"),
+	 fd(-1),segment(0),segmentSize(0),header(0),
+	 numSlots(sNumSlots),nextSequence(1)
+	{
+	name.append(sName);
+	for(int i=0;i<2;++i)
+		frameSize[i]=sFrameSize[i];
+	if(numSlots<2)
+		Misc::throwStdErr("SharedFrameRing: Shared memory segment %s needs at least two frame slots",name.c_str());
+	RingLayout layout(sizeof(Header),sizeof(SlotHeader),frameSize,numSlots);
+	segmentSize=layout.segmentSize;
+	Misc::UInt32 typeSizes[4]={sizeof(IntrinsicParameters),sizeof(ExtrinsicParameters),sizeof(DepthRange),sizeof(PixelCorrection)};
+	
+	/* Intentar reutilizar el segmento de un demonio anterior, para que los lectores conectados sigan recibiendo marcos: */
+	fd=shm_open(name.c_str(),O_RDWR,0);
+	if(fd>=0)
+		{
+		/* Tomar el segmento para este escritor; un demonio que todavía lo usa conserva su bloqueo: */
+		lockWriter();
+		
+		struct stat segmentStat;
+		if(fstat(fd,&segmentStat)==0&&size_t(segmentStat.st_size)==segmentSize)
+			{
+			void* map=mmap(0,segmentSize,PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+			if(map!=MAP_FAILED)
+				{
+				segment=static_cast<unsigned char*>(map);
+				header=reinterpret_cast<Header*>(segment);
+				}
+			}
+		if(header!=0&&__atomic_load_n(&header->magic,__ATOMIC_ACQUIRE)==ringMagic&&header->version==ringVersion&&header->segmentSize==segmentSize&&header->frameSize[0]==frameSize[0]&&header->frameSize[1]==frameSize[1]&&header->numSlots==numSlots&&memcmp(header->typeSizes,typeSizes,sizeof(typeSizes))==0)
+			{
+			/* Continuar la secuencia de marcos y abrir una nueva generación impar: */
+			nextSequence=__atomic_load_n(&header->publishedSequence,__ATOMIC_ACQUIRE)+1;
+			if((__atomic_load_n(&header->generation,__ATOMIC_ACQUIRE)&0x1U)==0x0U)
+				__atomic_add_fetch(&header->generation,1U,__ATOMIC_ACQ_REL);
+			return;
+			}
+		
+		/* Desechar el segmento incompatible: */
+		unmap();
+		segmentSize=layout.segmentSize;
+		}
+	
+	/* Crear un segmento nuevo; los lectores del segmento anterior lo detectan como reemplazado: */
+	shm_unlink(name.c_str());
+	fd=shm_open(name.c_str(),O_RDWR|O_CREAT|O_EXCL,0644);
+	if(fd<0)
+		Misc::throwStdErr("SharedFrameRing: Unable to create shared memory segment %s due to error %d (%s)",name.c_str(),errno,strerror(errno));
+	lockWriter();
+	if(ftruncate(fd,off_t(segmentSize))!=0)
+		{
+		int error=errno;
+		close(fd);
+		shm_unlink(name.c_str());
+		Misc::throwStdErr("SharedFrameRing: Unable to resize shared memory segment %s due to error %d (%s)",name.c_str(),error,strerror(error));
+		}
+	void* map=mmap(0,segmentSize,PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+	if(map==MAP_FAILED)
+		{
+		int error=errno;
+		close(fd);
+		shm_unlink(name.c_str());
+		Misc::throwStdErr("SharedFrameRing: Unable to map shared memory segment %s due to error %d (%s)",name.c_str(),error,strerror(error));
+		}
+	segment=static_cast<unsigned char*>(map);
+	header=reinterpret_cast<Header*>(segment);
+	
+	/* Inicializar el encabezado; el segmento recién creado está lleno de ceros: */
+	header->version=ringVersion;
+	for(int i=0;i<2;++i)
+		header->frameSize[i]=frameSize[i];
+	header->numSlots=numSlots;
+	memcpy(header->typeSizes,typeSizes,sizeof(typeSizes));
+	header->hasPixelCorrection=0;
+	header->segmentSize=segmentSize;
+	header->generation=1U;
+	header->frameCounter=0U;
+	header->publishedSequence=0;
+	__atomic_store_n(&header->magic,ringMagic,__ATOMIC_RELEASE);
+	}
+
+SharedFrameRing::SharedFrameRing(const char* sName,double timeout)
+	:name(sName[0]=='/'?"":"/"),
+	 fd(-1),segment(0),segmentSize(0),header(0),
+	 numSlots(0),nextSequence(0)
+	{
+	name.append(sName);
+	frameSize[0]=frameSize[1]=0;
+	
+	/* Esperar a que un demonio de captura cree e inicialice el segmento: */
+	double deadline=getTime()+timeout;
+	while(true)
+		{
+		fd=shm_open(name.c_str(),O_RDONLY,0);
+		if(fd<0&&errno!=ENOENT)
+			Misc::throwStdErr("SharedFrameRing: Unable to open shared memory segment %s due to error %d (%s)",name.c_str(),errno,strerror(errno));
+		if(fd>=0)
+			{
+			struct stat segmentStat;
+			if(fstat(fd,&segmentStat)==0&&size_t(segmentStat.st_size)>=sizeof(Header))
+				{
+				segmentSize=size_t(segmentStat.st_size);
+				void* map=mmap(0,segmentSize,PROT_READ,MAP_SHARED,fd,0);
+				if(map==MAP_FAILED)
+					{
+					int error=errno;
+					close(fd);
+					Misc::throwStdErr("SharedFrameRing: Unable to map shared memory segment %s due to error %d (%s)",name.c_str(),error,strerror(error));
+					}
+				segment=static_cast<unsigned char*>(map);
+				header=reinterpret_cast<Header*>(segment);
+				if(__atomic_load_n(&header->magic,__ATOMIC_ACQUIRE)==ringMagic)
+					break;
+				munmap(segment,segmentSize);
+				segment=0;
+				header=0;
+				}
+			close(fd);
+			fd=-1;
+			}
+		
+		if(getTime()>=deadline)
+			Misc::throwStdErr("SharedFrameRing: No capture daemon initialized shared memory segment %s within %.1f s",name.c_str(),timeout);
+		sleepFor(0.05);
+		}
+	
+	/* Comprobar la disposición del segmento: */
+	std::string error;
+	Misc::UInt32 typeSizes[4]={sizeof(IntrinsicParameters),sizeof(ExtrinsicParameters),sizeof(DepthRange),sizeof(PixelCorrection)};
+	if(header->version!=ringVersion)
+		error="has an unsupported layout version";
+	else if(memcmp(header->typeSizes,typeSizes,sizeof(typeSizes))!=0)
+		error="was written by a capture daemon built against a different Kinect package";
+	else
+		{
+		for(int i=0;i<2;++i)
+			frameSize[i]=header->frameSize[i];
+		numSlots=header->numSlots;
+		RingLayout layout(sizeof(Header),sizeof(SlotHeader),frameSize,numSlots);
+		if(numSlots<2||header->segmentSize!=layout.segmentSize||segmentSize<layout.segmentSize)
+			error="is truncated or corrupted";
+		}
+	if(!error.empty())
+		{
+		unmap();
+		Misc::throwStdErr("SharedFrameRing: Shared memory segment %s %s",name.c_str(),error.c_str());
+		}
+	}
+
+SharedFrameRing::~SharedFrameRing(void)
+	{
+	/* El segmento sobrevive al demonio, para que un demonio reiniciado pueda reutilizarlo: */
+	unmap();
+	}
+
+void SharedFrameRing::publishParameters(const SharedFrameRing::IntrinsicParameters& ips,const SharedFrameRing::ExtrinsicParameters& eps,const SharedFrameRing::DepthRange& depthRange,const SharedFrameRing::PixelCorrection* pixelCorrection)
+	{
+	/* Copiar los parámetros mientras la generación es impar, sobre un área a cero para que los lectores puedan comparar sus bytes sin procesar: */
+	RingLayout layout(sizeof(Header),sizeof(SlotHeader),frameSize,numSlots);
+	memset(segment+layout.parameterOffsets[0],0,layout.pixelCorrectionOffset-layout.parameterOffsets[0]);
+	new(segment+layout.parameterOffsets[0]) IntrinsicParameters(ips);
+	new(segment+layout.parameterOffsets[1]) ExtrinsicParameters(eps);
+	new(segment+layout.parameterOffsets[2]) DepthRange(depthRange);
+	size_t numPixels=size_t(frameSize[1])*size_t(frameSize[0]);
+	if(pixelCorrection!=0)
+		memcpy(segment+layout.pixelCorrectionOffset,pixelCorrection,numPixels*sizeof(PixelCorrection));
+	header->hasPixelCorrection=pixelCorrection!=0?1U:0U;
+	
+	/* Marcar el anillo como listo: */
+	__atomic_add_fetch(&header->generation,1U,__ATOMIC_RELEASE);
+	}
+
+void SharedFrameRing::publishFrame(const SharedFrameRing::DepthPixel* depth,double timeStamp)
+	{
+	/* Invalidar la ranura antes de sobrescribirla: */
+	SlotHeader* slot=getSlot(nextSequence);
+	__atomic_store_n(&slot->sequence,Misc::UInt64(0),__ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	
+	/* Copiar el marco: */
+	memcpy(slot+1,depth,size_t(frameSize[1])*size_t(frameSize[0])*sizeof(DepthPixel));
+	slot->timeStamp=timeStamp;
+	
+	/* Publicar el marco y despertar a los lectores en espera: */
+	__atomic_store_n(&slot->sequence,nextSequence,__ATOMIC_RELEASE);
+	__atomic_store_n(&header->publishedSequence,nextSequence,__ATOMIC_RELEASE);
+	__atomic_add_fetch(&header->frameCounter,1U,__ATOMIC_RELEASE);
+	wakeCounter(&header->frameCounter);
+	++nextSequence;
+	}
+
+Misc::UInt32 SharedFrameRing::getGeneration(void) const
+	{
+	return __atomic_load_n(&header->generation,__ATOMIC_ACQUIRE);
+	}
+
+void SharedFrameRing::getParameters(SharedFrameRing::IntrinsicParameters& ips,SharedFrameRing::ExtrinsicParameters& eps,SharedFrameRing::DepthRange& depthRange,SharedFrameRing::PixelCorrection* pixelCorrection,double timeout,std::vector<Misc::UInt8>* parameterBytes) const
+	{
+	RingLayout layout(sizeof(Header),sizeof(SlotHeader),frameSize,numSlots);
+	size_t numPixels=size_t(frameSize[1])*size_t(frameSize[0]);
+	double deadline=getTime()+timeout;
+	while(true)
+		{
+		/* Copiar los parámetros si ningún demonio se está inicializando: */
+		Misc::UInt32 generation=__atomic_load_n(&header->generation,__ATOMIC_ACQUIRE);
+		if((generation&0x1U)==0x0U)
+			{
+			ips=*reinterpret_cast<const IntrinsicParameters*>(segment+layout.parameterOffsets[0]);
+			eps=*reinterpret_cast<const ExtrinsicParameters*>(segment+layout.parameterOffsets[1]);
+			depthRange=*reinterpret_cast<const DepthRange*>(segment+layout.parameterOffsets[2]);
+			if(pixelCorrection!=0)
+				{
+				if(header->hasPixelCorrection!=0U)
+					memcpy(pixelCorrection,segment+layout.pixelCorrectionOffset,numPixels*sizeof(PixelCorrection));
+				else
+					{
+					/* Crear factores de corrección neutros: */
+					for(size_t i=0;i<numPixels;++i)
+						{
+						pixelCorrection[i].scale=1.0f;
+						pixelCorrection[i].offset=0.0f;
+						}
+					}
+				}
+			if(parameterBytes!=0)
+				{
+				/* Copiar los parámetros tal como están en el segmento, seguidos del indicador y de la corrección por píxel si la hay: */
+				size_t parameterSize=layout.pixelCorrectionOffset-layout.parameterOffsets[0];
+				Misc::UInt32 hasPixelCorrection=header->hasPixelCorrection;
+				size_t correctionSize=hasPixelCorrection!=0U?numPixels*sizeof(PixelCorrection):0;
+				parameterBytes->resize(parameterSize+sizeof(Misc::UInt32)+correctionSize);
+				Misc::UInt8* pbPtr=&(*parameterBytes)[0];
+				memcpy(pbPtr,segment+layout.parameterOffsets[0],parameterSize);
+				memcpy(pbPtr+parameterSize,&hasPixelCorrection,sizeof(Misc::UInt32));
+				if(correctionSize!=0)
+					memcpy(pbPtr+parameterSize+sizeof(Misc::UInt32),segment+layout.pixelCorrectionOffset,correctionSize);
+				}
+			
+			/* Aceptar la copia si la generación no cambió mientras tanto: */
+			__atomic_thread_fence(__ATOMIC_ACQUIRE);
+			if(__atomic_load_n(&header->generation,__ATOMIC_RELAXED)==generation)
+				return;
+			}
+		
+		if(getTime()>=deadline)
+			Misc::throwStdErr("SharedFrameRing: Capture daemon did not finish initializing shared memory segment %s within %.1f s",name.c_str(),timeout);
+		sleepFor(0.01);
+		}
+	}
+
+Misc::UInt64 SharedFrameRing::getPublishedSequence(void) const
+	{
+	return __atomic_load_n(&header->publishedSequence,__ATOMIC_ACQUIRE);
+	}
+
+bool SharedFrameRing::waitForFrame(Misc::UInt64 lastSequence,double timeout) const
+	{
+	double deadline=getTime()+timeout;
+	while(true)
+		{
+		/* Leer el contador antes del número de secuencia para no perder un aviso del escritor: */
+		Misc::UInt32 counter=__atomic_load_n(&header->frameCounter,__ATOMIC_ACQUIRE);
+		if(getPublishedSequence()!=lastSequence)
+			return true;
+		double remaining=deadline-getTime();
+		if(remaining<=0.0)
+			return false;
+		waitOnCounter(&header->frameCounter,counter,remaining);
+		}
+	}
+
+bool SharedFrameRing::readFrame(Misc::UInt64 sequence,SharedFrameRing::DepthPixel* depth,double& timeStamp) const
+	{
+	/* Comprobar que la ranura todavía contiene el marco pedido: */
+	const SlotHeader* slot=getSlot(sequence);
+	if(__atomic_load_n(&slot->sequence,__ATOMIC_ACQUIRE)!=sequence)
+		return false;
+	
+	/* Copiar el marco y comprobar que el escritor no empezó a sobrescribirlo: */
+	memcpy(depth,slot+1,size_t(frameSize[1])*size_t(frameSize[0])*sizeof(DepthPixel));
+	timeStamp=slot->timeStamp;
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	return __atomic_load_n(&slot->sequence,__ATOMIC_RELAXED)==sequence;
+	}
+
+bool SharedFrameRing::isReplaced(void) const
+	{
+	/* Comparar el segmento mapeado con el que tiene ahora el nombre: */
+	int currentFd=shm_open(name.c_str(),O_RDONLY,0);
+	if(currentFd<0)
+		return true;
+	struct stat mappedStat,currentStat;
+	bool replaced=fstat(fd,&mappedStat)!=0||fstat(currentFd,&currentStat)!=0||mappedStat.st_dev!=currentStat.st_dev||mappedStat.st_ino!=currentStat.st_ino;
+	close(currentFd);
+	return replaced;
+	}
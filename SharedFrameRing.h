@@ -0,0 +1,99 @@
+/***********************************************************************
+SharedFrameRing - Clase para un anillo de marcos de profundidad sin
+procesar en memoria compartida POSIX, escrito sin bloqueos por un único
+demonio de captura y leído por cualquier número de procesos locales.
+Copyright (c) 2026 Sergio081096
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#ifndef SHAREDFRAMERING_INCLUDED
+#define SHAREDFRAMERING_INCLUDED
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include <Misc/SizedTypes.h>
+#include <Kinect/FrameSource.h>
+
+class SharedFrameRing
+	{
+	/* Clases integradas: */
+	public:
+	typedef Kinect::FrameSource::DepthPixel DepthPixel; // Tipo de datos para valores de profundidad sin procesar
+	typedef Kinect::FrameSource::IntrinsicParameters IntrinsicParameters; // Tipo para los parámetros intrínsecos de la cámara
+	typedef Kinect::FrameSource::ExtrinsicParameters ExtrinsicParameters; // Tipo para los parámetros extrínsecos de la cámara
+	typedef Kinect::FrameSource::DepthRange DepthRange; // Tipo para el rango de valores de profundidad válidos
+	typedef Kinect::FrameSource::DepthCorrection::PixelCorrection PixelCorrection; // Tipo para factores de corrección de profundidad por píxel
+	
+	private:
+	struct Header; // Encabezado del segmento de memoria compartida
+	struct SlotHeader; // Encabezado de cada ranura de marco del anillo
+	
+	/* Elementos: */
+	std::string name; // Nombre del segmento de memoria compartida
+	int fd; // Descriptor del segmento de memoria compartida
+	unsigned char* segment; // Mapeo de memoria de todo el segmento
+	size_t segmentSize; // Tamaño del mapeo de memoria en bytes
+	Header* header; // Encabezado del segmento
+	unsigned int frameSize[2]; // Ancho y alto de los marcos de profundidad en píxeles
+	unsigned int numSlots; // Número de ranuras de marco del anillo
+	Misc::UInt64 nextSequence; // Número de secuencia del siguiente marco a publicar; solo usado por el escritor
+	
+	/* Métodos privados: */
+	SlotHeader* getSlot(Misc::UInt64 sequence) const; // Devuelve la ranura que contiene el marco del número de secuencia dado
+	void lockWriter(void); // Toma el bloqueo exclusivo de escritor sobre el segmento abierto; cierra el segmento y lanza una excepción si otro demonio lo tiene
+	void unmap(void); // Libera el mapeo de memoria y cierra el segmento
+	
+	/* Constructores y destructores: */
+	public:
+	SharedFrameRing(const char* sName,const unsigned int sFrameSize[2],unsigned int sNumSlots); // Abre el anillo del nombre dado para escribir, reutilizándolo si tiene la misma disposición o creándolo de nuevo; lanza una excepción si otro demonio de captura ya escribe en él
+	SharedFrameRing(const char* sName,double timeout); // Abre el anillo del nombre dado para leer; espera hasta el tiempo dado en segundos a que un demonio de captura lo inicialice
+	private:
+	SharedFrameRing(const SharedFrameRing& source); // Prohibir copia constructor
+	SharedFrameRing& operator=(const SharedFrameRing& source); // Prohibir operador de asignación
+	public:
+	~SharedFrameRing(void);
+	
+	/* Métodos: */
+	const std::string& getName(void) const // Devuelve el nombre del segmento de memoria compartida
+		{
+		return name;
+		}
+	const unsigned int* getFrameSize(void) const // Devuelve el tamaño de los marcos de profundidad
+		{
+		return frameSize;
+		}
+	unsigned int getNumSlots(void) const // Devuelve el número de ranuras de marco del anillo
+		{
+		return numSlots;
+		}
+	
+	/* Métodos del escritor: */
+	void publishParameters(const IntrinsicParameters& ips,const ExtrinsicParameters& eps,const DepthRange& depthRange,const PixelCorrection* pixelCorrection); // Publica los parámetros de la cámara y marca el anillo como listo; la corrección por píxel puede ser NULL
+	void publishFrame(const DepthPixel* depth,double timeStamp); // Copia un marco de profundidad en la siguiente ranura y lo publica sin bloquear a los lectores
+	
+	/* Métodos de los lectores: */
+	Misc::UInt32 getGeneration(void) const; // Devuelve la generación del anillo, que cambia cada vez que un demonio de captura se reinicia
+	void getParameters(IntrinsicParameters& ips,ExtrinsicParameters& eps,DepthRange& depthRange,PixelCorrection* pixelCorrection,double timeout,std::vector<Misc::UInt8>* parameterBytes=0) const; // Copia los parámetros de la cámara; la corrección por píxel puede ser NULL; si se da, copia en la misma lectura los bytes sin procesar del área de parámetros del segmento para compararlos; lanza una excepción si el demonio no termina de inicializarse a tiempo
+	Misc::UInt64 getPublishedSequence(void) const; // Devuelve el número de secuencia del marco publicado más reciente, o 0
+	bool waitForFrame(Misc::UInt64 lastSequence,double timeout) const; // Espera hasta el tiempo dado a que se publique un marco posterior al dado; devuelve falso al vencer el tiempo
+	bool readFrame(Misc::UInt64 sequence,DepthPixel* depth,double& timeStamp) const; // Copia el marco del número de secuencia dado; devuelve falso si el escritor lo sobrescribió mientras tanto
+	bool isReplaced(void) const; // Devuelve verdadero si el segmento fue eliminado o reemplazado por un demonio de captura con una disposición distinta
+	};
+
+#endif
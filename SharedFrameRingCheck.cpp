@@ -0,0 +1,181 @@
+/***********************************************************************
+SharedFrameRingCheck - Utilidad que comprueba el anillo de marcos en
+memoria compartida: publicación y lectura de marcos, rechazo de un
+segundo escritor, reutilización del segmento por un demonio reiniciado
+con la misma disposición y reemplazo con una disposición distinta.
+Copyright (c) 2026 Sergio081096
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include <stdio.h>
+#include <unistd.h>
+#include <math.h>
+#include <sys/mman.h>
+#include <vector>
+#include <iostream>
+#include <stdexcept>
+
+#include "SharedFrameRing.h"
+
+namespace {
+
+/****************
+Helper functions:
+****************/
+
+bool check(const char* name,double value,double expected,double tolerance)
+	{
+	bool ok=fabs(value-expected)<=tolerance;
+	std::cout<<name<<' '<<value<<" (expected "<<expected<<") "<<(ok?"ok":"FAILED")<<std::endl;
+	return ok;
+	}
+
+bool check(const char* name,bool ok)
+	{
+	std::cout<<name<<' '<<(ok?"ok":"FAILED")<<std::endl;
+	return ok;
+	}
+
+void publishFrames(SharedFrameRing& ring,Misc::UInt64 firstSequence,unsigned int numFrames) // Publica marcos cuyos píxeles dependen de su número de secuencia
+	{
+	const unsigned int* frameSize=ring.getFrameSize();
+	std::vector<SharedFrameRing::DepthPixel> depth(size_t(frameSize[1])*size_t(frameSize[0]));
+	for(Misc::UInt64 sequence=firstSequence;sequence<firstSequence+numFrames;++sequence)
+		{
+		for(size_t i=0;i<depth.size();++i)
+			depth[i]=SharedFrameRing::DepthPixel((sequence*100U+i)%2048U);
+		ring.publishFrame(&depth[0],double(sequence)*0.03);
+		}
+	}
+
+bool readFrame(const SharedFrameRing& ring,Misc::UInt64 sequence) // Lee el marco dado y devuelve verdadero si tiene el contenido y la marca de tiempo publicados
+	{
+	const unsigned int* frameSize=ring.getFrameSize();
+	std::vector<SharedFrameRing::DepthPixel> depth(size_t(frameSize[1])*size_t(frameSize[0]));
+	double timeStamp;
+	if(!ring.readFrame(sequence,&depth[0],timeStamp))
+		return false;
+	bool ok=timeStamp==double(sequence)*0.03;
+	for(size_t i=0;i<depth.size();++i)
+		ok=ok&&depth[i]==SharedFrameRing::DepthPixel((sequence*100U+i)%2048U);
+	return ok;
+	}
+
+}
+
+int main(int argc,char* argv[])
+	{
+	/* Parámetros del escenario: marcos de 8x6 píxeles en un anillo de 4 ranuras con un nombre propio de este proceso: */
+	const unsigned int frameSize[2]={8,6};
+	const unsigned int numSlots=4;
+	char ringName[64];
+	snprintf(ringName,sizeof(ringName),"/SARndboxRingCheck-%d",int(getpid()));
+	
+	bool ok=true;
+	SharedFrameRing* writer=0;
+	SharedFrameRing* reader=0;
+	try
+		{
+		/* Parámetros de la cámara; solo la corrección por píxel cambia entre los demonios: */
+		SharedFrameRing::IntrinsicParameters ips=SharedFrameRing::IntrinsicParameters();
+		SharedFrameRing::ExtrinsicParameters eps=SharedFrameRing::ExtrinsicParameters();
+		SharedFrameRing::DepthRange depthRange=SharedFrameRing::DepthRange();
+		std::vector<SharedFrameRing::PixelCorrection> pixelCorrection(size_t(frameSize[1])*size_t(frameSize[0]));
+		for(size_t i=0;i<pixelCorrection.size();++i)
+			{
+			pixelCorrection[i].scale=1.0f+float(i)*0.001f;
+			pixelCorrection[i].offset=0.5f;
+			}
+		
+		/* Publique seis marcos en el anillo de cuatro ranuras: */
+		writer=new SharedFrameRing(ringName,frameSize,numSlots);
+		writer->publishParameters(ips,eps,depthRange,0);
+		reader=new SharedFrameRing(ringName,1.0);
+		std::vector<Misc::UInt8> parameterBytes;
+		reader->getParameters(ips,eps,depthRange,0,1.0,&parameterBytes);
+		Misc::UInt32 generation=reader->getGeneration();
+		publishFrames(*writer,1,6);
+		ok=check("Published sequence",double(reader->getPublishedSequence()),6.0,0.0)&&ok;
+		ok=check("Newest frames",readFrame(*reader,6)&&readFrame(*reader,3))&&ok;
+		ok=check("Overwritten frame rejected",!readFrame(*reader,2))&&ok;
+		ok=check("Wait for newer frame times out",!reader->waitForFrame(6,0.05))&&ok;
+		ok=check("Wait for older frame returns",reader->waitForFrame(5,0.0))&&ok;
+		
+		/* Un segundo demonio no debe poder escribir en el anillo: */
+		bool rejected=false;
+		try
+			{
+			SharedFrameRing secondWriter(ringName,frameSize,numSlots);
+			}
+		catch(const std::runtime_error&)
+			{
+			rejected=true;
+			}
+		ok=check("Second writer rejected",rejected)&&ok;
+		
+		/* Un demonio reiniciado con la misma disposición debe reutilizar el segmento y continuar la secuencia: */
+		delete writer;
+		writer=0;
+		writer=new SharedFrameRing(ringName,frameSize,numSlots);
+		ok=check("Generation odd during restart",(reader->getGeneration()&0x1U)!=0x0U)&&ok;
+		writer->publishParameters(ips,eps,depthRange,0);
+		std::vector<Misc::UInt8> restartBytes;
+		reader->getParameters(ips,eps,depthRange,0,1.0,&restartBytes);
+		ok=check("Same segment after restart",!reader->isReplaced())&&ok;
+		ok=check("Generation changed",reader->getGeneration()!=generation)&&ok;
+		ok=check("Same parameters after restart",restartBytes==parameterBytes)&&ok;
+		publishFrames(*writer,7,2);
+		ok=check("Published sequence after restart",double(reader->getPublishedSequence()),8.0,0.0)&&ok;
+		ok=check("Frames after restart",readFrame(*reader,7)&&readFrame(*reader,8))&&ok;
+		
+		/* Un demonio reiniciado con otra corrección por píxel debe cambiar los bytes de los parámetros: */
+		delete writer;
+		writer=0;
+		writer=new SharedFrameRing(ringName,frameSize,numSlots);
+		writer->publishParameters(ips,eps,depthRange,&pixelCorrection[0]);
+		std::vector<SharedFrameRing::PixelCorrection> readCorrection(pixelCorrection.size());
+		reader->getParameters(ips,eps,depthRange,&readCorrection[0],1.0,&restartBytes);
+		ok=check("Changed parameters after restart",restartBytes!=parameterBytes)&&ok;
+		ok=check("Pixel correction",readCorrection[17].scale==pixelCorrection[17].scale&&readCorrection[17].offset==pixelCorrection[17].offset)&&ok;
+		
+		/* Un demonio reiniciado con otra disposición debe reemplazar el segmento y empezar una secuencia nueva: */
+		delete writer;
+		writer=0;
+		writer=new SharedFrameRing(ringName,frameSize,numSlots+2);
+		writer->publishParameters(ips,eps,depthRange,0);
+		ok=check("Segment replaced",reader->isReplaced())&&ok;
+		delete reader;
+		reader=0;
+		reader=new SharedFrameRing(ringName,1.0);
+		ok=check("Slots of new segment",double(reader->getNumSlots()),double(numSlots+2),0.0)&&ok;
+		publishFrames(*writer,1,1);
+		ok=check("Frame of new segment",readFrame(*reader,1))&&ok;
+		}
+	catch(const std::runtime_error& err)
+		{
+		std::cerr<<"Caught exception "<<err.what()<<std::endl;
+		ok=false;
+		}
+	
+	/* El segmento sobrevive a los demonios; elimínelo: */
+	delete reader;
+	delete writer;
+	shm_unlink(ringName);
+	
+	return ok?0:1;
+	}
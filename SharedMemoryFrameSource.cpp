@@ -0,0 +1,278 @@
+/***********************************************************************
+SharedMemoryFrameSource - Clase para una fuente de marcos de profundidad
+que lee el anillo de memoria compartida escrito por un demonio de
+captura local, con detección de marcos perdidos y de reinicios del
+demonio.
+Copyright (c) 2026 Sergio081096
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include "SharedMemoryFrameSource.h"
+
+#include <string.h>
+#include <vector>
+#include <iostream>
+#include <stdexcept>
+#include <Misc/FunctionCalls.h>
+#include <Kinect/FrameBuffer.h>
+
+#include "SharedFrameRing.h"
+
+namespace {
+
+/**************
+Helper objects:
+**************/
+
+const double frameWaitTimeout=0.1; // Tiempo máximo en segundos de cada espera del hilo lector, para reaccionar al apagado y a un segmento reemplazado
+
+}
+
+/****************************************
+Methods of class SharedMemoryFrameSource:
+****************************************/
+
+bool SharedMemoryFrameSource::haveSameParameters(const SharedFrameRing& checkRing) const
+	{
+	/* Leer los bytes sin procesar del área de parámetros publicada actualmente por el demonio: */
+	IntrinsicParameters newIps;
+	ExtrinsicParameters newEps;
+	DepthRange newDepthRange;
+	std::vector<Misc::UInt8> newParameterBytes;
+	checkRing.getParameters(newIps,newEps,newDepthRange,0,0.0,&newParameterBytes);
+	
+	/* Comparar con la copia sin procesar tomada al abrir la fuente; los objetos copiados tienen relleno indeterminado, el segmento no: */
+	return newParameterBytes==parameterBytes;
+	}
+
+void* SharedMemoryFrameSource::readerThreadMethod(void)
+	{
+	Misc::UInt64 lastSequence=0;
+	bool haveFrame=false;
+	Misc::UInt32 generation=ring->getGeneration();
+	bool reportedMismatch=false;
+	bool ignoreFrames=false;
+	size_t frameBytes=size_t(frameSize[1])*size_t(frameSize[0])*sizeof(DepthPixel);
+	while(runReaderThread)
+		{
+		/* Esperar el siguiente marco del demonio: */
+		if(!ring->waitForFrame(lastSequence,frameWaitTimeout))
+			{
+			/* Comprobar si un demonio reiniciado creó un segmento nuevo: */
+			if(ring->isReplaced())
+				{
+				try
+					{
+					SharedFrameRing* newRing=new SharedFrameRing(ringName.c_str(),0.0);
+					const unsigned int* newFrameSize=newRing->getFrameSize();
+					bool sameFrameSize=newFrameSize[0]==frameSize[0]&&newFrameSize[1]==frameSize[1];
+					
+					/* El resto de la aplicación usa los parámetros de cámara copiados al abrir la fuente: */
+					bool sameParameters=false;
+					if(sameFrameSize)
+						{
+						try
+							{
+							sameParameters=haveSameParameters(*newRing);
+							}
+						catch(const std::runtime_error& err)
+							{
+							delete newRing;
+							throw;
+							}
+						}
+					
+					if(sameParameters)
+						{
+						/* Cambiar al segmento nuevo; sus números de secuencia empiezan de nuevo: */
+						delete ring;
+						ring=newRing;
+						lastSequence=0;
+						haveFrame=false;
+						generation=ring->getGeneration();
+						++numRestarts;
+						reportedMismatch=false;
+						ignoreFrames=false;
+						std::cout<<"SharedMemoryFrameSource: Capture daemon re-created shared memory segment "<<ringName<<std::endl;
+						}
+					else
+						{
+						if(!reportedMismatch)
+							{
+							if(sameFrameSize)
+								std::cerr<<"SharedMemoryFrameSource: Capture daemon re-created shared memory segment "<<ringName<<" with different camera parameters; ignoring it"<<std::endl;
+							else
+								std::cerr<<"SharedMemoryFrameSource: Capture daemon re-created shared memory segment "<<ringName<<" with frame size "<<newFrameSize[0]<<'x'<<newFrameSize[1]<<"; ignoring it"<<std::endl;
+							}
+						delete newRing;
+						reportedMismatch=true;
+						}
+					}
+				catch(const std::runtime_error& err)
+					{
+					/* El demonio todavía no inicializó el segmento nuevo; volver a intentarlo más tarde: */
+					}
+				}
+			continue;
+			}
+		
+		/* Copiar el marco publicado más reciente en un nuevo búfer de marco: */
+		Misc::UInt64 sequence=ring->getPublishedSequence();
+		Kinect::FrameBuffer frame(frameSize[0],frameSize[1],frameBytes);
+		if(!ring->readFrame(sequence,frame.getData<DepthPixel>(),frame.timeStamp))
+			{
+			/* El demonio sobrescribió el marco durante la copia; leer el siguiente: */
+			continue;
+			}
+		
+		/* Contar los marcos perdidos desde el último entregado: */
+		if(haveFrame&&sequence>lastSequence+1)
+			numDroppedFrames+=sequence-lastSequence-1;
+		lastSequence=sequence;
+		haveFrame=true;
+		
+		/* Detectar un demonio reiniciado que reutilizó el segmento: */
+		Misc::UInt32 newGeneration=ring->getGeneration();
+		if(newGeneration!=generation)
+			{
+			/* Ignorar los marcos del demonio reiniciado si publicó parámetros de cámara distintos: */
+			try
+				{
+				ignoreFrames=!haveSameParameters(*ring);
+				}
+			catch(const std::runtime_error& err)
+				{
+				/* El demonio todavía se está inicializando; volver a comprobarlo con el siguiente marco: */
+				continue;
+				}
+			generation=newGeneration;
+			++numRestarts;
+			if(ignoreFrames)
+				std::cerr<<"SharedMemoryFrameSource: Capture daemon on shared memory segment "<<ringName<<" restarted with different camera parameters; ignoring its frames"<<std::endl;
+			else
+				std::cout<<"SharedMemoryFrameSource: Capture daemon on shared memory segment "<<ringName<<" restarted"<<std::endl;
+			}
+		if(ignoreFrames)
+			continue;
+		
+		/* Entregar el marco: */
+		++numFrames;
+		(*depthStreamingCallback)(frame);
+		}
+	
+	return 0;
+	}
+
+SharedMemoryFrameSource::SharedMemoryFrameSource(const char* sRingName,double timeout)
+	:ringName(sRingName),
+	 ring(new SharedFrameRing(sRingName,timeout)),
+	 pixelCorrection(0),
+	 depthStreamingCallback(0),
+	 runReaderThread(false),
+	 numFrames(0),numDroppedFrames(0),numRestarts(0)
+	{
+	/* Copiar el tamaño de marco y los parámetros de la cámara publicados por el demonio: */
+	for(int i=0;i<2;++i)
+		frameSize[i]=ring->getFrameSize()[i];
+	pixelCorrection=new PixelCorrection[frameSize[1]*frameSize[0]];
+	try
+		{
+		ring->getParameters(ips,eps,depthRange,pixelCorrection,timeout,&parameterBytes);
+		}
+	catch(const std::runtime_error& err)
+		{
+		delete[] pixelCorrection;
+		delete ring;
+		throw;
+		}
+	}
+
+SharedMemoryFrameSource::~SharedMemoryFrameSource(void)
+	{
+	stopStreaming();
+	delete[] pixelCorrection;
+	delete ring;
+	}
+
+Kinect::FrameSource::DepthCorrection* SharedMemoryFrameSource::getDepthCorrectionParameters(void)
+	{
+	/* El demonio publica la corrección ya evaluada por píxel; ver getPixelDepthCorrection: */
+	return 0;
+	}
+
+Kinect::FrameSource::IntrinsicParameters SharedMemoryFrameSource::getIntrinsicParameters(void)
+	{
+	return ips;
+	}
+
+Kinect::FrameSource::ExtrinsicParameters SharedMemoryFrameSource::getExtrinsicParameters(void)
+	{
+	return eps;
+	}
+
+const unsigned int* SharedMemoryFrameSource::getActualFrameSize(int sensor) const
+	{
+	/* El anillo solo contiene marcos de profundidad: */
+	return frameSize;
+	}
+
+Kinect::FrameSource::DepthRange SharedMemoryFrameSource::getDepthRange(void) const
+	{
+	return depthRange;
+	}
+
+void SharedMemoryFrameSource::startStreaming(Kinect::FrameSource::StreamingCallback* newColorStreamingCallback,Kinect::FrameSource::StreamingCallback* newDepthStreamingCallback)
+	{
+	/* Detener la transmisión anterior: */
+	stopStreaming();
+	
+	/* El anillo no contiene marcos de color: */
+	delete newColorStreamingCallback;
+	
+	/* Iniciar el hilo lector: */
+	depthStreamingCallback=newDepthStreamingCallback;
+	if(depthStreamingCallback!=0)
+		{
+		runReaderThread=true;
+		readerThread.start(this,&SharedMemoryFrameSource::readerThreadMethod);
+		}
+	}
+
+void SharedMemoryFrameSource::stopStreaming(void)
+	{
+	if(runReaderThread)
+		{
+		/* Detener el hilo lector: */
+		runReaderThread=false;
+		readerThread.join();
+		
+		/* Informar sobre la calidad de la transmisión: */
+		if(numDroppedFrames>0||numRestarts>0)
+			std::cout<<"SharedMemoryFrameSource: Received "<<numFrames<<" frames from shared memory segment "<<ringName<<", dropped "<<numDroppedFrames<<" frames, detected "<<numRestarts<<" capture daemon restarts"<<std::endl;
+		}
+	
+	delete depthStreamingCallback;
+	depthStreamingCallback=0;
+	}
+
+SharedMemoryFrameSource::PixelCorrection* SharedMemoryFrameSource::getPixelDepthCorrection(void) const
+	{
+	PixelCorrection* result=new PixelCorrection[frameSize[1]*frameSize[0]];
+	memcpy(result,pixelCorrection,size_t(frameSize[1])*size_t(frameSize[0])*sizeof(PixelCorrection));
+	return result;
+	}
@@ -0,0 +1,86 @@
+/***********************************************************************
+SharedMemoryFrameSource - Clase para una fuente de marcos de profundidad
+que lee el anillo de memoria compartida escrito por un demonio de
+captura local, con detección de marcos perdidos y de reinicios del
+demonio.
+Copyright (c) 2026 Sergio081096
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#ifndef SHAREDMEMORYFRAMESOURCE_INCLUDED
+#define SHAREDMEMORYFRAMESOURCE_INCLUDED
+
+#include <string>
+#include <vector>
+#include <Misc/SizedTypes.h>
+#include <Threads/Thread.h>
+#include <Kinect/FrameSource.h>
+
+/* Declaraciones de reenvío: */
+class SharedFrameRing;
+
+class SharedMemoryFrameSource:public Kinect::FrameSource
+	{
+	/* Clases integradas: */
+	public:
+	typedef DepthCorrection::PixelCorrection PixelCorrection; // Tipo para factores de corrección de profundidad por píxel
+	
+	/* Elementos: */
+	private:
+	std::string ringName; // Nombre del anillo de memoria compartida, para volver a abrirlo si el demonio lo reemplaza
+	SharedFrameRing* ring; // El anillo de memoria compartida; solo lo reemplaza el hilo lector
+	unsigned int frameSize[2]; // Ancho y alto de los marcos de profundidad
+	IntrinsicParameters ips; // Parámetros intrínsecos publicados por el demonio
+	ExtrinsicParameters eps; // Parámetros extrínsecos publicados por el demonio
+	DepthRange depthRange; // Rango de valores de profundidad válidos publicado por el demonio
+	PixelCorrection* pixelCorrection; // Factores de corrección de profundidad por píxel publicados por el demonio
+	std::vector<Misc::UInt8> parameterBytes; // Bytes sin procesar del área de parámetros del segmento, copiados junto con los parámetros al abrir la fuente
+	StreamingCallback* depthStreamingCallback; // Función llamada con cada nuevo marco de profundidad
+	volatile bool runReaderThread; // Marcar para mantener en ejecución el hilo lector
+	Threads::Thread readerThread; // Hilo que espera los marcos del demonio y los entrega
+	Misc::UInt64 numFrames; // Número de marcos entregados
+	Misc::UInt64 numDroppedFrames; // Número de marcos publicados por el demonio que no se llegaron a entregar
+	unsigned int numRestarts; // Número de reinicios del demonio detectados
+	
+	/* Métodos privados: */
+	bool haveSameParameters(const SharedFrameRing& checkRing) const; // Devuelve verdadero si el anillo dado publica los mismos parámetros de cámara que se copiaron al abrir la fuente; lanza una excepción si el demonio aún no los publicó
+	void* readerThreadMethod(void); // Método para el hilo lector
+	
+	/* Constructores y destructores: */
+	public:
+	SharedMemoryFrameSource(const char* sRingName,double timeout); // Abre el anillo de memoria compartida dado; espera hasta el tiempo dado en segundos a que el demonio de captura lo inicialice
+	private:
+	SharedMemoryFrameSource(const SharedMemoryFrameSource& source); // Prohibir copia constructor
+	SharedMemoryFrameSource& operator=(const SharedMemoryFrameSource& source); // Prohibir operador de asignación
+	public:
+	virtual ~SharedMemoryFrameSource(void);
+	
+	/* Métodos de la clase Kinect::FrameSource: */
+	virtual DepthCorrection* getDepthCorrectionParameters(void);
+	virtual IntrinsicParameters getIntrinsicParameters(void);
+	virtual ExtrinsicParameters getExtrinsicParameters(void);
+	virtual const unsigned int* getActualFrameSize(int sensor) const;
+	virtual DepthRange getDepthRange(void) const;
+	virtual void startStreaming(StreamingCallback* newColorStreamingCallback,StreamingCallback* newDepthStreamingCallback);
+	virtual void stopStreaming(void);
+	
+	/* Nuevos métodos: */
+	PixelCorrection* getPixelDepthCorrection(void) const; // Devuelve una copia nueva de los factores de corrección de profundidad por píxel del demonio
+	};
+
+#endif
@@ -0,0 +1,339 @@
+/***********************************************************************
+SurfaceMeshDecimator - Clase para construir en un hilo de fondo mallas
+diezmadas con error acotado de la superficie de arena, como listas de
+índices de triángulos sobre la plantilla de vértices de resolución
+completa, en dos niveles de detalle.
+Copyright (c) 2012-2016 Oliver Kreylos
+Copyright (c) 2026 Sergio081096
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include "SurfaceMeshDecimator.h"
+
+#include <Math/Math.h>
+#include <Math/Constants.h>
+
+/*************************************
+Methods of class SurfaceMeshDecimator:
+*************************************/
+
+void SurfaceMeshDecimator::addTiles(unsigned int x0,unsigned int y0,unsigned int width,unsigned int height,unsigned int maxSizeLog)
+	{
+	if(width==0||height==0)
+		return;
+	
+	/* Cubra el rectángulo con una fila de mosaicos del mayor tamaño que cabe: */
+	unsigned int sizeLog=0;
+	while(sizeLog<maxSizeLog&&(2U<<sizeLog)<=width&&(2U<<sizeLog)<=height)
+		++sizeLog;
+	unsigned int s=1U<<sizeLog;
+	unsigned int nx=width/s;
+	unsigned int ny=height/s;
+	for(unsigned int j=0;j<ny;++j)
+		for(unsigned int i=0;i<nx;++i)
+			{
+			Tile tile;
+			tile.origin[0]=x0+i*s;
+			tile.origin[1]=y0+j*s;
+			tile.sizeLog=sizeLog;
+			tiles.push_back(tile);
+			}
+	
+	/* Cubra los restos a la derecha y arriba con mosaicos más pequeños: */
+	addTiles(x0+nx*s,y0,width-nx*s,ny*s,sizeLog);
+	addTiles(x0,y0+ny*s,width,height-ny*s,sizeLog);
+	}
+
+void SurfaceMeshDecimator::processTriangle(const SurfaceMeshDecimator::Tile& tile,int level,int ax,int ay,int bx,int by,int cx,int cy,std::vector<GLuint>& indices) const
+	{
+	/* Divida el triángulo por el punto medio de su hipotenusa si es demasiado impreciso: */
+	int gridSize=(1<<tile.sizeLog)+1;
+	int mx=(ax+bx)>>1;
+	int my=(ay+by)>>1;
+	if(Math::abs(ax-cx)+Math::abs(ay-cy)>1&&errors[my*gridSize+mx]>maxErrors[level])
+		{
+		processTriangle(tile,level,cx,cy,ax,ay,mx,my,indices);
+		processTriangle(tile,level,bx,by,cx,cy,mx,my,indices);
+		}
+	else
+		{
+		/* Emita el triángulo con índices de la plantilla de vértices de resolución completa: */
+		GLuint base=GLuint(tile.origin[1]*size[0]+tile.origin[0]);
+		indices.push_back(base+GLuint(ay*int(size[0])+ax));
+		indices.push_back(base+GLuint(by*int(size[0])+bx));
+		indices.push_back(base+GLuint(cy*int(size[0])+cx));
+		}
+	}
+
+bool SurfaceMeshDecimator::checkTile(const SurfaceMeshDecimator::Tile& tile,const float* frameData) const
+	{
+	/* Compare las nuevas elevaciones de todas las muestras del mosaico con las usadas para la malla actual: */
+	int s=1<<tile.sizeLog;
+	for(int y=0;y<=s;++y)
+		{
+		unsigned int rowBase=(tile.origin[1]+y)*size[0]+tile.origin[0];
+		double dy=double(tile.origin[1]+y)+0.5;
+		for(int x=0;x<=s;++x)
+			{
+			double dx=double(tile.origin[0]+x)+0.5;
+			double z=double(frameData[rowBase+x]);
+			double e=(basePlaneDicEq[0]*dx+basePlaneDicEq[1]*dy+basePlaneDicEq[2]*z+basePlaneDicEq[3])/(weightDicEq[0]*dx+weightDicEq[1]*dy+weightDicEq[2]*z+weightDicEq[3]);
+			if(Math::abs(float(e)-elevation[rowBase+x])>=changeThreshold)
+				return true;
+			}
+		}
+	
+	return false;
+	}
+
+void SurfaceMeshDecimator::processTile(SurfaceMeshDecimator::Tile& tile,const float* frameData)
+	{
+	int s=1<<tile.sizeLog;
+	int gridSize=s+1;
+	
+	/* Acepte las nuevas elevaciones del mosaico: */
+	for(int y=0;y<=s;++y)
+		{
+		unsigned int rowBase=(tile.origin[1]+y)*size[0]+tile.origin[0];
+		double dy=double(tile.origin[1]+y)+0.5;
+		for(int x=0;x<=s;++x)
+			{
+			double dx=double(tile.origin[0]+x)+0.5;
+			double z=double(frameData[rowBase+x]);
+			elevation[rowBase+x]=float((basePlaneDicEq[0]*dx+basePlaneDicEq[1]*dy+basePlaneDicEq[2]*z+basePlaneDicEq[3])/(weightDicEq[0]*dx+weightDicEq[1]*dy+weightDicEq[2]*z+weightDicEq[3]));
+			}
+		}
+	
+	if(s==1)
+		{
+		/* Los mosaicos de una celda siempre se dividen en dos triángulos: */
+		GLuint base=GLuint(tile.origin[1]*size[0]+tile.origin[0]);
+		for(int level=0;level<2;++level)
+			{
+			std::vector<GLuint>& indices=tile.indices[level];
+			indices.clear();
+			indices.push_back(base);
+			indices.push_back(base+size[0]+1);
+			indices.push_back(base+1);
+			indices.push_back(base+size[0]+1);
+			indices.push_back(base);
+			indices.push_back(base+size[0]);
+			}
+		return;
+		}
+	
+	/* Fuerce la resolución completa en el borde del mosaico para que los mosaicos vecinos encajen sin grietas: */
+	for(int y=0;y<gridSize;++y)
+		for(int x=0;x<gridSize;++x)
+			errors[y*gridSize+x]=x==0||x==s||y==0||y==s?Math::Constants<float>::max:0.0f;
+	
+	/* Acumule los errores de aproximación de abajo arriba a lo largo de la jerarquía de bisección: */
+	const float* ePtr=elevation+(tile.origin[1]*size[0]+tile.origin[0]);
+	const std::vector<unsigned short>& coords=triangleCoords[tile.sizeLog];
+	int numTriangles=s*s*2-2;
+	int numParentTriangles=numTriangles-s*s;
+	for(int i=numTriangles-1;i>=0;--i)
+		{
+		const unsigned short* c=&coords[i*4];
+		int ax=c[0];
+		int ay=c[1];
+		int bx=c[2];
+		int by=c[3];
+		int mx=(ax+bx)>>1;
+		int my=(ay+by)>>1;
+		int cx=mx+my-ay;
+		int cy=my+ax-mx;
+		float interpolated=(ePtr[ay*size[0]+ax]+ePtr[by*size[0]+bx])*0.5f;
+		float& error=errors[my*gridSize+mx];
+		error=Math::max(error,Math::abs(interpolated-ePtr[my*size[0]+mx]));
+		if(i<numParentTriangles)
+			{
+			error=Math::max(error,errors[((ay+cy)>>1)*gridSize+((ax+cx)>>1)]);
+			error=Math::max(error,errors[((by+cy)>>1)*gridSize+((bx+cx)>>1)]);
+			}
+		}
+	
+	/* Extraiga las mallas fina y gruesa del mosaico: */
+	for(int level=0;level<2;++level)
+		{
+		std::vector<GLuint>& indices=tile.indices[level];
+		indices.clear();
+		processTriangle(tile,level,0,0,s,s,s,0,indices);
+		processTriangle(tile,level,s,s,0,0,0,s,indices);
+		}
+	}
+
+void* SurfaceMeshDecimator::decimatorThreadMethod(void)
+	{
+	unsigned int lastInputFrameVersion=0;
+	std::vector<unsigned char> tileDirty(tiles.size(),0);
+	while(true)
+		{
+		Kinect::FrameBuffer frame;
+		{
+		Threads::MutexCond::Lock inputLock(inputCond);
+		
+		/* Espere hasta que llegue una nueva imagen o el programa se apague: */
+		while(runDecimatorThread&&lastInputFrameVersion==inputFrameVersion)
+			inputCond.wait(inputLock);
+		
+		/* Salte si el programa se está cerrando: */
+		if(!runDecimatorThread)
+			break;
+		
+		/* Trabaja en la nueva imagen: */
+		frame=inputFrame;
+		lastInputFrameVersion=inputFrameVersion;
+		}
+		
+		/* Detecte los mosaicos modificados antes de aceptar elevaciones, porque los mosaicos vecinos comparten sus muestras del borde: */
+		const float* frameData=frame.getData<float>();
+		bool changed=false;
+		for(size_t i=0;i<tiles.size();++i)
+			{
+			tileDirty[i]=!haveElevation||checkTile(tiles[i],frameData);
+			changed=changed||tileDirty[i]!=0;
+			}
+		haveElevation=true;
+		if(!changed)
+			continue;
+		
+		/* Vuelva a diezmar los mosaicos modificados: */
+		for(size_t i=0;i<tiles.size();++i)
+			if(tileDirty[i])
+				processTile(tiles[i],frameData);
+		
+		/* Publique el nuevo par de mallas: */
+		Mesh& newMesh=meshes.startNewValue();
+		for(int level=0;level<2;++level)
+			{
+			newMesh.indices[level].clear();
+			for(std::vector<Tile>::iterator tIt=tiles.begin();tIt!=tiles.end();++tIt)
+				newMesh.indices[level].insert(newMesh.indices[level].end(),tIt->indices[level].begin(),tIt->indices[level].end());
+			}
+		meshes.postNewValue();
+		}
+	
+	return 0;
+	}
+
+SurfaceMeshDecimator::SurfaceMeshDecimator(const unsigned int sSize[2],const PTransform& depthProjection,const Plane& basePlane,float fineError,float coarseError,unsigned int maxTileSizeLog)
+	:changeThreshold(fineError*0.5f),
+	 elevation(0),
+	 haveElevation(false),
+	 inputFrameVersion(0),
+	 runDecimatorThread(false)
+	{
+	/* Copie el tamaño de la cuadrícula y los errores máximos: */
+	for(int i=0;i<2;++i)
+		size[i]=sSize[i];
+	maxErrors[0]=fineError;
+	maxErrors[1]=Math::max(coarseError,fineError);
+	
+	/* Transforme el plano base en el espacio de imagen de profundidad, como lo hace el renderizador de imágenes de profundidad: */
+	const PTransform::Matrix& dpm=depthProjection.getMatrix();
+	const Plane::Vector& bpn=basePlane.getNormal();
+	Scalar bpo=basePlane.getOffset();
+	for(int i=0;i<4;++i)
+		{
+		basePlaneDicEq[i]=dpm(0,i)*bpn[0]+dpm(1,i)*bpn[1]+dpm(2,i)*bpn[2]-dpm(3,i)*bpo;
+		weightDicEq[i]=dpm(3,i);
+		}
+	
+	/* Precalcule las hipotenusas de todos los triángulos de la bisección de cada tamaño de mosaico: */
+	triangleCoords.resize(maxTileSizeLog+1);
+	for(unsigned int sizeLog=1;sizeLog<=maxTileSizeLog;++sizeLog)
+		{
+		int s=1<<sizeLog;
+		int numTriangles=s*s*2-2;
+		std::vector<unsigned short>& coords=triangleCoords[sizeLog];
+		coords.reserve(numTriangles*4);
+		for(int i=0;i<numTriangles;++i)
+			{
+			/* Descienda desde uno de los dos triángulos raíz siguiendo los bits del identificador del triángulo: */
+			int id=i+2;
+			int ax=0,ay=0,bx=0,by=0,cx=0,cy=0;
+			if(id&1)
+				bx=by=cx=s;
+			else
+				ax=ay=cy=s;
+			while((id>>=1)>1)
+				{
+				int mx=(ax+bx)>>1;
+				int my=(ay+by)>>1;
+				if(id&1)
+					{
+					bx=ax;
+					by=ay;
+					ax=cx;
+					ay=cy;
+					}
+				else
+					{
+					ax=bx;
+					ay=by;
+					bx=cx;
+					by=cy;
+					}
+				cx=mx;
+				cy=my;
+				}
+			coords.push_back((unsigned short)(ax));
+			coords.push_back((unsigned short)(ay));
+			coords.push_back((unsigned short)(bx));
+			coords.push_back((unsigned short)(by));
+			}
+		}
+	
+	/* Descomponga la cuadrícula de celdas en mosaicos cuadrados: */
+	addTiles(0,0,size[0]-1,size[1]-1,maxTileSizeLog);
+	unsigned int maxGridSize=(1U<<maxTileSizeLog)+1U;
+	errors.resize(maxGridSize*maxGridSize);
+	
+	/* Asigne la cuadrícula de elevación: */
+	elevation=new float[size[1]*size[0]];
+	
+	/* Inicie el hilo de cálculo: */
+	runDecimatorThread=true;
+	decimatorThread.start(this,&SurfaceMeshDecimator::decimatorThreadMethod);
+	}
+
+SurfaceMeshDecimator::~SurfaceMeshDecimator(void)
+	{
+	/* Apague el hilo de cálculo: */
+	{
+	Threads::MutexCond::Lock inputLock(inputCond);
+	runDecimatorThread=false;
+	inputCond.signal();
+	}
+	decimatorThread.join();
+	
+	delete[] elevation;
+	}
+
+void SurfaceMeshDecimator::receiveDepthImage(const Kinect::FrameBuffer& newDepthImage)
+	{
+	Threads::MutexCond::Lock inputLock(inputCond);
+	
+	/* Almacene la nueva imagen en el búfer de entrada: */
+	inputFrame=newDepthImage;
+	++inputFrameVersion;
+	
+	/* Señale el hilo de fondo: */
+	inputCond.signal();
+	}
@@ -0,0 +1,110 @@
+/***********************************************************************
+SurfaceMeshDecimator - Clase para construir en un hilo de fondo mallas
+diezmadas con error acotado de la superficie de arena, como listas de
+índices de triángulos sobre la plantilla de vértices de resolución
+completa, en dos niveles de detalle.
+Copyright (c) 2012-2016 Oliver Kreylos
+Copyright (c) 2026 Sergio081096
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#ifndef SURFACEMESHDECIMATOR_INCLUDED
+#define SURFACEMESHDECIMATOR_INCLUDED
+
+#include <vector>
+#include <Threads/MutexCond.h>
+#include <Threads/Thread.h>
+#include <Threads/TripleBuffer.h>
+#include <GL/gl.h>
+#include <Kinect/FrameBuffer.h>
+
+#include "Types.h"
+
+class SurfaceMeshDecimator
+	{
+	/* Clases integradas: */
+	private:
+	struct Tile // Estructura para un mosaico cuadrado de la cuadrícula, con un lado de potencia de dos celdas
+		{
+		/* Elementos: */
+		public:
+		unsigned int origin[2]; // Índices de la celda inferior izquierda del mosaico
+		unsigned int sizeLog; // Logaritmo en base dos del lado del mosaico en celdas
+		std::vector<GLuint> indices[2]; // Índices de triángulos actuales del mosaico en los niveles fino y grueso
+		};
+	
+	struct Mesh // Estructura para un par de mallas diezmadas publicado por el hilo de fondo
+		{
+		/* Elementos: */
+		public:
+		std::vector<GLuint> indices[2]; // Índices de triángulos de las mallas fina y gruesa
+		};
+	
+	/* Elementos: */
+	unsigned int size[2]; // Ancho y alto de la cuadrícula de vértices, igual al tamaño de las imágenes de profundidad
+	double basePlaneDicEq[4]; // Ecuación del plano base en el espacio de imagen de profundidad
+	double weightDicEq[4]; // Ecuación para calcular el peso de un punto del espacio de imagen de profundidad en el espacio de la cámara
+	float maxErrors[2]; // Errores máximos de elevación de las mallas fina y gruesa
+	float changeThreshold; // Cambio mínimo de elevación para marcar un mosaico como modificado
+	std::vector<std::vector<unsigned short> > triangleCoords; // Coordenadas de los vértices de la hipotenusa de todos los triángulos de la bisección de un mosaico, por tamaño de mosaico
+	
+	/* Estado del cálculo, solo usado por el hilo de fondo: */
+	std::vector<Tile> tiles; // Descomposición de la cuadrícula en mosaicos cuadrados
+	float* elevation; // Cuadrícula de elevación usada para las mallas actuales
+	std::vector<float> errors; // Errores de aproximación por vértice del mosaico que se está procesando
+	bool haveElevation; // Marcar si la cuadrícula de elevación ya fue inicializada
+	
+	/* Estado del hilo de cálculo: */
+	Threads::MutexCond inputCond; // Variable de condición para señalar la llegada de una nueva imagen de profundidad
+	Kinect::FrameBuffer inputFrame; // La imagen de profundidad más reciente
+	unsigned int inputFrameVersion; // Número de versión de la imagen de profundidad de entrada
+	volatile bool runDecimatorThread; // Marcar para mantener en ejecución el hilo de cálculo de fondo
+	Threads::Thread decimatorThread; // El hilo de cálculo de fondo
+	
+	/* Estado de salida: */
+	Threads::TripleBuffer<Mesh> meshes; // Triple buffer de pares de mallas diezmadas
+	
+	/* Métodos privados: */
+	void addTiles(unsigned int x0,unsigned int y0,unsigned int width,unsigned int height,unsigned int maxSizeLog); // Descompone el rectángulo de celdas dado en mosaicos cuadrados
+	void processTriangle(const Tile& tile,int level,int ax,int ay,int bx,int by,int cx,int cy,std::vector<GLuint>& indices) const; // Refina recursivamente un triángulo de un mosaico hasta el error máximo del nivel dado
+	bool checkTile(const Tile& tile,const float* frameData) const; // Devuelve verdadero si alguna elevación del mosaico cambió más que el umbral
+	void processTile(Tile& tile,const float* frameData); // Acepta las nuevas elevaciones de un mosaico y vuelve a diezmarlo
+	void* decimatorThreadMethod(void); // Método para el hilo de cálculo de fondo
+	
+	/* Constructores y destructores: */
+	public:
+	SurfaceMeshDecimator(const unsigned int sSize[2],const PTransform& depthProjection,const Plane& basePlane,float fineError,float coarseError,unsigned int maxTileSizeLog=6); // Crea un diezmador para imágenes de profundidad del tamaño dado con los errores máximos de elevación en unidades del espacio de la cámara
+	private:
+	SurfaceMeshDecimator(const SurfaceMeshDecimator& source); // Prohibir copia constructor
+	SurfaceMeshDecimator& operator=(const SurfaceMeshDecimator& source); // Prohibir operador de asignación
+	public:
+	~SurfaceMeshDecimator(void);
+	
+	/* Métodos: */
+	void receiveDepthImage(const Kinect::FrameBuffer& newDepthImage); // Llamado para recibir una nueva imagen de profundidad
+	bool lockNewMesh(void) // Bloquea el par de mallas más reciente; devuelve verdadero si es nuevo
+		{
+		return meshes.lockNewValue();
+		}
+	const std::vector<GLuint>& getIndices(int level) const // Devuelve los índices de triángulos de la malla bloqueada del nivel dado; 0 es fino y 1 es grueso
+		{
+		return meshes.getLockedValue().indices[level];
+		}
+	};
+
+#endif
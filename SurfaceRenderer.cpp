@@ -22,12 +22,15 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 
 #include "SurfaceRenderer.h"
 
+#include <string.h>
+#include <strings.h>
 #include <string>
 #include <vector>
 #include <iostream>
 #include <Misc/PrintInteger.h>
 #include <Misc/ThrowStdErr.h>
 #include <Misc/MessageLogger.h>
+#include <Realtime/Time.h>
 #include <GL/gl.h>
 #include <GL/GLVertexArrayParts.h>
 #include <GL/Extensions/GLARBFragmentShader.h>
@@ -47,6 +50,8 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 #include "ElevationColorMap.h"
 #include "DEM.h"
 #include "WaterTable2.h"
+#include "FlowAccumulator.h"
+#include "ContourGenerator.h"
 #include "ShaderHelper.h"
 #include "Config.h"
 
@@ -55,15 +60,19 @@ Methods of class SurfaceRenderer::DataItem:
 ******************************************/
 
 SurfaceRenderer::DataItem::DataItem(void)
-	:contourLineFramebufferObject(0),
-	contourLineDepthBufferObject(0),
-	contourLineColorTextureObject(0),
-	contourLineVersion(0),
+	:contourLineUseCounter(0),
+	surfaceShaders(17),
+	shaderSourceVersion(0),
+	numShaderCompiles(0),
+	shaderCompileTime(0.0),
+	appearanceBaseFeatures(0),
+	nextAppearance(~0x0U),
 	heightMapShader(0),
 	surfaceSettingsVersion(0),
 	lightTrackerVersion(0),
 	globalAmbientHeightMapShader(0),
-	shadowedIlluminatedHeightMapShader(0)
+	shadowedIlluminatedHeightMapShader(0),
+	shadowTexture(0)
 	{
 	/* Inicialice todas las extensiones requeridas: */
 	GLARBFragmentShader::initExtension();
@@ -74,515 +83,830 @@ SurfaceRenderer::DataItem::DataItem(void)
 	GLARBTextureRg::initExtension();
 	GLARBVertexShader::initExtension();
 	GLEXTFramebufferObject::initExtension();
+	
+	/* Inicialice la transformación del mapa de sombras a la identidad: */
+	for(int i=0;i<16;++i)
+		shadowTextureMatrix[i]=i%5==0?1.0f:0.0f;
 	}
 
 SurfaceRenderer::DataItem::~DataItem(void)
 	{
 	/* Libere todos los búferes, texturas y sombreadores asignados: */
-	glDeleteFramebuffersEXT(1,&contourLineFramebufferObject);
-	glDeleteRenderbuffersEXT(1,&contourLineDepthBufferObject);
-	glDeleteTextures(1,&contourLineColorTextureObject);
-	glDeleteObjectARB(heightMapShader);
+	deleteContourLineBuffers();
+	for(SurfaceShaderCache::Iterator ssIt=surfaceShaders.begin();!ssIt.isFinished();++ssIt)
+		glDeleteObjectARB(ssIt->getDest().shader);
 	glDeleteObjectARB(globalAmbientHeightMapShader);
 	glDeleteObjectARB(shadowedIlluminatedHeightMapShader);
 	}
 
+void SurfaceRenderer::DataItem::deleteContourLineBuffers(void)
+	{
+	for(std::vector<ContourLineBuffer>::iterator clbIt=contourLineBuffers.begin();clbIt!=contourLineBuffers.end();++clbIt)
+		{
+		glDeleteFramebuffersEXT(1,&clbIt->framebufferObject);
+		glDeleteRenderbuffersEXT(1,&clbIt->depthBufferObject);
+		glDeleteTextures(1,&clbIt->colorTextureObject);
+		}
+	contourLineBuffers.clear();
+	}
+
 /********************************
 Methods of class SurfaceRenderer:
 ********************************/
 
+void SurfaceRenderer::loadShaderSources(void)
+	{
+	/* Lea primero todos los códigos fuente para que un error deje intactos los anteriores: */
+	std::string newContourLinesSource=readFragmentShaderSource("SurfaceAddContourLines");
+	std::string newAnalyticContourLinesSource=readFragmentShaderSource("SurfaceAddAnalyticContourLines");
+	std::string newIlluminateSource=readFragmentShaderSource("SurfaceIlluminate");
+	std::vector<std::string> newWaterAppearanceSources;
+	newWaterAppearanceSources.push_back(readFragmentShaderSource("SurfaceAddWaterColor"));
+	for(std::vector<std::string>::const_iterator wanIt=waterAppearanceNames.begin()+1;wanIt!=waterAppearanceNames.end();++wanIt)
+		newWaterAppearanceSources.push_back(readFragmentShaderSource(("SurfaceAddWaterColor-"+*wanIt).c_str()));
+	
+	/* Instale los nuevos códigos fuente: */
+	contourLinesSource.swap(newContourLinesSource);
+	analyticContourLinesSource.swap(newAnalyticContourLinesSource);
+	illuminateSource.swap(newIlluminateSource);
+	waterAppearanceSources.swap(newWaterAppearanceSources);
+	}
+
 void SurfaceRenderer::shaderSourceFileChanged(const IO::FileMonitor::Event& event)
 	{
 	std::cout<<"16.~: ShaderSourceFileChanged" << std::endl;
-	/* Invalide el sombreador de superficie de un solo paso: */
+	/* Vuelva a leer los códigos fuente de los sombreadores externos: */
+	try
+		{
+		loadShaderSources();
+		}
+	catch(const std::runtime_error& err)
+		{
+		Misc::formattedUserError("SurfaceRenderer: Caught exception %s while reloading shader source files",err.what());
+		return;
+		}
+	
+	/* Descarte los binarios de programas en disco construidos a partir de los archivos de origen anteriores: */
+	invalidateShaderCache();
+	
+	/* Invalide todas las variantes del sombreador de superficie de un solo paso: */
+	++shaderSourceVersion;
 	++surfaceSettingsVersion;
 	}
 
-GLhandleARB SurfaceRenderer::createSinglePassSurfaceShader(const GLLightTracker& lt,GLint* uniformLocations) const
+GLhandleARB SurfaceRenderer::createSinglePassSurfaceShader(const GLLightTracker& lt,unsigned int appearance,GLint* uniformLocations) const
 	{
-	GLhandleARB result=0;
+	/* Reúna los códigos fuente de todos los sombreadores para buscar el programa en la caché de binarios: */
+	ShaderSourceList shaders;
+	
+	/****************************************************************************
+	Ensamble y compile el sombreado de vértices de representación de superficie:
+	****************************************************************************/
+	
+	/* Ensamble las cadenas de función y declaración: */
+	std::string vertexFunctions="\
+		#extension GL_ARB_texture_rectangle : enable\n";
+	
+	std::string vertexUniforms="\
+		uniform sampler2DRect depthSampler; // Sampler for the depth image-space elevation texture\n\
+		uniform mat4 depthProjection; // Transformation from depth image space to camera space\n\
+		uniform mat4 projectionModelviewDepthProjection; // Transformation from depth image space to clip space\n";
+	
+	std::string vertexVaryings;
+	
+	/* Ensamble la función principal de sombreadores de vértices: */
+	std::string vertexMain="\
+		void main()\n\
+			{\n\
+			/* Get the vertex' depth image-space z coordinate from the texture: */\n\
+			vec4 vertexDic=gl_Vertex;\n\
+			vertexDic.z=texture2DRect(depthSampler,gl_Vertex.xy).r;\n\
+			\n\
+			/* Transform the vertex from depth image space to camera space and normalize it: */\n\
+			vec4 vertexCc=depthProjection*vertexDic;\n\
+			vertexCc/=vertexCc.w;\n\
+			\n";
 	
-	std::vector<GLhandleARB> shaders;
-	try
+	if(dem!=0)
 		{
-		/****************************************************************************
-		Ensamble y compile el sombreado de vértices de representación de superficie:
-		****************************************************************************/
-		
-		/* Ensamble las cadenas de función y declaración: */
-		std::string vertexFunctions="\
-			#extension GL_ARB_texture_rectangle : enable\n";
+		/* Agregue el código coincidente de DEM a la función principal del sombreador de vértice: */
+		vertexUniforms+="\
+			uniform mat4 demTransform; // Transformation from camera space to DEM space\n\
+			uniform sampler2DRect demSampler; // Sampler for the DEM texture\n\
+			uniform float demDistScale; // Distance from surface to DEM at which the color map saturates\n";
 		
-		std::string vertexUniforms="\
-			uniform sampler2DRect depthSampler; // Sampler for the depth image-space elevation texture\n\
-			uniform mat4 depthProjection; // Transformation from depth image space to camera space\n\
-			uniform mat4 projectionModelviewDepthProjection; // Transformation from depth image space to clip space\n";
+		vertexVaryings+="\
+			varying float demDist; // Scaled signed distance from surface to DEM\n";
 		
-		std::string vertexVaryings;
-		
-		/* Ensamble la función principal de sombreadores de vértices: */
-		std::string vertexMain="\
-			void main()\n\
-				{\n\
-				/* Get the vertex' depth image-space z coordinate from the texture: */\n\
-				vec4 vertexDic=gl_Vertex;\n\
-				vertexDic.z=texture2DRect(depthSampler,gl_Vertex.xy).r;\n\
-				\n\
-				/* Transform the vertex from depth image space to camera space and normalize it: */\n\
-				vec4 vertexCc=depthProjection*vertexDic;\n\
-				vertexCc/=vertexCc.w;\n\
-				\n";
-		
-		if(dem!=0)
+		/* Agregue el código coincidente de DEM a la función principal de sombreadores de vértices: */
+		vertexMain+="\
+			/* Transform the camera-space vertex to scaled DEM space: */\n\
+			vec4 vertexDem=demTransform*vertexCc;\n\
+			\n\
+			/* Calculate scaled DEM-surface distance: */\n\
+			demDist=(vertexDem.z-texture2DRect(demSampler,vertexDem.xy).r)*demDistScale;\n\
+			\n";
+		}
+	else
+		{
+		if(elevationColorMap!=0)
 			{
-			/* Agregue el código coincidente de DEM a la función principal del sombreador de vértice: */
+			/* Agregue declaraciones para el mapeo de altura: */
 			vertexUniforms+="\
-				uniform mat4 demTransform; // Transformation from camera space to DEM space\n\
-				uniform sampler2DRect demSampler; // Sampler for the DEM texture\n\
-				uniform float demDistScale; // Distance from surface to DEM at which the color map saturates\n";
+				uniform vec4 heightColorMapPlaneEq; // Plane equation of the base plane in camera space, scaled for height map textures\n";
 			
 			vertexVaryings+="\
-				varying float demDist; // Scaled signed distance from surface to DEM\n";
+				varying float heightColorMapTexCoord; // Texture coordinate for the height color map\n";
 			
-			/* Agregue el código coincidente de DEM a la función principal de sombreadores de vértices: */
+			/* Agregue el código de asignación de altura a la función principal del sombreador de vértice: */
 			vertexMain+="\
-				/* Transform the camera-space vertex to scaled DEM space: */\n\
-				vec4 vertexDem=demTransform*vertexCc;\n\
-				\n\
-				/* Calculate scaled DEM-surface distance: */\n\
-				demDist=(vertexDem.z-texture2DRect(demSampler,vertexDem.xy).r)*demDistScale;\n\
+				/* Plug camera-space vertex into the scaled and offset base plane equation: */\n\
+				heightColorMapTexCoord=dot(heightColorMapPlaneEq,vertexCc);\n\
 				\n";
 			}
-		else
+		
+		if(drawDippingBed)
 			{
-			if(elevationColorMap!=0)
+			/* Agregue las declaraciones para la representación de la cama de inmersión: */
+			if(dippingBedFolded)
 				{
-				/* Agregue declaraciones para el mapeo de altura: */
 				vertexUniforms+="\
-					uniform vec4 heightColorMapPlaneEq; // Plane equation of the base plane in camera space, scaled for height map textures\n";
-				
-				vertexVaryings+="\
-					varying float heightColorMapTexCoord; // Texture coordinate for the height color map\n";
-				
-				/* Agregue el código de asignación de altura a la función principal del sombreador de vértice: */
+					uniform float dbc[5]; // Dipping bed coefficients\n";
+				}
+			else
+				{
+				vertexUniforms+="\
+					uniform vec4 dippingBedPlaneEq; // Plane equation of the dipping bed\n";
+				}
+			
+			vertexVaryings+="\
+				varying float dippingBedDistance; // Vertex distance to dipping bed\n";
+			
+			/* Agregue el código de la cama de inmersión a la función principal del sombreador de vértice: */
+			if(dippingBedFolded)
+				{
 				vertexMain+="\
-					/* Plug camera-space vertex into the scaled and offset base plane equation: */\n\
-					heightColorMapTexCoord=dot(heightColorMapPlaneEq,vertexCc);\n\
+					/* Calculate distance from camera-space vertex to dipping bed equation: */\n\
+					dippingBedDistance=vertexCc.z-(((1.0-dbc[3])+cos(dbc[0]*vertexCc.x)*dbc[3])*sin(dbc[1]*vertexCc.y)*dbc[2]+dbc[4]);\n\
 					\n";
 				}
-			
-			if(drawDippingBed)
+			else
 				{
-				/* Agregue las declaraciones para la representación de la cama de inmersión: */
-				if(dippingBedFolded)
-					{
-					vertexUniforms+="\
-						uniform float dbc[5]; // Dipping bed coefficients\n";
-					}
-				else
-					{
-					vertexUniforms+="\
-						uniform vec4 dippingBedPlaneEq; // Plane equation of the dipping bed\n";
-					}
-				
-				vertexVaryings+="\
-					varying float dippingBedDistance; // Vertex distance to dipping bed\n";
-				
-				/* Agregue el código de la cama de inmersión a la función principal del sombreador de vértice: */
-				if(dippingBedFolded)
-					{
-					vertexMain+="\
-						/* Calculate distance from camera-space vertex to dipping bed equation: */\n\
-						dippingBedDistance=vertexCc.z-(((1.0-dbc[3])+cos(dbc[0]*vertexCc.x)*dbc[3])*sin(dbc[1]*vertexCc.y)*dbc[2]+dbc[4]);\n\
-						\n";
-					}
-				else
-					{
-					vertexMain+="\
-						/* Plug camera-space vertex into the dipping bed equation: */\n\
-						dippingBedDistance=dot(dippingBedPlaneEq,vertexCc);\n\
-						\n";
-					}
+				vertexMain+="\
+					/* Plug camera-space vertex into the dipping bed equation: */\n\
+					dippingBedDistance=dot(dippingBedPlaneEq,vertexCc);\n\
+					\n";
 				}
 			}
+		}
+	
+	if(useShaderContourLines()&&analyticContourLines)
+		{
+		/* Añadir declaraciones para las líneas de contorno analíticas: */
+		vertexUniforms+="\
+			uniform vec4 contourPlaneEq; // Plane equation of the base plane in camera space\n";
+		
+		vertexVaryings+="\
+			varying float contourElevation; // Elevation of the vertex above the base plane\n";
 		
-		if(illuminate)
+		/* Agregue el código de las líneas de contorno a la función principal del sombreador de vértice: */
+		vertexMain+="\
+			/* Plug camera-space vertex into the base plane equation: */\n\
+			contourElevation=dot(contourPlaneEq,vertexCc);\n\
+			\n";
+		}
+	
+	if(illuminate)
+		{
+		/* Añadir declaraciones para la iluminación: */
+		vertexUniforms+="\
+			uniform mat4 modelview; // Transformation from camera space to eye space\n\
+			uniform mat4 tangentModelviewDepthProjection; // Transformation from depth image space to eye space for tangent planes\n";
+		
+		vertexVaryings+="\
+			varying vec4 diffColor,specColor; // Diffuse and specular colors, interpolated separately for correct highlights\n";
+		
+		/* Agregue el código de iluminación a la función principal del sombreador de vértice: */
+		vertexMain+="\
+			/* Calculate the vertex' tangent plane equation in depth image space: */\n\
+			vec4 tangentDic;\n\
+			tangentDic.x=texture2DRect(depthSampler,vec2(vertexDic.x-1.0,vertexDic.y)).r-texture2DRect(depthSampler,vec2(vertexDic.x+1.0,vertexDic.y)).r;\n\
+			tangentDic.y=texture2DRect(depthSampler,vec2(vertexDic.x,vertexDic.y-1.0)).r-texture2DRect(depthSampler,vec2(vertexDic.x,vertexDic.y+1.0)).r;\n\
+			tangentDic.z=2.0;\n\
+			tangentDic.w=-dot(vertexDic.xyz,tangentDic.xyz)/vertexDic.w;\n\
+			\n\
+			/* Transform the vertex and its tangent plane from depth image space to eye space: */\n\
+			vec4 vertexEc=modelview*vertexCc;\n\
+			vec3 normalEc=normalize((tangentModelviewDepthProjection*tangentDic).xyz);\n\
+			\n\
+			/* Initialize the color accumulators: */\n\
+			diffColor=gl_LightModel.ambient*gl_FrontMaterial.ambient;\n\
+			specColor=vec4(0.0,0.0,0.0,0.0);\n\
+			\n";
+		
+		if(useShadowMap())
 			{
-			/* Añadir declaraciones para la iluminación: */
+			/* Añadir declaraciones para el mapa de sombras: */
 			vertexUniforms+="\
-				uniform mat4 modelview; // Transformation from camera space to eye space\n\
-				uniform mat4 tangentModelviewDepthProjection; // Transformation from depth image space to eye space for tangent planes\n";
+				uniform mat4 shadowTextureMatrix; // Transformation from camera space to shadow map texture space\n";
 			
 			vertexVaryings+="\
-				varying vec4 diffColor,specColor; // Diffuse and specular colors, interpolated separately for correct highlights\n";
+				varying vec4 shadowTexCoord; // Projective texture coordinate for the shadow map\n";
 			
-			/* Agregue el código de iluminación a la función principal del sombreador de vértice: */
+			/* Agregue el código del mapa de sombras a la función principal del sombreador de vértice: */
 			vertexMain+="\
-				/* Calculate the vertex' tangent plane equation in depth image space: */\n\
-				vec4 tangentDic;\n\
-				tangentDic.x=texture2DRect(depthSampler,vec2(vertexDic.x-1.0,vertexDic.y)).r-texture2DRect(depthSampler,vec2(vertexDic.x+1.0,vertexDic.y)).r;\n\
-				tangentDic.y=texture2DRect(depthSampler,vec2(vertexDic.x,vertexDic.y-1.0)).r-texture2DRect(depthSampler,vec2(vertexDic.x,vertexDic.y+1.0)).r;\n\
-				tangentDic.z=2.0;\n\
-				tangentDic.w=-dot(vertexDic.xyz,tangentDic.xyz)/vertexDic.w;\n\
-				\n\
-				/* Transform the vertex and its tangent plane from depth image space to eye space: */\n\
-				vec4 vertexEc=modelview*vertexCc;\n\
-				vec3 normalEc=normalize((tangentModelviewDepthProjection*tangentDic).xyz);\n\
-				\n\
-				/* Initialize the color accumulators: */\n\
-				diffColor=gl_LightModel.ambient*gl_FrontMaterial.ambient;\n\
-				specColor=vec4(0.0,0.0,0.0,0.0);\n\
+				/* Transform the camera-space vertex to shadow map texture space: */\n\
+				shadowTexCoord=shadowTextureMatrix*vertexCc;\n\
 				\n";
-			
-			/* Llame a la función de acumulación de luz adecuada para cada fuente de luz habilitada: */
-			bool firstLight=true;
-			for(int lightIndex=0;lightIndex<lt.getMaxNumLights();++lightIndex)
-				if(lt.getLightState(lightIndex).isEnabled())
+			}
+		
+		/* Llame a la función de acumulación de luz adecuada para cada fuente de luz habilitada: */
+		bool firstLight=true;
+		for(int lightIndex=0;lightIndex<lt.getMaxNumLights();++lightIndex)
+			if(lt.getLightState(lightIndex).isEnabled())
+				{
+				/* Crear la función de acumulación de luz: */
+				vertexFunctions.push_back('\n');
+				vertexFunctions+=lt.createAccumulateLightFunction(lightIndex);
+				
+				if(firstLight)
 					{
-					/* Crear la función de acumulación de luz: */
-					vertexFunctions.push_back('\n');
-					vertexFunctions+=lt.createAccumulateLightFunction(lightIndex);
-					
-					if(firstLight)
-						{
-						vertexMain+="\
-							/* Call the light accumulation functions for all enabled light sources: */\n";
-						firstLight=false;
-						}
-					
-					/* Llame a la función de acumulación de luz desde la función principal del sombreador de vértice: */
 					vertexMain+="\
-						accumulateLight";
-					char liBuffer[12];
-					vertexMain.append(Misc::print(lightIndex,liBuffer+11));
-					vertexMain+="(vertexEc,normalEc,gl_FrontMaterial.ambient,gl_FrontMaterial.diffuse,gl_FrontMaterial.specular,gl_FrontMaterial.shininess,diffColor,specColor);\n";
+						/* Call the light accumulation functions for all enabled light sources: */\n";
+					firstLight=false;
 					}
-			if(!firstLight)
+				
+				/* Llame a la función de acumulación de luz desde la función principal del sombreador de vértice: */
 				vertexMain+="\
-					\n";
-			}
-		
-		if(waterTable!=0&&dem==0)
-			{
-			/* Añadir declaraciones para el manejo del agua: */
-			vertexUniforms+="\
-				uniform mat4 waterTransform; // Transformation from camera space to water level texture coordinate space\n";
-			vertexVaryings+="\
-				varying vec2 waterTexCoord; // Texture coordinate for water level texture\n";
-			
-			/* Agregue el código de manejo de agua a la función principal del sombreador de vértice: */
+					accumulateLight";
+				char liBuffer[12];
+				vertexMain.append(Misc::print(lightIndex,liBuffer+11));
+				vertexMain+="(vertexEc,normalEc,gl_FrontMaterial.ambient,gl_FrontMaterial.diffuse,gl_FrontMaterial.specular,gl_FrontMaterial.shininess,diffColor,specColor);\n";
+				}
+		if(!firstLight)
 			vertexMain+="\
-				/* Transform the vertex from camera space to water level texture coordinate space: */\n\
-				waterTexCoord=(waterTransform*vertexCc).xy;\n\
 				\n";
-			}
+		}
+	
+	if(flowAccumulator!=0&&dem==0)
+		{
+		/* Añadir declaraciones para la red de ríos: */
+		vertexVaryings+="\
+			varying vec2 riverTexCoord; // Texture coordinate for the river mask texture\n";
 		
-		/* Termina la función principal del sombreador de vértices: */
+		/* Agregue el código de la red de ríos a la función principal del sombreador de vértice: */
 		vertexMain+="\
-				/* Transform vertex from depth image space to clip space: */\n\
-				gl_Position=projectionModelviewDepthProjection*vertexDic;\n\
-				}\n";
-		
-		/* Compila el sombreador de vértices: */
-		shaders.push_back(glCompileVertexShaderFromStrings(7,vertexFunctions.c_str(),"\t\t\n",vertexUniforms.c_str(),"\t\t\n",vertexVaryings.c_str(),"\t\t\n",vertexMain.c_str()));
-		
-		/*********************************************************************************
-		Ensamble y compile los sombreadores de fragmentos de representación de superficie:
-		*********************************************************************************/
-		
-		/* Ensamble las declaraciones de función del sombreador de fragmentos: */
-		std::string fragmentDeclarations;
-		
-		/* Ensamble las diversas variables y uniformes del fragmento de sombreado: */
-		std::string fragmentUniforms;
-		std::string fragmentVaryings;
+			/* The river mask is defined in depth image space: */\n\
+			riverTexCoord=vertexDic.xy;\n\
+			\n";
+		}
+	
+	if(waterTable!=0&&dem==0)
+		{
+		/* Añadir declaraciones para el manejo del agua: */
+		vertexUniforms+="\
+			uniform mat4 waterTransform; // Transformation from camera space to water level texture coordinate space\n";
+		vertexVaryings+="\
+			varying vec2 waterTexCoord; // Texture coordinate for water level texture\n";
 		
-		/* Ensamble la función principal del sombreador de fragmentos: */
-		std::string fragmentMain="\
-			void main()\n\
-				{\n";
+		/* Agregue el código de manejo de agua a la función principal del sombreador de vértice: */
+		vertexMain+="\
+			/* Transform the vertex from camera space to water level texture coordinate space: */\n\
+			waterTexCoord=(waterTransform*vertexCc).xy;\n\
+			\n";
+		}
+	
+	/* Termina la función principal del sombreador de vértices: */
+	vertexMain+="\
+			/* Transform vertex from depth image space to clip space: */\n\
+			gl_Position=projectionModelviewDepthProjection*vertexDic;\n\
+			}\n";
+	
+	/* Compila el sombreador de vértices: */
+	shaders.addVertexShader(vertexFunctions+"\t\t\n"+vertexUniforms+"\t\t\n"+vertexVaryings+"\t\t\n"+vertexMain);
+	
+	/*********************************************************************************
+	Ensamble y compile los sombreadores de fragmentos de representación de superficie:
+	*********************************************************************************/
+	
+	/* Ensamble las declaraciones de función del sombreador de fragmentos: */
+	std::string fragmentDeclarations;
+	
+	/* Ensamble las diversas variables y uniformes del fragmento de sombreado: */
+	std::string fragmentUniforms;
+	std::string fragmentVaryings;
+	
+	/* Ensamble la función principal del sombreador de fragmentos: */
+	std::string fragmentMain="\
+		void main()\n\
+			{\n";
+	
+	if(dem!=0)
+		{
+		/* Añadir declaraciones para la coincidencia de DEM: */
+		fragmentVaryings+="\
+			varying float demDist; // Scaled signed distance from surface to DEM\n";
 		
-		if(dem!=0)
+		/* Agregue el código coincidente de DEM a la función principal del sombreador de fragmentos: */
+		fragmentMain+="\
+			/* Calculate the fragment's color from a double-ramp function: */\n\
+			vec4 baseColor;\n\
+			if(demDist<0.0)\n\
+				baseColor=mix(vec4(1.0,1.0,1.0,1.0),vec4(1.0,0.0,0.0,1.0),min(-demDist,1.0));\n\
+			else\n\
+				baseColor=mix(vec4(1.0,1.0,1.0,1.0),vec4(0.0,0.0,1.0,1.0),min(demDist,1.0));\n\
+			\n";
+		}
+	else
+		{
+		if(elevationColorMap!=0)
 			{
-			/* Añadir declaraciones para la coincidencia de DEM: */
+			/* Agregue declaraciones para el mapeo de altura: */
+			fragmentUniforms+="\
+				uniform sampler1D heightColorMapSampler;\n";
 			fragmentVaryings+="\
-				varying float demDist; // Scaled signed distance from surface to DEM\n";
+				varying float heightColorMapTexCoord; // Texture coordinate for the height color map\n";
 			
-			/* Agregue el código coincidente de DEM a la función principal del sombreador de fragmentos: */
+			/* Agregue el código de asignación de altura a la función principal del sombreador de fragmentos: */
 			fragmentMain+="\
-				/* Calculate the fragment's color from a double-ramp function: */\n\
-				vec4 baseColor;\n\
-				if(demDist<0.0)\n\
-					baseColor=mix(vec4(1.0,1.0,1.0,1.0),vec4(1.0,0.0,0.0,1.0),min(-demDist,1.0));\n\
-				else\n\
-					baseColor=mix(vec4(1.0,1.0,1.0,1.0),vec4(0.0,0.0,1.0,1.0),min(demDist,1.0));\n\
+				/* Get the fragment's color from the height color map: */\n\
+				vec4 baseColor=texture1D(heightColorMapSampler,heightColorMapTexCoord);\n\
 				\n";
 			}
 		else
 			{
-			if(elevationColorMap!=0)
-				{
-				/* Agregue declaraciones para el mapeo de altura: */
-				fragmentUniforms+="\
-					uniform sampler1D heightColorMapSampler;\n";
-				fragmentVaryings+="\
-					varying float heightColorMapTexCoord; // Texture coordinate for the height color map\n";
-				
-				/* Agregue el código de asignación de altura a la función principal del sombreador de fragmentos: */
-				fragmentMain+="\
-					/* Get the fragment's color from the height color map: */\n\
-					vec4 baseColor=texture1D(heightColorMapSampler,heightColorMapTexCoord);\n\
-					\n";
-				}
-			else
-				{
-				fragmentMain+="\
-					/* Set the surface's base color to white: */\n\
-					vec4 baseColor=vec4(1.0,1.0,1.0,1.0);\n\
-					\n";
-				}
-			
-			if(drawDippingBed)
-				{
-				/* Agregue las declaraciones para la representación de la cama de inmersión: */
-				fragmentUniforms+="\
-					uniform float dippingBedThickness; // Thickness of dipping bed in camera-space units\n";
-				
-				fragmentVaryings+="\
-					varying float dippingBedDistance; // Vertex distance to dipping bed plane\n";
-				
-				/* Agregue el código de la cama de inmersión para fragmentar la función principal del sombreador: */
-				fragmentMain+="\
-					/* Check fragment's dipping plane distance against dipping bed thickness: */\n\
-					float w=fwidth(dippingBedDistance)*1.0;\n\
-					if(dippingBedDistance<0.0)\n\
-						baseColor=mix(baseColor,vec4(1.0,0.0,0.0,1.0),smoothstep(-dippingBedThickness*0.5-w,-dippingBedThickness*0.5+w,dippingBedDistance));\n\
-					else\n\
-						baseColor=mix(vec4(1.0,0.0,0.0,1.0),baseColor,smoothstep(dippingBedThickness*0.5-w,dippingBedThickness*0.5+w,dippingBedDistance));\n\
-					\n";
-				}
+			fragmentMain+="\
+				/* Set the surface's base color to white: */\n\
+				vec4 baseColor=vec4(1.0,1.0,1.0,1.0);\n\
+				\n";
 			}
 		
-		if(drawContourLines)// Importante
+		if(drawDippingBed)
 			{
-			/* Declare the contour line function: */
-			fragmentDeclarations+="\
-				void addContourLines(in vec2,inout vec4);\n";
+			/* Agregue las declaraciones para la representación de la cama de inmersión: */
+			fragmentUniforms+="\
+				uniform float dippingBedThickness; // Thickness of dipping bed in camera-space units\n";
 			
-			/* Declara la función de la línea de contorno: */
-			shaders.push_back(compileFragmentShader("SurfaceAddContourLines"));
+			fragmentVaryings+="\
+				varying float dippingBedDistance; // Vertex distance to dipping bed plane\n";
 			
-			/* Llamar a la función de línea de contorno desde la función principal del fragmento shader: */
+			/* Agregue el código de la cama de inmersión para fragmentar la función principal del sombreador: */
 			fragmentMain+="\
-				/* Modulate the base color by contour line color: */\n\
-				addContourLines(gl_FragCoord.xy,baseColor);\n\
+				/* Check fragment's dipping plane distance against dipping bed thickness: */\n\
+				float w=fwidth(dippingBedDistance)*1.0;\n\
+				if(dippingBedDistance<0.0)\n\
+					baseColor=mix(baseColor,vec4(1.0,0.0,0.0,1.0),smoothstep(-dippingBedThickness*0.5-w,-dippingBedThickness*0.5+w,dippingBedDistance));\n\
+				else\n\
+					baseColor=mix(vec4(1.0,0.0,0.0,1.0),baseColor,smoothstep(dippingBedThickness*0.5-w,dippingBedThickness*0.5+w,dippingBedDistance));\n\
 				\n";
 			}
 		
-		if(illuminate)
+		if(flowAccumulator!=0)
 			{
-			/* Declara la función de iluminación: */
-			fragmentDeclarations+="\
-				void illuminate(inout vec4);\n";
+			/* Agregue las declaraciones para la red de ríos: */
+			fragmentUniforms+="\
+				uniform sampler2DRect riverMaskSampler; // Sampler for the river mask texture\n";
 			
-			/* Compila el sombreador de iluminación: */
-			shaders.push_back(compileFragmentShader("SurfaceIlluminate"));
+			fragmentVaryings+="\
+				varying vec2 riverTexCoord; // Texture coordinate for the river mask texture\n";
 			
-			/* Función de iluminación de llamada de la función principal del fragmento shader: */
+			/* Agregue el código de la red de ríos a la función principal del sombreador de fragmentos: */
 			fragmentMain+="\
-				/* Apply illumination to the base color: */\n\
-				illuminate(baseColor);\n\
+				/* Blend the river color into the base color by the river mask intensity: */\n\
+				float river=texture2DRect(riverMaskSampler,riverTexCoord).r;\n\
+				baseColor=mix(baseColor,vec4(0.1,0.35,0.9,1.0),river*0.8);\n\
 				\n";
 			}
-		if(!lava)
-		{
-			if((waterTable != 0) && (dem == 0))
-			{
-				/* Declarar las funciones de manejo de agua: */
-				fragmentDeclarations+="\
-					void addWaterColor(in vec2,inout vec4);\n\
-					void addWaterColorAdvected(inout vec4);\n";
-				
-				/* Compile the water handling shader: */
-				shaders.push_back(compileFragmentShader("SurfaceAddWaterColor"));
-				
-				/* Compilar el shader de manejo de agua: */
-				if(advectWaterTexture)
-				{
-					fragmentMain+="\
-						/* Modulate the base color with water color: */\n\
-						addWaterColorAdvected(baseColor);\n\
-						\n";
-				}
-				else
-				{
-					fragmentMain+="\
-						/* Modulate the base color with water color: */\n\
-						addWaterColor(gl_FragCoord.xy,baseColor);\n\
-						\n";
-				}
-			}
 		}
-		else
+	
+	if(useShaderContourLines()&&analyticContourLines)
 		{
-			if((waterTable != 0) && (dem == 0))
-			{
-				/* Declarar las funciones de manejo de agua: */
-				fragmentDeclarations+="\
-					void addWaterColor(in vec2,inout vec4);\n\
-					void addWaterColorAdvected(inout vec4);\n";
-				
-				/* Compile the water handling shader: */
-				shaders.push_back(compileFragmentShader("SurfaceAddWaterColor-Lava"));
-				
-				/* Compilar el shader de manejo de agua: */
-				if(advectWaterTexture)
-				{
-					fragmentMain+="\
-						/* Modulate the base color with water color: */\n\
-						addWaterColorAdvected(baseColor);\n\
-						\n";
-				}
-				else
-				{
-					fragmentMain+="\
-						/* Modulate the base color with water color: */\n\
-						addWaterColor(gl_FragCoord.xy,baseColor);\n\
-						\n";
-				}
-			}
-		}
-
-		/* Termina la función principal del sombreador de fragmentos: */
-		fragmentMain+="\
-			/* Assign the final color to the fragment: */\n\
-			gl_FragColor=baseColor;\n\
-			}\n";
+		/* Declara la función de la línea de contorno analítica: */
+		fragmentDeclarations+="\
+			void addContourLines(in float,inout vec4);\n";
 		
-		/* Compila el fragmento shader: */
-		shaders.push_back(glCompileFragmentShaderFromStrings(7,fragmentDeclarations.c_str(),"\t\t\n",fragmentUniforms.c_str(),"\t\t\n",fragmentVaryings.c_str(),"\t\t\n",fragmentMain.c_str()));
+		fragmentVaryings+="\
+			varying float contourElevation; // Elevation of the fragment above the base plane\n";
 		
-		/* Enlace el programa de sombreado: */
-		result=glLinkShader(shaders);
+		/* Compila el sombreador de líneas de contorno analíticas: */
+		shaders.addFragmentShader(analyticContourLinesSource);
 		
-		/* Suelte todos los sombreadores compilados: */
-		for(std::vector<GLhandleARB>::iterator shIt=shaders.begin();shIt!=shaders.end();++shIt)
-			glDeleteObjectARB(*shIt);
+		/* Llamar a la función de línea de contorno desde la función principal del fragmento shader: */
+		fragmentMain+="\
+			/* Modulate the base color by contour line color: */\n\
+			addContourLines(contourElevation,baseColor);\n\
+			\n";
+		}
+	else if(useShaderContourLines())// Importante
+		{
+		/* Declare the contour line function: */
+		fragmentDeclarations+="\
+			void addContourLines(in vec2,inout vec4);\n";
+		
+		/* Declara la función de la línea de contorno: */
+		shaders.addFragmentShader(contourLinesSource);
+		
+		/* Llamar a la función de línea de contorno desde la función principal del fragmento shader: */
+		fragmentMain+="\
+			/* Modulate the base color by contour line color: */\n\
+			addContourLines(gl_FragCoord.xy,baseColor);\n\
+			\n";
+		}
+	
+	if(illuminate)
+		{
+		/* Declara la función de iluminación: */
+		fragmentDeclarations+="\
+			void illuminate(inout vec4);\n";
 		
-		/*******************************************************************
-		Consulta las ubicaciones uniformes del programa de sombreado:
-		*******************************************************************/
+		/* Compila el sombreador de iluminación: */
+		shaders.addFragmentShader(illuminateSource);
 		
-		GLint* ulPtr=uniformLocations;
+		/* Función de iluminación de llamada de la función principal del fragmento shader: */
+		fragmentMain+="\
+			/* Apply illumination to the base color: */\n\
+			illuminate(baseColor);\n\
+			\n";
 		
-		/* Consulta variables uniformes comunes: */
-		*(ulPtr++)=glGetUniformLocationARB(result,"depthSampler");
-		*(ulPtr++)=glGetUniformLocationARB(result,"depthProjection");
-		if(dem!=0)
+		if(useShadowMap())
 			{
-			/* Consultar variables uniformes de DEM coincidentes: */
-			*(ulPtr++)=glGetUniformLocationARB(result,"demTransform");
-			*(ulPtr++)=glGetUniformLocationARB(result,"demSampler");
-			*(ulPtr++)=glGetUniformLocationARB(result,"demDistScale");
+			/* Añadir declaraciones para el mapa de sombras: */
+			fragmentUniforms+="\
+				uniform sampler2DShadow shadowSampler; // Sampler for the shadow map depth texture\n";
+			
+			fragmentVaryings+="\
+				varying vec4 shadowTexCoord; // Projective texture coordinate for the shadow map\n";
+			
+			/* Agregue el código del mapa de sombras a la función principal del sombreador de fragmentos: */
+			fragmentMain+="\
+				/* Darken the illuminated color where the surface is in shadow: */\n\
+				float lit=shadow2DProj(shadowSampler,shadowTexCoord).r;\n\
+				baseColor.rgb*=0.5+0.5*lit;\n\
+				\n";
 			}
-		else if(elevationColorMap!=0)
+		}
+	if(!lava)
+	{
+		if((waterTable != 0) && (dem == 0))
+		{
+			/* Declarar las funciones de manejo de agua: */
+			fragmentDeclarations+="\
+				void addWaterColor(in vec2,inout vec4);\n\
+				void addWaterColorAdvected(inout vec4);\n";
+			
+			/* Compile the water handling shader: */
+			shaders.addFragmentShader(waterAppearanceSources[appearance]);
+			
+			/* Compilar el shader de manejo de agua: */
+			if(advectWaterTexture)
 			{
-			/* Variable de consulta de asignación de color variables uniformes: */
-			*(ulPtr++)=glGetUniformLocationARB(result,"heightColorMapPlaneEq");
-			*(ulPtr++)=glGetUniformLocationARB(result,"heightColorMapSampler");
+				fragmentMain+="\
+					/* Modulate the base color with water color: */\n\
+					addWaterColorAdvected(baseColor);\n\
+					\n";
 			}
-		if(drawContourLines)
+			else
 			{
-			*(ulPtr++)=glGetUniformLocationARB(result,"pixelCornerElevationSampler");
-			*(ulPtr++)=glGetUniformLocationARB(result,"contourLineFactor");
+				fragmentMain+="\
+					/* Modulate the base color with water color: */\n\
+					addWaterColor(gl_FragCoord.xy,baseColor);\n\
+					\n";
 			}
-		if(drawDippingBed)
+		}
+	}
+	else
+	{
+		if((waterTable != 0) && (dem == 0))
+		{
+			/* Declarar las funciones de manejo de agua: */
+			fragmentDeclarations+="\
+				void addWaterColor(in vec2,inout vec4);\n\
+				void addWaterColorAdvected(inout vec4);\n";
+			
+			/* Compile the water handling shader: */
+			shaders.addFragmentShader(waterAppearanceSources[lavaAppearance]);
+			
+			/* Compilar el shader de manejo de agua: */
+			if(advectWaterTexture)
 			{
-			if(dippingBedFolded)
-				*(ulPtr++)=glGetUniformLocationARB(result,"dbc");
+				fragmentMain+="\
+					/* Modulate the base color with water color: */\n\
+					addWaterColorAdvected(baseColor);\n\
+					\n";
+			}
 			else
-				*(ulPtr++)=glGetUniformLocationARB(result,"dippingBedPlaneEq");
-			*(ulPtr++)=glGetUniformLocationARB(result,"dippingBedThickness");
+			{
+				fragmentMain+="\
+					/* Modulate the base color with water color: */\n\
+					addWaterColor(gl_FragCoord.xy,baseColor);\n\
+					\n";
 			}
-		if(illuminate)
+		}
+	}
+	
+	/* Termina la función principal del sombreador de fragmentos: */
+	fragmentMain+="\
+		/* Assign the final color to the fragment: */\n\
+		gl_FragColor=baseColor;\n\
+		}\n";
+	
+	/* Compila el fragmento shader: */
+	shaders.addFragmentShader(fragmentDeclarations+"\t\t\n"+fragmentUniforms+"\t\t\n"+fragmentVaryings+"\t\t\n"+fragmentMain);
+	
+	/* Cargue o enlace el programa de sombreado: */
+	GLhandleARB result=shaders.link();
+	
+	/*******************************************************************
+	Consulta las ubicaciones uniformes del programa de sombreado:
+	*******************************************************************/
+	
+	GLint* ulPtr=uniformLocations;
+	
+	/* Consulta variables uniformes comunes: */
+	*(ulPtr++)=glGetUniformLocationARB(result,"depthSampler");
+	*(ulPtr++)=glGetUniformLocationARB(result,"depthProjection");
+	if(dem!=0)
+		{
+		/* Consultar variables uniformes de DEM coincidentes: */
+		*(ulPtr++)=glGetUniformLocationARB(result,"demTransform");
+		*(ulPtr++)=glGetUniformLocationARB(result,"demSampler");
+		*(ulPtr++)=glGetUniformLocationARB(result,"demDistScale");
+		}
+	else if(elevationColorMap!=0)
+		{
+		/* Variable de consulta de asignación de color variables uniformes: */
+		*(ulPtr++)=glGetUniformLocationARB(result,"heightColorMapPlaneEq");
+		*(ulPtr++)=glGetUniformLocationARB(result,"heightColorMapSampler");
+		}
+	if(useShaderContourLines())
+		{
+		if(analyticContourLines)
+			*(ulPtr++)=glGetUniformLocationARB(result,"contourPlaneEq");
+		else
+			*(ulPtr++)=glGetUniformLocationARB(result,"pixelCornerElevationSampler");
+		*(ulPtr++)=glGetUniformLocationARB(result,"contourLineFactor");
+		}
+	if(drawDippingBed)
+		{
+		if(dippingBedFolded)
+			*(ulPtr++)=glGetUniformLocationARB(result,"dbc");
+		else
+			*(ulPtr++)=glGetUniformLocationARB(result,"dippingBedPlaneEq");
+		*(ulPtr++)=glGetUniformLocationARB(result,"dippingBedThickness");
+		}
+	if(flowAccumulator!=0&&dem==0)
+		{
+		/* Consulta de variables uniformes de la red de ríos: */
+		*(ulPtr++)=glGetUniformLocationARB(result,"riverMaskSampler");
+		}
+	if(illuminate)
+		{
+		/* Variables uniformes de iluminación de consulta: */
+		*(ulPtr++)=glGetUniformLocationARB(result,"modelview");
+		*(ulPtr++)=glGetUniformLocationARB(result,"tangentModelviewDepthProjection");
+		if(useShadowMap())
+			{
+			*(ulPtr++)=glGetUniformLocationARB(result,"shadowTextureMatrix");
+			*(ulPtr++)=glGetUniformLocationARB(result,"shadowSampler");
+			}
+		}
+	if(waterTable!=0&&dem==0)
+		{
+		/* Consulta de variables de manejo de agua uniforme: */
+		*(ulPtr++)=glGetUniformLocationARB(result,"waterTransform");
+		*(ulPtr++)=glGetUniformLocationARB(result,"bathymetrySampler");
+		*(ulPtr++)=glGetUniformLocationARB(result,"quantitySampler");
+		*(ulPtr++)=glGetUniformLocationARB(result,"waterCellSize");
+		*(ulPtr++)=glGetUniformLocationARB(result,"waterOpacity");
+		*(ulPtr++)=glGetUniformLocationARB(result,"waterAnimationTime");
+		}
+	*(ulPtr++)=glGetUniformLocationARB(result,"projectionModelviewDepthProjection");
+	
+	return result;
+	}
+
+unsigned int SurfaceRenderer::getShaderFeatures(void) const
+	{
+	/* Reúna solo las características que cambian el código del sombreador creado por createSinglePassSurfaceShader: */
+	unsigned int result=0x0;
+	if(useShaderContourLines())
+		{
+		result|=CONTOUR_LINES;
+		if(analyticContourLines)
+			result|=ANALYTIC_CONTOUR_LINES;
+		}
+	if(dem!=0)
+		result|=DEM_DISTANCE;
+	else
+		{
+		if(elevationColorMap!=0)
+			result|=ELEVATION_COLOR_MAP;
+		if(drawDippingBed)
 			{
-			/* Variables uniformes de iluminación de consulta: */
-			*(ulPtr++)=glGetUniformLocationARB(result,"modelview");
-			*(ulPtr++)=glGetUniformLocationARB(result,"tangentModelviewDepthProjection");
+			result|=DIPPING_BED;
+			if(dippingBedFolded)
+				result|=DIPPING_BED_FOLDED;
 			}
-		if(waterTable!=0&&dem==0)
+		if(flowAccumulator!=0)
+			result|=RIVER_NETWORK;
+		if(waterTable!=0)
 			{
-			/* Consulta de variables de manejo de agua uniforme: */
-			*(ulPtr++)=glGetUniformLocationARB(result,"waterTransform");
-			*(ulPtr++)=glGetUniformLocationARB(result,"bathymetrySampler");
-			*(ulPtr++)=glGetUniformLocationARB(result,"quantitySampler");
-			*(ulPtr++)=glGetUniformLocationARB(result,"waterCellSize");
-			*(ulPtr++)=glGetUniformLocationARB(result,"waterOpacity");
-			*(ulPtr++)=glGetUniformLocationARB(result,"waterAnimationTime");
+			result|=WATER;
+			if(lava)
+				result|=LAVA;
+			else
+				result|=waterAppearance<<WATER_APPEARANCE_SHIFT;
+			if(advectWaterTexture)
+				result|=ADVECTED_WATER;
 			}
-		*(ulPtr++)=glGetUniformLocationARB(result,"projectionModelviewDepthProjection");
 		}
-	catch(...)
+	if(illuminate)
 		{
-		/* Limpie y vuelva a tirar la excepción: */
-		for(std::vector<GLhandleARB>::iterator shIt=shaders.begin();shIt!=shaders.end();++shIt)
-			glDeleteObjectARB(*shIt);
-		throw;
+		result|=ILLUMINATION;
+		if(useShadows)
+			result|=SHADOWS;
 		}
 	
 	return result;
 	}
 
-void SurfaceRenderer::renderPixelCornerElevations(const int viewport[4],const PTransform& projectionModelview,GLContextData& contextData,SurfaceRenderer::DataItem* dataItem) const
+void SurfaceRenderer::buildSurfaceShader(SurfaceRenderer::DataItem* dataItem,const GLLightTracker& lt,unsigned int features,unsigned int appearance) const
+	{
+	/* Compile y enlace la variante y mida el tiempo necesario; las excepciones dejan intactas las variantes existentes: */
+	Realtime::TimePointMonotonic compileTimer;
+	SurfaceShader newShader;
+	newShader.shader=createSinglePassSurfaceShader(lt,appearance,newShader.uniforms);
+	newShader.lightTrackerVersion=lt.getVersion();
+	newShader.compileTime=double(compileTimer.setAndDiff());
+	++dataItem->numShaderCompiles;
+	dataItem->shaderCompileTime+=newShader.compileTime;
+	
+	/* Descarte una variante anterior con la misma combinación de características: */
+	SurfaceShaderCache::Iterator ssIt=dataItem->surfaceShaders.findEntry(features);
+	if(!ssIt.isFinished())
+		glDeleteObjectARB(ssIt->getDest().shader);
+	
+	/* Guarde la nueva variante: */
+	dataItem->surfaceShaders.setEntry(SurfaceShaderCache::Entry(features,newShader));
+	
+	if(reportShaderCompiles)
+		Misc::formattedUserNote("SurfaceRenderer: Compiled surface shader variant 0x%x in %.1f ms (%u variants, %.1f ms total)",features,newShader.compileTime*1000.0,dataItem->numShaderCompiles,dataItem->shaderCompileTime*1000.0);
+	}
+
+void SurfaceRenderer::selectSurfaceShader(SurfaceRenderer::DataItem* dataItem,const GLLightTracker& lt) const
 	{
+	/* Busque la variante del sombreador para la configuración actual: */
+	unsigned int features=getShaderFeatures();
+	bool sourcesChanged=dataItem->shaderSourceVersion!=shaderSourceVersion;
+	SurfaceShaderCache::Iterator ssIt=dataItem->surfaceShaders.findEntry(features);
+	if(sourcesChanged||ssIt.isFinished()||((features&ILLUMINATION)!=0x0&&ssIt->getDest().lightTrackerVersion!=lt.getVersion()))
+		{
+		if(sourcesChanged)
+			{
+			/* Construya la variante actual antes de descartar las demás, para conservarlas si la compilación falla: */
+			buildSurfaceShader(dataItem,lt,features,waterAppearance);
+			SurfaceShader currentShader=dataItem->surfaceShaders.findEntry(features)->getDest();
+			
+			/* Descarte todas las variantes construidas a partir de los archivos de origen anteriores: */
+			for(SurfaceShaderCache::Iterator dIt=dataItem->surfaceShaders.begin();!dIt.isFinished();++dIt)
+				if(dIt->getSource()!=features)
+					glDeleteObjectARB(dIt->getDest().shader);
+			dataItem->surfaceShaders.clear();
+			dataItem->surfaceShaders.setEntry(SurfaceShaderCache::Entry(features,currentShader));
+			dataItem->shaderSourceVersion=shaderSourceVersion;
+			}
+		else
+			buildSurfaceShader(dataItem,lt,features,waterAppearance);
+		
+		ssIt=dataItem->surfaceShaders.findEntry(features);
+		}
+	
+	/* Precompile en los cuadros siguientes las variantes de las demás apariencias del agua, para que cambiar de apariencia no requiera compilar: */
+	if((features&WATER)!=0x0&&(features&LAVA)==0x0)
+		{
+		dataItem->appearanceBaseFeatures=features&((0x1U<<WATER_APPEARANCE_SHIFT)-1U);
+		dataItem->nextAppearance=0;
+		}
+	else
+		dataItem->nextAppearance=~0x0U;
+	
+	/* Cambie a la variante: */
+	const SurfaceShader& surfaceShader=ssIt->getDest();
+	dataItem->heightMapShader=surfaceShader.shader;
+	for(int i=0;i<20;++i)
+		dataItem->heightMapShaderUniforms[i]=surfaceShader.uniforms[i];
+	}
+
+void SurfaceRenderer::precompileWaterAppearance(SurfaceRenderer::DataItem* dataItem,const GLLightTracker& lt) const
+	{
+	/* Busque la siguiente apariencia cuya variante falta o está desactualizada: */
+	while(dataItem->nextAppearance<waterAppearanceNames.size())
+		{
+		unsigned int appearance=dataItem->nextAppearance++;
+		unsigned int appearanceFeatures=dataItem->appearanceBaseFeatures|(appearance<<WATER_APPEARANCE_SHIFT);
+		SurfaceShaderCache::Iterator aIt=dataItem->surfaceShaders.findEntry(appearanceFeatures);
+		if(aIt.isFinished()||((appearanceFeatures&ILLUMINATION)!=0x0&&aIt->getDest().lightTrackerVersion!=lt.getVersion()))
+			{
+			/* Compile solo esta variante en este cuadro: */
+			try
+				{
+				buildSurfaceShader(dataItem,lt,appearanceFeatures,appearance);
+				}
+			catch(const std::runtime_error& err)
+				{
+				Misc::formattedUserError("SurfaceRenderer: Caught exception %s while building water appearance %s",err.what(),waterAppearanceNames[appearance].c_str());
+				}
+			break;
+			}
+		}
+	}
+
+GLuint SurfaceRenderer::renderPixelCornerElevations(const int viewport[4],const PTransform& projectionModelview,GLContextData& contextData,SurfaceRenderer::DataItem* dataItem) const
+	{
+	/* Busque el búfer en caché de la vista actual; todas las ventanas del contexto con la misma vista comparten el mismo búfer: */
+	unsigned int depthTextureVersion=depthImageRenderer->getDepthTextureVersion(contextData);
+	++dataItem->contourLineUseCounter;
+	ContourLineBuffer* clb=0;
+	for(std::vector<ContourLineBuffer>::iterator clbIt=dataItem->contourLineBuffers.begin();clb==0&&clbIt!=dataItem->contourLineBuffers.end();++clbIt)
+		{
+		if(clbIt->framebufferSize[0]==(unsigned int)(viewport[2]+1)&&clbIt->framebufferSize[1]==(unsigned int)(viewport[3]+1))
+			{
+			bool viewChanged=false;
+			const PTransform::Matrix& pmv=projectionModelview.getMatrix();
+			const PTransform::Matrix& cpmv=clbIt->projectionModelview.getMatrix();
+			for(int i=0;i<4&&!viewChanged;++i)
+				for(int j=0;j<4;++j)
+					viewChanged=viewChanged||pmv(i,j)!=cpmv(i,j);
+			if(!viewChanged)
+				clb=&*clbIt;
+			}
+		}
+	if(clb!=0)
+		{
+		/* Devuelva la textura en caché si sigue siendo válida para la imagen de profundidad actual: */
+		clb->lastUse=dataItem->contourLineUseCounter;
+		if(clb->version==depthTextureVersion)
+			return clb->colorTextureObject;
+		}
+	else if(dataItem->contourLineBuffers.size()<maxNumContourLineBuffers)
+		{
+		/* Cree un nuevo búfer para la vista: */
+		ContourLineBuffer newClb;
+		for(int i=0;i<2;++i)
+			newClb.framebufferSize[i]=0;
+		glGenFramebuffersEXT(1,&newClb.framebufferObject);
+		glGenRenderbuffersEXT(1,&newClb.depthBufferObject);
+		glGenTextures(1,&newClb.colorTextureObject);
+		dataItem->contourLineBuffers.push_back(newClb);
+		clb=&dataItem->contourLineBuffers.back();
+		}
+	else
+		{
+		/* Reutilice el búfer usado menos recientemente: */
+		clb=&dataItem->contourLineBuffers.front();
+		for(std::vector<ContourLineBuffer>::iterator clbIt=dataItem->contourLineBuffers.begin();clbIt!=dataItem->contourLineBuffers.end();++clbIt)
+			if(clb->lastUse>clbIt->lastUse)
+				clb=&*clbIt;
+		}
+	clb->lastUse=dataItem->contourLineUseCounter;
+	
 	/* Guarde el búfer de cuadros actualmente enlazado y borre el color: */
 	GLint currentFrameBuffer;
 	glGetIntegerv(GL_FRAMEBUFFER_BINDING_EXT,&currentFrameBuffer);
 	GLfloat currentClearColor[4];
 	glGetFloatv(GL_COLOR_CLEAR_VALUE,currentClearColor);
 	
-	/* Compruebe si es necesario crear el búfer de cuadros de representación de líneas de contorno: */
-	if(dataItem->contourLineFramebufferObject==0)
-		{
-		/* Inicialice el buffer de cuadros: */
-		for(int i=0;i<2;++i)
-			dataItem->contourLineFramebufferSize[i]=0;
-		glGenFramebuffersEXT(1,&dataItem->contourLineFramebufferObject);
-		glGenRenderbuffersEXT(1,&dataItem->contourLineDepthBufferObject);
-		glGenTextures(1,&dataItem->contourLineColorTextureObject);
-		}
-	
 	/* Enlazar el objeto de búfer de marco de representación de línea de contorno: */
-	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,dataItem->contourLineFramebufferObject);
+	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,clb->framebufferObject);
 	
 	/* Compruebe si es necesario cambiar el tamaño del búfer de marco de la línea de contorno: */
-	if(dataItem->contourLineFramebufferSize[0]!=(unsigned int)(viewport[2]+1)||dataItem->contourLineFramebufferSize[1]!=(unsigned int)(viewport[3]+1))
+	if(clb->framebufferSize[0]!=(unsigned int)(viewport[2]+1)||clb->framebufferSize[1]!=(unsigned int)(viewport[3]+1))
 		{
 		/* Recuerde si los búferes de representación aún deben estar adjuntos al búfer de cuadros: */
-		bool mustAttachBuffers=dataItem->contourLineFramebufferSize[0]==0&&dataItem->contourLineFramebufferSize[1]==0;
+		bool mustAttachBuffers=clb->framebufferSize[0]==0&&clb->framebufferSize[1]==0;
 		
 		/* Actualice el tamaño del buffer de cuadros: */
 		for(int i=0;i<2;++i)
-			dataItem->contourLineFramebufferSize[i]=(unsigned int)(viewport[2+i]+1);
+			clb->framebufferSize[i]=(unsigned int)(viewport[2+i]+1);
 		
 		/* Cambiar el tamaño del búfer de profundidad de representación de la línea de contorno topográfico: */
-		glBindRenderbufferEXT(GL_RENDERBUFFER_EXT,dataItem->contourLineDepthBufferObject);
-		glRenderbufferStorageEXT(GL_RENDERBUFFER_EXT,GL_DEPTH_COMPONENT,dataItem->contourLineFramebufferSize[0],dataItem->contourLineFramebufferSize[1]);
+		glBindRenderbufferEXT(GL_RENDERBUFFER_EXT,clb->depthBufferObject);
+		glRenderbufferStorageEXT(GL_RENDERBUFFER_EXT,GL_DEPTH_COMPONENT,clb->framebufferSize[0],clb->framebufferSize[1]);
 		glBindRenderbufferEXT(GL_RENDERBUFFER_EXT,0);
 		
 		/* Cambiar el tamaño de la línea de contorno topográfico que representa la textura del color: */
-		glBindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->contourLineColorTextureObject);
+		glBindTexture(GL_TEXTURE_RECTANGLE_ARB,clb->colorTextureObject);
 		glTexParameteri(GL_TEXTURE_RECTANGLE_ARB,GL_TEXTURE_MIN_FILTER,GL_NEAREST);
 		glTexParameteri(GL_TEXTURE_RECTANGLE_ARB,GL_TEXTURE_MAG_FILTER,GL_NEAREST);
 		glTexParameteri(GL_TEXTURE_RECTANGLE_ARB,GL_TEXTURE_WRAP_S,GL_CLAMP);
 		glTexParameteri(GL_TEXTURE_RECTANGLE_ARB,GL_TEXTURE_WRAP_T,GL_CLAMP);
-		glTexImage2D(GL_TEXTURE_RECTANGLE_ARB,0,GL_R32F,dataItem->contourLineFramebufferSize[0],dataItem->contourLineFramebufferSize[1],0,GL_LUMINANCE,GL_UNSIGNED_BYTE,0);
+		glTexImage2D(GL_TEXTURE_RECTANGLE_ARB,0,GL_R32F,clb->framebufferSize[0],clb->framebufferSize[1],0,GL_LUMINANCE,GL_UNSIGNED_BYTE,0);
 		glBindTexture(GL_TEXTURE_RECTANGLE_ARB,0);
 		
 		if(mustAttachBuffers)
 			{
-			glFramebufferRenderbufferEXT(GL_FRAMEBUFFER_EXT,GL_DEPTH_ATTACHMENT_EXT,GL_RENDERBUFFER_EXT,dataItem->contourLineDepthBufferObject);
-			glFramebufferTexture2DEXT(GL_FRAMEBUFFER_EXT,GL_COLOR_ATTACHMENT0_EXT,GL_TEXTURE_RECTANGLE_ARB,dataItem->contourLineColorTextureObject,0);
+			glFramebufferRenderbufferEXT(GL_FRAMEBUFFER_EXT,GL_DEPTH_ATTACHMENT_EXT,GL_RENDERBUFFER_EXT,clb->depthBufferObject);
+			glFramebufferTexture2DEXT(GL_FRAMEBUFFER_EXT,GL_COLOR_ATTACHMENT0_EXT,GL_TEXTURE_RECTANGLE_ARB,clb->colorTextureObject,0);
 			glDrawBuffer(GL_COLOR_ATTACHMENT0_EXT);
 			glReadBuffer(GL_NONE);
 			}
@@ -605,20 +929,28 @@ void SurfaceRenderer::renderPixelCornerElevations(const int viewport[4],const PT
 		}
 	
 	/* Procese la elevación de la superficie en el búfer de fotogramas con desplazamiento de medio píxel: */
-	depthImageRenderer->renderElevation(shiftedProjectionModelview,contextData);
+	depthImageRenderer->renderElevation(shiftedProjectionModelview,contextData,DepthImageRenderer::COARSE_MESH);
 	
 	/* Restore the original viewport: */
 	glViewport(viewport[0],viewport[1],viewport[2],viewport[3]);
 	
+	/* Marque la textura como actual para la imagen de profundidad y la vista: */
+	clb->version=depthTextureVersion;
+	clb->projectionModelview=projectionModelview;
+	
 	/* Restaure el color claro original y el enlace del búfer del marco: */
 	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,currentFrameBuffer);
 	glClearColor(currentClearColor[0],currentClearColor[1],currentClearColor[2],currentClearColor[3]);
+	
+	return clb->colorTextureObject;
 	}
 
 SurfaceRenderer::SurfaceRenderer(const DepthImageRenderer* sDepthImageRenderer)
 	:depthImageRenderer(sDepthImageRenderer),
 	 drawContourLines(true),
 	 contourLineFactor(1.0f),
+	 contourGenerator(0),
+	 analyticContourLines(false),
 	 elevationColorMap(0),
 	 drawDippingBed(false),
 	 dippingBedFolded(false),
@@ -627,12 +959,18 @@ SurfaceRenderer::SurfaceRenderer(const DepthImageRenderer* sDepthImageRenderer)
 	 dem(0),
 	 demDistScale(2.0f),
 	 illuminate(false),
+	 useShadows(false),
+	 flowAccumulator(0),
 	 waterTable(0),
 	 advectWaterTexture(false),
 	 waterOpacity(2.0f),
 	 surfaceSettingsVersion(1),
+	 shaderSourceVersion(0),
+	 reportShaderCompiles(false),
 	 animationTime(0.0),
-	 lava(true)
+	 lava(true),
+	 waterAppearance(0),
+	 lavaAppearance(0)
 	{
 	std::cout<<"16: SurfaceRenderer" << std::endl;
 	/* Copia el tamaño de la imagen de profundidad: */
@@ -652,11 +990,21 @@ SurfaceRenderer::SurfaceRenderer(const DepthImageRenderer* sDepthImageRenderer)
 	if(depthProjectionInverts)
 		tangentDepthProjection*=PTransform::scale(PTransform::Scale(-1,-1,-1));
 	
+	/* Busque todas las apariencias del agua y precargue los códigos fuente de los sombreadores externos: */
+	waterAppearanceNames.push_back("Default");
+	findFragmentShaders("SurfaceAddWaterColor-",waterAppearanceNames);
+	int lavaIndex=findWaterAppearance("Lava");
+	if(lavaIndex>=0)
+		lavaAppearance=lavaIndex;
+	loadShaderSources();
+	
 	/* Supervise los archivos de origen del sombreador externo: */
 	fileMonitor.addPath((std::string(CONFIG_SHADERDIR)+std::string("/SurfaceAddContourLines.fs")).c_str(),IO::FileMonitor::Modified,Misc::createFunctionCall(this,&SurfaceRenderer::shaderSourceFileChanged));
+	fileMonitor.addPath((std::string(CONFIG_SHADERDIR)+std::string("/SurfaceAddAnalyticContourLines.fs")).c_str(),IO::FileMonitor::Modified,Misc::createFunctionCall(this,&SurfaceRenderer::shaderSourceFileChanged));
 	fileMonitor.addPath((std::string(CONFIG_SHADERDIR)+std::string("/SurfaceIlluminate.fs")).c_str(),IO::FileMonitor::Modified,Misc::createFunctionCall(this,&SurfaceRenderer::shaderSourceFileChanged));
 	fileMonitor.addPath((std::string(CONFIG_SHADERDIR)+std::string("/SurfaceAddWaterColor.fs")).c_str(),IO::FileMonitor::Modified,Misc::createFunctionCall(this,&SurfaceRenderer::shaderSourceFileChanged));
-	fileMonitor.addPath((std::string(CONFIG_SHADERDIR)+std::string("/SurfaceAddWaterColor-Lava.fs")).c_str(),IO::FileMonitor::Modified,Misc::createFunctionCall(this,&SurfaceRenderer::shaderSourceFileChanged));
+	for(std::vector<std::string>::const_iterator wanIt=waterAppearanceNames.begin()+1;wanIt!=waterAppearanceNames.end();++wanIt)
+		fileMonitor.addPath((std::string(CONFIG_SHADERDIR)+std::string("/SurfaceAddWaterColor-")+*wanIt+std::string(".fs")).c_str(),IO::FileMonitor::Modified,Misc::createFunctionCall(this,&SurfaceRenderer::shaderSourceFileChanged));
 	fileMonitor.startPolling();
 	}
 
@@ -667,7 +1015,8 @@ void SurfaceRenderer::initContext(GLContextData& contextData) const
 	contextData.addDataItem(this,dataItem);
 	
 	/* Crear el mapa de altura render shader: */
-	dataItem->heightMapShader=SurfaceRenderer::createSinglePassSurfaceShader(*contextData.getLightTracker(),dataItem->heightMapShaderUniforms);
+	dataItem->shaderSourceVersion=shaderSourceVersion;
+	selectSurfaceShader(dataItem,*contextData.getLightTracker());
 	dataItem->surfaceSettingsVersion=surfaceSettingsVersion;
 	dataItem->lightTrackerVersion=contextData.getLightTracker()->getVersion();
 	
@@ -704,8 +1053,11 @@ void SurfaceRenderer::initContext(GLContextData& contextData) const
 void SurfaceRenderer::setDrawContourLines(bool newDrawContourLines)
 	{
 	std::cout<<"16.1: SetDrawContourLines" << std::endl;
-	drawContourLines=newDrawContourLines;
-	++surfaceSettingsVersion;
+	if(drawContourLines!=newDrawContourLines)
+		{
+		drawContourLines=newDrawContourLines;
+		++surfaceSettingsVersion;
+		}
 	}
 
 void SurfaceRenderer::setContourLineDistance(GLfloat newContourLineDistance)
@@ -728,8 +1080,11 @@ void SurfaceRenderer::setElevationColorMap(ElevationColorMap* newElevationColorM
 
 void SurfaceRenderer::setDrawDippingBed(bool newDrawDippingBed)
 	{
-	drawDippingBed=newDrawDippingBed;//algo de luz
-	++surfaceSettingsVersion;
+	if(drawDippingBed!=newDrawDippingBed)
+		{
+		drawDippingBed=newDrawDippingBed;//algo de luz
+		++surfaceSettingsVersion;
+		}
 	}
 
 void SurfaceRenderer::setDippingBedPlane(const SurfaceRenderer::Plane& newDippingBedPlane)
@@ -784,29 +1139,116 @@ void SurfaceRenderer::setDemDistScale(GLfloat newDemDistScale)
 void SurfaceRenderer::setIlluminate(bool newIlluminate)
 	{
 	std::cout<<"16.4: SetIlluminate" << std::endl;
-	illuminate=newIlluminate;
-	++surfaceSettingsVersion;
+	if(illuminate!=newIlluminate)
+		{
+		illuminate=newIlluminate;
+		++surfaceSettingsVersion;
+		}
+	}
+
+void SurfaceRenderer::setUseShadows(bool newUseShadows)
+	{
+	if(useShadows!=newUseShadows)
+		{
+		useShadows=newUseShadows;
+		++surfaceSettingsVersion;
+		}
+	}
+
+void SurfaceRenderer::setShadowMap(GLuint shadowTexture,const PTransform& shadowTextureTransform,GLContextData& contextData) const
+	{
+	/* Obtener el elemento de datos: */
+	DataItem* dataItem=contextData.retrieveDataItem<DataItem>(this);
+	
+	/* Almacene la textura y su transformación en formato OpenGL principal de la columna: */
+	dataItem->shadowTexture=shadowTexture;
+	GLfloat* stmPtr=dataItem->shadowTextureMatrix;
+	for(int j=0;j<4;++j)
+		for(int i=0;i<4;++i,++stmPtr)
+			*stmPtr=GLfloat(shadowTextureTransform.getMatrix()(i,j));
 	}
 
 void SurfaceRenderer::setLava(bool newLava)
 	{
 	//std::cout<<"Numero: SetLava" << std::endl;
-	lava=newLava;
-	++surfaceSettingsVersion;
+	if(lava!=newLava)
+		{
+		lava=newLava;
+		++surfaceSettingsVersion;
+		}
+	}
+
+int SurfaceRenderer::findWaterAppearance(const char* appearanceName) const
+	{
+	for(unsigned int i=0;i<waterAppearanceNames.size();++i)
+		if(strcasecmp(waterAppearanceNames[i].c_str(),appearanceName)==0)
+			return int(i);
+	return -1;
+	}
+
+void SurfaceRenderer::setWaterAppearance(unsigned int newWaterAppearance)
+	{
+	/* Cambie a la nueva apariencia; su variante del sombreador suele estar ya precompilada si hay agua: */
+	if(newWaterAppearance<waterAppearanceNames.size()&&waterAppearance!=newWaterAppearance)
+		{
+		waterAppearance=newWaterAppearance;
+		++surfaceSettingsVersion;
+		}
+	}
+
+void SurfaceRenderer::setContourGenerator(const ContourGenerator* newContourGenerator)
+	{
+	/* Compruebe si la configuración de este generador de contornos invalida el shader: */
+	if((newContourGenerator!=0&&contourGenerator==0)||(newContourGenerator==0&&contourGenerator!=0))
+		++surfaceSettingsVersion;
+	
+	/* Establecer el nuevo generador de contornos: */
+	contourGenerator=newContourGenerator;
+	}
+
+void SurfaceRenderer::setAnalyticContourLines(bool newAnalyticContourLines)
+	{
+	/* Cambiar el modo de las líneas de contorno invalida el shader: */
+	if(analyticContourLines!=newAnalyticContourLines)
+		{
+		analyticContourLines=newAnalyticContourLines;
+		++surfaceSettingsVersion;
+		}
+	}
+
+void SurfaceRenderer::setReportShaderCompiles(bool newReportShaderCompiles)
+	{
+	reportShaderCompiles=newReportShaderCompiles;
+	}
+
+void SurfaceRenderer::setFlowAccumulator(const FlowAccumulator* newFlowAccumulator)
+	{
+	/* Compruebe si la configuración de este acumulador de flujo invalida el shader: */
+	if((newFlowAccumulator!=0&&flowAccumulator==0)||(newFlowAccumulator==0&&flowAccumulator!=0))
+		++surfaceSettingsVersion;
+	
+	/* Establecer el nuevo acumulador de flujo: */
+	flowAccumulator=newFlowAccumulator;
 	}
 
 void SurfaceRenderer::setWaterTable(WaterTable2* newWaterTable)
 	{
 	//std::cout<<"16.6: SetWaterTable" << std::endl;
-	waterTable=newWaterTable;
-	++surfaceSettingsVersion;
+	if(waterTable!=newWaterTable)
+		{
+		waterTable=newWaterTable;
+		++surfaceSettingsVersion;
+		}
 	}
 
 void SurfaceRenderer::setAdvectWaterTexture(bool newAdvectWaterTexture)
 	{
 	std::cout<<"16.7: SetAdvectWaterTexture" << std::endl;
-	advectWaterTexture=false; // Nueva textura de agua Advect;
-	++surfaceSettingsVersion;
+	if(advectWaterTexture)
+		{
+		advectWaterTexture=false; // Nueva textura de agua Advect;
+		++surfaceSettingsVersion;
+		}
 	}
 
 void SurfaceRenderer::setWaterOpacity(GLfloat newWaterOpacity)
@@ -834,32 +1276,26 @@ void SurfaceRenderer::renderSinglePass(const int viewport[4],const PTransform& p
 	PTransform projectionModelview=projection;
 	projectionModelview*=modelview;
 	
-	/* Compruebe si la representación de la línea de contorno está habilitada: */
-	if(drawContourLines)
+	/* Compruebe si las líneas de contorno del sombreador necesitan las elevaciones de esquina de píxel: */
+	GLuint pixelCornerElevationTexture=0;
+	if(usePixelCornerElevations())
 		{
 		/* Ejecute la primera pasada de representación para crear una textura de desplazamiento de medio píxel de elevaciones de superficie: */
-		renderPixelCornerElevations(viewport,projectionModelview,contextData,dataItem);
+		pixelCornerElevationTexture=renderPixelCornerElevations(viewport,projectionModelview,contextData,dataItem);
 		}
-	else if(dataItem->contourLineFramebufferObject!=0)
+	else if(!dataItem->contourLineBuffers.empty())
 		{
-		/* Elimine el búfer de cuadros de representación de líneas de contorno: */
-		glDeleteFramebuffersEXT(1,&dataItem->contourLineFramebufferObject);
-		dataItem->contourLineFramebufferObject=0;
-		glDeleteRenderbuffersEXT(1,&dataItem->contourLineDepthBufferObject);
-		dataItem->contourLineDepthBufferObject=0;
-		glDeleteTextures(1,&dataItem->contourLineColorTextureObject);
-		dataItem->contourLineColorTextureObject=0;
+		/* Elimine los búferes de cuadros de representación de líneas de contorno: */
+		dataItem->deleteContourLineBuffers();
 		}
 	
 	/* Compruebe si el sombreador de superficie de un solo paso está desactualizado: */
 	if(dataItem->surfaceSettingsVersion!=surfaceSettingsVersion||(illuminate&&dataItem->lightTrackerVersion!=contextData.getLightTracker()->getVersion()))
 		{
-		/* Reconstruir el shader: */
+		/* Cambie a la variante del shader de la configuración actual, construyéndola si es necesario: */
 		try
 			{
-			GLhandleARB newShader=createSinglePassSurfaceShader(*contextData.getLightTracker(),dataItem->heightMapShaderUniforms);
-			glDeleteObjectARB(dataItem->heightMapShader);
-			dataItem->heightMapShader=newShader;
+			selectSurfaceShader(dataItem,*contextData.getLightTracker());
 			}
 		catch(const std::runtime_error& err)
 			{
@@ -870,6 +1306,11 @@ void SurfaceRenderer::renderSinglePass(const int viewport[4],const PTransform& p
 		dataItem->surfaceSettingsVersion=surfaceSettingsVersion;
 		dataItem->lightTrackerVersion=contextData.getLightTracker()->getVersion();
 		}
+	else if(dataItem->nextAppearance<waterAppearanceNames.size())
+		{
+		/* Compile la siguiente variante pendiente de las demás apariencias del agua: */
+		precompileWaterAppearance(dataItem,*contextData.getLightTracker());
+		}
 	
 	/* Enlazar el sombreador de superficie de un solo paso: */
 	glUseProgramObjectARB(dataItem->heightMapShader);
@@ -907,13 +1348,26 @@ void SurfaceRenderer::renderSinglePass(const int viewport[4],const PTransform& p
 		glUniform1iARB(*(ulPtr++),1);
 		}
 	
-	if(drawContourLines)
+	if(usePixelCornerElevations())
 		{
 		/* Enlazar la textura de elevación de la esquina del píxel: */
 		glActiveTextureARB(GL_TEXTURE2_ARB);
-		glBindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->contourLineColorTextureObject);
+		glBindTexture(GL_TEXTURE_RECTANGLE_ARB,pixelCornerElevationTexture);
 		glUniform1iARB(*(ulPtr++),2);
 		
+		/* Sube el factor de distancia de la línea de contorno: */
+		glUniform1fARB(*(ulPtr++),contourLineFactor);
+		}
+	else if(useShaderContourLines())
+		{
+		/* Sube la ecuación del plano base en el espacio de la cámara: */
+		const Geometry::Plane<Scalar,3>& basePlane=depthImageRenderer->getBasePlane();
+		GLfloat planeEq[4];
+		for(int i=0;i<3;++i)
+			planeEq[i]=GLfloat(basePlane.getNormal()[i]);
+		planeEq[3]=GLfloat(-basePlane.getOffset());
+		glUniformARB<4>(*(ulPtr++),1,planeEq);
+		
 		/* Sube el factor de distancia de la línea de contorno: */
 		glUniform1fARB(*(ulPtr++),contourLineFactor);
 		}
@@ -939,6 +1393,14 @@ void SurfaceRenderer::renderSinglePass(const int viewport[4],const PTransform& p
 		glUniform1fARB(*(ulPtr++),dippingBedThickness);
 		}
 	
+	if(flowAccumulator!=0&&dem==0)
+		{
+		/* Enlazar la textura de la máscara de ríos: */
+		glActiveTextureARB(GL_TEXTURE5_ARB);
+		flowAccumulator->bindRiverMaskTexture(contextData);
+		glUniform1iARB(*(ulPtr++),5);
+		}
+	
 	if(illuminate)
 		{
 		/* Sube la matriz de modelview: */
@@ -953,6 +1415,17 @@ void SurfaceRenderer::renderSinglePass(const int viewport[4],const PTransform& p
 		for(int i=0;i<16;++i,++tmdpPtr,++mPtr)
 				*mPtr=GLfloat(*tmdpPtr);
 		glUniformMatrix4fvARB(*(ulPtr++),1,GL_FALSE,matrix);
+		
+		if(useShadowMap())
+			{
+			/* Sube la transformación del mapa de sombras: */
+			glUniformMatrix4fvARB(*(ulPtr++),1,GL_FALSE,dataItem->shadowTextureMatrix);
+			
+			/* Enlazar la textura del mapa de sombras: */
+			glActiveTextureARB(GL_TEXTURE6_ARB);
+			glBindTexture(GL_TEXTURE_2D,dataItem->shadowTexture);
+			glUniform1iARB(*(ulPtr++),6);
+			}
 		}
 	
 	if(waterTable!=0&&dem==0)
@@ -997,6 +1470,11 @@ void SurfaceRenderer::renderSinglePass(const int viewport[4],const PTransform& p
 	depthImageRenderer->renderSurfaceTemplate(contextData);
 	
 	/* Desenlazar todas las texturas y buffers: */
+	if(flowAccumulator!=0&&dem==0)
+		{
+		glActiveTextureARB(GL_TEXTURE5_ARB);
+		glBindTexture(GL_TEXTURE_RECTANGLE_ARB,0);
+		}
 	if(waterTable!=0&&dem==0)
 		{
 		glActiveTextureARB(GL_TEXTURE4_ARB);
@@ -1012,7 +1490,12 @@ void SurfaceRenderer::renderSinglePass(const int viewport[4],const PTransform& p
 		glTexParameteri(GL_TEXTURE_RECTANGLE_ARB,GL_TEXTURE_WRAP_T,GL_CLAMP);
 		glBindTexture(GL_TEXTURE_RECTANGLE_ARB,0);
 		}
-	if(drawContourLines)
+	if(useShadowMap())
+		{
+		glActiveTextureARB(GL_TEXTURE6_ARB);
+		glBindTexture(GL_TEXTURE_2D,0);
+		}
+	if(usePixelCornerElevations())
 		{
 		glActiveTextureARB(GL_TEXTURE2_ARB);
 		glBindTexture(GL_TEXTURE_RECTANGLE_ARB,0);
@@ -1032,6 +1515,12 @@ void SurfaceRenderer::renderSinglePass(const int viewport[4],const PTransform& p
 	
 	/* Desenlazar el mapa de altura shader: */
 	glUseProgramObjectARB(0);
+	
+	if(drawContourLines&&contourGenerator!=0)
+		{
+		/* Dibuje las líneas de contorno vectoriales sobre la superficie: */
+		contourGenerator->glRenderAction(projectionModelview,contextData);
+		}
 	}
 
 #if 0
@@ -23,6 +23,9 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 #ifndef SURFACERENDERER_INCLUDED
 #define SURFACERENDERER_INCLUDED
 
+#include <string>
+#include <vector>
+#include <Misc/HashTable.h>
 #include <IO/FileMonitor.h>
 #include <Geometry/ProjectiveTransformation.h>
 #include <Geometry/Plane.h>
@@ -39,6 +42,8 @@ class ElevationColorMap;
 class GLLightTracker;
 class DEM;
 class WaterTable2;
+class FlowAccumulator;
+class ContourGenerator;
 
 class SurfaceRenderer:public GLObject
 	{
@@ -47,27 +52,79 @@ class SurfaceRenderer:public GLObject
 	typedef Geometry::Plane<GLfloat,3> Plane; // Escriba para ecuaciones planas
 	
 	private:
+	enum ShaderFeatures // Enumerado de las características que seleccionan una variante del sombreador de superficie de un solo paso
+		{
+		CONTOUR_LINES=0x1,
+		DIPPING_BED=0x2,
+		DIPPING_BED_FOLDED=0x4,
+		DEM_DISTANCE=0x8,
+		ELEVATION_COLOR_MAP=0x10,
+		RIVER_NETWORK=0x20,
+		ILLUMINATION=0x40,
+		LAVA=0x80,
+		WATER=0x100,
+		ADVECTED_WATER=0x200,
+		SHADOWS=0x400,
+		ANALYTIC_CONTOUR_LINES=0x800,
+		WATER_APPEARANCE_SHIFT=12 // Desplazamiento en bits del índice de la apariencia del agua dentro de la combinación de características
+		};
+	
+	struct SurfaceShader // Estructura para una variante enlazada del sombreador de superficie de un solo paso
+		{
+		/* Elementos: */
+		public:
+		GLhandleARB shader; // Programa de sombreado de la variante
+		GLint uniforms[20]; // Ubicaciones de las variables uniformes de la variante
+		unsigned int lightTrackerVersion; // Número de versión del estado del rastreador de luz para el que se construyó la variante
+		double compileTime; // Tiempo en segundos que tardó la compilación y el enlace de la variante
+		};
+	
+	typedef Misc::HashTable<unsigned int,SurfaceShader> SurfaceShaderCache; // Tipo de mapa hash de las características de superficie a variantes del sombreador
+	
+	static const unsigned int maxNumContourLineBuffers=4; // Número máximo de vistas distintas para las que un contexto guarda elevaciones de esquina de píxel
+	
+	struct ContourLineBuffer // Estructura para un búfer en caché de elevaciones de esquina de píxel para una vista
+		{
+		/* Elementos: */
+		public:
+		GLuint framebufferSize[2]; // Anchura y altura actuales del búfer del marco de representación de línea de contorno
+		GLuint framebufferObject; // Objeto buffer de trama utilizado para representar líneas de contorno topográficas
+		GLuint depthBufferObject; // Tampón de renderizado de profundidad para tampón de marco de línea de contorno topográfico
+		GLuint colorTextureObject; // Objeto de textura de color para búfer de marco de línea de contorno topográfico
+		unsigned int version; // Número de versión de la imagen de profundidad utilizada para la generación de líneas de contorno
+		PTransform projectionModelview; // Matriz de proyección y vista de modelo utilizada para la generación de líneas de contorno
+		unsigned int lastUse; // Valor del contador de usos del contexto la última vez que se usó el búfer
+		};
+	
 	struct DataItem:public GLObject::DataItem
 		{
 		/* Elementos: */
 		public:
-		GLuint contourLineFramebufferSize[2]; // Anchura y altura actuales del búfer del marco de representación de línea de contorno
-		GLuint contourLineFramebufferObject; // Objeto buffer de trama utilizado para representar líneas de contorno topográficas
-		GLuint contourLineDepthBufferObject; // Tampón de renderizado de profundidad para tampón de marco de línea de contorno topográfico
-		GLuint contourLineColorTextureObject; // Objeto de textura de color para búfer de marco de línea de contorno topográfico
-		unsigned int contourLineVersion; // Número de versión de la imagen de profundidad utilizada para la generación de líneas de contorno
-		GLhandleARB heightMapShader; // Programa de sombreado para renderizar la superficie usando un mapa de color de altura
-		GLint heightMapShaderUniforms[16]; // Ubicaciones de las variables uniformes del sombreador del mapa de altura
-		unsigned int surfaceSettingsVersion; // Número de versión de la configuración de superficie para la cual se construyó el sombreador de mapa de altura
-		unsigned int lightTrackerVersion; // Número de versión del estado del rastreador de luz para el que se construyó el sombreador del mapa de altura
+		std::vector<ContourLineBuffer> contourLineBuffers; // Búferes de elevaciones de esquina de píxel de las vistas representadas en este contexto, compartidos por todas las ventanas del contexto
+		unsigned int contourLineUseCounter; // Contador de usos de los búferes de líneas de contorno para reemplazar el menos usado recientemente
+		SurfaceShaderCache surfaceShaders; // Mapa de las variantes del sombreador de superficie de un solo paso ya enlazadas en este contexto
+		unsigned int shaderSourceVersion; // Número de versión de los archivos de origen del sombreador externo para el que se enlazaron las variantes
+		unsigned int numShaderCompiles; // Número de variantes del sombreador compiladas en este contexto
+		double shaderCompileTime; // Tiempo total en segundos dedicado a compilar variantes del sombreador en este contexto
+		unsigned int appearanceBaseFeatures; // Combinación de características sin apariencia del agua para la que se precompilan las variantes de las demás apariencias
+		unsigned int nextAppearance; // Índice de la siguiente apariencia del agua a precompilar; no menor que el número de apariencias si no queda ninguna
+		GLhandleARB heightMapShader; // Variante actual del programa de sombreado para renderizar la superficie usando un mapa de color de altura; propiedad del mapa de variantes
+		GLint heightMapShaderUniforms[20]; // Ubicaciones de las variables uniformes del sombreador del mapa de altura
+		unsigned int surfaceSettingsVersion; // Número de versión de la configuración de superficie para la cual se seleccionó el sombreador de mapa de altura
+		unsigned int lightTrackerVersion; // Número de versión del estado del rastreador de luz para el que se seleccionó el sombreador del mapa de altura
 		GLhandleARB globalAmbientHeightMapShader; // Programa de sombreado para representar el componente ambiental global de la superficie utilizando un mapa de color de altura
 		GLint globalAmbientHeightMapShaderUniforms[13]; // Ubicaciones de las variables uniformes del sombreador del mapa de altura ambiental global
 		GLhandleARB shadowedIlluminatedHeightMapShader; // Programa de sombreado para renderizar la superficie usando iluminación con sombras y un mapa de color de altura
 		GLint shadowedIlluminatedHeightMapShaderUniforms[14]; // Ubicaciones de las variables uniformes del sombreador del mapa de altura iluminado sombreado
+		GLuint shadowTexture; // Textura de profundidad del mapa de sombras de este contexto, o 0
+		GLfloat shadowTextureMatrix[16]; // Transformación del espacio de la cámara al espacio de textura del mapa de sombras en formato compatible con GLSL
 		
 		/* Constructores y destructores: */
 		DataItem(void);
 		virtual ~DataItem(void);
+		
+		/* Métodos: */
+		void deleteContourLineBuffers(void); // Libera todos los búferes de elevaciones de esquina de píxel del contexto
 		};
 	
 	/* Elementos: */
@@ -78,6 +135,8 @@ class SurfaceRenderer:public GLObject
 	
 	bool drawContourLines; // Marcar si las líneas de contorno topográficas están habilitadas
 	GLfloat contourLineFactor; // Distancia de elevación inversa entre líneas de contorno topográficas adyacentes
+	const ContourGenerator* contourGenerator; // Puntero al generador de líneas de contorno vectoriales; si no es NULL, reemplaza el paso de líneas de contorno en la GPU
+	bool analyticContourLines; // Marcar si las líneas de contorno se calculan a partir de las derivadas de la elevación en el sombreador de superficie, sin el paso de elevaciones de esquina de píxel
 	
 	ElevationColorMap* elevationColorMap; // Puntero a un mapa de color para colorear el mapa de elevación topográfico
 	
@@ -91,19 +150,48 @@ class SurfaceRenderer:public GLObject
 	GLfloat demDistScale; // Desviación máxima de superficie a DEM en unidades de espacio de cámara
 	
 	bool illuminate; // Marque si la superficie debe estar iluminada
+	bool useShadows; // Marque si la superficie iluminada debe oscurecerse según el mapa de sombras del contexto
+	
+	const FlowAccumulator* flowAccumulator; // Puntero al acumulador de flujo para dibujar la red de ríos; si es NULL, no se dibujan ríos
 	
 	bool lava;
+	std::vector<std::string> waterAppearanceNames; // Nombres de las apariencias del agua; la primera usa SurfaceAddWaterColor.fs y las demás SurfaceAddWaterColor-<nombre>.fs
+	unsigned int waterAppearance; // Índice de la apariencia actual del agua
+	unsigned int lavaAppearance; // Índice de la apariencia del agua usada cuando la bandera de lava está activa
+	std::string contourLinesSource; // Código fuente precargado del sombreador de líneas de contorno
+	std::string analyticContourLinesSource; // Código fuente precargado del sombreador de líneas de contorno analíticas
+	std::string illuminateSource; // Código fuente precargado del sombreador de iluminación
+	std::vector<std::string> waterAppearanceSources; // Códigos fuente precargados de los sombreadores de color del agua de todas las apariencias
 	WaterTable2* waterTable; // Puntero al objeto de la capa freática; si es NULL, se ignora el agua
 	bool advectWaterTexture; // Marque si las coordenadas de textura del agua se advectan para visualizar el flujo de agua
 	GLfloat waterOpacity; // Factor de escala para la opacidad del agua.
 	
 	unsigned int surfaceSettingsVersion; // Número de versión de la configuración de superficie para invalidar el sombreado de representación de superficie en los cambios
+	unsigned int shaderSourceVersion; // Número de versión de los archivos de origen del sombreador externo para invalidar todas las variantes del sombreador
+	bool reportShaderCompiles; // Marcar para informar del tiempo de compilación de cada variante del sombreador
 	double animationTime; // Valor de tiempo para la animación del agua.
 	
 	/* Métodos privados: */
+	void loadShaderSources(void); // Lee los códigos fuente de los sombreadores de fragmentos externos del renderizador
 	void shaderSourceFileChanged(const IO::FileMonitor::Event& event); // Devolución de llamada cuando se cambia uno de los archivos de origen del sombreador externo
-	GLhandleARB createSinglePassSurfaceShader(const GLLightTracker& lt,GLint* uniformLocations) const; // Crea un sombreador de renderizado de superficie de un solo paso basado en la configuración actual del renderizador
-	void renderPixelCornerElevations(const int viewport[4],const PTransform& projectionModelview,GLContextData& contextData,DataItem* dataItem) const; // Crea texturas que contienen elevaciones de esquina de píxeles basadas en la imagen de profundidad actual
+	GLhandleARB createSinglePassSurfaceShader(const GLLightTracker& lt,unsigned int appearance,GLint* uniformLocations) const; // Crea un sombreador de renderizado de superficie de un solo paso basado en la configuración actual del renderizador y la apariencia del agua dada
+	bool useShaderContourLines(void) const // Devuelve verdadero si las líneas de contorno se calculan en el sombreador de superficie
+		{
+		return drawContourLines&&contourGenerator==0;
+		}
+	bool usePixelCornerElevations(void) const // Devuelve verdadero si las líneas de contorno del sombreador necesitan el paso de elevaciones de esquina de píxel
+		{
+		return useShaderContourLines()&&!analyticContourLines;
+		}
+	bool useShadowMap(void) const // Devuelve verdadero si el sombreador de superficie muestrea un mapa de sombras
+		{
+		return illuminate&&useShadows;
+		}
+	unsigned int getShaderFeatures(void) const; // Devuelve la combinación de características que selecciona la variante del sombreador de superficie para la configuración actual
+	void buildSurfaceShader(DataItem* dataItem,const GLLightTracker& lt,unsigned int features,unsigned int appearance) const; // Compila la variante del sombreador de superficie para la combinación de características y la apariencia del agua dadas y la guarda en el mapa de variantes
+	void selectSurfaceShader(DataItem* dataItem,const GLLightTracker& lt) const; // Selecciona la variante del sombreador de superficie para la configuración actual, compilándola solo si aún no existe
+	void precompileWaterAppearance(DataItem* dataItem,const GLLightTracker& lt) const; // Compila como mucho una variante pendiente de las demás apariencias del agua, para repartir las compilaciones entre los cuadros
+	GLuint renderPixelCornerElevations(const int viewport[4],const PTransform& projectionModelview,GLContextData& contextData,DataItem* dataItem) const; // Devuelve una textura que contiene elevaciones de esquina de píxeles basadas en la imagen de profundidad actual para la vista dada, reutilizando el búfer en caché de la vista si sigue siendo válido
 	
 	/* Constructores y destructores: */
 	public:
@@ -123,7 +211,27 @@ class SurfaceRenderer:public GLObject
 	void setDem(DEM* newDem); // Establece un modelo de elevación digital prefabricado para crear una superficie cero para la asignación de color de altura
 	void setDemDistScale(GLfloat newDemDistScale); // Establece la desviación de DEM a superficie para saturar el mapa de color de desviación
 	void setIlluminate(bool newIlluminate); // Establece la bandera de iluminación.
+	void setUseShadows(bool newUseShadows); // Establece la bandera de sombras; solo tiene efecto con iluminación
+	void setShadowMap(GLuint shadowTexture,const PTransform& shadowTextureTransform,GLContextData& contextData) const; // Establece la textura de profundidad del mapa de sombras y su transformación desde el espacio de la cámara para el contexto dado
 	void setLava(bool newLava); // Establece la bandera de lava.
+	unsigned int getNumWaterAppearances(void) const // Devuelve el número de apariencias del agua disponibles
+		{
+		return waterAppearanceNames.size();
+		}
+	const std::string& getWaterAppearanceName(unsigned int appearanceIndex) const // Devuelve el nombre de la apariencia del agua dada
+		{
+		return waterAppearanceNames[appearanceIndex];
+		}
+	unsigned int getWaterAppearance(void) const // Devuelve el índice de la apariencia actual del agua
+		{
+		return waterAppearance;
+		}
+	int findWaterAppearance(const char* appearanceName) const; // Devuelve el índice de la apariencia del agua con el nombre dado, sin distinguir mayúsculas, o -1
+	void setWaterAppearance(unsigned int newWaterAppearance); // Cambia a la apariencia del agua dada, cuyos sombreadores se precompilan en los cuadros siguientes a cada cambio de configuración
+	void setContourGenerator(const ContourGenerator* newContourGenerator); // Establece el generador de líneas de contorno vectoriales; NULL vuelve a las líneas de contorno calculadas en la GPU
+	void setAnalyticContourLines(bool newAnalyticContourLines); // Cambia entre líneas de contorno analíticas en un solo paso y líneas de contorno a partir de elevaciones de esquina de píxel
+	void setReportShaderCompiles(bool newReportShaderCompiles); // Habilita o deshabilita los avisos con el tiempo de compilación de cada variante del sombreador
+	void setFlowAccumulator(const FlowAccumulator* newFlowAccumulator); // Establece el acumulador de flujo cuya red de ríos se dibuja sobre la superficie; NULL deshabilita la red de ríos
 	void setWaterTable(WaterTable2* newWaterTable); // Establece el puntero a la capa freática; NULL deshabilita el manejo del agua
 	void setAdvectWaterTexture(bool newAdvectWaterTexture); // Establece la bandera de advección de coordenadas de textura de agua
 	void setWaterOpacity(GLfloat newWaterOpacity); // Establece el factor de opacidad del agua.
@@ -0,0 +1,150 @@
+/***********************************************************************
+TaskPool - Clase para repartir tareas numeradas entre un conjunto fijo de
+hilos de trabajo y el hilo que ejecuta cada paso paralelo.
+Copyright (c) 2026 Sergio081096
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include "TaskPool.h"
+
+#include <stdexcept>
+#include <Misc/ThrowStdErr.h>
+
+/*************************
+Methods of class TaskPool:
+*************************/
+
+void TaskPool::processTasks(void)
+	{
+	/* Procese tareas hasta que no quede ninguna, o hasta que se cancele el paso o falle una tarea: */
+	while(true)
+		{
+		unsigned int task;
+		{
+		Threads::Mutex::Lock taskLock(taskMutex);
+		if(cancel!=0&&*cancel)
+			cancelled=true;
+		if(cancelled||!error.empty()||nextTask>=numTasks)
+			break;
+		task=nextTask;
+		++nextTask;
+		}
+		
+		try
+			{
+			tasks->processTask(task);
+			}
+		catch(const std::runtime_error& err)
+			{
+			Threads::Mutex::Lock taskLock(taskMutex);
+			if(error.empty())
+				error=err.what();
+			}
+		}
+	
+	/* Señale que este hilo terminó el paso: */
+	Threads::MutexCond::Lock passDoneLock(passDoneCond);
+	++numFinishedThreads;
+	passDoneCond.signal();
+	}
+
+void* TaskPool::workerThreadMethod(void)
+	{
+	unsigned int lastPassVersion=0;
+	while(true)
+		{
+		{
+		Threads::MutexCond::Lock workerLock(workerCond);
+		
+		/* Espere hasta que empiece un nuevo paso o el conjunto se destruya: */
+		while(runWorkerThreads&&lastPassVersion==passVersion)
+			workerCond.wait(workerLock);
+		
+		/* Salte si el conjunto se está destruyendo: */
+		if(!runWorkerThreads)
+			break;
+		
+		lastPassVersion=passVersion;
+		}
+		
+		/* Participe en el paso actual: */
+		processTasks();
+		}
+	
+	return 0;
+	}
+
+TaskPool::TaskPool(unsigned int numThreads)
+	:numWorkerThreads(numThreads>1?numThreads-1:0),
+	 workerThreads(0),
+	 runWorkerThreads(true),
+	 passVersion(0),
+	 tasks(0),
+	 numTasks(0),nextTask(0),
+	 cancel(0),cancelled(false),
+	 numFinishedThreads(0)
+	{
+	/* Inicie los hilos de trabajo, que esperan hasta el primer paso: */
+	workerThreads=new Threads::Thread[numWorkerThreads];
+	for(unsigned int i=0;i<numWorkerThreads;++i)
+		workerThreads[i].start(this,&TaskPool::workerThreadMethod);
+	}
+
+TaskPool::~TaskPool(void)
+	{
+	/* Apague los hilos de trabajo: */
+	{
+	Threads::MutexCond::Lock workerLock(workerCond);
+	runWorkerThreads=false;
+	workerCond.broadcast();
+	}
+	for(unsigned int i=0;i<numWorkerThreads;++i)
+		workerThreads[i].join();
+	delete[] workerThreads;
+	}
+
+bool TaskPool::run(TaskPool::Tasks& newTasks,unsigned int newNumTasks,const volatile bool* newCancel)
+	{
+	/* Inicie el paso en todos los hilos de trabajo: */
+	{
+	Threads::MutexCond::Lock workerLock(workerCond);
+	tasks=&newTasks;
+	numTasks=newNumTasks;
+	nextTask=0;
+	cancel=newCancel;
+	cancelled=false;
+	error.clear();
+	numFinishedThreads=0;
+	++passVersion;
+	workerCond.broadcast();
+	}
+	
+	/* Participe en el paso: */
+	processTasks();
+	
+	/* Espere hasta que todos los hilos terminen el paso: */
+	{
+	Threads::MutexCond::Lock passDoneLock(passDoneCond);
+	while(numFinishedThreads<numWorkerThreads+1)
+		passDoneCond.wait(passDoneLock);
+	}
+	
+	if(!error.empty())
+		Misc::throwStdErr("%s",error.c_str());
+	return !cancelled;
+	}
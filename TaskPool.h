@@ -0,0 +1,85 @@
+/***********************************************************************
+TaskPool - Clase para repartir tareas numeradas entre un conjunto fijo de
+hilos de trabajo y el hilo que ejecuta cada paso paralelo.
+Copyright (c) 2026 Sergio081096
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#ifndef TASKPOOL_INCLUDED
+#define TASKPOOL_INCLUDED
+
+#include <string>
+#include <Threads/Mutex.h>
+#include <Threads/MutexCond.h>
+#include <Threads/Thread.h>
+
+class TaskPool
+	{
+	/* Clases integradas: */
+	public:
+	class Tasks // Clase base para el conjunto de tareas de un paso paralelo
+		{
+		/* Constructores y destructores: */
+		public:
+		virtual ~Tasks(void)
+			{
+			}
+		
+		/* Métodos: */
+		virtual void processTask(unsigned int task) =0; // Procesa la tarea dada; puede ser llamado desde varios hilos a la vez con tareas distintas
+		};
+	
+	/* Elementos: */
+	private:
+	unsigned int numWorkerThreads; // Número de hilos de trabajo adicionales al hilo que ejecuta los pasos
+	Threads::Thread* workerThreads; // Matriz de hilos de trabajo
+	Threads::MutexCond workerCond; // Variable de condición para señalar el inicio de un paso paralelo
+	volatile bool runWorkerThreads; // Marcar para mantener en ejecución los hilos de trabajo
+	unsigned int passVersion; // Número de versión del paso paralelo actual
+	Tasks* tasks; // Conjunto de tareas del paso actual
+	Threads::Mutex taskMutex; // Mutex que protege la asignación de tareas, la cancelación y el mensaje de error
+	unsigned int numTasks; // Número de tareas del paso actual
+	unsigned int nextTask; // Índice de la siguiente tarea sin asignar del paso actual
+	const volatile bool* cancel; // Bandera de cancelación consultada antes de asignar cada tarea, o nulo
+	bool cancelled; // Marcar si el paso actual se abandonó por la bandera de cancelación
+	std::string error; // Mensaje de la primera excepción lanzada por una tarea del paso actual
+	Threads::MutexCond passDoneCond; // Variable de condición para señalar el final del trabajo de un hilo en el paso actual
+	unsigned int numFinishedThreads; // Número de hilos que terminaron el paso actual
+	
+	/* Métodos privados: */
+	void processTasks(void); // Procesa tareas del paso actual hasta agotarlas
+	void* workerThreadMethod(void); // Método para los hilos de trabajo
+	
+	/* Constructores y destructores: */
+	public:
+	TaskPool(unsigned int numThreads); // Crea un conjunto con el número total de hilos dado, incluido el hilo que ejecuta los pasos
+	private:
+	TaskPool(const TaskPool& source); // Prohibir copia constructor
+	TaskPool& operator=(const TaskPool& source); // Prohibir operador de asignación
+	public:
+	~TaskPool(void);
+	
+	/* Métodos: */
+	unsigned int getNumThreads(void) const // Devuelve el número total de hilos, incluido el hilo que ejecuta los pasos
+		{
+		return numWorkerThreads+1;
+		}
+	bool run(Tasks& newTasks,unsigned int newNumTasks,const volatile bool* newCancel=0); // Procesa el número dado de tareas con todos los hilos y vuelve cuando terminan; devuelve falso si la bandera de cancelación dada se activó antes de asignar todas las tareas; relanza la primera excepción de una tarea; no es reentrante
+	};
+
+#endif
@@ -0,0 +1,510 @@
+/***********************************************************************
+TerrainMesh - Clase para convertir una cuadrícula de elevación en una
+malla de triángulos cerrada y diezmada con una base sólida, y escribirla
+en archivos STL binarios u OBJ para la impresión 3D.
+Copyright (c) 2026 Sergio081096
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include "TerrainMesh.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <algorithm>
+#include <functional>
+#include <Misc/SizedTypes.h>
+#include <Misc/Endianness.h>
+#include <Misc/ThrowStdErr.h>
+#include <IO/File.h>
+#include <IO/OpenFile.h>
+#include <Math/Math.h>
+#include <Math/Constants.h>
+
+#include "TaskPool.h"
+
+namespace {
+
+/**************
+Helper objects:
+**************/
+
+const int tileSizeLog=5; // Logaritmo en base dos del lado de los mosaicos en celdas
+
+/**************
+Helper classes:
+**************/
+
+class MeshBuilder:private TaskPool::Tasks // Clase para diezmar una cuadrícula de elevación por mosaicos con varios hilos
+	{
+	/* Clases integradas: */
+	private:
+	enum Pass // Enumerado de los pasos paralelos sobre los mosaicos
+		{
+		COMPUTE_ERRORS, // Calcula el error de aproximación propio de cada vértice
+		PROPAGATE_ERRORS, // Propaga los errores de un nivel de la bisección a sus vértices padres
+		EXTRACT_TRIANGLES // Extrae los triángulos de cada mosaico para el umbral de error actual
+		};
+	
+	enum Coverage // Enumerado de la posición de un triángulo respecto de la cuadrícula
+		{
+		OUTSIDE,INSIDE,STRADDLING
+		};
+	
+	/* Elementos: */
+	const float* elevation; // La cuadrícula de elevación
+	unsigned int size[2]; // Ancho y alto de la cuadrícula de elevación en vértices
+	int tileSize; // Lado de los mosaicos en celdas
+	unsigned int numTiles[2]; // Número de mosaicos en x e y; los mosaicos del borde superior y derecho pueden sobresalir de la cuadrícula
+	int latticeSize[2]; // Ancho y alto de la cuadrícula de errores común en vértices
+	std::vector<unsigned short> triangleCoords; // Coordenadas de los vértices de la hipotenusa de todos los triángulos de la bisección de un mosaico, por niveles
+	int numTriangles; // Número de triángulos divisibles de la bisección de un mosaico
+	std::vector<float> errors; // Cuadrícula de errores común a todos los mosaicos
+	int level; // Nivel de la bisección que se está propagando
+	float threshold; // Umbral de error actual para la extracción
+	std::vector<std::vector<unsigned int> > tileTriangles; // Índices de vértices de la cuadrícula de los triángulos extraídos de cada mosaico
+	Pass pass; // Paso paralelo actual
+	int triangleBegin,triangleEnd; // Intervalo de triángulos de la bisección que procesa el paso actual
+	
+	/* Métodos privados: */
+	Coverage getCoverage(int ax,int ay,int bx,int by,int cx,int cy) const // Devuelve la posición del triángulo dado en coordenadas de la cuadrícula respecto de la cuadrícula
+		{
+		if(Math::min(Math::min(ax,bx),cx)>=int(size[0])-1||Math::min(Math::min(ay,by),cy)>=int(size[1])-1)
+			return OUTSIDE;
+		else if(Math::max(Math::max(ax,bx),cx)<=int(size[0])-1&&Math::max(Math::max(ay,by),cy)<=int(size[1])-1)
+			return INSIDE;
+		else
+			return STRADDLING;
+		}
+	bool isInLattice(int x,int y) const // Devuelve verdadero si el vértice dado está en la cuadrícula de errores
+		{
+		return x>=0&&x<latticeSize[0]&&y>=0&&y<latticeSize[1];
+		}
+	float getError(int ax,int ay,int bx,int by,int cx,int cy) const // Devuelve el error propio del punto medio de la hipotenusa del triángulo dado
+		{
+		/* Los triángulos que cruzan el borde de la cuadrícula deben dividirse siempre, y los exteriores nunca: */
+		Coverage coverage=getCoverage(ax,ay,bx,by,cx,cy);
+		if(coverage==INSIDE)
+			{
+			float interpolated=(elevation[ay*size[0]+ax]+elevation[by*size[0]+bx])*0.5f;
+			return Math::abs(interpolated-elevation[((ay+by)>>1)*size[0]+((ax+bx)>>1)]);
+			}
+		else if(coverage==STRADDLING)
+			return Math::Constants<float>::max;
+		else
+			return 0.0f;
+		}
+	void processErrors(unsigned int tileIndex,int triangleBegin,int triangleEnd)
+		{
+		int s=tileSize;
+		unsigned int tx=tileIndex%numTiles[0];
+		unsigned int ty=tileIndex/numTiles[0];
+		int ox=int(tx)*s;
+		int oy=int(ty)*s;
+		
+		/* Cada mosaico escribe su interior y sus bordes izquierdo e inferior; los mosaicos del borde de la cuadrícula también escriben los demás: */
+		int xEnd=tx<numTiles[0]-1?s:s+1;
+		int yEnd=ty<numTiles[1]-1?s:s+1;
+		for(int i=triangleBegin;i<triangleEnd;++i)
+			{
+			const unsigned short* c=&triangleCoords[i*4];
+			int mx=(c[0]+c[2])>>1;
+			int my=(c[1]+c[3])>>1;
+			if(mx>=xEnd||my>=yEnd)
+				continue;
+			
+			/* Calcule el vértice opuesto de ambos triángulos que comparten la hipotenusa, que pueden estar en mosaicos distintos: */
+			int ax=ox+c[0];
+			int ay=oy+c[1];
+			int bx=ox+c[2];
+			int by=oy+c[3];
+			mx+=ox;
+			my+=oy;
+			int cx[2],cy[2];
+			cx[0]=mx+my-ay;
+			cy[0]=my+ax-mx;
+			cx[1]=2*mx-cx[0];
+			cy[1]=2*my-cy[0];
+			float& mError=errors[my*latticeSize[0]+mx];
+			for(int side=0;side<2;++side)
+				if(isInLattice(cx[side],cy[side]))
+					{
+					if(pass==COMPUTE_ERRORS)
+						mError=Math::max(mError,getError(ax,ay,bx,by,cx[side],cy[side]));
+					else
+						{
+						/* Herede los errores de los puntos medios de los dos triángulos hijos: */
+						mError=Math::max(mError,errors[((ay+cy[side])>>1)*latticeSize[0]+((ax+cx[side])>>1)]);
+						mError=Math::max(mError,errors[((by+cy[side])>>1)*latticeSize[0]+((bx+cx[side])>>1)]);
+						}
+					}
+			}
+		}
+	void extractTriangle(int ax,int ay,int bx,int by,int cx,int cy,std::vector<unsigned int>& indices) const
+		{
+		Coverage coverage=getCoverage(ax,ay,bx,by,cx,cy);
+		if(coverage==OUTSIDE)
+			return;
+		
+		/* Divida el triángulo por el punto medio de su hipotenusa si es demasiado impreciso o cruza el borde de la cuadrícula: */
+		int mx=(ax+bx)>>1;
+		int my=(ay+by)>>1;
+		if(Math::abs(ax-cx)+Math::abs(ay-cy)>1&&(coverage==STRADDLING||errors[my*latticeSize[0]+mx]>threshold))
+			{
+			extractTriangle(cx,cy,ax,ay,mx,my,indices);
+			extractTriangle(bx,by,cx,cy,mx,my,indices);
+			}
+		else
+			{
+			/* Emita el triángulo en sentido antihorario visto desde arriba: */
+			indices.push_back((unsigned int)(ay)*size[0]+(unsigned int)(ax));
+			if((bx-ax)*(cy-ay)-(by-ay)*(cx-ax)>0)
+				{
+				indices.push_back((unsigned int)(by)*size[0]+(unsigned int)(bx));
+				indices.push_back((unsigned int)(cy)*size[0]+(unsigned int)(cx));
+				}
+			else
+				{
+				indices.push_back((unsigned int)(cy)*size[0]+(unsigned int)(cx));
+				indices.push_back((unsigned int)(by)*size[0]+(unsigned int)(bx));
+				}
+			}
+		}
+	virtual void processTask(unsigned int task) // Procesa un mosaico en el paso actual
+		{
+		if(pass==EXTRACT_TRIANGLES)
+			{
+			/* Refine los dos triángulos raíz del mosaico: */
+			int s=tileSize;
+			int ox=int(task%numTiles[0])*s;
+			int oy=int(task/numTiles[0])*s;
+			std::vector<unsigned int>& indices=tileTriangles[task];
+			indices.clear();
+			extractTriangle(ox,oy,ox+s,oy+s,ox+s,oy,indices);
+			extractTriangle(ox+s,oy+s,ox,oy,ox,oy+s,indices);
+			}
+		else
+			processErrors(task,triangleBegin,triangleEnd);
+		}
+	void runPass(Pass newPass,TaskPool& taskPool) // Procesa todos los mosaicos en el paso dado con el conjunto de hilos dado
+		{
+		/* Calcule el intervalo de triángulos del nivel actual de la bisección: */
+		pass=newPass;
+		triangleBegin=0;
+		triangleEnd=numTriangles;
+		if(pass==PROPAGATE_ERRORS)
+			{
+			triangleBegin=(2<<level)-2;
+			triangleEnd=(4<<level)-2;
+			}
+		
+		taskPool.run(*this,numTiles[1]*numTiles[0]);
+		}
+	
+	/* Constructores y destructores: */
+	public:
+	MeshBuilder(const float* sElevation,const unsigned int sSize[2])
+		:elevation(sElevation),
+		 tileSize(1<<tileSizeLog),
+		 level(0),threshold(0.0f),
+		 pass(COMPUTE_ERRORS),triangleBegin(0),triangleEnd(0)
+		{
+		/* Cubra las celdas de la cuadrícula con mosaicos cuadrados del mismo tamaño para que los vecinos compartan su jerarquía de bisección: */
+		for(int i=0;i<2;++i)
+			{
+			size[i]=sSize[i];
+			numTiles[i]=(size[i]-1+tileSize-1)/tileSize;
+			latticeSize[i]=int(numTiles[i])*tileSize+1;
+			}
+		errors.resize(size_t(latticeSize[1])*size_t(latticeSize[0]),0.0f);
+		tileTriangles.resize(numTiles[1]*numTiles[0]);
+		
+		/* Precalcule las hipotenusas de todos los triángulos de la bisección de un mosaico; los identificadores de cada nivel son consecutivos: */
+		int s=tileSize;
+		numTriangles=s*s*2-2;
+		triangleCoords.reserve(numTriangles*4);
+		for(int i=0;i<numTriangles;++i)
+			{
+			/* Descienda desde uno de los dos triángulos raíz siguiendo los bits del identificador del triángulo: */
+			int id=i+2;
+			int ax=0,ay=0,bx=0,by=0,cx=0,cy=0;
+			if(id&1)
+				bx=by=cx=s;
+			else
+				ax=ay=cy=s;
+			while((id>>=1)>1)
+				{
+				int mx=(ax+bx)>>1;
+				int my=(ay+by)>>1;
+				if(id&1)
+					{
+					bx=ax;
+					by=ay;
+					ax=cx;
+					ay=cy;
+					}
+				else
+					{
+					ax=bx;
+					ay=by;
+					bx=cx;
+					by=cy;
+					}
+				cx=mx;
+				cy=my;
+				}
+			triangleCoords.push_back((unsigned short)(ax));
+			triangleCoords.push_back((unsigned short)(ay));
+			triangleCoords.push_back((unsigned short)(bx));
+			triangleCoords.push_back((unsigned short)(by));
+			}
+		}
+	
+	/* Métodos: */
+	void computeErrors(TaskPool& taskPool) // Calcula los errores de aproximación de todos los vértices, coherentes entre mosaicos vecinos
+		{
+		runPass(COMPUTE_ERRORS,taskPool);
+		
+		/* Propague los errores nivel por nivel desde el más fino, ya que cada punto medio hereda de los hijos de los dos triángulos que comparten su hipotenusa, que pueden estar en mosaicos distintos: */
+		for(level=2*tileSizeLog-2;level>=0;--level)
+			runPass(PROPAGATE_ERRORS,taskPool);
+		}
+	float selectThreshold(size_t maxNumSplits) const // Devuelve el umbral de error que divide como máximo el número dado de vértices de la cuadrícula
+		{
+		/* Recoja los errores de los vértices dentro de la cuadrícula; los vértices de triángulos que cruzan el borde se dividen siempre: */
+		std::vector<float> candidates;
+		size_t numForced=0;
+		float maxCandidate=0.0f;
+		for(unsigned int y=0;y<size[1];++y)
+			{
+			const float* gPtr=&errors[size_t(y)*size_t(latticeSize[0])];
+			for(unsigned int x=0;x<size[0];++x)
+				{
+				if(gPtr[x]==Math::Constants<float>::max)
+					++numForced;
+				else if(gPtr[x]>0.0f)
+					{
+					candidates.push_back(gPtr[x]);
+					maxCandidate=Math::max(maxCandidate,gPtr[x]);
+					}
+				}
+			}
+		
+		/* Busque el error del primer vértice que ya no cabe en el presupuesto: */
+		if(maxNumSplits<=numForced)
+			return maxCandidate;
+		size_t numFree=maxNumSplits-numForced;
+		if(numFree>=candidates.size())
+			return 0.0f;
+		std::nth_element(candidates.begin(),candidates.begin()+numFree,candidates.end(),std::greater<float>());
+		return candidates[numFree];
+		}
+	void extractTriangles(float newThreshold,TaskPool& taskPool) // Extrae los triángulos de todos los mosaicos para el umbral de error dado
+		{
+		threshold=newThreshold;
+		runPass(EXTRACT_TRIANGLES,taskPool);
+		}
+	const std::vector<std::vector<unsigned int> >& getTileTriangles(void) const
+		{
+		return tileTriangles;
+		}
+	};
+
+}
+
+/****************************
+Methods of class TerrainMesh:
+****************************/
+
+TerrainMesh::TerrainMesh(const float* elevation,const unsigned int gridSize[2],const float cellSize[2],float baseThickness,unsigned int maxNumTriangles,unsigned int numThreads)
+	:maxError(0.0f)
+	{
+	if(gridSize[0]<2||gridSize[1]<2)
+		Misc::throwStdErr("TerrainMesh: Elevation grid is too small");
+	
+	/* Calcule los errores de aproximación coherentes entre mosaicos vecinos: */
+	TaskPool taskPool(numThreads);
+	MeshBuilder builder(elevation,gridSize);
+	builder.computeErrors(taskPool);
+	
+	/* Calcule el perímetro de la cuadrícula en vértices; cada arista del borde cuesta dos triángulos de pared y uno de la base: */
+	size_t numBorderVertices=size_t(gridSize[0]-1)*2+size_t(gridSize[1]-1)*2;
+	
+	/* Cada vértice dividido añade unos dos triángulos a la superficie; corrija la estimación si el borde añadió demasiados: */
+	double maxNumSplits=double(maxNumTriangles)*0.5;
+	std::vector<unsigned int> vertexIndices(size_t(gridSize[1])*size_t(gridSize[0]));
+	std::vector<unsigned int> border;
+	for(int attempt=0;attempt<4;++attempt)
+		{
+		/* Extraiga la superficie diezmada con el umbral de error elegido: */
+		maxError=builder.selectThreshold(size_t(maxNumSplits));
+		builder.extractTriangles(maxError,taskPool);
+		
+		/* Cuente los vértices del borde usados por la superficie para saber el tamaño de la malla cerrada: */
+		const std::vector<std::vector<unsigned int> >& tileTriangles=builder.getTileTriangles();
+		std::fill(vertexIndices.begin(),vertexIndices.end(),~0U);
+		size_t numSurfaceTriangles=0;
+		for(std::vector<std::vector<unsigned int> >::const_iterator ttIt=tileTriangles.begin();ttIt!=tileTriangles.end();++ttIt)
+			{
+			numSurfaceTriangles+=ttIt->size()/3;
+			for(std::vector<unsigned int>::const_iterator iIt=ttIt->begin();iIt!=ttIt->end();++iIt)
+				vertexIndices[*iIt]=0U;
+			}
+		border.clear();
+		for(unsigned int i=0;i<numBorderVertices;++i)
+			{
+			/* Recorra el borde en sentido antihorario visto desde arriba, empezando en la esquina suroeste: */
+			unsigned int x,y;
+			if(i<gridSize[0]-1)
+				{
+				x=i;
+				y=0;
+				}
+			else if(i<gridSize[0]-1+gridSize[1]-1)
+				{
+				x=gridSize[0]-1;
+				y=i-(gridSize[0]-1);
+				}
+			else if(i<(gridSize[0]-1)*2+gridSize[1]-1)
+				{
+				x=gridSize[0]-1-(i-(gridSize[0]-1+gridSize[1]-1));
+				y=gridSize[1]-1;
+				}
+			else
+				{
+				x=0;
+				y=gridSize[1]-1-(i-((gridSize[0]-1)*2+gridSize[1]-1));
+				}
+			unsigned int gridIndex=y*gridSize[0]+x;
+			if(vertexIndices[gridIndex]==0U)
+				border.push_back(gridIndex);
+			}
+		
+		size_t numTotalTriangles=numSurfaceTriangles+border.size()*3;
+		if(numTotalTriangles<=size_t(maxNumTriangles)+size_t(maxNumTriangles)/50||maxError==0.0f||attempt==3)
+			break;
+		maxNumSplits*=double(maxNumTriangles)/double(numTotalTriangles);
+		}
+	
+	/* Numere los vértices de la superficie en el orden de los mosaicos: */
+	const std::vector<std::vector<unsigned int> >& tileTriangles=builder.getTileTriangles();
+	float zMin=elevation[0];
+	for(size_t i=1;i<vertexIndices.size();++i)
+		zMin=Math::min(zMin,elevation[i]);
+	float zBase=zMin-baseThickness;
+	unsigned int numVertices=0;
+	for(std::vector<std::vector<unsigned int> >::const_iterator ttIt=tileTriangles.begin();ttIt!=tileTriangles.end();++ttIt)
+		for(std::vector<unsigned int>::const_iterator iIt=ttIt->begin();iIt!=ttIt->end();++iIt)
+			if(vertexIndices[*iIt]==0U)
+				{
+				vertexIndices[*iIt]=numVertices+1U;
+				unsigned int x=*iIt%gridSize[0];
+				unsigned int y=*iIt/gridSize[0];
+				vertices.push_back(float(x)*cellSize[0]);
+				vertices.push_back(float(y)*cellSize[1]);
+				vertices.push_back(elevation[*iIt]);
+				++numVertices;
+				}
+	
+	/* Copie los triángulos de la superficie: */
+	for(std::vector<std::vector<unsigned int> >::const_iterator ttIt=tileTriangles.begin();ttIt!=tileTriangles.end();++ttIt)
+		for(std::vector<unsigned int>::const_iterator iIt=ttIt->begin();iIt!=ttIt->end();++iIt)
+			triangles.push_back(vertexIndices[*iIt]-1U);
+	
+	/* Cree un vértice de la base debajo de cada vértice del borde y uno en el centro de la base: */
+	unsigned int baseStart=numVertices;
+	for(std::vector<unsigned int>::iterator bIt=border.begin();bIt!=border.end();++bIt)
+		{
+		vertices.push_back(float(*bIt%gridSize[0])*cellSize[0]);
+		vertices.push_back(float(*bIt/gridSize[0])*cellSize[1]);
+		vertices.push_back(zBase);
+		}
+	unsigned int baseCenter=baseStart+(unsigned int)(border.size());
+	vertices.push_back(float(gridSize[0]-1)*cellSize[0]*0.5f);
+	vertices.push_back(float(gridSize[1]-1)*cellSize[1]*0.5f);
+	vertices.push_back(zBase);
+	
+	/* Cierre la malla con una pared vertical por cada arista del borde y un abanico de triángulos en la base: */
+	unsigned int numBorder=(unsigned int)(border.size());
+	for(unsigned int i=0;i<numBorder;++i)
+		{
+		unsigned int j=i+1<numBorder?i+1:0;
+		unsigned int p=vertexIndices[border[i]]-1U;
+		unsigned int q=vertexIndices[border[j]]-1U;
+		unsigned int pBase=baseStart+i;
+		unsigned int qBase=baseStart+j;
+		unsigned int wall[9]={p,pBase,qBase,p,qBase,q,baseCenter,qBase,pBase};
+		triangles.insert(triangles.end(),wall,wall+9);
+		}
+	}
+
+void TerrainMesh::writeSTL(const char* fileName) const
+	{
+	IO::FilePtr file=IO::openFile(fileName,IO::File::WriteOnly);
+	file->setEndianness(Misc::LittleEndian);
+	
+	/* Escribe el encabezado; no debe empezar con "solid" para no confundirse con el formato STL de texto: */
+	char header[80];
+	memset(header,0,sizeof(header));
+	strncpy(header,"SARndbox terrain mesh",sizeof(header));
+	file->write<char>(header,sizeof(header));
+	file->write<Misc::UInt32>(Misc::UInt32(getNumTriangles()));
+	
+	/* Escribe cada triángulo con su normal: */
+	for(std::vector<unsigned int>::const_iterator tIt=triangles.begin();tIt!=triangles.end();tIt+=3)
+		{
+		Misc::Float32 record[12];
+		for(int i=0;i<3;++i)
+			for(int j=0;j<3;++j)
+				record[3+i*3+j]=vertices[tIt[i]*3+j];
+		float e1[3],e2[3];
+		for(int j=0;j<3;++j)
+			{
+			e1[j]=record[6+j]-record[3+j];
+			e2[j]=record[9+j]-record[3+j];
+			}
+		record[0]=e1[1]*e2[2]-e1[2]*e2[1];
+		record[1]=e1[2]*e2[0]-e1[0]*e2[2];
+		record[2]=e1[0]*e2[1]-e1[1]*e2[0];
+		float length=Math::sqrt(record[0]*record[0]+record[1]*record[1]+record[2]*record[2]);
+		if(length>0.0f)
+			for(int j=0;j<3;++j)
+				record[j]/=length;
+		file->write<Misc::Float32>(record,12);
+		file->write<Misc::UInt16>(0);
+		}
+	}
+
+void TerrainMesh::writeOBJ(const char* fileName) const
+	{
+	IO::FilePtr file=IO::openFile(fileName,IO::File::WriteOnly);
+	
+	/* Escribe los vértices y luego los triángulos con índices basados en 1: */
+	char line[96];
+	int lineLength=snprintf(line,sizeof(line),"# SARndbox terrain mesh\no terrain\n");
+	file->write<char>(line,lineLength);
+	for(std::vector<float>::const_iterator vIt=vertices.begin();vIt!=vertices.end();vIt+=3)
+		{
+		lineLength=snprintf(line,sizeof(line),"v %.6g %.6g %.6g\n",vIt[0],vIt[1],vIt[2]);
+		file->write<char>(line,lineLength);
+		}
+	for(std::vector<unsigned int>::const_iterator tIt=triangles.begin();tIt!=triangles.end();tIt+=3)
+		{
+		lineLength=snprintf(line,sizeof(line),"f %u %u %u\n",tIt[0]+1U,tIt[1]+1U,tIt[2]+1U);
+		file->write<char>(line,lineLength);
+		}
+	}
@@ -0,0 +1,67 @@
+/***********************************************************************
+TerrainMesh - Clase para convertir una cuadrícula de elevación en una
+malla de triángulos cerrada y diezmada con una base sólida, y escribirla
+en archivos STL binarios u OBJ para la impresión 3D.
+Copyright (c) 2026 Sergio081096
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#ifndef TERRAINMESH_INCLUDED
+#define TERRAINMESH_INCLUDED
+
+#include <stddef.h>
+#include <vector>
+
+class TerrainMesh
+	{
+	/* Elementos: */
+	private:
+	std::vector<float> vertices; // Coordenadas x, y, z de los vértices de la malla
+	std::vector<unsigned int> triangles; // Índices de los vértices de cada triángulo, en sentido antihorario vistos desde fuera
+	float maxError; // Error máximo de elevación de la superficie diezmada
+	
+	/* Constructores y destructores: */
+	public:
+	TerrainMesh(const float* elevation,const unsigned int gridSize[2],const float cellSize[2],float baseThickness,unsigned int maxNumTriangles,unsigned int numThreads); // Crea una malla cerrada de la cuadrícula de elevación dada, con filas de sur a norte, con aproximadamente el número máximo de triángulos dado
+	
+	/* Métodos: */
+	size_t getNumVertices(void) const // Devuelve el número de vértices de la malla
+		{
+		return vertices.size()/3;
+		}
+	size_t getNumTriangles(void) const // Devuelve el número de triángulos de la malla
+		{
+		return triangles.size()/3;
+		}
+	const std::vector<float>& getVertices(void) const // Devuelve las coordenadas x, y, z de los vértices de la malla
+		{
+		return vertices;
+		}
+	const std::vector<unsigned int>& getTriangles(void) const // Devuelve los índices de los vértices de cada triángulo
+		{
+		return triangles;
+		}
+	float getMaxError(void) const // Devuelve el error máximo de elevación de la superficie diezmada
+		{
+		return maxError;
+		}
+	void writeSTL(const char* fileName) const; // Escribe la malla en un archivo STL binario
+	void writeOBJ(const char* fileName) const; // Escribe la malla en un archivo OBJ de Wavefront
+	};
+
+#endif
@@ -0,0 +1,210 @@
+/***********************************************************************
+TerrainMeshCheck - Utilidad que comprueba la malla cerrada de terreno:
+cada arista dirigida debe tener exactamente una arista opuesta, ningún
+triángulo debe ser degenerado, el volumen encerrado debe coincidir con
+el de la cuadrícula dentro del error de diezmado, y el resultado no debe
+depender del número de hilos.
+Copyright (c) 2026 Sergio081096
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include <math.h>
+#include <utility>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+#include "TerrainMesh.h"
+
+namespace {
+
+/****************
+Helper functions:
+****************/
+
+bool check(const char* name,double value,double expected,double tolerance)
+	{
+	bool ok=fabs(value-expected)<=tolerance;
+	std::cout<<name<<' '<<value<<" (expected "<<expected<<") "<<(ok?"ok":"FAILED")<<std::endl;
+	return ok;
+	}
+
+bool checkRange(const char* name,double value,double min,double max)
+	{
+	bool ok=value>=min&&value<=max;
+	std::cout<<name<<' '<<value<<" (expected "<<min<<" to "<<max<<") "<<(ok?"ok":"FAILED")<<std::endl;
+	return ok;
+	}
+
+size_t countOpenEdges(const TerrainMesh& mesh) // Devuelve el número de aristas dirigidas que no aparecen exactamente una vez junto con su opuesta
+	{
+	/* Reúna y ordene todas las aristas dirigidas de los triángulos: */
+	const std::vector<unsigned int>& triangles=mesh.getTriangles();
+	std::vector<std::pair<unsigned int,unsigned int> > edges;
+	edges.reserve(triangles.size());
+	for(size_t i=0;i<triangles.size();i+=3)
+		for(int j=0;j<3;++j)
+			edges.push_back(std::make_pair(triangles[i+j],triangles[i+(j+1)%3]));
+	std::sort(edges.begin(),edges.end());
+	
+	/* Busque cada arista repetida y la arista opuesta de cada arista: */
+	size_t numOpenEdges=0;
+	for(size_t i=0;i<edges.size();++i)
+		{
+		bool repeated=(i>0&&edges[i-1]==edges[i])||(i+1<edges.size()&&edges[i+1]==edges[i]);
+		std::pair<unsigned int,unsigned int> opposite(edges[i].second,edges[i].first);
+		std::pair<std::vector<std::pair<unsigned int,unsigned int> >::const_iterator,std::vector<std::pair<unsigned int,unsigned int> >::const_iterator> range=std::equal_range(edges.begin(),edges.end(),opposite);
+		if(repeated||range.second-range.first!=1)
+			++numOpenEdges;
+		}
+	
+	return numOpenEdges;
+	}
+
+size_t countDegenerateTriangles(const TerrainMesh& mesh) // Devuelve el número de triángulos sin área
+	{
+	const std::vector<float>& vertices=mesh.getVertices();
+	const std::vector<unsigned int>& triangles=mesh.getTriangles();
+	size_t numDegenerate=0;
+	for(size_t i=0;i<triangles.size();i+=3)
+		{
+		const float* v0=&vertices[triangles[i+0]*3];
+		const float* v1=&vertices[triangles[i+1]*3];
+		const float* v2=&vertices[triangles[i+2]*3];
+		double e1[3],e2[3];
+		for(int j=0;j<3;++j)
+			{
+			e1[j]=double(v1[j])-double(v0[j]);
+			e2[j]=double(v2[j])-double(v0[j]);
+			}
+		double n[3]={e1[1]*e2[2]-e1[2]*e2[1],e1[2]*e2[0]-e1[0]*e2[2],e1[0]*e2[1]-e1[1]*e2[0]};
+		if(n[0]==0.0&&n[1]==0.0&&n[2]==0.0)
+			++numDegenerate;
+		}
+	
+	return numDegenerate;
+	}
+
+double calcVolume(const TerrainMesh& mesh) // Devuelve el volumen encerrado por la malla como suma de tetraedros con el origen
+	{
+	const std::vector<float>& vertices=mesh.getVertices();
+	const std::vector<unsigned int>& triangles=mesh.getTriangles();
+	double volume=0.0;
+	for(size_t i=0;i<triangles.size();i+=3)
+		{
+		const float* a=&vertices[triangles[i+0]*3];
+		const float* b=&vertices[triangles[i+1]*3];
+		const float* c=&vertices[triangles[i+2]*3];
+		volume+=(double(a[0])*(double(b[1])*double(c[2])-double(b[2])*double(c[1]))
+		        -double(a[1])*(double(b[0])*double(c[2])-double(b[2])*double(c[0]))
+		        +double(a[2])*(double(b[0])*double(c[1])-double(b[1])*double(c[0])))/6.0;
+		}
+	
+	return volume;
+	}
+
+void calcGridVolumeRange(const std::vector<float>& elevation,const unsigned int gridSize[2],const float cellSize[2],float zBase,double& minVolume,double& maxVolume) // Calcula el volumen de la cuadrícula sobre la base para las dos diagonales posibles de cada celda
+	{
+	double cellArea=double(cellSize[0])*double(cellSize[1]);
+	minVolume=maxVolume=0.0;
+	for(unsigned int y=0;y+1<gridSize[1];++y)
+		for(unsigned int x=0;x+1<gridSize[0];++x)
+			{
+			const float* e=&elevation[size_t(y)*gridSize[0]+x];
+			double z00=double(e[0])-double(zBase);
+			double z10=double(e[1])-double(zBase);
+			double z01=double(e[gridSize[0]])-double(zBase);
+			double z11=double(e[gridSize[0]+1])-double(zBase);
+			double v1=cellArea*(2.0*z00+z10+z01+2.0*z11)/6.0;
+			double v2=cellArea*(z00+2.0*z10+2.0*z01+z11)/6.0;
+			minVolume+=std::min(v1,v2);
+			maxVolume+=std::max(v1,v2);
+			}
+	}
+
+bool checkMesh(const char* name,const std::vector<float>& elevation,const unsigned int gridSize[2],const float cellSize[2],float baseThickness,unsigned int maxNumTriangles,bool exact) // Crea la malla de la cuadrícula dada con uno y con cuatro hilos y comprueba ambas; una cuadrícula exacta debe diezmarse sin error
+	{
+	std::cout<<name<<':'<<std::endl;
+	bool ok=true;
+	
+	TerrainMesh mesh(&elevation[0],gridSize,cellSize,baseThickness,maxNumTriangles,1);
+	std::cout<<"Vertices "<<mesh.getNumVertices()<<std::endl;
+	if(exact)
+		ok=check("Maximum error",mesh.getMaxError(),0.0,0.0)&&ok;
+	ok=checkRange("Triangles",double(mesh.getNumTriangles()),1.0,double(maxNumTriangles)+double(maxNumTriangles/50))&&ok;
+	ok=check("Open directed edges",double(countOpenEdges(mesh)),0.0,0.0)&&ok;
+	ok=check("Degenerate triangles",double(countDegenerateTriangles(mesh)),0.0,0.0)&&ok;
+	
+	/* El volumen difiere del de la cuadrícula completa a lo sumo en el error de diezmado sobre toda el área: */
+	float zMin=*std::min_element(elevation.begin(),elevation.end());
+	double minVolume,maxVolume;
+	calcGridVolumeRange(elevation,gridSize,cellSize,zMin-baseThickness,minVolume,maxVolume);
+	double area=double(gridSize[0]-1)*double(cellSize[0])*double(gridSize[1]-1)*double(cellSize[1]);
+	double tolerance=double(mesh.getMaxError())*area+maxVolume*1.0e-5;
+	ok=checkRange("Volume",calcVolume(mesh),minVolume-tolerance,maxVolume+tolerance)&&ok;
+	
+	/* La malla debe ser idéntica con varios hilos: */
+	TerrainMesh parallelMesh(&elevation[0],gridSize,cellSize,baseThickness,maxNumTriangles,4);
+	bool identical=parallelMesh.getVertices()==mesh.getVertices()&&parallelMesh.getTriangles()==mesh.getTriangles();
+	std::cout<<"Four threads "<<(identical?"identical ok":"different FAILED")<<std::endl;
+	ok=identical&&ok;
+	
+	return ok;
+	}
+
+}
+
+int main(int argc,char* argv[])
+	{
+	/* Parámetros del escenario: una cuadrícula de 640x480 con celdas de 0.25cm y una base de 2cm: */
+	const unsigned int gridSize[2]={640,480};
+	const float cellSize[2]={0.25f,0.25f};
+	const float baseThickness=2.0f;
+	const unsigned int maxNumTriangles=100000;
+	
+	try
+		{
+		bool ok=true;
+		std::vector<float> elevation(size_t(gridSize[1])*size_t(gridSize[0]));
+		
+		/* Un plano inclinado debe diezmarse sin error, con el volumen exacto del prisma: */
+		for(unsigned int y=0;y<gridSize[1];++y)
+			for(unsigned int x=0;x<gridSize[0];++x)
+				elevation[size_t(y)*gridSize[0]+x]=float(5.0+0.015625*double(x)-0.03125*double(y));
+		ok=checkMesh("Inclined plane",elevation,gridSize,cellSize,baseThickness,maxNumTriangles,true)&&ok;
+		
+		/* Un terreno ondulado con una colina y ruido debe ajustarse al presupuesto de triángulos: */
+		for(unsigned int y=0;y<gridSize[1];++y)
+			for(unsigned int x=0;x<gridSize[0];++x)
+				{
+				double dx=double(x)-300.0;
+				double dy=double(y)-200.0;
+				double noise=double((x*7919U+y*104729U)%100U)*0.0005;
+				elevation[size_t(y)*gridSize[0]+x]=float(10.0*sin(double(x)*0.02)*cos(double(y)*0.03)+5.0*exp(-(dx*dx+dy*dy)/2000.0)+noise);
+				}
+		ok=checkMesh("Rolling terrain",elevation,gridSize,cellSize,baseThickness,maxNumTriangles,false)&&ok;
+		
+		return ok?0:1;
+		}
+	catch(const std::runtime_error& err)
+		{
+		std::cerr<<"Caught exception "<<err.what()<<std::endl;
+		return 1;
+		}
+	}
@@ -0,0 +1,168 @@
+/***********************************************************************
+TimeLapseCheck - Utilidad que comprueba el grabador y el lector de lapso
+de tiempo: graba cuadros sintéticos con y sin agua, los lee en orden
+arbitrario a través de los cuadros clave, y vuelve a leerlos tras cortar
+el índice y el último cuadro del archivo.
+Copyright (c) 2026 Sergio081096
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <vector>
+#include <iostream>
+#include <stdexcept>
+
+#include "ChunkedFile.h"
+#include "TimeLapseRecorder.h"
+#include "TimeLapseReader.h"
+
+namespace {
+
+/****************
+Helper functions:
+****************/
+
+bool check(const char* name,double value,double expected,double tolerance)
+	{
+	bool ok=fabs(value-expected)<=tolerance;
+	std::cout<<name<<' '<<value<<" (expected "<<expected<<") "<<(ok?"ok":"FAILED")<<std::endl;
+	return ok;
+	}
+
+bool hasWater(unsigned int frameIndex) // Devuelve verdadero si el cuadro sintético dado tiene una cuadrícula de agua
+	{
+	return frameIndex%3!=1;
+	}
+
+void createFrame(unsigned int frameIndex,const unsigned int elevationSize[2],const unsigned int waterSize[2],std::vector<float>& elevation,std::vector<float>& waterLevel) // Crea las cuadrículas del cuadro sintético dado
+	{
+	elevation.resize(size_t(elevationSize[1])*size_t(elevationSize[0]));
+	for(size_t i=0;i<elevation.size();++i)
+		elevation[i]=float(sin(double(i)*0.01+double(frameIndex)*0.1)+(i%7==0?double(frameIndex):0.0));
+	waterLevel.resize(size_t(waterSize[1])*size_t(waterSize[0]));
+	for(size_t i=0;i<waterLevel.size();++i)
+		waterLevel[i]=float(cos(double(i)*0.03+double(frameIndex)));
+	}
+
+unsigned int checkFrames(const char* fileName,unsigned int numFrames,const unsigned int elevationSize[2],const unsigned int waterSize[2]) // Lee los cuadros del archivo en orden arbitrario y devuelve el número de cuadros distintos de los grabados
+	{
+	TimeLapseReader reader(fileName);
+	
+	/* Salte hacia adelante y hacia atrás a través de los cuadros clave: */
+	static const unsigned int order[]={0,7,3,22,21,10,11,12,4,1,2};
+	std::vector<float> elevation,waterLevel;
+	unsigned int numBadFrames=0;
+	for(unsigned int i=0;i<sizeof(order)/sizeof(order[0]);++i)
+		{
+		unsigned int frameIndex=order[i];
+		if(frameIndex>=reader.getNumFrames())
+			continue;
+		reader.readFrame(frameIndex);
+		createFrame(frameIndex,elevationSize,waterSize,elevation,waterLevel);
+		bool ok=memcmp(reader.getElevation(),&elevation[0],elevation.size()*sizeof(float))==0;
+		if(hasWater(frameIndex))
+			ok=ok&&reader.getWaterLevel()!=0&&memcmp(reader.getWaterLevel(),&waterLevel[0],waterLevel.size()*sizeof(float))==0;
+		else
+			ok=ok&&reader.getWaterLevel()==0;
+		if(!ok)
+			++numBadFrames;
+		}
+	
+	return numBadFrames;
+	}
+
+}
+
+int main(int argc,char* argv[])
+	{
+	/* Parámetros del escenario: 23 cuadros de 64x48 con agua de 32x24 en dos de cada tres cuadros y un cuadro clave cada 5 cuadros: */
+	const unsigned int elevationSize[2]={64,48};
+	const unsigned int waterSize[2]={32,24};
+	const unsigned int numFrames=23;
+	const unsigned int keyframeInterval=5;
+	const double frameInterval=0.5;
+	const char* fileName="TimeLapseCheck.tlp";
+	
+	try
+		{
+		bool ok=true;
+		
+		/* Grabe los cuadros sintéticos, reintentando los cuadros descartados por una cola llena: */
+		{
+		TimeLapseRecorder recorder(fileName,elevationSize,waterSize,keyframeInterval);
+		std::vector<float> elevation,waterLevel;
+		for(unsigned int frameIndex=0;frameIndex<numFrames;++frameIndex)
+			{
+			createFrame(frameIndex,elevationSize,waterSize,elevation,waterLevel);
+			while(!recorder.addFrame(double(frameIndex)*frameInterval,&elevation[0],hasWater(frameIndex)?&waterLevel[0]:0))
+				usleep(1000);
+			}
+		std::string error=recorder.getError();
+		if(!error.empty())
+			{
+			std::cout<<"Recorder error "<<error<<" FAILED"<<std::endl;
+			ok=false;
+			}
+		}
+		
+		/* Lea el archivo cerrado correctamente a través de su índice: */
+		{
+		TimeLapseReader reader(fileName);
+		ok=check("Frames",reader.getNumFrames(),numFrames,0.0)&&ok;
+		ok=check("Last frame time (s)",reader.getFrameTime(numFrames-1),double(numFrames-1)*frameInterval,0.0)&&ok;
+		ok=check("Frame at 3.2s",reader.findFrame(3.2),6,0.0)&&ok;
+		}
+		ok=check("Bad frames",checkFrames(fileName,numFrames,elevationSize,waterSize),0,0.0)&&ok;
+		
+		/* Corte el final del archivo, como tras un fallo durante el cierre, y lea el archivo recorriendo los fragmentos: */
+		struct stat fileStats;
+		if(stat(fileName,&fileStats)<0)
+			throw std::runtime_error("Unable to query size of time lapse file");
+		off_t fileSize=fileStats.st_size;
+		if(truncate(fileName,fileSize-ChunkedFile::trailerSize/2)<0)
+			throw std::runtime_error("Unable to truncate time lapse file");
+		{
+		TimeLapseReader reader(fileName);
+		ok=check("Frames without trailer",reader.getNumFrames(),numFrames,0.0)&&ok;
+		}
+		ok=check("Bad frames without trailer",checkFrames(fileName,numFrames,elevationSize,waterSize),0,0.0)&&ok;
+		
+		/* Corte también el índice y el último byte del último cuadro, que debe descartarse: */
+		off_t indexSize=2*sizeof(Misc::UInt32)+numFrames*ChunkedFile::indexEntrySize;
+		if(truncate(fileName,fileSize-ChunkedFile::trailerSize-indexSize-1)<0)
+			throw std::runtime_error("Unable to truncate time lapse file");
+		{
+		TimeLapseReader reader(fileName);
+		ok=check("Frames with truncated last frame",reader.getNumFrames(),numFrames-1,0.0)&&ok;
+		}
+		ok=check("Bad frames with truncated last frame",checkFrames(fileName,numFrames,elevationSize,waterSize),0,0.0)&&ok;
+		
+		unlink(fileName);
+		return ok?0:1;
+		}
+	catch(const std::runtime_error& err)
+		{
+		unlink(fileName);
+		std::cerr<<"Caught exception "<<err.what()<<std::endl;
+		return 1;
+		}
+	}
@@ -0,0 +1,130 @@
+/***********************************************************************
+TimeLapseFile - Definiciones compartidas del formato de archivo de las
+grabaciones de lapso de tiempo de la cuadrícula de elevación y de la
+cuadrícula de agua, y funciones para codificar y decodificar cuadrículas
+como diferencias comprimidas respecto del cuadro anterior.
+Copyright (c) 2026 Sergio081096
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include "TimeLapseFile.h"
+
+#include <string.h>
+#include <zlib.h>
+#include <Misc/ThrowStdErr.h>
+
+namespace TimeLapseFile {
+
+const char fileMagic[8]={'S','A','R','T','L','A','P','S'};
+const char trailerMagic[8]={'S','A','R','T','L','E','N','D'};
+
+namespace {
+
+/****************
+Helper functions:
+****************/
+
+inline Misc::UInt32 getBits(const float* grid,size_t index) // Devuelve los bits del valor dado de una cuadrícula
+	{
+	Misc::UInt32 result;
+	memcpy(&result,grid+index,sizeof(Misc::UInt32));
+	return result;
+	}
+
+}
+
+void encodeGrid(const float* grid,const float* previousGrid,size_t numValues,std::vector<Misc::UInt32>& rleBuffer,std::vector<unsigned char>& result)
+	{
+	/* Calcule las diferencias con la cuadrícula anterior, o con cero en un cuadro clave: */
+	rleBuffer.resize(numValues);
+	Misc::UInt32* dPtr=&rleBuffer[0];
+	for(size_t i=0;i<numValues;++i)
+		dPtr[i]=getBits(grid,i)^(previousGrid!=0?getBits(previousGrid,i):0U);
+	
+	/* Codifique las diferencias como pares de una serie de ceros y una serie literal; los ceros aislados se quedan en las series literales: */
+	std::vector<Misc::UInt32> rle;
+	rle.reserve(numValues/8+16);
+	size_t i=0;
+	while(i<numValues)
+		{
+		/* Mida la serie de ceros: */
+		size_t zeroStart=i;
+		while(i<numValues&&dPtr[i]==0U)
+			++i;
+		rle.push_back(Misc::UInt32(i-zeroStart));
+		
+		/* Mida la serie literal, que termina con dos ceros consecutivos: */
+		size_t literalStart=i;
+		while(i<numValues&&(dPtr[i]!=0U||(i+1<numValues&&dPtr[i+1]!=0U)))
+			++i;
+		rle.push_back(Misc::UInt32(i-literalStart));
+		rle.insert(rle.end(),dPtr+literalStart,dPtr+i);
+		}
+	
+	/* Comprima la codificación con deflate a la velocidad máxima: */
+	result.clear();
+	if(rle.empty())
+		return;
+	uLong rleSize=uLong(rle.size()*sizeof(Misc::UInt32));
+	uLongf compressedSize=compressBound(rleSize);
+	result.resize(compressedSize);
+	if(compress2(&result[0],&compressedSize,reinterpret_cast<const Bytef*>(&rle[0]),rleSize,Z_BEST_SPEED)!=Z_OK)
+		Misc::throwStdErr("TimeLapseFile::encodeGrid: Unable to compress grid");
+	result.resize(compressedSize);
+	}
+
+void decodeGrid(const unsigned char* data,size_t dataSize,size_t numValues,bool keyframe,std::vector<Misc::UInt32>& rleBuffer,float* grid)
+	{
+	/* Descomprima la codificación; cada par de series cubre al menos dos valores salvo el último: */
+	rleBuffer.resize(numValues*2+4);
+	uLongf rleSize=uLongf(rleBuffer.size()*sizeof(Misc::UInt32));
+	if(dataSize!=0)
+		{
+		if(uncompress(reinterpret_cast<Bytef*>(&rleBuffer[0]),&rleSize,data,uLong(dataSize))!=Z_OK)
+			Misc::throwStdErr("TimeLapseFile::decodeGrid: Unable to decompress grid");
+		}
+	else
+		rleSize=0;
+	size_t numWords=rleSize/sizeof(Misc::UInt32);
+	
+	/* Un cuadro clave se decodifica respecto de una cuadrícula cero: */
+	if(keyframe)
+		memset(grid,0,numValues*sizeof(float));
+	
+	/* Aplique las series literales a la cuadrícula: */
+	const Misc::UInt32* rPtr=&rleBuffer[0];
+	const Misc::UInt32* rEnd=rPtr+numWords;
+	size_t i=0;
+	while(rPtr+2<=rEnd)
+		{
+		i+=rPtr[0];
+		size_t literalSize=rPtr[1];
+		rPtr+=2;
+		if(i+literalSize>numValues||rPtr+literalSize>rEnd)
+			Misc::throwStdErr("TimeLapseFile::decodeGrid: Corrupted grid data");
+		for(size_t j=0;j<literalSize;++j,++i,++rPtr)
+			{
+			Misc::UInt32 bits;
+			memcpy(&bits,grid+i,sizeof(Misc::UInt32));
+			bits^=*rPtr;
+			memcpy(grid+i,&bits,sizeof(Misc::UInt32));
+			}
+		}
+	}
+
+}
@@ -0,0 +1,68 @@
+/***********************************************************************
+TimeLapseFile - Definiciones compartidas del formato de archivo de las
+grabaciones de lapso de tiempo de la cuadrícula de elevación y de la
+cuadrícula de agua, y funciones para codificar y decodificar cuadrículas
+como diferencias comprimidas respecto del cuadro anterior.
+Copyright (c) 2026 Sergio081096
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#ifndef TIMELAPSEFILE_INCLUDED
+#define TIMELAPSEFILE_INCLUDED
+
+#include <stddef.h>
+#include <vector>
+#include <Misc/SizedTypes.h>
+
+/***********************************************************************
+Disposición del archivo, en el contenedor de ChunkedFile.h y en orden
+little-endian:
+- Encabezado: identificador "SARTLAPS", versión, ancho y alto de la
+  cuadrícula de elevación, ancho y alto de la cuadrícula de agua (cero si
+  no se graba el agua) e intervalo de cuadros clave.
+- Un fragmento por cuadro con dos bloques de datos: la cuadrícula de
+  elevación comprimida y la cuadrícula de agua comprimida, vacía si el
+  cuadro no tiene agua.
+- El índice del contenedor, con el identificador final "SARTLEND".
+Cada cuadrícula se codifica como el XOR de sus bits con los del cuadro
+anterior (o con cero en los cuadros clave), con las series de palabras
+cero codificadas por longitud y el resultado comprimido con deflate.
+***********************************************************************/
+
+namespace TimeLapseFile {
+
+extern const char fileMagic[8]; // Identificador al inicio del archivo
+extern const char trailerMagic[8]; // Identificador al final de un archivo cerrado correctamente
+static const Misc::UInt32 fileVersion=1; // Versión del formato de archivo
+static const size_t headerSize=32; // Tamaño del encabezado del archivo en bytes
+static const unsigned int numChunkBlocks=2; // Número de bloques de datos de un fragmento de cuadro
+static const Misc::UInt32 frameChunkTag=0x4d415246U; // Etiqueta de un fragmento de cuadro ("FRAM")
+
+enum FrameFlags // Enumerado de marcas de un cuadro
+	{
+	KEYFRAME=0x1, // El cuadro se codificó sin referencia al cuadro anterior
+	HAS_WATER=0x2, // El cuadro contiene una cuadrícula de agua
+	WATER_KEYFRAME=0x4 // La cuadrícula de agua se codificó sin referencia a una cuadrícula de agua anterior
+	};
+
+void encodeGrid(const float* grid,const float* previousGrid,size_t numValues,std::vector<Misc::UInt32>& rleBuffer,std::vector<unsigned char>& result); // Codifica una cuadrícula como diferencia con la cuadrícula anterior dada, o como cuadro clave si es nula
+void decodeGrid(const unsigned char* data,size_t dataSize,size_t numValues,bool keyframe,std::vector<Misc::UInt32>& rleBuffer,float* grid); // Decodifica una cuadrícula en el búfer dado, que contiene la cuadrícula anterior si el cuadro no es clave
+
+}
+
+#endif
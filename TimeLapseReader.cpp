@@ -0,0 +1,116 @@
+/***********************************************************************
+TimeLapseReader - Clase para leer cuadros con acceso aleatorio de un
+archivo de lapso de tiempo de cuadrículas de elevación y de agua.
+Copyright (c) 2026 Sergio081096
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include "TimeLapseReader.h"
+
+#include <string.h>
+#include <Misc/ThrowStdErr.h>
+
+#include "TimeLapseFile.h"
+
+/********************************
+Methods of class TimeLapseReader:
+********************************/
+
+void TimeLapseReader::decodeFrame(unsigned int frameIndex)
+	{
+	/* Decodifique la cuadrícula de elevación directamente desde el mapeo: */
+	Misc::UInt32 flags=file.getIndex()[frameIndex].flags;
+	size_t elevationDataSize;
+	const unsigned char* elevationData=file.getBlock(frameIndex,0,elevationDataSize);
+	TimeLapseFile::decodeGrid(elevationData,elevationDataSize,elevation.size(),(flags&TimeLapseFile::KEYFRAME)!=0,rleBuffer,&elevation[0]);
+	
+	/* Decodifique la cuadrícula de agua si el cuadro tiene una; el búfer conserva la última cuadrícula de agua para los cuadros siguientes: */
+	haveWaterLevel=false;
+	if((flags&TimeLapseFile::HAS_WATER)&&!waterLevel.empty())
+		{
+		size_t waterDataSize;
+		const unsigned char* waterData=file.getBlock(frameIndex,1,waterDataSize);
+		TimeLapseFile::decodeGrid(waterData,waterDataSize,waterLevel.size(),(flags&TimeLapseFile::WATER_KEYFRAME)!=0,rleBuffer,&waterLevel[0]);
+		haveWaterLevel=true;
+		}
+	
+	currentFrame=frameIndex;
+	}
+
+TimeLapseReader::TimeLapseReader(const char* fileName)
+	:file(fileName),
+	 haveWaterLevel(false),
+	 currentFrame(0)
+	{
+	/* Lea el encabezado del archivo: */
+	const unsigned char* header=file.getData();
+	if(file.getSize()<TimeLapseFile::headerSize||memcmp(header,TimeLapseFile::fileMagic,8)!=0)
+		Misc::throwStdErr("TimeLapseReader: %s is not a time-lapse file",fileName);
+	Misc::UInt32 version=ChunkedFile::getValue<Misc::UInt32>(header+8);
+	if(version!=TimeLapseFile::fileVersion)
+		Misc::throwStdErr("TimeLapseReader: %s has unsupported version %u",fileName,(unsigned int)version);
+	for(int i=0;i<2;++i)
+		{
+		elevationSize[i]=ChunkedFile::getValue<Misc::UInt32>(header+12+i*sizeof(Misc::UInt32));
+		waterSize[i]=ChunkedFile::getValue<Misc::UInt32>(header+20+i*sizeof(Misc::UInt32));
+		}
+	elevation.resize(size_t(elevationSize[1])*size_t(elevationSize[0]));
+	waterLevel.resize(size_t(waterSize[1])*size_t(waterSize[0]));
+	
+	/* Lea el índice, o recórralo si la grabación no se cerró correctamente: */
+	file.loadIndex(TimeLapseFile::headerSize,TimeLapseFile::trailerMagic,&TimeLapseFile::frameChunkTag,1,TimeLapseFile::numChunkBlocks);
+	if(file.getIndex().empty())
+		Misc::throwStdErr("TimeLapseReader: %s does not contain any frames",fileName);
+	currentFrame=(unsigned int)(file.getIndex().size());
+	}
+
+unsigned int TimeLapseReader::findFrame(double time) const
+	{
+	/* Busque binariamente el último cuadro no posterior al tiempo dado: */
+	const std::vector<ChunkedFile::IndexEntry>& index=file.getIndex();
+	double absTime=index.front().time+time;
+	unsigned int l=0;
+	unsigned int r=(unsigned int)(index.size());
+	while(r-l>1)
+		{
+		unsigned int m=(l+r)>>1;
+		if(index[m].time<=absTime)
+			l=m;
+		else
+			r=m;
+		}
+	
+	return l;
+	}
+
+void TimeLapseReader::readFrame(unsigned int frameIndex)
+	{
+	if(frameIndex==currentFrame)
+		return;
+	
+	/* Retroceda hasta el cuadro clave anterior, o hasta el cuadro siguiente al actual si está más cerca: */
+	const std::vector<ChunkedFile::IndexEntry>& index=file.getIndex();
+	unsigned int startFrame=frameIndex;
+	while(startFrame>0&&!(index[startFrame].flags&TimeLapseFile::KEYFRAME)&&!(currentFrame<frameIndex&&startFrame==currentFrame+1))
+		--startFrame;
+	
+	/* Decodifique los cuadros hacia adelante hasta el cuadro solicitado; invalide el cuadro actual por si falla la decodificación: */
+	currentFrame=(unsigned int)(index.size());
+	for(unsigned int f=startFrame;f<=frameIndex;++f)
+		decodeFrame(f);
+	}
@@ -0,0 +1,84 @@
+/***********************************************************************
+TimeLapseReader - Clase para leer cuadros con acceso aleatorio de un
+archivo de lapso de tiempo de cuadrículas de elevación y de agua.
+Copyright (c) 2026 Sergio081096
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#ifndef TIMELAPSEREADER_INCLUDED
+#define TIMELAPSEREADER_INCLUDED
+
+#include <vector>
+#include <Misc/SizedTypes.h>
+
+#include "ChunkedFile.h"
+
+class TimeLapseReader
+	{
+	/* Elementos: */
+	private:
+	ChunkedFile::Reader file; // Mapeo de memoria del archivo de lapso de tiempo con el índice de todos los cuadros
+	unsigned int elevationSize[2]; // Ancho y alto de la cuadrícula de elevación
+	unsigned int waterSize[2]; // Ancho y alto de la cuadrícula de agua; cero si no se grabó el agua
+	std::vector<float> elevation; // Cuadrícula de elevación del cuadro decodificado actual
+	std::vector<float> waterLevel; // Cuadrícula de agua del cuadro decodificado actual
+	bool haveWaterLevel; // Marcar si el cuadro decodificado actual tiene una cuadrícula de agua
+	unsigned int currentFrame; // Índice del cuadro decodificado actual, o el número de cuadros si no hay ninguno
+	std::vector<Misc::UInt32> rleBuffer; // Búfer para decodificar las diferencias entre cuadros
+	
+	/* Métodos privados: */
+	void decodeFrame(unsigned int frameIndex); // Decodifica el cuadro dado sobre el cuadro decodificado actual
+	
+	/* Constructores y destructores: */
+	public:
+	TimeLapseReader(const char* fileName); // Mapea en memoria el archivo de lapso de tiempo dado
+	private:
+	TimeLapseReader(const TimeLapseReader& source); // Prohibir copia constructor
+	TimeLapseReader& operator=(const TimeLapseReader& source); // Prohibir operador de asignación
+	
+	/* Métodos: */
+	public:
+	const unsigned int* getElevationSize(void) const // Devuelve el tamaño de la cuadrícula de elevación
+		{
+		return elevationSize;
+		}
+	const unsigned int* getWaterSize(void) const // Devuelve el tamaño de la cuadrícula de agua
+		{
+		return waterSize;
+		}
+	unsigned int getNumFrames(void) const // Devuelve el número de cuadros del archivo
+		{
+		return (unsigned int)(file.getIndex().size());
+		}
+	double getFrameTime(unsigned int frameIndex) const // Devuelve la marca de tiempo del cuadro dado relativa al primer cuadro
+		{
+		return file.getIndex()[frameIndex].time-file.getIndex().front().time;
+		}
+	unsigned int findFrame(double time) const; // Devuelve el índice del último cuadro con marca de tiempo relativa no posterior al tiempo dado
+	void readFrame(unsigned int frameIndex); // Decodifica el cuadro dado, a partir del cuadro clave anterior si es necesario
+	const float* getElevation(void) const // Devuelve la cuadrícula de elevación del cuadro decodificado
+		{
+		return &elevation[0];
+		}
+	const float* getWaterLevel(void) const // Devuelve la cuadrícula de agua del cuadro decodificado, o nulo si no tiene
+		{
+		return haveWaterLevel?&waterLevel[0]:0;
+		}
+	};
+
+#endif
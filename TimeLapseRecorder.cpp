@@ -0,0 +1,227 @@
+/***********************************************************************
+TimeLapseRecorder - Clase para grabar en un hilo de fondo la cuadrícula
+de elevación filtrada y la cuadrícula de agua en un archivo de lapso de
+tiempo de solo anexado, como diferencias comprimidas con un índice para
+el acceso aleatorio.
+Copyright (c) 2026 Sergio081096
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include "TimeLapseRecorder.h"
+
+#include <string.h>
+#include <stdexcept>
+
+#include "TimeLapseFile.h"
+
+/**********************************
+Methods of class TimeLapseRecorder:
+**********************************/
+
+void TimeLapseRecorder::writeFrame(const TimeLapseRecorder::Frame& frame)
+	{
+	/* Codifique un cuadro clave en intervalos regulares, o diferencias con el cuadro anterior: */
+	bool keyframe=file.getNumChunks()%keyframeInterval==0;
+	size_t numElevations=size_t(elevationSize[1])*size_t(elevationSize[0]);
+	TimeLapseFile::encodeGrid(frame.elevation,keyframe?0:&previousElevation[0],numElevations,rleBuffer,elevationData);
+	memcpy(&previousElevation[0],frame.elevation,numElevations*sizeof(float));
+	Misc::UInt32 flags=keyframe?TimeLapseFile::KEYFRAME:0U;
+	waterData.clear();
+	if(keyframe)
+		havePreviousWaterLevel=false;
+	if(frame.waterLevel!=0)
+		{
+		/* La cuadrícula de agua es clave si no hay una cuadrícula de agua anterior desde el último cuadro clave: */
+		size_t numWaterLevels=size_t(waterSize[1])*size_t(waterSize[0]);
+		TimeLapseFile::encodeGrid(frame.waterLevel,havePreviousWaterLevel?&previousWaterLevel[0]:0,numWaterLevels,rleBuffer,waterData);
+		memcpy(&previousWaterLevel[0],frame.waterLevel,numWaterLevels*sizeof(float));
+		flags|=TimeLapseFile::HAS_WATER;
+		if(!havePreviousWaterLevel)
+			flags|=TimeLapseFile::WATER_KEYFRAME;
+		havePreviousWaterLevel=true;
+		}
+	
+	/* Escribe el fragmento del cuadro y agréguelo al índice: */
+	const std::vector<unsigned char>* blocks[TimeLapseFile::numChunkBlocks]={&elevationData,&waterData};
+	file.writeChunk(TimeLapseFile::frameChunkTag,flags,frame.time,TimeLapseFile::numChunkBlocks,blocks);
+	}
+
+void* TimeLapseRecorder::writerThreadMethod(void)
+	{
+	bool ok=true;
+	while(true)
+		{
+		/* Espere hasta que haya un cuadro en espera o el programa se apague con la cola vacía: */
+		Frame frame;
+		{
+		Threads::MutexCond::Lock frameLock(frameCond);
+		while(runWriterThread&&frames.empty())
+			frameCond.wait(frameLock);
+		if(frames.empty())
+			break;
+		frame=frames.front();
+		frames.pop_front();
+		}
+		
+		/* Escribe el cuadro a menos que una escritura anterior haya fallado: */
+		if(ok)
+			{
+			try
+				{
+				writeFrame(frame);
+				}
+			catch(const std::runtime_error& err)
+				{
+				/* Deje de escribir y guarde el error para el hilo principal: */
+				Threads::MutexCond::Lock frameLock(frameCond);
+				error=err.what();
+				ok=false;
+				}
+			}
+		
+		/* Devuelva las copias del cuadro para su reutilización: */
+		{
+		Threads::MutexCond::Lock frameLock(frameCond);
+		freeFrames.push_back(frame);
+		}
+		}
+	
+	if(ok)
+		{
+		try
+			{
+			/* Cierre el archivo con su índice: */
+			file.close();
+			}
+		catch(const std::runtime_error& err)
+			{
+			Threads::MutexCond::Lock frameLock(frameCond);
+			error=err.what();
+			}
+		}
+	
+	return 0;
+	}
+
+TimeLapseRecorder::TimeLapseRecorder(const char* fileName,const unsigned int sElevationSize[2],const unsigned int sWaterSize[2],unsigned int sKeyframeInterval)
+	:keyframeInterval(sKeyframeInterval>0?sKeyframeInterval:1),
+	 maxQueuedFrames(4),
+	 file(fileName,TimeLapseFile::trailerMagic),
+	 havePreviousWaterLevel(false),
+	 numDroppedFrames(0),
+	 runWriterThread(false)
+	{
+	/* Copie los tamaños de las cuadrículas: */
+	for(int i=0;i<2;++i)
+		{
+		elevationSize[i]=sElevationSize[i];
+		waterSize[i]=sWaterSize!=0?sWaterSize[i]:0U;
+		}
+	previousElevation.resize(size_t(elevationSize[1])*size_t(elevationSize[0]));
+	previousWaterLevel.resize(size_t(waterSize[1])*size_t(waterSize[0]));
+	
+	/* Escribe el encabezado del archivo: */
+	IO::File& header=file.getFile();
+	header.write<char>(TimeLapseFile::fileMagic,8);
+	header.write<Misc::UInt32>(TimeLapseFile::fileVersion);
+	header.write<Misc::UInt32>(elevationSize,2);
+	header.write<Misc::UInt32>(waterSize,2);
+	header.write<Misc::UInt32>(keyframeInterval);
+	file.startChunks(TimeLapseFile::headerSize);
+	
+	/* Inicie el hilo de escritura: */
+	runWriterThread=true;
+	writerThread.start(this,&TimeLapseRecorder::writerThreadMethod);
+	}
+
+TimeLapseRecorder::~TimeLapseRecorder(void)
+	{
+	/* Apague el hilo de escritura después de que escriba los cuadros en espera y el índice: */
+	{
+	Threads::MutexCond::Lock frameLock(frameCond);
+	runWriterThread=false;
+	frameCond.signal();
+	}
+	writerThread.join();
+	
+	/* Libere todas las copias de cuadros: */
+	for(std::vector<Frame>::iterator fIt=freeFrames.begin();fIt!=freeFrames.end();++fIt)
+		{
+		delete[] fIt->elevation;
+		delete[] fIt->waterLevel;
+		}
+	}
+
+bool TimeLapseRecorder::addFrame(double time,const float* elevation,const float* waterLevel)
+	{
+	/* Tome un cuadro libre, o descarte el nuevo cuadro si la cola está llena para no bloquear nunca el hilo principal: */
+	Frame frame;
+	{
+	Threads::MutexCond::Lock frameLock(frameCond);
+	if(frames.size()>=maxQueuedFrames)
+		{
+		++numDroppedFrames;
+		return false;
+		}
+	if(!freeFrames.empty())
+		{
+		frame=freeFrames.back();
+		freeFrames.pop_back();
+		}
+	}
+	
+	/* Copie las cuadrículas, ya que los búferes de origen se reutilizan: */
+	size_t numElevations=size_t(elevationSize[1])*size_t(elevationSize[0]);
+	if(frame.elevation==0)
+		frame.elevation=new float[numElevations];
+	memcpy(frame.elevation,elevation,numElevations*sizeof(float));
+	if(hasWater()&&waterLevel!=0)
+		{
+		size_t numWaterLevels=size_t(waterSize[1])*size_t(waterSize[0]);
+		if(frame.waterLevel==0)
+			frame.waterLevel=new float[numWaterLevels];
+		memcpy(frame.waterLevel,waterLevel,numWaterLevels*sizeof(float));
+		}
+	else
+		{
+		delete[] frame.waterLevel;
+		frame.waterLevel=0;
+		}
+	frame.time=time;
+	
+	/* Agregue el cuadro a la cola y despierte el hilo de escritura: */
+	{
+	Threads::MutexCond::Lock frameLock(frameCond);
+	frames.push_back(frame);
+	frameCond.signal();
+	}
+	
+	return true;
+	}
+
+size_t TimeLapseRecorder::getNumDroppedFrames(void)
+	{
+	Threads::MutexCond::Lock frameLock(frameCond);
+	return numDroppedFrames;
+	}
+
+std::string TimeLapseRecorder::getError(void)
+	{
+	Threads::MutexCond::Lock frameLock(frameCond);
+	return error;
+	}
@@ -0,0 +1,103 @@
+/***********************************************************************
+TimeLapseRecorder - Clase para grabar en un hilo de fondo la cuadrícula
+de elevación filtrada y la cuadrícula de agua en un archivo de lapso de
+tiempo de solo anexado, como diferencias comprimidas con un índice para
+el acceso aleatorio.
+Copyright (c) 2026 Sergio081096
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#ifndef TIMELAPSERECORDER_INCLUDED
+#define TIMELAPSERECORDER_INCLUDED
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <Misc/SizedTypes.h>
+#include <Threads/MutexCond.h>
+#include <Threads/Thread.h>
+
+#include "ChunkedFile.h"
+
+class TimeLapseRecorder
+	{
+	/* Clases integradas: */
+	private:
+	struct Frame // Estructura para un cuadro en espera de ser escrito
+		{
+		/* Elementos: */
+		public:
+		double time; // Marca de tiempo del cuadro en segundos
+		float* elevation; // Copia de la cuadrícula de elevación
+		float* waterLevel; // Copia de la cuadrícula de agua, o nulo
+		
+		/* Constructores y destructores: */
+		Frame(void)
+			:time(0.0),elevation(0),waterLevel(0)
+			{
+			}
+		};
+	
+	/* Elementos: */
+	unsigned int elevationSize[2]; // Ancho y alto de la cuadrícula de elevación
+	unsigned int waterSize[2]; // Ancho y alto de la cuadrícula de agua; cero si no se graba el agua
+	unsigned int keyframeInterval; // Número de cuadros entre cuadros clave
+	size_t maxQueuedFrames; // Número máximo de cuadros en espera antes de descartar cuadros nuevos
+	
+	/* Estado del hilo de escritura: */
+	ChunkedFile::Writer file; // El archivo de lapso de tiempo con el índice de todos los cuadros escritos
+	std::vector<float> previousElevation; // Cuadrícula de elevación del cuadro escrito anterior
+	std::vector<float> previousWaterLevel; // Cuadrícula de agua del cuadro escrito anterior
+	bool havePreviousWaterLevel; // Marcar si se escribió una cuadrícula de agua desde el último cuadro clave
+	std::vector<Misc::UInt32> rleBuffer; // Búfer para codificar las diferencias entre cuadros
+	std::vector<unsigned char> elevationData; // Datos comprimidos de la cuadrícula de elevación
+	std::vector<unsigned char> waterData; // Datos comprimidos de la cuadrícula de agua
+	
+	/* Estado compartido entre los hilos: */
+	Threads::MutexCond frameCond; // Variable de condición para señalar la llegada de un nuevo cuadro
+	std::deque<Frame> frames; // Cola de cuadros en espera de ser escritos
+	std::vector<Frame> freeFrames; // Cuadros ya escritos, listos para reutilizarse
+	size_t numDroppedFrames; // Número de cuadros descartados porque la cola estaba llena
+	std::string error; // Mensaje de error si la escritura falló
+	volatile bool runWriterThread; // Marcar para mantener en ejecución el hilo de escritura
+	Threads::Thread writerThread; // El hilo de escritura
+	
+	/* Métodos privados: */
+	void writeFrame(const Frame& frame); // Codifica y escribe un cuadro en el archivo
+	void* writerThreadMethod(void); // Método para el hilo de escritura
+	
+	/* Constructores y destructores: */
+	public:
+	TimeLapseRecorder(const char* fileName,const unsigned int sElevationSize[2],const unsigned int sWaterSize[2],unsigned int sKeyframeInterval); // Crea un archivo de lapso de tiempo para cuadrículas de los tamaños dados; un tamaño de agua nulo desactiva la grabación del agua
+	private:
+	TimeLapseRecorder(const TimeLapseRecorder& source); // Prohibir copia constructor
+	TimeLapseRecorder& operator=(const TimeLapseRecorder& source); // Prohibir operador de asignación
+	public:
+	~TimeLapseRecorder(void); // Escribe los cuadros en espera y el índice, y cierra el archivo
+	
+	/* Métodos: */
+	bool hasWater(void) const // Devuelve verdadero si se graba la cuadrícula de agua
+		{
+		return waterSize[0]!=0&&waterSize[1]!=0;
+		}
+	bool addFrame(double time,const float* elevation,const float* waterLevel); // Copia las cuadrículas dadas en la cola de escritura; devuelve falso si el cuadro se descartó porque la cola estaba llena
+	size_t getNumDroppedFrames(void); // Devuelve el número de cuadros descartados hasta ahora
+	std::string getError(void); // Devuelve el mensaje de error si la escritura falló, o una cadena vacía
+	};
+
+#endif
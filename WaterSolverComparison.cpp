@@ -0,0 +1,597 @@
+/***********************************************************************
+WaterSolverComparison - Utilidad que compara en la CPU el esquema
+semi-implícito de la capa freática con el esquema Runge-Kutta
+explícito en tiempo de cálculo, conservación de masa y precisión. Los
+pasos son traducciones directas de los sombreadores Water2*.fs.
+Copyright (c) 2026 Sergio081096
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include <iostream>
+#include <iomanip>
+#include <Misc/Timer.h>
+
+namespace {
+
+/**************
+Helper classes:
+**************/
+
+struct Quantity // Estructura para las cantidades conservadas de una celda (w, hu, hv)
+	{
+	/* Elementos: */
+	public:
+	float c[3];
+	
+	/* Constructores y destructores: */
+	Quantity(void)
+		{
+		c[0]=c[1]=c[2]=0.0f;
+		}
+	Quantity(float c0,float c1,float c2)
+		{
+		c[0]=c0;
+		c[1]=c1;
+		c[2]=c2;
+		}
+	
+	/* Métodos: */
+	Quantity operator+(const Quantity& other) const
+		{
+		return Quantity(c[0]+other.c[0],c[1]+other.c[1],c[2]+other.c[2]);
+		}
+	Quantity operator-(const Quantity& other) const
+		{
+		return Quantity(c[0]-other.c[0],c[1]-other.c[1],c[2]-other.c[2]);
+		}
+	Quantity operator*(float s) const
+		{
+		return Quantity(c[0]*s,c[1]*s,c[2]*s);
+		}
+	};
+
+struct Face // Estructura para las descargas explícitas y profundidades de flujo de las caras este y norte de una celda
+	{
+	/* Elementos: */
+	public:
+	float qe,qn; // Descargas explícitas
+	float he,hn; // Profundidades de flujo
+	};
+
+struct Discharge // Estructura para las nuevas descargas de las caras este y norte y el factor de limitación de una celda
+	{
+	/* Elementos: */
+	public:
+	float qe,qn;
+	float limit;
+	};
+
+class Simulator // Clase para una traducción a la CPU de los pasos de integración de WaterTable2
+	{
+	/* Elementos: */
+	public:
+	int size[2]; // Ancho y alto de la cuadrícula de cantidades centrada en las celdas
+	float cellSize[2]; // Ancho y alto de las celdas
+	float theta,g,epsilon,attenuation,friction,dryDepth,maxStepSize; // Parámetros de simulación con los mismos valores por defecto que WaterTable2
+	unsigned int semiImplicitIterations; // Número de iteraciones de Jacobi por paso semi-implícito
+	std::vector<float> bathymetry; // Cuadrícula de batimetría centrada en los vértices de (size[0]-1)x(size[1]-1)
+	std::vector<Quantity> quantity; // Cuadrícula de cantidades conservadas actual
+	
+	/* Búferes intermedios: */
+	std::vector<Quantity> derivative,quantityStar;
+	std::vector<Face> faces;
+	std::vector<float> levels[2];
+	std::vector<Discharge> discharges;
+	
+	/* Constructores y destructores: */
+	Simulator(int width,int height,float sCellSize)
+		:theta(1.3f),g(9.81f),
+		 attenuation(127.0f/128.0f),friction(0.001f),
+		 maxStepSize(1.0f),semiImplicitIterations(16),
+		 bathymetry((width-1)*(height-1),0.0f),
+		 quantity(width*height),
+		 derivative(width*height),quantityStar(width*height),
+		 faces(width*height),discharges(width*height)
+		{
+		size[0]=width;
+		size[1]=height;
+		cellSize[0]=cellSize[1]=sCellSize;
+		epsilon=0.01f*fmaxf(sCellSize,1.0f);
+		dryDepth=0.001f*sCellSize;
+		for(int i=0;i<2;++i)
+			levels[i].resize(width*height);
+		}
+	
+	/* Métodos de acceso con la semántica de bordes de las texturas: */
+	static int clampInt(int value,int max) // Devuelve el índice dado limitado al rango [0, max], como el muestreo de texturas con GL_CLAMP
+		{
+		return value<0?0:value>max?max:value;
+		}
+	float b(int x,int y) const
+		{
+		return bathymetry[clampInt(y,size[1]-2)*(size[0]-1)+clampInt(x,size[0]-2)];
+		}
+	float cellB(int x,int y) const
+		{
+		return (b(x-1,y-1)+b(x,y-1)+b(x-1,y)+b(x,y))*0.25f;
+		}
+	template <class ValueParam>
+	const ValueParam& at(const std::vector<ValueParam>& grid,int x,int y) const
+		{
+		return grid[clampInt(y,size[1]-1)*size[0]+clampInt(x,size[0]-1)];
+		}
+	
+	/* Traducción de Water2SlopeAndFluxAndDerivativeShader.fs: */
+	Quantity calcSlope(const Quantity& q0,const Quantity& q1,const Quantity& q2,float cs,float b0,float b1) const
+		{
+		Quantity slope;
+		for(int i=0;i<3;++i)
+			{
+			float d01=(q1.c[i]-q0.c[i])*(theta/cs);
+			float d02=(q2.c[i]-q0.c[i])/(2.0f*cs);
+			float d12=(q2.c[i]-q1.c[i])*(theta/cs);
+			float dMin=fminf(fminf(d01,d02),d12);
+			float dMax=fmaxf(fmaxf(d01,d02),d12);
+			slope.c[i]=dMin>0.0f?dMin:dMax<0.0f?dMax:0.0f;
+			}
+		if(q1.c[0]-slope.c[0]*cs*0.5f<b0)
+			slope.c[0]=(q1.c[0]-b0)/(cs*0.5f);
+		if(q1.c[0]+slope.c[0]*cs*0.5f<b1)
+			slope.c[0]=(b1-q1.c[0])/(cs*0.5f);
+		return slope;
+		}
+	void calcUv(Quantity& q,float h,float uv[2]) const
+		{
+		float h4=h*h*h*h;
+		float f=1.41421356237309f*h/sqrtf(h4+fmaxf(h4,epsilon));
+		uv[0]=q.c[1]*f;
+		uv[1]=q.c[2]*f;
+		q.c[1]=uv[0]*h;
+		q.c[2]=uv[1]*h;
+		}
+	float calcPartialFluxX(Quantity qe,Quantity qw,float bew,Quantity& fluxX) const
+		{
+		float he=fmaxf(qe.c[0]-bew,0.0f);
+		float hw=fmaxf(qw.c[0]-bew,0.0f);
+		float uve[2],uvw[2];
+		calcUv(qe,he,uve);
+		calcUv(qw,hw,uvw);
+		Quantity fe(qe.c[1],uve[0]*qe.c[1]+0.5f*g*he*he,uve[1]*qe.c[1]);
+		Quantity fw(qw.c[1],uvw[0]*qw.c[1]+0.5f*g*hw*hw,uvw[1]*qw.c[1]);
+		float sghe=sqrtf(g*he);
+		float sghw=sqrtf(g*hw);
+		float ae=fminf(fminf(uve[0]-sghe,uvw[0]-sghw),0.0f);
+		float aw=fmaxf(fmaxf(uve[0]+sghe,uvw[0]+sghw),0.0f);
+		fluxX=aw-ae!=0.0f?((fe*aw-fw*ae)+(qw-qe)*(aw*ae))*(1.0f/(aw-ae)):Quantity();
+		return 0.5f*cellSize[0]/fabsf(fmaxf(-ae,aw)); // fabsf evita dividir por -0.0 en caras secas, donde -ae es -0.0
+		}
+	float calcPartialFluxY(Quantity qn,Quantity qs,float bns,Quantity& fluxY) const
+		{
+		float hn=fmaxf(qn.c[0]-bns,0.0f);
+		float hs=fmaxf(qs.c[0]-bns,0.0f);
+		float uvn[2],uvs[2];
+		calcUv(qn,hn,uvn);
+		calcUv(qs,hs,uvs);
+		Quantity fn(qn.c[2],uvn[0]*qn.c[2],uvn[1]*qn.c[2]+0.5f*g*hn*hn);
+		Quantity fs(qs.c[2],uvs[0]*qs.c[2],uvs[1]*qs.c[2]+0.5f*g*hs*hs);
+		float sghn=sqrtf(g*hn);
+		float sghs=sqrtf(g*hs);
+		float an=fminf(fminf(uvn[1]-sghn,uvs[1]-sghs),0.0f);
+		float as=fmaxf(fmaxf(uvn[1]+sghn,uvs[1]+sghs),0.0f);
+		fluxY=as-an!=0.0f?((fn*as-fs*an)+(qs-qn)*(as*an))*(1.0f/(as-an)):Quantity();
+		return 0.5f*cellSize[1]/fabsf(fmaxf(-an,as));
+		}
+	float calcDerivative(const std::vector<Quantity>& q,std::vector<Quantity>& qt) const // Calcula la derivada temporal y devuelve el tamaño de paso máximo
+		{
+		float stepSize=maxStepSize;
+		for(int y=0;y<size[1];++y)
+			for(int x=0;x<size[0];++x)
+				{
+				float b00=b(x-1,y-1);
+				float b10=b(x,y-1);
+				float b01=b(x-1,y);
+				float b11=b(x,y);
+				float b0=(b(x-1,y-2)+b(x,y-2))*0.5f;
+				float b1=(b00+b10)*0.5f;
+				float b2=(b(x-2,y-1)+b(x-2,y))*0.5f;
+				float b3=(b00+b01)*0.5f;
+				float b4=(b10+b11)*0.5f;
+				float b5=(b(x+1,y-1)+b(x+1,y))*0.5f;
+				float b6=(b01+b11)*0.5f;
+				float b7=(b(x-1,y+1)+b(x,y+1))*0.5f;
+				
+				const Quantity& q1=at(q,x,y-1);
+				const Quantity& q3=at(q,x-1,y);
+				const Quantity& q4=at(q,x,y);
+				const Quantity& q5=at(q,x+1,y);
+				const Quantity& q7=at(q,x,y+1);
+				
+				Quantity q1n=q1+calcSlope(at(q,x,y-2),q1,q4,cellSize[1],b0,b1)*(cellSize[1]*0.5f);
+				Quantity q3e=q3+calcSlope(at(q,x-2,y),q3,q4,cellSize[0],b2,b3)*(cellSize[0]*0.5f);
+				Quantity q4x=calcSlope(q3,q4,q5,cellSize[0],b3,b4)*(cellSize[0]*0.5f);
+				Quantity q4w=q4-q4x;
+				Quantity q4e=q4+q4x;
+				Quantity q4y=calcSlope(q1,q4,q7,cellSize[1],b1,b6)*(cellSize[1]*0.5f);
+				Quantity q4s=q4-q4y;
+				Quantity q4n=q4+q4y;
+				Quantity q5w=q5-calcSlope(q4,q5,at(q,x+2,y),cellSize[0],b4,b5)*(cellSize[0]*0.5f);
+				Quantity q7s=q7-calcSlope(q4,q7,at(q,x,y+2),cellSize[1],b6,b7)*(cellSize[1]*0.5f);
+				
+				Quantity fluxXw,fluxXe,fluxYs,fluxYn;
+				float cellStepSize=fminf(fminf(calcPartialFluxX(q3e,q4w,b3,fluxXw),
+				                              calcPartialFluxX(q4e,q5w,b4,fluxXe)),
+				                        fminf(calcPartialFluxY(q1n,q4s,b1,fluxYs),
+				                              calcPartialFluxY(q4n,q7s,b6,fluxYn)));
+				stepSize=fminf(stepSize,cellStepSize);
+				
+				float h=fmaxf(q4.c[0]-(b3+b4)*0.5f,0.0f);
+				Quantity source(0.0f,-g*h*(b4-b3)/cellSize[0],-g*h*(b6-b1)/cellSize[1]);
+				qt[y*size[0]+x]=source-(fluxXe-fluxXw)*(1.0f/cellSize[0])-(fluxYn-fluxYs)*(1.0f/cellSize[1]);
+				}
+		return stepSize;
+		}
+	
+	/* Traducción de Water2WaveSpeedShader.fs: */
+	float calcWaveSpeedStepSize(void) const
+		{
+		float stepSize=maxStepSize;
+		for(int y=0;y<size[1];++y)
+			for(int x=0;x<size[0];++x)
+				{
+				const Quantity& q=quantity[y*size[0]+x];
+				float h=fmaxf(q.c[0]-cellB(x,y),0.0f);
+				float h4=h*h*h*h;
+				float f=1.41421356237309f*h/sqrtf(h4+fmaxf(h4,epsilon));
+				float sgh=sqrtf(g*h);
+				float sx=cellSize[0]*0.5f/(fabsf(q.c[1])*f+sgh);
+				float sy=cellSize[1]*0.5f/(fabsf(q.c[2])*f+sgh);
+				stepSize=fminf(stepSize,fminf(sx,sy));
+				}
+		return stepSize;
+		}
+	
+	/* Traducción de Water2BoundaryShader.fs: */
+	void applyDryBoundary(void)
+		{
+		for(int y=0;y<size[1];++y)
+			for(int x=0;x<size[0];++x)
+				if(x==0||x==size[0]-1||y==0||y==size[1]-1)
+					quantity[y*size[0]+x]=Quantity(cellB(x,y),0.0f,0.0f);
+		}
+	
+	/* Traducción de WaterTable2::rungeKuttaStep: */
+	float rungeKuttaStep(float stepFactor,float maxStep)
+		{
+		float stepSize=fminf(calcDerivative(quantity,derivative)*stepFactor,maxStep);
+		float att=powf(attenuation,stepSize);
+		for(size_t i=0;i<quantity.size();++i)
+			{
+			quantityStar[i]=quantity[i]+derivative[i]*stepSize;
+			quantityStar[i].c[1]*=att;
+			quantityStar[i].c[2]*=att;
+			}
+		calcDerivative(quantityStar,derivative);
+		for(size_t i=0;i<quantity.size();++i)
+			{
+			quantity[i]=(quantity[i]+quantityStar[i]+derivative[i]*stepSize)*0.5f;
+			quantity[i].c[1]*=att;
+			quantity[i].c[2]*=att;
+			}
+		applyDryBoundary();
+		return stepSize;
+		}
+	
+	/* Traducción de WaterTable2::semiImplicitStep y de los sombreadores Water2SemiImplicit*.fs: */
+	void calcFace(float q,float h,float stepSize,float& qOut,float& hOut) const
+		{
+		if(h<=dryDepth)
+			{
+			qOut=hOut=0.0f;
+			return;
+			}
+		float f=1.0f+g*stepSize*friction*fabsf(q)/powf(h,7.0f/3.0f);
+		qOut=q/f;
+		hOut=h/f;
+		}
+	float semiImplicitStep(float stepSize)
+		{
+		/* Descargas explícitas y profundidades de flujo de las caras: */
+		float att=powf(attenuation,stepSize);
+		for(int y=0;y<size[1];++y)
+			for(int x=0;x<size[0];++x)
+				{
+				const Quantity& q=at(quantity,x,y);
+				float we=at(quantity,x+1,y).c[0];
+				float wn=at(quantity,x,y+1).c[0];
+				float bc=cellB(x,y);
+				float be=cellB(x+1,y);
+				float bn=cellB(x,y+1);
+				float he=x<size[0]-1?fmaxf(q.c[0],we)-fmaxf(bc,be):0.0f;
+				float hn=y<size[1]-1?fmaxf(q.c[0],wn)-fmaxf(bc,bn):0.0f;
+				Face& f=faces[y*size[0]+x];
+				calcFace(q.c[1]*att,he,stepSize,f.qe,f.he);
+				calcFace(q.c[2]*att,hn,stepSize,f.qn,f.hn);
+				}
+		
+		/* Iteraciones de Jacobi amortiguadas: */
+		float cx=g*stepSize*stepSize/(cellSize[0]*cellSize[0]);
+		float cy=g*stepSize*stepSize/(cellSize[1]*cellSize[1]);
+		for(size_t i=0;i<quantity.size();++i)
+			levels[0][i]=quantity[i].c[0];
+		int currentLevel=0;
+		for(unsigned int iteration=0;iteration<semiImplicitIterations;++iteration)
+			{
+			const std::vector<float>& l=levels[currentLevel];
+			std::vector<float>& newL=levels[1-currentLevel];
+			for(int y=0;y<size[1];++y)
+				for(int x=0;x<size[0];++x)
+					{
+					const Face& fc=faces[y*size[0]+x];
+					float fwq=0.0f,fwh=0.0f,fsq=0.0f,fsh=0.0f;
+					if(x>0)
+						{
+						fwq=faces[y*size[0]+x-1].qe;
+						fwh=faces[y*size[0]+x-1].he;
+						}
+					if(y>0)
+						{
+						fsq=faces[(y-1)*size[0]+x].qn;
+						fsh=faces[(y-1)*size[0]+x].hn;
+						}
+					float rhs=quantity[y*size[0]+x].c[0]-stepSize*((fc.qe-fwq)/cellSize[0]+(fc.qn-fsq)/cellSize[1]);
+					float ce=cx*fc.he;
+					float cw=cx*fwh;
+					float cn=cy*fc.hn;
+					float cs=cy*fsh;
+					float lc=at(l,x,y);
+					float off=ce*at(l,x+1,y)+cw*at(l,x-1,y)+cn*at(l,x,y+1)+cs*at(l,x,y-1);
+					newL[y*size[0]+x]=lc+((rhs+off)/(1.0f+ce+cw+cn+cs)-lc)*(2.0f/3.0f);
+					}
+			currentLevel=1-currentLevel;
+			}
+		const std::vector<float>& l=levels[currentLevel];
+		
+		/* Nuevas descargas y factores de limitación: */
+		float gdx=g*stepSize/cellSize[0];
+		float gdy=g*stepSize/cellSize[1];
+		for(int y=0;y<size[1];++y)
+			for(int x=0;x<size[0];++x)
+				{
+				const Face& fc=faces[y*size[0]+x];
+				float fwq=0.0f,fwh=0.0f,fsq=0.0f,fsh=0.0f;
+				if(x>0)
+					{
+					fwq=faces[y*size[0]+x-1].qe;
+					fwh=faces[y*size[0]+x-1].he;
+					}
+				if(y>0)
+					{
+					fsq=faces[(y-1)*size[0]+x].qn;
+					fsh=faces[(y-1)*size[0]+x].hn;
+					}
+				float lc=at(l,x,y);
+				float qe=fc.qe-gdx*fc.he*(at(l,x+1,y)-lc);
+				float qw=fwq-gdx*fwh*(lc-at(l,x-1,y));
+				float qn=fc.qn-gdy*fc.hn*(at(l,x,y+1)-lc);
+				float qs=fsq-gdy*fsh*(lc-at(l,x,y-1));
+				float outflow=stepSize*((fmaxf(qe,0.0f)-fminf(qw,0.0f))/cellSize[0]+(fmaxf(qn,0.0f)-fminf(qs,0.0f))/cellSize[1]);
+				float h=fmaxf(quantity[y*size[0]+x].c[0]-cellB(x,y),0.0f);
+				Discharge& d=discharges[y*size[0]+x];
+				d.qe=qe;
+				d.qn=qn;
+				d.limit=outflow>h?h/outflow:1.0f;
+				}
+		
+		/* Actualización conservativa: */
+		for(int y=0;y<size[1];++y)
+			for(int x=0;x<size[0];++x)
+				{
+				const Discharge& dc=discharges[y*size[0]+x];
+				float le=at(discharges,x+1,y).limit;
+				float ln=at(discharges,x,y+1).limit;
+				Discharge dw={0.0f,0.0f,0.0f};
+				Discharge ds={0.0f,0.0f,0.0f};
+				if(x>0)
+					dw=discharges[y*size[0]+x-1];
+				if(y>0)
+					ds=discharges[(y-1)*size[0]+x];
+				float qe=dc.qe*(dc.qe>0.0f?dc.limit:le);
+				float qn=dc.qn*(dc.qn>0.0f?dc.limit:ln);
+				float qw=dw.qe*(dw.qe>0.0f?dw.limit:dc.limit);
+				float qs=ds.qn*(ds.qn>0.0f?ds.limit:dc.limit);
+				float w=quantity[y*size[0]+x].c[0]-stepSize*((qe-qw)/cellSize[0]+(qn-qs)/cellSize[1]);
+				quantityStar[y*size[0]+x]=Quantity(fmaxf(w,cellB(x,y)),qe,qn);
+				}
+		quantity.swap(quantityStar);
+		applyDryBoundary();
+		return stepSize;
+		}
+	
+	/* Métodos de evaluación: */
+	double volume(void) const // Devuelve el volumen de agua de las celdas interiores
+		{
+		double result=0.0;
+		for(int y=1;y<size[1]-1;++y)
+			for(int x=1;x<size[0]-1;++x)
+				result+=double(fmaxf(quantity[y*size[0]+x].c[0]-cellB(x,y),0.0f));
+		return result*double(cellSize[0])*double(cellSize[1]);
+		}
+	};
+
+/****************
+Helper functions:
+****************/
+
+void initScene(Simulator& sim) // Crea una cuenca con una isla y un dique de agua retenida en su tercio izquierdo
+	{
+	float cx=float(sim.size[0]-1)*sim.cellSize[0]*0.5f;
+	float cy=float(sim.size[1]-1)*sim.cellSize[1]*0.5f;
+	for(int y=0;y<sim.size[1]-1;++y)
+		for(int x=0;x<sim.size[0]-1;++x)
+			{
+			float px=(float(x)+1.0f)*sim.cellSize[0]-cx;
+			float py=(float(y)+1.0f)*sim.cellSize[1]-cy;
+			float r2=px*px+py*py;
+			float ix=px-0.3f*cx,iy=py+0.2f*cy;
+			sim.bathymetry[y*(sim.size[0]-1)+x]=-10.0f+24.0f*r2/(cx*cx+cy*cy)+8.0f*expf(-(ix*ix+iy*iy)/(0.02f*cx*cx));
+			}
+	for(int y=0;y<sim.size[1];++y)
+		for(int x=0;x<sim.size[0];++x)
+			{
+			float b=sim.cellB(x,y);
+			float level=x<sim.size[0]/3?-2.0f:-6.0f;
+			sim.quantity[y*sim.size[0]+x]=Quantity(fmaxf(level,b),0.0f,0.0f);
+			}
+	sim.applyDryBoundary();
+	}
+
+struct Result // Estructura para el resultado de una ejecución
+	{
+	/* Elementos: */
+	public:
+	unsigned int numSteps;
+	double time; // Tiempo de cálculo en segundos
+	double stepSizeTime; // Tiempo de cálculo del dimensionamiento de los pasos en segundos
+	double massError; // Error relativo de volumen
+	std::vector<float> depth; // Profundidades finales de las celdas
+	};
+
+Result run(Simulator& sim,int scheme,float stepFactor,double endTime) // Ejecuta una simulación; esquema 0: Runge-Kutta, 1: semi-implícito con velocidad de onda, 2: semi-implícito con derivada
+	{
+	Result result;
+	result.numSteps=0;
+	result.stepSizeTime=0.0;
+	double startVolume=sim.volume();
+	Misc::Timer timer;
+	double t=0.0;
+	while(t<endTime)
+		{
+		float maxStep=float(endTime-t);
+		float stepSize;
+		if(scheme==0)
+			stepSize=sim.rungeKuttaStep(stepFactor,maxStep);
+		else
+			{
+			/* Dimensione el paso con el método elegido y mida su costo por separado: */
+			Misc::Timer stepSizeTimer;
+			float stableStepSize=scheme==1?sim.calcWaveSpeedStepSize():sim.calcDerivative(sim.quantity,sim.derivative);
+			stepSizeTimer.elapse();
+			result.stepSizeTime+=stepSizeTimer.getTime();
+			stepSize=sim.semiImplicitStep(fminf(fminf(stableStepSize*stepFactor,sim.maxStepSize),maxStep));
+			}
+		t+=double(stepSize);
+		++result.numSteps;
+		}
+	timer.elapse();
+	result.time=timer.getTime();
+	result.massError=(sim.volume()-startVolume)/startVolume;
+	for(int y=0;y<sim.size[1];++y)
+		for(int x=0;x<sim.size[0];++x)
+			result.depth.push_back(fmaxf(sim.quantity[y*sim.size[0]+x].c[0]-sim.cellB(x,y),0.0f));
+	return result;
+	}
+
+}
+
+int main(int argc,char* argv[])
+	{
+	/* Analizar la línea de comando: */
+	int size[2]={162,122};
+	float cellSize=0.5f;
+	double endTime=5.0;
+	float friction=0.0f;
+	unsigned int iterations=16;
+	for(int i=1;i<argc;++i)
+		{
+		if(strcasecmp(argv[i],"-size")==0&&i+2<argc)
+			{
+			size[0]=atoi(argv[i+1]);
+			size[1]=atoi(argv[i+2]);
+			i+=2;
+			}
+		else if(strcasecmp(argv[i],"-cellSize")==0&&i+1<argc)
+			cellSize=float(atof(argv[++i]));
+		else if(strcasecmp(argv[i],"-time")==0&&i+1<argc)
+			endTime=atof(argv[++i]);
+		else if(strcasecmp(argv[i],"-friction")==0&&i+1<argc)
+			friction=float(atof(argv[++i]));
+		else if(strcasecmp(argv[i],"-iterations")==0&&i+1<argc)
+			iterations=(unsigned int)(atoi(argv[++i]));
+		else
+			{
+			std::cerr<<"Usage: "<<argv[0]<<" [-size <width> <height>] [-cellSize <size>] [-time <seconds>] [-friction <friction>] [-iterations <iterations>]"<<std::endl;
+			return 1;
+			}
+		}
+	
+	/* Calcule la solución de referencia con pasos Runge-Kutta de un cuarto del tamaño estable: */
+	Simulator reference(size[0],size[1],cellSize);
+	initScene(reference);
+	Result ref=run(reference,0,0.25f,endTime);
+	double totalDepth=0.0;
+	for(size_t i=0;i<ref.depth.size();++i)
+		totalDepth+=ref.depth[i];
+	
+	std::cout<<"Grid "<<size[0]<<"x"<<size[1]<<", cell size "<<cellSize<<", "<<endTime<<" s simulated, friction "<<friction<<", "<<iterations<<" Jacobi iterations"<<std::endl;
+	std::cout<<"Reference: Runge-Kutta at 0.25x stable step, "<<ref.numSteps<<" steps, "<<ref.time<<" s"<<std::endl;
+	std::cout<<std::setw(28)<<std::left<<"Scheme"<<std::right<<std::setw(8)<<"Steps"<<std::setw(12)<<"Time (s)"<<std::setw(12)<<"ms/step"<<std::setw(14)<<"Sizing ms/st"<<std::setw(14)<<"Mass error"<<std::setw(12)<<"L1 error"<<std::setw(12)<<"Max error"<<std::endl;
+	
+	/* Ejecute el esquema Runge-Kutta y el semi-implícito con ambos métodos de dimensionamiento y varios factores de paso: */
+	struct Config
+		{
+		const char* name;
+		int scheme;
+		float stepFactor;
+		};
+	static const Config configs[]=
+		{
+		{"Runge-Kutta",0,1.0f},
+		{"Semi-implicit 1x (flux)",2,1.0f},
+		{"Semi-implicit 1x (wave)",1,1.0f},
+		{"Semi-implicit 2x (wave)",1,2.0f},
+		{"Semi-implicit 4x (flux)",2,4.0f},
+		{"Semi-implicit 4x (wave)",1,4.0f},
+		{"Semi-implicit 8x (wave)",1,8.0f}
+		};
+	for(size_t c=0;c<sizeof(configs)/sizeof(Config);++c)
+		{
+		Simulator sim(size[0],size[1],cellSize);
+		sim.friction=friction;
+		sim.semiImplicitIterations=iterations;
+		initScene(sim);
+		Result r=run(sim,configs[c].scheme,configs[c].stepFactor,endTime);
+		
+		/* Compare las profundidades finales con la referencia: */
+		double l1=0.0,maxError=0.0;
+		for(size_t i=0;i<r.depth.size();++i)
+			{
+			double e=fabs(double(r.depth[i])-double(ref.depth[i]));
+			l1+=e;
+			if(maxError<e)
+				maxError=e;
+			}
+		std::cout<<std::setw(28)<<std::left<<configs[c].name<<std::right<<std::setw(8)<<r.numSteps<<std::setw(12)<<std::setprecision(4)<<r.time<<std::setw(12)<<r.time*1000.0/double(r.numSteps)<<std::setw(14)<<r.stepSizeTime*1000.0/double(r.numSteps);
+		std::cout<<std::setw(14)<<r.massError<<std::setw(12)<<l1/totalDepth<<std::setw(12)<<maxError<<std::endl;
+		}
+	
+	return 0;
+	}
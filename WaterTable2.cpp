@@ -24,6 +24,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 
 #include <stdarg.h>
 #include <stdio.h>
+#include <string.h>
 #include <string>
 #include <iostream>
 #include <Math/Math.h>
@@ -33,13 +34,16 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 #include <GL/Extensions/GLARBDrawBuffers.h>
 #include <GL/Extensions/GLARBFragmentShader.h>
 #include <GL/Extensions/GLARBMultitexture.h>
+#include <GL/Extensions/GLARBPixelBufferObject.h>
 #include <GL/Extensions/GLARBShaderObjects.h>
 #include <GL/Extensions/GLARBTextureFloat.h>
 #include <GL/Extensions/GLARBTextureRectangle.h>
 #include <GL/Extensions/GLARBTextureRg.h>
+#include <GL/Extensions/GLARBVertexBufferObject.h>
 #include <GL/Extensions/GLARBVertexShader.h>
 #include <GL/Extensions/GLEXTFramebufferObject.h>
 #include <GL/GLContextData.h>
+#include <GL/GLExtensionManager.h>
 #include <GL/GLTransformationWrappers.h>
 
 #include "DepthImageRenderer.h"
@@ -85,25 +89,45 @@ WaterTable2::DataItem::DataItem(void)
 	 currentQuantity(0),
 	 derivativeTextureObject(0),
 	 waterTextureObject(0),
+	 sourceTextureObject(0),
 	 bathymetryFramebufferObject(0),
 	 derivativeFramebufferObject(0),
 	 maxStepSizeFramebufferObject(0),
 	 integrationFramebufferObject(0),
 	 waterFramebufferObject(0),
+	 semiImplicitFramebufferObject(0),
+	 statisticsFramebufferObject(0),
 	 bathymetryShader(0),
 	 waterAdaptShader(0),
 	 derivativeShader(0),
 	 maxStepSizeShader(0),
+	 waveSpeedShader(0),
 	 boundaryShader(0),
 	 eulerStepShader(0),
 	 rungeKuttaStepShader(0),
 	 waterAddShader(0),
-	 waterShader(0)
+	 waterShader(0),
+	 sourceShader(0),
+	 semiImplicitFluxShader(0),
+	 semiImplicitSolveShader(0),
+	 semiImplicitDischargeShader(0),
+	 semiImplicitUpdateShader(0),
+	 statisticsShader(0),
+	 statisticsReduceShader(0),
+	 haveSync(false),
+	 glFenceSyncProc(0),glClientWaitSyncProc(0),glDeleteSyncProc(0),
+	 numSteps(0),simulationTime(0.0),
+	 statisticsNumSteps(0),statisticsSimulationTime(0.0),
+	 numStatisticsResets(0),statisticsNumResets(0),
+	 haveStatistics(false),lastNumResets(0),lastVolume(0.0)
 	{
 	for(int i=0;i<2;++i)
 		{
 		bathymetryTextureObjects[i]=0;
 		maxStepSizeTextureObjects[i]=0;
+		faceTextureObjects[i]=0;
+		levelTextureObjects[i]=0;
+		statisticsTextureObjects[i]=0;
 		}
 	for(int i=0;i<3;++i)
 		quantityTextureObjects[i]=0;
@@ -112,12 +136,23 @@ WaterTable2::DataItem::DataItem(void)
 	GLARBDrawBuffers::initExtension();
 	GLARBFragmentShader::initExtension();
 	GLARBMultitexture::initExtension();
+	GLARBPixelBufferObject::initExtension();
 	GLARBShaderObjects::initExtension();
 	GLARBTextureFloat::initExtension();
 	GLARBTextureRectangle::initExtension();
 	GLARBTextureRg::initExtension();
+	GLARBVertexBufferObject::initExtension();
 	GLARBVertexShader::initExtension();
 	GLEXTFramebufferObject::initExtension();
+	
+	/* Obtenga las funciones de GL_ARB_sync si están disponibles; de lo contrario, las lecturas se completan después de un número fijo de fotogramas: */
+	if(GLExtensionManager::isExtensionSupported("GL_ARB_sync"))
+		{
+		glFenceSyncProc=GLExtensionManager::getFunction<PFNGLFENCESYNCPROC>("glFenceSync");
+		glClientWaitSyncProc=GLExtensionManager::getFunction<PFNGLCLIENTWAITSYNCPROC>("glClientWaitSync");
+		glDeleteSyncProc=GLExtensionManager::getFunction<PFNGLDELETESYNCPROC>("glDeleteSync");
+		haveSync=glFenceSyncProc!=0&&glClientWaitSyncProc!=0&&glDeleteSyncProc!=0;
+		}
 	}
 
 WaterTable2::DataItem::~DataItem(void)
@@ -128,20 +163,43 @@ WaterTable2::DataItem::~DataItem(void)
 	glDeleteTextures(1,&derivativeTextureObject);
 	glDeleteTextures(2,maxStepSizeTextureObjects);
 	glDeleteTextures(1,&waterTextureObject);
+	glDeleteTextures(1,&sourceTextureObject);
+	glDeleteTextures(2,faceTextureObjects);
+	glDeleteTextures(2,levelTextureObjects);
+	glDeleteTextures(2,statisticsTextureObjects);
 	glDeleteFramebuffersEXT(1,&bathymetryFramebufferObject);
 	glDeleteFramebuffersEXT(1,&derivativeFramebufferObject);
 	glDeleteFramebuffersEXT(1,&maxStepSizeFramebufferObject);
 	glDeleteFramebuffersEXT(1,&integrationFramebufferObject);
 	glDeleteFramebuffersEXT(1,&waterFramebufferObject);
+	glDeleteFramebuffersEXT(1,&semiImplicitFramebufferObject);
+	glDeleteFramebuffersEXT(1,&statisticsFramebufferObject);
 	glDeleteObjectARB(bathymetryShader);
 	glDeleteObjectARB(waterAdaptShader);
 	glDeleteObjectARB(derivativeShader);
 	glDeleteObjectARB(maxStepSizeShader);
+	glDeleteObjectARB(waveSpeedShader);
 	glDeleteObjectARB(boundaryShader);
 	glDeleteObjectARB(eulerStepShader);
 	glDeleteObjectARB(rungeKuttaStepShader);
 	glDeleteObjectARB(waterAddShader);
 	glDeleteObjectARB(waterShader);
+	glDeleteObjectARB(sourceShader);
+	glDeleteObjectARB(semiImplicitFluxShader);
+	glDeleteObjectARB(semiImplicitSolveShader);
+	glDeleteObjectARB(semiImplicitDischargeShader);
+	glDeleteObjectARB(semiImplicitUpdateShader);
+	glDeleteObjectARB(statisticsShader);
+	glDeleteObjectARB(statisticsReduceShader);
+	
+	/* Eliminar los objetos de lectura asincrónica: */
+	PixelReadback* readbacks[3]={&bathymetryReadback,&waterLevelReadback,&statisticsReadback};
+	for(int i=0;i<3;++i)
+		{
+		if(readbacks[i]->fence!=0)
+			glDeleteSyncProc(readbacks[i]->fence);
+		glDeleteBuffersARB(1,&readbacks[i]->bufferObject);
+		}
 	}
 
 /****************************
@@ -212,6 +270,55 @@ void WaterTable2::calcTransformations(void)
 			*wttmPtr=GLfloat(wttm(i,j));
 	}
 
+GLfloat WaterTable2::reduceMaxStepSize(WaterTable2::DataItem* dataItem) const
+	{
+	/* Configurar el sombreador de reducción de tamaño de paso máximo: */
+	glUseProgramObjectARB(dataItem->maxStepSizeShader);
+	
+	/* Enlazar el buffer de cuadro de cálculo de tamaño de paso máximo: */
+	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,dataItem->maxStepSizeFramebufferObject);
+	
+	/* Reduzca la textura de tamaño de paso máximo en una secuencia de pasos de reducción media: */
+	int reducedWidth=size[0];
+	int reducedHeight=size[1];
+	int currentMaxStepSizeTexture=0;
+	while(reducedWidth>1||reducedHeight>1)
+		{
+		/* Configure el buffer de cuadros de simulación para la reducción máxima del tamaño de paso */
+		glDrawBuffer(GL_COLOR_ATTACHMENT0_EXT+(1-currentMaxStepSizeTexture));
+		
+		/* Reducir la ventana gráfica por un factor de dos: */
+		glViewport(0,0,(reducedWidth+1)/2,(reducedHeight+1)/2);
+		glUniformARB(dataItem->maxStepSizeShaderUniformLocations[0],GLfloat(reducedWidth-1),GLfloat(reducedHeight-1));
+		
+		/* Enlazar la textura de tamaño de paso máximo actual: */
+		glActiveTextureARB(GL_TEXTURE0_ARB);
+		glBindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->maxStepSizeTextureObjects[currentMaxStepSizeTexture]);
+		glUniform1iARB(dataItem->maxStepSizeShaderUniformLocations[1],0);
+		
+		/* Ejecutar el paso de reducción: */
+		glBegin(GL_QUADS);
+		glVertex2i(0,0);
+		glVertex2i(size[0],0);
+		glVertex2i(size[0],size[1]);
+		glVertex2i(0,size[1]);
+		glEnd();
+		
+		/* Vaya al siguiente paso: */
+		reducedWidth=(reducedWidth+1)/2;
+		reducedHeight=(reducedHeight+1)/2;
+		currentMaxStepSizeTexture=1-currentMaxStepSizeTexture;
+		}
+	
+	/* Lea el valor final escrito en el último búfer de cuadros 1x1 reducido: */
+	GLfloat stepSize;
+	glReadBuffer(GL_COLOR_ATTACHMENT0_EXT+currentMaxStepSizeTexture);
+	glReadPixels(0,0,1,1,GL_LUMINANCE,GL_FLOAT,&stepSize);
+	
+	/* Limite el tamaño del paso al rango especificado por el cliente: */
+	return Math::min(stepSize,maxStepSize);
+	}
+
 GLfloat WaterTable2::calcDerivative(WaterTable2::DataItem* dataItem,GLuint quantityTextureObject,bool calcMaxStepSize) const
 	{
 	/*********************************************************************
@@ -253,57 +360,266 @@ GLfloat WaterTable2::calcDerivative(WaterTable2::DataItem* dataItem,GLuint quant
 	tamaño de paso máximo.
 	*********************************************************************/
 	
-	GLfloat stepSize=maxStepSize;
+	return calcMaxStepSize?reduceMaxStepSize(dataItem):maxStepSize;
+	}
+
+GLfloat WaterTable2::calcWaveSpeedStepSize(WaterTable2::DataItem* dataItem) const
+	{
+	/* Escriba el tamaño de paso máximo de cada celda directamente en la primera textura de tamaño de paso máximo: */
+	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,dataItem->maxStepSizeFramebufferObject);
+	glDrawBuffer(GL_COLOR_ATTACHMENT0_EXT);
+	glViewport(0,0,size[0],size[1]);
+	
+	/* Configurar el sombreador de velocidad de onda: */
+	glUseProgramObjectARB(dataItem->waveSpeedShader);
+	glUniformARB<2>(dataItem->waveSpeedShaderUniformLocations[0],1,cellSize);
+	glUniformARB(dataItem->waveSpeedShaderUniformLocations[1],g);
+	glUniformARB(dataItem->waveSpeedShaderUniformLocations[2],epsilon);
+	glActiveTextureARB(GL_TEXTURE0_ARB);
+	glBindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->bathymetryTextureObjects[dataItem->currentBathymetry]);
+	glUniform1iARB(dataItem->waveSpeedShaderUniformLocations[3],0);
+	glActiveTextureARB(GL_TEXTURE1_ARB);
+	glBindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->quantityTextureObjects[dataItem->currentQuantity]);
+	glUniform1iARB(dataItem->waveSpeedShaderUniformLocations[4],1);
+	
+	/* Calcular los tamaños de paso por celda: */
+	glBegin(GL_QUADS);
+	glVertex2i(0,0);
+	glVertex2i(size[0],0);
+	glVertex2i(size[0],size[1]);
+	glVertex2i(0,size[1]);
+	glEnd();
 	
-	if(calcMaxStepSize)
+	/* Desenlazar texturas innecesarias: */
+	glActiveTextureARB(GL_TEXTURE1_ARB);
+	glBindTexture(GL_TEXTURE_RECTANGLE_ARB,0);
+	
+	/* Reúna el mínimo de los tamaños de paso por celda: */
+	return reduceMaxStepSize(dataItem);
+	}
+
+void WaterTable2::startReadback(WaterTable2::DataItem* dataItem,WaterTable2::PixelReadback& readback,GLuint textureObject,GLfloat* buffer,unsigned int token) const
+	{
+	/* Lea el componente rojo de la textura en el búfer de píxeles; la llamada regresa sin esperar a la GPU: */
+	glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB,readback.bufferObject);
+	glActiveTextureARB(GL_TEXTURE0_ARB);
+	glBindTexture(GL_TEXTURE_RECTANGLE_ARB,textureObject);
+	glGetTexImage(GL_TEXTURE_RECTANGLE_ARB,0,GL_RED,GL_FLOAT,0);
+	glBindTexture(GL_TEXTURE_RECTANGLE_ARB,0);
+	glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB,0);
+	
+	/* Inserte una valla detrás de la lectura: */
+	if(dataItem->haveSync)
+		readback.fence=dataItem->glFenceSyncProc(GL_SYNC_GPU_COMMANDS_COMPLETE,0);
+	
+	/* Recuerde la solicitud atendida por esta lectura: */
+	readback.pending=true;
+	readback.numFrames=0;
+	readback.token=token;
+	readback.buffer=buffer;
+	}
+
+bool WaterTable2::finishReadback(WaterTable2::DataItem* dataItem,WaterTable2::PixelReadback& readback,GLsizei width,GLsizei height,const unsigned int* requestToken,unsigned int* replyToken) const
+	{
+	/* Compruebe si la GPU ha terminado de escribir en el búfer de píxeles: */
+	++readback.numFrames;
+	if(dataItem->haveSync)
 		{
-		/* Configurar el sombreador de reducción de tamaño de paso máximo: */
-		glUseProgramObjectARB(dataItem->maxStepSizeShader);
-		
-		/* Enlazar el buffer de cuadro de cálculo de tamaño de paso máximo: */
-		glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,dataItem->maxStepSizeFramebufferObject);
+		GLenum waitResult=dataItem->glClientWaitSyncProc(readback.fence,0,0);
+		if(waitResult!=GL_ALREADY_SIGNALED&&waitResult!=GL_CONDITION_SATISFIED)
+			return false;
+		dataItem->glDeleteSyncProc(readback.fence);
+		readback.fence=0;
+		}
+	else if(readback.numFrames<2)
+		{
+		/* Sin vallas, espere dos fotogramas para que la copia casi seguramente haya terminado: */
+		return false;
+		}
+	
+	readback.pending=false;
+	
+	/* Descarte el resultado si otro contexto ya respondió la solicitud o si fue cancelada o reemplazada: */
+	Threads::Mutex::Lock readbackLock(readbackMutex);
+	if(replyToken!=0&&(readback.token!=*requestToken||*replyToken==*requestToken))
+		return false;
+	
+	/* Copie el contenido del búfer de píxeles en el búfer de la aplicación mientras la solicitud no pueda cancelarse: */
+	glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB,readback.bufferObject);
+	const GLfloat* data=static_cast<const GLfloat*>(glMapBufferARB(GL_PIXEL_PACK_BUFFER_ARB,GL_READ_ONLY_ARB));
+	if(data!=0)
+		{
+		memcpy(readback.buffer,data,size_t(width)*size_t(height)*sizeof(GLfloat));
+		glUnmapBufferARB(GL_PIXEL_PACK_BUFFER_ARB);
+		}
+	glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB,0);
+	
+	/* Marque la solicitud como respondida: */
+	if(data!=0&&replyToken!=0)
+		*replyToken=readback.token;
+	return data!=0;
+	}
+
+void WaterTable2::processReadbacks(WaterTable2::DataItem* dataItem) const
+	{
+	/* Complete la lectura de la cuadrícula de batimetría; solo la primera lectura terminada de cualquier contexto responde la solicitud: */
+	if(dataItem->bathymetryReadback.pending)
+		finishReadback(dataItem,dataItem->bathymetryReadback,size[0]-1,size[1]-1,&readBathymetryRequest,&readBathymetryReply);
+	else
+		{
+		/* Inicie una lectura si la solicitud más reciente sigue sin respuesta: */
+		Threads::Mutex::Lock readbackLock(readbackMutex);
+		if(readBathymetryReply!=readBathymetryRequest)
+			startReadback(dataItem,dataItem->bathymetryReadback,dataItem->bathymetryTextureObjects[dataItem->currentBathymetry],readBathymetryBuffer,readBathymetryRequest);
+		}
+	
+	/* Complete o inicie la lectura del nivel de agua de la misma manera: */
+	if(dataItem->waterLevelReadback.pending)
+		finishReadback(dataItem,dataItem->waterLevelReadback,size[0],size[1],&readWaterLevelRequest,&readWaterLevelReply);
+	else
+		{
+		Threads::Mutex::Lock readbackLock(readbackMutex);
+		if(readWaterLevelReply!=readWaterLevelRequest)
+			startReadback(dataItem,dataItem->waterLevelReadback,dataItem->quantityTextureObjects[dataItem->currentQuantity],readWaterLevelBuffer,readWaterLevelRequest);
+		}
+	
+	/* Complete la lectura de las estadísticas del agua; las reducciones se inician desde runSimulationStep: */
+	if(dataItem->statisticsReadback.pending&&finishReadback(dataItem,dataItem->statisticsReadback,4,1,0,0))
+		finishStatistics(dataItem);
+	}
+
+void WaterTable2::startStatistics(WaterTable2::DataItem* dataItem) const
+	{
+	/* Enlazar el búfer de marco de reducción de estadísticas: */
+	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,dataItem->statisticsFramebufferObject);
+	
+	/*********************************************************************
+	Paso 1: Calcule la profundidad del agua de cada celda y reduzca
+	bloques de 2x2 celdas a suma de profundidades, número de celdas
+	mojadas y profundidad máxima.
+	*********************************************************************/
+	
+	glDrawBuffer(GL_COLOR_ATTACHMENT0_EXT);
+	glViewport(0,0,(size[0]+1)/2,(size[1]+1)/2);
+	
+	/* Configurar el sombreador de estadísticas: */
+	glUseProgramObjectARB(dataItem->statisticsShader);
+	glUniformARB(dataItem->statisticsShaderUniformLocations[0],GLfloat(size[0]-1),GLfloat(size[1]-1));
+	glUniformARB(dataItem->statisticsShaderUniformLocations[1],wetDepth);
+	glActiveTextureARB(GL_TEXTURE0_ARB);
+	glBindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->bathymetryTextureObjects[dataItem->currentBathymetry]);
+	glUniform1iARB(dataItem->statisticsShaderUniformLocations[2],0);
+	glActiveTextureARB(GL_TEXTURE1_ARB);
+	glBindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->quantityTextureObjects[dataItem->currentQuantity]);
+	glUniform1iARB(dataItem->statisticsShaderUniformLocations[3],1);
+	glActiveTextureARB(GL_TEXTURE2_ARB);
+	glBindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->sourceTextureObject);
+	glUniform1iARB(dataItem->statisticsShaderUniformLocations[4],2);
+	
+	/* Ejecutar el primer paso de reducción: */
+	glBegin(GL_QUADS);
+	glVertex2i(0,0);
+	glVertex2i(size[0],0);
+	glVertex2i(size[0],size[1]);
+	glVertex2i(0,size[1]);
+	glEnd();
+	
+	glActiveTextureARB(GL_TEXTURE2_ARB);
+	glBindTexture(GL_TEXTURE_RECTANGLE_ARB,0);
+	glActiveTextureARB(GL_TEXTURE1_ARB);
+	glBindTexture(GL_TEXTURE_RECTANGLE_ARB,0);
+	
+	/*********************************************************************
+	Paso 2: Reduzca la textura de estadísticas en una secuencia de pasos
+	de reducción media hasta un solo píxel.
+	*********************************************************************/
+	
+	glUseProgramObjectARB(dataItem->statisticsReduceShader);
+	int reducedWidth=(size[0]+1)/2;
+	int reducedHeight=(size[1]+1)/2;
+	int currentStatisticsTexture=0;
+	while(reducedWidth>1||reducedHeight>1)
+		{
+		/* Reducir la ventana gráfica por un factor de dos: */
+		glDrawBuffer(GL_COLOR_ATTACHMENT0_EXT+(1-currentStatisticsTexture));
+		glViewport(0,0,(reducedWidth+1)/2,(reducedHeight+1)/2);
+		glUniformARB(dataItem->statisticsReduceShaderUniformLocations[0],GLfloat(reducedWidth-1),GLfloat(reducedHeight-1));
 		
-		/* Reduzca la textura de tamaño de paso máximo en una secuencia de pasos de reducción media: */
-		int reducedWidth=size[0];
-		int reducedHeight=size[1];
-		int currentMaxStepSizeTexture=0;
-		while(reducedWidth>1||reducedHeight>1)
-			{
-			/* Configure el buffer de cuadros de simulación para la reducción máxima del tamaño de paso */
-			glDrawBuffer(GL_COLOR_ATTACHMENT0_EXT+(1-currentMaxStepSizeTexture));
-			
-			/* Reducir la ventana gráfica por un factor de dos: */
-			glViewport(0,0,(reducedWidth+1)/2,(reducedHeight+1)/2);
-			glUniformARB(dataItem->maxStepSizeShaderUniformLocations[0],GLfloat(reducedWidth-1),GLfloat(reducedHeight-1));
-			
-			/* Enlazar la textura de tamaño de paso máximo actual: */
-			glActiveTextureARB(GL_TEXTURE0_ARB);
-			glBindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->maxStepSizeTextureObjects[currentMaxStepSizeTexture]);
-			glUniform1iARB(dataItem->maxStepSizeShaderUniformLocations[1],0);
-			
-			/* Ejecutar el paso de reducción: */
-			glBegin(GL_QUADS);
-			glVertex2i(0,0);
-			glVertex2i(size[0],0);
-			glVertex2i(size[0],size[1]);
-			glVertex2i(0,size[1]);
-			glEnd();
-			
-			/* Vaya al siguiente paso: */
-			reducedWidth=(reducedWidth+1)/2;
-			reducedHeight=(reducedHeight+1)/2;
-			currentMaxStepSizeTexture=1-currentMaxStepSizeTexture;
-			}
+		/* Enlazar la textura de estadísticas actual: */
+		glActiveTextureARB(GL_TEXTURE0_ARB);
+		glBindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->statisticsTextureObjects[currentStatisticsTexture]);
+		glUniform1iARB(dataItem->statisticsReduceShaderUniformLocations[1],0);
 		
-		/* Lea el valor final escrito en el último búfer de cuadros 1x1 reducido: */
-		glReadBuffer(GL_COLOR_ATTACHMENT0_EXT+currentMaxStepSizeTexture);
-		glReadPixels(0,0,1,1,GL_LUMINANCE,GL_FLOAT,&stepSize);
+		/* Ejecutar el paso de reducción: */
+		glBegin(GL_QUADS);
+		glVertex2i(0,0);
+		glVertex2i(size[0],0);
+		glVertex2i(size[0],size[1]);
+		glVertex2i(0,size[1]);
+		glEnd();
 		
-		/* Limite el tamaño del paso al rango especificado por el cliente: */
-		stepSize=Math::min(stepSize,maxStepSize);
+		/* Vaya al siguiente paso: */
+		reducedWidth=(reducedWidth+1)/2;
+		reducedHeight=(reducedHeight+1)/2;
+		currentStatisticsTexture=1-currentStatisticsTexture;
 		}
 	
-	return stepSize;
+	glBindTexture(GL_TEXTURE_RECTANGLE_ARB,0);
+	
+	/* Lea el píxel final en el búfer de píxeles sin esperar a la GPU: */
+	glReadBuffer(GL_COLOR_ATTACHMENT0_EXT+currentStatisticsTexture);
+	glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB,dataItem->statisticsReadback.bufferObject);
+	glReadPixels(0,0,1,1,GL_RGBA,GL_FLOAT,0);
+	glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB,0);
+	glReadBuffer(GL_NONE);
+	
+	/* Inserte una valla detrás de la lectura: */
+	PixelReadback& readback=dataItem->statisticsReadback;
+	if(dataItem->haveSync)
+		readback.fence=dataItem->glFenceSyncProc(GL_SYNC_GPU_COMMANDS_COMPLETE,0);
+	readback.pending=true;
+	readback.numFrames=0;
+	readback.buffer=dataItem->statisticsBuffer;
+	
+	/* Recuerde el estado de la simulación en el momento de la reducción: */
+	dataItem->statisticsNumSteps=dataItem->numSteps;
+	dataItem->statisticsSimulationTime=dataItem->simulationTime;
+	dataItem->statisticsNumResets=dataItem->numStatisticsResets;
+	
+	/* Borre la textura de fuentes para acumular el agua agregada hasta la siguiente reducción: */
+	GLfloat currentClearColor[4];
+	glGetFloatv(GL_COLOR_CLEAR_VALUE,currentClearColor);
+	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,dataItem->waterFramebufferObject);
+	glDrawBuffer(GL_COLOR_ATTACHMENT1_EXT);
+	glViewport(0,0,size[0],size[1]);
+	glClearColor(0.0f,0.0f,0.0f,0.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+	glDrawBuffer(GL_COLOR_ATTACHMENT0_EXT);
+	glClearColor(currentClearColor[0],currentClearColor[1],currentClearColor[2],currentClearColor[3]);
+	}
+
+void WaterTable2::finishStatistics(WaterTable2::DataItem* dataItem) const
+	{
+	/* Convierta las sumas por celda en cantidades de coordenadas mundiales: */
+	double cellArea=double(cellSize[0])*double(cellSize[1]);
+	Statistics newStatistics;
+	newStatistics.numSteps=dataItem->statisticsNumSteps;
+	newStatistics.simulationTime=dataItem->statisticsSimulationTime;
+	newStatistics.volume=double(dataItem->statisticsBuffer[0])*cellArea;
+	newStatistics.wetArea=double(dataItem->statisticsBuffer[1])*cellArea;
+	newStatistics.maxDepth=double(dataItem->statisticsBuffer[2]);
+	newStatistics.sourceVolume=double(dataItem->statisticsBuffer[3])*cellArea;
+	
+	/* Calcule la deriva como el cambio de volumen que no explican las fuentes y sumideros desde la muestra anterior de este contexto, si la acumulación no se interrumpió entre ambas: */
+	if(dataItem->haveStatistics&&dataItem->statisticsNumResets==dataItem->lastNumResets)
+		newStatistics.drift=(newStatistics.volume-dataItem->lastVolume)-newStatistics.sourceVolume;
+	dataItem->haveStatistics=true;
+	dataItem->lastNumResets=dataItem->statisticsNumResets;
+	dataItem->lastVolume=newStatistics.volume;
+	
+	/* Publicar la nueva muestra: */
+	statistics=newStatistics;
+	++statisticsVersion;
 	}
 
 WaterTable2::WaterTable2(GLsizei width, GLsizei height, const GLfloat sCellSize[2])
@@ -312,7 +628,12 @@ WaterTable2::WaterTable2(GLsizei width, GLsizei height, const GLfloat sCellSize[
 	 dryBoundary(true),
 	 readBathymetryRequest(0U),
 	 readBathymetryBuffer(0),
-	 readBathymetryReply(0U)
+	 readBathymetryReply(0U),
+	 readWaterLevelRequest(0U),
+	 readWaterLevelBuffer(0),
+	 readWaterLevelReply(0U),
+	 statisticsInterval(0U),
+	 statisticsVersion(0U)
 	{
 	std::cout<<"13: WaterTable2 " << std::endl;
 	/* Inicialice el tamaño de la tabla de agua y el tamaño de la celda: */
@@ -337,9 +658,17 @@ WaterTable2::WaterTable2(GLsizei width, GLsizei height, const GLfloat sCellSize[
 	epsilon=0.01f*Math::max(Math::max(cellSize[0],cellSize[1]),1.0f);
 	attenuation=127.0f/128.0f; // 31.0f/32.0f;
 	maxStepSize=1.0f;
+	solverMode=RUNGE_KUTTA;
+	semiImplicitIterations=16;
+	semiImplicitStepFactor=4.0f;
+	friction=0.001f;
+	dryDepth=0.001f*Math::min(cellSize[0],cellSize[1]);
 	
 	/* Inicialice la cantidad del depósito de agua: */
 	waterDeposit=0.0f;
+	
+	/* Cuente como mojadas las celdas con al menos una centésima del tamaño de celda de agua: */
+	wetDepth=0.01f*Math::min(cellSize[0],cellSize[1]);
 	}
 
 WaterTable2::WaterTable2(GLsizei width, GLsizei height, const DepthImageRenderer* sDepthImageRenderer, const Point basePlaneCorners[4])
@@ -347,7 +676,12 @@ WaterTable2::WaterTable2(GLsizei width, GLsizei height, const DepthImageRenderer
 	 dryBoundary(true),
 	 readBathymetryRequest(0U),
 	 readBathymetryBuffer(0),
-	 readBathymetryReply(0U)
+	 readBathymetryReply(0U),
+	 readWaterLevelRequest(0U),
+	 readWaterLevelBuffer(0),
+	 readWaterLevelReply(0U),
+	 statisticsInterval(0U),
+	 statisticsVersion(0U)
 	{
 	std::cout<<"13: WaterTable2 " << std::endl;
 	/* Inicializar el tamaño de la tabla de agua: */
@@ -397,9 +731,17 @@ WaterTable2::WaterTable2(GLsizei width, GLsizei height, const DepthImageRenderer
 	epsilon=0.01f*Math::max(Math::max(cellSize[0],cellSize[1]),1.0f);
 	attenuation=127.0f/128.0f; // 31.0f/32.0f;
 	maxStepSize=1.0f;
+	solverMode=RUNGE_KUTTA;
+	semiImplicitIterations=16;
+	semiImplicitStepFactor=4.0f;
+	friction=0.001f;
+	dryDepth=0.001f*Math::min(cellSize[0],cellSize[1]);
 	
 	/* Inicialice la cantidad del depósito de agua: */
 	waterDeposit=0.0f;
+	
+	/* Cuente como mojadas las celdas con al menos una centésima del tamaño de celda de agua: */
+	wetDepth=0.01f*Math::min(cellSize[0],cellSize[1]);
 	}
 
 WaterTable2::~WaterTable2(void)
@@ -485,12 +827,67 @@ void WaterTable2::initContext(GLContextData& contextData) const
 	glTexParameteri(GL_TEXTURE_RECTANGLE_ARB,GL_TEXTURE_WRAP_T,GL_CLAMP);
 	GLfloat* w=makeBuffer(size[0],size[1],1,0.0);
 	glTexImage2D(GL_TEXTURE_RECTANGLE_ARB,0,GL_R32F,size[0],size[1],0,GL_LUMINANCE,GL_FLOAT,w);
+	
+	/* Crea la textura de acumulación de fuentes centrada en las células: */
+	glGenTextures(1,&dataItem->sourceTextureObject);
+	glBindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->sourceTextureObject);
+	glTexParameteri(GL_TEXTURE_RECTANGLE_ARB,GL_TEXTURE_MIN_FILTER,GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_RECTANGLE_ARB,GL_TEXTURE_MAG_FILTER,GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_RECTANGLE_ARB,GL_TEXTURE_WRAP_S,GL_CLAMP);
+	glTexParameteri(GL_TEXTURE_RECTANGLE_ARB,GL_TEXTURE_WRAP_T,GL_CLAMP);
+	glTexImage2D(GL_TEXTURE_RECTANGLE_ARB,0,GL_R32F,size[0],size[1],0,GL_LUMINANCE,GL_FLOAT,w);
 	delete[] w;
 	}
 	
+	{
+	/* Cree las texturas de caras y de iteración de los pasos semi-implícitos: */
+	glGenTextures(2,dataItem->faceTextureObjects);
+	glGenTextures(2,dataItem->levelTextureObjects);
+	for(int i=0;i<4;++i)
+		{
+		glBindTexture(GL_TEXTURE_RECTANGLE_ARB,i<2?dataItem->faceTextureObjects[i]:dataItem->levelTextureObjects[i-2]);
+		glTexParameteri(GL_TEXTURE_RECTANGLE_ARB,GL_TEXTURE_MIN_FILTER,GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_RECTANGLE_ARB,GL_TEXTURE_MAG_FILTER,GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_RECTANGLE_ARB,GL_TEXTURE_WRAP_S,GL_CLAMP);
+		glTexParameteri(GL_TEXTURE_RECTANGLE_ARB,GL_TEXTURE_WRAP_T,GL_CLAMP);
+		if(i<2)
+			glTexImage2D(GL_TEXTURE_RECTANGLE_ARB,0,GL_RGBA32F_ARB,size[0],size[1],0,GL_RGBA,GL_FLOAT,0);
+		else
+			glTexImage2D(GL_TEXTURE_RECTANGLE_ARB,0,GL_R32F,size[0],size[1],0,GL_LUMINANCE,GL_FLOAT,0);
+		}
+	}
+	
+	{
+	/* Cree las texturas de reducción de estadísticas del agua a la mitad de la resolución de la cuadrícula: */
+	glGenTextures(2,dataItem->statisticsTextureObjects);
+	for(int i=0;i<2;++i)
+		{
+		glBindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->statisticsTextureObjects[i]);
+		glTexParameteri(GL_TEXTURE_RECTANGLE_ARB,GL_TEXTURE_MIN_FILTER,GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_RECTANGLE_ARB,GL_TEXTURE_MAG_FILTER,GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_RECTANGLE_ARB,GL_TEXTURE_WRAP_S,GL_CLAMP);
+		glTexParameteri(GL_TEXTURE_RECTANGLE_ARB,GL_TEXTURE_WRAP_T,GL_CLAMP);
+		glTexImage2D(GL_TEXTURE_RECTANGLE_ARB,0,GL_RGBA32F_ARB,(size[0]+1)/2,(size[1]+1)/2,0,GL_RGBA,GL_FLOAT,0);
+		}
+	}
+	
 	/* Protege las texturas recién creadas: */
 	glBindTexture(GL_TEXTURE_RECTANGLE_ARB,0);
 	
+	{
+	/* Cree los búferes de píxeles para las lecturas asincrónicas de batimetría y nivel de agua: */
+	glGenBuffersARB(1,&dataItem->bathymetryReadback.bufferObject);
+	glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB,dataItem->bathymetryReadback.bufferObject);
+	glBufferDataARB(GL_PIXEL_PACK_BUFFER_ARB,(size[0]-1)*(size[1]-1)*sizeof(GLfloat),0,GL_STREAM_READ_ARB);
+	glGenBuffersARB(1,&dataItem->waterLevelReadback.bufferObject);
+	glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB,dataItem->waterLevelReadback.bufferObject);
+	glBufferDataARB(GL_PIXEL_PACK_BUFFER_ARB,size[0]*size[1]*sizeof(GLfloat),0,GL_STREAM_READ_ARB);
+	glGenBuffersARB(1,&dataItem->statisticsReadback.bufferObject);
+	glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB,dataItem->statisticsReadback.bufferObject);
+	glBufferDataARB(GL_PIXEL_PACK_BUFFER_ARB,4*sizeof(GLfloat),0,GL_STREAM_READ_ARB);
+	glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB,0);
+	}
+	
 	/* Guarda el búfer de cuadros actualmente enlazado: */
 	GLint currentFrameBuffer;
 	glGetIntegerv(GL_FRAMEBUFFER_BINDING_EXT,&currentFrameBuffer);
@@ -549,12 +946,40 @@ void WaterTable2::initContext(GLContextData& contextData) const
 	glGenFramebuffersEXT(1,&dataItem->waterFramebufferObject);
 	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,dataItem->waterFramebufferObject);
 	
-	/* Conecte la textura del agua al amortiguador de la estructura del agua: */
+	/* Conecte las texturas del agua y de fuentes al amortiguador de la estructura del agua: */
 	glFramebufferTexture2DEXT(GL_FRAMEBUFFER_EXT,GL_COLOR_ATTACHMENT0_EXT,GL_TEXTURE_RECTANGLE_ARB,dataItem->waterTextureObject,0);
+	glFramebufferTexture2DEXT(GL_FRAMEBUFFER_EXT,GL_COLOR_ATTACHMENT1_EXT,GL_TEXTURE_RECTANGLE_ARB,dataItem->sourceTextureObject,0);
 	glDrawBuffer(GL_COLOR_ATTACHMENT0_EXT);
 	glReadBuffer(GL_NONE);
 	}
 	
+	{
+	/* Cree el búfer de marco de los pasos semi-implícitos: */
+	glGenFramebuffersEXT(1,&dataItem->semiImplicitFramebufferObject);
+	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,dataItem->semiImplicitFramebufferObject);
+	
+	/* Adjunte las texturas de caras y de iteración al búfer de marco de los pasos semi-implícitos: */
+	for(int i=0;i<2;++i)
+		{
+		glFramebufferTexture2DEXT(GL_FRAMEBUFFER_EXT,GL_COLOR_ATTACHMENT0_EXT+i,GL_TEXTURE_RECTANGLE_ARB,dataItem->faceTextureObjects[i],0);
+		glFramebufferTexture2DEXT(GL_FRAMEBUFFER_EXT,GL_COLOR_ATTACHMENT2_EXT+i,GL_TEXTURE_RECTANGLE_ARB,dataItem->levelTextureObjects[i],0);
+		}
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+	}
+	
+	{
+	/* Cree el búfer de marco de reducción de estadísticas del agua: */
+	glGenFramebuffersEXT(1,&dataItem->statisticsFramebufferObject);
+	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,dataItem->statisticsFramebufferObject);
+	
+	/* Adjunte las texturas de estadísticas al búfer de marco de reducción de estadísticas: */
+	for(int i=0;i<2;++i)
+		glFramebufferTexture2DEXT(GL_FRAMEBUFFER_EXT,GL_COLOR_ATTACHMENT0_EXT+i,GL_TEXTURE_RECTANGLE_ARB,dataItem->statisticsTextureObjects[i],0);
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+	}
+	
 	/* Restaura el búfer de cuadros previamente enlazado: */
 	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,currentFrameBuffer);
 	
@@ -565,11 +990,7 @@ void WaterTable2::initContext(GLContextData& contextData) const
 	
 	/* Crear el sombreador de actualización batimetría: */
 	{
-	GLhandleARB vertexShader=glCompileVertexShaderFromString(vertexShaderSource);
-	GLhandleARB fragmentShader=compileFragmentShader("Water2BathymetryUpdateShader");
-	dataItem->bathymetryShader=glLinkShader(vertexShader,fragmentShader);
-	glDeleteObjectARB(vertexShader);
-	glDeleteObjectARB(fragmentShader);
+	dataItem->bathymetryShader=linkVertexSourceAndFragmentShader(vertexShaderSource,"Water2BathymetryUpdateShader");
 	dataItem->bathymetryShaderUniformLocations[0]=glGetUniformLocationARB(dataItem->bathymetryShader,"oldBathymetrySampler");
 	dataItem->bathymetryShaderUniformLocations[1]=glGetUniformLocationARB(dataItem->bathymetryShader,"newBathymetrySampler");
 	dataItem->bathymetryShaderUniformLocations[2]=glGetUniformLocationARB(dataItem->bathymetryShader,"quantitySampler");
@@ -577,22 +998,14 @@ void WaterTable2::initContext(GLContextData& contextData) const
 	
 	/* Crea el shader de adaptación al agua: */
 	{
-	GLhandleARB vertexShader=glCompileVertexShaderFromString(vertexShaderSource);
-	GLhandleARB fragmentShader=compileFragmentShader("Water2WaterAdaptShader");
-	dataItem->waterAdaptShader=glLinkShader(vertexShader,fragmentShader);
-	glDeleteObjectARB(vertexShader);
-	glDeleteObjectARB(fragmentShader);
+	dataItem->waterAdaptShader=linkVertexSourceAndFragmentShader(vertexShaderSource,"Water2WaterAdaptShader");
 	dataItem->waterAdaptShaderUniformLocations[0]=glGetUniformLocationARB(dataItem->waterAdaptShader,"bathymetrySampler");
 	dataItem->waterAdaptShaderUniformLocations[1]=glGetUniformLocationARB(dataItem->waterAdaptShader,"newQuantitySampler");
 	}
 	
 	/* Crear el sombreador de cálculo de derivada temporal: */
 	{
-	GLhandleARB vertexShader=glCompileVertexShaderFromString(vertexShaderSource);
-	GLhandleARB fragmentShader=compileFragmentShader("Water2SlopeAndFluxAndDerivativeShader");
-	dataItem->derivativeShader=glLinkShader(vertexShader,fragmentShader);
-	glDeleteObjectARB(vertexShader);
-	glDeleteObjectARB(fragmentShader);
+	dataItem->derivativeShader=linkVertexSourceAndFragmentShader(vertexShaderSource,"Water2SlopeAndFluxAndDerivativeShader");
 	dataItem->derivativeShaderUniformLocations[0]=glGetUniformLocationARB(dataItem->derivativeShader,"cellSize");
 	dataItem->derivativeShaderUniformLocations[1]=glGetUniformLocationARB(dataItem->derivativeShader,"theta");
 	dataItem->derivativeShaderUniformLocations[2]=glGetUniformLocationARB(dataItem->derivativeShader,"g");
@@ -603,32 +1016,30 @@ void WaterTable2::initContext(GLContextData& contextData) const
 	
 	/* Cree el sombreador de recopilación de tamaño de paso máximo: */
 	{
-	GLhandleARB vertexShader=glCompileVertexShaderFromString(vertexShaderSource);
-	GLhandleARB fragmentShader=compileFragmentShader("Water2MaxStepSizeShader");
-	dataItem->maxStepSizeShader=glLinkShader(vertexShader,fragmentShader);
-	glDeleteObjectARB(vertexShader);
-	glDeleteObjectARB(fragmentShader);
+	dataItem->maxStepSizeShader=linkVertexSourceAndFragmentShader(vertexShaderSource,"Water2MaxStepSizeShader");
 	dataItem->maxStepSizeShaderUniformLocations[0]=glGetUniformLocationARB(dataItem->maxStepSizeShader,"fullTextureSize");
 	dataItem->maxStepSizeShaderUniformLocations[1]=glGetUniformLocationARB(dataItem->maxStepSizeShader,"maxStepSizeSampler");
 	}
 	
+	/* Cree el sombreador de velocidad de onda: */
+	{
+	dataItem->waveSpeedShader=linkVertexSourceAndFragmentShader(vertexShaderSource,"Water2WaveSpeedShader");
+	dataItem->waveSpeedShaderUniformLocations[0]=glGetUniformLocationARB(dataItem->waveSpeedShader,"cellSize");
+	dataItem->waveSpeedShaderUniformLocations[1]=glGetUniformLocationARB(dataItem->waveSpeedShader,"g");
+	dataItem->waveSpeedShaderUniformLocations[2]=glGetUniformLocationARB(dataItem->waveSpeedShader,"epsilon");
+	dataItem->waveSpeedShaderUniformLocations[3]=glGetUniformLocationARB(dataItem->waveSpeedShader,"bathymetrySampler");
+	dataItem->waveSpeedShaderUniformLocations[4]=glGetUniformLocationARB(dataItem->waveSpeedShader,"quantitySampler");
+	}
+	
 	/* Crear el sombreador de condiciones de contorno: */
 	{
-	GLhandleARB vertexShader=glCompileVertexShaderFromString(vertexShaderSource);
-	GLhandleARB fragmentShader=compileFragmentShader("Water2BoundaryShader");
-	dataItem->boundaryShader=glLinkShader(vertexShader,fragmentShader);
-	glDeleteObjectARB(vertexShader);
-	glDeleteObjectARB(fragmentShader);
+	dataItem->boundaryShader=linkVertexSourceAndFragmentShader(vertexShaderSource,"Water2BoundaryShader");
 	dataItem->boundaryShaderUniformLocations[0]=glGetUniformLocationARB(dataItem->boundaryShader,"bathymetrySampler");
 	}
 	
 	/* Cree el sombreador de pasos de integración de Euler: */
 	{
-	GLhandleARB vertexShader=glCompileVertexShaderFromString(vertexShaderSource);
-	GLhandleARB fragmentShader=compileFragmentShader("Water2EulerStepShader");
-	dataItem->eulerStepShader=glLinkShader(vertexShader,fragmentShader);
-	glDeleteObjectARB(vertexShader);
-	glDeleteObjectARB(fragmentShader);
+	dataItem->eulerStepShader=linkVertexSourceAndFragmentShader(vertexShaderSource,"Water2EulerStepShader");
 	dataItem->eulerStepShaderUniformLocations[0]=glGetUniformLocationARB(dataItem->eulerStepShader,"stepSize");
 	dataItem->eulerStepShaderUniformLocations[1]=glGetUniformLocationARB(dataItem->eulerStepShader,"attenuation");
 	dataItem->eulerStepShaderUniformLocations[2]=glGetUniformLocationARB(dataItem->eulerStepShader,"quantitySampler");
@@ -637,11 +1048,7 @@ void WaterTable2::initContext(GLContextData& contextData) const
 	
 	/* Cree el sombreador de pasos de integración Runge-Kutta: */
 	{
-	GLhandleARB vertexShader=glCompileVertexShaderFromString(vertexShaderSource);
-	GLhandleARB fragmentShader=compileFragmentShader("Water2RungeKuttaStepShader");
-	dataItem->rungeKuttaStepShader=glLinkShader(vertexShader,fragmentShader);
-	glDeleteObjectARB(vertexShader);
-	glDeleteObjectARB(fragmentShader);
+	dataItem->rungeKuttaStepShader=linkVertexSourceAndFragmentShader(vertexShaderSource,"Water2RungeKuttaStepShader");
 	dataItem->rungeKuttaStepShaderUniformLocations[0]=glGetUniformLocationARB(dataItem->rungeKuttaStepShader,"stepSize");
 	dataItem->rungeKuttaStepShaderUniformLocations[1]=glGetUniformLocationARB(dataItem->rungeKuttaStepShader,"attenuation");
 	dataItem->rungeKuttaStepShaderUniformLocations[2]=glGetUniformLocationARB(dataItem->rungeKuttaStepShader,"quantitySampler");
@@ -651,11 +1058,7 @@ void WaterTable2::initContext(GLContextData& contextData) const
 	
 	/* Cree el sombreador de renderizado del sumador de agua: */
 	{
-	GLhandleARB vertexShader=compileVertexShader("Water2WaterAddShader");
-	GLhandleARB fragmentShader=compileFragmentShader("Water2WaterAddShader");
-	dataItem->waterAddShader=glLinkShader(vertexShader,fragmentShader);
-	glDeleteObjectARB(vertexShader);
-	glDeleteObjectARB(fragmentShader);
+	dataItem->waterAddShader=linkVertexAndFragmentShader("Water2WaterAddShader");
 	dataItem->waterAddShaderUniformLocations[0]=glGetUniformLocationARB(dataItem->waterAddShader,"pmv");
 	dataItem->waterAddShaderUniformLocations[1]=glGetUniformLocationARB(dataItem->waterAddShader,"stepSize");
 	dataItem->waterAddShaderUniformLocations[2]=glGetUniformLocationARB(dataItem->waterAddShader,"waterSampler");
@@ -663,15 +1066,81 @@ void WaterTable2::initContext(GLContextData& contextData) const
 	
 	/* Crea el shader de agua: */
 	{
-	GLhandleARB vertexShader=glCompileVertexShaderFromString(vertexShaderSource);
-	GLhandleARB fragmentShader=compileFragmentShader("Water2WaterUpdateShader");
-	dataItem->waterShader=glLinkShader(vertexShader,fragmentShader);
-	glDeleteObjectARB(vertexShader);
-	glDeleteObjectARB(fragmentShader);
+	dataItem->waterShader=linkVertexSourceAndFragmentShader(vertexShaderSource,"Water2WaterUpdateShader");
 	dataItem->waterShaderUniformLocations[0]=glGetUniformLocationARB(dataItem->waterShader,"bathymetrySampler");
 	dataItem->waterShaderUniformLocations[1]=glGetUniformLocationARB(dataItem->waterShader,"quantitySampler");
 	dataItem->waterShaderUniformLocations[2]=glGetUniformLocationARB(dataItem->waterShader,"waterSampler");
 	}
+	
+	/* Cree el sombreador de acumulación de fuentes: */
+	{
+	dataItem->sourceShader=linkVertexSourceAndFragmentShader(vertexShaderSource,"Water2SourceAccumulateShader");
+	dataItem->sourceShaderUniformLocations[0]=glGetUniformLocationARB(dataItem->sourceShader,"newQuantitySampler");
+	dataItem->sourceShaderUniformLocations[1]=glGetUniformLocationARB(dataItem->sourceShader,"oldQuantitySampler");
+	}
+	
+	/* Cree el sombreador de descargas explícitas de los pasos semi-implícitos: */
+	{
+	dataItem->semiImplicitFluxShader=linkVertexSourceAndFragmentShader(vertexShaderSource,"Water2SemiImplicitFluxShader");
+	dataItem->semiImplicitFluxShaderUniformLocations[0]=glGetUniformLocationARB(dataItem->semiImplicitFluxShader,"gridSize");
+	dataItem->semiImplicitFluxShaderUniformLocations[1]=glGetUniformLocationARB(dataItem->semiImplicitFluxShader,"stepSize");
+	dataItem->semiImplicitFluxShaderUniformLocations[2]=glGetUniformLocationARB(dataItem->semiImplicitFluxShader,"g");
+	dataItem->semiImplicitFluxShaderUniformLocations[3]=glGetUniformLocationARB(dataItem->semiImplicitFluxShader,"friction");
+	dataItem->semiImplicitFluxShaderUniformLocations[4]=glGetUniformLocationARB(dataItem->semiImplicitFluxShader,"attenuation");
+	dataItem->semiImplicitFluxShaderUniformLocations[5]=glGetUniformLocationARB(dataItem->semiImplicitFluxShader,"dryDepth");
+	dataItem->semiImplicitFluxShaderUniformLocations[6]=glGetUniformLocationARB(dataItem->semiImplicitFluxShader,"bathymetrySampler");
+	dataItem->semiImplicitFluxShaderUniformLocations[7]=glGetUniformLocationARB(dataItem->semiImplicitFluxShader,"quantitySampler");
+	}
+	
+	/* Cree el sombreador de iteraciones de Jacobi de los pasos semi-implícitos: */
+	{
+	dataItem->semiImplicitSolveShader=linkVertexSourceAndFragmentShader(vertexShaderSource,"Water2SemiImplicitSolveShader");
+	dataItem->semiImplicitSolveShaderUniformLocations[0]=glGetUniformLocationARB(dataItem->semiImplicitSolveShader,"cellSize");
+	dataItem->semiImplicitSolveShaderUniformLocations[1]=glGetUniformLocationARB(dataItem->semiImplicitSolveShader,"stepSize");
+	dataItem->semiImplicitSolveShaderUniformLocations[2]=glGetUniformLocationARB(dataItem->semiImplicitSolveShader,"g");
+	dataItem->semiImplicitSolveShaderUniformLocations[3]=glGetUniformLocationARB(dataItem->semiImplicitSolveShader,"faceSampler");
+	dataItem->semiImplicitSolveShaderUniformLocations[4]=glGetUniformLocationARB(dataItem->semiImplicitSolveShader,"quantitySampler");
+	dataItem->semiImplicitSolveShaderUniformLocations[5]=glGetUniformLocationARB(dataItem->semiImplicitSolveShader,"levelSampler");
+	}
+	
+	/* Cree el sombreador de nuevas descargas de los pasos semi-implícitos: */
+	{
+	dataItem->semiImplicitDischargeShader=linkVertexSourceAndFragmentShader(vertexShaderSource,"Water2SemiImplicitDischargeShader");
+	dataItem->semiImplicitDischargeShaderUniformLocations[0]=glGetUniformLocationARB(dataItem->semiImplicitDischargeShader,"cellSize");
+	dataItem->semiImplicitDischargeShaderUniformLocations[1]=glGetUniformLocationARB(dataItem->semiImplicitDischargeShader,"stepSize");
+	dataItem->semiImplicitDischargeShaderUniformLocations[2]=glGetUniformLocationARB(dataItem->semiImplicitDischargeShader,"g");
+	dataItem->semiImplicitDischargeShaderUniformLocations[3]=glGetUniformLocationARB(dataItem->semiImplicitDischargeShader,"bathymetrySampler");
+	dataItem->semiImplicitDischargeShaderUniformLocations[4]=glGetUniformLocationARB(dataItem->semiImplicitDischargeShader,"faceSampler");
+	dataItem->semiImplicitDischargeShaderUniformLocations[5]=glGetUniformLocationARB(dataItem->semiImplicitDischargeShader,"quantitySampler");
+	dataItem->semiImplicitDischargeShaderUniformLocations[6]=glGetUniformLocationARB(dataItem->semiImplicitDischargeShader,"levelSampler");
+	}
+	
+	/* Cree el sombreador de actualización de los pasos semi-implícitos: */
+	{
+	dataItem->semiImplicitUpdateShader=linkVertexSourceAndFragmentShader(vertexShaderSource,"Water2SemiImplicitUpdateShader");
+	dataItem->semiImplicitUpdateShaderUniformLocations[0]=glGetUniformLocationARB(dataItem->semiImplicitUpdateShader,"cellSize");
+	dataItem->semiImplicitUpdateShaderUniformLocations[1]=glGetUniformLocationARB(dataItem->semiImplicitUpdateShader,"stepSize");
+	dataItem->semiImplicitUpdateShaderUniformLocations[2]=glGetUniformLocationARB(dataItem->semiImplicitUpdateShader,"bathymetrySampler");
+	dataItem->semiImplicitUpdateShaderUniformLocations[3]=glGetUniformLocationARB(dataItem->semiImplicitUpdateShader,"dischargeSampler");
+	dataItem->semiImplicitUpdateShaderUniformLocations[4]=glGetUniformLocationARB(dataItem->semiImplicitUpdateShader,"quantitySampler");
+	}
+	
+	/* Cree el sombreador de estadísticas del agua: */
+	{
+	dataItem->statisticsShader=linkVertexSourceAndFragmentShader(vertexShaderSource,"Water2StatisticsShader");
+	dataItem->statisticsShaderUniformLocations[0]=glGetUniformLocationARB(dataItem->statisticsShader,"fullTextureSize");
+	dataItem->statisticsShaderUniformLocations[1]=glGetUniformLocationARB(dataItem->statisticsShader,"wetDepth");
+	dataItem->statisticsShaderUniformLocations[2]=glGetUniformLocationARB(dataItem->statisticsShader,"bathymetrySampler");
+	dataItem->statisticsShaderUniformLocations[3]=glGetUniformLocationARB(dataItem->statisticsShader,"quantitySampler");
+	dataItem->statisticsShaderUniformLocations[4]=glGetUniformLocationARB(dataItem->statisticsShader,"sourceSampler");
+	}
+	
+	/* Cree el sombreador de reducción de estadísticas del agua: */
+	{
+	dataItem->statisticsReduceShader=linkVertexSourceAndFragmentShader(vertexShaderSource,"Water2StatisticsReduceShader");
+	dataItem->statisticsReduceShaderUniformLocations[0]=glGetUniformLocationARB(dataItem->statisticsReduceShader,"fullTextureSize");
+	dataItem->statisticsReduceShaderUniformLocations[1]=glGetUniformLocationARB(dataItem->statisticsReduceShader,"statisticsSampler");
+	}
 	}
 
 void WaterTable2::setElevationRange(Scalar newMin,Scalar newMax)
@@ -695,6 +1164,18 @@ void WaterTable2::setMaxStepSize(GLfloat newMaxStepSize)
 	maxStepSize = newMaxStepSize;
 	}
 
+void WaterTable2::setSolverMode(WaterTable2::SolverMode newSolverMode)
+	{
+	solverMode=newSolverMode;
+	}
+
+void WaterTable2::setSemiImplicitParameters(unsigned int newIterations,GLfloat newStepFactor,GLfloat newFriction)
+	{
+	semiImplicitIterations=newIterations;
+	semiImplicitStepFactor=newStepFactor;
+	friction=newFriction;
+	}
+
 void WaterTable2::addRenderFunction(const AddWaterFunction* newRenderFunction)
 	{
 	std::cout<<"13.3: AddRenderFunction " << std::endl;
@@ -725,13 +1206,23 @@ void WaterTable2::setDryBoundary(bool newDryBoundary)
 	dryBoundary=newDryBoundary;
 	}
 
+void WaterTable2::setStatisticsInterval(unsigned int newStatisticsInterval)
+	{
+	statisticsInterval=newStatisticsInterval;
+	}
+
+void WaterTable2::setWetDepth(GLfloat newWetDepth)
+	{
+	wetDepth=newWetDepth;
+	}
+
 void WaterTable2::updateBathymetry(GLContextData& contextData) const
 	{
 	/* Obtener el elemento de datos: */
 	DataItem* dataItem=contextData.retrieveDataItem<DataItem>(this);
 	
 	/* Compruebe si la textura actual de la batimetría está desactualizada: */
-	if(dataItem->bathymetryVersion!=depthImageRenderer->getDepthImageVersion())
+	if(dataItem->bathymetryVersion!=depthImageRenderer->getDepthTextureVersion(contextData))
 		{
 		/* Guardar el estado relevante de OpenGL: */
 		glPushAttrib(GL_VIEWPORT_BIT);
@@ -764,16 +1255,6 @@ void WaterTable2::updateBathymetry(GLContextData& contextData) const
 		glBindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->bathymetryTextureObjects[1-dataItem->currentBathymetry]);
 		glUniform1iARB(dataItem->bathymetryShaderUniformLocations[1],1);
 		
-		/* Compruebe si se solicitó la red batimetría actual: */
-		if(readBathymetryReply!=readBathymetryRequest)
-			{
-			/* Lea la red de batimetría en el búfer suministrado: */
-			glGetTexImage(GL_TEXTURE_RECTANGLE_ARB,0,GL_RED,GL_FLOAT,readBathymetryBuffer);
-			
-			/* Terminar la solicitud: */
-			readBathymetryReply=readBathymetryRequest;
-			}
-		
 		glActiveTextureARB(GL_TEXTURE2_ARB);
 		glBindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->quantityTextureObjects[dataItem->currentQuantity]);
 		glUniform1iARB(dataItem->bathymetryShaderUniformLocations[2],2);
@@ -802,9 +1283,12 @@ void WaterTable2::updateBathymetry(GLContextData& contextData) const
 		
 		/* Actualización de las redes de batimetría y cantidad: */
 		dataItem->currentBathymetry=1-dataItem->currentBathymetry;
-		dataItem->bathymetryVersion=depthImageRenderer->getDepthImageVersion();
+		dataItem->bathymetryVersion=depthImageRenderer->getDepthTextureVersion(contextData);
 		dataItem->currentQuantity=1-dataItem->currentQuantity;
 		}
+	
+	/* Avance las lecturas asincrónicas pendientes: */
+	processReadbacks(dataItem);
 	}
 
 void WaterTable2::updateBathymetry(const GLfloat* bathymetryGrid,GLContextData& contextData) const
@@ -852,14 +1336,17 @@ void WaterTable2::updateBathymetry(const GLfloat* bathymetryGrid,GLContextData&
 	glActiveTextureARB(GL_TEXTURE0_ARB);
 	glBindTexture(GL_TEXTURE_RECTANGLE_ARB,0);
 	glUseProgramObjectARB(0);
-
+	
 	/* Restaure el estado de OpenGL: */
 	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,currentFrameBuffer);
 	glPopAttrib();
-
+	
 	/* Actualización de las redes de batimetría y cantidad: */
 	dataItem->currentBathymetry=1-dataItem->currentBathymetry;
 	dataItem->currentQuantity=1-dataItem->currentQuantity;
+	
+	/* Avance las lecturas asincrónicas pendientes: */
+	processReadbacks(dataItem);
 	}
 
 void WaterTable2::setWaterLevel(const GLfloat* waterGrid,GLContextData& contextData) const
@@ -905,25 +1392,20 @@ void WaterTable2::setWaterLevel(const GLfloat* waterGrid,GLContextData& contextD
 	glActiveTextureARB(GL_TEXTURE0_ARB);
 	glBindTexture(GL_TEXTURE_RECTANGLE_ARB,0);
 	glUseProgramObjectARB(0);
-
+	
 	/* Restaure el estado de OpenGL: */
 	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,currentFrameBuffer);
 	glPopAttrib();
-
+	
 	/* Actualizar la cuadrícula de cantidad: */
 	dataItem->currentQuantity=1-dataItem->currentQuantity;
+	
+	/* El nuevo nivel de agua no es un cambio de la simulación; la siguiente muestra de estadísticas no calcula la deriva: */
+	++dataItem->numStatisticsResets;
 	}
 
-GLfloat WaterTable2::runSimulationStep(bool forceStepSize,GLContextData& contextData) const
+GLfloat WaterTable2::rungeKuttaStep(WaterTable2::DataItem* dataItem,bool forceStepSize) const
 	{
-	/* Obtener el elemento de datos: */
-	DataItem* dataItem=contextData.retrieveDataItem<DataItem>(this);
-	
-	/* Guardar el estado relevante de OpenGL: */
-	glPushAttrib(GL_COLOR_BUFFER_BIT|GL_VIEWPORT_BIT);
-	GLint currentFrameBuffer;
-	glGetIntegerv(GL_FRAMEBUFFER_BINDING_EXT,&currentFrameBuffer);
-	
 	/*********************************************************************
 	Paso 1: Calcular la derivada temporal de las cantidades más recientes.
 	*********************************************************************/
@@ -995,6 +1477,165 @@ GLfloat WaterTable2::runSimulationStep(bool forceStepSize,GLContextData& context
 	glVertex2i(0,size[1]);
 	glEnd();
 	
+	return stepSize;
+	}
+
+GLfloat WaterTable2::semiImplicitStep(WaterTable2::DataItem* dataItem,bool forceStepSize) const
+	{
+	/*********************************************************************
+	Paso 1: Calcule el tamaño de paso como un múltiplo del tamaño de paso
+	estable del esquema explícito, estimado a partir de la velocidad de
+	onda máxima |u|+sqrt(g*h) sin calcular los flujos del esquema
+	explícito.
+	*********************************************************************/
+	
+	GLfloat stepSize=maxStepSize;
+	if(!forceStepSize)
+		stepSize=Math::min(calcWaveSpeedStepSize(dataItem)*semiImplicitStepFactor,maxStepSize);
+	
+	/*********************************************************************
+	Paso 2: Calcule las descargas explícitas y las profundidades de flujo
+	en las caras este y norte de cada celda.
+	*********************************************************************/
+	
+	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,dataItem->semiImplicitFramebufferObject);
+	glDrawBuffer(GL_COLOR_ATTACHMENT0_EXT);
+	glViewport(0,0,size[0],size[1]);
+	
+	glUseProgramObjectARB(dataItem->semiImplicitFluxShader);
+	glUniformARB(dataItem->semiImplicitFluxShaderUniformLocations[0],GLfloat(size[0]),GLfloat(size[1]));
+	glUniformARB(dataItem->semiImplicitFluxShaderUniformLocations[1],stepSize);
+	glUniformARB(dataItem->semiImplicitFluxShaderUniformLocations[2],g);
+	glUniformARB(dataItem->semiImplicitFluxShaderUniformLocations[3],friction);
+	glUniformARB(dataItem->semiImplicitFluxShaderUniformLocations[4],Math::pow(attenuation,stepSize));
+	glUniformARB(dataItem->semiImplicitFluxShaderUniformLocations[5],dryDepth);
+	glActiveTextureARB(GL_TEXTURE0_ARB);
+	glBindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->bathymetryTextureObjects[dataItem->currentBathymetry]);
+	glUniform1iARB(dataItem->semiImplicitFluxShaderUniformLocations[6],0);
+	glActiveTextureARB(GL_TEXTURE1_ARB);
+	glBindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->quantityTextureObjects[dataItem->currentQuantity]);
+	glUniform1iARB(dataItem->semiImplicitFluxShaderUniformLocations[7],1);
+	
+	glBegin(GL_QUADS);
+	glVertex2i(0,0);
+	glVertex2i(size[0],0);
+	glVertex2i(size[0],size[1]);
+	glVertex2i(0,size[1]);
+	glEnd();
+	
+	/*********************************************************************
+	Paso 3: Resuelva el sistema lineal de las nuevas elevaciones de la
+	superficie del agua con iteraciones de Jacobi amortiguadas, empezando
+	por las elevaciones actuales.
+	*********************************************************************/
+	
+	glUseProgramObjectARB(dataItem->semiImplicitSolveShader);
+	glUniformARB<2>(dataItem->semiImplicitSolveShaderUniformLocations[0],1,cellSize);
+	glUniformARB(dataItem->semiImplicitSolveShaderUniformLocations[1],stepSize);
+	glUniformARB(dataItem->semiImplicitSolveShaderUniformLocations[2],g);
+	glActiveTextureARB(GL_TEXTURE0_ARB);
+	glBindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->faceTextureObjects[0]);
+	glUniform1iARB(dataItem->semiImplicitSolveShaderUniformLocations[3],0);
+	glUniform1iARB(dataItem->semiImplicitSolveShaderUniformLocations[4],1);
+	glUniform1iARB(dataItem->semiImplicitSolveShaderUniformLocations[5],2);
+	
+	/* La primera iteración lee las elevaciones actuales directamente del componente rojo de la textura de cantidad: */
+	GLuint levelTextureObject=dataItem->quantityTextureObjects[dataItem->currentQuantity];
+	int currentLevel=0;
+	for(unsigned int iteration=0;iteration<semiImplicitIterations;++iteration)
+		{
+		glDrawBuffer(GL_COLOR_ATTACHMENT0_EXT+2+(1-currentLevel));
+		glActiveTextureARB(GL_TEXTURE2_ARB);
+		glBindTexture(GL_TEXTURE_RECTANGLE_ARB,levelTextureObject);
+		
+		/* Ejecutar la iteración: */
+		glBegin(GL_QUADS);
+		glVertex2i(0,0);
+		glVertex2i(size[0],0);
+		glVertex2i(size[0],size[1]);
+		glVertex2i(0,size[1]);
+		glEnd();
+		
+		currentLevel=1-currentLevel;
+		levelTextureObject=dataItem->levelTextureObjects[currentLevel];
+		}
+	
+	/*********************************************************************
+	Paso 4: Calcule las nuevas descargas de las caras y los factores de
+	limitación de la salida de agua de cada celda.
+	*********************************************************************/
+	
+	glDrawBuffer(GL_COLOR_ATTACHMENT1_EXT);
+	
+	glUseProgramObjectARB(dataItem->semiImplicitDischargeShader);
+	glUniformARB<2>(dataItem->semiImplicitDischargeShaderUniformLocations[0],1,cellSize);
+	glUniformARB(dataItem->semiImplicitDischargeShaderUniformLocations[1],stepSize);
+	glUniformARB(dataItem->semiImplicitDischargeShaderUniformLocations[2],g);
+	glActiveTextureARB(GL_TEXTURE0_ARB);
+	glBindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->bathymetryTextureObjects[dataItem->currentBathymetry]);
+	glUniform1iARB(dataItem->semiImplicitDischargeShaderUniformLocations[3],0);
+	glActiveTextureARB(GL_TEXTURE3_ARB);
+	glBindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->faceTextureObjects[0]);
+	glUniform1iARB(dataItem->semiImplicitDischargeShaderUniformLocations[4],3);
+	glUniform1iARB(dataItem->semiImplicitDischargeShaderUniformLocations[5],1);
+	glActiveTextureARB(GL_TEXTURE2_ARB);
+	glBindTexture(GL_TEXTURE_RECTANGLE_ARB,levelTextureObject);
+	glUniform1iARB(dataItem->semiImplicitDischargeShaderUniformLocations[6],2);
+	
+	glBegin(GL_QUADS);
+	glVertex2i(0,0);
+	glVertex2i(size[0],0);
+	glVertex2i(size[0],size[1]);
+	glVertex2i(0,size[1]);
+	glEnd();
+	
+	/*********************************************************************
+	Paso 5: Limite las descargas y actualice las elevaciones de la
+	superficie del agua de forma conservativa.
+	*********************************************************************/
+	
+	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,dataItem->integrationFramebufferObject);
+	glDrawBuffer(GL_COLOR_ATTACHMENT0_EXT+(1-dataItem->currentQuantity));
+	
+	glUseProgramObjectARB(dataItem->semiImplicitUpdateShader);
+	glUniformARB<2>(dataItem->semiImplicitUpdateShaderUniformLocations[0],1,cellSize);
+	glUniformARB(dataItem->semiImplicitUpdateShaderUniformLocations[1],stepSize);
+	glUniform1iARB(dataItem->semiImplicitUpdateShaderUniformLocations[2],0);
+	glActiveTextureARB(GL_TEXTURE3_ARB);
+	glBindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->faceTextureObjects[1]);
+	glUniform1iARB(dataItem->semiImplicitUpdateShaderUniformLocations[3],3);
+	glUniform1iARB(dataItem->semiImplicitUpdateShaderUniformLocations[4],1);
+	
+	glBegin(GL_QUADS);
+	glVertex2i(0,0);
+	glVertex2i(size[0],0);
+	glVertex2i(size[0],size[1]);
+	glVertex2i(0,size[1]);
+	glEnd();
+	
+	/* Desenlazar texturas innecesarias: */
+	glBindTexture(GL_TEXTURE_RECTANGLE_ARB,0);
+	
+	return stepSize;
+	}
+
+GLfloat WaterTable2::runSimulationStep(bool forceStepSize,GLContextData& contextData) const
+	{
+	/* Obtener el elemento de datos: */
+	DataItem* dataItem=contextData.retrieveDataItem<DataItem>(this);
+	
+	/* Guardar el estado relevante de OpenGL: */
+	glPushAttrib(GL_COLOR_BUFFER_BIT|GL_VIEWPORT_BIT);
+	GLint currentFrameBuffer;
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING_EXT,&currentFrameBuffer);
+	
+	/* Ejecute un paso de integración con el esquema seleccionado; ambos escriben las nuevas cantidades en la textura de cantidad no actual: */
+	GLfloat stepSize;
+	if(solverMode==SEMI_IMPLICIT)
+		stepSize=semiImplicitStep(dataItem,forceStepSize);
+	else
+		stepSize=rungeKuttaStep(dataItem,forceStepSize);
+	
 	if(dryBoundary)
 		{
 		/* Configure el sombreador de condiciones de contorno para imponer límites secos: */
@@ -1087,8 +1728,49 @@ GLfloat WaterTable2::runSimulationStep(bool forceStepSize,GLContextData& context
 		
 		/* Actualizar las cantidades actuales: */
 		dataItem->currentQuantity=1-dataItem->currentQuantity;
+		
+		if(statisticsInterval!=0)
+			{
+			/* Acumule el agua realmente agregada o eliminada por la actualización en la textura de fuentes: */
+			glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,dataItem->waterFramebufferObject);
+			glDrawBuffer(GL_COLOR_ATTACHMENT1_EXT);
+			glViewport(0,0,size[0],size[1]);
+			glEnable(GL_BLEND);
+			glBlendFunc(GL_ONE,GL_ONE);
+			
+			/* Configurar el sombreador de acumulación de fuentes: */
+			glUseProgramObjectARB(dataItem->sourceShader);
+			glActiveTextureARB(GL_TEXTURE0_ARB);
+			glBindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->quantityTextureObjects[dataItem->currentQuantity]);
+			glUniform1iARB(dataItem->sourceShaderUniformLocations[0],0);
+			glActiveTextureARB(GL_TEXTURE1_ARB);
+			glBindTexture(GL_TEXTURE_RECTANGLE_ARB,dataItem->quantityTextureObjects[1-dataItem->currentQuantity]);
+			glUniform1iARB(dataItem->sourceShaderUniformLocations[1],1);
+			
+			/* Ejecutar la acumulación: */
+			glBegin(GL_QUADS);
+			glVertex2i(0,0);
+			glVertex2i(size[0],0);
+			glVertex2i(size[0],size[1]);
+			glVertex2i(0,size[1]);
+			glEnd();
+			
+			/* Restaure el estado de OpenGL: */
+			glDisable(GL_BLEND);
+			glDrawBuffer(GL_COLOR_ATTACHMENT0_EXT);
+			}
 		}
 	
+	/* Con las estadísticas desactivadas no se acumulan fuentes; la primera muestra tras reactivarlas no calcula la deriva: */
+	if(statisticsInterval==0)
+		++dataItem->numStatisticsResets;
+	
+	/* Cuente el paso y reduzca las estadísticas del agua si toca y no hay una lectura anterior en curso: */
+	++dataItem->numSteps;
+	dataItem->simulationTime+=double(stepSize);
+	if(statisticsInterval!=0&&dataItem->numSteps%statisticsInterval==0&&!dataItem->statisticsReadback.pending)
+		startStatistics(dataItem);
+	
 	/* Desenlazar todos los sombreadores y texturas: */
 	glUseProgramObjectARB(0);
 	glActiveTextureARB(GL_TEXTURE2_ARB);
@@ -1133,6 +1815,7 @@ void WaterTable2::uploadWaterTextureTransform(GLint location) const
 bool WaterTable2::requestBathymetry(GLfloat* newReadBathymetryBuffer)
 	{
 	/* Compruebe si la solicitud de batimetría anterior se ha cumplido: */
+	Threads::Mutex::Lock readbackLock(readbackMutex);
 	if(readBathymetryReply==readBathymetryRequest)
 		{
 		/* Configure la nueva solicitud de batimetría: */
@@ -1144,3 +1827,41 @@ bool WaterTable2::requestBathymetry(GLfloat* newReadBathymetryBuffer)
 	else
 		return false;
 	}
+
+void WaterTable2::cancelBathymetryRequest(GLfloat* bathymetryBuffer)
+	{
+	/* Marque la solicitud pendiente como respondida; las lecturas en curso la descartarán: */
+	Threads::Mutex::Lock readbackLock(readbackMutex);
+	if(readBathymetryReply!=readBathymetryRequest&&readBathymetryBuffer==bathymetryBuffer)
+		{
+		readBathymetryReply=readBathymetryRequest;
+		readBathymetryBuffer=0;
+		}
+	}
+
+bool WaterTable2::requestWaterLevel(GLfloat* newReadWaterLevelBuffer)
+	{
+	/* Compruebe si la solicitud de nivel de agua anterior se ha cumplido: */
+	Threads::Mutex::Lock readbackLock(readbackMutex);
+	if(readWaterLevelReply==readWaterLevelRequest)
+		{
+		/* Configure la nueva solicitud de nivel de agua: */
+		++readWaterLevelRequest;
+		readWaterLevelBuffer=newReadWaterLevelBuffer;
+		
+		return true;
+		}
+	else
+		return false;
+	}
+
+void WaterTable2::cancelWaterLevelRequest(GLfloat* waterLevelBuffer)
+	{
+	/* Marque la solicitud pendiente como respondida; las lecturas en curso la descartarán: */
+	Threads::Mutex::Lock readbackLock(readbackMutex);
+	if(readWaterLevelReply!=readWaterLevelRequest&&readWaterLevelBuffer==waterLevelBuffer)
+		{
+		readWaterLevelReply=readWaterLevelRequest;
+		readWaterLevelBuffer=0;
+		}
+	}
@@ -26,10 +26,12 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 
 #include <vector>
 #include <Misc/FunctionCalls.h>
+#include <Threads/Mutex.h>
 #include <Geometry/Point.h>
 #include <Geometry/Box.h>
 #include <Geometry/OrthonormalTransformation.h>
 #include <GL/gl.h>
+#include <GL/glext.h>
 #include <GL/Extensions/GLARBShaderObjects.h>
 #include <GL/GLObject.h>
 #include <GL/GLContextData.h>
@@ -48,7 +50,50 @@ class WaterTable2:public GLObject
 	typedef Geometry::Box<Scalar,3> Box;
 	typedef Geometry::OrthonormalTransformation<Scalar,3> ONTransform;
 	
+	struct Statistics // Estructura para las estadísticas globales del agua en la capa freática
+		{
+		/* Elementos: */
+		public:
+		unsigned int numSteps; // Número de pasos de simulación ejecutados en el momento de la muestra
+		double simulationTime; // Tiempo de simulación transcurrido en el momento de la muestra
+		double volume; // Volumen total de agua en unidades de coordenadas mundiales al cubo
+		double wetArea; // Área total de las celdas mojadas en unidades de coordenadas mundiales al cuadrado
+		double maxDepth; // Profundidad máxima del agua en unidades de coordenadas mundiales
+		double sourceVolume; // Volumen de agua agregado (positivo) o eliminado (negativo) por fuentes, sumideros y deposición de agua desde la muestra anterior
+		double drift; // Cambio de volumen desde la muestra anterior menos el volumen de fuentes y sumideros; error de conservación de la simulación
+		
+		/* Constructores y destructores: */
+		Statistics(void)
+			:numSteps(0),simulationTime(0.0),volume(0.0),wetArea(0.0),maxDepth(0.0),sourceVolume(0.0),drift(0.0)
+			{
+			}
+		};
+	
+	enum SolverMode // Enumerado para los esquemas de integración de la simulación de flujo de agua
+		{
+		RUNGE_KUTTA, // Esquema explícito de volúmenes finitos con integración Runge-Kutta de segundo orden; las cantidades son (w, hu, hv) centradas en la celda
+		SEMI_IMPLICIT // Esquema semi-implícito en una cuadrícula escalonada; las cantidades son w centrada en la celda y las descargas de las caras este y norte
+		};
+	
 	private:
+	struct PixelReadback // Estructura para una lectura asincrónica de una textura de un componente a través de un objeto de búfer de píxeles
+		{
+		/* Elementos: */
+		public:
+		GLuint bufferObject; // Objeto de búfer de píxeles que recibe la textura leída
+		GLsync fence; // Objeto de sincronización señalado cuando la GPU terminó de escribir en el búfer de píxeles, o 0
+		bool pending; // Marcar si hay una lectura en curso en el búfer de píxeles
+		unsigned int numFrames; // Número de fotogramas que la lectura actual ha estado en curso
+		unsigned int token; // Token de solicitud atendido por la lectura actual
+		GLfloat* buffer; // Buffer de la aplicación en el que copiar el resultado de la lectura actual
+		
+		/* Constructores y destructores: */
+		PixelReadback(void)
+			:bufferObject(0),fence(0),pending(false),numFrames(0),token(0),buffer(0)
+			{
+			}
+		};
+	
 	struct DataItem:public GLObject::DataItem // Estructura que mantiene el estado por contexto
 		{
 		/* Elementos: */
@@ -61,11 +106,17 @@ class WaterTable2:public GLObject
 		GLuint derivativeTextureObject; // Objeto de textura de color de tres componentes que contiene la cuadrícula derivada temporal centrada en la celda
 		GLuint maxStepSizeTextureObjects[2]; // Objetos de textura de color de un componente con doble búfer para reunir el tamaño de paso máximo para los pasos de integración de Runge-Kutta
 		GLuint waterTextureObject; // Objeto de textura de color de un componente para agregar o eliminar agua a / de la cuadrícula de cantidad conservada
+		GLuint sourceTextureObject; // Objeto de textura de color de un componente que acumula el agua realmente agregada o eliminada por celda desde la última reducción de estadísticas
+		GLuint faceTextureObjects[2]; // Objetos de textura de color de cuatro componentes para los pasos semi-implícitos: descargas explícitas y profundidades de flujo de las caras, y nuevas descargas con factores de limitación
+		GLuint levelTextureObjects[2]; // Objetos de textura de color de un componente con doble búfer para las iteraciones de Jacobi de los pasos semi-implícitos
+		GLuint statisticsTextureObjects[2]; // Objetos de textura de color de cuatro componentes con doble búfer para reducir las estadísticas del agua (suma de profundidades, celdas mojadas, profundidad máxima)
 		GLuint bathymetryFramebufferObject; // Tampón de marco utilizado para representar la superficie de batimetría en la cuadrícula de batimetría
 		GLuint derivativeFramebufferObject; // Memoria intermedia de trama utilizada para el cálculo derivativo temporal
 		GLuint maxStepSizeFramebufferObject; // El buffer de trama se usa para calcular el tamaño máximo del paso de integración
 		GLuint integrationFramebufferObject; // Frame buffer utilizado para los pasos de integración de Euler y Runge-Kutta
 		GLuint waterFramebufferObject; // Frame buffer utilizado para el paso de renderizado de agua
+		GLuint semiImplicitFramebufferObject; // Búfer de marco utilizado para los pasos semi-implícitos
+		GLuint statisticsFramebufferObject; // Búfer de marco utilizado para reducir las estadísticas del agua
 		GLhandleARB bathymetryShader; // Shader para actualizar cantidades conservadas centradas en celdas después de un cambio en la cuadrícula de batimetría
 		GLint bathymetryShaderUniformLocations[3];
 		GLhandleARB waterAdaptShader; // Shader para adaptar una nueva cuadrícula de cantidad conservada a la cuadrícula de batimetría actual
@@ -74,6 +125,8 @@ class WaterTable2:public GLObject
 		GLint derivativeShaderUniformLocations[6];
 		GLhandleARB maxStepSizeShader; // Shader para calcular un tamaño de paso máximo para un paso de integración Runge-Kutta posterior
 		GLint maxStepSizeShaderUniformLocations[2];
+		GLhandleARB waveSpeedShader; // Shader para calcular el tamaño de paso máximo de cada celda a partir de su velocidad de onda local
+		GLint waveSpeedShaderUniformLocations[5];
 		GLhandleARB boundaryShader; // Shader para imponer condiciones de contorno en la cuadrícula de cantidades
 		GLint boundaryShaderUniformLocations[1];
 		GLhandleARB eulerStepShader; // Shader para calcular un paso de integración de Euler
@@ -84,6 +137,37 @@ class WaterTable2:public GLObject
 		GLint waterAddShaderUniformLocations[3];
 		GLhandleARB waterShader; // Shader para agregar o eliminar agua de la cuadrícula de cantidades conservadas
 		GLint waterShaderUniformLocations[3];
+		GLhandleARB sourceShader; // Shader para acumular el agua agregada o eliminada por el paso de actualización de agua
+		GLint sourceShaderUniformLocations[2];
+		GLhandleARB semiImplicitFluxShader; // Shader para calcular las descargas explícitas y las profundidades de flujo de las caras de un paso semi-implícito
+		GLint semiImplicitFluxShaderUniformLocations[8];
+		GLhandleARB semiImplicitSolveShader; // Shader para ejecutar una iteración de Jacobi de un paso semi-implícito
+		GLint semiImplicitSolveShaderUniformLocations[6];
+		GLhandleARB semiImplicitDischargeShader; // Shader para calcular las nuevas descargas de las caras y los factores de limitación de un paso semi-implícito
+		GLint semiImplicitDischargeShaderUniformLocations[7];
+		GLhandleARB semiImplicitUpdateShader; // Shader para actualizar las cantidades conservadas al final de un paso semi-implícito
+		GLint semiImplicitUpdateShaderUniformLocations[5];
+		GLhandleARB statisticsShader; // Shader para calcular las estadísticas del agua de bloques de 2x2 celdas
+		GLint statisticsShaderUniformLocations[5];
+		GLhandleARB statisticsReduceShader; // Shader para reducir la textura de estadísticas del agua por un factor de dos
+		GLint statisticsReduceShaderUniformLocations[2];
+		bool haveSync; // Marcar si el contexto admite GL_ARB_sync para sondear lecturas asincrónicas
+		PFNGLFENCESYNCPROC glFenceSyncProc; // Punteros a funciones de GL_ARB_sync
+		PFNGLCLIENTWAITSYNCPROC glClientWaitSyncProc;
+		PFNGLDELETESYNCPROC glDeleteSyncProc;
+		PixelReadback bathymetryReadback; // Lectura asincrónica de la cuadrícula de batimetría
+		PixelReadback waterLevelReadback; // Lectura asincrónica del componente de nivel de agua de la cuadrícula de cantidad conservada
+		PixelReadback statisticsReadback; // Lectura asincrónica del resultado de la reducción de estadísticas del agua
+		GLfloat statisticsBuffer[4]; // Buffer que recibe el resultado de la reducción de estadísticas del agua
+		unsigned int numSteps; // Número de pasos de simulación ejecutados en este contexto
+		double simulationTime; // Tiempo de simulación transcurrido en este contexto
+		unsigned int statisticsNumSteps; // Número de pasos de simulación en el momento de la reducción de estadísticas en curso
+		double statisticsSimulationTime; // Tiempo de simulación en el momento de la reducción de estadísticas en curso
+		unsigned int numStatisticsResets; // Número de veces que se interrumpió la acumulación de fuentes en este contexto
+		unsigned int statisticsNumResets; // Número de interrupciones en el momento de la reducción de estadísticas en curso
+		bool haveStatistics; // Marcar si este contexto ya completó una muestra de estadísticas
+		unsigned int lastNumResets; // Número de interrupciones en el momento de la muestra de estadísticas anterior
+		double lastVolume; // Volumen de agua de la muestra de estadísticas anterior
 		
 		/* Constructores y destructores: */
 		DataItem(void);
@@ -104,18 +188,40 @@ class WaterTable2:public GLObject
 	GLfloat epsilon; // Coeficiente para desingularizar operador de división
 	GLfloat attenuation; // Factor de atenuación para descargas parciales
 	GLfloat maxStepSize; // Tamaño máximo de paso para cada paso de integración Runge-Kutta
+	SolverMode solverMode; // Esquema de integración de la simulación de flujo de agua
+	unsigned int semiImplicitIterations; // Número de iteraciones de Jacobi por paso semi-implícito
+	GLfloat semiImplicitStepFactor; // Múltiplo del tamaño de paso estable del esquema explícito que usan los pasos semi-implícitos
+	GLfloat friction; // Coeficiente de fricción del fondo de los pasos semi-implícitos
+	GLfloat dryDepth; // Profundidad de flujo por debajo de la cual una cara no transporta agua en los pasos semi-implícitos
 	PTransform waterTextureTransform; // Transformación proyectiva del espacio de la cámara al espacio de textura del nivel del agua
 	GLfloat waterTextureTransformMatrix[16]; // Lo mismo en formato compatible con GLSL
 	std::vector<const AddWaterFunction*> renderFunctions; // Una lista de funciones que se llaman después de cada paso de simulación de flujo de agua para agregar o eliminar agua localmente de la capa freática
 	GLfloat waterDeposit; // Una cantidad fija de agua agregada en cada iteración de la simulación de flujo, para evaporación, etc.
 	bool dryBoundary; // Marque si se deben aplicar condiciones de límite seco al final de cada paso de simulación
+	mutable Threads::Mutex readbackMutex; // Mutex que protege los tokens y búferes de las solicitudes de lectura frente a los contextos que las atienden
 	unsigned int readBathymetryRequest; // Solicitar token para volver a leer la cuadrícula de batimetría actual de la GPU
 	mutable GLfloat* readBathymetryBuffer; // Buffer en el que leer la cuadrícula de batimetría actual
 	mutable unsigned int readBathymetryReply; // Token de respuesta después de volver a leer la cuadrícula de batimetría actual
+	unsigned int readWaterLevelRequest; // Solicitar token para volver a leer el nivel de agua actual de la GPU
+	mutable GLfloat* readWaterLevelBuffer; // Buffer en el que leer el nivel de agua actual
+	mutable unsigned int readWaterLevelReply; // Token de respuesta después de volver a leer el nivel de agua actual
+	unsigned int statisticsInterval; // Número de pasos de simulación entre reducciones de estadísticas del agua, o 0 para no calcularlas
+	GLfloat wetDepth; // Profundidad mínima del agua para contar una celda como mojada
+	mutable Statistics statistics; // La muestra de estadísticas del agua más reciente
+	mutable unsigned int statisticsVersion; // Número de versión de la muestra de estadísticas del agua más reciente
 	
 	/* Métodos privados: */
 	void calcTransformations(void); // Calcula transformaciones derivadas
+	void startReadback(DataItem* dataItem,PixelReadback& readback,GLuint textureObject,GLfloat* buffer,unsigned int token) const; // Inicia la lectura asincrónica del componente rojo del objeto de textura dado en el búfer de píxeles de la lectura dada
+	bool finishReadback(DataItem* dataItem,PixelReadback& readback,GLsizei width,GLsizei height,const unsigned int* requestToken,unsigned int* replyToken) const; // Completa la lectura dada si la GPU ha terminado; con tokens, solo copia el resultado si su solicitud sigue sin respuesta y la marca como respondida; devuelve verdadero si el resultado se copió en el búfer de la aplicación
+	void processReadbacks(DataItem* dataItem) const; // Inicia lecturas solicitadas y completa lecturas terminadas; se llama una vez por fotograma
+	void startStatistics(DataItem* dataItem) const; // Reduce las cantidades conservadas actuales a estadísticas globales del agua e inicia su lectura asincrónica
+	void finishStatistics(DataItem* dataItem) const; // Convierte el resultado leído de la reducción de estadísticas en una nueva muestra de estadísticas
+	GLfloat reduceMaxStepSize(DataItem* dataItem) const; // Reduce la textura de tamaño de paso máximo por celda a su mínimo y lo devuelve limitado a maxStepSize
 	GLfloat calcDerivative(DataItem* dataItem,GLuint quantityTextureObject,bool calcMaxStepSize) const; // Calcula la derivada temporal de las cantidades conservadas en el objeto de textura dado y devuelve el tamaño de paso máximo si la marca es verdadera
+	GLfloat calcWaveSpeedStepSize(DataItem* dataItem) const; // Devuelve el tamaño de paso máximo de las cantidades actuales estimado a partir de la velocidad de onda máxima, sin calcular flujos
+	GLfloat rungeKuttaStep(DataItem* dataItem,bool forceStepSize) const; // Ejecuta un paso de integración Runge-Kutta en la textura de cantidad no actual; devuelve el tamaño de paso
+	GLfloat semiImplicitStep(DataItem* dataItem,bool forceStepSize) const; // Ejecuta un paso semi-implícito en la textura de cantidad no actual; devuelve el tamaño de paso
 	
 	/* Constructores y destructores: */
 	public:
@@ -154,6 +260,12 @@ class WaterTable2:public GLObject
 	void setElevationRange(Scalar newMin,Scalar newMax); // Establece el rango de elevaciones posibles en la capa freática.
 	void setAttenuation(GLfloat newAttenuation); // Establece el factor de atenuación para descargas parciales
 	void setMaxStepSize(GLfloat newMaxStepSize); // Establece el tamaño de paso máximo para todos los pasos de integración posteriores
+	SolverMode getSolverMode(void) const // Devuelve el esquema de integración de la simulación de flujo de agua
+		{
+		return solverMode;
+		}
+	void setSolverMode(SolverMode newSolverMode); // Establece el esquema de integración; debe llamarse antes del primer paso de simulación, ya que ambos esquemas interpretan las descargas de forma distinta
+	void setSemiImplicitParameters(unsigned int newIterations,GLfloat newStepFactor,GLfloat newFriction); // Establece el número de iteraciones de Jacobi, el múltiplo del tamaño de paso explícito y el coeficiente de fricción de los pasos semi-implícitos
 	const PTransform& getWaterTextureTransform(void) const // Devuelve la matriz que se transforma del espacio de la cámara en espacio de textura de agua
 		{
 		return waterTextureTransform;
@@ -177,11 +289,34 @@ class WaterTable2:public GLObject
 		{
 		return size[index]-1;
 		}
-	bool requestBathymetry(GLfloat* newReadBathymetryBuffer); // Solicita la lectura de la cuadrícula de batimetría actual de la GPU durante el siguiente ciclo de representación; devuelve verdadero si se puede otorgar la solicitud
+	bool requestBathymetry(GLfloat* newReadBathymetryBuffer); // Solicita la lectura asincrónica de la cuadrícula de batimetría actual de la GPU; el resultado llega uno o más ciclos de representación después; devuelve verdadero si se puede otorgar la solicitud
 	bool haveBathymetry(void) const // Devuelve verdadero si se ha cumplido la solicitud de batimetría más reciente
 		{
+		Threads::Mutex::Lock readbackLock(readbackMutex);
 		return readBathymetryReply==readBathymetryRequest;
 		}
+	void cancelBathymetryRequest(GLfloat* bathymetryBuffer); // Cancela la solicitud de batimetría pendiente si lee en el búfer dado; después de regresar, ningún contexto escribe en el búfer
+	bool requestWaterLevel(GLfloat* newReadWaterLevelBuffer); // Solicita la lectura asincrónica de la elevación de la superficie del agua centrada en la celda (size[0]*size[1] valores) de la GPU; devuelve verdadero si se puede otorgar la solicitud
+	bool haveWaterLevel(void) const // Devuelve verdadero si se ha cumplido la solicitud de nivel de agua más reciente
+		{
+		Threads::Mutex::Lock readbackLock(readbackMutex);
+		return readWaterLevelReply==readWaterLevelRequest;
+		}
+	void cancelWaterLevelRequest(GLfloat* waterLevelBuffer); // Cancela la solicitud de nivel de agua pendiente si lee en el búfer dado; después de regresar, ningún contexto escribe en el búfer
+	unsigned int getStatisticsInterval(void) const // Devuelve el número de pasos de simulación entre muestras de estadísticas del agua
+		{
+		return statisticsInterval;
+		}
+	void setStatisticsInterval(unsigned int newStatisticsInterval); // Establece el número de pasos de simulación entre muestras de estadísticas del agua; 0 las desactiva
+	void setWetDepth(GLfloat newWetDepth); // Establece la profundidad mínima del agua para contar una celda como mojada
+	unsigned int getStatisticsVersion(void) const // Devuelve el número de versión de la muestra de estadísticas del agua más reciente
+		{
+		return statisticsVersion;
+		}
+	const Statistics& getStatistics(void) const // Devuelve la muestra de estadísticas del agua más reciente
+		{
+		return statistics;
+		}
 	};
 
 #endif
@@ -0,0 +1,41 @@
+/***********************************************************************
+SurfaceAddAnalyticContourLines - Shader fragment to add anti-aliased
+topographic contour lines to a surface's base color, using screen-space
+derivatives of the interpolated surface elevation instead of a separate
+pixel-corner elevation pass.
+Copyright (c) 2026 Sergio081096
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+uniform float contourLineFactor;
+
+void addContourLines(in float elevation,inout vec4 baseColor)
+	{
+	/* Express the fragment's elevation in units of the contour line distance: */
+	float contour=elevation*contourLineFactor;
+	
+	/* Calculate the distance to the closest contour line and the length of the contour gradient in screen space: */
+	float dist=abs(fract(contour+0.5)-0.5);
+	float pixelWidth=max(length(vec2(dFdx(contour),dFdy(contour))),1.0e-6);
+	
+	/* Calculate the pixel's coverage by a contour line that is one pixel wide, box-filtered over the pixel: */
+	float coverage=1.0-clamp(dist/pixelWidth,0.0,1.0);
+	
+	/* Topographic contour lines are rendered in black: */
+	baseColor=mix(baseColor,vec4(0.0,0.0,0.0,1.0),coverage);
+	}
@@ -0,0 +1,74 @@
+/***********************************************************************
+Water2SemiImplicitDischargeShader - Shader to compute the new face
+discharges from the solved water surface elevations and the factor by
+which each cell's outflow has to be limited to keep its water column
+non-negative for a semi-implicit water flow simulation step.
+Copyright (c) 2026 Sergio081096
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#extension GL_ARB_texture_rectangle : enable
+
+uniform vec2 cellSize;
+uniform float stepSize;
+uniform float g;
+uniform sampler2DRect bathymetrySampler;
+uniform sampler2DRect faceSampler;
+uniform sampler2DRect quantitySampler;
+uniform sampler2DRect levelSampler;
+
+float cellBathymetry(vec2 cell)
+	{
+	/* Calculate the bathymetry elevation at the center of the cell: */
+	return (texture2DRect(bathymetrySampler,vec2(cell.x-1.0,cell.y-1.0)).r+
+	        texture2DRect(bathymetrySampler,vec2(cell.x,cell.y-1.0)).r+
+	        texture2DRect(bathymetrySampler,vec2(cell.x-1.0,cell.y)).r+
+	        texture2DRect(bathymetrySampler,cell).r)*0.25;
+	}
+
+void main()
+	{
+	/* Get the explicit discharges and flow depths across all four faces of this cell; faces on the grid boundary are closed: */
+	vec4 fc=texture2DRect(faceSampler,gl_FragCoord.xy);
+	vec2 fw=gl_FragCoord.x>1.0?texture2DRect(faceSampler,vec2(gl_FragCoord.x-1.0,gl_FragCoord.y)).xz:vec2(0.0);
+	vec2 fs=gl_FragCoord.y>1.0?texture2DRect(faceSampler,vec2(gl_FragCoord.x,gl_FragCoord.y-1.0)).yw:vec2(0.0);
+	
+	/* Get the solved water surface elevations of this cell and its four neighbors: */
+	float l=texture2DRect(levelSampler,gl_FragCoord.xy).r;
+	float le=texture2DRect(levelSampler,vec2(gl_FragCoord.x+1.0,gl_FragCoord.y)).r;
+	float lw=texture2DRect(levelSampler,vec2(gl_FragCoord.x-1.0,gl_FragCoord.y)).r;
+	float ln=texture2DRect(levelSampler,vec2(gl_FragCoord.x,gl_FragCoord.y+1.0)).r;
+	float ls=texture2DRect(levelSampler,vec2(gl_FragCoord.x,gl_FragCoord.y-1.0)).r;
+	
+	/* Calculate the new discharges across all four faces: */
+	vec2 gdt=vec2(g*stepSize)/cellSize;
+	float qe=fc.x-gdt.x*fc.z*(le-l);
+	float qw=fw.x-gdt.x*fw.y*(l-lw);
+	float qn=fc.y-gdt.y*fc.w*(ln-l);
+	float qs=fs.x-gdt.y*fs.y*(l-ls);
+	
+	/* Calculate the water column height that would leave the cell during the step: */
+	float outflow=stepSize*((max(qe,0.0)-min(qw,0.0))/cellSize.x+(max(qn,0.0)-min(qs,0.0))/cellSize.y);
+	
+	/* Calculate the outflow limiting factor from the current water column height: */
+	float h=max(texture2DRect(quantitySampler,gl_FragCoord.xy).r-cellBathymetry(gl_FragCoord.xy),0.0);
+	float limit=outflow>h?h/outflow:1.0;
+	
+	/* Write the discharges across the east and north faces and the outflow limiting factor: */
+	gl_FragData[0]=vec4(qe,qn,limit,0.0);
+	}
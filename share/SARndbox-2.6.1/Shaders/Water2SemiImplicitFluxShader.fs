@@ -0,0 +1,77 @@
+/***********************************************************************
+Water2SemiImplicitFluxShader - Shader to compute the explicit parts of
+the discharges and the friction-adjusted flow depths across the east and
+north faces of each cell for a semi-implicit water flow simulation step.
+Copyright (c) 2026 Sergio081096
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#extension GL_ARB_texture_rectangle : enable
+
+uniform vec2 gridSize;
+uniform float stepSize;
+uniform float g;
+uniform float friction;
+uniform float attenuation;
+uniform float dryDepth;
+uniform sampler2DRect bathymetrySampler;
+uniform sampler2DRect quantitySampler;
+
+float cellBathymetry(vec2 cell)
+	{
+	/* Calculate the bathymetry elevation at the center of the cell: */
+	return (texture2DRect(bathymetrySampler,vec2(cell.x-1.0,cell.y-1.0)).r+
+	        texture2DRect(bathymetrySampler,vec2(cell.x,cell.y-1.0)).r+
+	        texture2DRect(bathymetrySampler,vec2(cell.x-1.0,cell.y)).r+
+	        texture2DRect(bathymetrySampler,cell).r)*0.25;
+	}
+
+vec2 calcFace(float q,float h)
+	{
+	/* Dry faces do not carry any discharge: */
+	if(h<=dryDepth)
+		return vec2(0.0,0.0);
+	
+	/* Treat bottom friction implicitly by dividing discharge and flow depth by the friction term: */
+	float f=1.0+g*stepSize*friction*abs(q)/pow(h,7.0/3.0);
+	return vec2(q,h)/f;
+	}
+
+void main()
+	{
+	/* Get the quantities of this cell and the water surface elevations of its east and north neighbors: */
+	vec3 q=texture2DRect(quantitySampler,gl_FragCoord.xy).rgb;
+	float we=texture2DRect(quantitySampler,vec2(gl_FragCoord.x+1.0,gl_FragCoord.y)).r;
+	float wn=texture2DRect(quantitySampler,vec2(gl_FragCoord.x,gl_FragCoord.y+1.0)).r;
+	
+	/* Calculate the bathymetry elevations of this cell and its east and north neighbors: */
+	float b=cellBathymetry(gl_FragCoord.xy);
+	float be=cellBathymetry(vec2(gl_FragCoord.x+1.0,gl_FragCoord.y));
+	float bn=cellBathymetry(vec2(gl_FragCoord.x,gl_FragCoord.y+1.0));
+	
+	/* Calculate the flow depths across the east and north faces; faces on the grid boundary are closed: */
+	float he=gl_FragCoord.x<gridSize.x-1.0?max(q.x,we)-max(b,be):0.0;
+	float hn=gl_FragCoord.y<gridSize.y-1.0?max(q.x,wn)-max(b,bn):0.0;
+	
+	/* Calculate the explicit discharges and flow depths of the east and north faces: */
+	vec2 fe=calcFace(q.y*attenuation,he);
+	vec2 fn=calcFace(q.z*attenuation,hn);
+	
+	/* Write the explicit discharges and flow depths: */
+	gl_FragData[0]=vec4(fe.x,fn.x,fe.y,fn.y);
+	}
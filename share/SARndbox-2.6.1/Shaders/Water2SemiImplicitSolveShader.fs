@@ -0,0 +1,59 @@
+/***********************************************************************
+Water2SemiImplicitSolveShader - Shader to run one damped Jacobi
+iteration of the linear system for the new water surface elevations of a
+semi-implicit water flow simulation step.
+Copyright (c) 2026 Sergio081096
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#extension GL_ARB_texture_rectangle : enable
+
+uniform vec2 cellSize;
+uniform float stepSize;
+uniform float g;
+uniform sampler2DRect faceSampler;
+uniform sampler2DRect quantitySampler;
+uniform sampler2DRect levelSampler;
+
+void main()
+	{
+	/* Get the explicit discharges and flow depths across all four faces of this cell; faces on the grid boundary are closed: */
+	vec4 fc=texture2DRect(faceSampler,gl_FragCoord.xy);
+	vec2 fw=gl_FragCoord.x>1.0?texture2DRect(faceSampler,vec2(gl_FragCoord.x-1.0,gl_FragCoord.y)).xz:vec2(0.0);
+	vec2 fs=gl_FragCoord.y>1.0?texture2DRect(faceSampler,vec2(gl_FragCoord.x,gl_FragCoord.y-1.0)).yw:vec2(0.0);
+	
+	/* Calculate the explicit right-hand side from the previous water surface elevation: */
+	float rhs=texture2DRect(quantitySampler,gl_FragCoord.xy).r-stepSize*((fc.x-fw.x)/cellSize.x+(fc.y-fs.x)/cellSize.y);
+	
+	/* Calculate the coefficients of the implicit surface gradient terms: */
+	vec2 c=vec2(g*stepSize*stepSize)/(cellSize*cellSize);
+	float ce=c.x*fc.z;
+	float cw=c.x*fw.y;
+	float cn=c.y*fc.w;
+	float cs=c.y*fs.y;
+	
+	/* Solve for the new water surface elevation using the current estimates of the neighbors: */
+	float l=texture2DRect(levelSampler,gl_FragCoord.xy).r;
+	float off=ce*texture2DRect(levelSampler,vec2(gl_FragCoord.x+1.0,gl_FragCoord.y)).r+
+	          cw*texture2DRect(levelSampler,vec2(gl_FragCoord.x-1.0,gl_FragCoord.y)).r+
+	          cn*texture2DRect(levelSampler,vec2(gl_FragCoord.x,gl_FragCoord.y+1.0)).r+
+	          cs*texture2DRect(levelSampler,vec2(gl_FragCoord.x,gl_FragCoord.y-1.0)).r;
+	
+	/* Damp the Jacobi update to suppress checkerboard oscillations: */
+	gl_FragData[0]=vec4(mix(l,(rhs+off)/(1.0+ce+cw+cn+cs),2.0/3.0),0.0,0.0,0.0);
+	}
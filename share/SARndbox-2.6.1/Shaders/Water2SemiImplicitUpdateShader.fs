@@ -0,0 +1,62 @@
+/***********************************************************************
+Water2SemiImplicitUpdateShader - Shader to limit the new face
+discharges by the outflow limiting factors of their upstream cells and to
+update the water surface elevations conservatively for a semi-implicit
+water flow simulation step.
+Copyright (c) 2026 Sergio081096
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#extension GL_ARB_texture_rectangle : enable
+
+uniform vec2 cellSize;
+uniform float stepSize;
+uniform sampler2DRect bathymetrySampler;
+uniform sampler2DRect dischargeSampler;
+uniform sampler2DRect quantitySampler;
+
+float cellBathymetry(vec2 cell)
+	{
+	/* Calculate the bathymetry elevation at the center of the cell: */
+	return (texture2DRect(bathymetrySampler,vec2(cell.x-1.0,cell.y-1.0)).r+
+	        texture2DRect(bathymetrySampler,vec2(cell.x,cell.y-1.0)).r+
+	        texture2DRect(bathymetrySampler,vec2(cell.x-1.0,cell.y)).r+
+	        texture2DRect(bathymetrySampler,cell).r)*0.25;
+	}
+
+void main()
+	{
+	/* Get the discharges and limiting factors of this cell and its four neighbors: */
+	vec3 dc=texture2DRect(dischargeSampler,gl_FragCoord.xy).rgb;
+	float le=texture2DRect(dischargeSampler,vec2(gl_FragCoord.x+1.0,gl_FragCoord.y)).b;
+	float ln=texture2DRect(dischargeSampler,vec2(gl_FragCoord.x,gl_FragCoord.y+1.0)).b;
+	vec3 dw=gl_FragCoord.x>1.0?texture2DRect(dischargeSampler,vec2(gl_FragCoord.x-1.0,gl_FragCoord.y)).rgb:vec3(0.0);
+	vec3 ds=gl_FragCoord.y>1.0?texture2DRect(dischargeSampler,vec2(gl_FragCoord.x,gl_FragCoord.y-1.0)).rgb:vec3(0.0);
+	
+	/* Limit every face discharge by the limiting factor of the cell it drains: */
+	float qe=dc.x*(dc.x>0.0?dc.z:le);
+	float qn=dc.y*(dc.y>0.0?dc.z:ln);
+	float qw=dw.x*(dw.x>0.0?dw.z:dc.z);
+	float qs=ds.y*(ds.y>0.0?ds.z:dc.z);
+	
+	/* Update the water surface elevation from the net discharge into the cell: */
+	float w=texture2DRect(quantitySampler,gl_FragCoord.xy).r-stepSize*((qe-qw)/cellSize.x+(qn-qs)/cellSize.y);
+	
+	/* Write the new water surface elevation and the discharges across the east and north faces: */
+	gl_FragColor=vec4(max(w,cellBathymetry(gl_FragCoord.xy)),qe,qn,0.0);
+	}
@@ -0,0 +1,36 @@
+/***********************************************************************
+Water2SourceAccumulateShader - Shader to additively accumulate the
+change in water surface height applied by the water update step, to
+account for water sources and sinks in the water statistics.
+Copyright (c) 2026 Sergio081096
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#extension GL_ARB_texture_rectangle : enable
+
+uniform sampler2DRect newQuantitySampler;
+uniform sampler2DRect oldQuantitySampler;
+
+void main()
+	{
+	/* Calculate the change in water surface height applied to this cell: */
+	float dw=texture2DRect(newQuantitySampler,gl_FragCoord.xy).r-texture2DRect(oldQuantitySampler,gl_FragCoord.xy).r;
+	
+	/* Write the change for additive blending into the source texture: */
+	gl_FragColor=vec4(dw,0.0,0.0,0.0);
+	}
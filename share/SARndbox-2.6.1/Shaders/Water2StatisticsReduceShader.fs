@@ -0,0 +1,52 @@
+/***********************************************************************
+Water2StatisticsReduceShader - Shader to reduce the water statistics
+texture by a factor of two by summing total depths, wet cell counts, and
+source water, and taking the maximum of maximum depths of 2x2 blocks of
+pixels.
+Copyright (c) 2012 Oliver Kreylos
+Copyright (c) 2026 Sergio081096
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#extension GL_ARB_texture_rectangle : enable
+
+uniform vec2 fullTextureSize;
+uniform sampler2DRect statisticsSampler;
+
+vec4 combine(vec4 s1,vec4 s2)
+	{
+	return vec4(s1.xy+s2.xy,max(s1.z,s2.z),s1.w+s2.w);
+	}
+
+void main()
+	{
+	/* Calculate the base position of a 2x2 tile of pixels: */
+	vec2 frag=gl_FragCoord.xy*2.0-vec2(0.5,0.5);
+	
+	/* Combine the statistics of the 2x2 tile: */
+	vec4 stats=texture2DRect(statisticsSampler,frag);
+	if(frag.x<fullTextureSize.x)
+		stats=combine(stats,texture2DRect(statisticsSampler,vec2(frag.x+1.0,frag.y)));
+	if(frag.y<fullTextureSize.y)
+		stats=combine(stats,texture2DRect(statisticsSampler,vec2(frag.x,frag.y+1.0)));
+	if(frag.x<fullTextureSize.x&&frag.y<fullTextureSize.y)
+		stats=combine(stats,texture2DRect(statisticsSampler,vec2(frag.x+1.0,frag.y+1.0)));
+	
+	/* Assign the combined statistics to the result frame buffer: */
+	gl_FragData[0]=stats;
+	}
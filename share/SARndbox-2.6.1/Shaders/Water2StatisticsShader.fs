@@ -0,0 +1,70 @@
+/***********************************************************************
+Water2StatisticsShader - Shader to compute the total water depth, the
+number of wet cells, the maximum water depth, and the total water added
+by sources and sinks of 2x2 blocks of cells as the first step of a
+global water statistics reduction.
+Copyright (c) 2012 Oliver Kreylos
+Copyright (c) 2026 Sergio081096
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#extension GL_ARB_texture_rectangle : enable
+
+uniform vec2 fullTextureSize;
+uniform float wetDepth;
+uniform sampler2DRect bathymetrySampler;
+uniform sampler2DRect quantitySampler;
+uniform sampler2DRect sourceSampler;
+
+vec4 cellStatistics(vec2 cell)
+	{
+	/* Calculate the bathymetry elevation at the center of the cell: */
+	float b=(texture2DRect(bathymetrySampler,vec2(cell.x-1.0,cell.y-1.0)).r+
+	         texture2DRect(bathymetrySampler,vec2(cell.x,cell.y-1.0)).r+
+	         texture2DRect(bathymetrySampler,vec2(cell.x-1.0,cell.y)).r+
+	         texture2DRect(bathymetrySampler,cell).r)*0.25;
+	
+	/* Calculate the water column height of the cell: */
+	float h=max(texture2DRect(quantitySampler,cell).r-b,0.0);
+	
+	/* Return the cell's depth, wet flag, depth again for the maximum, and accumulated source water: */
+	return vec4(h,h>wetDepth?1.0:0.0,h,texture2DRect(sourceSampler,cell).r);
+	}
+
+vec4 combine(vec4 s1,vec4 s2)
+	{
+	return vec4(s1.xy+s2.xy,max(s1.z,s2.z),s1.w+s2.w);
+	}
+
+void main()
+	{
+	/* Calculate the base position of a 2x2 tile of cells: */
+	vec2 frag=gl_FragCoord.xy*2.0-vec2(0.5,0.5);
+	
+	/* Accumulate the statistics of the 2x2 tile: */
+	vec4 stats=cellStatistics(frag);
+	if(frag.x<fullTextureSize.x)
+		stats=combine(stats,cellStatistics(vec2(frag.x+1.0,frag.y)));
+	if(frag.y<fullTextureSize.y)
+		stats=combine(stats,cellStatistics(vec2(frag.x,frag.y+1.0)));
+	if(frag.x<fullTextureSize.x&&frag.y<fullTextureSize.y)
+		stats=combine(stats,cellStatistics(vec2(frag.x+1.0,frag.y+1.0)));
+	
+	/* Assign the statistics of the 2x2 tile to the result frame buffer: */
+	gl_FragData[0]=stats;
+	}
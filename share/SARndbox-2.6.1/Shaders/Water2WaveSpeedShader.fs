@@ -0,0 +1,52 @@
+/***********************************************************************
+Water2WaveSpeedShader - Shader to compute the maximum stable step size
+of each cell from its local wave speed |u|+sqrt(g*h), as a cheap
+replacement of the full flux computation for sizing semi-implicit
+steps.
+Copyright (c) 2012 Oliver Kreylos
+Copyright (c) 2026 Sergio081096
+
+This file is part of the Augmented Reality Sandbox (SARndbox).
+
+The Augmented Reality Sandbox is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version.
+
+The Augmented Reality Sandbox is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the Augmented Reality Sandbox; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+***********************************************************************/
+
+#extension GL_ARB_texture_rectangle : enable
+
+uniform vec2 cellSize;
+uniform float g;
+uniform float epsilon;
+uniform sampler2DRect bathymetrySampler;
+uniform sampler2DRect quantitySampler;
+
+void main()
+	{
+	/* Calculate the bathymetry elevation at the center of this cell: */
+	float b=(texture2DRect(bathymetrySampler,vec2(gl_FragCoord.x-1.0,gl_FragCoord.y-1.0)).r+
+	         texture2DRect(bathymetrySampler,vec2(gl_FragCoord.x,gl_FragCoord.y-1.0)).r+
+	         texture2DRect(bathymetrySampler,vec2(gl_FragCoord.x-1.0,gl_FragCoord.y)).r+
+	         texture2DRect(bathymetrySampler,gl_FragCoord.xy).r)*0.25;
+	
+	/* Calculate the water column height and the desingularized flow speeds of this cell: */
+	vec3 q=texture2DRect(quantitySampler,gl_FragCoord.xy).rgb;
+	float h=max(q.x-b,0.0);
+	float h4=h*h*h*h;
+	vec2 uv=abs(q.yz)*(1.41421356237309*h/sqrt(h4+max(h4,epsilon)));
+	
+	/* Calculate the maximum step size from the local wave speeds: */
+	float sgh=sqrt(g*h);
+	vec2 maxStepSize=(cellSize*0.5)/(uv+vec2(sgh));
+	gl_FragData[0]=vec4(min(maxStepSize.x,maxStepSize.y),0.0,0.0,0.0);
+	}